@@ -0,0 +1,319 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "benchmarks/baseline_comparison.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "benchmarks/benchmark_baseline.pb.h"
+#include "google/protobuf/repeated_field.h"
+#include "google/protobuf/util/json_util.h"
+
+namespace distributed_point_functions {
+
+namespace {
+
+// Returns the number of nanoseconds in `time_unit`, or 0 if it is unknown.
+double NanosecondsPerUnit(absl::string_view time_unit) {
+  if (time_unit == "ns") {
+    return 1;
+  } else if (time_unit == "us") {
+    return 1e3;
+  } else if (time_unit == "ms") {
+    return 1e6;
+  } else if (time_unit == "s") {
+    return 1e9;
+  }
+  return 0;
+}
+
+// Google Benchmark writes non-finite counters as bare NaN and Infinity tokens,
+// which are not valid JSON. Returns a copy of `json` where these are replaced
+// by the quoted strings accepted by the protobuf JSON parser.
+std::string QuoteNonFiniteNumbers(absl::string_view json) {
+  static constexpr std::pair<absl::string_view, absl::string_view>
+      kReplacements[] = {{"-Infinity", "\"-Infinity\""},
+                         {"Infinity", "\"Infinity\""},
+                         {"-NaN", "\"NaN\""},
+                         {"NaN", "\"NaN\""}};
+  std::string result;
+  result.reserve(json.size());
+  bool in_string = false;
+  for (size_t i = 0; i < json.size(); ++i) {
+    if (in_string) {
+      if (json[i] == '\\' && i + 1 < json.size()) {
+        result += json[i++];
+      } else if (json[i] == '"') {
+        in_string = false;
+      }
+      result += json[i];
+      continue;
+    }
+    if (json[i] == '"') {
+      in_string = true;
+    }
+    bool replaced = false;
+    for (const auto& [token, replacement] : kReplacements) {
+      if (absl::StartsWith(json.substr(i), token)) {
+        absl::StrAppend(&result, replacement);
+        i += token.size() - 1;
+        replaced = true;
+        break;
+      }
+    }
+    if (!replaced) {
+      result += json[i];
+    }
+  }
+  return result;
+}
+
+double Median(const google::protobuf::RepeatedField<double>& samples) {
+  if (samples.empty()) {
+    return 0;
+  }
+  std::vector<double> sorted(samples.begin(), samples.end());
+  std::sort(sorted.begin(), sorted.end());
+  int n = sorted.size();
+  if (n % 2 == 1) {
+    return sorted[n / 2];
+  }
+  return (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+}
+
+// Compares `metric` of `baseline` and `candidate`. Timing metrics are tested
+// for significance, memory metrics are not.
+BenchmarkComparison CompareMetric(
+    absl::string_view metric,
+    const google::protobuf::RepeatedField<double>& baseline,
+    const google::protobuf::RepeatedField<double>& candidate,
+    bool is_timing, const BaselineComparisonOptions& options) {
+  BenchmarkComparison result;
+  result.metric = std::string(metric);
+  result.baseline_median = Median(baseline);
+  result.candidate_median = Median(candidate);
+  if (result.baseline_median != 0) {
+    result.relative_change =
+        (result.candidate_median - result.baseline_median) /
+        result.baseline_median;
+  } else if (result.candidate_median != 0) {
+    result.relative_change = INFINITY;
+  }
+  bool significant = true;
+  if (is_timing) {
+    result.p_value = MannWhitneyUTestPValue(baseline, candidate);
+    significant = result.p_value < options.alpha;
+  }
+  result.is_regression =
+      significant && result.relative_change > options.min_relative_change;
+  result.is_improvement =
+      significant && result.relative_change < -options.min_relative_change;
+  return result;
+}
+
+}  // namespace
+
+absl::Status AddGoogleBenchmarkOutput(absl::string_view target,
+                                      absl::string_view json,
+                                      BenchmarkBaseline& baseline) {
+  GoogleBenchmarkOutput output;
+  google::protobuf::util::JsonParseOptions parse_options;
+  parse_options.ignore_unknown_fields = true;
+  auto status = google::protobuf::util::JsonStringToMessage(
+      QuoteNonFiniteNumbers(json), &output, parse_options);
+  if (!status.ok()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Failed to parse benchmark output of ", target, ": ",
+        status.ToString()));
+  }
+
+  if (baseline.host_name().empty()) {
+    const GoogleBenchmarkOutput::Context& context = output.context();
+    baseline.set_date(context.date());
+    baseline.set_host_name(context.host_name());
+    baseline.set_num_cpus(context.num_cpus());
+    baseline.set_mhz_per_cpu(context.mhz_per_cpu());
+    baseline.set_cpu_scaling_enabled(context.cpu_scaling_enabled());
+    baseline.set_library_build_type(context.library_build_type());
+  }
+
+  // Repetitions of the same benchmark share a run_name.
+  absl::flat_hash_map<std::string, BenchmarkSamples*> samples_by_name;
+  for (const GoogleBenchmarkOutput::Run& run : output.benchmarks()) {
+    if (run.run_type() == "aggregate" || run.error_occurred()) {
+      continue;
+    }
+    double unit = NanosecondsPerUnit(run.time_unit());
+    if (unit == 0) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unknown time unit \"", run.time_unit(), "\" in ",
+                       run.name(), " of ", target));
+    }
+    const std::string& name =
+        run.run_name().empty() ? run.name() : run.run_name();
+    BenchmarkSamples*& samples = samples_by_name[name];
+    if (samples == nullptr) {
+      samples = baseline.add_benchmarks();
+      samples->set_target(std::string(target));
+      samples->set_name(name);
+    }
+    samples->add_real_time_ns(run.real_time() * unit);
+    samples->add_cpu_time_ns(run.cpu_time() * unit);
+    samples->add_allocs_per_iter(run.allocs_per_iter());
+    samples->add_bytes_allocated_per_iter(run.bytes_allocated_per_iter());
+    samples->add_peak_live_bytes(run.peak_live_bytes());
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<BenchmarkBaseline> ParseBaseline(absl::string_view json) {
+  BenchmarkBaseline baseline;
+  auto status =
+      google::protobuf::util::JsonStringToMessage(std::string(json), &baseline);
+  if (!status.ok()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Failed to parse baseline: ", status.ToString()));
+  }
+  if (baseline.format_version() != kBenchmarkBaselineFormatVersion) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unsupported baseline format_version ",
+                     baseline.format_version(), ", expected ",
+                     kBenchmarkBaselineFormatVersion));
+  }
+  return baseline;
+}
+
+absl::StatusOr<std::string> SerializeBaseline(
+    const BenchmarkBaseline& baseline) {
+  google::protobuf::util::JsonPrintOptions print_options;
+  print_options.add_whitespace = true;
+  print_options.preserve_proto_field_names = true;
+  std::string json;
+  auto status = google::protobuf::util::MessageToJsonString(baseline, &json,
+                                                            print_options);
+  if (!status.ok()) {
+    return absl::InternalError(
+        absl::StrCat("Failed to serialize baseline: ", status.ToString()));
+  }
+  return json;
+}
+
+double MannWhitneyUTestPValue(absl::Span<const double> x,
+                              absl::Span<const double> y) {
+  const double n1 = x.size();
+  const double n2 = y.size();
+  if (n1 == 0 || n2 == 0) {
+    return 1;
+  }
+
+  // Rank all samples, assigning average ranks to ties, and sum up the ranks of
+  // `x` as well as the tie correction term.
+  std::vector<std::pair<double, bool>> samples;
+  samples.reserve(x.size() + y.size());
+  for (double sample : x) {
+    samples.emplace_back(sample, true);
+  }
+  for (double sample : y) {
+    samples.emplace_back(sample, false);
+  }
+  std::sort(samples.begin(), samples.end());
+  double rank_sum_x = 0;
+  double tie_correction = 0;
+  for (int i = 0; i < static_cast<int>(samples.size());) {
+    int j = i;
+    while (j < static_cast<int>(samples.size()) &&
+           samples[j].first == samples[i].first) {
+      ++j;
+    }
+    // Samples i, ..., j - 1 are tied and get ranks i + 1, ..., j.
+    double average_rank = (i + 1 + j) / 2.0;
+    for (int k = i; k < j; ++k) {
+      if (samples[k].second) {
+        rank_sum_x += average_rank;
+      }
+    }
+    double num_tied = j - i;
+    tie_correction += num_tied * num_tied * num_tied - num_tied;
+    i = j;
+  }
+
+  const double n = n1 + n2;
+  const double u = rank_sum_x - n1 * (n1 + 1) / 2;
+  const double mean = n1 * n2 / 2;
+  const double variance =
+      n1 * n2 / 12 * ((n + 1) - tie_correction / (n * (n - 1)));
+  if (variance <= 0) {
+    return 1;
+  }
+  // Continuity correction.
+  double z = std::max(0.0, std::abs(u - mean) - 0.5) / std::sqrt(variance);
+  return std::erfc(z / std::sqrt(2.0));
+}
+
+std::vector<BenchmarkComparison> CompareBaselines(
+    const BenchmarkBaseline& baseline, const BenchmarkBaseline& candidate,
+    const BaselineComparisonOptions& options) {
+  absl::flat_hash_map<std::pair<std::string, std::string>,
+                      const BenchmarkSamples*>
+      candidate_samples;
+  for (const BenchmarkSamples& samples : candidate.benchmarks()) {
+    candidate_samples[{samples.target(), samples.name()}] = &samples;
+  }
+
+  std::vector<BenchmarkComparison> result;
+  for (const BenchmarkSamples& old_samples : baseline.benchmarks()) {
+    auto it =
+        candidate_samples.find({old_samples.target(), old_samples.name()});
+    if (it == candidate_samples.end()) {
+      continue;
+    }
+    const BenchmarkSamples& new_samples = *it->second;
+    std::vector<BenchmarkComparison> comparisons;
+    comparisons.push_back(CompareMetric("cpu_time_ns",
+                                        old_samples.cpu_time_ns(),
+                                        new_samples.cpu_time_ns(),
+                                        /*is_timing=*/true, options));
+    comparisons.push_back(CompareMetric(
+        "bytes_allocated_per_iter", old_samples.bytes_allocated_per_iter(),
+        new_samples.bytes_allocated_per_iter(), /*is_timing=*/false, options));
+    comparisons.push_back(CompareMetric(
+        "peak_live_bytes", old_samples.peak_live_bytes(),
+        new_samples.peak_live_bytes(), /*is_timing=*/false, options));
+    for (BenchmarkComparison& comparison : comparisons) {
+      // Skip memory metrics of benchmarks that don't report them.
+      if (comparison.baseline_median == 0 &&
+          comparison.candidate_median == 0) {
+        continue;
+      }
+      comparison.target = old_samples.target();
+      comparison.name = old_samples.name();
+      result.push_back(std::move(comparison));
+    }
+  }
+  return result;
+}
+
+}  // namespace distributed_point_functions
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_BENCHMARKS_BASELINE_COMPARISON_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_BENCHMARKS_BASELINE_COMPARISON_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "benchmarks/benchmark_baseline.pb.h"
+
+namespace distributed_point_functions {
+
+// Current value of BenchmarkBaseline::format_version.
+constexpr int kBenchmarkBaselineFormatVersion = 1;
+
+// Parses `json`, the output of the Google Benchmark binary `target` with
+// --benchmark_out_format=json, and appends one BenchmarkSamples per benchmark
+// to `baseline`. Aggregates and failed runs are skipped. Fields describing the
+// machine are taken from the first output added.
+//
+// Returns INVALID_ARGUMENT if `json` cannot be parsed.
+absl::Status AddGoogleBenchmarkOutput(absl::string_view target,
+                                      absl::string_view json,
+                                      BenchmarkBaseline& baseline);
+
+// Parses and serializes baselines as JSON.
+//
+// ParseBaseline returns INVALID_ARGUMENT if `json` cannot be parsed or has an
+// unsupported format_version.
+absl::StatusOr<BenchmarkBaseline> ParseBaseline(absl::string_view json);
+absl::StatusOr<std::string> SerializeBaseline(
+    const BenchmarkBaseline& baseline);
+
+// Returns the two-sided p-value of the Mann-Whitney U test for the samples `x`
+// and `y` coming from the same distribution, using the normal approximation
+// with tie correction. This is the same test used by Google Benchmark's
+// compare.py, and needs about 9 samples on each side to be meaningful. Returns
+// 1 if either side is empty or all samples are equal.
+double MannWhitneyUTestPValue(absl::Span<const double> x,
+                              absl::Span<const double> y);
+
+struct BaselineComparisonOptions {
+  // Significance level for timing differences.
+  double alpha = 0.05;
+
+  // Minimum relative change of the median for a difference to be flagged. Also
+  // applies to memory counters, which are deterministic and therefore not
+  // tested for significance.
+  double min_relative_change = 0.05;
+};
+
+// Result of comparing one metric of one benchmark.
+struct BenchmarkComparison {
+  std::string target;
+  std::string name;
+  // One of "cpu_time_ns", "bytes_allocated_per_iter" and "peak_live_bytes".
+  std::string metric;
+  double baseline_median = 0;
+  double candidate_median = 0;
+  // (candidate_median - baseline_median) / baseline_median.
+  double relative_change = 0;
+  // Only set for timing metrics, 1 otherwise.
+  double p_value = 1;
+  bool is_regression = false;
+  bool is_improvement = false;
+};
+
+// Compares all benchmarks present in both `baseline` and `candidate`.
+// Benchmarks present in only one of them are ignored.
+std::vector<BenchmarkComparison> CompareBaselines(
+    const BenchmarkBaseline& baseline, const BenchmarkBaseline& candidate,
+    const BaselineComparisonOptions& options);
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_BENCHMARKS_BASELINE_COMPARISON_H_
@@ -0,0 +1,340 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "benchmarks/baseline_comparison.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "benchmarks/benchmark_baseline.pb.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::StatusIs;
+using ::testing::DoubleEq;
+using ::testing::DoubleNear;
+using ::testing::ElementsAre;
+using ::testing::Gt;
+using ::testing::HasSubstr;
+using ::testing::Lt;
+using ::testing::SizeIs;
+
+constexpr absl::string_view kGoogleBenchmarkOutput = R"json({
+  "context": {
+    "date": "2023-05-04T12:00:00+00:00",
+    "host_name": "bench-host",
+    "executable": "./distributed_point_function_benchmark",
+    "num_cpus": 8,
+    "mhz_per_cpu": 3000,
+    "cpu_scaling_enabled": false,
+    "caches": [{"type": "Data", "level": 1, "size": 32768}],
+    "library_build_type": "release"
+  },
+  "benchmarks": [
+    {
+      "name": "BM_Eval/12",
+      "family_index": 0,
+      "run_name": "BM_Eval/12",
+      "run_type": "iteration",
+      "repetitions": 2,
+      "repetition_index": 0,
+      "iterations": 1000,
+      "real_time": 1.5,
+      "cpu_time": 1.25,
+      "time_unit": "us",
+      "allocs_per_iter": 3,
+      "bytes_allocated_per_iter": 4096,
+      "peak_live_bytes": 8192
+    },
+    {
+      "name": "BM_Eval/12",
+      "run_name": "BM_Eval/12",
+      "run_type": "iteration",
+      "iterations": 1000,
+      "real_time": 2.5,
+      "cpu_time": 2.0,
+      "time_unit": "us",
+      "allocs_per_iter": 3,
+      "bytes_allocated_per_iter": 4096,
+      "peak_live_bytes": 8192
+    },
+    {
+      "name": "BM_Eval/12_mean",
+      "run_name": "BM_Eval/12",
+      "run_type": "aggregate",
+      "aggregate_name": "mean",
+      "iterations": 2,
+      "real_time": 2.0,
+      "cpu_time": 1.625,
+      "time_unit": "us"
+    },
+    {
+      "name": "BM_Keygen",
+      "run_name": "BM_Keygen",
+      "run_type": "iteration",
+      "iterations": 10,
+      "real_time": 3,
+      "cpu_time": 2,
+      "time_unit": "ms"
+    },
+    {
+      "name": "BM_Broken",
+      "run_name": "BM_Broken",
+      "run_type": "iteration",
+      "error_occurred": true,
+      "error_message": "failed"
+    }
+  ]
+})json";
+
+BenchmarkSamples* AddSamples(absl::string_view name,
+                             const std::vector<double>& cpu_time_ns,
+                             BenchmarkBaseline& baseline) {
+  BenchmarkSamples* samples = baseline.add_benchmarks();
+  samples->set_target("//dpf:benchmark");
+  samples->set_name(std::string(name));
+  for (double sample : cpu_time_ns) {
+    samples->add_cpu_time_ns(sample);
+  }
+  return samples;
+}
+
+TEST(BaselineComparisonTest, AddGoogleBenchmarkOutputGroupsRepetitions) {
+  BenchmarkBaseline baseline;
+  ASSERT_TRUE(AddGoogleBenchmarkOutput("//dpf:benchmark",
+                                       kGoogleBenchmarkOutput, baseline)
+                  .ok());
+
+  EXPECT_EQ(baseline.host_name(), "bench-host");
+  EXPECT_EQ(baseline.num_cpus(), 8);
+  EXPECT_EQ(baseline.library_build_type(), "release");
+  ASSERT_THAT(baseline.benchmarks(), SizeIs(2));
+
+  const BenchmarkSamples& eval = baseline.benchmarks(0);
+  EXPECT_EQ(eval.target(), "//dpf:benchmark");
+  EXPECT_EQ(eval.name(), "BM_Eval/12");
+  EXPECT_THAT(eval.real_time_ns(), ElementsAre(1500, 2500));
+  EXPECT_THAT(eval.cpu_time_ns(), ElementsAre(1250, 2000));
+  EXPECT_THAT(eval.allocs_per_iter(), ElementsAre(3, 3));
+  EXPECT_THAT(eval.bytes_allocated_per_iter(), ElementsAre(4096, 4096));
+  EXPECT_THAT(eval.peak_live_bytes(), ElementsAre(8192, 8192));
+
+  const BenchmarkSamples& keygen = baseline.benchmarks(1);
+  EXPECT_EQ(keygen.name(), "BM_Keygen");
+  EXPECT_THAT(keygen.cpu_time_ns(), ElementsAre(2e6));
+  EXPECT_THAT(keygen.peak_live_bytes(), ElementsAre(0));
+}
+
+TEST(BaselineComparisonTest, AddGoogleBenchmarkOutputFailsOnInvalidJson) {
+  BenchmarkBaseline baseline;
+  EXPECT_THAT(AddGoogleBenchmarkOutput("//dpf:benchmark", "{", baseline),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("//dpf:benchmark")));
+}
+
+TEST(BaselineComparisonTest, AddGoogleBenchmarkOutputFailsOnUnknownTimeUnit) {
+  BenchmarkBaseline baseline;
+  EXPECT_THAT(
+      AddGoogleBenchmarkOutput(
+          "//dpf:benchmark",
+          R"json({"benchmarks": [{"name": "BM_Eval", "run_type": "iteration",
+                                   "time_unit": "days"}]})json",
+          baseline),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("days")));
+}
+
+TEST(BaselineComparisonTest, AddGoogleBenchmarkOutputAcceptsNonFiniteCounters) {
+  BenchmarkBaseline baseline;
+  ASSERT_TRUE(AddGoogleBenchmarkOutput(
+                  "//dpf:benchmark",
+                  R"json({"benchmarks": [{"name": "BM_Eval", "run_name": "NaN",
+                                          "run_type": "iteration",
+                                          "time_unit": "ns", "cpu_time": 1,
+                                          "fraction": -NaN,
+                                          "peak_live_bytes": Infinity}]})json",
+                  baseline)
+                  .ok());
+
+  ASSERT_THAT(baseline.benchmarks(), SizeIs(1));
+  EXPECT_EQ(baseline.benchmarks(0).name(), "NaN");
+  EXPECT_THAT(baseline.benchmarks(0).peak_live_bytes(),
+              ElementsAre(std::numeric_limits<double>::infinity()));
+}
+
+TEST(BaselineComparisonTest, SerializeAndParseRoundTrip) {
+  BenchmarkBaseline baseline;
+  baseline.set_format_version(kBenchmarkBaselineFormatVersion);
+  baseline.set_library_version("v1.2.3");
+  baseline.set_repetitions(2);
+  ASSERT_TRUE(AddGoogleBenchmarkOutput("//dpf:benchmark",
+                                       kGoogleBenchmarkOutput, baseline)
+                  .ok());
+
+  absl::StatusOr<std::string> json = SerializeBaseline(baseline);
+  ASSERT_TRUE(json.ok()) << json.status();
+  EXPECT_THAT(*json, HasSubstr("\"library_version\": \"v1.2.3\""));
+
+  absl::StatusOr<BenchmarkBaseline> parsed = ParseBaseline(*json);
+  ASSERT_TRUE(parsed.ok()) << parsed.status();
+  EXPECT_EQ(parsed->DebugString(), baseline.DebugString());
+}
+
+TEST(BaselineComparisonTest, ParseBaselineFailsOnWrongFormatVersion) {
+  EXPECT_THAT(ParseBaseline(R"json({"format_version": 2})json"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("format_version")));
+}
+
+TEST(BaselineComparisonTest, ParseBaselineFailsOnInvalidJson) {
+  EXPECT_THAT(ParseBaseline("not json"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(MannWhitneyUTestTest, IdenticalSamplesAreNotSignificant) {
+  std::vector<double> x = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  EXPECT_THAT(MannWhitneyUTestPValue(x, x), DoubleNear(1, 1e-9));
+}
+
+TEST(MannWhitneyUTestTest, AllEqualSamplesReturnOne) {
+  std::vector<double> x(10, 5);
+  EXPECT_EQ(MannWhitneyUTestPValue(x, x), 1);
+}
+
+TEST(MannWhitneyUTestTest, EmptySamplesReturnOne) {
+  std::vector<double> x = {1, 2, 3};
+  EXPECT_EQ(MannWhitneyUTestPValue(x, {}), 1);
+  EXPECT_EQ(MannWhitneyUTestPValue({}, x), 1);
+}
+
+TEST(MannWhitneyUTestTest, SeparatedSamplesAreSignificant) {
+  std::vector<double> x = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  std::vector<double> y = {11, 12, 13, 14, 15, 16, 17, 18, 19, 20};
+  // U = 0, mean = 50, variance = 175, z = 49.5 / sqrt(175).
+  EXPECT_THAT(MannWhitneyUTestPValue(x, y), DoubleNear(1.8267e-4, 1e-7));
+  EXPECT_THAT(MannWhitneyUTestPValue(y, x), DoubleNear(1.8267e-4, 1e-7));
+}
+
+TEST(MannWhitneyUTestTest, InterleavedSamplesAreNotSignificant) {
+  std::vector<double> x = {1, 3, 5, 7, 9, 11, 13, 15, 17, 19};
+  std::vector<double> y = {2, 4, 6, 8, 10, 12, 14, 16, 18, 20};
+  EXPECT_THAT(MannWhitneyUTestPValue(x, y), Gt(0.5));
+}
+
+TEST(CompareBaselinesTest, FlagsSignificantRegression) {
+  BenchmarkBaseline baseline, candidate;
+  AddSamples("BM_Eval", {100, 101, 102, 103, 104, 105, 106, 107, 108, 109},
+             baseline);
+  AddSamples("BM_Eval", {120, 121, 122, 123, 124, 125, 126, 127, 128, 129},
+             candidate);
+
+  std::vector<BenchmarkComparison> result =
+      CompareBaselines(baseline, candidate, BaselineComparisonOptions());
+
+  ASSERT_THAT(result, SizeIs(1));
+  EXPECT_EQ(result[0].target, "//dpf:benchmark");
+  EXPECT_EQ(result[0].name, "BM_Eval");
+  EXPECT_EQ(result[0].metric, "cpu_time_ns");
+  EXPECT_THAT(result[0].baseline_median, DoubleEq(104.5));
+  EXPECT_THAT(result[0].candidate_median, DoubleEq(124.5));
+  EXPECT_THAT(result[0].relative_change, DoubleNear(20 / 104.5, 1e-9));
+  EXPECT_THAT(result[0].p_value, Lt(0.05));
+  EXPECT_TRUE(result[0].is_regression);
+  EXPECT_FALSE(result[0].is_improvement);
+}
+
+TEST(CompareBaselinesTest, FlagsSignificantImprovement) {
+  BenchmarkBaseline baseline, candidate;
+  AddSamples("BM_Eval", {120, 121, 122, 123, 124, 125, 126, 127, 128, 129},
+             baseline);
+  AddSamples("BM_Eval", {100, 101, 102, 103, 104, 105, 106, 107, 108, 109},
+             candidate);
+
+  std::vector<BenchmarkComparison> result =
+      CompareBaselines(baseline, candidate, BaselineComparisonOptions());
+
+  ASSERT_THAT(result, SizeIs(1));
+  EXPECT_FALSE(result[0].is_regression);
+  EXPECT_TRUE(result[0].is_improvement);
+}
+
+TEST(CompareBaselinesTest, IgnoresInsignificantChange) {
+  BenchmarkBaseline baseline, candidate;
+  AddSamples("BM_Eval", {100, 140, 102, 143, 104, 145, 106, 147, 108, 149},
+             baseline);
+  AddSamples("BM_Eval", {101, 141, 103, 144, 105, 146, 107, 148, 109, 150},
+             candidate);
+
+  std::vector<BenchmarkComparison> result =
+      CompareBaselines(baseline, candidate, BaselineComparisonOptions());
+
+  ASSERT_THAT(result, SizeIs(1));
+  EXPECT_THAT(result[0].p_value, Gt(0.05));
+  EXPECT_FALSE(result[0].is_regression);
+  EXPECT_FALSE(result[0].is_improvement);
+}
+
+TEST(CompareBaselinesTest, IgnoresSignificantChangeBelowThreshold) {
+  BenchmarkBaseline baseline, candidate;
+  AddSamples("BM_Eval", {100, 100, 100, 100, 100, 100, 100, 100, 100, 100},
+             baseline);
+  AddSamples("BM_Eval", {101, 101, 101, 101, 101, 101, 101, 101, 101, 101},
+             candidate);
+
+  std::vector<BenchmarkComparison> result =
+      CompareBaselines(baseline, candidate, BaselineComparisonOptions());
+
+  ASSERT_THAT(result, SizeIs(1));
+  EXPECT_THAT(result[0].p_value, Lt(0.05));
+  EXPECT_FALSE(result[0].is_regression);
+}
+
+TEST(CompareBaselinesTest, FlagsMemoryRegressionWithoutSignificanceTest) {
+  BenchmarkBaseline baseline, candidate;
+  AddSamples("BM_Eval", {100}, baseline)->add_peak_live_bytes(1000);
+  AddSamples("BM_Eval", {100}, candidate)->add_peak_live_bytes(2000);
+
+  std::vector<BenchmarkComparison> result =
+      CompareBaselines(baseline, candidate, BaselineComparisonOptions());
+
+  ASSERT_THAT(result, SizeIs(2));
+  EXPECT_EQ(result[0].metric, "cpu_time_ns");
+  EXPECT_FALSE(result[0].is_regression);
+  EXPECT_EQ(result[1].metric, "peak_live_bytes");
+  EXPECT_THAT(result[1].relative_change, DoubleEq(1));
+  EXPECT_TRUE(result[1].is_regression);
+}
+
+TEST(CompareBaselinesTest, SkipsBenchmarksMissingFromEitherSide) {
+  BenchmarkBaseline baseline, candidate;
+  AddSamples("BM_Old", {100}, baseline);
+  AddSamples("BM_Both", {100}, baseline);
+  AddSamples("BM_Both", {100}, candidate);
+  AddSamples("BM_New", {100}, candidate);
+
+  std::vector<BenchmarkComparison> result =
+      CompareBaselines(baseline, candidate, BaselineComparisonOptions());
+
+  ASSERT_THAT(result, SizeIs(1));
+  EXPECT_EQ(result[0].name, "BM_Both");
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
@@ -0,0 +1,180 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "benchmarks/baseline_comparison.h"
+#include "benchmarks/benchmark_baseline.pb.h"
+#include "dpf/status_macros.h"
+
+ABSL_FLAG(std::string, output, "",
+          "create: Path of the baseline to write. Prints to stdout if empty.");
+ABSL_FLAG(std::string, library_version, "",
+          "create: Version of the library that was benchmarked.");
+ABSL_FLAG(int, repetitions, 0,
+          "create: Number of repetitions each benchmark was run with.");
+ABSL_FLAG(double, alpha, 0.05,
+          "compare: Significance level for timing differences.");
+ABSL_FLAG(double, min_relative_change, 0.05,
+          "compare: Minimum relative change of the median to be reported.");
+
+namespace distributed_point_functions {
+namespace {
+
+absl::StatusOr<std::string> ReadFile(absl::string_view path) {
+  std::ifstream file{std::string(path)};
+  if (!file.is_open()) {
+    return absl::NotFoundError(absl::StrCat("Could not open ", path));
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  return buffer.str();
+}
+
+absl::Status WriteFile(absl::string_view path, absl::string_view contents) {
+  std::ofstream file{std::string(path)};
+  file << contents;
+  file.close();
+  if (file.fail()) {
+    return absl::InternalError(absl::StrCat("Could not write to ", path));
+  }
+  return absl::OkStatus();
+}
+
+// Creates a baseline from `outputs`, each of the form
+// <target>=<path to Google Benchmark JSON output>.
+absl::Status Create(const std::vector<char*>& outputs) {
+  BenchmarkBaseline baseline;
+  baseline.set_format_version(kBenchmarkBaselineFormatVersion);
+  baseline.set_library_version(absl::GetFlag(FLAGS_library_version));
+  baseline.set_repetitions(absl::GetFlag(FLAGS_repetitions));
+  for (absl::string_view output : outputs) {
+    std::pair<std::string, std::string> target_and_path =
+        absl::StrSplit(output, absl::MaxSplits('=', 1));
+    if (target_and_path.second.empty()) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Expected <target>=<path>, got \"", output, "\""));
+    }
+    std::string json;
+    DPF_ASSIGN_OR_RETURN(json, ReadFile(target_and_path.second));
+    DPF_RETURN_IF_ERROR(
+        AddGoogleBenchmarkOutput(target_and_path.first, json, baseline));
+  }
+
+  std::string json;
+  DPF_ASSIGN_OR_RETURN(json, SerializeBaseline(baseline));
+  const std::string path = absl::GetFlag(FLAGS_output);
+  if (path.empty()) {
+    std::cout << json;
+    return absl::OkStatus();
+  }
+  return WriteFile(path, json);
+}
+
+// Compares the baselines at `baseline_path` and `candidate_path`, printing all
+// significant changes. Sets `has_regressions` if any of them is a regression.
+absl::Status Compare(absl::string_view baseline_path,
+                     absl::string_view candidate_path, bool& has_regressions) {
+  std::string json;
+  BenchmarkBaseline baseline, candidate;
+  DPF_ASSIGN_OR_RETURN(json, ReadFile(baseline_path));
+  DPF_ASSIGN_OR_RETURN(baseline, ParseBaseline(json));
+  DPF_ASSIGN_OR_RETURN(json, ReadFile(candidate_path));
+  DPF_ASSIGN_OR_RETURN(candidate, ParseBaseline(json));
+
+  if (baseline.host_name() != candidate.host_name() ||
+      baseline.num_cpus() != candidate.num_cpus()) {
+    ABSL_LOG(WARNING) << "Baselines were created on different machines ("
+                      << baseline.host_name() << " and "
+                      << candidate.host_name()
+                      << "), timing differences may not be meaningful";
+  }
+
+  BaselineComparisonOptions options;
+  options.alpha = absl::GetFlag(FLAGS_alpha);
+  options.min_relative_change = absl::GetFlag(FLAGS_min_relative_change);
+  std::vector<BenchmarkComparison> comparisons =
+      CompareBaselines(baseline, candidate, options);
+
+  int num_regressions = 0, num_improvements = 0;
+  for (const BenchmarkComparison& comparison : comparisons) {
+    if (!comparison.is_regression && !comparison.is_improvement) {
+      continue;
+    }
+    std::cout << absl::StrFormat(
+        "%-11s %s %s %s: %.6g -> %.6g (%+.1f%%, p=%.4f)\n",
+        comparison.is_regression ? "REGRESSION" : "IMPROVEMENT",
+        comparison.target, comparison.name, comparison.metric,
+        comparison.baseline_median, comparison.candidate_median,
+        100 * comparison.relative_change, comparison.p_value);
+    if (comparison.is_regression) {
+      ++num_regressions;
+    } else {
+      ++num_improvements;
+    }
+  }
+  std::cout << absl::StrFormat(
+      "Compared %d metrics of %s (%s) and %s (%s): %d regressions, %d "
+      "improvements\n",
+      comparisons.size(), baseline_path, baseline.library_version(),
+      candidate_path, candidate.library_version(), num_regressions,
+      num_improvements);
+  has_regressions = num_regressions > 0;
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
+
+int main(int argc, char* argv[]) {
+  absl::SetProgramUsageMessage(
+      "Creates and compares benchmark baselines.\n\n"
+      "  baseline_tool create --library_version=<version> "
+      "--repetitions=<n> --output=<file> <target>=<benchmark JSON>...\n"
+      "  baseline_tool compare <baseline> <candidate>\n\n"
+      "compare exits with status 1 if any regressions were found.");
+  std::vector<char*> args = absl::ParseCommandLine(argc, argv);
+  ABSL_QCHECK(args.size() >= 2) << "Expected a command";
+  const absl::string_view command = args[1];
+  const std::vector<char*> operands(args.begin() + 2, args.end());
+
+  if (command == "create") {
+    ABSL_QCHECK_OK(distributed_point_functions::Create(operands));
+    return 0;
+  } else if (command == "compare") {
+    ABSL_QCHECK(operands.size() == 2)
+        << "Expected exactly two baselines to compare";
+    bool has_regressions = false;
+    ABSL_QCHECK_OK(distributed_point_functions::Compare(
+        operands[0], operands[1], has_regressions));
+    return has_regressions ? 1 : 0;
+  }
+  ABSL_LOG(QFATAL) << "Unknown command \"" << command << "\"";
+}
@@ -0,0 +1,121 @@
+#!/bin/bash
+# Copyright 2023 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Runs all benchmarks with a fixed number of repetitions, pinned to a single
+# CPU, and writes the results to a baseline file. See benchmarks/README.md.
+#
+# Usage: benchmarks/run_benchmarks.sh [OPTIONS]
+#
+#   --version=<version>   Library version to record. Defaults to the output of
+#                         `git describe --tags --always --dirty`.
+#   --output=<file>       Baseline to write. Defaults to
+#                         benchmarks/baselines/<version>.json.
+#   --repetitions=<n>     Repetitions of each benchmark. Defaults to 10.
+#   --cpu=<cpu>           CPU to pin benchmarks to. Defaults to the last CPU,
+#                         i.e., `nproc` - 1.
+#   --filter=<regex>      Passed as --benchmark_filter to all benchmarks.
+#                         Defaults to ".".
+#   --targets=<targets>   Space-separated benchmark targets to run. Defaults to
+#                         all targets listed below.
+
+set -euo pipefail
+
+readonly ALL_TARGETS=(
+  //dpf:distributed_point_function_benchmark
+  //dpf:int_mod_n_benchmark
+  //dpf:out_of_core_evaluator_benchmark
+  //dcf:distributed_comparison_function_benchmark
+  //dcf/fss_gates:multiple_interval_containment_benchmark
+  //dcf/fss_gates:equality_benchmark
+  //dcf/fss_gates:spline_benchmark
+  //pir:dense_dpf_pir_database_benchmark
+  //pir:dense_dpf_pir_server_benchmark
+  //pir:dense_dpf_pir_client_benchmark
+  //pir:dense_additive_pir_database_benchmark
+  //pir:cuckoo_hashing_sparse_dpf_pir_server_benchmark
+  //pir:cuckoo_hashing_membership_dpf_pir_server_benchmark
+  //pir:simple_hashing_sparse_dpf_pir_server_benchmark
+  //pir:batching_helper_sender_benchmark
+  //pir/hashing:hashing_benchmark
+)
+
+version=""
+output=""
+repetitions=10
+cpu="$(( $(nproc) - 1 ))"
+filter="."
+targets=("${ALL_TARGETS[@]}")
+
+for arg in "$@"; do
+  case "${arg}" in
+    --version=*) version="${arg#*=}" ;;
+    --output=*) output="${arg#*=}" ;;
+    --repetitions=*) repetitions="${arg#*=}" ;;
+    --cpu=*) cpu="${arg#*=}" ;;
+    --filter=*) filter="${arg#*=}" ;;
+    --targets=*) read -r -a targets <<< "${arg#*=}" ;;
+    *)
+      echo "Unknown argument: ${arg}" >&2
+      exit 2
+      ;;
+  esac
+done
+
+cd "$(dirname "$0")/.."
+
+if [[ -z "${version}" ]]; then
+  version="$(git describe --tags --always --dirty)"
+fi
+if [[ -z "${output}" ]]; then
+  output="benchmarks/baselines/${version}.json"
+fi
+
+if [[ -r /sys/devices/system/cpu/cpu${cpu}/cpufreq/scaling_governor ]] &&
+   [[ "$(cat /sys/devices/system/cpu/cpu${cpu}/cpufreq/scaling_governor)" \
+      != "performance" ]]; then
+  echo "Warning: CPU ${cpu} does not use the performance governor," \
+       "results will be noisy" >&2
+fi
+
+bazel build -c opt "${targets[@]}" //benchmarks:baseline_tool
+readonly BAZEL_BIN="$(bazel info -c opt bazel-bin)"
+
+tmpdir="$(mktemp -d)"
+trap 'rm -rf "${tmpdir}"' EXIT
+
+outputs=()
+for target in "${targets[@]}"; do
+  binary="${BAZEL_BIN}/${target#//}"
+  binary="${binary/://}"
+  json="${tmpdir}/$(basename "${binary}").json"
+  echo "Running ${target}" >&2
+  # Random interleaving reduces the effect of slow drift in machine state on
+  # the comparison between repetitions.
+  taskset -c "${cpu}" "${binary}" \
+    --benchmark_filter="${filter}" \
+    --benchmark_repetitions="${repetitions}" \
+    --benchmark_enable_random_interleaving=true \
+    --benchmark_out="${json}" \
+    --benchmark_out_format=json > /dev/null
+  outputs+=("${target}=${json}")
+done
+
+mkdir -p "$(dirname "${output}")"
+"${BAZEL_BIN}/benchmarks/baseline_tool" create \
+  --library_version="${version}" \
+  --repetitions="${repetitions}" \
+  --output="${output}" \
+  "${outputs[@]}"
+echo "Wrote ${output}" >&2
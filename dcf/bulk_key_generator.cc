@@ -0,0 +1,52 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dcf/bulk_key_generator.h"
+
+#include <cstdint>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "dcf/distributed_comparison_function.h"
+#include "dcf/distributed_comparison_function.pb.h"
+#include "dcf/key_file.h"
+#include "dpf/bulk_key_generator.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/status_macros.h"
+
+namespace distributed_point_functions {
+
+absl::StatusOr<int64_t> GenerateKeysToFiles(
+    DistributedComparisonFunction& dcf, KeyGenerationInputSource next_input,
+    DcfKeyFileWriter& writer_0, DcfKeyFileWriter& writer_1,
+    const BulkKeyGenerationOptions& options) {
+  // DcfKeys are written through the DpfKeys they wrap.
+  return GenerateKeysToFiles(
+      [&dcf](const KeyGenerationInput& input)
+          -> absl::StatusOr<std::pair<DpfKey, DpfKey>> {
+        if (input.beta.size() != 1) {
+          return absl::InvalidArgumentError(
+              "`beta` must contain exactly one value for DCF keys");
+        }
+        DPF_ASSIGN_OR_RETURN(auto keys,
+                             dcf.GenerateKeys(input.alpha, input.beta[0]));
+        return std::make_pair(std::move(*(keys.first.mutable_key())),
+                              std::move(*(keys.second.mutable_key())));
+      },
+      next_input, writer_0.dpf_key_writer(), writer_1.dpf_key_writer(),
+      options);
+}
+
+}  // namespace distributed_point_functions
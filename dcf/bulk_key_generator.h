@@ -0,0 +1,45 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DCF_BULK_KEY_GENERATOR_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DCF_BULK_KEY_GENERATOR_H_
+
+#include <cstdint>
+
+#include "absl/status/statusor.h"
+#include "dcf/distributed_comparison_function.h"
+#include "dcf/key_file.h"
+#include "dpf/bulk_key_generator.h"
+
+namespace distributed_point_functions {
+
+// Generates a pair of DCF keys with `dcf` for each input read from
+// `next_input`, and appends the keys of party 0 to `writer_0` and the keys of
+// party 1 to `writer_1`, as described for DPF keys in dpf/bulk_key_generator.h.
+// The `beta` of each input must contain exactly one value.
+//
+// Returns the number of key pairs written, INVALID_ARGUMENT if any input is
+// invalid for `dcf` or `options` are invalid, or the first error returned by
+// `next_input` or the writers. On error, the files may contain keys for a
+// prefix of the inputs.
+absl::StatusOr<int64_t> GenerateKeysToFiles(
+    DistributedComparisonFunction& dcf, KeyGenerationInputSource next_input,
+    DcfKeyFileWriter& writer_0, DcfKeyFileWriter& writer_1,
+    const BulkKeyGenerationOptions& options = {});
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DCF_BULK_KEY_GENERATOR_H_
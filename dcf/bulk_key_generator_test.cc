@@ -0,0 +1,132 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dcf/bulk_key_generator.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "dcf/distributed_comparison_function.h"
+#include "dcf/distributed_comparison_function.pb.h"
+#include "dcf/key_file.h"
+#include "dpf/bulk_key_generator.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::IsOkAndHolds;
+using dpf_internal::StatusIs;
+using ::testing::HasSubstr;
+
+constexpr int kLogDomainSize = 16;
+
+class DcfBulkKeyGeneratorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    parameters_.mutable_parameters()->set_log_domain_size(kLogDomainSize);
+    *(parameters_.mutable_parameters()->mutable_value_type()) =
+        ToValueType<uint64_t>();
+    DPF_ASSERT_OK_AND_ASSIGN(
+        dcf_, DistributedComparisonFunction::Create(parameters_));
+    for (int party = 0; party < 2; ++party) {
+      paths_[party] =
+          absl::StrCat(::testing::TempDir(), "/dcf_bulk_keys_", party);
+      DPF_ASSERT_OK_AND_ASSIGN(
+          writers_[party],
+          DcfKeyFileWriter::Create(paths_[party], parameters_, party));
+    }
+  }
+
+  // Returns an input source producing `num_inputs` inputs, where the i-th
+  // input has alpha = 7919 * i + 1 and beta = {i}.
+  static auto Inputs(int num_inputs) {
+    return [num_inputs, next = std::make_shared<int>(0)](
+               KeyGenerationInput& input) -> absl::StatusOr<bool> {
+      int i = (*next)++;
+      if (i >= num_inputs) {
+        return false;
+      }
+      input.alpha = Alpha(i);
+      input.beta = {ToValue<uint64_t>(i)};
+      return true;
+    };
+  }
+
+  static absl::uint128 Alpha(int i) {
+    return (absl::uint128{7919} * i + 1) % (uint64_t{1} << kLogDomainSize);
+  }
+
+  DcfParameters parameters_;
+  std::unique_ptr<DistributedComparisonFunction> dcf_;
+  std::string paths_[2];
+  std::unique_ptr<DcfKeyFileWriter> writers_[2];
+};
+
+TEST_F(DcfBulkKeyGeneratorTest, GeneratesKeysInInputOrder) {
+  constexpr int kNumInputs = 300;
+  EXPECT_THAT(GenerateKeysToFiles(*dcf_, Inputs(kNumInputs), *writers_[0],
+                                  *writers_[1],
+                                  {.num_threads = 3, .batch_size = 7}),
+              IsOkAndHolds(kNumInputs));
+  writers_[0].reset();
+  writers_[1].reset();
+
+  std::unique_ptr<DcfKeyFileReader> readers[2];
+  for (int party = 0; party < 2; ++party) {
+    DPF_ASSERT_OK_AND_ASSIGN(readers[party],
+                             DcfKeyFileReader::Open(paths_[party]));
+    EXPECT_EQ(readers[party]->party(), party);
+    EXPECT_EQ(readers[party]->num_keys(), kNumInputs);
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<DcfKey> keys_0,
+                           readers[0]->ReadBatch(kNumInputs));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<DcfKey> keys_1,
+                           readers[1]->ReadBatch(kNumInputs));
+  ASSERT_EQ(keys_0.size(), kNumInputs);
+  ASSERT_EQ(keys_1.size(), kNumInputs);
+  for (int i = 0; i < kNumInputs; ++i) {
+    for (absl::uint128 x : {Alpha(i) - 1, Alpha(i)}) {
+      DPF_ASSERT_OK_AND_ASSIGN(uint64_t result_0,
+                               dcf_->Evaluate<uint64_t>(keys_0[i], x));
+      DPF_ASSERT_OK_AND_ASSIGN(uint64_t result_1,
+                               dcf_->Evaluate<uint64_t>(keys_1[i], x));
+      EXPECT_EQ(result_0 + result_1, x < Alpha(i) ? i : 0)
+          << "key " << i << ", x = " << x;
+    }
+  }
+}
+
+TEST_F(DcfBulkKeyGeneratorTest, FailsForWrongNumberOfBetas) {
+  auto next_input = [](KeyGenerationInput& input) -> absl::StatusOr<bool> {
+    input.beta = {ToValue<uint64_t>(1), ToValue<uint64_t>(2)};
+    return true;
+  };
+  EXPECT_THAT(GenerateKeysToFiles(*dcf_, next_input, *writers_[0],
+                                  *writers_[1]),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Input 0: `beta` must contain exactly one")));
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
@@ -49,6 +49,21 @@ DistributedComparisonFunction::DistributedComparisonFunction(
 
 absl::StatusOr<std::unique_ptr<DistributedComparisonFunction>>
 DistributedComparisonFunction::Create(const DcfParameters& parameters) {
+  DPF_ASSIGN_OR_RETURN(std::vector<DpfParameters> dpf_parameters,
+                       GetDpfParameters(parameters));
+
+  // Create incremental DPF.
+  DPF_ASSIGN_OR_RETURN(
+      std::unique_ptr<DistributedPointFunction> dpf,
+      DistributedPointFunction::CreateIncremental(dpf_parameters));
+
+  return absl::WrapUnique(
+      new DistributedComparisonFunction(parameters, std::move(dpf)));
+}
+
+absl::StatusOr<std::vector<DpfParameters>>
+DistributedComparisonFunction::GetDpfParameters(
+    const DcfParameters& parameters) {
   // A DCF with a single-element domain doesn't make sense.
   if (parameters.parameters().log_domain_size() < 1) {
     return absl::InvalidArgumentError("A DCF must have log_domain_size >= 1");
@@ -74,14 +89,7 @@ DistributedComparisonFunction::Create(const DcfParameters& parameters) {
   // directly.
   DPF_RETURN_IF_ERROR(
       dpf_internal::ProtoValidator::ValidateParameters(dpf_parameters));
-
-  // Create incremental DPF.
-  DPF_ASSIGN_OR_RETURN(
-      std::unique_ptr<DistributedPointFunction> dpf,
-      DistributedPointFunction::CreateIncremental(dpf_parameters));
-
-  return absl::WrapUnique(
-      new DistributedComparisonFunction(parameters, std::move(dpf)));
+  return dpf_parameters;
 }
 
 absl::StatusOr<std::pair<DcfKey, DcfKey>>
@@ -17,6 +17,7 @@
 #ifndef DISTRIBUTED_POINT_FUNCTIONS_DCF_DISTRIBUTED_COMPARISON_FUNCTION_H_
 #define DISTRIBUTED_POINT_FUNCTIONS_DCF_DISTRIBUTED_COMPARISON_FUNCTION_H_
 
+#include <cstdint>
 #include <memory>
 #include <type_traits>
 #include <utility>
@@ -41,6 +42,15 @@ class DistributedComparisonFunction {
   static absl::StatusOr<std::unique_ptr<DistributedComparisonFunction>> Create(
       const DcfParameters& parameters);
 
+  // Returns the parameters of the incremental DPF underlying a DCF with
+  // `parameters`: one hierarchy level for each log_domain_size below that of
+  // `parameters`, all with the DCF's value type. `DcfKey::key` is a key of
+  // this DPF.
+  //
+  // Returns INVALID_ARGUMENT if `parameters` are invalid.
+  static absl::StatusOr<std::vector<DpfParameters>> GetDpfParameters(
+      const DcfParameters& parameters);
+
   // Creates keys for a DCF that evaluates to shares of `beta` on any input x <
   // `alpha`, and shares of 0 otherwise.
   //
@@ -110,7 +120,38 @@ class DistributedComparisonFunction {
   template <typename T>
   absl::Status BatchEvaluate(dpf_internal::MaybeDerefSpan<const DcfKey> keys,
                              absl::Span<const absl::uint128> evaluation_points,
-                             absl::Span<T> output);
+                             absl::Span<T> output) {
+    return BatchEvaluateImpl<T>(keys, evaluation_points, output);
+  }
+
+  // Same as the two-argument version above, but with 64-bit
+  // `evaluation_points`, which suffice for domains of up to 2^64 elements.
+  // Avoids 128-bit arithmetic on the evaluation points, and halves the memory
+  // traffic for reading them.
+  template <typename T, typename Points,
+            dpf_internal::EnableIfUint64Points<Points> = 0>
+  inline absl::StatusOr<std::vector<T>> BatchEvaluate(
+      dpf_internal::MaybeDerefSpan<const DcfKey> keys,
+      const Points& evaluation_points) {
+    std::vector<T> result(keys.size());
+    absl::Status status =
+        BatchEvaluate<T>(keys, evaluation_points, absl::MakeSpan(result));
+    if (!status.ok()) {
+      return status;
+    }
+    return result;
+  }
+
+  // As the previous version, but writes to `output` instead of allocating a
+  // std::vector.
+  template <typename T, typename Points,
+            dpf_internal::EnableIfUint64Points<Points> = 0>
+  absl::Status BatchEvaluate(dpf_internal::MaybeDerefSpan<const DcfKey> keys,
+                             const Points& evaluation_points,
+                             absl::Span<T> output) {
+    return BatchEvaluateImpl<T>(
+        keys, absl::Span<const uint64_t>(evaluation_points), output);
+  }
 
   // DistributedComparisonFunction is neither copyable nor movable.
   DistributedComparisonFunction(const DistributedComparisonFunction&) = delete;
@@ -121,16 +162,23 @@ class DistributedComparisonFunction {
   DistributedComparisonFunction(DcfParameters parameters,
                                 std::unique_ptr<DistributedPointFunction> dpf);
 
+  // Joint implementation of both variants of `BatchEvaluate` writing to
+  // `output`. `PointType` is either absl::uint128 or uint64_t.
+  template <typename T, typename PointType>
+  absl::Status BatchEvaluateImpl(
+      dpf_internal::MaybeDerefSpan<const DcfKey> keys,
+      absl::Span<const PointType> evaluation_points, absl::Span<T> output);
+
   const DcfParameters parameters_;
   const std::unique_ptr<DistributedPointFunction> dpf_;
 };
 
 // Implementation details.
 
-template <typename T>
-absl::Status DistributedComparisonFunction::BatchEvaluate(
+template <typename T, typename PointType>
+absl::Status DistributedComparisonFunction::BatchEvaluateImpl(
     dpf_internal::MaybeDerefSpan<const DcfKey> keys,
-    absl::Span<const absl::uint128> evaluation_points, absl::Span<T> output) {
+    absl::Span<const PointType> evaluation_points, absl::Span<T> output) {
   if (keys.size() != evaluation_points.size()) {
     // Different error message for the two-argument version.
     return absl::InvalidArgumentError(
@@ -153,8 +201,12 @@ absl::Status DistributedComparisonFunction::BatchEvaluate(
           "number of batched keys");
       return false;
     }
-    const absl::uint128 mask =
-        (absl::uint128{1} << (log_domain_size - hierarchy_level - 1));
+    // Bits beyond the width of `PointType` are always zero.
+    const int bit_index = log_domain_size - hierarchy_level - 1;
+    PointType mask = 0;
+    if (bit_index < static_cast<int>(8 * sizeof(PointType))) {
+      mask = PointType{1} << bit_index;
+    }
     for (int i = 0; i < num_keys; ++i) {
       const auto current_bit =
           static_cast<int>((evaluation_points[i] & mask) != 0);
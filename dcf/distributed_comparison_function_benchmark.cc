@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -25,6 +27,7 @@
 #include "dcf/distributed_comparison_function.h"
 #include "dcf/distributed_comparison_function.pb.h"
 #include "dpf/distributed_point_function.h"
+#include "dpf/internal/memory_counters.h"
 #include "dpf/internal/status_matchers.h"
 
 namespace distributed_point_functions {
@@ -55,6 +58,7 @@ void BM_EvaluateDcf(benchmark::State& state) {
     evaluation_points[i] &= domain_mask;
   }
 
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto s : state) {
     DPF_ASSERT_OK_AND_ASSIGN(std::vector<T> evaluation,
                              dcf->BatchEvaluate<T>(keys, evaluation_points));
@@ -75,6 +79,47 @@ BENCHMARK_TEMPLATE(BM_EvaluateDcf, uint64_t)
     ->RangePair(2, 128, 1, 1024);
 BENCHMARK_TEMPLATE(BM_EvaluateDcf, absl::uint128)->RangePair(2, 128, 1, 1024);
 
+// Benchmarks BatchEvaluate with 64-bit or 128-bit evaluation points. The first
+// argument specifies the log domain size, the second the batch size.
+template <typename PointType>
+void BM_EvaluateDcfWithPointType(benchmark::State& state) {
+  using T = uint64_t;
+  int log_domain_size = state.range(0);
+  int batch_size = state.range(1);
+  DcfParameters parameters;
+  *(parameters.mutable_parameters()->mutable_value_type()) = ToValueType<T>();
+  parameters.mutable_parameters()->set_log_domain_size(log_domain_size);
+  std::unique_ptr<DistributedComparisonFunction> dcf =
+      DistributedComparisonFunction::Create(parameters).value();
+
+  std::vector<DcfKey> keys(batch_size);
+  std::vector<PointType> evaluation_points(batch_size);
+  absl::BitGen rng;
+  uint64_t domain_mask = std::numeric_limits<uint64_t>::max();
+  if (log_domain_size < 64) {
+    domain_mask = (uint64_t{1} << log_domain_size) - 1;
+  }
+  for (int i = 0; i < batch_size; ++i) {
+    uint64_t alpha = absl::Uniform<uint64_t>(rng) & domain_mask;
+    T beta = absl::Uniform<T>(rng);
+    std::tie(keys[i], std::ignore) = dcf->GenerateKeys(alpha, beta).value();
+    evaluation_points[i] = absl::Uniform<uint64_t>(rng) & domain_mask;
+  }
+
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto s : state) {
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<T> evaluation,
+                             dcf->BatchEvaluate<T>(keys, evaluation_points));
+    benchmark::DoNotOptimize(evaluation);
+  }
+}
+BENCHMARK_TEMPLATE(BM_EvaluateDcfWithPointType, absl::uint128)
+    ->RangeMultiplier(4)
+    ->RangePair(16, 64, 1, 1024);
+BENCHMARK_TEMPLATE(BM_EvaluateDcfWithPointType, uint64_t)
+    ->RangeMultiplier(4)
+    ->RangePair(16, 64, 1, 1024);
+
 }  // namespace distributed_point_functions
 
 // Declare benchmark_filter flag, which will be defined by benchmark library.
@@ -14,6 +14,8 @@
 
 #include "dcf/distributed_comparison_function.h"
 
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <tuple>
 #include <vector>
@@ -186,6 +188,37 @@ TYPED_TEST(DcfTest, BatchEvaluateMatchesSingleEvaluate) {
       IsOkAndHolds(ElementsAreArray({evaluation_0, evaluation_1})));
 }
 
+TYPED_TEST(DcfTest, BatchEvaluateWithUint64PointsMatchesUint128Points) {
+  using ValueType = typename TypeParam::ValueType;
+  const uint64_t domain_size = uint64_t{1} << TypeParam::kLogDomainSize;
+  ValueType beta;
+  SetTo42(beta);
+  for (uint64_t alpha = 0; alpha < domain_size; ++alpha) {
+    DcfKey key_0, key_1;
+    DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_0, key_1),
+                             this->dcf_->GenerateKeys(alpha, beta));
+    std::vector<DcfKey> keys;
+    std::vector<uint64_t> evaluation_points;
+    for (uint64_t x = 0; x < domain_size; ++x) {
+      keys.push_back(key_0);
+      keys.push_back(key_1);
+      evaluation_points.push_back(x);
+      evaluation_points.push_back(x);
+    }
+    std::vector<absl::uint128> evaluation_points_128(evaluation_points.begin(),
+                                                     evaluation_points.end());
+
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<ValueType> output_128,
+        this->dcf_->template BatchEvaluate<ValueType>(keys,
+                                                      evaluation_points_128));
+    EXPECT_THAT(
+        this->dcf_->template BatchEvaluate<ValueType>(keys, evaluation_points),
+        IsOkAndHolds(ElementsAreArray(output_128)))
+        << "alpha=" << alpha;
+  }
+}
+
 TEST(DcfTest, WorksCorrectlyOnUint64TWithLargeDomain) {
   using ValueType = uint64_t;
   const absl::uint128 domain_size = absl::uint128{1} << 64;
@@ -240,6 +273,56 @@ TEST(DcfTest, WorksCorrectlyOnUint64TWithLargeDomain) {
   }
 }
 
+TEST(DcfTest, BatchEvaluateWithUint64PointsWorksOnLargeDomain) {
+  using ValueType = uint64_t;
+  ValueType beta;
+  SetTo42(beta);
+  const uint64_t alpha = (uint64_t{1} << 63) + 50;
+
+  DcfParameters parameters;
+  parameters.mutable_parameters()->set_log_domain_size(64);
+  *(parameters.mutable_parameters()->mutable_value_type()) =
+      ToValueType<uint64_t>();
+
+  DPF_ASSERT_OK_AND_ASSIGN(auto dcf,
+                           DistributedComparisonFunction::Create(parameters));
+
+  // Generate keys.
+  DcfKey key_0, key_1;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_0, key_1),
+                           dcf->GenerateKeys(alpha, beta));
+
+  // Evaluate on 100 random points in the domain, and around `alpha`.
+  absl::BitGen rng;
+  absl::uniform_int_distribution<uint64_t> dist;
+  const int kNumEvaluationPoints = 100;
+  std::vector<uint64_t> evaluation_points(kNumEvaluationPoints);
+  for (int i = 0; i < kNumEvaluationPoints - 3; ++i) {
+    evaluation_points[i] = dist(rng);
+  }
+  evaluation_points[kNumEvaluationPoints - 3] = alpha - 1;
+  evaluation_points[kNumEvaluationPoints - 2] = alpha;
+  evaluation_points[kNumEvaluationPoints - 1] =
+      std::numeric_limits<uint64_t>::max();
+  std::vector<DcfKey> keys_0(kNumEvaluationPoints, key_0),
+      keys_1(kNumEvaluationPoints, key_1);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<ValueType> result_0,
+      dcf->template BatchEvaluate<ValueType>(keys_0, evaluation_points));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<ValueType> result_1,
+      dcf->template BatchEvaluate<ValueType>(keys_1, evaluation_points));
+  for (int i = 0; i < kNumEvaluationPoints; ++i) {
+    if (evaluation_points[i] < alpha) {
+      EXPECT_EQ(ValueType(result_0[i] + result_1[i]), beta)
+          << "x=" << evaluation_points[i] << ", alpha=" << alpha;
+    } else {
+      EXPECT_EQ(ValueType(result_0[i] + result_1[i]), ValueType{})
+          << "x=" << evaluation_points[i] << ", alpha=" << alpha;
+    }
+  }
+}
+
 }  // namespace
 
 }  // namespace distributed_point_functions
@@ -0,0 +1,156 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dcf/fss_gates/equality.h"
+
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "dcf/fss_gates/equality.pb.h"
+#include "dcf/fss_gates/prng/basic_rng.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/internal/maybe_deref_span.h"
+#include "dpf/status_macros.h"
+
+namespace distributed_point_functions {
+namespace fss_gates {
+
+namespace {
+
+void SetUint128(absl::uint128 value, Value::Integer& integer) {
+  integer.mutable_value_uint128()->set_high(absl::Uint128High64(value));
+  integer.mutable_value_uint128()->set_low(absl::Uint128Low64(value));
+}
+
+absl::uint128 GetUint128(const Value::Integer& integer) {
+  return absl::MakeUint128(integer.value_uint128().high(),
+                           integer.value_uint128().low());
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<EqualityGate>> EqualityGate::Create(
+    const EqualityParameters& parameters) {
+  if (parameters.log_group_size() < 1 || parameters.log_group_size() > 127) {
+    return absl::InvalidArgumentError(
+        "log_group_size should be in > 0 and < 128");
+  }
+
+  // The DPF domain is the input group, and its values are 128 bit integers,
+  // which are reduced to the output group after evaluation.
+  DpfParameters dpf_parameters;
+  dpf_parameters.set_log_domain_size(parameters.log_group_size());
+  *(dpf_parameters.mutable_value_type()) = ToValueType<absl::uint128>();
+  DPF_ASSIGN_OR_RETURN(std::unique_ptr<DistributedPointFunction> dpf,
+                       DistributedPointFunction::Create(dpf_parameters));
+
+  return absl::WrapUnique(new EqualityGate(parameters, std::move(dpf)));
+}
+
+EqualityGate::EqualityGate(EqualityParameters parameters,
+                           std::unique_ptr<DistributedPointFunction> dpf)
+    : parameters_(std::move(parameters)), dpf_(std::move(dpf)) {}
+
+absl::StatusOr<std::pair<EqualityKey, EqualityKey>> EqualityGate::Gen(
+    absl::uint128 r_in, absl::uint128 r_out) {
+  // Setting N = 2 ^ log_group_size.
+  const absl::uint128 N = absl::uint128(1) << parameters_.log_group_size();
+  if (r_in >= N) {
+    return absl::InvalidArgumentError(
+        "Input mask should be between 0 and 2^log_group_size");
+  }
+  if (r_out >= N) {
+    return absl::InvalidArgumentError(
+        "Output mask should be between 0 and 2^log_group_size");
+  }
+
+  // The DPF evaluates to shares of 1 exactly on the masked input of y = 0.
+  EqualityKey k0, k1;
+  DPF_ASSIGN_OR_RETURN(std::tie(*k0.mutable_dpfkey(), *k1.mutable_dpfkey()),
+                       dpf_->GenerateKeys(r_in, absl::uint128{1}));
+
+  const absl::string_view kSampleSeed = absl::string_view();
+  DPF_ASSIGN_OR_RETURN(auto rng, BasicRng::Create(kSampleSeed));
+  DPF_ASSIGN_OR_RETURN(absl::uint128 r_out_0, rng->Rand128());
+  r_out_0 = r_out_0 % N;
+  const absl::uint128 r_out_1 = (r_out - r_out_0) % N;
+  SetUint128(r_out_0, *k0.mutable_output_mask_share());
+  SetUint128(r_out_1, *k1.mutable_output_mask_share());
+
+  return std::pair<EqualityKey, EqualityKey>(std::move(k0), std::move(k1));
+}
+
+absl::StatusOr<std::pair<std::vector<EqualityKey>, std::vector<EqualityKey>>>
+EqualityGate::BatchGen(absl::Span<const absl::uint128> r_in,
+                       absl::Span<const absl::uint128> r_out) {
+  if (r_in.size() != r_out.size()) {
+    return absl::InvalidArgumentError(
+        "`r_in` and `r_out` must have the same size");
+  }
+  std::vector<EqualityKey> keys_0(r_in.size()), keys_1(r_in.size());
+  for (int i = 0; i < r_in.size(); ++i) {
+    DPF_ASSIGN_OR_RETURN(std::tie(keys_0[i], keys_1[i]),
+                         Gen(r_in[i], r_out[i]));
+  }
+  return std::make_pair(std::move(keys_0), std::move(keys_1));
+}
+
+absl::StatusOr<std::vector<absl::uint128>> EqualityGate::BatchEval(
+    dpf_internal::MaybeDerefSpan<const EqualityKey> keys,
+    absl::Span<const absl::uint128> evaluation_points) {
+  if (keys.size() != evaluation_points.size()) {
+    return absl::InvalidArgumentError(
+        "`keys` and `evaluations_points` must have the same size");
+  }
+
+  // Setting N = 2 ^ log_group_size
+  const absl::uint128 N = absl::uint128(1) << parameters_.log_group_size();
+  for (int i = 0; i < evaluation_points.size(); i++) {
+    if (evaluation_points[i] >= N) {
+      return absl::InvalidArgumentError(
+          "Masked input should be between 0 and 2^log_group_size");
+    }
+  }
+
+  std::vector<const DpfKey*> dpf_keys(keys.size());
+  for (int i = 0; i < keys.size(); ++i) {
+    dpf_keys[i] = &(keys[i].dpfkey());
+  }
+
+  // The DPF has a single hierarchy level, so `op` is called exactly once with
+  // the outputs for all keys.
+  std::vector<absl::uint128> result(keys.size());
+  DPF_RETURN_IF_ERROR(dpf_->EvaluateAndApply<absl::uint128>(
+      dpf_keys, evaluation_points,
+      [&keys, &result, N](absl::Span<const absl::uint128> values) {
+        for (int i = 0; i < values.size(); ++i) {
+          result[i] =
+              (values[i] + GetUint128(keys[i].output_mask_share())) % N;
+        }
+        return true;
+      }));
+  return result;
+}
+
+}  // namespace fss_gates
+}  // namespace distributed_point_functions
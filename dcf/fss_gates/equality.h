@@ -0,0 +1,111 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DCF_FSS_GATES_EQUALITY_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DCF_FSS_GATES_EQUALITY_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "dcf/fss_gates/equality.pb.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/internal/maybe_deref_span.h"
+
+namespace distributed_point_functions {
+namespace fss_gates {
+
+// Implements the Equality (zero test) gate from
+// https://eprint.iacr.org/2020/1392 over the input and output group Z_{2 ^ n}.
+// The key generation procedure takes an input mask `r_in` and an output mask
+// `r_out`, and produces two keys, k_0 and k_1, corresponding to Party 0 and
+// Party 1 respectively. Evaluating both keys on the masked input
+// `x = y + r_in` results in additive secret shares of
+// `(y == 0 ? 1 : 0) + r_out`.
+//
+// The gate uses a single DPF with point `r_in` and value 1, so each evaluation
+// costs one DPF point evaluation. To test whether `y` equals a public value `p`
+// or another secret-shared value `z`, evaluate the gate on `x - p` or on the
+// masked difference `y - z + r_in`, respectively. This replaces the emulation
+// with a MultipleIntervalContainmentGate on the interval [p, p], which needs
+// two DCF evaluations per input.
+class EqualityGate {
+ public:
+  // Factory method : creates and returns an EqualityGate initialized with
+  // appropriate parameters.
+  //
+  // Returns INVALID_ARGUMENT if `log_group_size` is not between 1 and 127.
+  static absl::StatusOr<std::unique_ptr<EqualityGate>> Create(
+      const EqualityParameters& parameters);
+
+  // EqualityGate is neither copyable nor movable.
+  EqualityGate(const EqualityGate&) = delete;
+  EqualityGate& operator=(const EqualityGate&) = delete;
+
+  // Generates a pair of keys using `r_in` and `r_out` as the input and output
+  // mask, respectively. Both are interpreted as elements of Z_{2 ^ n}.
+  //
+  // Returns INVALID_ARGUMENT if `r_in` or `r_out` is not a group element.
+  absl::StatusOr<std::pair<EqualityKey, EqualityKey>> Gen(absl::uint128 r_in,
+                                                          absl::uint128 r_out);
+
+  // Generates a pair of keys for each pair `r_in[i]`, `r_out[i]`, and returns
+  // the keys of Party 0 and Party 1 in separate vectors.
+  //
+  // Returns INVALID_ARGUMENT if `r_in` and `r_out` have different sizes, or if
+  // any mask is not a group element.
+  absl::StatusOr<std::pair<std::vector<EqualityKey>, std::vector<EqualityKey>>>
+  BatchGen(absl::Span<const absl::uint128> r_in,
+           absl::Span<const absl::uint128> r_out);
+
+  // Evaluates the key `k` on the masked input `x`. The output needs to be
+  // interpreted as an element in the output group Z_{2 ^ n}.
+  inline absl::StatusOr<absl::uint128> Eval(const EqualityKey& k,
+                                            absl::uint128 x) {
+    absl::StatusOr<std::vector<absl::uint128>> result =
+        BatchEval(absl::MakeConstSpan(&k, 1), absl::MakeConstSpan(&x, 1));
+    if (!result.ok()) {
+      return result.status();
+    }
+    return (*result)[0];
+  }
+
+  // Evaluates keys[i] on evaluation_points[i] for all i. All keys are
+  // evaluated in a single pass over the DPF tree.
+  //
+  // Returns INVALID_ARGUMENT if `keys` and `evaluation_points` have different
+  // sizes, if any key is invalid, or if any evaluation point is out of range.
+  absl::StatusOr<std::vector<absl::uint128>> BatchEval(
+      dpf_internal::MaybeDerefSpan<const EqualityKey> keys,
+      absl::Span<const absl::uint128> evaluation_points);
+
+ private:
+  // Private constructor, called by `Create`.
+  EqualityGate(EqualityParameters parameters,
+               std::unique_ptr<DistributedPointFunction> dpf);
+
+  // Parameters needed for specifying an Equality gate.
+  const EqualityParameters parameters_;
+
+  // The DPF used by Gen and Eval.
+  std::unique_ptr<DistributedPointFunction> dpf_;
+};
+
+}  // namespace fss_gates
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DCF_FSS_GATES_EQUALITY_H_
@@ -0,0 +1,118 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/random/distributions.h"
+#include "absl/random/random.h"
+#include "benchmark/benchmark.h"  // third_party/benchmark
+#include "dcf/fss_gates/equality.h"
+#include "dcf/fss_gates/equality.pb.h"
+#include "dcf/fss_gates/multiple_interval_containment.h"
+#include "dcf/fss_gates/multiple_interval_containment.pb.h"
+#include "dpf/internal/memory_counters.h"
+#include "dpf/internal/status_matchers.h"
+
+namespace distributed_point_functions {
+namespace fss_gates {
+namespace {
+
+constexpr int kLogGroupSize = 64;
+
+void BM_BatchedEqualityEvaluation(benchmark::State& state) {
+  int num_keys = state.range(0);
+  EqualityParameters params;
+  params.set_log_group_size(kLogGroupSize);
+  DPF_ASSERT_OK_AND_ASSIGN(auto gate, EqualityGate::Create(params));
+  absl::BitGen gen;
+  std::vector<absl::uint128> r_in(num_keys), r_out(num_keys),
+      evaluation_points(num_keys);
+  for (int i = 0; i < num_keys; ++i) {
+    r_in[i] = absl::Uniform<uint64_t>(gen);
+    r_out[i] = absl::Uniform<uint64_t>(gen);
+    evaluation_points[i] = absl::Uniform<uint64_t>(gen);
+  }
+  std::vector<EqualityKey> keys;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(keys, std::ignore),
+                           gate->BatchGen(r_in, r_out));
+
+  std::vector<absl::uint128> evaluations(num_keys);
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto s : state) {
+    DPF_ASSERT_OK_AND_ASSIGN(evaluations,
+                             gate->BatchEval(keys, evaluation_points));
+    benchmark::DoNotOptimize(evaluations);
+  }
+}
+
+BENCHMARK(BM_BatchedEqualityEvaluation)->RangeMultiplier(8)->Range(1, 4096);
+
+// Emulates the equality test with a MultipleIntervalContainmentGate on the
+// single interval [0, 0], which is what callers had to do before EqualityGate.
+void BM_BatchedMicEqualityEmulation(benchmark::State& state) {
+  int num_keys = state.range(0);
+  MicParameters params;
+  params.set_log_group_size(kLogGroupSize);
+  Interval* interval = params.add_intervals();
+  interval->mutable_lower_bound()->set_value_uint64(0);
+  interval->mutable_upper_bound()->set_value_uint64(0);
+  DPF_ASSERT_OK_AND_ASSIGN(auto mic_gate,
+                           MultipleIntervalContainmentGate::Create(params));
+  absl::BitGen gen;
+  std::vector<MicKey> keys(num_keys);
+  std::vector<absl::uint128> evaluation_points(num_keys);
+  for (int i = 0; i < num_keys; ++i) {
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::tie(keys[i], std::ignore),
+        mic_gate->Gen(absl::Uniform<uint64_t>(gen),
+                      {absl::Uniform<uint64_t>(gen)}));
+    evaluation_points[i] = absl::Uniform<uint64_t>(gen);
+  }
+
+  std::vector<absl::uint128> evaluations(num_keys);
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto s : state) {
+    DPF_ASSERT_OK_AND_ASSIGN(evaluations,
+                             mic_gate->BatchEval(keys, evaluation_points));
+    benchmark::DoNotOptimize(evaluations);
+  }
+}
+
+BENCHMARK(BM_BatchedMicEqualityEmulation)->RangeMultiplier(8)->Range(1, 4096);
+
+}  // namespace
+}  // namespace fss_gates
+}  // namespace distributed_point_functions
+
+// Declare benchmark_filter flag, which will be defined by benchmark library.
+// Use it to check if any benchmarks were specified explicitly.
+//
+namespace benchmark {
+extern std::string FLAGS_benchmark_filter;
+}
+using benchmark::FLAGS_benchmark_filter;
+
+int main(int argc, char* argv[]) {
+  FLAGS_benchmark_filter = "";
+  benchmark::Initialize(&argc, argv);
+  if (!FLAGS_benchmark_filter.empty()) {
+    benchmark::RunSpecifiedBenchmarks();
+  }
+  benchmark::Shutdown();
+  return 0;
+}
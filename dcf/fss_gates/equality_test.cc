@@ -0,0 +1,170 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dcf/fss_gates/equality.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "dcf/fss_gates/equality.pb.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace distributed_point_functions {
+namespace fss_gates {
+namespace {
+
+using dpf_internal::StatusIs;
+using ::testing::ElementsAreArray;
+using ::testing::HasSubstr;
+
+absl::uint128 RandomGroupElement(absl::BitGen& gen, int log_group_size) {
+  const absl::uint128 N = absl::uint128(1) << log_group_size;
+  return absl::MakeUint128(absl::Uniform<uint64_t>(gen),
+                           absl::Uniform<uint64_t>(gen)) %
+         N;
+}
+
+TEST(EqualityTest, CreateFailsWithInvalidLogGroupSize) {
+  for (int log_group_size : {-1, 0, 128}) {
+    EqualityParameters parameters;
+    parameters.set_log_group_size(log_group_size);
+    EXPECT_THAT(EqualityGate::Create(parameters),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         "log_group_size should be in > 0 and < 128"));
+  }
+}
+
+TEST(EqualityTest, GenFailsIfMasksAreOutOfRange) {
+  EqualityParameters parameters;
+  parameters.set_log_group_size(16);
+  DPF_ASSERT_OK_AND_ASSIGN(auto gate, EqualityGate::Create(parameters));
+  EXPECT_THAT(gate->Gen(1 << 16, 0),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Input mask")));
+  EXPECT_THAT(gate->Gen(0, 1 << 16),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Output mask")));
+}
+
+TEST(EqualityTest, BatchGenFailsIfSizesDontMatch) {
+  EqualityParameters parameters;
+  parameters.set_log_group_size(16);
+  DPF_ASSERT_OK_AND_ASSIGN(auto gate, EqualityGate::Create(parameters));
+  std::vector<absl::uint128> r_in(2), r_out(3);
+  EXPECT_THAT(gate->BatchGen(r_in, r_out),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`r_in` and `r_out` must have the same size"));
+}
+
+TEST(EqualityTest, BatchEvalFailsIfSizesDontMatch) {
+  EqualityParameters parameters;
+  parameters.set_log_group_size(16);
+  DPF_ASSERT_OK_AND_ASSIGN(auto gate, EqualityGate::Create(parameters));
+  EqualityKey key_0;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_0, std::ignore), gate->Gen(5, 7));
+  std::vector<EqualityKey> keys = {key_0, key_0};
+  std::vector<absl::uint128> points = {5};
+  EXPECT_THAT(gate->BatchEval(keys, points),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("must have the same size")));
+}
+
+TEST(EqualityTest, EvalFailsIfInputIsOutOfRange) {
+  EqualityParameters parameters;
+  parameters.set_log_group_size(16);
+  DPF_ASSERT_OK_AND_ASSIGN(auto gate, EqualityGate::Create(parameters));
+  EqualityKey key_0;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key_0, std::ignore), gate->Gen(5, 7));
+  EXPECT_THAT(gate->Eval(key_0, 1 << 16),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Masked input")));
+}
+
+class EqualityGenAndEvalTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(EqualityGenAndEvalTest, OutputsSharesOfZeroTest) {
+  const int log_group_size = GetParam();
+  const absl::uint128 N = absl::uint128(1) << log_group_size;
+  EqualityParameters parameters;
+  parameters.set_log_group_size(log_group_size);
+  DPF_ASSERT_OK_AND_ASSIGN(auto gate, EqualityGate::Create(parameters));
+
+  absl::BitGen gen;
+  for (int i = 0; i < 20; ++i) {
+    const absl::uint128 r_in = RandomGroupElement(gen, log_group_size);
+    const absl::uint128 r_out = RandomGroupElement(gen, log_group_size);
+    DPF_ASSERT_OK_AND_ASSIGN(auto keys, gate->Gen(r_in, r_out));
+
+    // y = 0, y = 1, y = -1, and a random y.
+    for (absl::uint128 y : {absl::uint128{0}, absl::uint128{1}, N - 1,
+                            RandomGroupElement(gen, log_group_size)}) {
+      const absl::uint128 x = (y + r_in) % N;
+      DPF_ASSERT_OK_AND_ASSIGN(absl::uint128 share_0,
+                               gate->Eval(keys.first, x));
+      DPF_ASSERT_OK_AND_ASSIGN(absl::uint128 share_1,
+                               gate->Eval(keys.second, x));
+      const absl::uint128 expected = y == 0 ? 1 : 0;
+      EXPECT_EQ((share_0 + share_1 - r_out) % N, expected)
+          << "log_group_size=" << log_group_size << " y=" << y;
+    }
+  }
+}
+
+TEST_P(EqualityGenAndEvalTest, BatchEvalMatchesEval) {
+  const int log_group_size = GetParam();
+  const absl::uint128 N = absl::uint128(1) << log_group_size;
+  const int num_keys = 50;
+  EqualityParameters parameters;
+  parameters.set_log_group_size(log_group_size);
+  DPF_ASSERT_OK_AND_ASSIGN(auto gate, EqualityGate::Create(parameters));
+
+  absl::BitGen gen;
+  std::vector<absl::uint128> r_in(num_keys), r_out(num_keys), ys(num_keys),
+      xs(num_keys);
+  for (int i = 0; i < num_keys; ++i) {
+    r_in[i] = RandomGroupElement(gen, log_group_size);
+    r_out[i] = RandomGroupElement(gen, log_group_size);
+    // Make every other input equal to zero.
+    ys[i] = i % 2 == 0 ? 0 : RandomGroupElement(gen, log_group_size);
+    xs[i] = (ys[i] + r_in[i]) % N;
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(auto keys, gate->BatchGen(r_in, r_out));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> shares_0,
+                           gate->BatchEval(keys.first, xs));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> shares_1,
+                           gate->BatchEval(keys.second, xs));
+
+  std::vector<absl::uint128> expected(num_keys), outputs(num_keys);
+  for (int i = 0; i < num_keys; ++i) {
+    DPF_ASSERT_OK_AND_ASSIGN(absl::uint128 share_0,
+                             gate->Eval(keys.first[i], xs[i]));
+    EXPECT_EQ(shares_0[i], share_0);
+    expected[i] = ys[i] == 0 ? 1 : 0;
+    outputs[i] = (shares_0[i] + shares_1[i] - r_out[i]) % N;
+  }
+  EXPECT_THAT(outputs, ElementsAreArray(expected));
+}
+
+INSTANTIATE_TEST_SUITE_P(VaryLogGroupSize, EqualityGenAndEvalTest,
+                         testing::Values(1, 2, 8, 32, 64, 127));
+
+}  // namespace
+}  // namespace fss_gates
+}  // namespace distributed_point_functions
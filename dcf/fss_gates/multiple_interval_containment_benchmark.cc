@@ -23,6 +23,7 @@
 #include "benchmark/benchmark.h"  // third_party/benchmark
 #include "dcf/fss_gates/multiple_interval_containment.h"
 #include "dcf/fss_gates/multiple_interval_containment.pb.h"
+#include "dpf/internal/memory_counters.h"
 #include "dpf/internal/status_matchers.h"
 
 namespace distributed_point_functions {
@@ -56,6 +57,7 @@ void BM_BatchedMicEvaluation(benchmark::State& state) {
   }
 
   std::vector<absl::uint128> evaluations(num_intervals);
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto s : state) {
     DPF_ASSERT_OK_AND_ASSIGN(evaluations,
                              mic_gate->BatchEval(keys, evaluation_points));
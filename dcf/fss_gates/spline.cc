@@ -0,0 +1,431 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dcf/fss_gates/spline.h"
+
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "dcf/distributed_comparison_function.h"
+#include "dcf/fss_gates/prng/basic_rng.h"
+#include "dcf/fss_gates/spline.pb.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/internal/maybe_deref_span.h"
+#include "dpf/internal/value_type_helpers.h"
+#include "dpf/status_macros.h"
+#include "dpf/tuple.h"
+#include "hwy/aligned_allocator.h"
+
+namespace distributed_point_functions {
+namespace fss_gates {
+
+namespace {
+
+// Splits `value` into two additive shares modulo `N`, and appends them to
+// `share_0` and `share_1`.
+absl::Status AddShares(
+    absl::uint128 value, absl::uint128 N,
+    google::protobuf::RepeatedPtrField<Value::Integer>* share_0,
+    google::protobuf::RepeatedPtrField<Value::Integer>* share_1) {
+  const absl::string_view kSampleSeed = absl::string_view();
+  DPF_ASSIGN_OR_RETURN(
+      auto rng, distributed_point_functions::BasicRng::Create(kSampleSeed));
+  DPF_ASSIGN_OR_RETURN(absl::uint128 value_0, rng->Rand128());
+  value_0 = value_0 % N;
+  absl::uint128 value_1 = (value - value_0) % N;
+  *(share_0->Add()) = dpf_internal::Uint128ToValueInteger(value_0);
+  *(share_1->Add()) = dpf_internal::Uint128ToValueInteger(value_1);
+  return absl::OkStatus();
+}
+
+template <size_t>
+using Coefficient = absl::uint128;
+
+// Converts between the coefficients of a polynomial and the DCF payload
+// holding all of them, a Tuple with one absl::uint128 per coefficient.
+template <typename Indices>
+struct CoefficientPayloadHelper;
+
+template <size_t... I>
+struct CoefficientPayloadHelper<std::index_sequence<I...>> {
+  using Payload = Tuple<Coefficient<I>...>;
+
+  static Payload FromCoefficients(absl::Span<const absl::uint128> in) {
+    return Payload(in[I]...);
+  }
+
+  static void ToCoefficients(const Payload& in, absl::Span<absl::uint128> out) {
+    ((out[I] = std::get<I>(in.value())), ...);
+  }
+};
+
+// A single coefficient is stored as a plain integer, which the DPF handles
+// faster than a Tuple with one element.
+template <>
+struct CoefficientPayloadHelper<std::index_sequence<0>> {
+  using Payload = absl::uint128;
+
+  static Payload FromCoefficients(absl::Span<const absl::uint128> in) {
+    return in[0];
+  }
+
+  static void ToCoefficients(const Payload& in, absl::Span<absl::uint128> out) {
+    out[0] = in;
+  }
+};
+
+template <size_t kNumCoefficients>
+using CoefficientPayload =
+    CoefficientPayloadHelper<std::make_index_sequence<kNumCoefficients>>;
+
+// The DCF operations of a spline gate, for a fixed number of coefficients.
+struct CoefficientDcfOps {
+  // Returns the value type of the DCF payload.
+  ValueType (*value_type)();
+
+  // Generates DCF keys whose payload is `coefficients`.
+  absl::StatusOr<std::pair<DcfKey, DcfKey>> (*generate_keys)(
+      DistributedComparisonFunction& dcf, absl::uint128 alpha,
+      absl::Span<const absl::uint128> coefficients);
+
+  // Evaluates `keys[i]` at `evaluation_points[i]`, and writes the coefficients
+  // of the result to `output`, starting at i * num_coefficients.
+  absl::Status (*batch_evaluate)(
+      DistributedComparisonFunction& dcf, absl::Span<const DcfKey* const> keys,
+      absl::Span<const absl::uint128> evaluation_points,
+      absl::Span<absl::uint128> output);
+};
+
+template <size_t kNumCoefficients>
+ValueType CoefficientValueType() {
+  return ToValueType<
+      typename CoefficientPayload<kNumCoefficients>::Payload>();
+}
+
+template <size_t kNumCoefficients>
+absl::StatusOr<std::pair<DcfKey, DcfKey>> GenerateCoefficientDcfKeys(
+    DistributedComparisonFunction& dcf, absl::uint128 alpha,
+    absl::Span<const absl::uint128> coefficients) {
+  return dcf.GenerateKeys(
+      alpha,
+      CoefficientPayload<kNumCoefficients>::FromCoefficients(coefficients));
+}
+
+template <size_t kNumCoefficients>
+absl::Status BatchEvaluateCoefficientDcf(
+    DistributedComparisonFunction& dcf, absl::Span<const DcfKey* const> keys,
+    absl::Span<const absl::uint128> evaluation_points,
+    absl::Span<absl::uint128> output) {
+  using Payload = typename CoefficientPayload<kNumCoefficients>::Payload;
+  std::vector<Payload> payloads(keys.size());
+  DPF_RETURN_IF_ERROR(dcf.BatchEvaluate<Payload>(keys, evaluation_points,
+                                                 absl::MakeSpan(payloads)));
+  for (size_t i = 0; i < payloads.size(); ++i) {
+    CoefficientPayload<kNumCoefficients>::ToCoefficients(
+        payloads[i],
+        output.subspan(i * kNumCoefficients, kNumCoefficients));
+  }
+  return absl::OkStatus();
+}
+
+template <size_t... I>
+const CoefficientDcfOps& GetCoefficientDcfOps(int num_coefficients,
+                                              std::index_sequence<I...>) {
+  static constexpr CoefficientDcfOps kOps[] = {
+      {&CoefficientValueType<I + 1>, &GenerateCoefficientDcfKeys<I + 1>,
+       &BatchEvaluateCoefficientDcf<I + 1>}...};
+  return kOps[num_coefficients - 1];
+}
+
+// Returns the DCF operations for payloads of `num_coefficients` coefficients,
+// which must be between 1 and SplineGate::kMaxDegree + 1. The payload type is
+// chosen at compile time, so that all coefficients of a boundary share a
+// single DCF key and evaluation.
+const CoefficientDcfOps& GetCoefficientDcfOps(int num_coefficients) {
+  return GetCoefficientDcfOps(
+      num_coefficients, std::make_index_sequence<SplineGate::kMaxDegree + 1>{});
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<SplineGate>> SplineGate::Create(
+    const SplineParameters& spline_parameters) {
+  // Return error if log_group_size is not between 1 and 127.
+  if (spline_parameters.log_group_size() < 1 ||
+      spline_parameters.log_group_size() > 127) {
+    return absl::InvalidArgumentError(
+        "log_group_size should be in > 0 and < 128");
+  }
+  if (spline_parameters.degree() < 0) {
+    return absl::InvalidArgumentError("degree must be non-negative");
+  }
+  if (spline_parameters.degree() > kMaxDegree) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("degree must be at most ", kMaxDegree));
+  }
+  if (spline_parameters.pieces_size() == 0) {
+    return absl::InvalidArgumentError("pieces must not be empty");
+  }
+
+  // Setting N = 2 ^ log_group_size.
+  absl::uint128 N = absl::uint128(1) << spline_parameters.log_group_size();
+  int num_coefficients = spline_parameters.degree() + 1;
+
+  std::vector<absl::uint128> boundaries;
+  std::vector<std::vector<absl::uint128>> coefficients;
+  boundaries.reserve(spline_parameters.pieces_size());
+  coefficients.reserve(spline_parameters.pieces_size());
+  for (const SplinePiece& piece : spline_parameters.pieces()) {
+    if (!piece.has_lower_bound()) {
+      return absl::InvalidArgumentError("Pieces should have a lower bound");
+    }
+    DPF_ASSIGN_OR_RETURN(
+        absl::uint128 p,
+        dpf_internal::ValueIntegerToUint128(piece.lower_bound()));
+
+    // Return error if the boundaries do not partition the group.
+    if (boundaries.empty() && p != 0) {
+      return absl::InvalidArgumentError(
+          "The lower bound of the first piece should be 0");
+    }
+    if (!boundaries.empty() && p <= boundaries.back()) {
+      return absl::InvalidArgumentError(
+          "Lower bounds of pieces should be strictly increasing");
+    }
+    if (p >= N) {
+      return absl::InvalidArgumentError(
+          "Lower bounds should be between 0 and 2^log_group_size");
+    }
+
+    if (piece.coefficients_size() > num_coefficients) {
+      return absl::InvalidArgumentError(
+          "Pieces should have at most degree + 1 coefficients");
+    }
+    std::vector<absl::uint128> piece_coefficients(num_coefficients, 0);
+    for (int k = 0; k < piece.coefficients_size(); ++k) {
+      DPF_ASSIGN_OR_RETURN(
+          piece_coefficients[k],
+          dpf_internal::ValueIntegerToUint128(piece.coefficients(k)));
+      if (piece_coefficients[k] >= N) {
+        return absl::InvalidArgumentError(
+            "Coefficients should be between 0 and 2^log_group_size");
+      }
+    }
+    boundaries.push_back(p);
+    coefficients.push_back(std::move(piece_coefficients));
+  }
+
+  // Setting the `log_domain_size` of the DCF to be same as the
+  // `log_group_size` of the spline gate. The outputs are tuples of one 128 bit
+  // integer per coefficient.
+  DcfParameters dcf_parameters;
+  dcf_parameters.mutable_parameters()->set_log_domain_size(
+      spline_parameters.log_group_size());
+  *(dcf_parameters.mutable_parameters()->mutable_value_type()) =
+      GetCoefficientDcfOps(num_coefficients).value_type();
+  DPF_ASSIGN_OR_RETURN(std::unique_ptr<DistributedComparisonFunction> dcf,
+                       DistributedComparisonFunction::Create(dcf_parameters));
+
+  return absl::WrapUnique(new SplineGate(spline_parameters,
+                                         std::move(boundaries),
+                                         std::move(coefficients),
+                                         std::move(dcf)));
+}
+
+SplineGate::SplineGate(SplineParameters spline_parameters,
+                       std::vector<absl::uint128> boundaries,
+                       std::vector<std::vector<absl::uint128>> coefficients,
+                       std::unique_ptr<DistributedComparisonFunction> dcf)
+    : spline_parameters_(std::move(spline_parameters)),
+      boundaries_(std::move(boundaries)),
+      coefficients_(std::move(coefficients)),
+      dcf_(std::move(dcf)) {}
+
+absl::StatusOr<std::pair<SplineKey, SplineKey>> SplineGate::Gen(
+    absl::uint128 r_in, std::vector<absl::uint128> r_out) {
+  int num_coefficients = spline_parameters_.degree() + 1;
+  int num_pieces = boundaries_.size();
+  if (r_out.size() != num_coefficients) {
+    return absl::InvalidArgumentError(
+        "Count of output masks should be equal to degree + 1");
+  }
+
+  // Setting N = 2 ^ log_group_size.
+  absl::uint128 N = absl::uint128(1) << spline_parameters_.log_group_size();
+
+  // Checking whether r_in and r_out are group elements.
+  if (r_in >= N) {
+    return absl::InvalidArgumentError(
+        "Input mask should be between 0 and 2^log_group_size");
+  }
+  for (int k = 0; k < num_coefficients; ++k) {
+    if (r_out[k] >= N) {
+      return absl::InvalidArgumentError(
+          "Output mask should be between 0 and 2^log_group_size");
+    }
+  }
+
+  // Compute the coefficients of g_i(X) = f_i(X - r_in) by a Taylor shift.
+  // Arithmetic modulo 2^128 is compatible with arithmetic modulo N, so we only
+  // reduce at the end.
+  absl::uint128 shift = N - r_in;
+  std::vector<std::vector<absl::uint128>> shifted = coefficients_;
+  for (std::vector<absl::uint128>& g : shifted) {
+    for (int i = 0; i + 1 < num_coefficients; ++i) {
+      for (int j = num_coefficients - 2; j >= i; --j) {
+        g[j] += shift * g[j + 1];
+      }
+    }
+    for (absl::uint128& c : g) {
+      c %= N;
+    }
+  }
+
+  // As in the Multiple Interval Containment gate (Fig. 14), the DCF outputs
+  // its payload on inputs less than gamma.
+  absl::uint128 gamma = (N - 1 + r_in) % N;
+
+  const CoefficientDcfOps& dcf_ops = GetCoefficientDcfOps(num_coefficients);
+  SplineKey k0, k1;
+  std::vector<absl::uint128> correction = shifted[0];
+  std::vector<absl::uint128> delta(num_coefficients);
+  for (int i = 0; i < num_pieces; ++i) {
+    const std::vector<absl::uint128>& previous =
+        shifted[(i + num_pieces - 1) % num_pieces];
+
+    // [x >= p_i] is computed as in Fig. 14 for the interval [p_i, N - 1]. The
+    // comparison with the upper end is the same for all boundaries and is
+    // folded into the key for boundary 0, whose payload is the negated sum of
+    // all other payloads. The following computes the correction term `z` from
+    // Line 5 of Fig. 14 for this interval.
+    absl::uint128 alpha_p = (boundaries_[i] + r_in) % N;
+    absl::uint128 z = (alpha_p > gamma ? 1 : 0) +
+                      (alpha_p > boundaries_[i] ? -1 : 0) + 1;
+    for (int k = 0; k < num_coefficients; ++k) {
+      delta[k] = (shifted[i][k] - previous[k]) % N;
+      if (i > 0) {
+        correction[k] += z * delta[k];
+        DPF_RETURN_IF_ERROR(
+            AddShares(delta[k], N, k0.mutable_coefficient_difference_shares(),
+                      k1.mutable_coefficient_difference_shares()));
+      }
+    }
+    DcfKey key_0, key_1;
+    DPF_ASSIGN_OR_RETURN(std::tie(key_0, key_1),
+                         dcf_ops.generate_keys(*dcf_, gamma, delta));
+    *(k0.add_dcf_keys()) = std::move(key_0);
+    *(k1.add_dcf_keys()) = std::move(key_1);
+  }
+
+  for (int k = 0; k < num_coefficients; ++k) {
+    DPF_RETURN_IF_ERROR(AddShares((correction[k] + r_out[k]) % N, N,
+                                  k0.mutable_output_mask_share(),
+                                  k1.mutable_output_mask_share()));
+  }
+  return std::pair<SplineKey, SplineKey>(std::move(k0), std::move(k1));
+}
+
+absl::StatusOr<std::vector<absl::uint128>> SplineGate::BatchEval(
+    dpf_internal::MaybeDerefSpan<const SplineKey> keys,
+    absl::Span<const absl::uint128> evaluation_points) {
+  if (keys.size() != evaluation_points.size()) {
+    return absl::InvalidArgumentError(
+        "`keys` and `evaluations_points` must have the same size");
+  }
+
+  // Setting N = 2 ^ log_group_size
+  absl::uint128 N = absl::uint128(1) << spline_parameters_.log_group_size();
+  int num_coefficients = spline_parameters_.degree() + 1;
+  int num_pieces = boundaries_.size();
+
+  for (int i = 0; i < keys.size(); ++i) {
+    if (evaluation_points[i] >= N) {
+      return absl::InvalidArgumentError(
+          "Masked input should be between 0 and 2^log_group_size");
+    }
+    if (keys[i].dcf_keys_size() != num_pieces ||
+        keys[i].coefficient_difference_shares_size() !=
+            (num_pieces - 1) * num_coefficients ||
+        keys[i].output_mask_share_size() != num_coefficients) {
+      return absl::InvalidArgumentError(
+          "Key does not match the parameters of this gate");
+    }
+  }
+
+  // Evaluate every DCF key once, at the point corresponding to its boundary,
+  // i.e., x_p from Line 4 of Fig. 14. Adjacent pieces share this evaluation,
+  // and each evaluation outputs all coefficients at once.
+  std::vector<const DcfKey*> dcf_keys;
+  dcf_keys.reserve(keys.size() * num_pieces);
+  auto x_p = hwy::AllocateAligned<absl::uint128>(keys.size() * num_pieces);
+  if (x_p == nullptr) {
+    return absl::ResourceExhaustedError("Memory allocation error");
+  }
+  for (int i = 0; i < keys.size(); ++i) {
+    const absl::uint128& x = evaluation_points[i];
+    for (int j = 0; j < num_pieces; ++j) {
+      x_p[dcf_keys.size()] = (x + N - 1 - boundaries_[j]) % N;
+      dcf_keys.push_back(&(keys[i].dcf_keys(j)));
+    }
+  }
+  // Coefficient c of boundary j for key i is at (i * m + j) * (d + 1) + c.
+  std::vector<absl::uint128> s_p(dcf_keys.size() * num_coefficients);
+  DPF_RETURN_IF_ERROR(GetCoefficientDcfOps(num_coefficients)
+                          .batch_evaluate(
+                              *dcf_, dcf_keys,
+                              absl::MakeConstSpan(x_p.get(), dcf_keys.size()),
+                              absl::MakeSpan(s_p)));
+  const int coefficients_per_key = num_pieces * num_coefficients;
+
+  std::vector<absl::uint128> res;
+  res.reserve(keys.size() * num_coefficients);
+  for (int i = 0; i < keys.size(); ++i) {
+    const absl::uint128& x = evaluation_points[i];
+    const SplineKey& k = keys[i];
+    for (int c = 0; c < num_coefficients; ++c) {
+      DPF_ASSIGN_OR_RETURN(
+          absl::uint128 y,
+          dpf_internal::ValueIntegerToUint128(k.output_mask_share(c)));
+      y -= s_p[i * coefficients_per_key + c];
+      for (int j = 1; j < num_pieces; ++j) {
+        // Public part of Line 7 of Fig. 14, multiplied with a share of the
+        // coefficient difference, since the latter depends on r_in.
+        absl::uint128 public_term =
+            (x > boundaries_[j] ? 1 : 0) - (x > 0 ? 1 : 0);
+        DPF_ASSIGN_OR_RETURN(
+            absl::uint128 delta_share,
+            dpf_internal::ValueIntegerToUint128(
+                k.coefficient_difference_shares((j - 1) * num_coefficients +
+                                                c)));
+        y += public_term * delta_share -
+             s_p[i * coefficients_per_key + j * num_coefficients + c];
+      }
+      res.push_back(y % N);
+    }
+  }
+  return res;
+}
+
+}  // namespace fss_gates
+}  // namespace distributed_point_functions
@@ -0,0 +1,120 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DCF_FSS_GATES_SPLINE_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DCF_FSS_GATES_SPLINE_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "dcf/distributed_comparison_function.h"
+#include "dcf/fss_gates/spline.pb.h"
+#include "dpf/internal/maybe_deref_span.h"
+
+namespace distributed_point_functions {
+namespace fss_gates {
+
+// Implements a spline gate in the spirit of https://eprint.iacr.org/2020/1392
+// (Fig. 15). Such a gate is specified by input and output group Z_{2 ^ n} and
+// `m` public polynomials {f_i}_{i \in [m]} of degree at most `d`, where f_i is
+// used on the interval [p_i, p_{i + 1} - 1]. Evaluating a key on a masked
+// input `x + r_in` results in additive secret shares of the `d + 1`
+// coefficients of the polynomial
+//
+//   g(X) = f_i(X - r_in), where p_i <= x < p_{i + 1},
+//
+// each masked with the corresponding output mask. Since the masked input is
+// public, both parties can evaluate g at `x + r_in` locally to obtain shares of
+// f_i(x) without further interaction.
+//
+// Whereas the Multiple Interval Containment gate compares with both ends of
+// each interval, consecutive pieces share their common boundary here: the
+// coefficients are computed as g = g_0 + sum_i [x >= p_i] * (g_i - g_{i - 1}),
+// with a single DCF evaluation per boundary. The payload of each DCF holds all
+// `d + 1` coefficient differences.
+class SplineGate {
+ public:
+  // The maximal degree of the polynomials. The DCF payload type is fixed at
+  // compile time for each number of coefficients up to `kMaxDegree + 1`.
+  static constexpr int kMaxDegree = 7;
+
+  // Factory method : creates and returns a SplineGate initialized with
+  // appropriate parameters.
+  //
+  // Returns INVALID_ARGUMENT if the parameters are invalid, or if the degree is
+  // larger than `kMaxDegree`.
+  static absl::StatusOr<std::unique_ptr<SplineGate>> Create(
+      const SplineParameters& spline_parameters);
+
+  // SplineGate is neither copyable nor movable.
+  SplineGate(const SplineGate&) = delete;
+  SplineGate& operator=(const SplineGate&) = delete;
+
+  // Generates a pair of keys using `r_in` as the input mask and `r_out` as the
+  // output masks, one for each of the `degree + 1` coefficients. As for the
+  // Multiple Interval Containment gate, all masks are interpreted as elements
+  // of Z_{2 ^ n}.
+  //
+  // Returns INVALID_ARGUMENT if the size of `r_out` is not `degree + 1`, or if
+  // any mask is not a group element.
+  absl::StatusOr<std::pair<SplineKey, SplineKey>> Gen(
+      absl::uint128 r_in, std::vector<absl::uint128> r_out);
+
+  // Evaluates the spline gate key k on the masked input `x`. Returns shares of
+  // the `degree + 1` masked coefficients of the active piece, starting with the
+  // constant coefficient.
+  inline absl::StatusOr<std::vector<absl::uint128>> Eval(const SplineKey& k,
+                                                         absl::uint128 x) {
+    return BatchEval(absl::MakeConstSpan(&k, 1), absl::MakeConstSpan(&x, 1));
+  }
+
+  // Evaluates keys[i] on evaluation_points[i] for all i, and returns the result
+  // as a single vector of absl::uint128. Coefficient k for key i will be at
+  // position i * (degree + 1) + k in the resulting vector. All DCF evaluations
+  // are done in a single batch.
+  //
+  // Returns INVALID_ARGUMENT if any key is invalid, or if any evaluation point
+  // is out of range.
+  absl::StatusOr<std::vector<absl::uint128>> BatchEval(
+      dpf_internal::MaybeDerefSpan<const SplineKey> keys,
+      absl::Span<const absl::uint128> evaluation_points);
+
+ private:
+  // Private constructor, called by `Create`.
+  SplineGate(SplineParameters spline_parameters,
+             std::vector<absl::uint128> boundaries,
+             std::vector<std::vector<absl::uint128>> coefficients,
+             std::unique_ptr<DistributedComparisonFunction> dcf);
+
+  // Parameters needed for specifying a spline gate.
+  const SplineParameters spline_parameters_;
+
+  // The lower bounds of the pieces, i.e., the boundaries {p_i}_{i \in [m]}.
+  const std::vector<absl::uint128> boundaries_;
+
+  // The `degree + 1` coefficients of each piece, padded with zeros.
+  const std::vector<std::vector<absl::uint128>> coefficients_;
+
+  // Distributed Comparison Function invoked by Gen and Eval.
+  std::unique_ptr<DistributedComparisonFunction> dcf_;
+};
+
+}  // namespace fss_gates
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DCF_FSS_GATES_SPLINE_H_
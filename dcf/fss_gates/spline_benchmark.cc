@@ -0,0 +1,161 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/random/distributions.h"
+#include "absl/random/random.h"
+#include "benchmark/benchmark.h"  // third_party/benchmark
+#include "dcf/fss_gates/multiple_interval_containment.h"
+#include "dcf/fss_gates/multiple_interval_containment.pb.h"
+#include "dcf/fss_gates/spline.h"
+#include "dcf/fss_gates/spline.pb.h"
+#include "dpf/internal/memory_counters.h"
+#include "dpf/internal/status_matchers.h"
+
+namespace distributed_point_functions {
+namespace fss_gates {
+namespace {
+
+// Returns the sorted lower bounds of `num_pieces` random pieces partitioning
+// Z_{2^64}, starting with 0.
+std::vector<uint64_t> RandomLowerBounds(int num_pieces, absl::BitGen& gen) {
+  std::vector<uint64_t> lower_bounds(num_pieces, 0);
+  for (int i = 1; i < num_pieces; ++i) {
+    lower_bounds[i] = absl::Uniform<uint64_t>(gen);
+  }
+  std::sort(lower_bounds.begin(), lower_bounds.end());
+  lower_bounds.erase(std::unique(lower_bounds.begin(), lower_bounds.end()),
+                     lower_bounds.end());
+  return lower_bounds;
+}
+
+void BM_BatchedSplineEvaluation(benchmark::State& state) {
+  int num_keys = state.range(0);
+  int num_pieces = state.range(1);
+  int degree = state.range(2);
+  std::vector<SplineKey> keys(num_keys);
+  std::vector<absl::uint128> evaluation_points(num_keys);
+  SplineParameters params;
+  params.set_log_group_size(64);
+  params.set_degree(degree);
+  absl::BitGen gen;
+  for (uint64_t lower_bound : RandomLowerBounds(num_pieces, gen)) {
+    SplinePiece* piece = params.add_pieces();
+    piece->mutable_lower_bound()->set_value_uint64(lower_bound);
+    for (int k = 0; k <= degree; ++k) {
+      piece->add_coefficients()->set_value_uint64(
+          absl::Uniform<uint64_t>(gen));
+    }
+  }
+  std::vector<absl::uint128> r_out(degree + 1);
+  for (absl::uint128& r : r_out) {
+    r = absl::Uniform<uint64_t>(gen);
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(auto spline_gate, SplineGate::Create(params));
+  for (int i = 0; i < num_keys; ++i) {
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::tie(keys[i], std::ignore),
+        spline_gate->Gen(absl::Uniform<uint64_t>(gen), r_out));
+    evaluation_points[i] = absl::Uniform<uint64_t>(gen);
+  }
+
+  std::vector<absl::uint128> evaluations;
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto s : state) {
+    DPF_ASSERT_OK_AND_ASSIGN(evaluations,
+                             spline_gate->BatchEval(keys, evaluation_points));
+    benchmark::DoNotOptimize(evaluations);
+  }
+}
+
+BENCHMARK(BM_BatchedSplineEvaluation)
+    ->ArgsProduct({{1, 128}, {1, 4, 16}, {0, 1, 3}})
+    ->Args({1000, 6, 2});
+
+// Baseline for BM_BatchedSplineEvaluation: the Multiple Interval Containment
+// gate on the same pieces, which is how splines were emulated before. Its
+// output is only the containment bit of each piece, and the coefficients
+// would still have to be selected with one secure multiplication per piece and
+// coefficient. So this measures a lower bound on the cost of the emulation,
+// with two DCF evaluations per piece instead of one per boundary.
+void BM_BatchedMicSplineEmulation(benchmark::State& state) {
+  int num_keys = state.range(0);
+  int num_pieces = state.range(1);
+  std::vector<MicKey> keys(num_keys);
+  std::vector<absl::uint128> evaluation_points(num_keys);
+  MicParameters params;
+  params.set_log_group_size(64);
+  absl::BitGen gen;
+  std::vector<uint64_t> lower_bounds = RandomLowerBounds(num_pieces, gen);
+  for (int i = 0; i < static_cast<int>(lower_bounds.size()); ++i) {
+    uint64_t upper_bound = i + 1 < static_cast<int>(lower_bounds.size())
+                               ? lower_bounds[i + 1] - 1
+                               : ~uint64_t{0};
+    Interval* interval = params.add_intervals();
+    interval->mutable_lower_bound()->set_value_uint64(lower_bounds[i]);
+    interval->mutable_upper_bound()->set_value_uint64(upper_bound);
+  }
+  std::vector<absl::uint128> r_out(params.intervals_size());
+  for (absl::uint128& r : r_out) {
+    r = absl::Uniform<uint64_t>(gen);
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(auto mic_gate,
+                           MultipleIntervalContainmentGate::Create(params));
+  for (int i = 0; i < num_keys; ++i) {
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::tie(keys[i], std::ignore),
+        mic_gate->Gen(absl::Uniform<uint64_t>(gen), r_out));
+    evaluation_points[i] = absl::Uniform<uint64_t>(gen);
+  }
+
+  std::vector<absl::uint128> evaluations;
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto s : state) {
+    DPF_ASSERT_OK_AND_ASSIGN(evaluations,
+                             mic_gate->BatchEval(keys, evaluation_points));
+    benchmark::DoNotOptimize(evaluations);
+  }
+}
+
+BENCHMARK(BM_BatchedMicSplineEmulation)
+    ->ArgsProduct({{1, 128}, {1, 4, 16}})
+    ->Args({1000, 6});
+
+}  // namespace
+}  // namespace fss_gates
+}  // namespace distributed_point_functions
+
+// Declare benchmark_filter flag, which will be defined by benchmark library.
+// Use it to check if any benchmarks were specified explicitly.
+//
+namespace benchmark {
+extern std::string FLAGS_benchmark_filter;
+}
+using benchmark::FLAGS_benchmark_filter;
+
+int main(int argc, char* argv[]) {
+  FLAGS_benchmark_filter = "";
+  benchmark::Initialize(&argc, argv);
+  if (!FLAGS_benchmark_filter.empty()) {
+    benchmark::RunSpecifiedBenchmarks();
+  }
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,374 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dcf/fss_gates/spline.h"
+
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "dcf/fss_gates/spline.pb.h"
+#include "dpf/internal/status_matchers.h"
+#include "dpf/internal/value_type_helpers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace distributed_point_functions {
+namespace fss_gates {
+namespace {
+
+using dpf_internal::StatusIs;
+using ::testing::HasSubstr;
+
+absl::uint128 RandomGroupElement(absl::BitGen& gen, int log_group_size) {
+  const absl::uint128 N = absl::uint128(1) << log_group_size;
+  return absl::MakeUint128(absl::Uniform<uint64_t>(gen),
+                           absl::Uniform<uint64_t>(gen)) %
+         N;
+}
+
+// Returns parameters for a spline with the given lower bounds and random
+// polynomials of the given degree.
+SplineParameters RandomSpline(absl::BitGen& gen, int log_group_size,
+                              int degree,
+                              const std::vector<absl::uint128>& lower_bounds) {
+  SplineParameters parameters;
+  parameters.set_log_group_size(log_group_size);
+  parameters.set_degree(degree);
+  for (absl::uint128 p : lower_bounds) {
+    SplinePiece* piece = parameters.add_pieces();
+    *(piece->mutable_lower_bound()) = dpf_internal::Uint128ToValueInteger(p);
+    for (int k = 0; k <= degree; ++k) {
+      *(piece->add_coefficients()) = dpf_internal::Uint128ToValueInteger(
+          RandomGroupElement(gen, log_group_size));
+    }
+  }
+  return parameters;
+}
+
+// Evaluates the polynomial with the given coefficients at `x` modulo N.
+absl::uint128 EvaluatePolynomial(absl::Span<const absl::uint128> coefficients,
+                                 absl::uint128 x, absl::uint128 N) {
+  absl::uint128 result = 0;
+  for (int k = coefficients.size() - 1; k >= 0; --k) {
+    result = result * x + coefficients[k];
+  }
+  return result % N;
+}
+
+// Returns the coefficients of the piece of `parameters` containing `y`.
+std::vector<absl::uint128> ActiveCoefficients(
+    const SplineParameters& parameters, absl::uint128 y) {
+  int active = 0;
+  for (int i = 0; i < parameters.pieces_size(); ++i) {
+    absl::uint128 p = *dpf_internal::ValueIntegerToUint128(
+        parameters.pieces(i).lower_bound());
+    if (y >= p) active = i;
+  }
+  std::vector<absl::uint128> result;
+  for (const Value::Integer& c : parameters.pieces(active).coefficients()) {
+    result.push_back(*dpf_internal::ValueIntegerToUint128(c));
+  }
+  return result;
+}
+
+TEST(SplineTest, CreateFailsWithInvalidLogGroupSize) {
+  absl::BitGen gen;
+  for (int log_group_size : {-1, 0, 128}) {
+    SplineParameters parameters = RandomSpline(gen, 16, 1, {0});
+    parameters.set_log_group_size(log_group_size);
+    EXPECT_THAT(SplineGate::Create(parameters),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         "log_group_size should be in > 0 and < 128"));
+  }
+}
+
+TEST(SplineTest, CreateFailsWithoutPieces) {
+  SplineParameters parameters;
+  parameters.set_log_group_size(16);
+  EXPECT_THAT(SplineGate::Create(parameters),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "pieces must not be empty"));
+}
+
+TEST(SplineTest, CreateFailsIfPiecesDontPartitionTheGroup) {
+  absl::BitGen gen;
+  EXPECT_THAT(SplineGate::Create(RandomSpline(gen, 16, 1, {1, 5})),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("first piece should be 0")));
+  EXPECT_THAT(SplineGate::Create(RandomSpline(gen, 16, 1, {0, 5, 5})),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("strictly increasing")));
+  EXPECT_THAT(SplineGate::Create(RandomSpline(gen, 16, 1, {0, 1 << 16})),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("between 0 and 2^log_group_size")));
+}
+
+TEST(SplineTest, CreateFailsWithTooManyCoefficients) {
+  absl::BitGen gen;
+  SplineParameters parameters = RandomSpline(gen, 16, 2, {0, 5});
+  parameters.set_degree(1);
+  EXPECT_THAT(SplineGate::Create(parameters),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("at most degree + 1 coefficients")));
+}
+
+TEST(SplineTest, CreateFailsIfDegreeIsTooLarge) {
+  absl::BitGen gen;
+  EXPECT_THAT(SplineGate::Create(
+                  RandomSpline(gen, 16, SplineGate::kMaxDegree + 1, {0})),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("degree must be at most")));
+}
+
+TEST(SplineTest, GenFailsIfMasksAreInvalid) {
+  absl::BitGen gen;
+  DPF_ASSERT_OK_AND_ASSIGN(auto gate,
+                           SplineGate::Create(RandomSpline(gen, 16, 1, {0})));
+  EXPECT_THAT(gate->Gen(0, {0}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("equal to degree + 1")));
+  EXPECT_THAT(gate->Gen(1 << 16, {0, 0}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Input mask")));
+  EXPECT_THAT(gate->Gen(0, {0, 1 << 16}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Output mask")));
+}
+
+TEST(SplineTest, BatchEvalFailsWithInvalidInputs) {
+  absl::BitGen gen;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto gate, SplineGate::Create(RandomSpline(gen, 16, 1, {0, 10})));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto other_gate,
+      SplineGate::Create(RandomSpline(gen, 16, 1, {0, 10, 20})));
+  SplineKey key, other_key;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(key, std::ignore), gate->Gen(5, {7, 9}));
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(other_key, std::ignore),
+                           other_gate->Gen(5, {7, 9}));
+
+  std::vector<SplineKey> keys = {key, key};
+  std::vector<absl::uint128> points = {5};
+  EXPECT_THAT(gate->BatchEval(keys, points),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("must have the same size")));
+  EXPECT_THAT(gate->Eval(key, 1 << 16),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Masked input")));
+  EXPECT_THAT(gate->Eval(other_key, 5),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("does not match the parameters")));
+}
+
+TEST(SplineTest, OutputsActiveCoefficientsOnSmallGroup) {
+  const int log_group_size = 6;
+  const absl::uint128 N = absl::uint128(1) << log_group_size;
+  const int degree = 2;
+  absl::BitGen gen;
+  const SplineParameters parameters =
+      RandomSpline(gen, log_group_size, degree, {0, 10, 11, 33, 63});
+  DPF_ASSERT_OK_AND_ASSIGN(auto gate, SplineGate::Create(parameters));
+
+  for (int i = 0; i < 5; ++i) {
+    const absl::uint128 r_in = RandomGroupElement(gen, log_group_size);
+    std::vector<absl::uint128> r_out(degree + 1);
+    for (absl::uint128& r : r_out) {
+      r = RandomGroupElement(gen, log_group_size);
+    }
+    DPF_ASSERT_OK_AND_ASSIGN(auto keys, gate->Gen(r_in, r_out));
+
+    // Check every input, so that all boundaries are crossed.
+    for (absl::uint128 y = 0; y < N; ++y) {
+      const absl::uint128 x = (y + r_in) % N;
+      DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> shares_0,
+                               gate->Eval(keys.first, x));
+      DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> shares_1,
+                               gate->Eval(keys.second, x));
+      ASSERT_EQ(shares_0.size(), degree + 1);
+      ASSERT_EQ(shares_1.size(), degree + 1);
+
+      // The reconstructed coefficients are those of f_i(X - r_in), so
+      // evaluating them at the masked input must yield f_i(y), for every
+      // choice of the masked input in the active piece.
+      std::vector<absl::uint128> coefficients(degree + 1);
+      for (int k = 0; k <= degree; ++k) {
+        coefficients[k] = (shares_0[k] + shares_1[k] - r_out[k]) % N;
+      }
+      const std::vector<absl::uint128> expected =
+          ActiveCoefficients(parameters, y);
+      for (absl::uint128 z : {y, (y + 1) % N, (y + 17) % N}) {
+        if (ActiveCoefficients(parameters, z) != expected) continue;
+        EXPECT_EQ(EvaluatePolynomial(coefficients, (z + r_in) % N, N),
+                  EvaluatePolynomial(expected, z, N))
+            << "r_in=" << r_in << " y=" << y << " z=" << z;
+      }
+    }
+  }
+}
+
+TEST(SplineTest, OutputsActiveCoefficientsForAllDegrees) {
+  const int log_group_size = 6;
+  const absl::uint128 N = absl::uint128(1) << log_group_size;
+  absl::BitGen gen;
+  for (int degree = 0; degree <= SplineGate::kMaxDegree; ++degree) {
+    const SplineParameters parameters =
+        RandomSpline(gen, log_group_size, degree, {0, 10, 33});
+    DPF_ASSERT_OK_AND_ASSIGN(auto gate, SplineGate::Create(parameters));
+    const absl::uint128 r_in = RandomGroupElement(gen, log_group_size);
+    std::vector<absl::uint128> r_out(degree + 1);
+    for (absl::uint128& r : r_out) {
+      r = RandomGroupElement(gen, log_group_size);
+    }
+    DPF_ASSERT_OK_AND_ASSIGN(auto keys, gate->Gen(r_in, r_out));
+
+    // All coefficients of a boundary share one DCF key.
+    EXPECT_EQ(keys.first.dcf_keys_size(), parameters.pieces_size());
+    EXPECT_EQ(keys.second.dcf_keys_size(), parameters.pieces_size());
+
+    std::vector<absl::uint128> xs;
+    for (absl::uint128 y = 0; y < N; ++y) {
+      xs.push_back((y + r_in) % N);
+    }
+    std::vector<SplineKey> keys_0(xs.size(), keys.first),
+        keys_1(xs.size(), keys.second);
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> shares_0,
+                             gate->BatchEval(keys_0, xs));
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> shares_1,
+                             gate->BatchEval(keys_1, xs));
+    ASSERT_EQ(shares_0.size(), xs.size() * (degree + 1));
+    ASSERT_EQ(shares_1.size(), xs.size() * (degree + 1));
+    for (absl::uint128 y = 0; y < N; ++y) {
+      std::vector<absl::uint128> coefficients(degree + 1);
+      for (int k = 0; k <= degree; ++k) {
+        int index = static_cast<int>(y) * (degree + 1) + k;
+        coefficients[k] = (shares_0[index] + shares_1[index] - r_out[k]) % N;
+      }
+      EXPECT_EQ(EvaluatePolynomial(coefficients, (y + r_in) % N, N),
+                EvaluatePolynomial(ActiveCoefficients(parameters, y), y, N))
+          << "degree=" << degree << " y=" << y;
+    }
+  }
+}
+
+TEST(SplineTest, OutputsActiveCoefficientsOnLargeGroup) {
+  const int log_group_size = 127;
+  const absl::uint128 N = absl::uint128(1) << log_group_size;
+  const int degree = 3;
+  absl::BitGen gen;
+  const std::vector<absl::uint128> lower_bounds = {0, 1, N / 2, N - 2};
+  const SplineParameters parameters =
+      RandomSpline(gen, log_group_size, degree, lower_bounds);
+  DPF_ASSERT_OK_AND_ASSIGN(auto gate, SplineGate::Create(parameters));
+
+  const absl::uint128 r_in = RandomGroupElement(gen, log_group_size);
+  std::vector<absl::uint128> r_out(degree + 1);
+  for (absl::uint128& r : r_out) {
+    r = RandomGroupElement(gen, log_group_size);
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(auto keys, gate->Gen(r_in, r_out));
+
+  // Inputs in the vicinity of the boundaries, and random inputs.
+  std::vector<absl::uint128> ys;
+  for (absl::uint128 p : lower_bounds) {
+    ys.push_back((p + N - 1) % N);
+    ys.push_back(p);
+    ys.push_back((p + 1) % N);
+  }
+  for (int i = 0; i < 10; ++i) {
+    ys.push_back(RandomGroupElement(gen, log_group_size));
+  }
+  std::vector<absl::uint128> xs;
+  for (absl::uint128 y : ys) {
+    xs.push_back((y + r_in) % N);
+  }
+  std::vector<SplineKey> keys_0(ys.size(), keys.first),
+      keys_1(ys.size(), keys.second);
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> shares_0,
+                           gate->BatchEval(keys_0, xs));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> shares_1,
+                           gate->BatchEval(keys_1, xs));
+  ASSERT_EQ(shares_0.size(), ys.size() * (degree + 1));
+
+  for (int i = 0; i < ys.size(); ++i) {
+    std::vector<absl::uint128> coefficients(degree + 1);
+    for (int k = 0; k <= degree; ++k) {
+      int index = i * (degree + 1) + k;
+      coefficients[k] = (shares_0[index] + shares_1[index] - r_out[k]) % N;
+    }
+    EXPECT_EQ(EvaluatePolynomial(coefficients, xs[i], N),
+              EvaluatePolynomial(ActiveCoefficients(parameters, ys[i]), ys[i],
+                                 N))
+        << "y=" << ys[i];
+  }
+}
+
+TEST(SplineTest, MasksUnshiftedCoefficientsWhenInputMaskIsZero) {
+  const int log_group_size = 32;
+  const absl::uint128 N = absl::uint128(1) << log_group_size;
+  const int degree = 2;
+  absl::BitGen gen;
+  const SplineParameters parameters =
+      RandomSpline(gen, log_group_size, degree, {0, 1000, 5000});
+  DPF_ASSERT_OK_AND_ASSIGN(auto gate, SplineGate::Create(parameters));
+  const std::vector<absl::uint128> r_out = {3, 5, 7};
+  DPF_ASSERT_OK_AND_ASSIGN(auto keys, gate->Gen(0, r_out));
+
+  for (absl::uint128 y : {0, 999, 1000, 4999, 5000, 123456}) {
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> shares_0,
+                             gate->Eval(keys.first, y));
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> shares_1,
+                             gate->Eval(keys.second, y));
+    std::vector<absl::uint128> expected = ActiveCoefficients(parameters, y);
+    for (int k = 0; k <= degree; ++k) {
+      EXPECT_EQ((shares_0[k] + shares_1[k]) % N, (expected[k] + r_out[k]) % N)
+          << "y=" << y << " k=" << k;
+    }
+  }
+}
+
+TEST(SplineTest, SinglePieceWithMissingCoefficients) {
+  const int log_group_size = 20;
+  const absl::uint128 N = absl::uint128(1) << log_group_size;
+  SplineParameters parameters;
+  parameters.set_log_group_size(log_group_size);
+  parameters.set_degree(2);
+  SplinePiece* piece = parameters.add_pieces();
+  piece->mutable_lower_bound()->set_value_uint64(0);
+  piece->add_coefficients()->set_value_uint64(42);
+  DPF_ASSERT_OK_AND_ASSIGN(auto gate, SplineGate::Create(parameters));
+  const absl::uint128 r_in = 12345;
+  const std::vector<absl::uint128> r_out = {1, 2, 3};
+  DPF_ASSERT_OK_AND_ASSIGN(auto keys, gate->Gen(r_in, r_out));
+
+  for (absl::uint128 y : {0, 1, 777, 1 << 19}) {
+    const absl::uint128 x = (y + r_in) % N;
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> shares_0,
+                             gate->Eval(keys.first, x));
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::uint128> shares_1,
+                             gate->Eval(keys.second, x));
+    EXPECT_EQ((shares_0[0] + shares_1[0]) % N, 43);
+    EXPECT_EQ((shares_0[1] + shares_1[1]) % N, 2);
+    EXPECT_EQ((shares_0[2] + shares_1[2]) % N, 3);
+  }
+}
+
+}  // namespace
+}  // namespace fss_gates
+}  // namespace distributed_point_functions
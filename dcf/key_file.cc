@@ -0,0 +1,120 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dcf/key_file.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "dcf/distributed_comparison_function.h"
+#include "dcf/distributed_comparison_function.pb.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/internal/value_type_helpers.h"
+#include "dpf/key_file.h"
+#include "dpf/status_macros.h"
+
+namespace distributed_point_functions {
+
+namespace {
+
+// Returns the parameters of the DCF whose keys are stored in a key file with
+// `dpf_parameters`, or INVALID_ARGUMENT if there is no such DCF.
+absl::StatusOr<DcfParameters> ToDcfParameters(
+    absl::Span<const DpfParameters> dpf_parameters) {
+  const absl::Status not_a_dcf = absl::InvalidArgumentError(
+      "The key file's parameters are not those of a DCF");
+  if (dpf_parameters.empty()) {
+    return not_a_dcf;
+  }
+  DcfParameters parameters;
+  parameters.mutable_parameters()->set_log_domain_size(dpf_parameters.size());
+  *(parameters.mutable_parameters()->mutable_value_type()) =
+      dpf_parameters[0].value_type();
+  for (int i = 0; i < static_cast<int>(dpf_parameters.size()); ++i) {
+    if (dpf_parameters[i].log_domain_size() != i) {
+      return not_a_dcf;
+    }
+    DPF_ASSIGN_OR_RETURN(
+        bool same_value_type,
+        dpf_internal::ValueTypesAreEqual(dpf_parameters[i].value_type(),
+                                         parameters.parameters().value_type()));
+    if (!same_value_type) {
+      return not_a_dcf;
+    }
+  }
+  return parameters;
+}
+
+}  // namespace
+
+DcfKeyFileWriter::DcfKeyFileWriter(std::unique_ptr<KeyFileWriter> writer)
+    : writer_(std::move(writer)) {}
+
+absl::StatusOr<std::unique_ptr<DcfKeyFileWriter>> DcfKeyFileWriter::Create(
+    const std::string& path, const DcfParameters& parameters, int party) {
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<DpfParameters> dpf_parameters,
+      DistributedComparisonFunction::GetDpfParameters(parameters));
+  DPF_ASSIGN_OR_RETURN(std::unique_ptr<KeyFileWriter> writer,
+                       KeyFileWriter::Create(path, dpf_parameters, party));
+  return absl::WrapUnique(new DcfKeyFileWriter(std::move(writer)));
+}
+
+absl::StatusOr<std::string> DcfKeyFileWriter::Encode(
+    absl::Span<const DcfKey> keys) const {
+  std::vector<const DpfKey*> dpf_keys(keys.size());
+  for (int64_t i = 0; i < static_cast<int64_t>(keys.size()); ++i) {
+    dpf_keys[i] = &keys[i].key();
+  }
+  return writer_->Encode(dpf_keys);
+}
+
+absl::Status DcfKeyFileWriter::Append(absl::Span<const DcfKey> keys) {
+  DPF_ASSIGN_OR_RETURN(std::string records, Encode(keys));
+  return AppendEncoded(records);
+}
+
+DcfKeyFileReader::DcfKeyFileReader(std::unique_ptr<KeyFileReader> reader,
+                                   DcfParameters parameters)
+    : reader_(std::move(reader)), parameters_(std::move(parameters)) {}
+
+absl::StatusOr<std::unique_ptr<DcfKeyFileReader>> DcfKeyFileReader::Open(
+    const std::string& path) {
+  DPF_ASSIGN_OR_RETURN(std::unique_ptr<KeyFileReader> reader,
+                       KeyFileReader::Open(path));
+  DPF_ASSIGN_OR_RETURN(DcfParameters parameters,
+                       ToDcfParameters(reader->parameters()));
+  return absl::WrapUnique(
+      new DcfKeyFileReader(std::move(reader), std::move(parameters)));
+}
+
+absl::StatusOr<std::vector<DcfKey>> DcfKeyFileReader::ReadBatch(
+    int64_t max_keys) {
+  DPF_ASSIGN_OR_RETURN(std::vector<DpfKey> dpf_keys,
+                       reader_->ReadBatch(max_keys));
+  std::vector<DcfKey> keys(dpf_keys.size());
+  for (int64_t i = 0; i < static_cast<int64_t>(keys.size()); ++i) {
+    *(keys[i].mutable_key()) = std::move(dpf_keys[i]);
+  }
+  return keys;
+}
+
+}  // namespace distributed_point_functions
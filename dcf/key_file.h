@@ -0,0 +1,113 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DCF_KEY_FILE_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DCF_KEY_FILE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "dcf/distributed_comparison_function.pb.h"
+#include "dpf/key_file.h"
+
+namespace distributed_point_functions {
+
+// Key files for DcfKeys. A DcfKey only wraps a key of the incremental DPF
+// given by `DistributedComparisonFunction::GetDpfParameters`, so DCF key files
+// are key files for that DPF (see dpf/key_file.h) storing `DcfKey::key`.
+
+// Writes DcfKeys to a key file. Not thread-safe, except for `Encode`.
+class DcfKeyFileWriter {
+ public:
+  // Creates a key file at `path` for DCF keys of `party` under `parameters`,
+  // and writes its header. Truncates any existing file.
+  //
+  // Returns INVALID_ARGUMENT if `parameters` are invalid or `party` is not 0
+  // or 1, or an error from the file system.
+  static absl::StatusOr<std::unique_ptr<DcfKeyFileWriter>> Create(
+      const std::string& path, const DcfParameters& parameters, int party);
+
+  // Encodes `keys` as consecutive key records. See `KeyFileWriter::Encode`.
+  absl::StatusOr<std::string> Encode(absl::Span<const DcfKey> keys) const;
+
+  // Appends key records returned by `Encode` to the file. See
+  // `KeyFileWriter::AppendEncoded`.
+  absl::Status AppendEncoded(absl::string_view records) {
+    return writer_->AppendEncoded(records);
+  }
+
+  // Encodes and appends `keys` to the file.
+  absl::Status Append(absl::Span<const DcfKey> keys);
+
+  // Returns the number of keys written so far.
+  int64_t num_keys() const { return writer_->num_keys(); }
+
+  // Returns the underlying writer, which accepts the DpfKeys wrapped by
+  // DcfKeys.
+  KeyFileWriter& dpf_key_writer() { return *writer_; }
+
+ private:
+  explicit DcfKeyFileWriter(std::unique_ptr<KeyFileWriter> writer);
+
+  std::unique_ptr<KeyFileWriter> writer_;
+};
+
+// Reads batches of DcfKeys from a key file written by DcfKeyFileWriter. Not
+// thread-safe.
+class DcfKeyFileReader {
+ public:
+  // Opens the key file at `path` and reads its header.
+  //
+  // Returns INVALID_ARGUMENT if the file is not a valid key file, or if its
+  // parameters are not those of a DCF, or an error from the file system.
+  static absl::StatusOr<std::unique_ptr<DcfKeyFileReader>> Open(
+      const std::string& path);
+
+  // Returns the parameters of all keys in the file.
+  const DcfParameters& parameters() const { return parameters_; }
+
+  // Returns the party of all keys in the file.
+  int party() const { return reader_->party(); }
+
+  // Returns the total number of keys in the file.
+  int64_t num_keys() const { return reader_->num_keys(); }
+
+  // Returns the index of the next key returned by `ReadBatch`.
+  int64_t position() const { return reader_->position(); }
+
+  // Reads up to `max_keys` keys starting at `position()`, and advances
+  // `position()` past them. Returns an empty vector at the end of the file.
+  //
+  // Returns INVALID_ARGUMENT if `max_keys` is not positive.
+  absl::StatusOr<std::vector<DcfKey>> ReadBatch(int64_t max_keys);
+
+ private:
+  DcfKeyFileReader(std::unique_ptr<KeyFileReader> reader,
+                   DcfParameters parameters);
+
+  std::unique_ptr<KeyFileReader> reader_;
+  DcfParameters parameters_;
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DCF_KEY_FILE_H_
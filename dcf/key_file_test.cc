@@ -0,0 +1,152 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dcf/key_file.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "dcf/distributed_comparison_function.h"
+#include "dcf/distributed_comparison_function.pb.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/internal/status_matchers.h"
+#include "dpf/key_file.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::StatusIs;
+using ::testing::HasSubstr;
+using ::testing::SizeIs;
+
+constexpr int kLogDomainSize = 10;
+constexpr int kNumKeys = 13;
+
+std::string TestPath(absl::string_view name) {
+  return absl::StrCat(::testing::TempDir(), "/", name);
+}
+
+class DcfKeyFileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    parameters_.mutable_parameters()->set_log_domain_size(kLogDomainSize);
+    *(parameters_.mutable_parameters()->mutable_value_type()) =
+        ToValueType<uint32_t>();
+    DPF_ASSERT_OK_AND_ASSIGN(
+        dcf_, DistributedComparisonFunction::Create(parameters_));
+    for (int i = 0; i < kNumKeys; ++i) {
+      DPF_ASSERT_OK_AND_ASSIGN(
+          auto keys,
+          dcf_->GenerateKeys(Alpha(i), static_cast<uint32_t>(i + 1)));
+      keys_[0].push_back(std::move(keys.first));
+      keys_[1].push_back(std::move(keys.second));
+    }
+  }
+
+  static absl::uint128 Alpha(int i) { return 71 * i + 5; }
+
+  DcfParameters parameters_;
+  std::unique_ptr<DistributedComparisonFunction> dcf_;
+  std::vector<DcfKey> keys_[2];
+};
+
+TEST_F(DcfKeyFileTest, RoundTripPreservesKeys) {
+  for (int party = 0; party < 2; ++party) {
+    std::string path = TestPath(absl::StrCat("dcf_round_trip_", party));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<DcfKeyFileWriter> writer,
+        DcfKeyFileWriter::Create(path, parameters_, party));
+    DPF_ASSERT_OK(writer->Append(keys_[party]));
+    EXPECT_EQ(writer->num_keys(), kNumKeys);
+    writer.reset();
+
+    DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<DcfKeyFileReader> reader,
+                             DcfKeyFileReader::Open(path));
+    EXPECT_EQ(reader->party(), party);
+    EXPECT_EQ(reader->num_keys(), kNumKeys);
+    EXPECT_EQ(reader->parameters().SerializeAsString(),
+              parameters_.SerializeAsString());
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<DcfKey> keys,
+                             reader->ReadBatch(2 * kNumKeys));
+    ASSERT_THAT(keys, SizeIs(kNumKeys));
+    for (int i = 0; i < kNumKeys; ++i) {
+      EXPECT_EQ(keys[i].SerializeAsString(),
+                keys_[party][i].SerializeAsString())
+          << "party " << party << ", key " << i;
+    }
+  }
+}
+
+TEST_F(DcfKeyFileTest, DecodedKeysEvaluateCorrectly) {
+  std::unique_ptr<DcfKeyFileReader> readers[2];
+  for (int party = 0; party < 2; ++party) {
+    std::string path = TestPath(absl::StrCat("dcf_evaluate_", party));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<DcfKeyFileWriter> writer,
+        DcfKeyFileWriter::Create(path, parameters_, party));
+    DPF_ASSERT_OK(writer->Append(keys_[party]));
+    writer.reset();
+    DPF_ASSERT_OK_AND_ASSIGN(readers[party], DcfKeyFileReader::Open(path));
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<DcfKey> keys_0,
+                           readers[0]->ReadBatch(kNumKeys));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<DcfKey> keys_1,
+                           readers[1]->ReadBatch(kNumKeys));
+  for (int i = 0; i < kNumKeys; ++i) {
+    for (absl::uint128 x : {Alpha(i) - 1, Alpha(i)}) {
+      DPF_ASSERT_OK_AND_ASSIGN(uint32_t result_0,
+                               dcf_->Evaluate<uint32_t>(keys_0[i], x));
+      DPF_ASSERT_OK_AND_ASSIGN(uint32_t result_1,
+                               dcf_->Evaluate<uint32_t>(keys_1[i], x));
+      EXPECT_EQ(static_cast<uint32_t>(result_0 + result_1),
+                x < Alpha(i) ? i + 1 : 0)
+          << "key " << i << ", x = " << x;
+    }
+  }
+}
+
+TEST_F(DcfKeyFileTest, CreateFailsForInvalidParameters) {
+  parameters_.mutable_parameters()->set_log_domain_size(0);
+  EXPECT_THAT(DcfKeyFileWriter::Create(TestPath("dcf_invalid"), parameters_, 0),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("log_domain_size")));
+}
+
+TEST_F(DcfKeyFileTest, OpenFailsForDpfKeyFile) {
+  std::vector<DpfParameters> dpf_parameters(2);
+  dpf_parameters[0].set_log_domain_size(4);
+  dpf_parameters[1].set_log_domain_size(10);
+  for (DpfParameters& p : dpf_parameters) {
+    *(p.mutable_value_type()) = ToValueType<uint32_t>();
+  }
+  std::string path = TestPath("dcf_not_a_dcf");
+  DPF_ASSERT_OK(KeyFileWriter::Create(path, dpf_parameters, 0).status());
+
+  EXPECT_THAT(DcfKeyFileReader::Open(path),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not those of a DCF")));
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
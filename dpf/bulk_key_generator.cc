@@ -0,0 +1,234 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/bulk_key_generator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/key_file.h"
+#include "dpf/status_macros.h"
+
+namespace distributed_point_functions {
+
+namespace {
+
+// The inputs of one round, and the encoded keys generated from them by each
+// thread.
+struct Round {
+  std::vector<KeyGenerationInput> inputs;
+  std::vector<std::string> records_0;
+  std::vector<std::string> records_1;
+  std::vector<absl::Status> statuses;
+};
+
+// Generates keys for `inputs` and encodes them into `records_0` and
+// `records_1`. `first_input` is only used for error messages.
+absl::Status GenerateBatch(KeyPairGenerator generate_keys,
+                           absl::Span<const KeyGenerationInput> inputs,
+                           int64_t first_input, const KeyFileWriter& writer_0,
+                           const KeyFileWriter& writer_1,
+                           std::string& records_0, std::string& records_1) {
+  std::vector<DpfKey> keys_0, keys_1;
+  keys_0.reserve(inputs.size());
+  keys_1.reserve(inputs.size());
+  for (int64_t i = 0; i < static_cast<int64_t>(inputs.size()); ++i) {
+    absl::StatusOr<std::pair<DpfKey, DpfKey>> keys = generate_keys(inputs[i]);
+    if (!keys.ok()) {
+      return absl::Status(keys.status().code(),
+                          absl::StrCat("Input ", first_input + i, ": ",
+                                       keys.status().message()));
+    }
+    keys_0.push_back(std::move(keys->first));
+    keys_1.push_back(std::move(keys->second));
+  }
+  DPF_ASSIGN_OR_RETURN(records_0, writer_0.Encode(keys_0));
+  DPF_ASSIGN_OR_RETURN(records_1, writer_1.Encode(keys_1));
+  return absl::OkStatus();
+}
+
+// Appends the keys of `round` to the writers, in order.
+absl::Status WriteRound(const Round& round, KeyFileWriter& writer_0,
+                        KeyFileWriter& writer_1) {
+  for (int t = 0; t < static_cast<int>(round.records_0.size()); ++t) {
+    DPF_RETURN_IF_ERROR(writer_0.AppendEncoded(round.records_0[t]));
+    DPF_RETURN_IF_ERROR(writer_1.AppendEncoded(round.records_1[t]));
+  }
+  return absl::OkStatus();
+}
+
+// Threads running `generate_batch(t)` for the t-th batch of each round. The
+// threads are started once and reused for all rounds.
+class BatchWorkers {
+ public:
+  BatchWorkers(int num_threads, absl::FunctionRef<void(int)> generate_batch)
+      : generate_batch_(generate_batch) {
+    threads_.reserve(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+      threads_.emplace_back([this, t] { Run(t); });
+    }
+  }
+
+  ~BatchWorkers() {
+    {
+      absl::MutexLock lock(&mu_);
+      stopped_ = true;
+    }
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  // Starts generating batches 0 to `num_batches - 1` of the next round, where
+  // `num_batches` must be at most the number of threads.
+  void StartRound(int num_batches) {
+    absl::MutexLock lock(&mu_);
+    ++round_;
+    num_batches_ = num_batches;
+    remaining_batches_ = num_batches;
+  }
+
+  // Waits until all batches of the current round have been generated.
+  void WaitForRound() {
+    absl::MutexLock lock(&mu_);
+    mu_.Await(absl::Condition(this, &BatchWorkers::IsRoundDone));
+  }
+
+ private:
+  bool IsRoundDone() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return remaining_batches_ == 0;
+  }
+
+  void Run(int t) {
+    int64_t last_round = 0;
+    while (true) {
+      {
+        absl::MutexLock lock(&mu_);
+        auto has_new_round = [this, last_round]()
+                                 ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+          return stopped_ || round_ != last_round;
+        };
+        mu_.Await(absl::Condition(&has_new_round));
+        if (stopped_) {
+          return;
+        }
+        last_round = round_;
+        if (t >= num_batches_) {
+          continue;
+        }
+      }
+      generate_batch_(t);
+      absl::MutexLock lock(&mu_);
+      --remaining_batches_;
+    }
+  }
+
+  const absl::FunctionRef<void(int)> generate_batch_;
+  absl::Mutex mu_;
+  int64_t round_ ABSL_GUARDED_BY(mu_) = 0;
+  int num_batches_ ABSL_GUARDED_BY(mu_) = 0;
+  int remaining_batches_ ABSL_GUARDED_BY(mu_) = 0;
+  bool stopped_ ABSL_GUARDED_BY(mu_) = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace
+
+absl::StatusOr<int64_t> GenerateKeysToFiles(
+    DistributedPointFunction& dpf, KeyGenerationInputSource next_input,
+    KeyFileWriter& writer_0, KeyFileWriter& writer_1,
+    const BulkKeyGenerationOptions& options) {
+  return GenerateKeysToFiles(
+      [&dpf](const KeyGenerationInput& input) {
+        return dpf.GenerateKeysIncremental(input.alpha, input.beta);
+      },
+      next_input, writer_0, writer_1, options);
+}
+
+absl::StatusOr<int64_t> GenerateKeysToFiles(
+    KeyPairGenerator generate_keys, KeyGenerationInputSource next_input,
+    KeyFileWriter& writer_0, KeyFileWriter& writer_1,
+    const BulkKeyGenerationOptions& options) {
+  if (options.num_threads <= 0) {
+    return absl::InvalidArgumentError("`num_threads` must be positive");
+  }
+  if (options.batch_size <= 0) {
+    return absl::InvalidArgumentError("`batch_size` must be positive");
+  }
+  const int64_t round_size =
+      static_cast<int64_t>(options.num_threads) * options.batch_size;
+
+  // Keys of round r are generated while the keys of round r - 1 are written.
+  Round current, previous;
+  int64_t num_inputs = 0;
+  auto generate_batch = [&](int t) {
+    const int64_t begin = t * static_cast<int64_t>(options.batch_size);
+    const int64_t end = std::min<int64_t>(begin + options.batch_size,
+                                          current.inputs.size());
+    current.statuses[t] = GenerateBatch(
+        generate_keys,
+        absl::MakeConstSpan(current.inputs).subspan(begin, end - begin),
+        num_inputs + begin, writer_0, writer_1, current.records_0[t],
+        current.records_1[t]);
+  };
+  BatchWorkers workers(options.num_threads, generate_batch);
+  bool end_of_input = false;
+  while (true) {
+    current.inputs.clear();
+    while (!end_of_input &&
+           static_cast<int64_t>(current.inputs.size()) < round_size) {
+      DPF_ASSIGN_OR_RETURN(bool has_input,
+                           next_input(current.inputs.emplace_back()));
+      if (!has_input) {
+        current.inputs.pop_back();
+        end_of_input = true;
+      }
+    }
+
+    const int64_t round_inputs = current.inputs.size();
+    const int num_batches = static_cast<int>(
+        (round_inputs + options.batch_size - 1) / options.batch_size);
+    current.records_0.assign(num_batches, std::string());
+    current.records_1.assign(num_batches, std::string());
+    current.statuses.assign(num_batches, absl::OkStatus());
+    workers.StartRound(num_batches);
+    absl::Status write_status = WriteRound(previous, writer_0, writer_1);
+    workers.WaitForRound();
+    DPF_RETURN_IF_ERROR(write_status);
+    for (const absl::Status& status : current.statuses) {
+      DPF_RETURN_IF_ERROR(status);
+    }
+    num_inputs += round_inputs;
+    if (round_inputs == 0) {
+      break;
+    }
+    std::swap(current, previous);
+  }
+  return num_inputs;
+}
+
+}  // namespace distributed_point_functions
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_BULK_KEY_GENERATOR_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DPF_BULK_KEY_GENERATOR_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/numeric/int128.h"
+#include "absl/status/statusor.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/key_file.h"
+
+namespace distributed_point_functions {
+
+// Input for generating a single pair of keys with
+// `DistributedPointFunction::GenerateKeysIncremental`.
+struct KeyGenerationInput {
+  absl::uint128 alpha = 0;
+  std::vector<Value> beta;
+};
+
+struct BulkKeyGenerationOptions {
+  // Number of threads generating keys. The threads are started once and reused
+  // for all rounds. The calling thread writes the keys generated in the
+  // previous round in the meantime.
+  int num_threads = 1;
+
+  // Number of key pairs each thread generates per round. Each round holds
+  // `num_threads * batch_size` inputs and keys in memory.
+  int batch_size = 1024;
+};
+
+// Function type for reading inputs. Fills `input` with the next input and
+// returns true, or returns false at the end of the input. Returning an error
+// aborts key generation.
+using KeyGenerationInputSource =
+    absl::FunctionRef<absl::StatusOr<bool>(KeyGenerationInput& input)>;
+
+// Function type for generating a single pair of keys from `input`. Called
+// concurrently from `BulkKeyGenerationOptions::num_threads` threads.
+using KeyPairGenerator =
+    absl::FunctionRef<absl::StatusOr<std::pair<DpfKey, DpfKey>>(
+        const KeyGenerationInput& input)>;
+
+// Generates a pair of keys with `dpf` for each input read from `next_input`,
+// and appends the keys of party 0 to `writer_0` and the keys of party 1 to
+// `writer_1`. Keys are generated on `options.num_threads` threads, but written
+// in the order of the inputs, so the i-th keys in both files form a pair.
+// `RegisterValueType` must not be called on `dpf` concurrently.
+//
+// Returns the number of key pairs written, INVALID_ARGUMENT if any input is
+// invalid for `dpf` or `options` are invalid, or the first error returned by
+// `next_input` or the writers. On error, the files may contain keys for a
+// prefix of the inputs.
+absl::StatusOr<int64_t> GenerateKeysToFiles(
+    DistributedPointFunction& dpf, KeyGenerationInputSource next_input,
+    KeyFileWriter& writer_0, KeyFileWriter& writer_1,
+    const BulkKeyGenerationOptions& options = {});
+
+// As above, but generates each pair of keys with `generate_keys`. Used for
+// keys that wrap a DpfKey, such as DcfKeys (see dcf/bulk_key_generator.h).
+absl::StatusOr<int64_t> GenerateKeysToFiles(
+    KeyPairGenerator generate_keys, KeyGenerationInputSource next_input,
+    KeyFileWriter& writer_0, KeyFileWriter& writer_1,
+    const BulkKeyGenerationOptions& options = {});
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DPF_BULK_KEY_GENERATOR_H_
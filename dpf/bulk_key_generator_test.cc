@@ -0,0 +1,182 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/bulk_key_generator.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/internal/status_matchers.h"
+#include "dpf/key_file.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::IsOkAndHolds;
+using dpf_internal::StatusIs;
+using ::testing::HasSubstr;
+
+constexpr int kLogDomainSizes[] = {8, 20};
+
+class BulkKeyGeneratorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (int log_domain_size : kLogDomainSizes) {
+      DpfParameters& p = parameters_.emplace_back();
+      p.set_log_domain_size(log_domain_size);
+      *(p.mutable_value_type()) = ToValueType<uint64_t>();
+    }
+    DPF_ASSERT_OK_AND_ASSIGN(
+        dpf_, DistributedPointFunction::CreateIncremental(parameters_));
+    for (int party = 0; party < 2; ++party) {
+      paths_[party] = absl::StrCat(::testing::TempDir(), "/bulk_keys_", party);
+      DPF_ASSERT_OK_AND_ASSIGN(
+          writers_[party],
+          KeyFileWriter::Create(paths_[party], parameters_, party));
+    }
+  }
+
+  // Returns an input source producing `num_inputs` inputs, where the i-th
+  // input has alpha = 7919 * i and beta = {i, i + 1}.
+  static auto Inputs(int num_inputs) {
+    return [num_inputs, next = std::make_shared<int>(0)](
+               KeyGenerationInput& input) -> absl::StatusOr<bool> {
+      int i = (*next)++;
+      if (i >= num_inputs) {
+        return false;
+      }
+      input.alpha = Alpha(i);
+      input.beta = {ToValue<uint64_t>(i), ToValue<uint64_t>(i + 1)};
+      return true;
+    };
+  }
+
+  static absl::uint128 Alpha(int i) {
+    return (absl::uint128{7919} * i) % (uint64_t{1} << kLogDomainSizes[1]);
+  }
+
+  std::vector<DpfParameters> parameters_;
+  std::unique_ptr<DistributedPointFunction> dpf_;
+  std::string paths_[2];
+  std::unique_ptr<KeyFileWriter> writers_[2];
+};
+
+TEST_F(BulkKeyGeneratorTest, GeneratesKeysInInputOrder) {
+  constexpr int kNumInputs = 1000;
+  EXPECT_THAT(GenerateKeysToFiles(*dpf_, Inputs(kNumInputs), *writers_[0],
+                                  *writers_[1],
+                                  {.num_threads = 4, .batch_size = 7}),
+              IsOkAndHolds(kNumInputs));
+  writers_[0].reset();
+  writers_[1].reset();
+
+  std::unique_ptr<KeyFileReader> readers[2];
+  for (int party = 0; party < 2; ++party) {
+    DPF_ASSERT_OK_AND_ASSIGN(readers[party],
+                             KeyFileReader::Open(paths_[party]));
+    EXPECT_EQ(readers[party]->party(), party);
+    EXPECT_EQ(readers[party]->num_keys(), kNumInputs);
+  }
+  int i = 0;
+  while (true) {
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<DpfKey> keys_0,
+                             readers[0]->ReadBatch(64));
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<DpfKey> keys_1,
+                             readers[1]->ReadBatch(64));
+    ASSERT_EQ(keys_0.size(), keys_1.size());
+    if (keys_0.empty()) {
+      break;
+    }
+    for (int j = 0; j < static_cast<int>(keys_0.size()); ++j, ++i) {
+      for (int level = 0; level < 2; ++level) {
+        absl::uint128 alpha_prefix =
+            Alpha(i) >> (kLogDomainSizes[1] - kLogDomainSizes[level]);
+        std::vector<absl::uint128> points = {alpha_prefix, alpha_prefix ^ 1};
+        DPF_ASSERT_OK_AND_ASSIGN(
+            std::vector<uint64_t> result_0,
+            dpf_->EvaluateAt<uint64_t>(keys_0[j], level, points));
+        DPF_ASSERT_OK_AND_ASSIGN(
+            std::vector<uint64_t> result_1,
+            dpf_->EvaluateAt<uint64_t>(keys_1[j], level, points));
+        EXPECT_EQ(result_0[0] + result_1[0], i + level) << "key " << i;
+        EXPECT_EQ(result_0[1] + result_1[1], 0) << "key " << i;
+      }
+    }
+  }
+  EXPECT_EQ(i, kNumInputs);
+}
+
+TEST_F(BulkKeyGeneratorTest, SucceedsWithoutInputs) {
+  EXPECT_THAT(GenerateKeysToFiles(*dpf_, Inputs(0), *writers_[0],
+                                  *writers_[1]),
+              IsOkAndHolds(0));
+  EXPECT_EQ(writers_[0]->num_keys(), 0);
+  EXPECT_EQ(writers_[1]->num_keys(), 0);
+}
+
+TEST_F(BulkKeyGeneratorTest, FailsForInvalidOptions) {
+  EXPECT_THAT(GenerateKeysToFiles(*dpf_, Inputs(1), *writers_[0],
+                                  *writers_[1], {.num_threads = 0}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`num_threads` must be positive"));
+  EXPECT_THAT(GenerateKeysToFiles(*dpf_, Inputs(1), *writers_[0],
+                                  *writers_[1], {.batch_size = 0}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`batch_size` must be positive"));
+}
+
+TEST_F(BulkKeyGeneratorTest, FailsForInvalidInput) {
+  auto inputs = Inputs(100);
+  int i = 0;
+  auto next_input = [&](KeyGenerationInput& input) -> absl::StatusOr<bool> {
+    absl::StatusOr<bool> result = inputs(input);
+    if (i++ == 42) {
+      input.alpha = absl::uint128{1} << kLogDomainSizes[1];
+    }
+    return result;
+  };
+  EXPECT_THAT(GenerateKeysToFiles(*dpf_, next_input, *writers_[0],
+                                  *writers_[1],
+                                  {.num_threads = 3, .batch_size = 5}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Input 42:")));
+}
+
+TEST_F(BulkKeyGeneratorTest, PropagatesInputSourceErrors) {
+  int i = 0;
+  auto next_input = [&](KeyGenerationInput& input) -> absl::StatusOr<bool> {
+    if (i == 10) {
+      return absl::DataLossError("Corrupted input");
+    }
+    input.alpha = i++;
+    input.beta = {ToValue<uint64_t>(1), ToValue<uint64_t>(1)};
+    return true;
+  };
+  EXPECT_THAT(GenerateKeysToFiles(*dpf_, next_input, *writers_[0],
+                                  *writers_[1], {.batch_size = 4}),
+              StatusIs(absl::StatusCode::kDataLoss, "Corrupted input"));
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
@@ -24,6 +24,8 @@
 #include <utility>
 #include <vector>
 
+#include "absl/base/attributes.h"
+#include "absl/base/const_init.h"
 #include "absl/container/btree_map.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/inlined_vector.h"
@@ -35,6 +37,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "dpf/internal/evaluate_prg_hwy.h"
 #include "dpf/internal/get_hwy_mode.h"
@@ -61,24 +64,64 @@ constexpr absl::uint128 kPrgKeyRight =
 constexpr absl::uint128 kPrgKeyValue =
     absl::MakeUint128(0x05a5d1588c5423e3ULL, 0x46a31101b21d1c98ULL);
 
+// Maximum number of parameter sets for which validated parameters are cached.
+constexpr size_t kMaxCachedParameterStates = 1024;
+
+// Guards the state shared between DistributedPointFunction instances.
+ABSL_CONST_INIT absl::Mutex shared_state_mutex(absl::kConstInit);
+
+// Deterministically serializes `parameters` into a string that can be used as
+// a map key. Each message is prefixed by its length.
+//
+// Returns INTERNAL in case serialization fails.
+absl::StatusOr<std::string> SerializeParametersDeterministically(
+    absl::Span<const DpfParameters> parameters) {
+  std::string serialized_parameters;
+  {  // Start new block so that stream destructors are run before returning.
+    ::google::protobuf::io::StringOutputStream string_stream(
+        &serialized_parameters);
+    ::google::protobuf::io::CodedOutputStream coded_stream(&string_stream);
+    coded_stream.SetSerializationDeterministic(true);
+    for (const DpfParameters& parameter : parameters) {
+      coded_stream.WriteVarint64(parameter.ByteSizeLong());
+      if (!parameter.SerializeToCodedStream(&coded_stream)) {
+        return absl::InternalError("Serializing parameters to string failed");
+      }
+    }
+  }
+  return serialized_parameters;
+}
+
 }  // namespace
 
+struct DistributedPointFunction::GlobalState {
+  Aes128FixedKeyHash prg_left;
+  Aes128FixedKeyHash prg_right;
+  Aes128FixedKeyHash prg_value;
+  absl::flat_hash_map<std::string, ValueCorrectionFunction>
+      value_correction_functions;
+};
+
+struct DistributedPointFunction::ParameterState {
+  std::unique_ptr<dpf_internal::ProtoValidator> proto_validator;
+  std::vector<int> blocks_needed;
+};
+
 DistributedPointFunction::DistributedPointFunction(
-    std::unique_ptr<dpf_internal::ProtoValidator> proto_validator,
-    std::vector<int> blocks_needed, Aes128FixedKeyHash prg_left,
-    Aes128FixedKeyHash prg_right, Aes128FixedKeyHash prg_value,
-    absl::flat_hash_map<std::string, ValueCorrectionFunction>
-        value_correction_functions)
-    : proto_validator_(std::move(proto_validator)),
+    const GlobalState& global_state,
+    std::shared_ptr<const ParameterState> parameter_state)
+    : parameter_state_(std::move(parameter_state)),
+      proto_validator_(parameter_state_->proto_validator.get()),
       parameters_(proto_validator_->parameters()),
       tree_levels_needed_(proto_validator_->tree_levels_needed()),
       tree_to_hierarchy_(proto_validator_->tree_to_hierarchy()),
       hierarchy_to_tree_(proto_validator_->hierarchy_to_tree()),
-      blocks_needed_(std::move(blocks_needed)),
-      prg_left_(std::move(prg_left)),
-      prg_right_(std::move(prg_right)),
-      prg_value_(std::move(prg_value)),
-      value_correction_functions_(value_correction_functions) {}
+      blocks_needed_(parameter_state_->blocks_needed),
+      prg_left_(global_state.prg_left),
+      prg_right_(global_state.prg_right),
+      prg_value_(global_state.prg_value),
+      default_value_correction_functions_(
+          global_state.value_correction_functions) {}
 
 absl::StatusOr<std::vector<Value>>
 DistributedPointFunction::ComputeValueCorrection(
@@ -240,9 +283,27 @@ int DistributedPointFunction::DomainToBlockIndex(absl::uint128 domain_index,
                           ((absl::uint128{1} << block_index_bits) - 1));
 }
 
-absl::Status DistributedPointFunction::EvaluateSeeds(
+uint64_t DistributedPointFunction::DomainToTreeIndex(
+    uint64_t domain_index, int hierarchy_level) const {
+  int block_index_bits = parameters_[hierarchy_level].log_domain_size() -
+                         hierarchy_to_tree_[hierarchy_level];
+  ABSL_DCHECK_LT(block_index_bits, 64);
+  return domain_index >> block_index_bits;
+}
+
+int DistributedPointFunction::DomainToBlockIndex(uint64_t domain_index,
+                                                 int hierarchy_level) const {
+  int block_index_bits = parameters_[hierarchy_level].log_domain_size() -
+                         hierarchy_to_tree_[hierarchy_level];
+  ABSL_DCHECK_LT(block_index_bits, 64);
+  return static_cast<int>(domain_index &
+                          ((uint64_t{1} << block_index_bits) - 1));
+}
+
+template <typename PathType>
+absl::Status DistributedPointFunction::EvaluateSeedsImpl(
     absl::Span<const absl::uint128> seeds, absl::Span<const bool> control_bits,
-    absl::Span<const absl::uint128> paths,
+    absl::Span<const PathType> paths,
     absl::Span<const CorrectionWord* const> correction_words,
     absl::Span<absl::uint128> seeds_out,
     absl::Span<bool> control_bits_out) const {
@@ -288,6 +349,26 @@ absl::Status DistributedPointFunction::EvaluateSeeds(
   return absl::OkStatus();
 }
 
+absl::Status DistributedPointFunction::EvaluateSeeds(
+    absl::Span<const absl::uint128> seeds, absl::Span<const bool> control_bits,
+    absl::Span<const absl::uint128> paths,
+    absl::Span<const CorrectionWord* const> correction_words,
+    absl::Span<absl::uint128> seeds_out,
+    absl::Span<bool> control_bits_out) const {
+  return EvaluateSeedsImpl(seeds, control_bits, paths, correction_words,
+                           seeds_out, control_bits_out);
+}
+
+absl::Status DistributedPointFunction::EvaluateSeeds(
+    absl::Span<const absl::uint128> seeds, absl::Span<const bool> control_bits,
+    absl::Span<const uint64_t> paths,
+    absl::Span<const CorrectionWord* const> correction_words,
+    absl::Span<absl::uint128> seeds_out,
+    absl::Span<bool> control_bits_out) const {
+  return EvaluateSeedsImpl(seeds, control_bits, paths, correction_words,
+                           seeds_out, control_bits_out);
+}
+
 absl::StatusOr<DistributedPointFunction::DpfExpansion>
 DistributedPointFunction::ExpandSeeds(
     const DpfExpansion& partial_evaluations,
@@ -374,6 +455,147 @@ DistributedPointFunction::ExpandSeeds(
   return expansion;
 }
 
+absl::StatusOr<DistributedPointFunction::DpfExpansion>
+DistributedPointFunction::ExpandKeys(
+    dpf_internal::MaybeDerefSpan<const DpfKey> keys, int64_t first_key,
+    int64_t num_keys, int num_expansions, int64_t leaves_per_key) const {
+  // Check that the output size fits in a size_t. This should already be checked
+  // by the caller, so using ABSL_DCHECK here is enough.
+  ABSL_DCHECK_GE(leaves_per_key, 1);
+  ABSL_DCHECK(num_expansions >= 63 ||
+              leaves_per_key <= (int64_t{1} << num_expansions));
+  ABSL_DCHECK_LE(first_key + num_keys, static_cast<int64_t>(keys.size()));
+  absl::uint128 output_size_128 =
+      absl::uint128{static_cast<uint64_t>(num_keys)} *
+      static_cast<uint64_t>(leaves_per_key);
+  ABSL_DCHECK_LE(output_size_128, std::numeric_limits<size_t>::max() / 2);
+  size_t output_size = static_cast<size_t>(output_size_128);
+
+  // Returns the number of nodes of each key at tree level `level` whose
+  // subtrees contain one of the first `leaves_per_key` leaves.
+  auto nodes_per_key = [num_expansions, leaves_per_key](int level) {
+    const int shift = num_expansions - level;
+    return shift >= 63 ? int64_t{1} : ((leaves_per_key - 1) >> shift) + 1;
+  };
+
+  int64_t max_batch_size = Aes128FixedKeyHash::kBatchSize;
+  std::vector<absl::uint128> prg_buffer_left(max_batch_size),
+      prg_buffer_right(max_batch_size);
+
+  // Extract the correction words of all keys up front, so that the inner loop
+  // below doesn't have to access protos.
+  std::vector<absl::uint128> correction_seeds(num_expansions * num_keys);
+  BitVector correction_controls_left(num_expansions * num_keys),
+      correction_controls_right(num_expansions * num_keys);
+  for (int level = 0; level < num_expansions; ++level) {
+    for (int64_t i = 0; i < num_keys; ++i) {
+      const CorrectionWord& correction_word =
+          keys[first_key + i].correction_words(level);
+      const int64_t index = level * num_keys + i;
+      correction_seeds[index] = absl::MakeUint128(
+          correction_word.seed().high(), correction_word.seed().low());
+      correction_controls_left[index] = correction_word.control_left();
+      correction_controls_right[index] = correction_word.control_right();
+    }
+  }
+
+  // Initialize the roots of all trees. Seeds are stored key-major, i.e., the
+  // nodes of key i at tree level l are at positions [i * n_l, (i + 1) * n_l),
+  // where n_l = nodes_per_key(l). Since the children of node j are 2j and
+  // 2j + 1, expanding all nodes in order keeps this layout at the next level.
+  DpfExpansion expansion;
+  expansion.seeds = hwy::AllocateAligned<absl::uint128>(output_size);
+  if (expansion.seeds == nullptr) {
+    return absl::ResourceExhaustedError("Memory allocation error");
+  }
+  expansion.control_bits.reserve(output_size);
+  for (int64_t i = 0; i < num_keys; ++i) {
+    const DpfKey& key = keys[first_key + i];
+    expansion.seeds[i] = absl::MakeUint128(key.seed().high(), key.seed().low());
+    expansion.control_bits.push_back(static_cast<bool>(key.party()));
+  }
+  DpfExpansion next_level_expansion;
+  next_level_expansion.seeds = hwy::AllocateAligned<absl::uint128>(output_size);
+  if (next_level_expansion.seeds == nullptr) {
+    return absl::ResourceExhaustedError("Memory allocation error");
+  }
+  next_level_expansion.control_bits.reserve(output_size);
+
+  // Same as `ExpandSeeds`, except that each PRG batch may contain nodes of
+  // different keys, so the correction word is looked up per node. This keeps
+  // the AES pipeline full even at the top levels of the trees, where each key
+  // only has a few nodes. If `nodes_per_key` is odd at the next level, the
+  // right child of the last node of each key is dropped.
+  int64_t current_level_size = num_keys;
+  int64_t current_nodes_per_key = 1;
+  for (int level = 0; level < num_expansions; ++level) {
+    const int64_t next_nodes_per_key = nodes_per_key(level + 1);
+    next_level_expansion.control_bits.resize(0);
+    // Key and node index within that key of the next node to expand.
+    int64_t key_index = 0, node_index = 0;
+    for (int64_t start_block = 0; start_block < current_level_size;
+         start_block += max_batch_size) {
+      int64_t batch_size =
+          std::min<int64_t>(current_level_size - start_block, max_batch_size);
+      DPF_RETURN_IF_ERROR(prg_left_.Evaluate(
+          absl::MakeConstSpan(expansion.seeds.get() + start_block, batch_size),
+          absl::MakeSpan(prg_buffer_left).subspan(0, batch_size)));
+      DPF_RETURN_IF_ERROR(prg_right_.Evaluate(
+          absl::MakeConstSpan(expansion.seeds.get() + start_block, batch_size),
+          absl::MakeSpan(prg_buffer_right).subspan(0, batch_size)));
+
+      // Merge results into next level of seeds and perform correction.
+      for (int64_t j = 0; j < batch_size; ++j) {
+        const int64_t index_expanded =
+            key_index * next_nodes_per_key + 2 * node_index;
+        const bool has_right_child = 2 * node_index + 1 < next_nodes_per_key;
+        const int64_t correction_index = level * num_keys + key_index;
+        const bool control_bit = expansion.control_bits[start_block + j];
+        if (control_bit) {
+          prg_buffer_left[j] ^= correction_seeds[correction_index];
+          prg_buffer_right[j] ^= correction_seeds[correction_index];
+        }
+        next_level_expansion.seeds[index_expanded] = prg_buffer_left[j];
+        next_level_expansion.control_bits.push_back(
+            dpf_internal::ExtractAndClearLowestBit(
+                next_level_expansion.seeds[index_expanded]));
+        if (control_bit) {
+          next_level_expansion.control_bits[index_expanded] ^=
+              correction_controls_left[correction_index];
+        }
+        if (has_right_child) {
+          next_level_expansion.seeds[index_expanded + 1] = prg_buffer_right[j];
+          next_level_expansion.control_bits.push_back(
+              dpf_internal::ExtractAndClearLowestBit(
+                  next_level_expansion.seeds[index_expanded + 1]));
+          if (control_bit) {
+            next_level_expansion.control_bits[index_expanded + 1] ^=
+                correction_controls_right[correction_index];
+          }
+        }
+        if (++node_index == current_nodes_per_key) {
+          node_index = 0;
+          ++key_index;
+        }
+      }
+    }
+    std::swap(expansion, next_level_expansion);
+    current_nodes_per_key = next_nodes_per_key;
+    current_level_size = num_keys * next_nodes_per_key;
+  }
+  return expansion;
+}
+
+absl::StatusOr<DistributedPointFunction::DpfExpansion>
+DistributedPointFunction::ComputePartialEvaluations(
+    absl::Span<const uint64_t> prefixes, int hierarchy_level, bool update_ctx,
+    EvaluationContext& ctx) const {
+  // Prefixes are stored as 128-bit integers in `ctx`.
+  std::vector<absl::uint128> prefixes_128(prefixes.begin(), prefixes.end());
+  return ComputePartialEvaluations(prefixes_128, hierarchy_level, update_ctx,
+                                   ctx);
+}
+
 absl::StatusOr<DistributedPointFunction::DpfExpansion>
 DistributedPointFunction::ComputePartialEvaluations(
     absl::Span<const absl::uint128> prefixes, int hierarchy_level,
@@ -574,7 +796,11 @@ DistributedPointFunction::GetValueCorrectionFunction(
   DPF_ASSIGN_OR_RETURN(
       serialized_value_type,
       SerializeValueTypeDeterministically(parameters.value_type()));
-  auto it = value_correction_functions_.find(serialized_value_type);
+  auto it = default_value_correction_functions_.find(serialized_value_type);
+  if (it != default_value_correction_functions_.end()) {
+    return it->second;
+  }
+  it = value_correction_functions_.find(serialized_value_type);
   if (it == value_correction_functions_.end()) {
     return absl::FailedPreconditionError(absl::StrCat(
         "No value correction function known for the following parameters:\n",
@@ -596,20 +822,20 @@ DistributedPointFunction::CreateIncremental(
   ABSL_LOG_FIRST_N(INFO, 1)
       << "Highway is in " << dpf_internal::GetHwyModeAsString() << " mode";
 
-  // Validate `parameters` and store validator for later.
-  DPF_ASSIGN_OR_RETURN(
-      std::unique_ptr<dpf_internal::ProtoValidator> proto_validator,
-      dpf_internal::ProtoValidator::Create(parameters));
+  DPF_ASSIGN_OR_RETURN(const GlobalState* global_state, GetGlobalState());
+  DPF_ASSIGN_OR_RETURN(std::shared_ptr<const ParameterState> parameter_state,
+                       GetParameterState(parameters));
+  return absl::WrapUnique(
+      new DistributedPointFunction(*global_state, std::move(parameter_state)));
+}
 
-  // Compute the number of value correction blocks needed for each hierarchy
-  // level.
-  std::vector<int> blocks_needed(parameters.size());
-  for (int i = 0; i < static_cast<int>(parameters.size()); ++i) {
-    DPF_ASSIGN_OR_RETURN(
-        int bits_needed,
-        dpf_internal::BitsNeeded(parameters[i].value_type(),
-                                 parameters[i].security_parameter()));
-    blocks_needed[i] = (bits_needed + 127) / 128;
+absl::StatusOr<const DistributedPointFunction::GlobalState*>
+DistributedPointFunction::GetGlobalState() {
+  absl::MutexLock lock(&shared_state_mutex);
+  // Never destroyed, since instances may outlive static destructors.
+  static const GlobalState* global_state = nullptr;
+  if (global_state != nullptr) {
+    return global_state;
   }
 
   // Set up hash functions for PRG.
@@ -635,11 +861,62 @@ DistributedPointFunction::CreateIncremental(
   DPF_RETURN_IF_ERROR(
       RegisterValueTypeImpl<absl::uint128>(value_correction_functions));
 
-  // Copy parameters and return new DPF.
-  return absl::WrapUnique(new DistributedPointFunction(
-      std::move(proto_validator), std::move(blocks_needed), std::move(prg_left),
-      std::move(prg_right), std::move(prg_value),
-      std::move(value_correction_functions)));
+  global_state = new GlobalState{std::move(prg_left), std::move(prg_right),
+                                 std::move(prg_value),
+                                 std::move(value_correction_functions)};
+  return global_state;
+}
+
+absl::StatusOr<std::shared_ptr<const DistributedPointFunction::ParameterState>>
+DistributedPointFunction::GetParameterState(
+    absl::Span<const DpfParameters> parameters) {
+  // Maps serialized parameters to their state. When the cache is full, entries
+  // not used by any instance are evicted.
+  static auto* cache = new absl::flat_hash_map<
+      std::string, std::shared_ptr<const ParameterState>>();
+
+  DPF_ASSIGN_OR_RETURN(std::string cache_key,
+                       SerializeParametersDeterministically(parameters));
+  {
+    absl::MutexLock lock(&shared_state_mutex);
+    auto it = cache->find(cache_key);
+    if (it != cache->end()) {
+      return it->second;
+    }
+  }
+
+  // Validate `parameters` and store validator for later. Done without holding
+  // the lock, since it is the expensive part.
+  auto state = std::make_shared<ParameterState>();
+  DPF_ASSIGN_OR_RETURN(state->proto_validator,
+                       dpf_internal::ProtoValidator::Create(parameters));
+
+  // Compute the number of value correction blocks needed for each hierarchy
+  // level.
+  state->blocks_needed.resize(parameters.size());
+  for (int i = 0; i < static_cast<int>(parameters.size()); ++i) {
+    DPF_ASSIGN_OR_RETURN(
+        int bits_needed,
+        dpf_internal::BitsNeeded(parameters[i].value_type(),
+                                 parameters[i].security_parameter()));
+    state->blocks_needed[i] = (bits_needed + 127) / 128;
+  }
+
+  absl::MutexLock lock(&shared_state_mutex);
+  // Another thread may have created the same state in the meantime.
+  auto it = cache->find(cache_key);
+  if (it != cache->end()) {
+    return it->second;
+  }
+  if (cache->size() >= kMaxCachedParameterStates) {
+    absl::erase_if(*cache, [](const auto& key_and_state) {
+      return key_and_state.second.use_count() == 1;
+    });
+  }
+  if (cache->size() < kMaxCachedParameterStates) {
+    cache->emplace(std::move(cache_key), state);
+  }
+  return state;
 }
 
 absl::StatusOr<std::pair<DpfKey, DpfKey>>
@@ -79,6 +79,19 @@ ValueType ToValueType() {
   return dpf_internal::ValueTypeHelper<T>::ToValueType();
 }
 
+namespace dpf_internal {
+
+// Template guard for the overloads taking 64-bit evaluation points. They are
+// templates on the type of the points, so that they only match arguments that
+// actually convert to absl::Span<const uint64_t>. A braced initializer list
+// can't be deduced, so calls like `EvaluateAt<T>(key, 0, {x})` keep resolving
+// to the absl::uint128 overloads.
+template <typename Points>
+using EnableIfUint64Points = absl::enable_if_t<
+    std::is_convertible_v<const Points&, absl::Span<const uint64_t>>, int>;
+
+}  // namespace dpf_internal
+
 // Implements key generation and evaluation of distributed point functions.
 // A distributed point function (DPF) is parameterized by an index `alpha` and a
 // value `beta`. The key generation procedure produces two keys `k_a`, `k_b`.
@@ -101,6 +114,10 @@ class DistributedPointFunction {
   // domain size and element size at one of the layers to be evaluated, in
   // increasing domain size order. Element sizes must be non-decreasing.
   //
+  // The PRGs and the validated parameters are shared between all instances
+  // created with the same parameters, so creating many instances is cheap.
+  // This function is thread-safe.
+  //
   // Returns INVALID_ARGUMENT if the parameters are invalid.
   static absl::StatusOr<std::unique_ptr<DistributedPointFunction>>
   CreateIncremental(absl::Span<const DpfParameters> parameters);
@@ -335,6 +352,43 @@ class DistributedPointFunction {
     }
   }
 
+  // Evaluates all `keys` on the full domain of `hierarchy_level`, i.e., the
+  // result is the same as calling `EvaluateUntil<T>(hierarchy_level, {}, ctx)`
+  // with a fresh EvaluationContext for each key. The trees of all keys are
+  // expanded together, with nodes of different keys sharing the same AES
+  // batches. This is significantly faster than evaluating keys one by one if
+  // each tree is small, e.g., when handling many PIR queries on a database with
+  // a few thousand records.
+  //
+  // The outputs are returned in a single contiguous vector, where the outputs
+  // of keys[i] are at positions [i * n, (i + 1) * n), with n being the domain
+  // size of `hierarchy_level`.
+  //
+  // Returns INVALID_ARGUMENT if any element of `keys` is malformed, if
+  // `hierarchy_level` is out of range, if the bit-size of T doesn't match the
+  // `hierarchy_level`'s element_bitsize, or if the output would be too large.
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateUntilBatch(
+      int hierarchy_level,
+      dpf_internal::MaybeDerefSpan<const DpfKey> keys) const;
+
+  // Same as above, but only evaluates the first `domain_size` elements of the
+  // domain of `hierarchy_level`. Subtrees that only contain larger elements are
+  // not expanded, so the cost is proportional to `domain_size` rather than to
+  // the next power of two. This is useful if the domain of the DPF is rounded
+  // up from the actual number of elements, e.g., the records of a database.
+  //
+  // The outputs of keys[i] are at positions [i * domain_size,
+  // (i + 1) * domain_size).
+  //
+  // Returns INVALID_ARGUMENT under the same conditions as above, or if
+  // `domain_size` is not positive or larger than the domain size of
+  // `hierarchy_level`.
+  template <typename T>
+  absl::StatusOr<std::vector<T>> EvaluateUntilBatch(
+      int hierarchy_level, dpf_internal::MaybeDerefSpan<const DpfKey> keys,
+      int64_t domain_size) const;
+
   // Evaluates a single key at one or multiple points, up to the given
   // `hierarchy_level`. Each element of `evaluation_points` must be within the
   // domain of this DPF at `hierarchy_level`.
@@ -356,6 +410,21 @@ class DistributedPointFunction {
     return EvaluateAtImpl<T>(key, hierarchy_level, evaluation_points, nullptr);
   }
 
+  // Same as above, but with 64-bit `evaluation_points`, which suffice for
+  // domains of up to 2^64 elements. Avoids 128-bit arithmetic on the
+  // evaluation points, and halves the memory traffic for reading them.
+  // `evaluation_points` can be anything convertible to
+  // absl::Span<const uint64_t>.
+  template <typename T, typename Points,
+            dpf_internal::EnableIfUint64Points<Points> = 0>
+  absl::StatusOr<std::vector<T>> EvaluateAt(
+      const DpfKey& key, int hierarchy_level,
+      const Points& evaluation_points) const {
+    return EvaluateAtImpl<T>(key, hierarchy_level,
+                             absl::Span<const uint64_t>(evaluation_points),
+                             nullptr);
+  }
+
   // Evaluates a single key at one or multiple points, up to the given
   // `hierarchy_level`. Each element of `evaluation_points` must be within the
   // domain of this DPF at `hierarchy_level`.
@@ -380,6 +449,17 @@ class DistributedPointFunction {
                              &ctx);
   }
 
+  // Same as above, but with 64-bit `evaluation_points`.
+  template <typename T, typename Points,
+            dpf_internal::EnableIfUint64Points<Points> = 0>
+  absl::StatusOr<std::vector<T>> EvaluateAt(int hierarchy_level,
+                                            const Points& evaluation_points,
+                                            EvaluationContext& ctx) const {
+    return EvaluateAtImpl<T>(ctx.key(), hierarchy_level,
+                             absl::Span<const uint64_t>(evaluation_points),
+                             &ctx);
+  }
+
   // Evaluates a span of DPF keys. The i-th key is evaluated at
   // evaluation_points[i]. After each hierarchy level, calls `op` on the output
   // at that hierarchy level. `op` must be callable with the following
@@ -405,9 +485,25 @@ class DistributedPointFunction {
   // `evaluation_points` are out of range.
   template <typename T, typename Fn>
   absl::Status EvaluateAndApply(
-      dpf_internal::MaybeDerefSpan<const DpfKey>,
+      dpf_internal::MaybeDerefSpan<const DpfKey> keys,
       absl::Span<const absl::uint128> evaluation_points, Fn op,
-      int evaluation_points_rightshift = 0) const;
+      int evaluation_points_rightshift = 0) const {
+    return EvaluateAndApplyImpl<T>(keys, evaluation_points, std::move(op),
+                                   evaluation_points_rightshift);
+  }
+
+  // Same as above, but with 64-bit `evaluation_points`, which suffice for
+  // domains of up to 2^64 elements. The paths are then kept in 64-bit lanes
+  // during evaluation, halving the memory traffic for reading them.
+  template <typename T, typename Fn, typename Points,
+            dpf_internal::EnableIfUint64Points<Points> = 0>
+  absl::Status EvaluateAndApply(dpf_internal::MaybeDerefSpan<const DpfKey> keys,
+                                const Points& evaluation_points, Fn op,
+                                int evaluation_points_rightshift = 0) const {
+    return EvaluateAndApplyImpl<T>(
+        keys, absl::Span<const uint64_t>(evaluation_points), std::move(op),
+        evaluation_points_rightshift);
+  }
 
   // Returns the DpfParameters of this DPF.
   inline absl::Span<const DpfParameters> parameters() const {
@@ -435,13 +531,32 @@ class DistributedPointFunction {
       absl::string_view, absl::string_view, int block_index, const Value&,
       bool);
 
+  // Immutable state that does not depend on the parameters: The PRGs and the
+  // value correction functions for unsigned integers. Created once per process
+  // by `GetGlobalState`.
+  struct GlobalState;
+
+  // Immutable state derived from the parameters passed to `CreateIncremental`.
+  // Shared by all instances created with the same parameters, see
+  // `GetParameterState`.
+  struct ParameterState;
+
+  // Returns the process-wide GlobalState, creating it on first use.
+  //
+  // Returns INTERNAL in case of OpenSSL errors.
+  static absl::StatusOr<const GlobalState*> GetGlobalState();
+
+  // Returns the ParameterState for `parameters`. States are cached by their
+  // parameters, up to a fixed number of parameter sets.
+  //
+  // Returns INVALID_ARGUMENT if the parameters are invalid.
+  static absl::StatusOr<std::shared_ptr<const ParameterState>>
+  GetParameterState(absl::Span<const DpfParameters> parameters);
+
   // Private constructor, called by `CreateIncremental`.
   DistributedPointFunction(
-      std::unique_ptr<dpf_internal::ProtoValidator> proto_validator,
-      std::vector<int> blocks_needed, Aes128FixedKeyHash prg_left,
-      Aes128FixedKeyHash prg_right, Aes128FixedKeyHash prg_value,
-      absl::flat_hash_map<std::string, ValueCorrectionFunction>
-          value_correction_functions);
+      const GlobalState& global_state,
+      std::shared_ptr<const ParameterState> parameter_state);
 
   // Computes the value correction for the given `hierarchy_level`, `seeds`,
   // index `alpha` and value `beta`. If `invert` is true, the individual values
@@ -474,11 +589,13 @@ class DistributedPointFunction {
   // given domain index fits in the domain at `hierarchy_level`.
   absl::uint128 DomainToTreeIndex(absl::uint128 domain_index,
                                   int hierarchy_level) const;
+  uint64_t DomainToTreeIndex(uint64_t domain_index, int hierarchy_level) const;
 
   // Computes the block index (pointing to an element in a batched 128-bit
   // block) from the given `domain_index` and `hierarchy_level`. Does NOT check
   // whether the given domain index fits in the domain at `hierarchy_level`.
   int DomainToBlockIndex(absl::uint128 domain_index, int hierarchy_level) const;
+  int DomainToBlockIndex(uint64_t domain_index, int hierarchy_level) const;
 
   // Performs DPF evaluation of the given `seeds` using prg_ctx_left_ or
   // prg_ctx_right_, and the given `control_bits` and `correction_words`. At
@@ -502,6 +619,22 @@ class DistributedPointFunction {
       absl::Span<const CorrectionWord* const> correction_words,
       absl::Span<absl::uint128> seeds_out,
       absl::Span<bool> control_bits_out) const;
+  absl::Status EvaluateSeeds(
+      absl::Span<const absl::uint128> seeds,
+      absl::Span<const bool> control_bits, absl::Span<const uint64_t> paths,
+      absl::Span<const CorrectionWord* const> correction_words,
+      absl::Span<absl::uint128> seeds_out,
+      absl::Span<bool> control_bits_out) const;
+
+  // Joint implementation of both variants of `EvaluateSeeds`. `PathType` is
+  // either absl::uint128 or uint64_t.
+  template <typename PathType>
+  absl::Status EvaluateSeedsImpl(
+      absl::Span<const absl::uint128> seeds,
+      absl::Span<const bool> control_bits, absl::Span<const PathType> paths,
+      absl::Span<const CorrectionWord* const> correction_words,
+      absl::Span<absl::uint128> seeds_out,
+      absl::Span<bool> control_bits_out) const;
 
   // Performs DPF expansion of the given `partial_evaluations` using
   // prg_ctx_left_ and prg_ctx_right_, and the given `correction_words`. In
@@ -516,6 +649,20 @@ class DistributedPointFunction {
       const DpfExpansion& partial_evaluations,
       absl::Span<const CorrectionWord* const> correction_words) const;
 
+  // Performs DPF expansion of the first `num_expansions` tree levels of
+  // `keys[first_key]` to `keys[first_key + num_keys - 1]`, interleaving nodes
+  // of different keys in the same PRG batches. Only the first
+  // `leaves_per_key` nodes of the last level are computed for each key, and
+  // nodes whose subtrees contain none of them are skipped on every level. The
+  // result contains `num_keys * leaves_per_key` evaluations, where the
+  // evaluations of each key are stored contiguously. Called by
+  // `EvaluateUntilBatch`.
+  //
+  // Returns INTERNAL in case of OpenSSL errors.
+  absl::StatusOr<DpfExpansion> ExpandKeys(
+      dpf_internal::MaybeDerefSpan<const DpfKey> keys, int64_t first_key,
+      int64_t num_keys, int num_expansions, int64_t leaves_per_key) const;
+
   // Computes partial evaluations of the paths to `prefixes` up to
   // `hierarchy_level`, to be used as the starting point of the expansion of
   // `ctx`. If `update_ctx
@@ -529,6 +676,9 @@ class DistributedPointFunction {
   absl::StatusOr<DpfExpansion> ComputePartialEvaluations(
       absl::Span<const absl::uint128> prefixes, int hierarchy_level,
       bool update_ctx, EvaluationContext& ctx) const;
+  absl::StatusOr<DpfExpansion> ComputePartialEvaluations(
+      absl::Span<const uint64_t> prefixes, int hierarchy_level,
+      bool update_ctx, EvaluationContext& ctx) const;
 
   // Extracts the seeds for the given `prefixes` from `ctx` and expands them as
   // far as needed for the next hierarchy level. Returns the result as a
@@ -583,18 +733,31 @@ class DistributedPointFunction {
   absl::StatusOr<std::array<T, dpf_internal::ElementsPerBlock<T>()>>
   GetValueCorrectionAsArray(const DpfKey& key, int hierarchy_level) const;
 
-  // Joint implementation of the two variants of `EvaluateAt<T>`. If `ctx !=
+  // Joint implementation of the variants of `EvaluateAt<T>`. If `ctx !=
   // NULL`, `key` must point to `ctx->key()`, and `*ctx` will be updated with
-  // the partial evaluations at this `hierarchy_level`.
+  // the partial evaluations at this `hierarchy_level`. `PointType` is either
+  // absl::uint128 or uint64_t.
   //
-  template <typename T>
+  template <typename T, typename PointType>
   absl::StatusOr<std::vector<T>> EvaluateAtImpl(
       const DpfKey& key, int hierarchy_level,
-      absl::Span<const absl::uint128> evaluation_points,
+      absl::Span<const PointType> evaluation_points,
       EvaluationContext* ctx) const;
 
+  // Joint implementation of both variants of `EvaluateAndApply<T>`.
+  // `PointType` is either absl::uint128 or uint64_t.
+  template <typename T, typename PointType, typename Fn>
+  absl::Status EvaluateAndApplyImpl(
+      dpf_internal::MaybeDerefSpan<const DpfKey> keys,
+      absl::Span<const PointType> evaluation_points, Fn op,
+      int evaluation_points_rightshift) const;
+
+  // Keeps the state shared with other instances alive. All references below
+  // point into it or into the GlobalState, which is never destroyed.
+  const std::shared_ptr<const ParameterState> parameter_state_;
+
   // Used to validate DpfParameters, DpfKey and EvaluationContext protos.
-  const std::unique_ptr<dpf_internal::ProtoValidator> proto_validator_;
+  const dpf_internal::ProtoValidator* const proto_validator_;
 
   // DP parameters passed to the factory function. Contains the domain size and
   // element size for hierarchy level of the incremental DPF. Owned by
@@ -614,7 +777,7 @@ class DistributedPointFunction {
 
   // Cached numbers of AES blocks needed for value correction at each hierarchy
   // level.
-  const std::vector<int> blocks_needed_;
+  const std::vector<int>& blocks_needed_;
 
   // Pseudorandom generator used for seed expansion (left and right), and value
   // correction. The PRG G(x) for hierarchy level i is defined as the
@@ -624,12 +787,18 @@ class DistributedPointFunction {
   //
   // where k is equal to blocks_needed_[i], and H_*(x) is the evaluation of
   // prg_*_ on input x.
-  const Aes128FixedKeyHash prg_left_;
-  const Aes128FixedKeyHash prg_right_;
-  const Aes128FixedKeyHash prg_value_;
+  const Aes128FixedKeyHash& prg_left_;
+  const Aes128FixedKeyHash& prg_right_;
+  const Aes128FixedKeyHash& prg_value_;
+
+  // Value correction functions for all unsigned integer types, shared by all
+  // instances. See `value_correction_functions_`.
+  const absl::flat_hash_map<std::string, ValueCorrectionFunction>&
+      default_value_correction_functions_;
 
   // Maps serialized `ValueType` messages to the correct value correction
-  // functions. Map values are instantiations of
+  // functions, for types registered with this instance by
+  // `RegisterValueType<T>`. Map values are instantiations of
   // `dpf_internal::ComputeValueCorrectionFor`. Relies on protobuf's
   // deterministic serialization feature. This has the caveat that messages with
   // unknown fields are not supported. However, as long as `ValueType` consists
@@ -899,6 +1068,141 @@ absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateUntil(
   }
 }
 
+template <typename T>
+absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateUntilBatch(
+    int hierarchy_level,
+    dpf_internal::MaybeDerefSpan<const DpfKey> keys) const {
+  if (hierarchy_level < 0 ||
+      hierarchy_level >= static_cast<int>(parameters_.size())) {
+    return absl::InvalidArgumentError(
+        "`hierarchy_level` must be non-negative and less than "
+        "parameters_.size()");
+  }
+  const int log_domain_size = parameters_[hierarchy_level].log_domain_size();
+  if (log_domain_size >= 63) {
+    return absl::InvalidArgumentError(
+        "Domain size too large for full evaluation. Please insert "
+        "intermediate hierarchy levels.");
+  }
+  return EvaluateUntilBatch<T>(hierarchy_level, keys,
+                               int64_t{1} << log_domain_size);
+}
+
+template <typename T>
+absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateUntilBatch(
+    int hierarchy_level, dpf_internal::MaybeDerefSpan<const DpfKey> keys,
+    int64_t domain_size) const {
+  if (hierarchy_level < 0 ||
+      hierarchy_level >= static_cast<int>(parameters_.size())) {
+    return absl::InvalidArgumentError(
+        "`hierarchy_level` must be non-negative and less than "
+        "parameters_.size()");
+  }
+  absl::StatusOr<bool> types_are_equal = dpf_internal::ValueTypesAreEqual(
+      ToValueType<T>(), parameters_[hierarchy_level].value_type());
+  if (!types_are_equal.ok()) {
+    return types_are_equal.status();
+  } else if (!*types_are_equal) {
+    return absl::InvalidArgumentError(
+        "Value type T doesn't match parameters at `hierarchy_level`");
+  }
+  const int log_domain_size = parameters_[hierarchy_level].log_domain_size();
+  if (domain_size <= 0 ||
+      (log_domain_size < 63 && domain_size > int64_t{1} << log_domain_size)) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "`domain_size` must be positive and at most 2^", log_domain_size));
+  }
+  const auto num_keys = static_cast<int64_t>(keys.size());
+  for (int64_t i = 0; i < num_keys; ++i) {
+    absl::Status status = proto_validator_->ValidateDpfKey(keys[i]);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
+  // Check that the output size is not too large.
+  if (absl::uint128{static_cast<uint64_t>(num_keys)} *
+          static_cast<uint64_t>(domain_size) >
+      std::numeric_limits<size_t>::max() / 2) {
+    return absl::InvalidArgumentError(
+        "Output size would be too large. Please evaluate fewer keys at once.");
+  }
+  if (num_keys == 0) {
+    return std::vector<T>();
+  }
+
+  // Expand the trees of a group of keys together, then hash all their leaves
+  // at once. Interleaving keys only helps as long as each tree has few nodes
+  // per level, so the group size is chosen to keep the expansion of a group
+  // in cache.
+  constexpr int64_t kMaxBlocksPerGroup = int64_t{1} << 12;
+  const int num_tree_levels = hierarchy_to_tree_[hierarchy_level];
+  constexpr int elements_per_block = dpf_internal::ElementsPerBlock<T>();
+  const int corrected_elements_per_block =
+      1 << (log_domain_size - num_tree_levels);
+  const int blocks_needed = blocks_needed_[hierarchy_level];
+  const int64_t blocks_per_key =
+      (domain_size - 1) / corrected_elements_per_block + 1;
+  const int64_t keys_per_group =
+      std::max<int64_t>(1, kMaxBlocksPerGroup / blocks_per_key);
+  ABSL_DCHECK(corrected_elements_per_block <= elements_per_block);
+  std::vector<T> result(num_keys * domain_size);
+  for (int64_t first_key = 0; first_key < num_keys;
+       first_key += keys_per_group) {
+    const int64_t group_size =
+        std::min<int64_t>(keys_per_group, num_keys - first_key);
+    absl::StatusOr<DpfExpansion> expansion = ExpandKeys(
+        keys, first_key, group_size, num_tree_levels, blocks_per_key);
+    if (!expansion.ok()) {
+      return expansion.status();
+    }
+    const auto expansion_size =
+        static_cast<int64_t>(expansion->control_bits.size());
+    absl::StatusOr<hwy::AlignedFreeUniquePtr<absl::uint128[]>>
+        hashed_expansion = HashExpandedSeeds(
+            hierarchy_level,
+            absl::MakeConstSpan(expansion->seeds.get(), expansion_size));
+    if (!hashed_expansion.ok()) {
+      return hashed_expansion.status();
+    }
+
+    // Apply each key's value correction to its own leaves. As in
+    // `EvaluateUntil`, blocks might not be full, and the last block of each
+    // key may extend past `domain_size`.
+    for (int64_t k = 0; k < group_size; ++k) {
+      const DpfKey& key = keys[first_key + k];
+      absl::StatusOr<std::array<T, elements_per_block>> correction_ints =
+          GetValueCorrectionAsArray<T>(key, hierarchy_level);
+      if (!correction_ints.ok()) {
+        return correction_ints.status();
+      }
+      const bool invert = key.party() == 1;
+      T* output = result.data() + (first_key + k) * domain_size;
+      for (int64_t block = 0; block < blocks_per_key; ++block) {
+        const int64_t i = k * blocks_per_key + block;
+        const int64_t first_element = block * corrected_elements_per_block;
+        const int num_elements = static_cast<int>(std::min<int64_t>(
+            corrected_elements_per_block, domain_size - first_element));
+        std::array<T, elements_per_block> current_elements =
+            dpf_internal::ConvertBytesToArrayOf<T>(absl::string_view(
+                reinterpret_cast<const char*>(hashed_expansion->get() +
+                                              i * blocks_needed),
+                blocks_needed * sizeof(absl::uint128)));
+        for (int j = 0; j < num_elements; ++j) {
+          if (expansion->control_bits[i]) {
+            current_elements[j] += (*correction_ints)[j];
+          }
+          if (invert) {
+            current_elements[j] = -current_elements[j];
+          }
+          output[first_element + j] = current_elements[j];
+        }
+      }
+    }
+  }
+  return result;
+}
+
 template <typename T>
 absl::StatusOr<std::array<T, dpf_internal::ElementsPerBlock<T>()>>
 DistributedPointFunction::GetValueCorrectionAsArray(const DpfKey& key,
@@ -919,10 +1223,10 @@ DistributedPointFunction::GetValueCorrectionAsArray(const DpfKey& key,
   return dpf_internal::ValuesToArray<T>(*value_correction);
 }
 
-template <typename T>
+template <typename T, typename PointType>
 absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateAtImpl(
     const DpfKey& key, int hierarchy_level,
-    absl::Span<const absl::uint128> evaluation_points,
+    absl::Span<const PointType> evaluation_points,
     EvaluationContext* ctx) const {
   if (ctx != nullptr) {
     if (&key != &ctx->key()) {
@@ -941,9 +1245,9 @@ absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateAtImpl(
   const auto num_evaluation_points =
       static_cast<int64_t>(evaluation_points.size());
   const int log_domain_size = parameters_[hierarchy_level].log_domain_size();
-  absl::uint128 max_evaluation_point = absl::Uint128Max();
-  if (log_domain_size < 128) {
-    max_evaluation_point = (absl::uint128{1} << log_domain_size) - 1;
+  PointType max_evaluation_point = std::numeric_limits<PointType>::max();
+  if (log_domain_size < static_cast<int>(8 * sizeof(PointType))) {
+    max_evaluation_point = (PointType{1} << log_domain_size) - 1;
   }
   // Check if `evaluation_points` are inside the domain. This has minimal (~ 1%)
   // performance impact.
@@ -966,12 +1270,12 @@ absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateAtImpl(
   // Split up evaluation_points into tree indices and block indices, if we're
   // operating on a packed type. Otherwise set `tree_indices` to
   // `evaluation_points`.
-  hwy::AlignedFreeUniquePtr<absl::uint128[]> maybe_recomputed_tree_indices;
+  hwy::AlignedFreeUniquePtr<PointType[]> maybe_recomputed_tree_indices;
   constexpr int elements_per_block = dpf_internal::ElementsPerBlock<T>();
-  absl::Span<const absl::uint128> tree_indices;
+  absl::Span<const PointType> tree_indices;
   if (elements_per_block > 1) {
     maybe_recomputed_tree_indices =
-        hwy::AllocateAligned<absl::uint128>(num_evaluation_points);
+        hwy::AllocateAligned<PointType>(num_evaluation_points);
     if (maybe_recomputed_tree_indices == nullptr) {
       return absl::ResourceExhaustedError("Memory allocation error");
     }
@@ -1078,10 +1382,10 @@ absl::StatusOr<std::vector<T>> DistributedPointFunction::EvaluateAtImpl(
   return result;
 }
 
-template <typename T, typename Fn>
-absl::Status DistributedPointFunction::EvaluateAndApply(
+template <typename T, typename PointType, typename Fn>
+absl::Status DistributedPointFunction::EvaluateAndApplyImpl(
     dpf_internal::MaybeDerefSpan<const DpfKey> keys,
-    absl::Span<const absl::uint128> evaluation_points, Fn op,
+    absl::Span<const PointType> evaluation_points, Fn op,
     int evaluation_points_rightshift) const {
   if (evaluation_points.size() != keys.size()) {
     return absl::InvalidArgumentError(
@@ -1184,7 +1488,8 @@ absl::Status DistributedPointFunction::EvaluateAndApply(
         return correction_ints.status();
       }
       int block_index = 0;
-      if (elements_per_block > 1 && domain_index_rightshift < 128) {
+      if (elements_per_block > 1 &&
+          domain_index_rightshift < static_cast<int>(8 * sizeof(PointType))) {
         block_index = DomainToBlockIndex(
             evaluation_points[i] >> domain_index_rightshift, hierarchy_level);
       }
@@ -14,6 +14,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <memory>
 #include <numeric>
 #include <string>
@@ -31,6 +32,7 @@
 #include "absl/types/span.h"
 #include "benchmark/benchmark.h"
 #include "dpf/distributed_point_function.h"
+#include "dpf/internal/memory_counters.h"
 #include "google/protobuf/arena.h"
 #include "hwy/aligned_allocator.h"
 
@@ -51,6 +53,7 @@ void BM_EvaluateRegularDpf(benchmark::State& state) {
   ABSL_CHECK(dpf->RegisterValueType<T>().ok());
   std::pair<DpfKey, DpfKey> keys = dpf->GenerateKeys(alpha, beta).value();
   EvaluationContext ctx_0 = dpf->CreateEvaluationContext(keys.first).value();
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto s : state) {
     google::protobuf::Arena arena;
     EvaluationContext* ctx =
@@ -94,6 +97,45 @@ BENCHMARK_TEMPLATE(
 BENCHMARK_TEMPLATE(BM_EvaluateRegularDpf, XorWrapper<absl::uint128>)
     ->DenseRange(1, 24, 1);
 
+// Benchmarks full-domain evaluation of many keys over a small domain, as done
+// by PIR servers. Expects the first range argument to specify the log domain
+// size, and the second one the number of keys. If `batched` is true, all keys
+// are evaluated with a single call to EvaluateUntilBatch, otherwise each key is
+// evaluated separately with EvaluateNext.
+template <bool batched>
+void BM_EvaluateManyKeys(benchmark::State& state) {
+  using T = XorWrapper<absl::uint128>;
+  DpfParameters parameters;
+  parameters.set_log_domain_size(state.range(0));
+  *(parameters.mutable_value_type()) = ToValueType<T>();
+  std::unique_ptr<DistributedPointFunction> dpf =
+      DistributedPointFunction::Create(parameters).value();
+  const int num_keys = state.range(1);
+  std::vector<DpfKey> keys(num_keys);
+  for (int i = 0; i < num_keys; ++i) {
+    absl::uint128 alpha = i % (int64_t{1} << state.range(0));
+    keys[i] = dpf->GenerateKeys(alpha, T{1}).value().first;
+  }
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto s : state) {
+    if (batched) {
+      std::vector<T> result = dpf->EvaluateUntilBatch<T>(0, keys).value();
+      benchmark::DoNotOptimize(result);
+    } else {
+      for (const DpfKey& key : keys) {
+        EvaluationContext ctx = dpf->CreateEvaluationContext(key).value();
+        std::vector<T> result = dpf->EvaluateNext<T>({}, ctx).value();
+        benchmark::DoNotOptimize(result);
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_keys);
+}
+BENCHMARK_TEMPLATE(BM_EvaluateManyKeys, false)
+    ->ArgsProduct({{4, 9, 12}, {1, 16, 256}});
+BENCHMARK_TEMPLATE(BM_EvaluateManyKeys, true)
+    ->ArgsProduct({{4, 9, 12}, {1, 16, 256}});
+
 // Benchmarks full evaluation of all hierarchy levels. Expects the first range
 // argument to specify the number of iterations. The output domain size is fixed
 // to 2**20.
@@ -130,6 +172,7 @@ void BM_EvaluateHierarchicalFull(benchmark::State& state) {
   }
 
   // Run hierarchical evaluation.
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto s : state) {
     google::protobuf::Arena arena;
     EvaluationContext* ctx =
@@ -219,6 +262,7 @@ void BM_IsrgExampleHierarchy(benchmark::State& state) {
 
   // Run hierarchical evaluation.
   EvaluationContext ctx_0 = dpf->CreateEvaluationContext(keys.first).value();
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto s : state) {
     google::protobuf::Arena arena;
     EvaluationContext* ctx =
@@ -261,6 +305,7 @@ void BM_KeyGeneration(benchmark::State& state) {
   absl::uint128 alpha_mask =
       (absl::uint128{1} << parameters.back().log_domain_size()) - 1;
   std::pair<DpfKey, DpfKey> result;
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto s : state) {
     // Sample alpha randomly, so we don't rely on any structure here.
     absl::uint128 alpha = absl::MakeUint128(dist(rng), dist(rng)) & alpha_mask;
@@ -272,6 +317,25 @@ void BM_KeyGeneration(benchmark::State& state) {
 BENCHMARK_TEMPLATE(BM_KeyGeneration, true)->RangeMultiplier(2)->Range(1, 128);
 BENCHMARK_TEMPLATE(BM_KeyGeneration, false)->RangeMultiplier(2)->Range(1, 128);
 
+// Benchmarks construction of an incremental DPF with `state.range(0)` hierarchy
+// levels, as done by PIR servers and DCF instances. All iterations use the same
+// parameters, so this measures construction from cached state.
+void BM_CreateIncremental(benchmark::State& state) {
+  int num_levels = state.range(0);
+  std::vector<DpfParameters> parameters(num_levels);
+  for (int i = 0; i < num_levels; ++i) {
+    parameters[i].set_log_domain_size(i + 1);
+    parameters[i].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  }
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto s : state) {
+    std::unique_ptr<DistributedPointFunction> dpf =
+        *(DistributedPointFunction::CreateIncremental(parameters));
+    benchmark::DoNotOptimize(dpf);
+  }
+}
+BENCHMARK(BM_CreateIncremental)->RangeMultiplier(4)->Range(1, 128);
+
 // Generates `num_nonzeros` uniform indices, and computes their prefixes for
 // each hierarchy level in `parameters`.
 absl::StatusOr<std::vector<std::vector<absl::uint128>>> GenerateUniformPrefixes(
@@ -337,6 +401,7 @@ void BM_HeavyHitters(benchmark::State& state) {
 
   // Run hierarchical evaluation.
   EvaluationContext ctx_0 = dpf->CreateEvaluationContext(key).value();
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto s : state) {
     google::protobuf::Arena arena;
     EvaluationContext* ctx =
@@ -396,6 +461,7 @@ void BM_BatchEvaluation(benchmark::State& state) {
     }
   }
 
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto s : state) {
     for (int i = 0; i < num_keys; ++i) {
       std::vector<T> result =
@@ -414,5 +480,91 @@ BENCHMARK_TEMPLATE(BM_BatchEvaluation, XorWrapper<absl::uint128>)
     ->ArgPair(10, 40000)
     ->ArgPair(100, 4000);
 
+// Benchmarks EvaluateAt with 64-bit or 128-bit evaluation points on a 64-bit
+// domain. The first argument specifies the number of evaluation points.
+template <typename PointType>
+void BM_EvaluateAtWithPointType(benchmark::State& state) {
+  using T = uint64_t;
+  const int num_evaluation_points = state.range(0);
+  constexpr int kLogDomainSize = 64;
+
+  DpfParameters parameters;
+  parameters.set_log_domain_size(kLogDomainSize);
+  *(parameters.mutable_value_type()) = ToValueType<T>();
+  std::unique_ptr<DistributedPointFunction> dpf =
+      DistributedPointFunction::Create(parameters).value();
+
+  absl::BitGen rng;
+  const DpfKey key =
+      dpf->GenerateKeys(absl::Uniform<uint64_t>(rng), T{42}).value().first;
+  std::vector<PointType> evaluation_points(num_evaluation_points);
+  for (PointType& point : evaluation_points) {
+    point = absl::Uniform<uint64_t>(rng);
+  }
+
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto s : state) {
+    std::vector<T> result =
+        dpf->EvaluateAt<T>(key, 0, evaluation_points).value();
+    benchmark::DoNotOptimize(result);
+  }
+}
+BENCHMARK_TEMPLATE(BM_EvaluateAtWithPointType, absl::uint128)
+    ->RangeMultiplier(10)
+    ->Range(1, 10000);
+BENCHMARK_TEMPLATE(BM_EvaluateAtWithPointType, uint64_t)
+    ->RangeMultiplier(10)
+    ->Range(1, 10000);
+
+// Benchmarks EvaluateAndApply with 64-bit or 128-bit evaluation points on a
+// 64-bit domain split into 8 hierarchy levels. The first argument specifies
+// the number of keys.
+template <typename PointType>
+void BM_EvaluateAndApplyWithPointType(benchmark::State& state) {
+  using T = uint64_t;
+  const int num_keys = state.range(0);
+  constexpr int kNumHierarchyLevels = 8;
+
+  std::vector<DpfParameters> parameters(kNumHierarchyLevels);
+  for (int i = 0; i < kNumHierarchyLevels; ++i) {
+    parameters[i].set_log_domain_size((i + 1) * 64 / kNumHierarchyLevels);
+    *(parameters[i].mutable_value_type()) = ToValueType<T>();
+  }
+  std::unique_ptr<DistributedPointFunction> dpf =
+      DistributedPointFunction::CreateIncremental(parameters).value();
+
+  absl::BitGen rng;
+  std::vector<T> beta(kNumHierarchyLevels, T{42});
+  const DpfKey key =
+      dpf->GenerateKeysIncremental(absl::Uniform<uint64_t>(rng),
+                                   absl::MakeConstSpan(beta))
+          .value()
+          .first;
+  std::vector<const DpfKey*> keys(num_keys, &key);
+  std::vector<PointType> evaluation_points(num_keys);
+  for (PointType& point : evaluation_points) {
+    point = absl::Uniform<uint64_t>(rng);
+  }
+  std::vector<T> sums(num_keys);
+
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto s : state) {
+    ABSL_CHECK_OK(dpf->EvaluateAndApply<T>(
+        keys, evaluation_points, [&sums](absl::Span<const T> values) {
+          for (int i = 0; i < static_cast<int>(values.size()); ++i) {
+            sums[i] += values[i];
+          }
+          return true;
+        }));
+    benchmark::DoNotOptimize(sums);
+  }
+}
+BENCHMARK_TEMPLATE(BM_EvaluateAndApplyWithPointType, absl::uint128)
+    ->RangeMultiplier(10)
+    ->Range(1, 10000);
+BENCHMARK_TEMPLATE(BM_EvaluateAndApplyWithPointType, uint64_t)
+    ->RangeMultiplier(10)
+    ->Range(1, 10000);
+
 }  // namespace
 }  // namespace distributed_point_functions
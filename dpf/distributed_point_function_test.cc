@@ -14,9 +14,12 @@
 
 #include "dpf/distributed_point_function.h"
 
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -35,6 +38,7 @@
 #include "dpf/distributed_point_function.pb.h"
 #include "dpf/internal/proto_validator.h"
 #include "dpf/internal/status_matchers.h"
+#include "dpf/status_macros.h"
 #include "dpf/xor_wrapper.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -111,6 +115,79 @@ TEST(DistributedPointFunction, CreateFailsForInvalidValueType) {
                        StartsWith("ValidateValueType: Unsupported ValueType")));
 }
 
+TEST(DistributedPointFunction, InstancesWithSameParametersAreIndependent) {
+  DpfParameters parameters;
+  parameters.set_log_domain_size(10);
+  *(parameters.mutable_value_type()) = ToValueType<Tuple<uint32_t>>();
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<DistributedPointFunction> dpf_1,
+                           DistributedPointFunction::Create(parameters));
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<DistributedPointFunction> dpf_2,
+                           DistributedPointFunction::Create(parameters));
+
+  // Registering a value type with one instance doesn't affect the other.
+  DPF_ASSERT_OK_AND_ASSIGN(Value beta, dpf_1->ToValue(Tuple<uint32_t>{42}));
+  DPF_ASSERT_OK_AND_ASSIGN(auto keys, dpf_1->GenerateKeys(23, beta));
+  EXPECT_THAT(dpf_2->GenerateKeys(23, beta),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       StartsWith("No value correction function known")));
+
+  // Keys generated by one instance can be evaluated by the other, even after
+  // the first one is destroyed.
+  dpf_1.reset();
+  DPF_ASSERT_OK(dpf_2->RegisterValueType<Tuple<uint32_t>>());
+  std::vector<absl::uint128> evaluation_points = {22, 23};
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<Tuple<uint32_t>> result_0,
+      dpf_2->EvaluateAt<Tuple<uint32_t>>(keys.first, 0, evaluation_points));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<Tuple<uint32_t>> result_1,
+      dpf_2->EvaluateAt<Tuple<uint32_t>>(keys.second, 0, evaluation_points));
+  EXPECT_EQ(result_0[0] + result_1[0], Tuple<uint32_t>{0});
+  EXPECT_EQ(result_0[1] + result_1[1], Tuple<uint32_t>{42});
+}
+
+TEST(DistributedPointFunction, ConcurrentCreateAndEvaluate) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumIterations = 20;
+  std::vector<std::thread> threads;
+  std::vector<absl::Status> statuses(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([i, &statuses] {
+      statuses[i] = [i]() -> absl::Status {
+        for (int j = 0; j < kNumIterations; ++j) {
+          // Alternate between a few parameter sets, so that threads create
+          // instances both with new and with cached parameters.
+          DpfParameters parameters;
+          parameters.set_log_domain_size(8 + (i + j) % 3);
+          *(parameters.mutable_value_type()) = ToValueType<uint64_t>();
+          DPF_ASSIGN_OR_RETURN(std::unique_ptr<DistributedPointFunction> dpf,
+                               DistributedPointFunction::Create(parameters));
+          DPF_ASSIGN_OR_RETURN(auto keys,
+                               dpf->GenerateKeys(j, uint64_t{1} + i));
+          std::vector<absl::uint128> evaluation_points = {
+              absl::uint128{static_cast<uint64_t>(j)}};
+          DPF_ASSIGN_OR_RETURN(std::vector<uint64_t> result_0,
+                               dpf->EvaluateAt<uint64_t>(keys.first, 0,
+                                                         evaluation_points));
+          DPF_ASSIGN_OR_RETURN(std::vector<uint64_t> result_1,
+                               dpf->EvaluateAt<uint64_t>(keys.second, 0,
+                                                         evaluation_points));
+          if (result_0[0] + result_1[0] != uint64_t{1} + i) {
+            return absl::InternalError("Incorrect evaluation result");
+          }
+        }
+        return absl::OkStatus();
+      }();
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const absl::Status& status : statuses) {
+    EXPECT_THAT(status, IsOk());
+  }
+}
+
 TEST(DistributedPointFunction, TestGenerateKeysIncrementalVariadicTemplate) {
   std::vector<DpfParameters> parameters(2);
 
@@ -1064,6 +1141,138 @@ TYPED_TEST(DpfEvaluationTest, TestRegularDpf) {
   }
 }
 
+TYPED_TEST(DpfEvaluationTest, TestEvaluateUntilBatchMatchesEvaluateUntil) {
+  const std::vector<std::vector<int>> parameters = {
+      {0}, {1}, {7}, {10}, {2, 5, 12}};
+  for (const auto& log_domain_sizes : parameters) {
+    this->SetUp(log_domain_sizes, 0);
+    // Use keys for different alphas, and keys of both parties.
+    std::vector<DpfKey> keys;
+    for (absl::uint128 alpha : {0, 3, 23}) {
+      if (alpha >> log_domain_sizes.back() != 0) {
+        continue;
+      }
+      DPF_ASSERT_OK_AND_ASSIGN(
+          auto key_pair, this->dpf_->GenerateKeysIncremental(
+                             alpha, absl::MakeConstSpan(this->beta_)));
+      keys.push_back(std::move(key_pair.first));
+      keys.push_back(std::move(key_pair.second));
+    }
+
+    for (int level = 0; level < static_cast<int>(log_domain_sizes.size());
+         ++level) {
+      const int64_t outputs_per_key = int64_t{1} << log_domain_sizes[level];
+      DPF_ASSERT_OK_AND_ASSIGN(
+          std::vector<TypeParam> batch_output,
+          this->dpf_->template EvaluateUntilBatch<TypeParam>(level, keys));
+      ASSERT_EQ(batch_output.size(), keys.size() * outputs_per_key);
+      for (int i = 0; i < static_cast<int>(keys.size()); ++i) {
+        DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx,
+                                 this->dpf_->CreateEvaluationContext(keys[i]));
+        DPF_ASSERT_OK_AND_ASSIGN(
+            std::vector<TypeParam> output,
+            this->dpf_->template EvaluateUntil<TypeParam>(level, {}, ctx));
+        for (int64_t j = 0; j < outputs_per_key; ++j) {
+          EXPECT_EQ(batch_output[i * outputs_per_key + j], output[j])
+              << "key=" << i << ", level=" << level << ", j=" << j;
+        }
+      }
+    }
+  }
+}
+
+TYPED_TEST(DpfEvaluationTest, TestEvaluateUntilBatchFailsOnInvalidInput) {
+  std::vector<DpfKey> keys = {this->keys_.first, this->keys_.second};
+  EXPECT_THAT(this->dpf_->template EvaluateUntilBatch<TypeParam>(1, keys),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`hierarchy_level` must be non-negative")));
+  keys[1].clear_seed();
+  EXPECT_THAT(this->dpf_->template EvaluateUntilBatch<TypeParam>(0, keys),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(this->dpf_->template EvaluateUntilBatch<TypeParam>(
+                  0, absl::Span<const DpfKey>()),
+              IsOkAndHolds(::testing::IsEmpty()));
+}
+
+TYPED_TEST(DpfEvaluationTest, TestEvaluateUntilBatchWithDomainSize) {
+  const std::vector<std::vector<int>> parameters = {{0}, {3}, {10}, {2, 5, 12}};
+  for (const auto& log_domain_sizes : parameters) {
+    this->SetUp(log_domain_sizes, 0);
+    std::vector<DpfKey> keys;
+    for (absl::uint128 alpha : {0, 5, 700}) {
+      if (alpha >> log_domain_sizes.back() != 0) {
+        continue;
+      }
+      DPF_ASSERT_OK_AND_ASSIGN(
+          auto key_pair, this->dpf_->GenerateKeysIncremental(
+                             alpha, absl::MakeConstSpan(this->beta_)));
+      keys.push_back(std::move(key_pair.first));
+      keys.push_back(std::move(key_pair.second));
+    }
+
+    for (int level = 0; level < static_cast<int>(log_domain_sizes.size());
+         ++level) {
+      const int64_t full_domain_size = int64_t{1} << log_domain_sizes[level];
+      DPF_ASSERT_OK_AND_ASSIGN(
+          std::vector<TypeParam> full_output,
+          this->dpf_->template EvaluateUntilBatch<TypeParam>(level, keys));
+      for (int64_t domain_size :
+           {int64_t{1}, int64_t{3}, full_domain_size / 2 + 1,
+            full_domain_size - 1, full_domain_size}) {
+        if (domain_size < 1 || domain_size > full_domain_size) {
+          continue;
+        }
+        DPF_ASSERT_OK_AND_ASSIGN(
+            std::vector<TypeParam> output,
+            this->dpf_->template EvaluateUntilBatch<TypeParam>(level, keys,
+                                                               domain_size));
+        ASSERT_EQ(output.size(), keys.size() * domain_size);
+        for (int i = 0; i < static_cast<int>(keys.size()); ++i) {
+          for (int64_t j = 0; j < domain_size; ++j) {
+            EXPECT_EQ(output[i * domain_size + j],
+                      full_output[i * full_domain_size + j])
+                << "key=" << i << ", level=" << level
+                << ", domain_size=" << domain_size << ", j=" << j;
+          }
+        }
+      }
+    }
+  }
+}
+
+TYPED_TEST(DpfEvaluationTest, TestEvaluateUntilBatchOnPrefixOfLargeDomain) {
+  // Full evaluation is impossible on this domain, but a prefix can be
+  // evaluated.
+  this->SetUp(128, 3);
+  std::vector<DpfKey> keys = {this->keys_.first, this->keys_.second};
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<TypeParam> output,
+      this->dpf_->template EvaluateUntilBatch<TypeParam>(0, keys, 10));
+  ASSERT_EQ(output.size(), 20);
+  for (int j = 0; j < 10; ++j) {
+    TypeParam sum = output[j] + output[10 + j];
+    if (j == 3) {
+      EXPECT_EQ(sum, this->beta_[0]);
+    } else {
+      EXPECT_EQ(sum, TypeParam{});
+    }
+  }
+  EXPECT_THAT(this->dpf_->template EvaluateUntilBatch<TypeParam>(0, keys),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Domain size too large")));
+}
+
+TYPED_TEST(DpfEvaluationTest, TestEvaluateUntilBatchFailsOnInvalidDomainSize) {
+  this->SetUp(4, 0);
+  std::vector<DpfKey> keys = {this->keys_.first, this->keys_.second};
+  EXPECT_THAT(this->dpf_->template EvaluateUntilBatch<TypeParam>(0, keys, 0),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`domain_size` must be positive and at most 2^4"));
+  EXPECT_THAT(this->dpf_->template EvaluateUntilBatch<TypeParam>(0, keys, 17),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`domain_size` must be positive and at most 2^4"));
+}
+
 TYPED_TEST(DpfEvaluationTest, TestBatchSinglePointEvaluation) {
   // Set Up with a large output domain, to make sure this works.
   for (int log_domain_size : {0, 1, 2, 32, 128}) {
@@ -1101,6 +1310,100 @@ TYPED_TEST(DpfEvaluationTest, TestBatchSinglePointEvaluation) {
   }
 }
 
+TYPED_TEST(DpfEvaluationTest, TestBatchSinglePointEvaluationWithUint64Points) {
+  for (int log_domain_size : {0, 1, 2, 32, 63, 64, 128}) {
+    uint64_t max_evaluation_point = std::numeric_limits<uint64_t>::max();
+    if (log_domain_size < 64) {
+      max_evaluation_point = (uint64_t{1} << log_domain_size) - 1;
+    }
+    const uint64_t alpha = 23 & max_evaluation_point;
+    this->SetUp(log_domain_size, alpha);
+    for (int num_evaluation_points : {0, 1, 2, 100, 1000}) {
+      std::vector<uint64_t> evaluation_points(num_evaluation_points);
+      for (int i = 0; i < num_evaluation_points; ++i) {
+        evaluation_points[i] = (0x9e3779b97f4a7c15 * i) & max_evaluation_point;
+      }
+      if (num_evaluation_points > 0) {
+        evaluation_points.back() = alpha;
+      }
+      std::vector<absl::uint128> evaluation_points_128(
+          evaluation_points.begin(), evaluation_points.end());
+      for (const DpfKey* key : {&this->keys_.first, &this->keys_.second}) {
+        DPF_ASSERT_OK_AND_ASSIGN(std::vector<TypeParam> output_64,
+                                 this->dpf_->template EvaluateAt<TypeParam>(
+                                     *key, 0, evaluation_points));
+        DPF_ASSERT_OK_AND_ASSIGN(std::vector<TypeParam> output_128,
+                                 this->dpf_->template EvaluateAt<TypeParam>(
+                                     *key, 0, evaluation_points_128));
+        EXPECT_EQ(output_64, output_128)
+            << "log_domain_size=" << log_domain_size;
+      }
+    }
+  }
+}
+
+TYPED_TEST(DpfEvaluationTest, TestEvaluateAtWithContextAndUint64Points) {
+  const std::vector<int> log_domain_sizes = {8, 20, 40, 64};
+  const uint64_t alpha = 0x123456789abcdef0;
+  this->SetUp(log_domain_sizes, alpha);
+  DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx_64,
+                           this->dpf_->CreateEvaluationContext(
+                               this->keys_.first));
+  EvaluationContext ctx_128 = ctx_64;
+  for (int hierarchy_level = 0;
+       hierarchy_level < static_cast<int>(log_domain_sizes.size());
+       ++hierarchy_level) {
+    const int shift_amount = 64 - log_domain_sizes[hierarchy_level];
+    std::vector<uint64_t> prefixes = {
+        alpha >> shift_amount, (alpha ^ (uint64_t{1} << 63)) >> shift_amount};
+    std::vector<absl::uint128> prefixes_128(prefixes.begin(), prefixes.end());
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<TypeParam> output_64,
+        this->dpf_->template EvaluateAt<TypeParam>(hierarchy_level, prefixes,
+                                                   ctx_64));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<TypeParam> output_128,
+        this->dpf_->template EvaluateAt<TypeParam>(hierarchy_level,
+                                                   prefixes_128, ctx_128));
+    EXPECT_EQ(output_64, output_128) << "hierarchy_level=" << hierarchy_level;
+  }
+}
+
+TYPED_TEST(DpfEvaluationTest, TestEvaluateAtWithBracedEvaluationPoints) {
+  // Braced lists can't select the uint64_t overloads, so these calls resolve
+  // to the absl::uint128 overloads without ambiguity, as they did before the
+  // uint64_t overloads were added.
+  const uint64_t x = 23;
+  this->SetUp(32, x);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<TypeParam> output_1,
+      this->dpf_->template EvaluateAt<TypeParam>(this->keys_.first, 0, {x}));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<TypeParam> output_2,
+      this->dpf_->template EvaluateAt<TypeParam>(this->keys_.second, 0, {23}));
+  ASSERT_EQ(output_1.size(), 1);
+  ASSERT_EQ(output_2.size(), 1);
+  TypeParam sum = output_1[0] + output_2[0];
+  EXPECT_EQ(sum, this->beta_[0]);
+
+  DPF_ASSERT_OK_AND_ASSIGN(
+      EvaluationContext ctx,
+      this->dpf_->CreateEvaluationContext(this->keys_.first));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<TypeParam> output_ctx,
+      this->dpf_->template EvaluateAt<TypeParam>(0, {x}, ctx));
+  EXPECT_EQ(output_ctx, output_1);
+}
+
+TYPED_TEST(DpfEvaluationTest, TestEvaluateAtWithUint64PointsFailsOutOfDomain) {
+  this->SetUp(32, 23);
+  std::vector<uint64_t> evaluation_points = {1, uint64_t{1} << 32};
+  EXPECT_THAT(this->dpf_->template EvaluateAt<TypeParam>(this->keys_.first, 0,
+                                                         evaluation_points),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("evaluation_points[1]")));
+}
+
 TYPED_TEST(DpfEvaluationTest, TestEvaluateAndApplySimpleAddition) {
   std::vector<std::vector<int>> parameters = {
       {0, 1, 2}, {8, 16, 32, 64}, {0, 128}, {128}, {/* filled below */}};
@@ -1164,6 +1467,54 @@ TYPED_TEST(DpfEvaluationTest, TestEvaluateAndApplySimpleAddition) {
   }
 }
 
+TYPED_TEST(DpfEvaluationTest, TestEvaluateAndApplyWithUint64Points) {
+  std::vector<std::vector<int>> parameters = {
+      {0, 1, 2}, {8, 16, 32, 64}, {0, 64}, {64}, {/* filled below */}};
+  for (int i = 0; i <= 64; ++i) {
+    parameters.back().push_back(i);
+  }
+  for (const auto& log_domain_sizes : parameters) {
+    uint64_t max_domain_element = std::numeric_limits<uint64_t>::max();
+    if (log_domain_sizes.back() < 64) {
+      max_domain_element = (uint64_t{1} << log_domain_sizes.back()) - 1;
+    }
+    this->SetUp(log_domain_sizes, max_domain_element);
+
+    // Use enough keys to fill several SIMD vectors.
+    constexpr int kNumKeys = 101;
+    std::vector<uint64_t> evaluation_points(kNumKeys);
+    std::vector<const DpfKey*> keys(kNumKeys);
+    for (int i = 0; i < kNumKeys; ++i) {
+      evaluation_points[i] = (0x9e3779b97f4a7c15 * i) & max_domain_element;
+      keys[i] = i % 2 == 0 ? &(this->keys_.first) : &(this->keys_.second);
+    }
+    evaluation_points[0] = max_domain_element;
+    std::vector<absl::uint128> evaluation_points_128(evaluation_points.begin(),
+                                                     evaluation_points.end());
+
+    std::vector<std::vector<TypeParam>> outputs_64, outputs_128;
+    EXPECT_THAT(
+        this->dpf_->template EvaluateAndApply<TypeParam>(
+            keys, evaluation_points,
+            [&outputs_64](absl::Span<const TypeParam> values) {
+              outputs_64.emplace_back(values.begin(), values.end());
+              return true;
+            }),
+        IsOk());
+    EXPECT_THAT(
+        this->dpf_->template EvaluateAndApply<TypeParam>(
+            keys, evaluation_points_128,
+            [&outputs_128](absl::Span<const TypeParam> values) {
+              outputs_128.emplace_back(values.begin(), values.end());
+              return true;
+            }),
+        IsOk());
+    EXPECT_EQ(outputs_64.size(), log_domain_sizes.size());
+    EXPECT_EQ(outputs_64, outputs_128)
+        << "log_domain_sizes=" << absl::StrJoin(log_domain_sizes, " ");
+  }
+}
+
 TYPED_TEST(DpfEvaluationTest,
            EvaluateAndApplyFailsWithTooManyEvaluationPoints) {
   std::vector<absl::uint128> evaluation_points = {0, 1};
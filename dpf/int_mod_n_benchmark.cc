@@ -22,6 +22,7 @@
 #include "absl/types/span.h"
 #include "benchmark/benchmark.h"
 #include "dpf/int_mod_n.h"
+#include "dpf/internal/memory_counters.h"
 #include "openssl/rand.h"
 
 namespace distributed_point_functions {
@@ -37,6 +38,7 @@ void BM_Sample(benchmark::State& state) {
       MyInt::GetNumBytesRequired(kNumSamples, security_parameter).value());
   RAND_bytes(bytes.data(), bytes.size());
   std::vector<MyInt> output(num_iterations * kNumSamples);
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto s : state) {
     for (int i = 0; i < num_iterations; ++i) {
       MyInt::UnsafeSampleFromBytes<kNumSamples>(
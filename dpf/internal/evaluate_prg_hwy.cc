@@ -50,16 +50,33 @@ namespace hn = hwy::HWY_NAMESPACE;
 #if HWY_TARGET == HWY_SCALAR
 
 absl::Status EvaluateSeedsHwy(
-    int64_t num_seeds, int num_levels, const absl::uint128* seeds_in,
-    const bool* control_bits_in, const absl::uint128* paths,
+    int64_t num_seeds, int num_levels, int num_correction_words,
+    const absl::uint128* seeds_in, const bool* control_bits_in,
+    const absl::uint128* paths, int paths_rightshift,
+    const absl::uint128* correction_seeds, const bool* correction_controls_left,
+    const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
+    const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
+    bool* control_bits_out) {
+  return EvaluateSeedsNoHwy(
+      num_seeds, num_levels, num_correction_words, seeds_in, control_bits_in,
+      paths, paths_rightshift, correction_seeds, correction_controls_left,
+      correction_controls_right, prg_left, prg_right, seeds_out,
+      control_bits_out);
+}
+
+absl::Status EvaluateSeedsUint64Hwy(
+    int64_t num_seeds, int num_levels, int num_correction_words,
+    const absl::uint128* seeds_in, const bool* control_bits_in,
+    const uint64_t* paths, int paths_rightshift,
     const absl::uint128* correction_seeds, const bool* correction_controls_left,
     const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
     const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
     bool* control_bits_out) {
-  return EvaluateSeedsNoHwy(num_seeds, num_levels, seeds_in, control_bits_in,
-                            paths, correction_seeds, correction_controls_left,
-                            correction_controls_right, prg_left, prg_right,
-                            seeds_out, control_bits_out);
+  return EvaluateSeedsNoHwy(
+      num_seeds, num_levels, num_correction_words, seeds_in, control_bits_in,
+      paths, paths_rightshift, correction_seeds, correction_controls_left,
+      correction_controls_right, prg_left, prg_right, seeds_out,
+      control_bits_out);
 }
 
 #else
@@ -147,10 +164,42 @@ struct HWY_ALIGN Aligned128 {
   absl::uint128 _;
 };
 
-absl::Status EvaluateSeedsHwy(
+// Loads the paths of the `num_blocks` seeds starting at `start_block` into a
+// byte vector, with the i-th path in the i-th 128-bit block. Blocks beyond
+// `num_blocks` are set to zero. `paths + start_block` must be aligned if
+// `num_blocks` fills a whole vector.
+template <typename D>
+hn::Vec<D> LoadPaths(D d8, const absl::uint128* paths, int64_t start_block,
+                     int num_blocks) {
+  const uint8_t* paths_ptr =
+      reinterpret_cast<const uint8_t*>(paths + start_block);
+  const size_t num_bytes = num_blocks * sizeof(absl::uint128);
+  if (num_bytes == hn::Lanes(d8)) {
+    return hn::Load(d8, paths_ptr);
+  }
+  return hn::LoadN(d8, paths_ptr, num_bytes);
+}
+
+// Same as above, but for 64-bit paths. Only half a vector is read from
+// memory, and each path is zero-extended to its 128-bit block, so that
+// `IsBitSet` works the same way for both path types. `paths` need not be
+// aligned.
+template <typename D>
+hn::Vec<D> LoadPaths(D d8, const uint64_t* paths, int64_t start_block,
+                     int num_blocks) {
+  const hn::Repartition<uint64_t, D> d64;
+  const auto packed_paths = hn::LoadN(d64, paths + start_block, num_blocks);
+  return hn::BitCast(
+      d8, hn::InterleaveWholeLower(d64, packed_paths, hn::Zero(d64)));
+}
+
+// Implementation of `EvaluateSeedsHwy` and `EvaluateSeedsUint64Hwy`.
+// `PathType` is either absl::uint128 or uint64_t.
+template <typename PathType>
+absl::Status EvaluateSeedsHwyImpl(
     int64_t num_seeds, int num_levels, int num_correction_words,
     const absl::uint128* seeds_in, const bool* control_bits_in,
-    const absl::uint128* paths, int paths_rightshift,
+    const PathType* paths, int paths_rightshift,
     const absl::uint128* correction_seeds, const bool* correction_controls_left,
     const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
     const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
@@ -160,11 +209,13 @@ absl::Status EvaluateSeedsHwy(
     return absl::OkStatus();
   }
 
-  // Check if inputs and outputs are aligned.
+  // Check if inputs and outputs are aligned. 64-bit paths are loaded with
+  // unaligned loads, see `LoadPaths`.
   constexpr size_t kHwyAlignment = alignof(Aligned128);
   const bool is_aligned =
       (reinterpret_cast<uintptr_t>(seeds_in) % kHwyAlignment == 0) &&
-      (reinterpret_cast<uintptr_t>(paths) % kHwyAlignment == 0) &&
+      (sizeof(PathType) < sizeof(absl::uint128) ||
+       reinterpret_cast<uintptr_t>(paths) % kHwyAlignment == 0) &&
       (reinterpret_cast<uintptr_t>(correction_seeds) % kHwyAlignment == 0) &&
       (reinterpret_cast<uintptr_t>(seeds_out) % kHwyAlignment == 0);
   // Vector type used throughout this function: Largest byte vector available.
@@ -210,7 +261,6 @@ absl::Status EvaluateSeedsHwy(
 
   // Pointer aliases for reading and writing data.
   const uint8_t* seeds_in_ptr = reinterpret_cast<const uint8_t*>(seeds_in);
-  const uint8_t* paths_ptr = reinterpret_cast<const uint8_t*>(paths);
   uint8_t* seeds_out_ptr = reinterpret_cast<uint8_t*>(seeds_out);
   // Four vectors at a time.
   int64_t i = 0;
@@ -221,10 +271,13 @@ absl::Status EvaluateSeedsHwy(
     auto vec_1 = hn::Load(d8, seeds_in_ptr + i + 1 * bytes_per_vec);
     auto vec_2 = hn::Load(d8, seeds_in_ptr + i + 2 * bytes_per_vec);
     auto vec_3 = hn::Load(d8, seeds_in_ptr + i + 3 * bytes_per_vec);
-    const auto path_0 = hn::Load(d8, paths_ptr + i);
-    const auto path_1 = hn::Load(d8, paths_ptr + i + 1 * bytes_per_vec);
-    const auto path_2 = hn::Load(d8, paths_ptr + i + 2 * bytes_per_vec);
-    const auto path_3 = hn::Load(d8, paths_ptr + i + 3 * bytes_per_vec);
+    const auto path_0 = LoadPaths(d8, paths, start_block, blocks_per_vec);
+    const auto path_1 = LoadPaths(d8, paths, start_block + 1 * blocks_per_vec,
+                                  blocks_per_vec);
+    const auto path_2 = LoadPaths(d8, paths, start_block + 2 * blocks_per_vec,
+                                  blocks_per_vec);
+    const auto path_3 = LoadPaths(d8, paths, start_block + 3 * blocks_per_vec,
+                                  blocks_per_vec);
     auto control_mask_0 = MaskFromBools(d64, control_bits_in + start_block);
     auto control_mask_1 =
         MaskFromBools(d64, control_bits_in + start_block + 1 * blocks_per_vec);
@@ -394,7 +447,7 @@ absl::Status EvaluateSeedsHwy(
   for (; i + bytes_per_vec <= num_bytes; i += bytes_per_vec) {
     const int64_t start_block = i / sizeof(absl::uint128);
     auto vec = hn::Load(d8, seeds_in_ptr + i);
-    const auto path = hn::Load(d8, paths_ptr + i);
+    const auto path = LoadPaths(d8, paths, start_block, blocks_per_vec);
     auto control_mask = MaskFromBools(d64, control_bits_in + start_block);
     for (int j = 0; j < num_levels; ++j) {
       const int bit_index = num_levels - j - 1 + paths_rightshift;
@@ -465,17 +518,15 @@ absl::Status EvaluateSeedsHwy(
     // Copy to a buffer first, to ensure we have at least bytes_per_vec bytes
     // to read. Calling MaskedLoad directly instead might lead to out-of-bounds
     // accesses.
-    auto buffer = hwy::AllocateAligned<absl::uint128>(2 * blocks_per_vec);
+    auto buffer = hwy::AllocateAligned<absl::uint128>(blocks_per_vec);
     if (buffer == nullptr) {
       return absl::ResourceExhaustedError("Memory allocation error");
     }
     auto buffer_ptr = reinterpret_cast<uint8_t*>(buffer.get());
     std::copy_n(seeds_in + start_block, remaining_blocks, buffer.get());
-    std::copy_n(paths + start_block, remaining_blocks,
-                buffer.get() + blocks_per_vec);
     const auto load_mask = hn::FirstN(d8, remaining_bytes);
     auto vec = hn::MaskedLoad(load_mask, d8, buffer_ptr);
-    const auto path = hn::MaskedLoad(load_mask, d8, buffer_ptr + bytes_per_vec);
+    const auto path = LoadPaths(d8, paths, start_block, remaining_blocks);
     auto control_mask =
         MaskFromBools(d64, control_bits_in + start_block, remaining_blocks);
     for (int j = 0; j < num_levels; ++j) {
@@ -538,6 +589,36 @@ absl::Status EvaluateSeedsHwy(
   return absl::OkStatus();
 }
 
+absl::Status EvaluateSeedsHwy(
+    int64_t num_seeds, int num_levels, int num_correction_words,
+    const absl::uint128* seeds_in, const bool* control_bits_in,
+    const absl::uint128* paths, int paths_rightshift,
+    const absl::uint128* correction_seeds, const bool* correction_controls_left,
+    const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
+    const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
+    bool* control_bits_out) {
+  return EvaluateSeedsHwyImpl(
+      num_seeds, num_levels, num_correction_words, seeds_in, control_bits_in,
+      paths, paths_rightshift, correction_seeds, correction_controls_left,
+      correction_controls_right, prg_left, prg_right, seeds_out,
+      control_bits_out);
+}
+
+absl::Status EvaluateSeedsUint64Hwy(
+    int64_t num_seeds, int num_levels, int num_correction_words,
+    const absl::uint128* seeds_in, const bool* control_bits_in,
+    const uint64_t* paths, int paths_rightshift,
+    const absl::uint128* correction_seeds, const bool* correction_controls_left,
+    const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
+    const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
+    bool* control_bits_out) {
+  return EvaluateSeedsHwyImpl(
+      num_seeds, num_levels, num_correction_words, seeds_in, control_bits_in,
+      paths, paths_rightshift, correction_seeds, correction_controls_left,
+      correction_controls_right, prg_left, prg_right, seeds_out,
+      control_bits_out);
+}
+
 #endif  // HWY_TARGET == HWY_SCALAR
 
 }  // namespace HWY_NAMESPACE
@@ -548,11 +629,23 @@ HWY_AFTER_NAMESPACE();
 #if HWY_ONCE || HWY_IDE
 namespace distributed_point_functions {
 namespace dpf_internal {
+namespace {
 
-absl::Status EvaluateSeedsNoHwy(
+// Returns whether the `bit_index`-th bit of `path` is set.
+bool IsPathBitSet(absl::uint128 path, int bit_index) {
+  return bit_index < 128 && (path & (absl::uint128{1} << bit_index)) != 0;
+}
+bool IsPathBitSet(uint64_t path, int bit_index) {
+  return bit_index < 64 && (path & (uint64_t{1} << bit_index)) != 0;
+}
+
+// Implementation of both variants of `EvaluateSeedsNoHwy`. `PathType` is
+// either absl::uint128 or uint64_t.
+template <typename PathType>
+absl::Status EvaluateSeedsNoHwyImpl(
     int64_t num_seeds, int num_levels, int num_correction_words,
     const absl::uint128* seeds_in, const bool* control_bits_in,
-    const absl::uint128* paths, int paths_rightshift,
+    const PathType* paths, int paths_rightshift,
     const absl::uint128* correction_seeds, const bool* correction_controls_left,
     const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
     const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
@@ -589,11 +682,7 @@ absl::Status EvaluateSeedsNoHwy(
       // Merge back into result.
       const int bit_index = num_levels - level - 1 + paths_rightshift;
       for (int i = 0; i < current_batch_size; ++i) {
-        path_bits[i] = 0;
-        if (bit_index < 128) {
-          path_bits[i] =
-              ((paths[start_block + i]) & (absl::uint128{1} << bit_index)) != 0;
-        }
+        path_bits[i] = IsPathBitSet(paths[start_block + i], bit_index);
         if (path_bits[i] == 0) {
           seeds_out[start_block + i] = buffer_left[i];
         } else {
@@ -633,7 +722,54 @@ absl::Status EvaluateSeedsNoHwy(
   return absl::OkStatus();
 }
 
+// Checks the number of correction words passed to either variant of
+// `EvaluateSeeds`.
+absl::Status CheckNumCorrectionWords(int64_t num_seeds, int num_levels,
+                                     int num_correction_words) {
+  // Check that we either have one or `num_seeds` correction words per level.
+  if (num_correction_words != num_levels &&
+      num_correction_words != num_levels * num_seeds) {
+    return absl::InvalidArgumentError(
+        "`num_correction_words` must be equal to `num_levels` or `num_levels * "
+        "num_seeds`");
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::Status EvaluateSeedsNoHwy(
+    int64_t num_seeds, int num_levels, int num_correction_words,
+    const absl::uint128* seeds_in, const bool* control_bits_in,
+    const absl::uint128* paths, int paths_rightshift,
+    const absl::uint128* correction_seeds, const bool* correction_controls_left,
+    const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
+    const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
+    bool* control_bits_out) {
+  return EvaluateSeedsNoHwyImpl(
+      num_seeds, num_levels, num_correction_words, seeds_in, control_bits_in,
+      paths, paths_rightshift, correction_seeds, correction_controls_left,
+      correction_controls_right, prg_left, prg_right, seeds_out,
+      control_bits_out);
+}
+
+absl::Status EvaluateSeedsNoHwy(
+    int64_t num_seeds, int num_levels, int num_correction_words,
+    const absl::uint128* seeds_in, const bool* control_bits_in,
+    const uint64_t* paths, int paths_rightshift,
+    const absl::uint128* correction_seeds, const bool* correction_controls_left,
+    const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
+    const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
+    bool* control_bits_out) {
+  return EvaluateSeedsNoHwyImpl(
+      num_seeds, num_levels, num_correction_words, seeds_in, control_bits_in,
+      paths, paths_rightshift, correction_seeds, correction_controls_left,
+      correction_controls_right, prg_left, prg_right, seeds_out,
+      control_bits_out);
+}
+
 HWY_EXPORT(EvaluateSeedsHwy);
+HWY_EXPORT(EvaluateSeedsUint64Hwy);
 
 absl::Status EvaluateSeeds(
     int64_t num_seeds, int num_levels, int num_correction_words,
@@ -643,13 +779,8 @@ absl::Status EvaluateSeeds(
     const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
     const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
     bool* control_bits_out) {
-  // Check that we either have one or `num_seeds` correction words per level.
-  if (num_correction_words != num_levels &&
-      num_correction_words != num_levels * num_seeds) {
-    return absl::InvalidArgumentError(
-        "`num_correction_words` must be equal to `num_levels` or `num_levels * "
-        "num_seeds`");
-  }
+  DPF_RETURN_IF_ERROR(
+      CheckNumCorrectionWords(num_seeds, num_levels, num_correction_words));
   return HWY_DYNAMIC_DISPATCH(EvaluateSeedsHwy)(
       num_seeds, num_levels, num_correction_words, seeds_in, control_bits_in,
       paths, paths_rightshift, correction_seeds, correction_controls_left,
@@ -657,6 +788,23 @@ absl::Status EvaluateSeeds(
       control_bits_out);
 }
 
+absl::Status EvaluateSeeds(
+    int64_t num_seeds, int num_levels, int num_correction_words,
+    const absl::uint128* seeds_in, const bool* control_bits_in,
+    const uint64_t* paths, int paths_rightshift,
+    const absl::uint128* correction_seeds, const bool* correction_controls_left,
+    const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
+    const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
+    bool* control_bits_out) {
+  DPF_RETURN_IF_ERROR(
+      CheckNumCorrectionWords(num_seeds, num_levels, num_correction_words));
+  return HWY_DYNAMIC_DISPATCH(EvaluateSeedsUint64Hwy)(
+      num_seeds, num_levels, num_correction_words, seeds_in, control_bits_in,
+      paths, paths_rightshift, correction_seeds, correction_controls_left,
+      correction_controls_right, prg_left, prg_right, seeds_out,
+      control_bits_out);
+}
+
 }  // namespace dpf_internal
 }  // namespace distributed_point_functions
 #endif
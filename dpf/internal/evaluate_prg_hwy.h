@@ -76,6 +76,18 @@ absl::Status EvaluateSeeds(
     const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
     bool* control_bits_out);
 
+// Same as above, but with 64-bit `paths`, for domains of at most 2^64
+// elements. Halves the memory needed for the paths, and does not require them
+// to be aligned.
+absl::Status EvaluateSeeds(
+    int64_t num_seeds, int num_levels, int num_correction_words,
+    const absl::uint128* seeds_in, const bool* control_bits_in,
+    const uint64_t* paths, int paths_rightshift,
+    const absl::uint128* correction_seeds, const bool* correction_controls_left,
+    const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
+    const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
+    bool* control_bits_out);
+
 // As `EvaluateSeeds`, but does not require any SIMD support.
 absl::Status EvaluateSeedsNoHwy(
     int64_t num_seeds, int num_levels, int num_correction_words,
@@ -85,6 +97,14 @@ absl::Status EvaluateSeedsNoHwy(
     const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
     const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
     bool* control_bits_out);
+absl::Status EvaluateSeedsNoHwy(
+    int64_t num_seeds, int num_levels, int num_correction_words,
+    const absl::uint128* seeds_in, const bool* control_bits_in,
+    const uint64_t* paths, int paths_rightshift,
+    const absl::uint128* correction_seeds, const bool* correction_controls_left,
+    const bool* correction_controls_right, const Aes128FixedKeyHash& prg_left,
+    const Aes128FixedKeyHash& prg_right, absl::uint128* seeds_out,
+    bool* control_bits_out);
 
 }  // namespace dpf_internal
 }  // namespace distributed_point_functions
@@ -14,6 +14,7 @@
 
 #include "dpf/internal/evaluate_prg_hwy.h"
 
+#include <cstdint>
 #include <memory>
 
 #include "absl/numeric/int128.h"
@@ -192,6 +193,118 @@ void TestPathsRightshift() {
   }
 }
 
+void TestUint64PathsMatchUint128Paths(int num_seeds, int num_levels,
+                                      int num_correction_words,
+                                      int paths_rightshift) {
+  // Generate seeds, and the same paths as 64-bit and as 128-bit integers. The
+  // 64-bit paths are deliberately not aligned.
+  hwy::AlignedFreeUniquePtr<absl::uint128[]> seeds_in, paths_128;
+  hwy::AlignedFreeUniquePtr<uint64_t[]> paths_64;
+  hwy::AlignedFreeUniquePtr<bool[]> control_bits_in;
+  seeds_in = hwy::AllocateAligned<absl::uint128>(num_seeds + 1);
+  ASSERT_NE(seeds_in, nullptr);
+  paths_128 = hwy::AllocateAligned<absl::uint128>(num_seeds + 1);
+  ASSERT_NE(paths_128, nullptr);
+  paths_64 = hwy::AllocateAligned<uint64_t>(num_seeds + 1);
+  ASSERT_NE(paths_64, nullptr);
+  control_bits_in = hwy::AllocateAligned<bool>(num_seeds + 1);
+  ASSERT_NE(control_bits_in, nullptr);
+  for (int i = 0; i < num_seeds; ++i) {
+    // All of these are arbitrary.
+    seeds_in[i] = absl::MakeUint128(i, i + 1);
+    paths_64[i + 1] = 0x9e3779b97f4a7c15 * (i + 1);
+    paths_128[i] = paths_64[i + 1];
+    control_bits_in[i] = (i % 7 == 0);
+  }
+
+  // Generate correction words.
+  hwy::AlignedFreeUniquePtr<absl::uint128[]> correction_seeds;
+  hwy::AlignedFreeUniquePtr<bool[]> correction_controls_left,
+      correction_controls_right;
+  correction_seeds =
+      hwy::AllocateAligned<absl::uint128>(num_correction_words + 1);
+  ASSERT_NE(correction_seeds, nullptr);
+  correction_controls_left =
+      hwy::AllocateAligned<bool>(num_correction_words + 1);
+  ASSERT_NE(correction_controls_left, nullptr);
+  correction_controls_right =
+      hwy::AllocateAligned<bool>(num_correction_words + 1);
+  ASSERT_NE(correction_controls_right, nullptr);
+  for (int i = 0; i < num_correction_words; ++i) {
+    correction_seeds[i] = absl::MakeUint128(i + 1, i);
+    correction_controls_left[i] = (i % 23 == 0);
+    correction_controls_right[i] = (i % 42 != 0);
+  }
+
+  // Set up PRGs.
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto prg_left,
+      distributed_point_functions::Aes128FixedKeyHash::Create(kKey0));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto prg_right,
+      distributed_point_functions::Aes128FixedKeyHash::Create(kKey1));
+
+  // Evaluate with both path types, with and without Highway.
+  hwy::AlignedFreeUniquePtr<absl::uint128[]> seeds_out_64, seeds_out_64_no_hwy,
+      seeds_out_128;
+  hwy::AlignedFreeUniquePtr<bool[]> control_bits_out_64,
+      control_bits_out_64_no_hwy, control_bits_out_128;
+  seeds_out_64 = hwy::AllocateAligned<absl::uint128>(num_seeds + 1);
+  ASSERT_NE(seeds_out_64, nullptr);
+  seeds_out_64_no_hwy = hwy::AllocateAligned<absl::uint128>(num_seeds + 1);
+  ASSERT_NE(seeds_out_64_no_hwy, nullptr);
+  seeds_out_128 = hwy::AllocateAligned<absl::uint128>(num_seeds + 1);
+  ASSERT_NE(seeds_out_128, nullptr);
+  control_bits_out_64 = hwy::AllocateAligned<bool>(num_seeds + 1);
+  ASSERT_NE(control_bits_out_64, nullptr);
+  control_bits_out_64_no_hwy = hwy::AllocateAligned<bool>(num_seeds + 1);
+  ASSERT_NE(control_bits_out_64_no_hwy, nullptr);
+  control_bits_out_128 = hwy::AllocateAligned<bool>(num_seeds + 1);
+  ASSERT_NE(control_bits_out_128, nullptr);
+  DPF_ASSERT_OK(EvaluateSeeds(
+      num_seeds, num_levels, num_correction_words, seeds_in.get(),
+      control_bits_in.get(), paths_64.get() + 1, paths_rightshift,
+      correction_seeds.get(), correction_controls_left.get(),
+      correction_controls_right.get(), prg_left, prg_right, seeds_out_64.get(),
+      control_bits_out_64.get()));
+  DPF_ASSERT_OK(EvaluateSeedsNoHwy(
+      num_seeds, num_levels, num_correction_words, seeds_in.get(),
+      control_bits_in.get(), paths_64.get() + 1, paths_rightshift,
+      correction_seeds.get(), correction_controls_left.get(),
+      correction_controls_right.get(), prg_left, prg_right,
+      seeds_out_64_no_hwy.get(), control_bits_out_64_no_hwy.get()));
+  DPF_ASSERT_OK(EvaluateSeeds(
+      num_seeds, num_levels, num_correction_words, seeds_in.get(),
+      control_bits_in.get(), paths_128.get(), paths_rightshift,
+      correction_seeds.get(), correction_controls_left.get(),
+      correction_controls_right.get(), prg_left, prg_right,
+      seeds_out_128.get(), control_bits_out_128.get()));
+
+  // Check that all evaluations are equal, if there was anything to evaluate.
+  if (num_levels > 0) {
+    for (int i = 0; i < num_seeds; ++i) {
+      EXPECT_EQ(seeds_out_64[i], seeds_out_128[i]);
+      EXPECT_EQ(control_bits_out_64[i], control_bits_out_128[i]);
+      EXPECT_EQ(seeds_out_64_no_hwy[i], seeds_out_128[i]);
+      EXPECT_EQ(control_bits_out_64_no_hwy[i], control_bits_out_128[i]);
+    }
+  }
+}
+
+void TestUint64Paths() {
+  for (int num_seeds : {0, 1, 2, 101, 128, 1000}) {
+    for (int num_levels : {0, 1, 2, 32, 63, 64}) {
+      for (int num_correction_words : {num_levels, num_levels * num_seeds}) {
+        for (int paths_rightshift : {0, 1, 64 - num_levels, 64}) {
+          TestUint64PathsMatchUint128Paths(num_seeds, num_levels,
+                                           num_correction_words,
+                                           paths_rightshift);
+        }
+      }
+    }
+  }
+}
+
 void FailsIfNumCorrectionWordsIsWrong() {
   constexpr int num_seeds = 1000;
   constexpr int num_levels = 10;
@@ -245,6 +358,7 @@ namespace dpf_internal {
 HWY_BEFORE_TEST(EvaluatePrgHwyTest);
 HWY_EXPORT_AND_TEST_P(EvaluatePrgHwyTest, TestAll);
 HWY_EXPORT_AND_TEST_P(EvaluatePrgHwyTest, TestPathsRightshift);
+HWY_EXPORT_AND_TEST_P(EvaluatePrgHwyTest, TestUint64Paths);
 HWY_EXPORT_AND_TEST_P(EvaluatePrgHwyTest, FailsIfNumCorrectionWordsIsWrong);
 }  // namespace dpf_internal
 }  // namespace distributed_point_functions
@@ -0,0 +1,205 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/internal/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+
+namespace {
+
+int64_t PageSize() {
+  static const int64_t page_size = sysconf(_SC_PAGESIZE);
+  return page_size;
+}
+
+absl::Status ErrnoError(absl::string_view operation,
+                        absl::string_view path) {
+  return absl::ErrnoToStatus(errno, absl::StrCat(operation, " ", path));
+}
+
+}  // namespace
+
+MappedFile::Window::Window(Window&& other) noexcept
+    : mapping_(std::exchange(other.mapping_, nullptr)),
+      mapping_size_(std::exchange(other.mapping_size_, 0)),
+      data_(std::exchange(other.data_, absl::string_view())) {}
+
+MappedFile::Window& MappedFile::Window::operator=(Window&& other) noexcept {
+  if (this != &other) {
+    if (mapping_ != nullptr) {
+      munmap(mapping_, mapping_size_);
+    }
+    mapping_ = std::exchange(other.mapping_, nullptr);
+    mapping_size_ = std::exchange(other.mapping_size_, 0);
+    data_ = std::exchange(other.data_, absl::string_view());
+  }
+  return *this;
+}
+
+MappedFile::Window::~Window() {
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapping_size_);
+  }
+}
+
+absl::StatusOr<MappedFile> MappedFile::Create(const std::string& path) {
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return ErrnoError("Failed to create", path);
+  }
+  return MappedFile(fd, 0, path);
+}
+
+absl::StatusOr<MappedFile> MappedFile::CreateTemporary(
+    const std::string& directory) {
+  std::string path_template = absl::StrCat(directory, "/dpf_scratch_XXXXXX");
+  std::vector<char> path(path_template.begin(), path_template.end());
+  path.push_back('\0');
+  int fd = mkstemp(path.data());
+  if (fd < 0) {
+    return ErrnoError("Failed to create temporary file in", directory);
+  }
+  // Unlinking right away makes sure the file is deleted even if the process
+  // dies. The data stays accessible through `fd` until it is closed.
+  if (unlink(path.data()) != 0) {
+    absl::Status status = ErrnoError("Failed to unlink", path.data());
+    close(fd);
+    return status;
+  }
+  return MappedFile(fd, 0, path.data());
+}
+
+absl::StatusOr<MappedFile> MappedFile::Open(const std::string& path) {
+  return OpenWithFlags(path, O_RDWR | O_CLOEXEC);
+}
+
+absl::StatusOr<MappedFile> MappedFile::OpenReadOnly(const std::string& path) {
+  return OpenWithFlags(path, O_RDONLY | O_CLOEXEC);
+}
+
+absl::StatusOr<MappedFile> MappedFile::OpenWithFlags(const std::string& path,
+                                                     int flags) {
+  int fd = open(path.c_str(), flags);
+  if (fd < 0) {
+    return ErrnoError("Failed to open", path);
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    absl::Status status = ErrnoError("Failed to stat", path);
+    close(fd);
+    return status;
+  }
+  return MappedFile(fd, file_stat.st_size, path,
+                    /*read_only=*/(flags & O_ACCMODE) == O_RDONLY);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : fd_(std::exchange(other.fd_, -1)),
+      size_(std::exchange(other.size_, 0)),
+      path_(std::move(other.path_)),
+      read_only_(other.read_only_) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+    fd_ = std::exchange(other.fd_, -1);
+    size_ = std::exchange(other.size_, 0);
+    path_ = std::move(other.path_);
+    read_only_ = other.read_only_;
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+absl::Status MappedFile::Append(absl::string_view data) {
+  if (read_only_) {
+    return absl::FailedPreconditionError(
+        absl::StrCat("Cannot append to ", path_, ", which is read-only"));
+  }
+  if (data.empty()) {
+    return absl::OkStatus();
+  }
+  const int64_t new_size = size_ + static_cast<int64_t>(data.size());
+  if (ftruncate(fd_, new_size) != 0) {
+    return ErrnoError("Failed to extend", path_);
+  }
+  // Mappings must start at a page boundary.
+  const int64_t map_offset = size_ - size_ % PageSize();
+  const size_t map_size = new_size - map_offset;
+  void* mapping =
+      mmap(nullptr, map_size, PROT_WRITE, MAP_SHARED, fd_, map_offset);
+  if (mapping == MAP_FAILED) {
+    return ErrnoError("Failed to map", path_);
+  }
+  std::memcpy(static_cast<char*>(mapping) + (size_ - map_offset), data.data(),
+              data.size());
+  munmap(mapping, map_size);
+  size_ = new_size;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<MappedFile::Window> MappedFile::Map(int64_t offset,
+                                                   int64_t length) const {
+  if (offset < 0 || length < 0 || offset > size_ || length > size_ - offset) {
+    return absl::OutOfRangeError(
+        absl::StrCat("Range [", offset, ", ", offset + length,
+                     ") is not contained in file of size ", size_));
+  }
+  if (length == 0) {
+    return Window();
+  }
+  const int64_t map_offset = offset - offset % PageSize();
+  const size_t map_size = offset + length - map_offset;
+  void* mapping = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd_,
+                       map_offset);
+  if (mapping == MAP_FAILED) {
+    return ErrnoError("Failed to map", path_);
+  }
+  // Only a hint, so failures are ignored.
+  madvise(mapping, map_size, MADV_SEQUENTIAL);
+  return Window(
+      mapping, map_size,
+      absl::string_view(static_cast<const char*>(mapping) +
+                            (offset - map_offset),
+                        length));
+}
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_MAPPED_FILE_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+
+// A file that is written by appending and read through memory-mapped windows
+// of bounded size, so that its size is not limited by the available memory.
+// Appends are also done through memory mappings, so writing is sequential and
+// left to the kernel's writeback. Only supported on POSIX systems.
+//
+// MappedFile is not thread-safe.
+class MappedFile {
+ public:
+  // A read-only memory-mapped window of a MappedFile. Stays valid when the
+  // MappedFile is destroyed or appended to.
+  class Window {
+   public:
+    Window() = default;
+    Window(Window&& other) noexcept;
+    Window& operator=(Window&& other) noexcept;
+    ~Window();
+
+    absl::string_view data() const { return data_; }
+
+   private:
+    friend class MappedFile;
+    Window(void* mapping, size_t mapping_size, absl::string_view data)
+        : mapping_(mapping), mapping_size_(mapping_size), data_(data) {}
+
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    absl::string_view data_;
+  };
+
+  // Creates an empty file at `path`, truncating any existing file.
+  //
+  // Returns an error corresponding to `errno` if the file cannot be created.
+  static absl::StatusOr<MappedFile> Create(const std::string& path);
+
+  // Creates an empty file in `directory`, which is deleted as soon as the
+  // returned MappedFile is destroyed.
+  //
+  // Returns an error corresponding to `errno` if the file cannot be created.
+  static absl::StatusOr<MappedFile> CreateTemporary(
+      const std::string& directory);
+
+  // Opens the existing file at `path`. Appends go to the end of the file.
+  //
+  // Returns an error corresponding to `errno` if the file cannot be opened.
+  static absl::StatusOr<MappedFile> Open(const std::string& path);
+
+  // Opens the existing file at `path` for reading only. `Append` fails with
+  // FAILED_PRECONDITION on the returned MappedFile.
+  //
+  // Returns an error corresponding to `errno` if the file cannot be opened.
+  static absl::StatusOr<MappedFile> OpenReadOnly(const std::string& path);
+
+  // MappedFile is movable but not copyable.
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  // Returns the size of the file in bytes.
+  int64_t size() const { return size_; }
+
+  // Appends `data` to the end of the file.
+  //
+  // Returns FAILED_PRECONDITION if the file was opened read-only, or an error
+  // corresponding to `errno` if the file cannot be extended or mapped.
+  absl::Status Append(absl::string_view data);
+
+  // Maps `length` bytes of the file starting at `offset` for reading. The
+  // mapping is advised for sequential access.
+  //
+  // Returns OUT_OF_RANGE if the range is not contained in the file, or an error
+  // corresponding to `errno` if mapping fails.
+  absl::StatusOr<Window> Map(int64_t offset, int64_t length) const;
+
+ private:
+  MappedFile(int fd, int64_t size, std::string path, bool read_only = false)
+      : fd_(fd), size_(size), path_(std::move(path)), read_only_(read_only) {}
+
+  // Opens `path` with the given `flags` and determines its size.
+  static absl::StatusOr<MappedFile> OpenWithFlags(const std::string& path,
+                                                  int flags);
+
+  int fd_ = -1;
+  int64_t size_ = 0;
+  // Only used in error messages.
+  std::string path_;
+  bool read_only_ = false;
+};
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_MAPPED_FILE_H_
@@ -0,0 +1,122 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/internal/mapped_file.h"
+
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+namespace {
+
+using ::testing::Eq;
+
+// Larger than a page, and not a multiple of the page size.
+std::string TestData() {
+  std::string data;
+  for (int i = 0; i < 10000; ++i) {
+    data += static_cast<char>('a' + i % 26);
+  }
+  return data;
+}
+
+TEST(MappedFileTest, AppendAndMapRoundTrip) {
+  DPF_ASSERT_OK_AND_ASSIGN(MappedFile file,
+                           MappedFile::CreateTemporary(::testing::TempDir()));
+  EXPECT_EQ(file.size(), 0);
+
+  // Append in pieces that don't start at page boundaries.
+  std::string data = TestData();
+  for (int start = 0; start < static_cast<int>(data.size()); start += 1234) {
+    DPF_ASSERT_OK(file.Append(absl::string_view(data).substr(start, 1234)));
+  }
+  EXPECT_EQ(file.size(), data.size());
+
+  DPF_ASSERT_OK_AND_ASSIGN(MappedFile::Window window,
+                           file.Map(0, data.size()));
+  EXPECT_EQ(window.data(), data);
+  DPF_ASSERT_OK_AND_ASSIGN(window, file.Map(5000, 3333));
+  EXPECT_EQ(window.data(), absl::string_view(data).substr(5000, 3333));
+}
+
+TEST(MappedFileTest, WindowOutlivesFile) {
+  std::string data = TestData();
+  MappedFile::Window window;
+  {
+    DPF_ASSERT_OK_AND_ASSIGN(MappedFile file,
+                             MappedFile::CreateTemporary(::testing::TempDir()));
+    DPF_ASSERT_OK(file.Append(data));
+    DPF_ASSERT_OK_AND_ASSIGN(window, file.Map(100, 200));
+  }
+  EXPECT_EQ(window.data(), absl::string_view(data).substr(100, 200));
+}
+
+TEST(MappedFileTest, OpenReadsExistingFile) {
+  std::string path = absl::StrCat(::testing::TempDir(), "/mapped_file_test");
+  std::string data = TestData();
+  {
+    DPF_ASSERT_OK_AND_ASSIGN(MappedFile file, MappedFile::Create(path));
+    DPF_ASSERT_OK(file.Append(data));
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(MappedFile file, MappedFile::Open(path));
+  EXPECT_EQ(file.size(), data.size());
+  DPF_ASSERT_OK(file.Append("xyz"));
+  DPF_ASSERT_OK_AND_ASSIGN(MappedFile::Window window,
+                           file.Map(data.size() - 1, 4));
+  EXPECT_EQ(window.data(), absl::StrCat(data.substr(data.size() - 1), "xyz"));
+
+  // Create truncates.
+  DPF_ASSERT_OK_AND_ASSIGN(file, MappedFile::Create(path));
+  EXPECT_EQ(file.size(), 0);
+}
+
+TEST(MappedFileTest, OpenReadOnlyFailsToAppend) {
+  std::string path = absl::StrCat(::testing::TempDir(), "/mapped_file_test");
+  {
+    DPF_ASSERT_OK_AND_ASSIGN(MappedFile file, MappedFile::Create(path));
+    DPF_ASSERT_OK(file.Append("abc"));
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(MappedFile file, MappedFile::OpenReadOnly(path));
+  DPF_ASSERT_OK_AND_ASSIGN(MappedFile::Window window, file.Map(0, 3));
+  EXPECT_EQ(window.data(), "abc");
+  EXPECT_THAT(file.Append("d"),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST(MappedFileTest, MapFailsOutOfRange) {
+  DPF_ASSERT_OK_AND_ASSIGN(MappedFile file,
+                           MappedFile::CreateTemporary(::testing::TempDir()));
+  DPF_ASSERT_OK(file.Append("abc"));
+  EXPECT_THAT(file.Map(2, 2), StatusIs(absl::StatusCode::kOutOfRange));
+  EXPECT_THAT(file.Map(-1, 1), StatusIs(absl::StatusCode::kOutOfRange));
+  DPF_ASSERT_OK_AND_ASSIGN(MappedFile::Window window, file.Map(3, 0));
+  EXPECT_THAT(window.data().size(), Eq(0));
+}
+
+TEST(MappedFileTest, OpenFailsIfFileDoesNotExist) {
+  EXPECT_THAT(MappedFile::Open(absl::StrCat(::testing::TempDir(),
+                                            "/does_not_exist")),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+}  // namespace
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
@@ -0,0 +1,204 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/internal/memory_counters.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include "absl/base/config.h"
+#include "benchmark/benchmark.h"  // third_party/benchmark
+
+// Sanitizers interpose malloc themselves.
+#if defined(__GLIBC__) && !defined(ABSL_HAVE_ADDRESS_SANITIZER) && \
+    !defined(ABSL_HAVE_MEMORY_SANITIZER) &&                         \
+    !defined(ABSL_HAVE_THREAD_SANITIZER)
+#define DPF_INTERNAL_COUNT_ALLOCATIONS 1
+#include <malloc.h>
+#endif
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+
+namespace {
+
+// Constant-initialized, so they can be used by allocations made during static
+// initialization.
+std::atomic<int64_t> num_allocations{0};
+std::atomic<int64_t> bytes_allocated{0};
+std::atomic<int64_t> live_bytes{0};
+std::atomic<int64_t> peak_live_bytes{0};
+
+}  // namespace
+
+#ifdef DPF_INTERNAL_COUNT_ALLOCATIONS
+
+namespace {
+
+// Allocations are accounted with their usable size, so that frees, which
+// don't know the requested size, can be accounted consistently.
+void RecordAllocation(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  int64_t size = malloc_usable_size(ptr);
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+  int64_t live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+  int64_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+  while (live > peak && !peak_live_bytes.compare_exchange_weak(
+                            peak, live, std::memory_order_relaxed)) {
+  }
+}
+
+void RecordDeallocation(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  live_bytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+}
+
+}  // namespace
+
+#endif  // DPF_INTERNAL_COUNT_ALLOCATIONS
+
+bool AllocationCountingSupported() {
+#ifdef DPF_INTERNAL_COUNT_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+AllocationStats GetAllocationStats() {
+  AllocationStats stats;
+  stats.num_allocations = num_allocations.load(std::memory_order_relaxed);
+  stats.bytes_allocated = bytes_allocated.load(std::memory_order_relaxed);
+  stats.live_bytes = live_bytes.load(std::memory_order_relaxed);
+  stats.peak_live_bytes = peak_live_bytes.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void ResetPeakLiveBytes() {
+  peak_live_bytes.store(live_bytes.load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+}
+
+MemoryCounters::MemoryCounters(benchmark::State& state) : state_(state) {
+  ResetPeakLiveBytes();
+  start_ = GetAllocationStats();
+}
+
+MemoryCounters::~MemoryCounters() {
+  AllocationStats end = GetAllocationStats();
+  state_.counters["allocs_per_iter"] =
+      benchmark::Counter(end.num_allocations - start_.num_allocations,
+                         benchmark::Counter::kAvgIterations);
+  state_.counters["bytes_allocated_per_iter"] = benchmark::Counter(
+      end.bytes_allocated - start_.bytes_allocated,
+      benchmark::Counter::kAvgIterations, benchmark::Counter::kIs1024);
+  state_.counters["peak_live_bytes"] =
+      benchmark::Counter(end.peak_live_bytes - start_.live_bytes,
+                         benchmark::Counter::kDefaults,
+                         benchmark::Counter::kIs1024);
+}
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+
+#ifdef DPF_INTERNAL_COUNT_ALLOCATIONS
+
+// Interpose the glibc allocation functions. Since these definitions are part
+// of the executable, they take precedence over the ones in libc, including for
+// calls from other shared libraries such as libstdc++'s operator new.
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void* __libc_valloc(size_t size);
+void* __libc_pvalloc(size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size) noexcept {
+  void* result = __libc_malloc(size);
+  distributed_point_functions::dpf_internal::RecordAllocation(result);
+  return result;
+}
+
+void* calloc(size_t num, size_t size) noexcept {
+  void* result = __libc_calloc(num, size);
+  distributed_point_functions::dpf_internal::RecordAllocation(result);
+  return result;
+}
+
+void* realloc(void* ptr, size_t size) noexcept {
+  size_t old_size = ptr == nullptr ? 0 : malloc_usable_size(ptr);
+  void* result = __libc_realloc(ptr, size);
+  if (result == nullptr && size != 0) {
+    // Reallocation failed, and `ptr` is still valid.
+    return result;
+  }
+  distributed_point_functions::dpf_internal::live_bytes.fetch_sub(
+      old_size, std::memory_order_relaxed);
+  distributed_point_functions::dpf_internal::RecordAllocation(result);
+  return result;
+}
+
+void* memalign(size_t alignment, size_t size) noexcept {
+  void* result = __libc_memalign(alignment, size);
+  distributed_point_functions::dpf_internal::RecordAllocation(result);
+  return result;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size) noexcept {
+  if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+    return EINVAL;
+  }
+  void* ptr = memalign(alignment, size);
+  if (ptr == nullptr) {
+    return ENOMEM;
+  }
+  *result = ptr;
+  return 0;
+}
+
+void* valloc(size_t size) noexcept {
+  void* result = __libc_valloc(size);
+  distributed_point_functions::dpf_internal::RecordAllocation(result);
+  return result;
+}
+
+void* pvalloc(size_t size) noexcept {
+  void* result = __libc_pvalloc(size);
+  distributed_point_functions::dpf_internal::RecordAllocation(result);
+  return result;
+}
+
+void free(void* ptr) noexcept {
+  distributed_point_functions::dpf_internal::RecordDeallocation(ptr);
+  __libc_free(ptr);
+}
+
+}  // extern "C"
+
+#endif  // DPF_INTERNAL_COUNT_ALLOCATIONS
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_MEMORY_COUNTERS_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_MEMORY_COUNTERS_H_
+
+#include <cstdint>
+
+#include "benchmark/benchmark.h"  // third_party/benchmark
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+
+// Process-wide heap allocation statistics. Linking this library interposes
+// malloc and friends, so that allocations made through operator new as well as
+// through hwy::AllocateAligned are counted. Counting is only supported with
+// glibc; elsewhere, all statistics stay zero.
+struct AllocationStats {
+  // Number of allocations since the process started.
+  int64_t num_allocations = 0;
+  // Total number of bytes allocated since the process started.
+  int64_t bytes_allocated = 0;
+  // Number of bytes currently allocated.
+  int64_t live_bytes = 0;
+  // Maximum of `live_bytes` since the last call to ResetPeakLiveBytes.
+  int64_t peak_live_bytes = 0;
+};
+
+// Returns true if allocations are being counted on this platform.
+bool AllocationCountingSupported();
+
+// Returns a snapshot of the current statistics.
+AllocationStats GetAllocationStats();
+
+// Resets `peak_live_bytes` to the current `live_bytes`.
+void ResetPeakLiveBytes();
+
+// Reports the heap allocations made during a benchmark run as counters of
+// `state`. Must be created right before the benchmark loop, and reports when it
+// goes out of scope:
+//
+//   void BM_Foo(benchmark::State& state) {
+//     ... setup ...
+//     dpf_internal::MemoryCounters memory_counters(state);
+//     for (auto _ : state) {
+//       ...
+//     }
+//   }
+//
+// Reports the following counters:
+//   - `allocs_per_iter`: Number of allocations per iteration.
+//   - `bytes_allocated_per_iter`: Bytes allocated per iteration.
+//   - `peak_live_bytes`: Maximum number of bytes allocated at the same time
+//     during the run, on top of what was allocated when `state` was created.
+//
+// Allocations are counted process-wide, so benchmarks running on several
+// threads should only create a MemoryCounters on `state.thread_index() == 0`.
+class MemoryCounters {
+ public:
+  explicit MemoryCounters(benchmark::State& state);
+  ~MemoryCounters();
+
+  MemoryCounters(const MemoryCounters&) = delete;
+  MemoryCounters& operator=(const MemoryCounters&) = delete;
+
+ private:
+  benchmark::State& state_;
+  AllocationStats start_;
+};
+
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DPF_INTERNAL_MEMORY_COUNTERS_H_
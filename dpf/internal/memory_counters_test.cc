@@ -0,0 +1,108 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/internal/memory_counters.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "benchmark/benchmark.h"  // third_party/benchmark
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "hwy/aligned_allocator.h"
+
+namespace distributed_point_functions {
+namespace dpf_internal {
+namespace {
+
+using ::testing::Ge;
+
+constexpr int kSize = 1 << 20;
+
+class MemoryCountersTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (!AllocationCountingSupported()) {
+      GTEST_SKIP() << "Allocation counting not supported on this platform";
+    }
+  }
+};
+
+TEST_F(MemoryCountersTest, CountsOperatorNew) {
+  AllocationStats before = GetAllocationStats();
+  auto buffer = std::make_unique<std::vector<char>>(kSize);
+  benchmark::DoNotOptimize(buffer->data());
+  AllocationStats during = GetAllocationStats();
+  buffer.reset();
+  AllocationStats after = GetAllocationStats();
+
+  // The unique_ptr and the vector's buffer.
+  EXPECT_EQ(during.num_allocations - before.num_allocations, 2);
+  EXPECT_THAT(during.bytes_allocated - before.bytes_allocated, Ge(kSize));
+  EXPECT_THAT(during.live_bytes - before.live_bytes, Ge(kSize));
+  EXPECT_EQ(after.live_bytes, before.live_bytes);
+}
+
+TEST_F(MemoryCountersTest, CountsAlignedAllocations) {
+  AllocationStats before = GetAllocationStats();
+  auto buffer = hwy::AllocateAligned<absl::uint128>(kSize);
+  benchmark::DoNotOptimize(buffer.get());
+  AllocationStats during = GetAllocationStats();
+  buffer.reset();
+  AllocationStats after = GetAllocationStats();
+
+  EXPECT_THAT(during.bytes_allocated - before.bytes_allocated,
+              Ge(kSize * sizeof(absl::uint128)));
+  EXPECT_EQ(after.live_bytes, before.live_bytes);
+}
+
+TEST_F(MemoryCountersTest, CountsRealloc) {
+  AllocationStats before = GetAllocationStats();
+  void* ptr = std::malloc(16);
+  ptr = std::realloc(ptr, kSize);
+  ASSERT_NE(ptr, nullptr);
+  AllocationStats during = GetAllocationStats();
+  std::free(ptr);
+  AllocationStats after = GetAllocationStats();
+
+  EXPECT_EQ(during.num_allocations - before.num_allocations, 2);
+  EXPECT_THAT(during.live_bytes - before.live_bytes, Ge(kSize));
+  EXPECT_LT(during.live_bytes - before.live_bytes, 2 * kSize);
+  EXPECT_EQ(after.live_bytes, before.live_bytes);
+}
+
+TEST_F(MemoryCountersTest, TracksPeakLiveBytes) {
+  ResetPeakLiveBytes();
+  AllocationStats before = GetAllocationStats();
+  EXPECT_EQ(before.peak_live_bytes, before.live_bytes);
+  {
+    std::vector<char> buffer(kSize);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  AllocationStats after = GetAllocationStats();
+
+  EXPECT_EQ(after.live_bytes, before.live_bytes);
+  EXPECT_THAT(after.peak_live_bytes - before.live_bytes, Ge(kSize));
+
+  ResetPeakLiveBytes();
+  AllocationStats reset = GetAllocationStats();
+  EXPECT_EQ(reset.peak_live_bytes, reset.live_bytes);
+}
+
+}  // namespace
+}  // namespace dpf_internal
+}  // namespace distributed_point_functions
@@ -0,0 +1,546 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/key_file.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/internal/mapped_file.h"
+#include "dpf/internal/maybe_deref_span.h"
+#include "dpf/internal/proto_validator.h"
+#include "dpf/internal/value_type_helpers.h"
+#include "dpf/status_macros.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+
+namespace distributed_point_functions {
+
+namespace {
+
+constexpr absl::string_view kMagic("DPFKEYS\0", 8);
+
+// Size of the magic, format version and header size.
+constexpr int64_t kPreambleSize = 16;
+
+// Size of a Block in a key record.
+constexpr int kBlockSize = 16;
+
+void WriteLittleEndian(absl::uint128 value, int num_bytes, char* out) {
+  for (int i = 0; i < num_bytes; ++i) {
+    out[i] = static_cast<char>(absl::Uint128Low64(value) & 0xff);
+    value >>= 8;
+  }
+}
+
+absl::uint128 ReadLittleEndian(const char* in, int num_bytes) {
+  absl::uint128 result = 0;
+  for (int i = num_bytes - 1; i >= 0; --i) {
+    result = (result << 8) | static_cast<uint8_t>(in[i]);
+  }
+  return result;
+}
+
+void AppendUint32(uint32_t value, std::string& out) {
+  char bytes[4];
+  WriteLittleEndian(value, 4, bytes);
+  out.append(bytes, 4);
+}
+
+void WriteBlock(const Block& block, char* out) {
+  WriteLittleEndian(block.low(), 8, out);
+  WriteLittleEndian(block.high(), 8, out + 8);
+}
+
+void ReadBlock(const char* in, Block& block) {
+  block.set_low(absl::Uint128Low64(ReadLittleEndian(in, 8)));
+  block.set_high(absl::Uint128Low64(ReadLittleEndian(in + 8, 8)));
+}
+
+// Returns the number of bytes used for an integer of the given `bitsize`.
+int IntegerSize(int bitsize) { return std::max(1, bitsize / 8); }
+
+// Returns the number of bytes used for a value of `value_type`.
+int64_t ValueSize(const ValueType& value_type) {
+  switch (value_type.type_case()) {
+    case ValueType::kInteger:
+      return IntegerSize(value_type.integer().bitsize());
+    case ValueType::kXorWrapper:
+      return IntegerSize(value_type.xor_wrapper().bitsize());
+    case ValueType::kIntModN:
+      return IntegerSize(value_type.int_mod_n().base_integer().bitsize());
+    case ValueType::kTuple: {
+      int64_t size = 0;
+      for (const ValueType& element : value_type.tuple().elements()) {
+        size += ValueSize(element);
+      }
+      return size;
+    }
+    default:
+      return 0;
+  }
+}
+
+// Returns true if values of `value_type` are converted directly from
+// pseudorandom bytes, i.e., if they don't contain an IntModN.
+bool CanBeConvertedDirectly(const ValueType& value_type) {
+  switch (value_type.type_case()) {
+    case ValueType::kInteger:
+    case ValueType::kXorWrapper:
+      return true;
+    case ValueType::kTuple:
+      return std::all_of(value_type.tuple().elements().begin(),
+                         value_type.tuple().elements().end(),
+                         CanBeConvertedDirectly);
+    default:
+      return false;
+  }
+}
+
+// Returns the number of values of `value_type` that are packed into a single
+// block, which is also the number of values in each value correction. Mirrors
+// dpf_internal::ElementsPerBlock<T>() for the C++ type T corresponding to
+// `value_type`.
+int ValuesPerBlock(const ValueType& value_type) {
+  const int64_t total_bit_size = 8 * ValueSize(value_type);
+  if (!CanBeConvertedDirectly(value_type) || total_bit_size > 128) {
+    return 1;
+  }
+  return static_cast<int>(128 / total_bit_size);
+}
+
+absl::Status EncodeInteger(const Value::Integer& value, int bitsize,
+                           char*& out) {
+  DPF_ASSIGN_OR_RETURN(absl::uint128 integer,
+                       dpf_internal::ValueIntegerToUint128(value));
+  int size = IntegerSize(bitsize);
+  if (size < 16 && (integer >> (8 * size)) != 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Value does not fit in ", size, " bytes"));
+  }
+  WriteLittleEndian(integer, size, out);
+  out += size;
+  return absl::OkStatus();
+}
+
+absl::Status EncodeValue(const Value& value, const ValueType& value_type,
+                         char*& out) {
+  switch (value_type.type_case()) {
+    case ValueType::kInteger:
+      if (value.value_case() == Value::kInteger) {
+        return EncodeInteger(value.integer(), value_type.integer().bitsize(),
+                             out);
+      }
+      break;
+    case ValueType::kXorWrapper:
+      if (value.value_case() == Value::kXorWrapper) {
+        return EncodeInteger(value.xor_wrapper(),
+                             value_type.xor_wrapper().bitsize(), out);
+      }
+      break;
+    case ValueType::kIntModN:
+      if (value.value_case() == Value::kIntModN) {
+        return EncodeInteger(value.int_mod_n(),
+                             value_type.int_mod_n().base_integer().bitsize(),
+                             out);
+      }
+      break;
+    case ValueType::kTuple:
+      if (value.value_case() == Value::kTuple &&
+          value.tuple().elements_size() ==
+              value_type.tuple().elements_size()) {
+        for (int i = 0; i < value_type.tuple().elements_size(); ++i) {
+          DPF_RETURN_IF_ERROR(EncodeValue(value.tuple().elements(i),
+                                          value_type.tuple().elements(i),
+                                          out));
+        }
+        return absl::OkStatus();
+      }
+      break;
+    default:
+      break;
+  }
+  return absl::InvalidArgumentError("Value does not match value type");
+}
+
+void DecodeValue(const ValueType& value_type, const char*& in, Value& value) {
+  auto decode_integer = [&in](int bitsize, Value::Integer& integer) {
+    int size = IntegerSize(bitsize);
+    integer =
+        dpf_internal::Uint128ToValueInteger(ReadLittleEndian(in, size));
+    in += size;
+  };
+  switch (value_type.type_case()) {
+    case ValueType::kInteger:
+      decode_integer(value_type.integer().bitsize(), *value.mutable_integer());
+      break;
+    case ValueType::kXorWrapper:
+      decode_integer(value_type.xor_wrapper().bitsize(),
+                     *value.mutable_xor_wrapper());
+      break;
+    case ValueType::kIntModN:
+      decode_integer(value_type.int_mod_n().base_integer().bitsize(),
+                     *value.mutable_int_mod_n());
+      break;
+    case ValueType::kTuple:
+      for (const ValueType& element : value_type.tuple().elements()) {
+        DecodeValue(element, in, *value.mutable_tuple()->add_elements());
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+absl::StatusOr<std::string> SerializeDeterministically(
+    const DpfParameters& parameters) {
+  std::string result;
+  {  // Start new block so that stream destructors are run before returning.
+    ::google::protobuf::io::StringOutputStream string_stream(&result);
+    ::google::protobuf::io::CodedOutputStream coded_stream(&string_stream);
+    coded_stream.SetSerializationDeterministic(true);
+    if (!parameters.SerializeToCodedStream(&coded_stream)) {
+      return absl::InternalError("Serializing parameters to string failed");
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+namespace dpf_internal {
+
+// Computes the layout of key records from the DPF parameters, and converts
+// between DpfKeys and key records.
+class KeyRecordLayout {
+ public:
+  static absl::StatusOr<std::unique_ptr<const KeyRecordLayout>> Create(
+      absl::Span<const DpfParameters> parameters) {
+    DPF_ASSIGN_OR_RETURN(std::unique_ptr<ProtoValidator> validator,
+                         ProtoValidator::Create(parameters));
+    auto layout = absl::WrapUnique(new KeyRecordLayout);
+    const std::vector<int>& hierarchy_to_tree = validator->hierarchy_to_tree();
+    const int num_levels = static_cast<int>(parameters.size());
+    layout->num_correction_words_ = hierarchy_to_tree.back();
+    layout->correction_word_level_.assign(layout->num_correction_words_, -1);
+    layout->record_size_ = kBlockSize;
+    for (int i = 0; i < num_levels; ++i) {
+      const ValueType& value_type = parameters[i].value_type();
+      layout->value_types_.push_back(value_type);
+      layout->values_per_level_.push_back(ValuesPerBlock(value_type));
+      // The last hierarchy level is stored in last_level_value_correction.
+      if (i < num_levels - 1) {
+        layout->correction_word_level_[hierarchy_to_tree[i]] = i;
+      }
+      layout->record_size_ +=
+          layout->values_per_level_.back() * ValueSize(value_type);
+    }
+    layout->record_size_ += layout->num_correction_words_ * (kBlockSize + 1);
+    return layout;
+  }
+
+  int64_t record_size() const { return record_size_; }
+
+  // Writes `key` to `out`, which must have `record_size()` bytes.
+  absl::Status Encode(const DpfKey& key, char* out) const {
+    if (key.correction_words_size() != num_correction_words_) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Expected ", num_correction_words_,
+                       " correction words, but got ",
+                       key.correction_words_size()));
+    }
+    WriteBlock(key.seed(), out);
+    out += kBlockSize;
+    for (int i = 0; i < num_correction_words_; ++i) {
+      const CorrectionWord& correction_word = key.correction_words(i);
+      WriteBlock(correction_word.seed(), out);
+      out += kBlockSize;
+      *out++ = static_cast<char>(int{correction_word.control_left()} |
+                                 (int{correction_word.control_right()} << 1));
+      DPF_RETURN_IF_ERROR(EncodeValueCorrection(
+          correction_word.value_correction(), correction_word_level_[i], out));
+    }
+    return EncodeValueCorrection(key.last_level_value_correction(),
+                                 static_cast<int>(value_types_.size()) - 1,
+                                 out);
+  }
+
+  // Reads a DpfKey of `party` from `in`, which must have `record_size()`
+  // bytes.
+  void Decode(const char* in, int party, DpfKey& key) const {
+    key.set_party(party);
+    ReadBlock(in, *key.mutable_seed());
+    in += kBlockSize;
+    key.mutable_correction_words()->Reserve(num_correction_words_);
+    for (int i = 0; i < num_correction_words_; ++i) {
+      CorrectionWord& correction_word = *key.add_correction_words();
+      ReadBlock(in, *correction_word.mutable_seed());
+      in += kBlockSize;
+      correction_word.set_control_left((*in & 1) != 0);
+      correction_word.set_control_right((*in & 2) != 0);
+      ++in;
+      int level = correction_word_level_[i];
+      if (level >= 0) {
+        for (int j = 0; j < values_per_level_[level]; ++j) {
+          DecodeValue(value_types_[level], in,
+                      *correction_word.add_value_correction());
+        }
+      }
+    }
+    int last_level = static_cast<int>(value_types_.size()) - 1;
+    for (int j = 0; j < values_per_level_[last_level]; ++j) {
+      DecodeValue(value_types_[last_level], in,
+                  *key.add_last_level_value_correction());
+    }
+  }
+
+ private:
+  KeyRecordLayout() = default;
+
+  // Encodes the value correction of hierarchy `level`, or checks that
+  // `values` is empty if `level` is negative.
+  absl::Status EncodeValueCorrection(
+      const google::protobuf::RepeatedPtrField<Value>& values, int level,
+      char*& out) const {
+    int expected_size = level >= 0 ? values_per_level_[level] : 0;
+    if (values.size() != expected_size) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Expected ", expected_size,
+                       " values in value correction, but got ",
+                       values.size()));
+    }
+    for (const Value& value : values) {
+      DPF_RETURN_IF_ERROR(EncodeValue(value, value_types_[level], out));
+    }
+    return absl::OkStatus();
+  }
+
+  int num_correction_words_ = 0;
+  // Hierarchy level of the value correction in each correction word, or -1 if
+  // the correction word has none.
+  std::vector<int> correction_word_level_;
+  // Value type and number of values in the value correction for each
+  // hierarchy level.
+  std::vector<ValueType> value_types_;
+  std::vector<int> values_per_level_;
+  int64_t record_size_ = 0;
+};
+
+}  // namespace dpf_internal
+
+KeyFileWriter::KeyFileWriter(
+    dpf_internal::MappedFile file,
+    std::unique_ptr<const dpf_internal::KeyRecordLayout> layout, int party)
+    : file_(std::move(file)), layout_(std::move(layout)), party_(party) {}
+
+KeyFileWriter::~KeyFileWriter() = default;
+
+absl::StatusOr<std::unique_ptr<KeyFileWriter>> KeyFileWriter::Create(
+    const std::string& path, absl::Span<const DpfParameters> parameters,
+    int party) {
+  if (party != 0 && party != 1) {
+    return absl::InvalidArgumentError("`party` must be 0 or 1");
+  }
+  DPF_ASSIGN_OR_RETURN(std::unique_ptr<const dpf_internal::KeyRecordLayout>
+                           layout,
+                       dpf_internal::KeyRecordLayout::Create(parameters));
+
+  std::string header;
+  AppendUint32(party, header);
+  AppendUint32(layout->record_size(), header);
+  AppendUint32(parameters.size(), header);
+  for (const DpfParameters& parameter : parameters) {
+    DPF_ASSIGN_OR_RETURN(std::string serialized,
+                         SerializeDeterministically(parameter));
+    AppendUint32(serialized.size(), header);
+    header += serialized;
+  }
+  std::string preamble(kMagic);
+  AppendUint32(kKeyFileFormatVersion, preamble);
+  AppendUint32(header.size(), preamble);
+
+  DPF_ASSIGN_OR_RETURN(dpf_internal::MappedFile file,
+                       dpf_internal::MappedFile::Create(path));
+  DPF_RETURN_IF_ERROR(file.Append(absl::StrCat(preamble, header)));
+  return absl::WrapUnique(
+      new KeyFileWriter(std::move(file), std::move(layout), party));
+}
+
+absl::StatusOr<std::string> KeyFileWriter::Encode(
+    absl::Span<const DpfKey> keys) const {
+  return EncodeImpl(keys);
+}
+
+absl::StatusOr<std::string> KeyFileWriter::Encode(
+    absl::Span<const DpfKey* const> keys) const {
+  return EncodeImpl(keys);
+}
+
+absl::StatusOr<std::string> KeyFileWriter::EncodeImpl(
+    dpf_internal::MaybeDerefSpan<const DpfKey> keys) const {
+  const int64_t record_size = layout_->record_size();
+  std::string records(keys.size() * record_size, '\0');
+  for (int64_t i = 0; i < static_cast<int64_t>(keys.size()); ++i) {
+    if (keys[i].party() != party_) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Key ", i, " belongs to party ", keys[i].party(),
+                       ", expected ", party_));
+    }
+    absl::Status status = layout_->Encode(keys[i], &records[i * record_size]);
+    if (!status.ok()) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Key ", i, " is malformed: ", status.message()));
+    }
+  }
+  return records;
+}
+
+absl::Status KeyFileWriter::AppendEncoded(absl::string_view records) {
+  const int64_t record_size = layout_->record_size();
+  if (records.size() % record_size != 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Size of `records` (= ", records.size(),
+                     ") must be a multiple of the record size (= ",
+                     record_size, ")"));
+  }
+  DPF_RETURN_IF_ERROR(file_.Append(records));
+  num_keys_ += records.size() / record_size;
+  return absl::OkStatus();
+}
+
+absl::Status KeyFileWriter::Append(absl::Span<const DpfKey> keys) {
+  DPF_ASSIGN_OR_RETURN(std::string records, Encode(keys));
+  return AppendEncoded(records);
+}
+
+KeyFileReader::KeyFileReader(
+    dpf_internal::MappedFile file, std::vector<DpfParameters> parameters,
+    std::unique_ptr<const dpf_internal::KeyRecordLayout> layout, int party,
+    int64_t records_offset)
+    : file_(std::move(file)),
+      parameters_(std::move(parameters)),
+      layout_(std::move(layout)),
+      party_(party),
+      records_offset_(records_offset),
+      num_keys_((file_.size() - records_offset) / layout_->record_size()) {}
+
+KeyFileReader::~KeyFileReader() = default;
+
+absl::StatusOr<std::unique_ptr<KeyFileReader>> KeyFileReader::Open(
+    const std::string& path) {
+  DPF_ASSIGN_OR_RETURN(dpf_internal::MappedFile file,
+                       dpf_internal::MappedFile::OpenReadOnly(path));
+  auto invalid_file = [&path](absl::string_view reason) {
+    return absl::InvalidArgumentError(
+        absl::StrCat(path, " is not a valid key file: ", reason));
+  };
+  if (file.size() < kPreambleSize) {
+    return invalid_file("file too short");
+  }
+  DPF_ASSIGN_OR_RETURN(dpf_internal::MappedFile::Window preamble,
+                       file.Map(0, kPreambleSize));
+  if (preamble.data().substr(0, kMagic.size()) != kMagic) {
+    return invalid_file("wrong magic");
+  }
+  uint32_t version = absl::Uint128Low64(
+      ReadLittleEndian(preamble.data().data() + kMagic.size(), 4));
+  if (version != kKeyFileFormatVersion) {
+    return invalid_file(absl::StrCat("unsupported format version ", version));
+  }
+  int64_t header_size = absl::Uint128Low64(
+      ReadLittleEndian(preamble.data().data() + kMagic.size() + 4, 4));
+  if (header_size > file.size() - kPreambleSize) {
+    return invalid_file("header exceeds file size");
+  }
+  DPF_ASSIGN_OR_RETURN(dpf_internal::MappedFile::Window header_window,
+                       file.Map(kPreambleSize, header_size));
+  absl::string_view header = header_window.data();
+
+  // Reads the next uint32 from `header`.
+  auto read_uint32 = [&header](uint32_t& value) {
+    if (header.size() < 4) {
+      return false;
+    }
+    value = absl::Uint128Low64(ReadLittleEndian(header.data(), 4));
+    header.remove_prefix(4);
+    return true;
+  };
+  uint32_t party, record_size, num_parameters;
+  if (!read_uint32(party) || !read_uint32(record_size) ||
+      !read_uint32(num_parameters)) {
+    return invalid_file("truncated header");
+  }
+  if (party > 1) {
+    return invalid_file(absl::StrCat("invalid party ", party));
+  }
+  std::vector<DpfParameters> parameters;
+  for (uint32_t i = 0; i < num_parameters; ++i) {
+    uint32_t size;
+    if (!read_uint32(size) || size > header.size()) {
+      return invalid_file("truncated header");
+    }
+    if (!parameters.emplace_back().ParseFromArray(header.data(), size)) {
+      return invalid_file("malformed parameters");
+    }
+    header.remove_prefix(size);
+  }
+  DPF_ASSIGN_OR_RETURN(std::unique_ptr<const dpf_internal::KeyRecordLayout>
+                           layout,
+                       dpf_internal::KeyRecordLayout::Create(parameters));
+  if (layout->record_size() != record_size) {
+    return invalid_file("record size doesn't match parameters");
+  }
+  const int64_t records_offset = kPreambleSize + header_size;
+  if ((file.size() - records_offset) % record_size != 0) {
+    return invalid_file("file size is not a multiple of the record size");
+  }
+  return absl::WrapUnique(new KeyFileReader(std::move(file),
+                                            std::move(parameters),
+                                            std::move(layout), party,
+                                            records_offset));
+}
+
+absl::StatusOr<std::vector<DpfKey>> KeyFileReader::ReadBatch(
+    int64_t max_keys) {
+  if (max_keys <= 0) {
+    return absl::InvalidArgumentError("`max_keys` must be positive");
+  }
+  const int64_t num_keys = std::min(max_keys, num_keys_ - position_);
+  std::vector<DpfKey> keys(num_keys);
+  if (num_keys == 0) {
+    return keys;
+  }
+  const int64_t record_size = layout_->record_size();
+  DPF_ASSIGN_OR_RETURN(dpf_internal::MappedFile::Window window,
+                       file_.Map(records_offset_ + position_ * record_size,
+                                 num_keys * record_size));
+  for (int64_t i = 0; i < num_keys; ++i) {
+    layout_->Decode(window.data().data() + i * record_size, party_, keys[i]);
+  }
+  position_ += num_keys;
+  return keys;
+}
+
+}  // namespace distributed_point_functions
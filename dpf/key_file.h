@@ -0,0 +1,185 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_KEY_FILE_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DPF_KEY_FILE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/internal/mapped_file.h"
+#include "dpf/internal/maybe_deref_span.h"
+
+namespace distributed_point_functions {
+
+namespace dpf_internal {
+class KeyRecordLayout;
+}  // namespace dpf_internal
+
+// Key files store many DpfKeys of the same party and parameters, e.g., the
+// keys generated in an offline phase for one of the two servers. Compared to
+// serialized protos, every key takes the same number of bytes, so keys can be
+// written and read in large batches without per-key framing.
+//
+// File layout (all integers little-endian):
+//
+//   magic                  8 bytes, "DPFKEYS\0"
+//   format version         uint32, currently 1
+//   header size            uint32, size of the following header in bytes
+//   header:
+//     party                uint32
+//     record size          uint32, size of each key record in bytes
+//     number of parameters uint32
+//     for each parameter:  uint32 length, followed by the deterministically
+//                          serialized DpfParameters
+//   key records, each of the same size:
+//     seed                 16 bytes
+//     for each correction word:
+//       seed               16 bytes
+//       control bits       1 byte, control_left in bit 0, control_right in
+//                          bit 1
+//       value correction   if the correction word has one, the values for the
+//                          corresponding hierarchy level
+//     last level value correction
+//
+// Values are stored by concatenating their integers in order, each using
+// max(1, bitsize / 8) bytes.
+constexpr int kKeyFileFormatVersion = 1;
+
+// Writes DpfKeys to a key file. Not thread-safe, except for `Encode`.
+class KeyFileWriter {
+ public:
+  // Creates a key file at `path` for keys of `party` under `parameters`, and
+  // writes its header. Truncates any existing file.
+  //
+  // Returns INVALID_ARGUMENT if `parameters` are invalid or `party` is not 0
+  // or 1, or an error from the file system.
+  static absl::StatusOr<std::unique_ptr<KeyFileWriter>> Create(
+      const std::string& path, absl::Span<const DpfParameters> parameters,
+      int party);
+
+  ~KeyFileWriter();
+
+  // Encodes `keys` as consecutive key records. Thread-safe, so that callers
+  // can encode in parallel and append the results in order.
+  //
+  // Returns INVALID_ARGUMENT if any key doesn't belong to the party or doesn't
+  // match the parameters passed at construction.
+  absl::StatusOr<std::string> Encode(absl::Span<const DpfKey> keys) const;
+
+  // Overload for pointers to keys, e.g., to the keys wrapped by DcfKeys.
+  absl::StatusOr<std::string> Encode(
+      absl::Span<const DpfKey* const> keys) const;
+
+  // Appends key records returned by `Encode` to the file.
+  //
+  // Returns INVALID_ARGUMENT if the size of `records` is not a multiple of the
+  // record size.
+  absl::Status AppendEncoded(absl::string_view records);
+
+  // Encodes and appends `keys` to the file.
+  absl::Status Append(absl::Span<const DpfKey> keys);
+
+  // Returns the number of keys written so far.
+  int64_t num_keys() const { return num_keys_; }
+
+ private:
+  KeyFileWriter(dpf_internal::MappedFile file,
+                std::unique_ptr<const dpf_internal::KeyRecordLayout> layout,
+                int party);
+
+  // Joint implementation of both variants of `Encode`.
+  absl::StatusOr<std::string> EncodeImpl(
+      dpf_internal::MaybeDerefSpan<const DpfKey> keys) const;
+
+  dpf_internal::MappedFile file_;
+  std::unique_ptr<const dpf_internal::KeyRecordLayout> layout_;
+  int party_;
+  int64_t num_keys_ = 0;
+};
+
+// Reads batches of DpfKeys from a key file written by KeyFileWriter. The file
+// is read sequentially through memory mappings, so only the current batch is
+// held in memory. Not thread-safe.
+//
+// Example:
+//
+//   DPF_ASSIGN_OR_RETURN(std::unique_ptr<KeyFileReader> reader,
+//                        KeyFileReader::Open(path));
+//   DPF_ASSIGN_OR_RETURN(
+//       std::unique_ptr<DistributedPointFunction> dpf,
+//       DistributedPointFunction::CreateIncremental(reader->parameters()));
+//   while (true) {
+//     DPF_ASSIGN_OR_RETURN(std::vector<DpfKey> keys, reader->ReadBatch(1024));
+//     if (keys.empty()) break;
+//     DPF_ASSIGN_OR_RETURN(std::vector<uint64_t> outputs,
+//                          dpf->EvaluateUntilBatch<uint64_t>(0, keys));
+//     ...
+//   }
+class KeyFileReader {
+ public:
+  // Opens the key file at `path` and reads its header.
+  //
+  // Returns INVALID_ARGUMENT if the file is not a valid key file, or an error
+  // from the file system.
+  static absl::StatusOr<std::unique_ptr<KeyFileReader>> Open(
+      const std::string& path);
+
+  ~KeyFileReader();
+
+  // Returns the parameters of all keys in the file.
+  absl::Span<const DpfParameters> parameters() const { return parameters_; }
+
+  // Returns the party of all keys in the file.
+  int party() const { return party_; }
+
+  // Returns the total number of keys in the file.
+  int64_t num_keys() const { return num_keys_; }
+
+  // Returns the index of the next key returned by `ReadBatch`.
+  int64_t position() const { return position_; }
+
+  // Reads up to `max_keys` keys starting at `position()`, and advances
+  // `position()` past them. Returns an empty vector at the end of the file.
+  //
+  // Returns INVALID_ARGUMENT if `max_keys` is not positive.
+  absl::StatusOr<std::vector<DpfKey>> ReadBatch(int64_t max_keys);
+
+ private:
+  KeyFileReader(dpf_internal::MappedFile file,
+                std::vector<DpfParameters> parameters,
+                std::unique_ptr<const dpf_internal::KeyRecordLayout> layout,
+                int party, int64_t records_offset);
+
+  dpf_internal::MappedFile file_;
+  std::vector<DpfParameters> parameters_;
+  std::unique_ptr<const dpf_internal::KeyRecordLayout> layout_;
+  int party_;
+  int64_t records_offset_;
+  int64_t num_keys_;
+  int64_t position_ = 0;
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DPF_KEY_FILE_H_
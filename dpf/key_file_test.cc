@@ -0,0 +1,315 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/key_file.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "absl/utility/utility.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/internal/mapped_file.h"
+#include "dpf/internal/status_matchers.h"
+#include "dpf/int_mod_n.h"
+#include "dpf/tuple.h"
+#include "dpf/xor_wrapper.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::StatusIs;
+using ::testing::HasSubstr;
+using ::testing::SizeIs;
+
+constexpr int kLogDomainSizes[] = {2, 5, 9, 16};
+constexpr int kNumKeys = 37;
+
+std::string TestPath(absl::string_view name) {
+  return absl::StrCat(::testing::TempDir(), "/", name);
+}
+
+template <typename T>
+class KeyFileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (int log_domain_size : kLogDomainSizes) {
+      DpfParameters& p = parameters_.emplace_back();
+      p.set_log_domain_size(log_domain_size);
+      *(p.mutable_value_type()) = ToValueType<T>();
+    }
+    DPF_ASSERT_OK_AND_ASSIGN(
+        dpf_, DistributedPointFunction::CreateIncremental(parameters_));
+    DPF_ASSERT_OK(dpf_->template RegisterValueType<T>());
+    SetTo42(beta_);
+    std::vector<T> beta(parameters_.size(), beta_);
+    for (int i = 0; i < kNumKeys; ++i) {
+      DPF_ASSERT_OK_AND_ASSIGN(
+          auto keys,
+          dpf_->GenerateKeysIncremental(i * 1001, absl::MakeConstSpan(beta)));
+      keys_[0].push_back(std::move(keys.first));
+      keys_[1].push_back(std::move(keys.second));
+    }
+  }
+
+  // Helper function that recursively sets all elements of a tuple to 42.
+  template <typename T0>
+  static void SetTo42(T0& x) {
+    x = T0(42);
+  }
+  template <typename T0, typename... Tn>
+  static void SetTo42(T0& x0, Tn&... xn) {
+    SetTo42(x0);
+    SetTo42(xn...);
+  }
+  template <typename... Tn>
+  static void SetTo42(Tuple<Tn...>& x) {
+    absl::apply([](auto&... in) { SetTo42(in...); }, x.value());
+  }
+
+  std::vector<DpfParameters> parameters_;
+  std::unique_ptr<DistributedPointFunction> dpf_;
+  T beta_;
+  std::vector<DpfKey> keys_[2];
+};
+
+using MyIntModN = IntModN<uint32_t, 4294967291u>;  // 2**32 - 5.
+using KeyFileTypes =
+    ::testing::Types<uint8_t, uint32_t, absl::uint128,
+                     Tuple<uint32_t, uint64_t>,
+                     Tuple<uint8_t, uint8_t, uint8_t>, MyIntModN,
+                     Tuple<uint32_t, MyIntModN>, XorWrapper<uint64_t>>;
+TYPED_TEST_SUITE(KeyFileTest, KeyFileTypes);
+
+TYPED_TEST(KeyFileTest, RoundTripPreservesKeys) {
+  for (int party = 0; party < 2; ++party) {
+    std::string path = TestPath(absl::StrCat("round_trip_", party));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<KeyFileWriter> writer,
+        KeyFileWriter::Create(path, this->parameters_, party));
+    DPF_ASSERT_OK(writer->Append(this->keys_[party]));
+    EXPECT_EQ(writer->num_keys(), kNumKeys);
+    writer.reset();
+
+    DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<KeyFileReader> reader,
+                             KeyFileReader::Open(path));
+    EXPECT_EQ(reader->party(), party);
+    EXPECT_EQ(reader->num_keys(), kNumKeys);
+    ASSERT_EQ(reader->parameters().size(), this->parameters_.size());
+    for (int i = 0; i < static_cast<int>(this->parameters_.size()); ++i) {
+      EXPECT_EQ(reader->parameters()[i].log_domain_size(),
+                this->parameters_[i].log_domain_size());
+    }
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<DpfKey> keys,
+                             reader->ReadBatch(2 * kNumKeys));
+    ASSERT_THAT(keys, SizeIs(kNumKeys));
+    for (int i = 0; i < kNumKeys; ++i) {
+      EXPECT_EQ(keys[i].SerializeAsString(),
+                this->keys_[party][i].SerializeAsString())
+          << "party " << party << ", key " << i;
+    }
+  }
+}
+
+TYPED_TEST(KeyFileTest, DecodedKeysEvaluateCorrectly) {
+  std::vector<std::vector<DpfKey>> decoded(2);
+  for (int party = 0; party < 2; ++party) {
+    std::string path = TestPath(absl::StrCat("evaluate_", party));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<KeyFileWriter> writer,
+        KeyFileWriter::Create(path, this->parameters_, party));
+    DPF_ASSERT_OK(writer->Append(this->keys_[party]));
+    writer.reset();
+    DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<KeyFileReader> reader,
+                             KeyFileReader::Open(path));
+    DPF_ASSERT_OK_AND_ASSIGN(decoded[party], reader->ReadBatch(kNumKeys));
+  }
+  const int last_level = static_cast<int>(this->parameters_.size()) - 1;
+  for (int i = 0; i < kNumKeys; ++i) {
+    std::vector<absl::uint128> points = {i * 1001, i * 1001 + 1};
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<TypeParam> result_0,
+        this->dpf_->template EvaluateAt<TypeParam>(decoded[0][i], last_level,
+                                                   points));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<TypeParam> result_1,
+        this->dpf_->template EvaluateAt<TypeParam>(decoded[1][i], last_level,
+                                                   points));
+    // Cast to avoid integer promotion for uint8_t.
+    EXPECT_EQ(TypeParam(result_0[0] + result_1[0]), this->beta_);
+    EXPECT_EQ(TypeParam(result_0[1] + result_1[1]), TypeParam{});
+  }
+}
+
+TYPED_TEST(KeyFileTest, ReadsInBatches) {
+  std::string path = TestPath("batches");
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<KeyFileWriter> writer,
+                           KeyFileWriter::Create(path, this->parameters_, 0));
+  // Append in several parts to check that records are concatenated.
+  auto keys = absl::MakeConstSpan(this->keys_[0]);
+  DPF_ASSERT_OK(writer->Append(keys.subspan(0, 10)));
+  DPF_ASSERT_OK_AND_ASSIGN(std::string records,
+                           writer->Encode(keys.subspan(10)));
+  DPF_ASSERT_OK(writer->AppendEncoded(records));
+  writer.reset();
+
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<KeyFileReader> reader,
+                           KeyFileReader::Open(path));
+  constexpr int kBatchSize = 8;
+  int num_read = 0;
+  while (true) {
+    EXPECT_EQ(reader->position(), num_read);
+    DPF_ASSERT_OK_AND_ASSIGN(std::vector<DpfKey> batch,
+                             reader->ReadBatch(kBatchSize));
+    if (batch.empty()) {
+      break;
+    }
+    EXPECT_LE(batch.size(), kBatchSize);
+    for (const DpfKey& key : batch) {
+      EXPECT_EQ(key.SerializeAsString(),
+                this->keys_[0][num_read++].SerializeAsString());
+    }
+  }
+  EXPECT_EQ(num_read, kNumKeys);
+}
+
+TEST(KeyFile, EmptyFileHasNoKeys) {
+  std::string path = TestPath("empty");
+  std::vector<DpfParameters> parameters(1);
+  parameters[0].set_log_domain_size(10);
+  parameters[0].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  DPF_ASSERT_OK(KeyFileWriter::Create(path, parameters, 1).status());
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<KeyFileReader> reader,
+                           KeyFileReader::Open(path));
+  EXPECT_EQ(reader->num_keys(), 0);
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<DpfKey> keys, reader->ReadBatch(1));
+  EXPECT_TRUE(keys.empty());
+}
+
+class KeyFileErrorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    parameters_.resize(2);
+    parameters_[0].set_log_domain_size(4);
+    parameters_[1].set_log_domain_size(10);
+    for (DpfParameters& p : parameters_) {
+      p.mutable_value_type()->mutable_integer()->set_bitsize(32);
+    }
+    DPF_ASSERT_OK_AND_ASSIGN(
+        dpf_, DistributedPointFunction::CreateIncremental(parameters_));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        keys_, dpf_->GenerateKeysIncremental(
+                   123, std::vector<absl::uint128>{1, 2}));
+  }
+
+  std::vector<DpfParameters> parameters_;
+  std::unique_ptr<DistributedPointFunction> dpf_;
+  std::pair<DpfKey, DpfKey> keys_;
+};
+
+TEST_F(KeyFileErrorTest, CreateFailsForInvalidParty) {
+  EXPECT_THAT(KeyFileWriter::Create(TestPath("party"), parameters_, 2),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`party` must be 0 or 1"));
+}
+
+TEST_F(KeyFileErrorTest, CreateFailsForInvalidParameters) {
+  parameters_[1].set_log_domain_size(2);
+  EXPECT_THAT(KeyFileWriter::Create(TestPath("parameters"), parameters_, 0),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(KeyFileErrorTest, AppendFailsForKeyOfWrongParty) {
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<KeyFileWriter> writer,
+      KeyFileWriter::Create(TestPath("wrong_party"), parameters_, 0));
+  EXPECT_THAT(writer->Append({keys_.first, keys_.second}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Key 1 belongs to party 1, expected 0"));
+  EXPECT_EQ(writer->num_keys(), 0);
+}
+
+TEST_F(KeyFileErrorTest, AppendFailsForMalformedKey) {
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<KeyFileWriter> writer,
+      KeyFileWriter::Create(TestPath("malformed"), parameters_, 0));
+  keys_.first.mutable_correction_words()->RemoveLast();
+  EXPECT_THAT(writer->Append({keys_.first}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Key 0 is malformed")));
+}
+
+TEST_F(KeyFileErrorTest, AppendEncodedFailsForPartialRecords) {
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<KeyFileWriter> writer,
+      KeyFileWriter::Create(TestPath("partial"), parameters_, 0));
+  DPF_ASSERT_OK_AND_ASSIGN(std::string records, writer->Encode({keys_.first}));
+  records.pop_back();
+  EXPECT_THAT(writer->AppendEncoded(records),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("must be a multiple of the record size")));
+}
+
+TEST_F(KeyFileErrorTest, ReadBatchFailsForNonPositiveMaxKeys) {
+  std::string path = TestPath("max_keys");
+  DPF_ASSERT_OK(KeyFileWriter::Create(path, parameters_, 0).status());
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<KeyFileReader> reader,
+                           KeyFileReader::Open(path));
+  EXPECT_THAT(reader->ReadBatch(0),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`max_keys` must be positive"));
+}
+
+TEST_F(KeyFileErrorTest, OpenFailsForMissingFile) {
+  EXPECT_THAT(KeyFileReader::Open(TestPath("does_not_exist")),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST_F(KeyFileErrorTest, OpenFailsForWrongMagic) {
+  std::string path = TestPath("wrong_magic");
+  DPF_ASSERT_OK_AND_ASSIGN(dpf_internal::MappedFile file,
+                           dpf_internal::MappedFile::Create(path));
+  DPF_ASSERT_OK(file.Append("NOTAKEYFILE, BUT LONG ENOUGH"));
+  EXPECT_THAT(KeyFileReader::Open(path),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("wrong magic")));
+}
+
+TEST_F(KeyFileErrorTest, OpenFailsForTruncatedFile) {
+  std::string path = TestPath("truncated");
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<KeyFileWriter> writer,
+                           KeyFileWriter::Create(path, parameters_, 0));
+  DPF_ASSERT_OK_AND_ASSIGN(std::string records, writer->Encode({keys_.first}));
+  writer.reset();
+  // Append a partial record through a plain file.
+  DPF_ASSERT_OK_AND_ASSIGN(dpf_internal::MappedFile file,
+                           dpf_internal::MappedFile::Open(path));
+  DPF_ASSERT_OK(file.Append(records.substr(0, records.size() - 1)));
+  EXPECT_THAT(KeyFileReader::Open(path),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not a multiple of the record size")));
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
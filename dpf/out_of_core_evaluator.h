@@ -0,0 +1,352 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_DPF_OUT_OF_CORE_EVALUATOR_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_DPF_OUT_OF_CORE_EVALUATOR_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/internal/mapped_file.h"
+#include "dpf/internal/proto_validator.h"
+#include "dpf/status_macros.h"
+
+namespace distributed_point_functions {
+
+// A file of trivially copyable records of type T, written by appending and
+// read through memory-mapped windows. Used for the inputs and outputs of
+// `OutOfCoreEvaluator`. Records are stored in native byte order, so files are
+// not portable between machines.
+template <typename T>
+class RecordFile {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "RecordFile requires a trivially copyable record type");
+
+ public:
+  // A read-only view of a range of records, backed by a memory mapping.
+  class Window {
+   public:
+    Window() = default;
+
+    absl::Span<const T> records() const {
+      return absl::MakeConstSpan(
+          reinterpret_cast<const T*>(window_.data().data()),
+          window_.data().size() / sizeof(T));
+    }
+
+   private:
+    friend class RecordFile;
+    explicit Window(dpf_internal::MappedFile::Window window)
+        : window_(std::move(window)) {}
+
+    dpf_internal::MappedFile::Window window_;
+  };
+
+  // Creates an empty record file at `path`, truncating any existing file.
+  static absl::StatusOr<RecordFile> Create(const std::string& path) {
+    DPF_ASSIGN_OR_RETURN(dpf_internal::MappedFile file,
+                         dpf_internal::MappedFile::Create(path));
+    return RecordFile(std::move(file));
+  }
+
+  // Creates an empty record file in `directory` that is deleted when the
+  // returned RecordFile is destroyed.
+  static absl::StatusOr<RecordFile> CreateTemporary(
+      const std::string& directory) {
+    DPF_ASSIGN_OR_RETURN(dpf_internal::MappedFile file,
+                         dpf_internal::MappedFile::CreateTemporary(directory));
+    return RecordFile(std::move(file));
+  }
+
+  // Opens an existing record file at `path`.
+  //
+  // Returns INVALID_ARGUMENT if the file size is not a multiple of sizeof(T).
+  static absl::StatusOr<RecordFile> Open(const std::string& path) {
+    DPF_ASSIGN_OR_RETURN(dpf_internal::MappedFile file,
+                         dpf_internal::MappedFile::Open(path));
+    if (file.size() % sizeof(T) != 0) {
+      return absl::InvalidArgumentError(
+          "File size is not a multiple of the record size");
+    }
+    return RecordFile(std::move(file));
+  }
+
+  // Returns the number of records in the file.
+  int64_t size() const { return file_.size() / sizeof(T); }
+
+  // Appends `records` to the end of the file.
+  absl::Status Append(absl::Span<const T> records) {
+    return file_.Append(
+        absl::string_view(reinterpret_cast<const char*>(records.data()),
+                          records.size() * sizeof(T)));
+  }
+
+  // Maps `count` records starting at record `first` for reading.
+  //
+  // Returns OUT_OF_RANGE if the records are not contained in the file.
+  absl::StatusOr<Window> Map(int64_t first, int64_t count) const {
+    if (first < 0 || count < 0 || first > size() || count > size() - first) {
+      return absl::OutOfRangeError("Records are not contained in the file");
+    }
+    DPF_ASSIGN_OR_RETURN(dpf_internal::MappedFile::Window window,
+                         file_.Map(first * sizeof(T), count * sizeof(T)));
+    return Window(std::move(window));
+  }
+
+ private:
+  explicit RecordFile(dpf_internal::MappedFile file) : file_(std::move(file)) {}
+
+  dpf_internal::MappedFile file_;
+};
+
+// Incrementally evaluates a hierarchical DPF key like
+// `DistributedPointFunction::EvaluateUntil`, but with the partial evaluations
+// kept between hierarchy levels (the "frontier") and the outputs stored in
+// memory-mapped files instead of main memory. Each hierarchy level is
+// evaluated in chunks of sorted prefixes, whose size is chosen such that the
+// memory used for evaluating a chunk stays below `Options::max_memory_bytes`.
+// Since prefixes are sorted, the frontier file is read sequentially, once per
+// hierarchy level. If the prefixes are passed as a RecordFile, they are read
+// sequentially as well. This allows evaluating on a number of prefixes whose
+// frontier and outputs don't fit into main memory, e.g., when computing heavy
+// hitters over large domains.
+//
+// Example:
+//
+//   DPF_ASSIGN_OR_RETURN(
+//       std::unique_ptr<OutOfCoreEvaluator> evaluator,
+//       OutOfCoreEvaluator::Create(*dpf, key, {.scratch_directory = "/tmp"}));
+//   DPF_ASSIGN_OR_RETURN(auto output0,
+//                        RecordFile<uint64_t>::Create("/tmp/output0"));
+//   DPF_RETURN_IF_ERROR(evaluator->EvaluateUntil(0, {}, output0));
+//   ...
+//   DPF_ASSIGN_OR_RETURN(auto prefixes1,
+//                        RecordFile<absl::uint128>::Open("/tmp/prefixes1"));
+//   DPF_RETURN_IF_ERROR(evaluator->EvaluateUntil(1, prefixes1, output1));
+//
+// OutOfCoreEvaluator is not thread-safe.
+class OutOfCoreEvaluator {
+ public:
+  struct Options {
+    // Directory in which temporary files for the frontier are created. The
+    // files are deleted when they are no longer needed, or when the process
+    // exits.
+    std::string scratch_directory;
+
+    // Approximate upper bound on the memory used for evaluating a single chunk
+    // of prefixes, not counting the page cache used for the memory-mapped
+    // files.
+    int64_t max_memory_bytes = int64_t{1} << 30;
+  };
+
+  // Creates a new OutOfCoreEvaluator for the given `key`. `dpf` must outlive
+  // the returned object.
+  //
+  // Returns INVALID_ARGUMENT if `key` doesn't match the parameters of `dpf`, or
+  // if `options` are invalid.
+  static absl::StatusOr<std::unique_ptr<OutOfCoreEvaluator>> Create(
+      const DistributedPointFunction& dpf, DpfKey key, Options options);
+
+  // OutOfCoreEvaluator is neither copyable nor movable.
+  OutOfCoreEvaluator(const OutOfCoreEvaluator&) = delete;
+  OutOfCoreEvaluator& operator=(const OutOfCoreEvaluator&) = delete;
+
+  // Evaluates `hierarchy_level` under all `prefixes` and appends the outputs to
+  // `output`, in the same order as `DistributedPointFunction::EvaluateUntil`.
+  // The requirements on `prefixes` are the same, and additionally `prefixes`
+  // must be sorted in increasing order. The first call must have empty
+  // `prefixes`, and is evaluated in memory.
+  //
+  // If an error is returned, `output` may contain a partial result, but the
+  // evaluator stays at the previous hierarchy level and can be used again.
+  //
+  // Returns INVALID_ARGUMENT if `prefixes` are not sorted or the arguments are
+  // invalid for `DistributedPointFunction::EvaluateUntil`, RESOURCE_EXHAUSTED
+  // if a single prefix (or the first hierarchy level) would exceed
+  // `Options::max_memory_bytes`, or an error from the file system.
+  template <typename T>
+  absl::Status EvaluateUntil(int hierarchy_level,
+                             absl::Span<const absl::uint128> prefixes,
+                             RecordFile<T>& output);
+
+  // Same as above, but reads `prefixes` from a file one chunk at a time, such
+  // that they don't need to fit into main memory.
+  template <typename T>
+  absl::Status EvaluateUntil(int hierarchy_level,
+                             const RecordFile<absl::uint128>& prefixes,
+                             RecordFile<T>& output);
+
+  // Returns the hierarchy level that was last evaluated, or -1 if no level has
+  // been evaluated yet.
+  int previous_hierarchy_level() const { return previous_hierarchy_level_; }
+
+ private:
+  // A partial evaluation stored in the frontier file. Uses 64-bit fields to
+  // avoid the alignment requirements of absl::uint128.
+  struct FrontierRecord {
+    uint64_t prefix_high;
+    uint64_t prefix_low;
+    uint64_t seed_high;
+    uint64_t seed_low;
+    uint64_t control_bit;
+  };
+
+  OutOfCoreEvaluator(const DistributedPointFunction& dpf,
+                     std::unique_ptr<dpf_internal::ProtoValidator> validator,
+                     EvaluationContext ctx, Options options);
+
+  // Joint implementation of both variants of `EvaluateUntil`. `get_chunk` is
+  // called with the index of the first prefix and the number of prefixes in
+  // each chunk, and returns an absl::StatusOr<absl::Span<const
+  // absl::uint128>> that stays valid until the next call.
+  template <typename T, typename GetChunkFn>
+  absl::Status EvaluateUntilImpl(int hierarchy_level, int64_t num_prefixes,
+                                 GetChunkFn get_chunk, RecordFile<T>& output);
+
+  // Checks that `hierarchy_level` can be evaluated after the previous level,
+  // and returns the number of prefixes to evaluate at once, given that each
+  // output has `output_size` bytes.
+  absl::StatusOr<int64_t> ComputeChunkSize(int hierarchy_level,
+                                           int64_t num_prefixes,
+                                           int64_t output_size) const;
+
+  // Sets up `ctx_` for evaluating `chunk`, loading the partial evaluations for
+  // `chunk` from `frontier_`. `frontier_position` is the index of the first
+  // frontier record that may be needed, and is advanced past the records that
+  // are no longer needed by later chunks.
+  absl::Status PrepareChunk(absl::Span<const absl::uint128> chunk,
+                            int64_t& frontier_position);
+
+  // Appends the partial evaluations computed for the last chunk to
+  // `next_frontier`.
+  absl::Status AppendPartialEvaluations(
+      RecordFile<FrontierRecord>& next_frontier) const;
+
+  // Makes `next_frontier` the current frontier after successfully evaluating
+  // `hierarchy_level`.
+  void FinishLevel(int hierarchy_level,
+                   std::optional<RecordFile<FrontierRecord>> next_frontier);
+
+  const DistributedPointFunction& dpf_;
+  const std::unique_ptr<dpf_internal::ProtoValidator> validator_;
+  const Options options_;
+
+  // Holds the key and parameters, and the partial evaluations for the chunk
+  // currently being evaluated.
+  EvaluationContext ctx_;
+
+  int previous_hierarchy_level_ = -1;
+
+  // Partial evaluations at `frontier_level_`, sorted by prefix. Empty after the
+  // first hierarchy level, in which case evaluation starts from the key seed.
+  std::optional<RecordFile<FrontierRecord>> frontier_;
+  int frontier_level_ = -1;
+};
+
+template <typename T>
+absl::Status OutOfCoreEvaluator::EvaluateUntil(
+    int hierarchy_level, absl::Span<const absl::uint128> prefixes,
+    RecordFile<T>& output) {
+  return EvaluateUntilImpl(
+      hierarchy_level, prefixes.size(),
+      [prefixes](int64_t start, int64_t count)
+          -> absl::StatusOr<absl::Span<const absl::uint128>> {
+        return prefixes.subspan(start, count);
+      },
+      output);
+}
+
+template <typename T>
+absl::Status OutOfCoreEvaluator::EvaluateUntil(
+    int hierarchy_level, const RecordFile<absl::uint128>& prefixes,
+    RecordFile<T>& output) {
+  // Holds the mapping of the current chunk.
+  RecordFile<absl::uint128>::Window window;
+  return EvaluateUntilImpl(
+      hierarchy_level, prefixes.size(),
+      [&prefixes, &window](int64_t start, int64_t count)
+          -> absl::StatusOr<absl::Span<const absl::uint128>> {
+        DPF_ASSIGN_OR_RETURN(window, prefixes.Map(start, count));
+        return window.records();
+      },
+      output);
+}
+
+template <typename T, typename GetChunkFn>
+absl::Status OutOfCoreEvaluator::EvaluateUntilImpl(int hierarchy_level,
+                                                   int64_t num_prefixes,
+                                                   GetChunkFn get_chunk,
+                                                   RecordFile<T>& output) {
+  DPF_ASSIGN_OR_RETURN(
+      int64_t chunk_size,
+      ComputeChunkSize(hierarchy_level, num_prefixes, sizeof(T)));
+
+  // The first level has no prefixes, so it can't be split into chunks.
+  if (num_prefixes == 0) {
+    ctx_.clear_partial_evaluations();
+    ctx_.set_previous_hierarchy_level(previous_hierarchy_level_);
+    DPF_ASSIGN_OR_RETURN(std::vector<T> result,
+                         dpf_.EvaluateUntil<T>(hierarchy_level, {}, ctx_));
+    DPF_RETURN_IF_ERROR(output.Append(result));
+    FinishLevel(hierarchy_level, std::nullopt);
+    return absl::OkStatus();
+  }
+
+  std::optional<RecordFile<FrontierRecord>> next_frontier;
+  if (hierarchy_level < static_cast<int>(validator_->parameters().size()) - 1) {
+    DPF_ASSIGN_OR_RETURN(next_frontier,
+                         RecordFile<FrontierRecord>::CreateTemporary(
+                             options_.scratch_directory));
+  }
+  int64_t frontier_position = 0;
+  std::optional<absl::uint128> previous_prefix;
+  for (int64_t start = 0; start < num_prefixes; start += chunk_size) {
+    DPF_ASSIGN_OR_RETURN(
+        absl::Span<const absl::uint128> chunk,
+        get_chunk(start, std::min(chunk_size, num_prefixes - start)));
+    if (!std::is_sorted(chunk.begin(), chunk.end()) ||
+        (previous_prefix.has_value() && chunk.front() < *previous_prefix)) {
+      return absl::InvalidArgumentError("`prefixes` must be sorted");
+    }
+    previous_prefix = chunk.back();
+    DPF_RETURN_IF_ERROR(PrepareChunk(chunk, frontier_position));
+    DPF_ASSIGN_OR_RETURN(std::vector<T> result,
+                         dpf_.EvaluateUntil<T>(hierarchy_level, chunk, ctx_));
+    DPF_RETURN_IF_ERROR(output.Append(result));
+    if (next_frontier.has_value()) {
+      DPF_RETURN_IF_ERROR(AppendPartialEvaluations(*next_frontier));
+    }
+  }
+  FinishLevel(hierarchy_level, std::move(next_frontier));
+  return absl::OkStatus();
+}
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_DPF_OUT_OF_CORE_EVALUATOR_H_
@@ -0,0 +1,152 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/numeric/int128.h"
+#include "absl/random/random.h"
+#include "absl/random/uniform_int_distribution.h"
+#include "benchmark/benchmark.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/internal/memory_counters.h"
+#include "dpf/out_of_core_evaluator.h"
+
+namespace distributed_point_functions {
+namespace {
+
+// Log domain sizes of the hierarchy levels, similar to a heavy hitters
+// computation that extends each prefix by a few bits per level.
+constexpr int kLogDomainSizes[] = {16, 20, 24};
+
+// Returns the directory for scratch files: $TEST_TMPDIR if set, /tmp
+// otherwise.
+std::string ScratchDirectory() {
+  const char* test_tmpdir = std::getenv("TEST_TMPDIR");
+  return test_tmpdir != nullptr ? test_tmpdir : "/tmp";
+}
+
+struct Setup {
+  std::unique_ptr<DistributedPointFunction> dpf;
+  DpfKey key;
+  // Sorted prefixes for each hierarchy level.
+  std::vector<std::vector<absl::uint128>> prefixes;
+};
+
+// Creates a DPF with `kLogDomainSizes` and uint32_t outputs, and
+// `num_prefixes` random prefixes for each level after the first, each
+// extending a prefix of the previous level.
+Setup CreateSetup(int num_prefixes) {
+  Setup setup;
+  std::vector<DpfParameters> parameters(std::size(kLogDomainSizes));
+  for (int i = 0; i < static_cast<int>(parameters.size()); ++i) {
+    parameters[i].set_log_domain_size(kLogDomainSizes[i]);
+    parameters[i].mutable_value_type()->mutable_integer()->set_bitsize(32);
+  }
+  setup.dpf = DistributedPointFunction::CreateIncremental(parameters).value();
+  std::vector<absl::uint128> beta(parameters.size(), 1);
+  setup.key = setup.dpf->GenerateKeysIncremental(1234567, beta).value().first;
+
+  absl::BitGen rng;
+  setup.prefixes.resize(parameters.size());
+  for (int i = 1; i < static_cast<int>(parameters.size()); ++i) {
+    int shift = kLogDomainSizes[i - 1] - (i > 1 ? kLogDomainSizes[i - 2] : 0);
+    absl::uniform_int_distribution<uint32_t> dist_suffix(0,
+                                                         (1 << shift) - 1);
+    for (int j = 0; j < num_prefixes; ++j) {
+      absl::uint128 prefix = 0;
+      if (i > 1) {
+        prefix = setup.prefixes[i - 1][absl::Uniform<int>(
+                     rng, 0, setup.prefixes[i - 1].size())]
+                 << shift;
+      }
+      setup.prefixes[i].push_back(prefix | dist_suffix(rng));
+    }
+    std::sort(setup.prefixes[i].begin(), setup.prefixes[i].end());
+    setup.prefixes[i].erase(
+        std::unique(setup.prefixes[i].begin(), setup.prefixes[i].end()),
+        setup.prefixes[i].end());
+  }
+  return setup;
+}
+
+// Benchmarks out-of-core evaluation of all hierarchy levels. Expects the first
+// range argument to specify the number of prefixes per level, and the second
+// to specify `max_memory_bytes` in MiB. The prefixes are read from and the
+// outputs are written to temporary files.
+void BM_EvaluateOutOfCore(benchmark::State& state) {
+  Setup setup = CreateSetup(state.range(0));
+  OutOfCoreEvaluator::Options options{
+      .scratch_directory = ScratchDirectory(),
+      .max_memory_bytes = state.range(1) << 20};
+  std::vector<RecordFile<absl::uint128>> prefix_files;
+  for (const std::vector<absl::uint128>& prefixes : setup.prefixes) {
+    prefix_files.push_back(
+        RecordFile<absl::uint128>::CreateTemporary(options.scratch_directory)
+            .value());
+    ABSL_CHECK(prefix_files.back().Append(prefixes).ok());
+  }
+  setup.prefixes.clear();
+  dpf_internal::MemoryCounters memory_counters(state);
+  int64_t num_outputs = 0;
+  for (auto s : state) {
+    std::unique_ptr<OutOfCoreEvaluator> evaluator =
+        OutOfCoreEvaluator::Create(*setup.dpf, setup.key, options).value();
+    for (int i = 0; i < static_cast<int>(prefix_files.size()); ++i) {
+      RecordFile<uint32_t> output =
+          RecordFile<uint32_t>::CreateTemporary(options.scratch_directory)
+              .value();
+      ABSL_CHECK(evaluator->EvaluateUntil(i, prefix_files[i], output).ok());
+      num_outputs += output.size();
+    }
+  }
+  state.SetItemsProcessed(num_outputs);
+}
+BENCHMARK(BM_EvaluateOutOfCore)
+    ->ArgPair(1 << 16, 16)
+    ->ArgPair(1 << 16, 256)
+    ->ArgPair(1 << 20, 16)
+    ->ArgPair(1 << 20, 256);
+
+// Same as BM_EvaluateOutOfCore, but evaluates in memory with
+// `DistributedPointFunction::EvaluateUntil`, for comparison. Ignores the second
+// range argument.
+void BM_EvaluateInMemory(benchmark::State& state) {
+  Setup setup = CreateSetup(state.range(0));
+  EvaluationContext ctx_0 =
+      setup.dpf->CreateEvaluationContext(setup.key).value();
+  dpf_internal::MemoryCounters memory_counters(state);
+  int64_t num_outputs = 0;
+  for (auto s : state) {
+    EvaluationContext ctx = ctx_0;
+    for (int i = 0; i < static_cast<int>(setup.prefixes.size()); ++i) {
+      std::vector<uint32_t> result =
+          setup.dpf->EvaluateUntil<uint32_t>(i, setup.prefixes[i], ctx)
+              .value();
+      num_outputs += result.size();
+      benchmark::DoNotOptimize(result);
+    }
+  }
+  state.SetItemsProcessed(num_outputs);
+}
+BENCHMARK(BM_EvaluateInMemory)->ArgPair(1 << 16, 0)->ArgPair(1 << 20, 0);
+
+}  // namespace
+}  // namespace distributed_point_functions
@@ -0,0 +1,256 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dpf/out_of_core_evaluator.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::StatusIs;
+using ::testing::ElementsAreArray;
+using ::testing::HasSubstr;
+
+constexpr int kLogDomainSizes[] = {3, 6, 10, 14};
+constexpr absl::uint128 kAlpha = 12345;
+
+template <typename T>
+class OutOfCoreEvaluatorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::vector<DpfParameters> parameters;
+    for (int log_domain_size : kLogDomainSizes) {
+      DpfParameters& p = parameters.emplace_back();
+      p.set_log_domain_size(log_domain_size);
+      *(p.mutable_value_type()) = ToValueType<T>();
+    }
+    DPF_ASSERT_OK_AND_ASSIGN(
+        dpf_, DistributedPointFunction::CreateIncremental(parameters));
+    std::vector<T> beta(parameters.size(), T{1});
+    DPF_ASSERT_OK_AND_ASSIGN(keys_, dpf_->GenerateKeysIncremental(
+                                        kAlpha, absl::MakeConstSpan(beta)));
+  }
+
+  // Returns the prefixes to evaluate at `hierarchy_level`. These are the
+  // elements of the previous domain where no prefix at any previous level is 1
+  // mod 3, such that they always extend the prefixes of the previous level.
+  static std::vector<absl::uint128> Prefixes(int hierarchy_level) {
+    std::vector<absl::uint128> prefixes;
+    if (hierarchy_level == 0) {
+      return prefixes;
+    }
+    const int log_domain_size = kLogDomainSizes[hierarchy_level - 1];
+    for (int i = 0; i < (1 << log_domain_size); ++i) {
+      bool included = true;
+      for (int level = 0; level < hierarchy_level; ++level) {
+        int prefix = i >> (log_domain_size - kLogDomainSizes[level]);
+        included &= (prefix % 3 != 1);
+      }
+      if (included) {
+        prefixes.push_back(i);
+      }
+    }
+    return prefixes;
+  }
+
+  // Evaluates all hierarchy levels of `keys_.first` both in memory and out of
+  // core with the given `max_memory_bytes`, and checks that the results match.
+  // If `prefixes_from_file` is true, the prefixes are passed as a RecordFile.
+  void EvaluateAndCompare(int64_t max_memory_bytes,
+                          bool prefixes_from_file = false) {
+    DPF_ASSERT_OK_AND_ASSIGN(EvaluationContext ctx,
+                             dpf_->CreateEvaluationContext(keys_.first));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<OutOfCoreEvaluator> evaluator,
+        OutOfCoreEvaluator::Create(
+            *dpf_, keys_.first,
+            {.scratch_directory = ::testing::TempDir(),
+             .max_memory_bytes = max_memory_bytes}));
+    for (int i = 0; i < static_cast<int>(std::size(kLogDomainSizes)); ++i) {
+      std::vector<absl::uint128> prefixes = Prefixes(i);
+      DPF_ASSERT_OK_AND_ASSIGN(std::vector<T> expected,
+                               dpf_->EvaluateUntil<T>(i, prefixes, ctx));
+      DPF_ASSERT_OK_AND_ASSIGN(
+          RecordFile<T> output,
+          RecordFile<T>::CreateTemporary(::testing::TempDir()));
+      if (prefixes_from_file) {
+        DPF_ASSERT_OK_AND_ASSIGN(
+            RecordFile<absl::uint128> prefix_file,
+            RecordFile<absl::uint128>::CreateTemporary(::testing::TempDir()));
+        DPF_ASSERT_OK(prefix_file.Append(prefixes));
+        DPF_ASSERT_OK(evaluator->EvaluateUntil(i, prefix_file, output));
+      } else {
+        DPF_ASSERT_OK(evaluator->EvaluateUntil(i, prefixes, output));
+      }
+      EXPECT_EQ(evaluator->previous_hierarchy_level(), i);
+      DPF_ASSERT_OK_AND_ASSIGN(typename RecordFile<T>::Window window,
+                               output.Map(0, output.size()));
+      EXPECT_THAT(window.records(), ElementsAreArray(expected))
+          << "hierarchy_level=" << i;
+    }
+  }
+
+  std::unique_ptr<DistributedPointFunction> dpf_;
+  std::pair<DpfKey, DpfKey> keys_;
+};
+
+using OutputTypes = ::testing::Types<uint8_t, uint32_t, absl::uint128>;
+TYPED_TEST_SUITE(OutOfCoreEvaluatorTest, OutputTypes);
+
+TYPED_TEST(OutOfCoreEvaluatorTest, MatchesInMemoryEvaluation) {
+  this->EvaluateAndCompare(OutOfCoreEvaluator::Options().max_memory_bytes);
+}
+
+TYPED_TEST(OutOfCoreEvaluatorTest, MatchesInMemoryEvaluationWithManyChunks) {
+  // Enough for the first level, but only for few prefixes per chunk afterwards.
+  this->EvaluateAndCompare(4096);
+}
+
+TYPED_TEST(OutOfCoreEvaluatorTest,
+           MatchesInMemoryEvaluationWithPrefixesFromFile) {
+  this->EvaluateAndCompare(4096, /*prefixes_from_file=*/true);
+}
+
+TYPED_TEST(OutOfCoreEvaluatorTest, MatchesInMemoryEvaluationWithOnePrefix) {
+  // Enough for a single prefix per chunk at the last level, which has the
+  // largest gap between domain sizes.
+  this->EvaluateAndCompare(128 + 16 * (sizeof(TypeParam) + 52));
+}
+
+TYPED_TEST(OutOfCoreEvaluatorTest, FailsIfPrefixesAreNotSorted) {
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<OutOfCoreEvaluator> evaluator,
+      OutOfCoreEvaluator::Create(*this->dpf_, this->keys_.first,
+                                 {.scratch_directory = ::testing::TempDir()}));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      RecordFile<TypeParam> output,
+      RecordFile<TypeParam>::CreateTemporary(::testing::TempDir()));
+  DPF_ASSERT_OK(evaluator->EvaluateUntil(0, {}, output));
+  std::vector<absl::uint128> prefixes = {3, 1, 2};
+  EXPECT_THAT(evaluator->EvaluateUntil(1, prefixes, output),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("must be sorted")));
+  EXPECT_EQ(evaluator->previous_hierarchy_level(), 0);
+}
+
+TYPED_TEST(OutOfCoreEvaluatorTest, FailsIfPrefixFileIsNotSortedAcrossChunks) {
+  // Fits a single prefix per chunk at the second level.
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<OutOfCoreEvaluator> evaluator,
+      OutOfCoreEvaluator::Create(
+          *this->dpf_, this->keys_.first,
+          {.scratch_directory = ::testing::TempDir(),
+           .max_memory_bytes = 128 + 8 * (sizeof(TypeParam) + 52)}));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      RecordFile<TypeParam> output,
+      RecordFile<TypeParam>::CreateTemporary(::testing::TempDir()));
+  DPF_ASSERT_OK(evaluator->EvaluateUntil(0, {}, output));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      RecordFile<absl::uint128> prefixes,
+      RecordFile<absl::uint128>::CreateTemporary(::testing::TempDir()));
+  std::vector<absl::uint128> records = {2, 3, 1};
+  DPF_ASSERT_OK(prefixes.Append(records));
+  EXPECT_THAT(evaluator->EvaluateUntil(1, prefixes, output),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("must be sorted")));
+  EXPECT_EQ(evaluator->previous_hierarchy_level(), 0);
+}
+
+TYPED_TEST(OutOfCoreEvaluatorTest, FailsIfFirstLevelExceedsMemory) {
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<OutOfCoreEvaluator> evaluator,
+      OutOfCoreEvaluator::Create(*this->dpf_, this->keys_.first,
+                                 {.scratch_directory = ::testing::TempDir(),
+                                  .max_memory_bytes = 512}));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      RecordFile<TypeParam> output,
+      RecordFile<TypeParam>::CreateTemporary(::testing::TempDir()));
+  EXPECT_THAT(evaluator->EvaluateUntil(0, {}, output),
+              StatusIs(absl::StatusCode::kResourceExhausted));
+}
+
+// Uses 128-bit outputs, such that prefixes and tree indices coincide.
+using OutOfCoreEvaluatorUint128Test = OutOfCoreEvaluatorTest<absl::uint128>;
+
+TEST_F(OutOfCoreEvaluatorUint128Test, FailsIfPrefixWasNotEvaluated) {
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<OutOfCoreEvaluator> evaluator,
+      OutOfCoreEvaluator::Create(*dpf_, keys_.first,
+                                 {.scratch_directory = ::testing::TempDir(),
+                                  .max_memory_bytes = 4096}));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      RecordFile<absl::uint128> output,
+      RecordFile<absl::uint128>::CreateTemporary(::testing::TempDir()));
+  DPF_ASSERT_OK(evaluator->EvaluateUntil(0, {}, output));
+  std::vector<absl::uint128> prefixes = {0, 1, 2, 3};
+  DPF_ASSERT_OK(evaluator->EvaluateUntil(1, prefixes, output));
+  // 63 extends 7, which was not evaluated at level 1. All prefixes fit into a
+  // single chunk, so the chunk also contains prefixes from the frontier.
+  prefixes = {0, 1, 63};
+  EXPECT_THAT(evaluator->EvaluateUntil(2, prefixes, output),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  // The evaluator can still be used after the error.
+  prefixes = {0, 1, 2, 31};
+  DPF_EXPECT_OK(evaluator->EvaluateUntil(2, prefixes, output));
+}
+
+TEST(OutOfCoreEvaluator, CreateFailsWithInvalidOptions) {
+  DpfParameters parameters;
+  parameters.set_log_domain_size(10);
+  *(parameters.mutable_value_type()) = ToValueType<uint32_t>();
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<DistributedPointFunction> dpf,
+                           DistributedPointFunction::Create(parameters));
+  DPF_ASSERT_OK_AND_ASSIGN(auto keys, dpf->GenerateKeys(23, 42));
+  EXPECT_THAT(OutOfCoreEvaluator::Create(*dpf, keys.first, {}),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(
+      OutOfCoreEvaluator::Create(*dpf, keys.first,
+                                 {.scratch_directory = ::testing::TempDir(),
+                                  .max_memory_bytes = 0}),
+      StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(RecordFileTest, OpenFailsIfSizeIsNotAMultipleOfRecordSize) {
+  std::string path = absl::StrCat(::testing::TempDir(), "/record_file_test");
+  {
+    DPF_ASSERT_OK_AND_ASSIGN(RecordFile<uint8_t> file,
+                             RecordFile<uint8_t>::Create(path));
+    std::vector<uint8_t> records = {1, 2, 3};
+    DPF_ASSERT_OK(file.Append(records));
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(RecordFile<uint8_t> bytes,
+                           RecordFile<uint8_t>::Open(path));
+  EXPECT_EQ(bytes.size(), 3);
+  EXPECT_THAT(RecordFile<uint16_t>::Open(path),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
@@ -0,0 +1,85 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "absl/container/btree_set.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "absl/numeric/int128.h"
+#include "absl/random/random.h"
+#include "experiments/synthetic_data.h"
+
+ABSL_FLAG(std::string, output, "",
+          "Path of the CSV file to write the non-zero buckets to, one per "
+          "line.");
+ABSL_FLAG(std::string, distribution, "uniform",
+          "Distribution of the non-zero buckets. One of \"uniform\", "
+          "\"power_law\" and \"zipf\".");
+ABSL_FLAG(double, skew, 0.1,
+          "For \"power_law\", the fraction of the domain holding a fraction of "
+          "1 - skew of the non-zeros. For \"zipf\", the exponent of the "
+          "distribution, which must be greater than 1.");
+ABSL_FLAG(int, log_domain_size, 20, "Logarithm of the domain size.");
+ABSL_FLAG(int64_t, num_nonzeros, 1 << 20,
+          "Number of distinct non-zero buckets to generate.");
+ABSL_FLAG(uint64_t, seed, 0,
+          "Seed for the random number generator. If 0, a random seed is used.");
+
+int main(int argc, char* argv[]) {
+  absl::SetProgramUsageMessage(
+      "generate_synthetic_data --output=<file> [OPTIONS]\n\n"
+      "Generates a set of distinct non-zero buckets of a sparse histogram, to "
+      "be used as --input of synthetic_data_benchmarks.");
+  absl::ParseCommandLine(argc, argv);
+  const std::string output = absl::GetFlag(FLAGS_output);
+  ABSL_QCHECK(!output.empty()) << "--output is required";
+
+  distributed_point_functions::experiments::SyntheticDataOptions options;
+  absl::StatusOr<distributed_point_functions::experiments::Distribution>
+      distribution = distributed_point_functions::experiments::
+          ParseDistribution(absl::GetFlag(FLAGS_distribution));
+  ABSL_QCHECK_OK(distribution.status());
+  options.distribution = *distribution;
+  options.skew = absl::GetFlag(FLAGS_skew);
+  options.log_domain_size = absl::GetFlag(FLAGS_log_domain_size);
+  options.num_nonzeros = absl::GetFlag(FLAGS_num_nonzeros);
+
+  uint64_t seed = absl::GetFlag(FLAGS_seed);
+  if (seed == 0) {
+    seed = absl::Uniform<uint64_t>(absl::BitGen());
+  }
+  std::seed_seq seed_seq{static_cast<uint32_t>(seed),
+                         static_cast<uint32_t>(seed >> 32)};
+  absl::BitGen rng(seed_seq);
+  absl::StatusOr<absl::btree_set<absl::uint128>> nonzeros =
+      distributed_point_functions::experiments::GenerateNonzeros(options, rng);
+  ABSL_QCHECK_OK(nonzeros.status());
+
+  std::ofstream file(output);
+  ABSL_QCHECK(file.is_open()) << "Could not open " << output;
+  for (const absl::uint128& nonzero : *nonzeros) {
+    file << nonzero << "\n";
+  }
+  file.close();
+  ABSL_QCHECK(!file.fail()) << "Could not write to " << output;
+  ABSL_LOG(INFO) << "Wrote " << nonzeros->size() << " non-zeros to " << output
+                 << " (seed " << seed << ")";
+}
@@ -0,0 +1,168 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "experiments/synthetic_data.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "absl/container/btree_set.h"
+#include "absl/numeric/int128.h"
+#include "absl/random/bit_gen_ref.h"
+#include "absl/random/distributions.h"
+#include "absl/random/zipf_distribution.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace distributed_point_functions {
+namespace experiments {
+
+namespace {
+
+// Maximum number of draws per requested non-zero before giving up.
+constexpr int64_t kMaxDrawsPerNonzero = 100;
+
+// Returns a uniformly random 128-bit integer.
+absl::uint128 Uniform128(absl::BitGenRef rng) {
+  return absl::MakeUint128(absl::Uniform<uint64_t>(rng),
+                           absl::Uniform<uint64_t>(rng));
+}
+
+// Returns a uniformly random integer in [0, bound), where `bound == 0` stands
+// for 2^128.
+absl::uint128 UniformBelow(absl::BitGenRef rng, absl::uint128 bound) {
+  if (bound == 0) {
+    return Uniform128(rng);
+  }
+  // Rejection sampling on the smallest power of two that is at least `bound`.
+  absl::uint128 mask = bound - 1;
+  for (int shift = 1; shift < 128; shift <<= 1) {
+    mask |= mask >> shift;
+  }
+  absl::uint128 result;
+  do {
+    result = Uniform128(rng) & mask;
+  } while (result >= bound);
+  return result;
+}
+
+}  // namespace
+
+absl::StatusOr<Distribution> ParseDistribution(absl::string_view name) {
+  if (name == "uniform") {
+    return Distribution::kUniform;
+  } else if (name == "power_law") {
+    return Distribution::kPowerLaw;
+  } else if (name == "zipf") {
+    return Distribution::kZipf;
+  }
+  return absl::InvalidArgumentError(absl::StrCat(
+      "Unknown distribution \"", name,
+      "\", must be one of \"uniform\", \"power_law\" and \"zipf\""));
+}
+
+absl::StatusOr<absl::btree_set<absl::uint128>> GenerateNonzeros(
+    const SyntheticDataOptions& options, absl::BitGenRef rng) {
+  const int log_domain_size = options.log_domain_size;
+  if (log_domain_size < 0 || log_domain_size > 128) {
+    return absl::InvalidArgumentError(
+        "`log_domain_size` must be in [0, 128]");
+  }
+  if (options.num_nonzeros <= 0) {
+    return absl::InvalidArgumentError("`num_nonzeros` must be positive");
+  }
+  if (log_domain_size < 63 && options.num_nonzeros > (int64_t{1}
+                                                       << log_domain_size)) {
+    return absl::InvalidArgumentError(
+        "`num_nonzeros` must be at most 2^log_domain_size");
+  }
+  if (options.distribution == Distribution::kPowerLaw &&
+      !(options.skew > 0 && options.skew < 1)) {
+    return absl::InvalidArgumentError(
+        "`skew` must be in (0, 1) for the power law distribution");
+  }
+  if (options.distribution == Distribution::kZipf && !(options.skew > 1)) {
+    return absl::InvalidArgumentError(
+        "`skew` must be greater than 1 for the Zipf distribution");
+  }
+
+  // The domain size, where 0 stands for 2^128. Subtraction wraps around
+  // accordingly.
+  const absl::uint128 domain_size =
+      log_domain_size == 128 ? 0 : absl::uint128{1} << log_domain_size;
+
+  // Size of the dense part of the domain for kPowerLaw, in [1, domain_size).
+  absl::uint128 hot_size = 1;
+  if (options.distribution == Distribution::kPowerLaw && domain_size != 1) {
+    hot_size = std::max(
+        absl::uint128{1},
+        absl::uint128(std::ldexp(options.skew, log_domain_size)));
+    if (domain_size != 0) {
+      hot_size = std::min(hot_size, domain_size - 1);
+    }
+  }
+
+  // For kZipf, the upper `zipf_bits` bits of each bucket are drawn from the
+  // Zipf distribution, and the rest uniformly.
+  const int zipf_bits = std::min(log_domain_size, 64);
+  const uint64_t zipf_max = zipf_bits == 64
+                                ? std::numeric_limits<uint64_t>::max()
+                                : (uint64_t{1} << zipf_bits) - 1;
+  const int uniform_bits = log_domain_size - zipf_bits;
+
+  absl::btree_set<absl::uint128> nonzeros;
+  const int64_t max_draws = kMaxDrawsPerNonzero * options.num_nonzeros;
+  for (int64_t i = 0; i < max_draws &&
+                      static_cast<int64_t>(nonzeros.size()) <
+                          options.num_nonzeros;
+       ++i) {
+    absl::uint128 bucket;
+    switch (options.distribution) {
+      case Distribution::kUniform:
+        bucket = UniformBelow(rng, domain_size);
+        break;
+      case Distribution::kPowerLaw:
+        if (domain_size == 1) {
+          bucket = 0;
+        } else if (absl::Bernoulli(rng, 1 - options.skew)) {
+          bucket = UniformBelow(rng, hot_size);
+        } else {
+          bucket = hot_size + UniformBelow(rng, domain_size - hot_size);
+        }
+        break;
+      case Distribution::kZipf:
+        bucket = absl::uint128{absl::Zipf<uint64_t>(rng, zipf_max,
+                                                    options.skew, 1.0)}
+                 << uniform_bits;
+        if (uniform_bits > 0) {
+          bucket |= UniformBelow(rng, absl::uint128{1} << uniform_bits);
+        }
+        break;
+    }
+    nonzeros.insert(bucket);
+  }
+  if (static_cast<int64_t>(nonzeros.size()) < options.num_nonzeros) {
+    return absl::FailedPreconditionError(absl::StrCat(
+        "Only found ", nonzeros.size(), " distinct non-zeros after ",
+        max_draws, " draws. Try a smaller `skew` or `num_nonzeros`"));
+  }
+  return nonzeros;
+}
+
+}  // namespace experiments
+}  // namespace distributed_point_functions
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_EXPERIMENTS_SYNTHETIC_DATA_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_EXPERIMENTS_SYNTHETIC_DATA_H_
+
+#include <cstdint>
+
+#include "absl/container/btree_set.h"
+#include "absl/numeric/int128.h"
+#include "absl/random/bit_gen_ref.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace distributed_point_functions {
+namespace experiments {
+
+// Distributions of the non-zero buckets of a synthetic sparse histogram.
+enum class Distribution {
+  // Every bucket in the domain is equally likely.
+  kUniform,
+  // A fraction `1 - skew` of the non-zeros is in the first `skew` fraction of
+  // the domain, the rest is spread uniformly over the remaining domain. This
+  // is how the files in experiments/data were generated, e.g., `skew = 0.1`
+  // puts 90% of the non-zeros into 10% of the domain.
+  kPowerLaw,
+  // The bucket prefix follows a Zipf distribution with exponent `skew`, i.e.,
+  // bucket prefix k is drawn with probability proportional to 1 / (k + 1)^skew.
+  // Domains larger than 2^64 draw the lower 64 bits uniformly.
+  kZipf,
+};
+
+// Parses one of "uniform", "power_law" and "zipf".
+absl::StatusOr<Distribution> ParseDistribution(absl::string_view name);
+
+struct SyntheticDataOptions {
+  Distribution distribution = Distribution::kUniform;
+
+  // Logarithm of the domain size, in [0, 128].
+  int log_domain_size = 20;
+
+  // Number of distinct non-zero buckets to generate. Must be positive and at
+  // most 2^log_domain_size.
+  int64_t num_nonzeros = 1 << 10;
+
+  // Skew parameter. Must be in (0, 1) for kPowerLaw and greater than 1 for
+  // kZipf. Ignored for kUniform.
+  double skew = 0.1;
+};
+
+// Draws `options.num_nonzeros` distinct buckets in [0, 2^log_domain_size)
+// from `options.distribution` using `rng`.
+//
+// Returns INVALID_ARGUMENT if `options` are invalid, and FAILED_PRECONDITION if
+// the distribution is too concentrated to produce enough distinct buckets.
+absl::StatusOr<absl::btree_set<absl::uint128>> GenerateNonzeros(
+    const SyntheticDataOptions& options, absl::BitGenRef rng);
+
+}  // namespace experiments
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_EXPERIMENTS_SYNTHETIC_DATA_H_
@@ -12,10 +12,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <sys/resource.h>
+
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -29,6 +36,8 @@
 #include "absl/random/random.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
@@ -38,6 +47,7 @@
 #include "benchmark/benchmark.h"  // third_party/benchmark
 #include "dpf/distributed_point_function.h"
 #include "dpf/distributed_point_function.pb.h"
+#include "experiments/synthetic_data.h"
 #include "imap.hpp"  // cppitertools
 #include "riegeli/bytes/fd_reader.h"
 #include "riegeli/lines/line_reading.h"
@@ -59,15 +69,33 @@ ABSL_FLAG(bool, only_nonzeros, false,
 ABSL_FLAG(std::vector<std::string>, levels_to_evaluate, {},
           "List of integers specifying the log domain sizes at which to insert "
           "hierarchy levels.");
+ABSL_FLAG(std::string, distribution, "",
+          "If set and --input is empty, generates the non-zeros in-process "
+          "from the given distribution instead of reading them from a file. "
+          "One of \"uniform\", \"power_law\" and \"zipf\".");
+ABSL_FLAG(int64_t, num_nonzeros, 1 << 20,
+          "Number of non-zeros to generate when --distribution is set.");
+ABSL_FLAG(double, skew, 0.1,
+          "Skew of the distribution passed via --distribution. See "
+          "generate_synthetic_data for its meaning.");
+ABSL_FLAG(int, num_keys, 1,
+          "Number of distinct DPF keys to evaluate in each iteration.");
+ABSL_FLAG(int, num_threads, 1,
+          "Number of threads evaluating keys concurrently.");
+ABSL_FLAG(std::string, output_json, "",
+          "If set, writes throughput, per-level timings and peak RSS as JSON "
+          "to the given file, or to stdout if set to \"-\".");
 
 namespace {
 
 const char* Usage() {
   return "synthetic_data_benchmarks [OPTIONS]\n\n"
-         "Runs a single DPF key evaluation on the specified domain. If an "
-         "input file is specified with --input, it is read as a CSV file "
-         "containing the bucket IDs to expand in the first column. Otherwise, "
-         "the full domain will be expanded.";
+         "Runs DPF key evaluations on the specified domain. If an input file "
+         "is specified with --input, it is read as a CSV file containing the "
+         "bucket IDs to expand in the first column. If --distribution is "
+         "given instead, the bucket IDs are generated from that distribution. "
+         "Otherwise, the full domain will be expanded. With --num_keys and "
+         "--num_threads, many keys are evaluated concurrently.";
 }
 
 void ValidateFlags() {
@@ -75,10 +103,19 @@ void ValidateFlags() {
   ABSL_QCHECK(log_domain_size >= 0) << "--log_domain_size must be non-negative";
   int num_iterations = absl::GetFlag(FLAGS_num_iterations);
   ABSL_QCHECK(num_iterations > 0) << "--num_iterations must be positive";
+  bool has_input = !absl::GetFlag(FLAGS_input).empty();
+  bool has_distribution = !absl::GetFlag(FLAGS_distribution).empty();
+  ABSL_QCHECK(!has_input || !has_distribution)
+      << "At most one of --input and --distribution may be set";
   if (absl::GetFlag(FLAGS_only_nonzeros)) {
-    ABSL_QCHECK(!absl::GetFlag(FLAGS_input).empty())
-        << "--input is required when --only_nonzeros is true";
+    ABSL_QCHECK(has_input || has_distribution)
+        << "--input or --distribution is required when --only_nonzeros is "
+           "true";
   }
+  ABSL_QCHECK(absl::GetFlag(FLAGS_num_keys) > 0)
+      << "--num_keys must be positive";
+  ABSL_QCHECK(absl::GetFlag(FLAGS_num_threads) > 0)
+      << "--num_threads must be positive";
   int max_expansion_factor = absl::GetFlag(FLAGS_max_expansion_factor);
   ABSL_QCHECK(max_expansion_factor >= 2)
       << "--max_expansion_factor must be at least 2";
@@ -171,46 +208,129 @@ std::vector<int> ComputeLevelsToEvaluate(
   return levels_to_evaluate;
 }
 
-// Evaluates the given `key` for `dpf` at each hierarchy level, using the given
-// `prefixes` for each level. Repeats `num_iterations` times.
+// Evaluates the given `ctx` for `dpf` at each hierarchy level, using the given
+// `prefixes` for each level. Adds the time spent on each level to
+// `level_times`.
 template <typename T>
 void RunHierarchicalEvaluation(
     const distributed_point_functions::DistributedPointFunction& dpf,
-    const distributed_point_functions::DpfKey& key,
-    absl::Span<const std::vector<absl::uint128>> prefixes, int num_iterations) {
-  const distributed_point_functions::EvaluationContext ctx =
-      dpf.CreateEvaluationContext(key).value();
+    const distributed_point_functions::EvaluationContext& ctx,
+    absl::Span<const std::vector<absl::uint128>> prefixes, bool log_sizes,
+    absl::Span<absl::Duration> level_times) {
   ABSL_CHECK_EQ(prefixes.size(), ctx.parameters_size());
-  for (int i = 0; i < num_iterations; ++i) {
-    distributed_point_functions::EvaluationContext ctx_copy = ctx;
-    for (int level = 0; level < static_cast<int>(prefixes.size()); ++level) {
-      std::vector<T> result =
-          dpf.EvaluateUntil<T>(level, prefixes[level], ctx_copy).value();
-      if (i == 0) {
-        ABSL_LOG(INFO) << "Number of outputs at " << level
-                       << "-th level: " << result.size();
-        ABSL_LOG(INFO) << "log_domain_size="
-                       << ctx.parameters(level).log_domain_size();
-      }
-      benchmark::DoNotOptimize(result);
+  ABSL_CHECK_EQ(prefixes.size(), level_times.size());
+  distributed_point_functions::EvaluationContext ctx_copy = ctx;
+  for (int level = 0; level < static_cast<int>(prefixes.size()); ++level) {
+    absl::Time start = absl::Now();
+    std::vector<T> result =
+        dpf.EvaluateUntil<T>(level, prefixes[level], ctx_copy).value();
+    level_times[level] += absl::Now() - start;
+    if (log_sizes) {
+      ABSL_LOG(INFO) << "Number of outputs at " << level
+                     << "-th level: " << result.size();
+      ABSL_LOG(INFO) << "log_domain_size="
+                     << ctx.parameters(level).log_domain_size();
     }
+    benchmark::DoNotOptimize(result);
   }
 }
 
-// Evaluates the given `key` for `dpf` at the points in `nonzeros`, repeating
-// `num_iterations` times.
+// Evaluates the given `key` for `dpf` at the points in `nonzeros`. Adds the
+// time spent to `time`.
 template <typename T>
 void RunBatchedSinglePointEvaluation(
     const distributed_point_functions::DistributedPointFunction& dpf,
     const distributed_point_functions::DpfKey& key,
-    absl::Span<const absl::uint128> nonzeros, int num_iterations) {
+    absl::Span<const absl::uint128> nonzeros, absl::Duration& time) {
   // Check that we have a single hierarchy level.
   ABSL_CHECK_EQ(dpf.parameters().size(), 1);
-  for (int i = 0; i < num_iterations; ++i) {
-    std::vector<T> result = dpf.EvaluateAt<T>(key, 0, nonzeros).value();
-    ABSL_CHECK_EQ(result.size(), nonzeros.size());
-    benchmark::DoNotOptimize(result);
+  absl::Time start = absl::Now();
+  std::vector<T> result = dpf.EvaluateAt<T>(key, 0, nonzeros).value();
+  time += absl::Now() - start;
+  ABSL_CHECK_EQ(result.size(), nonzeros.size());
+  benchmark::DoNotOptimize(result);
+}
+
+// Timings accumulated by RunReplay.
+struct ReplayStats {
+  // Total number of key evaluations.
+  int64_t num_evaluations = 0;
+  // Time spent on each hierarchy level, summed over all evaluations. Has a
+  // single element for direct evaluation.
+  std::vector<absl::Duration> level_times;
+};
+
+// Evaluates each of the `keys` `num_iterations` times on `num_threads`
+// threads, either hierarchically using `prefixes`, or directly at `nonzeros`
+// if `only_nonzeros` is true.
+template <typename T>
+ReplayStats RunReplay(
+    const distributed_point_functions::DistributedPointFunction& dpf,
+    absl::Span<const distributed_point_functions::DpfKey> keys,
+    absl::Span<const std::vector<absl::uint128>> prefixes,
+    absl::Span<const absl::uint128> nonzeros, bool only_nonzeros,
+    int num_iterations, int num_threads) {
+  std::vector<distributed_point_functions::EvaluationContext> contexts;
+  if (!only_nonzeros) {
+    contexts.reserve(keys.size());
+    for (const distributed_point_functions::DpfKey& key : keys) {
+      contexts.push_back(dpf.CreateEvaluationContext(key).value());
+    }
   }
+  const int num_levels = only_nonzeros ? 1 : prefixes.size();
+  const int64_t num_evaluations =
+      static_cast<int64_t>(keys.size()) * num_iterations;
+
+  // Threads pick the next evaluation from a shared counter, so that all
+  // threads stay busy until the end.
+  std::atomic<int64_t> next_evaluation = 0;
+  std::vector<ReplayStats> thread_stats(num_threads);
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back([&, i] {
+      ReplayStats& stats = thread_stats[i];
+      stats.level_times.resize(num_levels);
+      for (int64_t evaluation = next_evaluation++;
+           evaluation < num_evaluations; evaluation = next_evaluation++) {
+        const int key_index = evaluation % keys.size();
+        if (only_nonzeros) {
+          RunBatchedSinglePointEvaluation<T>(dpf, keys[key_index], nonzeros,
+                                             stats.level_times[0]);
+        } else {
+          RunHierarchicalEvaluation<T>(dpf, contexts[key_index], prefixes,
+                                       /*log_sizes=*/evaluation == 0,
+                                       absl::MakeSpan(stats.level_times));
+        }
+        ++stats.num_evaluations;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ReplayStats result;
+  result.level_times.resize(num_levels);
+  for (const ReplayStats& stats : thread_stats) {
+    result.num_evaluations += stats.num_evaluations;
+    for (int level = 0; level < num_levels; ++level) {
+      result.level_times[level] += stats.level_times[level];
+    }
+  }
+  return result;
+}
+
+// Returns the peak resident set size of this process in bytes.
+int64_t GetPeakRssBytes() {
+  struct rusage usage;
+  ABSL_CHECK_EQ(getrusage(RUSAGE_SELF, &usage), 0);
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  // Linux reports kilobytes.
+  return int64_t{usage.ru_maxrss} * 1024;
+#endif
 }
 
 }  // namespace
@@ -219,14 +339,30 @@ int main(int argc, char* argv[]) {
   absl::ParseCommandLine(argc, argv);
   ValidateFlags();
 
-  // Read nonzeros from input file, compute prefixes,
+  // Read or generate nonzeros, compute prefixes,
   std::string input_file = absl::GetFlag(FLAGS_input);
+  std::string distribution = absl::GetFlag(FLAGS_distribution);
   const int log_domain_size = absl::GetFlag(FLAGS_log_domain_size);
   std::vector<std::vector<absl::uint128>> prefixes(1);
+  absl::BitGen rng;
   if (!input_file.empty()) {
     absl::btree_set<absl::uint128> nonzeros =
         ReadUniqueValuesFromFile(input_file);
     prefixes = ComputePrefixes(nonzeros, log_domain_size);
+  } else if (!distribution.empty()) {
+    distributed_point_functions::experiments::SyntheticDataOptions options;
+    options.distribution =
+        distributed_point_functions::experiments::ParseDistribution(
+            distribution)
+            .value();
+    options.log_domain_size = log_domain_size;
+    options.num_nonzeros = absl::GetFlag(FLAGS_num_nonzeros);
+    options.skew = absl::GetFlag(FLAGS_skew);
+    absl::btree_set<absl::uint128> nonzeros =
+        distributed_point_functions::experiments::GenerateNonzeros(options,
+                                                                   rng)
+            .value();
+    prefixes = ComputePrefixes(nonzeros, log_domain_size);
   }
   int num_nonzeros = prefixes.back().size();
   ABSL_LOG(INFO) << "Number of nonzeros: " << num_nonzeros;
@@ -278,31 +414,67 @@ int main(int argc, char* argv[]) {
           parameters)
           .value();
 
-  // Generate DPF key.
-  absl::BitGen rng;
-  absl::uint128 alpha = absl::MakeUint128(absl::Uniform<uint64_t>(rng),
-                                          absl::Uniform<uint64_t>(rng));
-  if (log_domain_size < 128) {
-    alpha %= absl::uint128{1} << log_domain_size;
-  }
+  // Generate DPF keys.
+  const int num_keys = absl::GetFlag(FLAGS_num_keys);
   std::vector<absl::uint128> beta(parameters.size(), 1);
-  distributed_point_functions::DpfKey key;
-  std::tie(key, std::ignore) =
-      dpf->GenerateKeysIncremental(alpha, beta).value();
-  ABSL_LOG(INFO) << "Key size: " << key.ByteSizeLong() << " bytes";
+  std::vector<distributed_point_functions::DpfKey> keys(num_keys);
+  for (distributed_point_functions::DpfKey& key : keys) {
+    absl::uint128 alpha = absl::MakeUint128(absl::Uniform<uint64_t>(rng),
+                                            absl::Uniform<uint64_t>(rng));
+    if (log_domain_size < 128) {
+      alpha %= absl::uint128{1} << log_domain_size;
+    }
+    std::tie(key, std::ignore) =
+        dpf->GenerateKeysIncremental(alpha, beta).value();
+  }
+  ABSL_LOG(INFO) << "Key size: " << keys[0].ByteSizeLong() << " bytes";
 
   // Run the experiment and measure time.
-  int num_iterations = absl::GetFlag(FLAGS_num_iterations);
+  const int num_iterations = absl::GetFlag(FLAGS_num_iterations);
+  const int num_threads = absl::GetFlag(FLAGS_num_threads);
   using T = uint32_t;
   absl::Time start = absl::Now();
-  if (only_nonzeros) {
-    RunBatchedSinglePointEvaluation<T>(*dpf, key, prefixes.back(),
-                                       num_iterations);
-  } else {
-    RunHierarchicalEvaluation<T>(*dpf, key, prefixes_to_evaluate,
-                                 num_iterations);
-  }
+  ReplayStats stats =
+      RunReplay<T>(*dpf, keys, prefixes_to_evaluate, prefixes.back(),
+                   only_nonzeros, num_iterations, num_threads);
   absl::Duration wallclock = absl::Now() - start;
   ABSL_LOG(INFO) << "Wallclock time per iteration: "
                  << wallclock / num_iterations;
+  const double evaluations_per_second =
+      stats.num_evaluations / absl::ToDoubleSeconds(wallclock);
+  ABSL_LOG(INFO) << "Key evaluations per second: " << evaluations_per_second;
+
+  std::string output_json = absl::GetFlag(FLAGS_output_json);
+  if (!output_json.empty()) {
+    std::string json = absl::StrCat(
+        "{\n  \"mode\": \"", only_nonzeros ? "direct" : "hierarchical",
+        "\",\n  \"log_domain_size\": ", log_domain_size,
+        ",\n  \"num_nonzeros\": ", num_nonzeros,
+        ",\n  \"levels_to_evaluate\": [",
+        absl::StrJoin(levels_to_evaluate, ", "),
+        "],\n  \"num_keys\": ", num_keys, ",\n  \"num_threads\": ",
+        num_threads, ",\n  \"num_iterations\": ", num_iterations,
+        ",\n  \"num_evaluations\": ", stats.num_evaluations,
+        ",\n  \"wallclock_seconds\": ",
+        absl::StrFormat("%.9g", absl::ToDoubleSeconds(wallclock)),
+        ",\n  \"evaluations_per_second\": ",
+        absl::StrFormat("%.9g", evaluations_per_second),
+        ",\n  \"mean_level_seconds\": [",
+        absl::StrJoin(stats.level_times, ", ",
+                      [&stats](std::string* out, absl::Duration time) {
+                        absl::StrAppendFormat(
+                            out, "%.9g",
+                            absl::ToDoubleSeconds(time) /
+                                stats.num_evaluations);
+                      }),
+        "],\n  \"peak_rss_bytes\": ", GetPeakRssBytes(), "\n}\n");
+    if (output_json == "-") {
+      std::cout << json;
+    } else {
+      std::ofstream file(output_json);
+      file << json;
+      file.close();
+      ABSL_QCHECK(!file.fail()) << "Could not write to " << output_json;
+    }
+  }
 }
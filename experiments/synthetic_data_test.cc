@@ -0,0 +1,151 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "experiments/synthetic_data.h"
+
+#include <cstdint>
+#include <tuple>
+
+#include "absl/container/btree_set.h"
+#include "absl/numeric/int128.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace distributed_point_functions {
+namespace experiments {
+namespace {
+
+using dpf_internal::IsOkAndHolds;
+using dpf_internal::StatusIs;
+using ::testing::HasSubstr;
+
+TEST(SyntheticData, ParseDistribution) {
+  EXPECT_THAT(ParseDistribution("uniform"),
+              IsOkAndHolds(Distribution::kUniform));
+  EXPECT_THAT(ParseDistribution("power_law"),
+              IsOkAndHolds(Distribution::kPowerLaw));
+  EXPECT_THAT(ParseDistribution("zipf"), IsOkAndHolds(Distribution::kZipf));
+  EXPECT_THAT(ParseDistribution("gaussian"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unknown distribution")));
+}
+
+TEST(SyntheticData, FailsOnInvalidOptions) {
+  absl::BitGen rng;
+  SyntheticDataOptions options;
+  options.log_domain_size = 129;
+  EXPECT_THAT(GenerateNonzeros(options, rng),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("log_domain_size")));
+
+  options = SyntheticDataOptions();
+  options.log_domain_size = 4;
+  options.num_nonzeros = 17;
+  EXPECT_THAT(GenerateNonzeros(options, rng),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("num_nonzeros")));
+
+  options = SyntheticDataOptions();
+  options.distribution = Distribution::kPowerLaw;
+  options.skew = 1;
+  EXPECT_THAT(GenerateNonzeros(options, rng),
+              StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("skew")));
+
+  options.distribution = Distribution::kZipf;
+  EXPECT_THAT(GenerateNonzeros(options, rng),
+              StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("skew")));
+}
+
+TEST(SyntheticData, FailsIfDistributionIsTooConcentrated) {
+  absl::BitGen rng;
+  SyntheticDataOptions options;
+  options.distribution = Distribution::kZipf;
+  options.log_domain_size = 20;
+  options.num_nonzeros = 1 << 12;
+  options.skew = 10;
+  EXPECT_THAT(GenerateNonzeros(options, rng),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("distinct non-zeros")));
+}
+
+class SyntheticDataTest
+    : public ::testing::TestWithParam<std::tuple<Distribution, int>> {};
+
+TEST_P(SyntheticDataTest, GeneratesDistinctNonzerosInDomain) {
+  absl::BitGen rng;
+  SyntheticDataOptions options;
+  options.distribution = std::get<0>(GetParam());
+  options.log_domain_size = std::get<1>(GetParam());
+  options.num_nonzeros = 100;
+  options.skew = options.distribution == Distribution::kZipf ? 1.1 : 0.1;
+
+  DPF_ASSERT_OK_AND_ASSIGN(absl::btree_set<absl::uint128> nonzeros,
+                           GenerateNonzeros(options, rng));
+
+  EXPECT_EQ(nonzeros.size(), options.num_nonzeros);
+  if (options.log_domain_size < 128) {
+    EXPECT_LT(*nonzeros.rbegin(), absl::uint128{1}
+                                      << options.log_domain_size);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AllDistributions, SyntheticDataTest,
+    testing::Combine(testing::Values(Distribution::kUniform,
+                                     Distribution::kPowerLaw,
+                                     Distribution::kZipf),
+                     testing::Values(10, 32, 64, 100, 128)));
+
+TEST(SyntheticData, PowerLawIsSkewed) {
+  absl::BitGen rng;
+  SyntheticDataOptions options;
+  options.distribution = Distribution::kPowerLaw;
+  options.log_domain_size = 32;
+  options.num_nonzeros = 10000;
+  options.skew = 0.1;
+
+  DPF_ASSERT_OK_AND_ASSIGN(absl::btree_set<absl::uint128> nonzeros,
+                           GenerateNonzeros(options, rng));
+
+  const absl::uint128 hot_size = (absl::uint128{1} << 32) / 10;
+  int64_t num_hot = 0;
+  for (const absl::uint128& nonzero : nonzeros) {
+    num_hot += nonzero < hot_size;
+  }
+  // 90% in expectation.
+  EXPECT_GT(num_hot, 8500);
+  EXPECT_LT(num_hot, 9500);
+}
+
+TEST(SyntheticData, ZipfConcentratesOnSmallPrefixes) {
+  absl::BitGen rng;
+  SyntheticDataOptions options;
+  options.distribution = Distribution::kZipf;
+  options.log_domain_size = 32;
+  options.num_nonzeros = 1000;
+  options.skew = 1.5;
+
+  DPF_ASSERT_OK_AND_ASSIGN(absl::btree_set<absl::uint128> nonzeros,
+                           GenerateNonzeros(options, rng));
+
+  // Uniformly random buckets would almost never be this small.
+  EXPECT_LT(*nonzeros.begin(), 10);
+}
+
+}  // namespace
+}  // namespace experiments
+}  // namespace distributed_point_functions
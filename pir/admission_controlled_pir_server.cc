@@ -0,0 +1,218 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/admission_controlled_pir_server.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "dpf/status_macros.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+AdmissionControlledPirServer::AdmissionControlledPirServer(
+    std::unique_ptr<PirServer> server, Options options)
+    : server_(std::move(server)),
+      options_(std::move(options)),
+      next_sequence_number_(0) {}
+
+absl::StatusOr<std::unique_ptr<AdmissionControlledPirServer>>
+AdmissionControlledPirServer::Create(std::unique_ptr<PirServer> server,
+                                     Options options) {
+  if (server == nullptr) {
+    return absl::InvalidArgumentError("`server` cannot be null");
+  }
+  if (options.num_records <= 0) {
+    return absl::InvalidArgumentError("`num_records` must be positive");
+  }
+  if (options.max_record_bytes < 0) {
+    return absl::InvalidArgumentError(
+        "`max_record_bytes` must not be negative");
+  }
+  if (options.max_concurrent_requests <= 0) {
+    return absl::InvalidArgumentError(
+        "`max_concurrent_requests` must be positive");
+  }
+  if (options.max_memory_bytes < 0) {
+    return absl::InvalidArgumentError(
+        "`max_memory_bytes` must not be negative");
+  }
+  if (options.max_queue_size < 0) {
+    return absl::InvalidArgumentError("`max_queue_size` must not be negative");
+  }
+  if (options.max_overtakes < 0) {
+    return absl::InvalidArgumentError("`max_overtakes` must not be negative");
+  }
+  return absl::WrapUnique(
+      new AdmissionControlledPirServer(std::move(server), std::move(options)));
+}
+
+absl::StatusOr<AdmissionControlledPirServer::RequestCost>
+AdmissionControlledPirServer::EstimateCost(const PirRequest& request,
+                                           const Options& options) {
+  if (request.wrapped_pir_request_case() != PirRequest::kDpfPirRequest) {
+    return absl::InvalidArgumentError(
+        "`request` does not contain a valid DpfPirRequest");
+  }
+  RequestCost cost;
+  const DpfPirRequest& dpf_pir_request = request.dpf_pir_request();
+  switch (dpf_pir_request.wrapped_request_case()) {
+    case DpfPirRequest::kPlainRequest:
+      cost.num_keys = dpf_pir_request.plain_request().dpf_key_size();
+      break;
+    case DpfPirRequest::kLeaderRequest:
+      cost.num_keys =
+          dpf_pir_request.leader_request().plain_request().dpf_key_size();
+      break;
+    case DpfPirRequest::kEncryptedHelperRequest:
+      cost.num_keys = 1;
+      break;
+    default:
+      return absl::InvalidArgumentError(
+          "`request` does not contain a valid DpfPirRequest");
+  }
+
+  // Each key is evaluated on the full domain, and the resulting selection
+  // vector is combined with every database byte.
+  cost.compute = cost.num_keys * options.num_records *
+                 (1 + options.max_record_bytes);
+  // Each key needs a selection vector with one bit per record while it is being
+  // evaluated, and produces one record-sized response.
+  cost.memory_bytes = cost.num_keys * ((options.num_records + 7) / 8 +
+                                       options.max_record_bytes);
+  return cost;
+}
+
+const PirServerPublicParams& AdmissionControlledPirServer::GetPublicParams()
+    const {
+  return server_->GetPublicParams();
+}
+
+bool AdmissionControlledPirServer::HasCapacityFor(
+    const RequestCost& cost) const {
+  if (stats_.running_requests >= options_.max_concurrent_requests) {
+    return false;
+  }
+  return options_.max_memory_bytes == 0 ||
+         stats_.running_memory_bytes + cost.memory_bytes <=
+             options_.max_memory_bytes;
+}
+
+void AdmissionControlledPirServer::Admit(const RequestCost& cost) const {
+  ++stats_.running_requests;
+  stats_.running_memory_bytes += cost.memory_bytes;
+  ++stats_.admitted_requests;
+}
+
+AdmissionControlledPirServer::Waiter* AdmissionControlledPirServer::NextWaiter()
+    const {
+  Waiter* oldest = *arrival_queue_.begin();
+  if (oldest->overtake_limit <= stats_.admitted_requests) {
+    return oldest;
+  }
+  return *queue_.begin();
+}
+
+void AdmissionControlledPirServer::RemoveWaiter(Waiter* waiter) const {
+  queue_.erase(waiter);
+  arrival_queue_.erase(waiter);
+}
+
+void AdmissionControlledPirServer::DispatchQueue() const {
+  // Stop at the first request that does not fit instead of searching for one
+  // that does, so that requests needing a large part of the memory budget are
+  // not overtaken by smaller ones that happen to fit. NextWaiter() bounds how
+  // often cheaper requests can go first.
+  while (!queue_.empty()) {
+    Waiter* waiter = NextWaiter();
+    if (!HasCapacityFor(waiter->cost)) {
+      break;
+    }
+    RemoveWaiter(waiter);
+    waiter->admitted = true;
+    Admit(waiter->cost);
+  }
+  stats_.queue_depth = static_cast<int>(queue_.size());
+}
+
+absl::StatusOr<PirResponse> AdmissionControlledPirServer::HandleRequest(
+    const PirRequest& request) const {
+  DPF_ASSIGN_OR_RETURN(RequestCost cost, EstimateCost(request, options_));
+
+  {
+    absl::MutexLock lock(&mu_);
+    if (options_.max_memory_bytes > 0 &&
+        cost.memory_bytes > options_.max_memory_bytes) {
+      ++stats_.rejected_requests;
+      return absl::ResourceExhaustedError(absl::StrCat(
+          "Request needs an estimated ", cost.memory_bytes,
+          " bytes of memory, which exceeds the budget of ",
+          options_.max_memory_bytes, " bytes"));
+    }
+    if (queue_.empty() && HasCapacityFor(cost)) {
+      Admit(cost);
+    } else {
+      if (static_cast<int>(queue_.size()) >= options_.max_queue_size) {
+        ++stats_.rejected_requests;
+        return absl::ResourceExhaustedError(
+            absl::StrCat("Admission queue is full (", queue_.size(),
+                         " requests waiting)"));
+      }
+      Waiter waiter{cost, next_sequence_number_++,
+                    stats_.admitted_requests + options_.max_overtakes};
+      queue_.insert(&waiter);
+      arrival_queue_.insert(&waiter);
+      // The new request may be cheaper than everything else in the queue.
+      DispatchQueue();
+      stats_.max_queue_depth =
+          std::max(stats_.max_queue_depth, stats_.queue_depth);
+      mu_.AwaitWithTimeout(absl::Condition(&waiter.admitted),
+                           options_.max_queue_time);
+      if (!waiter.admitted) {
+        RemoveWaiter(&waiter);
+        // Requests behind this one might fit now.
+        DispatchQueue();
+        ++stats_.rejected_requests;
+        return absl::ResourceExhaustedError(
+            absl::StrCat("Request was not admitted within ",
+                         absl::FormatDuration(options_.max_queue_time)));
+      }
+    }
+  }
+
+  absl::StatusOr<PirResponse> response = server_->HandleRequest(request);
+
+  absl::MutexLock lock(&mu_);
+  --stats_.running_requests;
+  stats_.running_memory_bytes -= cost.memory_bytes;
+  DispatchQueue();
+  return response;
+}
+
+AdmissionControlledPirServer::Stats AdmissionControlledPirServer::GetStats()
+    const {
+  absl::MutexLock lock(&mu_);
+  return stats_;
+}
+
+}  // namespace distributed_point_functions
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_ADMISSION_CONTROLLED_PIR_SERVER_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_ADMISSION_CONTROLLED_PIR_SERVER_H_
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <tuple>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "pir/pir_server.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+// Wraps a PirServer (typically a DpfPirServer) with cost-aware admission
+// control. Each request's cost is estimated from its number of DPF keys and
+// the size of the database before it runs. Requests are admitted as long as
+// the number of concurrently running requests and their estimated memory
+// usage stay within the configured budgets. All other requests wait in a
+// queue that is ordered by estimated compute cost, so that cheap requests are
+// not stuck behind expensive ones. To bound the wait of expensive requests, a
+// request that has been overtaken by `Options::max_overtakes` others is
+// admitted next regardless of its cost. Requests that cannot be queued, or
+// that wait longer than `Options::max_queue_time`, fail with
+// RESOURCE_EXHAUSTED instead of piling up.
+//
+// This class is thread-safe, as long as the wrapped server's HandleRequest is.
+class AdmissionControlledPirServer : public PirServer {
+ public:
+  struct Options {
+    // Number of records in the wrapped server's database. Must be positive.
+    int64_t num_records = 0;
+
+    // Size in bytes of the largest record in the database, i.e., the size of
+    // the response to a single DPF key. Must not be negative.
+    int64_t max_record_bytes = 0;
+
+    // Maximum number of requests running at the same time. Must be positive.
+    int max_concurrent_requests = 1;
+
+    // Maximum total estimated memory in bytes of all running requests. A
+    // single request exceeding this budget is rejected immediately. A value of
+    // 0 means no limit.
+    int64_t max_memory_bytes = 0;
+
+    // Maximum number of requests waiting for admission. Requests arriving at a
+    // full queue are rejected. Must not be negative. Setting this to 0
+    // disables queueing, so that every request that cannot start immediately
+    // is rejected.
+    int max_queue_size = 64;
+
+    // Maximum time a request waits in the queue before it is rejected.
+    absl::Duration max_queue_time = absl::Seconds(30);
+
+    // Maximum number of requests admitted ahead of a waiting request because
+    // they are cheaper. Once a request has waited for this many admissions,
+    // it is admitted before any cheaper requests, so that expensive requests
+    // are not starved by a steady stream of cheap ones. A value of 0 admits
+    // requests in arrival order. Must not be negative.
+    int max_overtakes = 16;
+  };
+
+  // Estimated cost of a single request.
+  struct RequestCost {
+    // Number of DPF keys contained in the request.
+    int num_keys = 0;
+
+    // Compute cost in arbitrary units, proportional to the number of DPF
+    // evaluations plus the number of database bytes scanned. Used to order the
+    // queue.
+    int64_t compute = 0;
+
+    // Peak memory in bytes needed for selection vectors and responses.
+    int64_t memory_bytes = 0;
+  };
+
+  // Snapshot of the scheduler's state, to be exported as metrics.
+  struct Stats {
+    // Number of requests currently waiting for admission.
+    int queue_depth = 0;
+    // Largest queue depth observed so far.
+    int max_queue_depth = 0;
+    // Number of requests currently running.
+    int running_requests = 0;
+    // Total estimated memory of all running requests.
+    int64_t running_memory_bytes = 0;
+    // Total number of admitted requests.
+    int64_t admitted_requests = 0;
+    // Total number of requests rejected with RESOURCE_EXHAUSTED.
+    int64_t rejected_requests = 0;
+  };
+
+  // Creates a new AdmissionControlledPirServer forwarding admitted requests to
+  // `server`.
+  //
+  // Returns INVALID_ARGUMENT if `server` is NULL or `options` are invalid.
+  static absl::StatusOr<std::unique_ptr<AdmissionControlledPirServer>> Create(
+      std::unique_ptr<PirServer> server, Options options);
+
+  // Estimates the cost of `request` against a database described by `options`.
+  // The keys of an EncryptedHelperRequest are not visible before decryption,
+  // so such requests are counted as containing a single key. Helpers are
+  // usually only reachable through a Leader, which should apply admission
+  // control based on the plain part of the request.
+  //
+  // Returns INVALID_ARGUMENT if `request` is not a DpfPirRequest.
+  static absl::StatusOr<RequestCost> EstimateCost(const PirRequest& request,
+                                                  const Options& options);
+
+  // Forwards to the wrapped server.
+  const PirServerPublicParams& GetPublicParams() const override;
+
+  // Waits until `request` is admitted, and then forwards it to the wrapped
+  // server.
+  //
+  // Returns RESOURCE_EXHAUSTED if the request exceeds the memory budget on its
+  // own, if the queue is full, or if the request waits for longer than
+  // `Options::max_queue_time`. Returns INVALID_ARGUMENT if the cost of
+  // `request` cannot be estimated. Otherwise returns the wrapped server's
+  // response.
+  absl::StatusOr<PirResponse> HandleRequest(
+      const PirRequest& request) const override;
+
+  // Returns a snapshot of the current scheduler state.
+  Stats GetStats() const;
+
+  // Returns a reference to the wrapped server.
+  const PirServer& server() const { return *server_; }
+
+ private:
+  // A request waiting for admission. Ordered by compute cost first, and by
+  // arrival within the same cost.
+  struct Waiter {
+    RequestCost cost;
+    int64_t sequence_number;
+    // Value of `Stats::admitted_requests` from which on this request is
+    // admitted ahead of cheaper ones.
+    int64_t overtake_limit;
+    bool admitted = false;
+
+    bool operator<(const Waiter& other) const {
+      return std::tie(cost.compute, sequence_number) <
+             std::tie(other.cost.compute, other.sequence_number);
+    }
+  };
+  struct WaiterPtrLess {
+    bool operator()(const Waiter* a, const Waiter* b) const { return *a < *b; }
+  };
+  struct WaiterPtrArrivalLess {
+    bool operator()(const Waiter* a, const Waiter* b) const {
+      return a->sequence_number < b->sequence_number;
+    }
+  };
+
+  AdmissionControlledPirServer(std::unique_ptr<PirServer> server,
+                               Options options);
+
+  // Returns true if a request with the given cost can start right now.
+  bool HasCapacityFor(const RequestCost& cost) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Marks a request with the given cost as running.
+  void Admit(const RequestCost& cost) const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns the waiting request to be admitted next: the oldest one if it has
+  // been overtaken `Options::max_overtakes` times, and the cheapest one
+  // otherwise. The queue must not be empty.
+  Waiter* NextWaiter() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Removes `waiter` from the queue.
+  void RemoveWaiter(Waiter* waiter) const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Admits waiting requests in the order given by NextWaiter() while capacity
+  // allows.
+  void DispatchQueue() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  std::unique_ptr<PirServer> server_;
+  const Options options_;
+
+  mutable absl::Mutex mu_;
+  mutable std::set<Waiter*, WaiterPtrLess> queue_ ABSL_GUARDED_BY(mu_);
+  // The same requests as `queue_`, in order of arrival.
+  mutable std::set<Waiter*, WaiterPtrArrivalLess> arrival_queue_
+      ABSL_GUARDED_BY(mu_);
+  mutable int64_t next_sequence_number_ ABSL_GUARDED_BY(mu_);
+  mutable Stats stats_ ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_ADMISSION_CONTROLLED_PIR_SERVER_H_
@@ -0,0 +1,330 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/admission_controlled_pir_server.h"
+
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "pir/private_information_retrieval.pb.h"
+#include "pir/testing/mock_pir_server.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::IsOk;
+using dpf_internal::StatusIs;
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::Invoke;
+using ::testing::Return;
+using Options = AdmissionControlledPirServer::Options;
+
+constexpr int kNumRecords = 1024;
+constexpr int kRecordBytes = 16;
+
+PirRequest CreatePlainRequest(int num_keys) {
+  PirRequest request;
+  auto* plain_request =
+      request.mutable_dpf_pir_request()->mutable_plain_request();
+  for (int i = 0; i < num_keys; ++i) {
+    plain_request->add_dpf_key();
+  }
+  return request;
+}
+
+Options DefaultOptions() {
+  Options options;
+  options.num_records = kNumRecords;
+  options.max_record_bytes = kRecordBytes;
+  return options;
+}
+
+// Waits until the server reports the given queue depth.
+void AwaitQueueDepth(const AdmissionControlledPirServer& server, int depth) {
+  while (server.GetStats().queue_depth != depth) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+}
+
+TEST(AdmissionControlledPirServer, CreateFailsWithNullServer) {
+  EXPECT_THAT(AdmissionControlledPirServer::Create(nullptr, DefaultOptions()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`server` cannot be null")));
+}
+
+TEST(AdmissionControlledPirServer, CreateFailsWithInvalidOptions) {
+  Options options = DefaultOptions();
+  options.num_records = 0;
+  EXPECT_THAT(AdmissionControlledPirServer::Create(
+                  std::make_unique<pir_testing::MockPirServer>(), options),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("num_records")));
+
+  options = DefaultOptions();
+  options.max_concurrent_requests = 0;
+  EXPECT_THAT(AdmissionControlledPirServer::Create(
+                  std::make_unique<pir_testing::MockPirServer>(), options),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("max_concurrent_requests")));
+
+  options = DefaultOptions();
+  options.max_queue_size = -1;
+  EXPECT_THAT(AdmissionControlledPirServer::Create(
+                  std::make_unique<pir_testing::MockPirServer>(), options),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("max_queue_size")));
+
+  options = DefaultOptions();
+  options.max_overtakes = -1;
+  EXPECT_THAT(AdmissionControlledPirServer::Create(
+                  std::make_unique<pir_testing::MockPirServer>(), options),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("max_overtakes")));
+}
+
+TEST(AdmissionControlledPirServer, EstimateCostCountsKeys) {
+  Options options = DefaultOptions();
+  DPF_ASSERT_OK_AND_ASSIGN(
+      AdmissionControlledPirServer::RequestCost cost,
+      AdmissionControlledPirServer::EstimateCost(CreatePlainRequest(3),
+                                                 options));
+  EXPECT_EQ(cost.num_keys, 3);
+  EXPECT_EQ(cost.compute, 3 * kNumRecords * (1 + kRecordBytes));
+  EXPECT_EQ(cost.memory_bytes, 3 * (kNumRecords / 8 + kRecordBytes));
+
+  PirRequest leader_request;
+  auto* plain_request = leader_request.mutable_dpf_pir_request()
+                            ->mutable_leader_request()
+                            ->mutable_plain_request();
+  plain_request->add_dpf_key();
+  plain_request->add_dpf_key();
+  DPF_ASSERT_OK_AND_ASSIGN(
+      cost, AdmissionControlledPirServer::EstimateCost(leader_request,
+                                                       options));
+  EXPECT_EQ(cost.num_keys, 2);
+
+  PirRequest helper_request;
+  helper_request.mutable_dpf_pir_request()->mutable_encrypted_helper_request();
+  DPF_ASSERT_OK_AND_ASSIGN(
+      cost, AdmissionControlledPirServer::EstimateCost(helper_request,
+                                                       options));
+  EXPECT_EQ(cost.num_keys, 1);
+}
+
+TEST(AdmissionControlledPirServer, EstimateCostFailsWithEmptyRequest) {
+  EXPECT_THAT(
+      AdmissionControlledPirServer::EstimateCost(PirRequest(),
+                                                 DefaultOptions()),
+      StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(AdmissionControlledPirServer, ForwardsAdmittedRequests) {
+  auto mock_server = std::make_unique<pir_testing::MockPirServer>();
+  PirResponse response;
+  response.mutable_dpf_pir_response()->add_masked_response("response");
+  EXPECT_CALL(*mock_server, HandleRequest(_)).WillOnce(Return(response));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto server, AdmissionControlledPirServer::Create(std::move(mock_server),
+                                                        DefaultOptions()));
+
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse result,
+                           server->HandleRequest(CreatePlainRequest(1)));
+  EXPECT_THAT(result.dpf_pir_response().masked_response(),
+              ElementsAre("response"));
+  AdmissionControlledPirServer::Stats stats = server->GetStats();
+  EXPECT_EQ(stats.admitted_requests, 1);
+  EXPECT_EQ(stats.rejected_requests, 0);
+  EXPECT_EQ(stats.running_requests, 0);
+  EXPECT_EQ(stats.running_memory_bytes, 0);
+}
+
+TEST(AdmissionControlledPirServer, RejectsRequestsExceedingMemoryBudget) {
+  auto mock_server = std::make_unique<pir_testing::MockPirServer>();
+  EXPECT_CALL(*mock_server, HandleRequest(_)).Times(0);
+  Options options = DefaultOptions();
+  options.max_memory_bytes = 2 * (kNumRecords / 8 + kRecordBytes);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto server,
+      AdmissionControlledPirServer::Create(std::move(mock_server), options));
+
+  EXPECT_THAT(server->HandleRequest(CreatePlainRequest(3)),
+              StatusIs(absl::StatusCode::kResourceExhausted,
+                       HasSubstr("exceeds the budget")));
+  EXPECT_EQ(server->GetStats().rejected_requests, 1);
+}
+
+TEST(AdmissionControlledPirServer, RejectsRequestsWhenQueueIsFull) {
+  auto mock_server = std::make_unique<pir_testing::MockPirServer>();
+  absl::Notification started, release;
+  EXPECT_CALL(*mock_server, HandleRequest(_))
+      .WillOnce(Invoke([&](const PirRequest&) {
+        started.Notify();
+        release.WaitForNotification();
+        return PirResponse();
+      }));
+  Options options = DefaultOptions();
+  options.max_queue_size = 0;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto server,
+      AdmissionControlledPirServer::Create(std::move(mock_server), options));
+
+  std::thread running([&] {
+    EXPECT_THAT(server->HandleRequest(CreatePlainRequest(1)), IsOk());
+  });
+  started.WaitForNotification();
+  EXPECT_THAT(server->HandleRequest(CreatePlainRequest(1)),
+              StatusIs(absl::StatusCode::kResourceExhausted,
+                       HasSubstr("queue is full")));
+  release.Notify();
+  running.join();
+
+  AdmissionControlledPirServer::Stats stats = server->GetStats();
+  EXPECT_EQ(stats.admitted_requests, 1);
+  EXPECT_EQ(stats.rejected_requests, 1);
+}
+
+TEST(AdmissionControlledPirServer, RejectsRequestsAfterQueueTimeout) {
+  auto mock_server = std::make_unique<pir_testing::MockPirServer>();
+  absl::Notification started, release;
+  EXPECT_CALL(*mock_server, HandleRequest(_))
+      .WillOnce(Invoke([&](const PirRequest&) {
+        started.Notify();
+        release.WaitForNotification();
+        return PirResponse();
+      }));
+  Options options = DefaultOptions();
+  options.max_queue_size = 1;
+  options.max_queue_time = absl::Milliseconds(10);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto server,
+      AdmissionControlledPirServer::Create(std::move(mock_server), options));
+
+  std::thread running([&] {
+    EXPECT_THAT(server->HandleRequest(CreatePlainRequest(1)), IsOk());
+  });
+  started.WaitForNotification();
+  EXPECT_THAT(server->HandleRequest(CreatePlainRequest(1)),
+              StatusIs(absl::StatusCode::kResourceExhausted,
+                       HasSubstr("not admitted within")));
+  EXPECT_EQ(server->GetStats().queue_depth, 0);
+  EXPECT_EQ(server->GetStats().max_queue_depth, 1);
+  release.Notify();
+  running.join();
+}
+
+TEST(AdmissionControlledPirServer, AdmitsCheapRequestsFirst) {
+  auto mock_server = std::make_unique<pir_testing::MockPirServer>();
+  absl::Notification started, release;
+  absl::Mutex mu;
+  std::vector<int> handled_num_keys;
+  EXPECT_CALL(*mock_server, HandleRequest(_))
+      .WillRepeatedly(Invoke([&](const PirRequest& request) {
+        int num_keys = request.dpf_pir_request().plain_request().dpf_key_size();
+        if (num_keys == 1) {
+          started.Notify();
+          release.WaitForNotification();
+        }
+        absl::MutexLock lock(&mu);
+        handled_num_keys.push_back(num_keys);
+        return PirResponse();
+      }));
+  Options options = DefaultOptions();
+  options.max_queue_size = 3;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto server,
+      AdmissionControlledPirServer::Create(std::move(mock_server), options));
+
+  std::vector<std::thread> threads;
+  threads.emplace_back([&] {
+    EXPECT_THAT(server->HandleRequest(CreatePlainRequest(1)), IsOk());
+  });
+  started.WaitForNotification();
+  // Queue requests in order of decreasing cost.
+  for (int num_keys : {8, 4, 2}) {
+    threads.emplace_back([&, num_keys] {
+      EXPECT_THAT(server->HandleRequest(CreatePlainRequest(num_keys)), IsOk());
+    });
+    AwaitQueueDepth(*server, threads.size() - 1);
+  }
+  EXPECT_EQ(server->GetStats().max_queue_depth, 3);
+  release.Notify();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_THAT(handled_num_keys, ElementsAre(1, 2, 4, 8));
+  AdmissionControlledPirServer::Stats stats = server->GetStats();
+  EXPECT_EQ(stats.admitted_requests, 4);
+  EXPECT_EQ(stats.rejected_requests, 0);
+  EXPECT_EQ(stats.queue_depth, 0);
+}
+
+TEST(AdmissionControlledPirServer, AdmitsOvertakenRequestsAhead) {
+  auto mock_server = std::make_unique<pir_testing::MockPirServer>();
+  absl::Notification started, release;
+  absl::Mutex mu;
+  std::vector<int> handled_num_keys;
+  EXPECT_CALL(*mock_server, HandleRequest(_))
+      .WillRepeatedly(Invoke([&](const PirRequest& request) {
+        int num_keys = request.dpf_pir_request().plain_request().dpf_key_size();
+        if (num_keys == 1) {
+          started.Notify();
+          release.WaitForNotification();
+        }
+        absl::MutexLock lock(&mu);
+        handled_num_keys.push_back(num_keys);
+        return PirResponse();
+      }));
+  Options options = DefaultOptions();
+  options.max_queue_size = 4;
+  options.max_overtakes = 2;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto server,
+      AdmissionControlledPirServer::Create(std::move(mock_server), options));
+
+  std::vector<std::thread> threads;
+  threads.emplace_back([&] {
+    EXPECT_THAT(server->HandleRequest(CreatePlainRequest(1)), IsOk());
+  });
+  started.WaitForNotification();
+  // An expensive request followed by more cheap requests than it may be
+  // overtaken by.
+  for (int num_keys : {8, 2, 2, 2}) {
+    threads.emplace_back([&, num_keys] {
+      EXPECT_THAT(server->HandleRequest(CreatePlainRequest(num_keys)), IsOk());
+    });
+    AwaitQueueDepth(*server, threads.size() - 1);
+  }
+  release.Notify();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_THAT(handled_num_keys, ElementsAre(1, 2, 2, 8, 2));
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
@@ -0,0 +1,228 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pir/batching_helper_sender.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+// A batch of helper requests. `request` is guarded by the sender's `mu_` while
+// the batch is open, and only accessed by the thread sending the batch
+// afterwards. `responses` are written before `done` is notified.
+struct BatchingHelperSender::Batch {
+  Batch(int max_size, absl::Time deadline)
+      : max_size(max_size), deadline(deadline) {}
+
+  bool IsFull() const {
+    return request.dpf_pir_request()
+               .batched_helper_request()
+               .encrypted_helper_requests_size() >= max_size;
+  }
+
+  const int max_size;
+  // Time at which the batch is sent even if it is not full.
+  const absl::Time deadline;
+  PirRequest request;
+  std::vector<absl::StatusOr<PirResponse>> responses;
+  absl::Notification done;
+};
+
+BatchingHelperSender::BatchingHelperSender(BatchSenderFn batch_sender,
+                                           Options options)
+    : batch_sender_(std::move(batch_sender)), options_(std::move(options)) {
+  sender_threads_.reserve(options_.num_sender_threads);
+  for (int i = 0; i < options_.num_sender_threads; ++i) {
+    sender_threads_.emplace_back([this] { RunSenderThread(); });
+  }
+}
+
+BatchingHelperSender::~BatchingHelperSender() {
+  {
+    absl::MutexLock lock(&mu_);
+    shutting_down_ = true;
+  }
+  for (std::thread& thread : sender_threads_) {
+    thread.join();
+  }
+}
+
+absl::StatusOr<std::shared_ptr<BatchingHelperSender>>
+BatchingHelperSender::Create(BatchSenderFn batch_sender, Options options) {
+  if (!batch_sender) {
+    return absl::InvalidArgumentError("`batch_sender` cannot be null");
+  }
+  if (options.max_batch_size <= 0) {
+    return absl::InvalidArgumentError("`max_batch_size` must be positive");
+  }
+  if (options.max_delay < absl::ZeroDuration()) {
+    return absl::InvalidArgumentError("`max_delay` must not be negative");
+  }
+  if (options.num_sender_threads <= 0) {
+    return absl::InvalidArgumentError("`num_sender_threads` must be positive");
+  }
+  return std::shared_ptr<BatchingHelperSender>(
+      new BatchingHelperSender(std::move(batch_sender), std::move(options)));
+}
+
+DpfPirServer::ForwardHelperRequestFn
+BatchingHelperSender::AsForwardHelperRequestFn(
+    std::shared_ptr<const BatchingHelperSender> sender) {
+  return [sender = std::move(sender)](
+             const PirRequest& helper_request,
+             absl::AnyInvocable<void()> while_waiting) {
+    return sender->Send(helper_request, std::move(while_waiting));
+  };
+}
+
+absl::StatusOr<PirResponse> BatchingHelperSender::Send(
+    const PirRequest& helper_request,
+    absl::AnyInvocable<void()> while_waiting) const {
+  if (helper_request.dpf_pir_request().wrapped_request_case() !=
+      DpfPirRequest::kEncryptedHelperRequest) {
+    return absl::InvalidArgumentError(
+        "`helper_request` must be a valid EncryptedHelperRequest");
+  }
+
+  // Join the open batch, or open a new one if there is none. Full batches are
+  // handed to the sender threads right away, all others once they reach their
+  // deadline.
+  std::shared_ptr<Batch> batch;
+  int index;
+  {
+    absl::MutexLock lock(&mu_);
+    ++stats_.requests;
+    if (open_batch_ == nullptr) {
+      open_batch_ = std::make_shared<Batch>(options_.max_batch_size,
+                                            absl::Now() + options_.max_delay);
+    }
+    batch = open_batch_;
+    DpfPirRequest::BatchedHelperRequest& batched_request =
+        *(batch->request.mutable_dpf_pir_request()
+              ->mutable_batched_helper_request());
+    index = batched_request.encrypted_helper_requests_size();
+    *(batched_request.add_encrypted_helper_requests()) =
+        helper_request.dpf_pir_request().encrypted_helper_request();
+    if (batch->IsFull()) {
+      full_batches_.push_back(std::exchange(open_batch_, nullptr));
+    }
+  }
+
+  while_waiting();
+
+  batch->done.WaitForNotification();
+  return std::move(batch->responses[index]);
+}
+
+void BatchingHelperSender::RunSenderThread() const {
+  while (std::shared_ptr<Batch> batch = TakeNextBatch()) {
+    SendBatch(*batch);
+  }
+}
+
+std::shared_ptr<BatchingHelperSender::Batch>
+BatchingHelperSender::TakeNextBatch() const {
+  absl::MutexLock lock(&mu_);
+  while (true) {
+    if (!full_batches_.empty()) {
+      std::shared_ptr<Batch> batch = std::move(full_batches_.front());
+      full_batches_.pop_front();
+      return batch;
+    }
+    if (open_batch_ != nullptr &&
+        (shutting_down_ || absl::Now() >= open_batch_->deadline)) {
+      return std::exchange(open_batch_, nullptr);
+    }
+    if (shutting_down_) {
+      return nullptr;
+    }
+    // Wait until a batch becomes full, the open batch is replaced or reaches
+    // its deadline, or the destructor is called.
+    const Batch* const waiting_for = open_batch_.get();
+    auto should_wake_up = [this, waiting_for]()
+                              ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return !full_batches_.empty() || shutting_down_ ||
+             open_batch_.get() != waiting_for;
+    };
+    mu_.AwaitWithDeadline(absl::Condition(&should_wake_up),
+                          waiting_for != nullptr ? waiting_for->deadline
+                                                 : absl::InfiniteFuture());
+  }
+}
+
+void BatchingHelperSender::SendBatch(Batch& batch) const {
+  int num_requests;
+  {
+    absl::MutexLock lock(&mu_);
+    ++stats_.batches;
+    num_requests = batch.request.dpf_pir_request()
+                       .batched_helper_request()
+                       .encrypted_helper_requests_size();
+  }
+
+  absl::StatusOr<PirResponse> response = batch_sender_(batch.request);
+  if (response.ok() &&
+      response->batched_dpf_pir_response().responses_size() != num_requests) {
+    response = absl::InternalError(absl::StrCat(
+        "Helper returned ",
+        response->batched_dpf_pir_response().responses_size(),
+        " responses for a batch of ", num_requests, " requests"));
+  }
+  if (!response.ok()) {
+    {
+      absl::MutexLock lock(&mu_);
+      ++stats_.failed_batches;
+    }
+    batch.responses.assign(num_requests, response.status());
+    batch.done.Notify();
+    return;
+  }
+
+  batch.responses.reserve(num_requests);
+  for (BatchedDpfPirResponse::Entry& entry :
+       *(response->mutable_batched_dpf_pir_response()->mutable_responses())) {
+    if (entry.status_code() != 0) {
+      batch.responses.push_back(
+          absl::Status(static_cast<absl::StatusCode>(entry.status_code()),
+                       entry.status_message()));
+      continue;
+    }
+    PirResponse current_response;
+    *(current_response.mutable_dpf_pir_response()) =
+        std::move(*(entry.mutable_response()));
+    batch.responses.push_back(std::move(current_response));
+  }
+  batch.done.Notify();
+}
+
+BatchingHelperSender::Stats BatchingHelperSender::GetStats() const {
+  absl::MutexLock lock(&mu_);
+  return stats_;
+}
+
+}  // namespace distributed_point_functions
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_BATCHING_HELPER_SENDER_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_BATCHING_HELPER_SENDER_H_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "pir/dpf_pir_server.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+// Forwards a Leader's helper requests to the Helper in batches. Helper requests
+// arriving within `Options::max_delay` of each other are collected into a
+// single DpfPirRequest::BatchedHelperRequest, which is sent to the Helper with
+// a single call, and the Helper's BatchedDpfPirResponse is split up again
+// among the waiting requests. This saves the per-call overhead of the
+// transport, and allows the Helper to answer all requests in a batch with a
+// single pass over its database (see DpfPirServer::HandleRequest).
+//
+// Each request is still masked with the one-time-pad chosen by its client, so
+// batching does not reveal anything to the Leader beyond the individual
+// requests. The Leader computes its own share of each response while the batch
+// is in flight.
+//
+// Usage:
+//
+//   DPF_ASSIGN_OR_RETURN(
+//       std::shared_ptr<BatchingHelperSender> batching_sender,
+//       BatchingHelperSender::Create(std::move(batch_sender), options));
+//   DPF_ASSIGN_OR_RETURN(
+//       auto leader,
+//       DenseDpfPirServer::CreateLeader(
+//           config, std::move(database),
+//           BatchingHelperSender::AsForwardHelperRequestFn(batching_sender)));
+//
+// This class is thread-safe, as long as the batch sender function is. Batching
+// only helps if the Leader handles several requests concurrently.
+class BatchingHelperSender {
+ public:
+  // Function type for sending a batch to the Helper. Should send
+  // `batched_helper_request` to the Helper's HandleRequest and return its
+  // response. See pir/testing/in_process_helper_transport.h for a stand-in
+  // that calls a Helper in the same process.
+  using BatchSenderFn = absl::AnyInvocable<absl::StatusOr<PirResponse>(
+      const PirRequest& batched_helper_request) const>;
+
+  struct Options {
+    // Maximum time the first request of a batch waits for further requests
+    // before the batch is sent.
+    absl::Duration max_delay = absl::Milliseconds(1);
+
+    // Maximum number of requests in a batch. Full batches are sent right away.
+    // Must be positive.
+    int max_batch_size = 64;
+
+    // Number of threads sending batches to the Helper, i.e., the maximum number
+    // of batches in flight at the same time. Must be positive.
+    int num_sender_threads = 1;
+  };
+
+  // Counters to be exported as metrics.
+  struct Stats {
+    // Total number of helper requests.
+    int64_t requests = 0;
+    // Total number of batches sent to the Helper.
+    int64_t batches = 0;
+    // Number of batches for which the Helper did not return a valid response.
+    int64_t failed_batches = 0;
+  };
+
+  // Creates a new BatchingHelperSender that sends its batches with
+  // `batch_sender`.
+  //
+  // Returns INVALID_ARGUMENT if `batch_sender` is NULL, or if `options` are
+  // invalid.
+  static absl::StatusOr<std::shared_ptr<BatchingHelperSender>> Create(
+      BatchSenderFn batch_sender, Options options);
+
+  // Sends the open batch, if any, and joins the sender threads.
+  ~BatchingHelperSender();
+
+  // Returns a function that can be passed as the `sender` of a Leader, and
+  // that keeps `sender` alive for as long as it is used.
+  static DpfPirServer::ForwardHelperRequestFn AsForwardHelperRequestFn(
+      std::shared_ptr<const BatchingHelperSender> sender);
+
+  // Adds `helper_request` to the current batch, starting a new one if needed,
+  // and calls `while_waiting` on the calling thread. Returns once the Helper
+  // responded to the batch.
+  //
+  // Returns INVALID_ARGUMENT if `helper_request` is not an
+  // EncryptedHelperRequest. Returns the error returned by the batch sender if
+  // sending the batch failed, or the Helper's error for this request.
+  absl::StatusOr<PirResponse> Send(
+      const PirRequest& helper_request,
+      absl::AnyInvocable<void()> while_waiting) const;
+
+  // Returns a snapshot of the current counters.
+  Stats GetStats() const;
+
+ private:
+  struct Batch;
+
+  BatchingHelperSender(BatchSenderFn batch_sender, Options options);
+
+  // Main loop of each sender thread. Sends batches until the destructor is
+  // called and no batch is left.
+  void RunSenderThread() const;
+
+  // Blocks until a batch is full or reached its deadline, and returns it after
+  // removing it from `full_batches_` or `open_batch_`. Returns NULL once the
+  // destructor was called and no batch is left.
+  std::shared_ptr<Batch> TakeNextBatch() const;
+
+  // Sends `batch` to the Helper and hands out the responses.
+  void SendBatch(Batch& batch) const;
+
+  const BatchSenderFn batch_sender_;
+  const Options options_;
+
+  mutable absl::Mutex mu_;
+  // The batch currently accepting requests, if any.
+  mutable std::shared_ptr<Batch> open_batch_ ABSL_GUARDED_BY(mu_);
+  // Batches that became full and wait for a sender thread, oldest first.
+  mutable std::deque<std::shared_ptr<Batch>> full_batches_ ABSL_GUARDED_BY(mu_);
+  mutable Stats stats_ ABSL_GUARDED_BY(mu_);
+  bool shutting_down_ ABSL_GUARDED_BY(mu_) = false;
+
+  // Started by the constructor and joined by the destructor.
+  std::vector<std::thread> sender_threads_;
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_BATCHING_HELPER_SENDER_H_
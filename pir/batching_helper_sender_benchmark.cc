@@ -0,0 +1,233 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/random/random.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"  // third_party/benchmark
+#include "dpf/internal/memory_counters.h"
+#include "dpf/internal/status_matchers.h"
+#include "dpf/status_macros.h"
+#include "pir/batching_helper_sender.h"
+#include "pir/dense_dpf_pir_database.h"
+#include "pir/dense_dpf_pir_server.h"
+#include "pir/testing/encrypt_decrypt.h"
+#include "pir/testing/in_process_helper_transport.h"
+#include "pir/testing/mock_pir_database.h"
+#include "pir/testing/request_generator.h"
+
+// Batching pays off for small databases, where per-request overhead is a
+// significant part of the cost.
+ABSL_FLAG(int, num_records, 1 << 12,
+          "The number of records in the dense database.");
+ABSL_FLAG(int, num_bytes_per_record, 64,
+          "The number of bytes in each record.");
+ABSL_FLAG(absl::Duration, helper_latency, absl::Microseconds(200),
+          "Simulated round trip time of each call from Leader to Helper.");
+
+namespace distributed_point_functions {
+namespace {
+
+PirConfig CreateConfig() {
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(
+      absl::GetFlag(FLAGS_num_records));
+  return config;
+}
+
+absl::StatusOr<std::unique_ptr<DenseDpfPirServer::Database>>
+CreateDatabase() {
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<std::string> values,
+      pir_testing::GenerateRandomStringsEqualSize(
+          absl::GetFlag(FLAGS_num_records),
+          absl::GetFlag(FLAGS_num_bytes_per_record)));
+  DenseDpfPirDatabase::Builder builder;
+  for (auto& value : values) {
+    builder.Insert(std::move(value));
+  }
+  return builder.Build();
+}
+
+absl::StatusOr<std::unique_ptr<DenseDpfPirServer>> CreateHelper(
+    const crypto::tink::HybridDecrypt& hybrid_decrypt) {
+  DPF_ASSIGN_OR_RETURN(auto database, CreateDatabase());
+  return DenseDpfPirServer::CreateHelper(
+      CreateConfig(), std::move(database),
+      [&hybrid_decrypt](absl::string_view ciphertext,
+                        absl::string_view context_info) {
+        return hybrid_decrypt.Decrypt(ciphertext, context_info);
+      });
+}
+
+// Creates `num_requests` LeaderRequests for random single records.
+absl::StatusOr<std::vector<DpfPirRequest::LeaderRequest>>
+CreateLeaderRequests(int num_requests) {
+  const int num_records = absl::GetFlag(FLAGS_num_records);
+  DPF_ASSIGN_OR_RETURN(
+      auto request_generator,
+      pir_testing::RequestGenerator::Create(
+          num_records, DenseDpfPirServer::kEncryptionContextInfo));
+  absl::BitGen bitgen;
+  std::vector<DpfPirRequest::LeaderRequest> requests(num_requests);
+  for (auto& request : requests) {
+    DPF_ASSIGN_OR_RETURN(
+        request, request_generator->CreateDpfPirLeaderRequest(
+                     {absl::Uniform<int>(bitgen, 0, num_records)}));
+  }
+  return requests;
+}
+
+// Benchmarks the Helper answering `state.range(0)` helper requests, either one
+// by one or as a single BatchedHelperRequest if `state.range(1)` is nonzero.
+void BM_HelperHandlesRequests(benchmark::State& state) {
+  const int num_requests = state.range(0);
+  const bool batched = state.range(1) != 0;
+  DPF_ASSERT_OK_AND_ASSIGN(auto hybrid_decrypt,
+                           pir_testing::CreateFakeHybridDecrypt());
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<DenseDpfPirServer> helper,
+                           CreateHelper(*hybrid_decrypt));
+
+  std::vector<PirRequest> helper_requests(num_requests);
+  PirRequest batched_request;
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<DpfPirRequest::LeaderRequest>
+                               leader_requests,
+                           CreateLeaderRequests(num_requests));
+  for (int i = 0; i < num_requests; ++i) {
+    *(helper_requests[i]
+          .mutable_dpf_pir_request()
+          ->mutable_encrypted_helper_request()) =
+        leader_requests[i].encrypted_helper_request();
+    *(batched_request.mutable_dpf_pir_request()
+          ->mutable_batched_helper_request()
+          ->add_encrypted_helper_requests()) =
+        leader_requests[i].encrypted_helper_request();
+  }
+
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto _ : state) {
+    if (batched) {
+      auto response = helper->HandleRequest(batched_request);
+      benchmark::DoNotOptimize(response);
+    } else {
+      for (const PirRequest& request : helper_requests) {
+        auto response = helper->HandleRequest(request);
+        benchmark::DoNotOptimize(response);
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_requests);
+}
+BENCHMARK(BM_HelperHandlesRequests)
+    ->ArgNames({"num_requests", "batched"})
+    ->ArgsProduct({{1, 8, 64}, {0, 1}});
+
+// Benchmarks a Leader answering `state.range(0)` concurrent client requests,
+// forwarding the helper requests with a BatchingHelperSender if
+// `state.range(1)` is nonzero, and one call per request otherwise. Each call
+// to the Helper is delayed by `--helper_latency`.
+void BM_LeaderForwardsConcurrentRequests(benchmark::State& state) {
+  const int num_clients = state.range(0);
+  const bool batched = state.range(1) != 0;
+  const absl::Duration latency = absl::GetFlag(FLAGS_helper_latency);
+  DPF_ASSERT_OK_AND_ASSIGN(auto hybrid_decrypt,
+                           pir_testing::CreateFakeHybridDecrypt());
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<DenseDpfPirServer> helper,
+                           CreateHelper(*hybrid_decrypt));
+
+  DenseDpfPirServer::ForwardHelperRequestFn sender;
+  std::shared_ptr<BatchingHelperSender> batching_sender;
+  if (batched) {
+    BatchingHelperSender::Options options;
+    options.max_batch_size = num_clients;
+    DPF_ASSERT_OK_AND_ASSIGN(
+        batching_sender,
+        BatchingHelperSender::Create(
+            pir_testing::CreateInProcessBatchSender(*helper, latency),
+            options));
+    sender = BatchingHelperSender::AsForwardHelperRequestFn(batching_sender);
+  } else {
+    sender = pir_testing::CreateInProcessHelperSender(*helper, latency);
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(auto database, CreateDatabase());
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto leader, DenseDpfPirServer::CreateLeader(
+                       CreateConfig(), std::move(database), std::move(sender)));
+
+  std::vector<PirRequest> requests(num_clients);
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<DpfPirRequest::LeaderRequest>
+                               leader_requests,
+                           CreateLeaderRequests(num_clients));
+  for (int i = 0; i < num_clients; ++i) {
+    *(requests[i].mutable_dpf_pir_request()->mutable_leader_request()) =
+        std::move(leader_requests[i]);
+  }
+
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto _ : state) {
+    std::vector<std::thread> threads;
+    threads.reserve(num_clients);
+    for (const PirRequest& request : requests) {
+      threads.emplace_back([&leader, &request] {
+        auto response = leader->HandleRequest(request);
+        benchmark::DoNotOptimize(response);
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_clients);
+  if (batching_sender != nullptr) {
+    BatchingHelperSender::Stats stats = batching_sender->GetStats();
+    state.counters["requests_per_batch"] =
+        static_cast<double>(stats.requests) / stats.batches;
+  }
+}
+BENCHMARK(BM_LeaderForwardsConcurrentRequests)
+    ->ArgNames({"num_clients", "batched"})
+    ->ArgsProduct({{8, 64}, {0, 1}})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace distributed_point_functions
+
+// Declare benchmark_filter flag, which will be defined by benchmark library.
+// Use it to check if any benchmarks were specified explicitly.
+//
+namespace benchmark {
+extern std::string FLAGS_benchmark_filter;
+}
+using benchmark::FLAGS_benchmark_filter;
+
+int main(int argc, char* argv[]) {
+  FLAGS_benchmark_filter = "";
+  benchmark::Initialize(&argc, argv);
+  absl::ParseCommandLine(argc, argv);
+  if (!FLAGS_benchmark_filter.empty()) {
+    benchmark::RunSpecifiedBenchmarks();
+  }
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,393 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pir/batching_helper_sender.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "dpf/internal/status_matchers.h"
+#include "dpf/status_macros.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "pir/dense_dpf_pir_client.h"
+#include "pir/dense_dpf_pir_database.h"
+#include "pir/dense_dpf_pir_server.h"
+#include "pir/private_information_retrieval.pb.h"
+#include "pir/testing/encrypt_decrypt.h"
+#include "pir/testing/in_process_helper_transport.h"
+#include "pir/testing/mock_pir_database.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::StatusIs;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::StartsWith;
+using Options = BatchingHelperSender::Options;
+
+constexpr int kTestDatabaseElements = 1234;
+
+PirRequest CreateHelperRequest(absl::string_view encrypted_request) {
+  PirRequest request;
+  request.mutable_dpf_pir_request()
+      ->mutable_encrypted_helper_request()
+      ->set_encrypted_request(std::string(encrypted_request));
+  return request;
+}
+
+// Stand-in for a Helper that answers each request with its ciphertext, and
+// counts the batches it received in `num_batches`.
+BatchingHelperSender::BatchSenderFn CreateEchoingBatchSender(
+    std::atomic<int>& num_batches) {
+  return [&num_batches](const PirRequest& batched_helper_request) {
+    ++num_batches;
+    PirResponse response;
+    for (const auto& request : batched_helper_request.dpf_pir_request()
+                                   .batched_helper_request()
+                                   .encrypted_helper_requests()) {
+      response.mutable_batched_dpf_pir_response()
+          ->add_responses()
+          ->mutable_response()
+          ->add_masked_response(request.encrypted_request());
+    }
+    return response;
+  };
+}
+
+// Sends `num_requests` requests through `sender` concurrently, and returns the
+// responses in order.
+std::vector<absl::StatusOr<PirResponse>> SendConcurrently(
+    const BatchingHelperSender& sender, int num_requests) {
+  std::vector<absl::StatusOr<PirResponse>> responses(num_requests);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_requests; ++i) {
+    threads.emplace_back([&sender, &responses, i] {
+      responses[i] =
+          sender.Send(CreateHelperRequest(absl::StrCat("request ", i)), [] {});
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return responses;
+}
+
+TEST(BatchingHelperSender, CreateFailsWithNullBatchSender) {
+  EXPECT_THAT(BatchingHelperSender::Create(nullptr, Options()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`batch_sender` cannot be null")));
+}
+
+TEST(BatchingHelperSender, CreateFailsWithNonPositiveMaxBatchSize) {
+  std::atomic<int> num_batches = 0;
+  Options options;
+  options.max_batch_size = 0;
+  EXPECT_THAT(
+      BatchingHelperSender::Create(CreateEchoingBatchSender(num_batches),
+                                   options),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("`max_batch_size` must be positive")));
+}
+
+TEST(BatchingHelperSender, CreateFailsWithNegativeMaxDelay) {
+  std::atomic<int> num_batches = 0;
+  Options options;
+  options.max_delay = -absl::Milliseconds(1);
+  EXPECT_THAT(
+      BatchingHelperSender::Create(CreateEchoingBatchSender(num_batches),
+                                   options),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("`max_delay` must not be negative")));
+}
+
+TEST(BatchingHelperSender, CreateFailsWithNonPositiveNumSenderThreads) {
+  std::atomic<int> num_batches = 0;
+  Options options;
+  options.num_sender_threads = 0;
+  EXPECT_THAT(
+      BatchingHelperSender::Create(CreateEchoingBatchSender(num_batches),
+                                   options),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("`num_sender_threads` must be positive")));
+}
+
+TEST(BatchingHelperSender, SendFailsIfRequestIsNotEncryptedHelperRequest) {
+  std::atomic<int> num_batches = 0;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender, BatchingHelperSender::Create(
+                       CreateEchoingBatchSender(num_batches), Options()));
+
+  EXPECT_THAT(sender->Send(PirRequest(), [] {}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("EncryptedHelperRequest")));
+  EXPECT_EQ(num_batches, 0);
+}
+
+TEST(BatchingHelperSender, SingleRequestIsSentAfterMaxDelay) {
+  std::atomic<int> num_batches = 0;
+  Options options;
+  options.max_delay = absl::Milliseconds(10);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender, BatchingHelperSender::Create(
+                       CreateEchoingBatchSender(num_batches), options));
+
+  bool called_while_waiting = false;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      PirResponse response,
+      sender->Send(CreateHelperRequest("request"),
+                   [&called_while_waiting] { called_while_waiting = true; }));
+
+  EXPECT_TRUE(called_while_waiting);
+  EXPECT_THAT(response.dpf_pir_response().masked_response(),
+              ElementsAre("request"));
+  EXPECT_EQ(num_batches, 1);
+  BatchingHelperSender::Stats stats = sender->GetStats();
+  EXPECT_EQ(stats.requests, 1);
+  EXPECT_EQ(stats.batches, 1);
+  EXPECT_EQ(stats.failed_batches, 0);
+}
+
+TEST(BatchingHelperSender, ConcurrentRequestsAreBatched) {
+  constexpr int kNumRequests = 8;
+  std::atomic<int> num_batches = 0;
+  Options options;
+  // Only full batches are sent.
+  options.max_delay = absl::InfiniteDuration();
+  options.max_batch_size = kNumRequests / 2;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender, BatchingHelperSender::Create(
+                       CreateEchoingBatchSender(num_batches), options));
+
+  std::vector<absl::StatusOr<PirResponse>> responses =
+      SendConcurrently(*sender, kNumRequests);
+
+  for (int i = 0; i < kNumRequests; ++i) {
+    DPF_ASSERT_OK(responses[i]);
+    EXPECT_THAT(responses[i]->dpf_pir_response().masked_response(),
+                ElementsAre(absl::StrCat("request ", i)));
+  }
+  EXPECT_EQ(num_batches, 2);
+  BatchingHelperSender::Stats stats = sender->GetStats();
+  EXPECT_EQ(stats.requests, kNumRequests);
+  EXPECT_EQ(stats.batches, 2);
+}
+
+TEST(BatchingHelperSender, SenderThreadsSendBatchesConcurrently) {
+  constexpr int kNumRequests = 4;
+  constexpr int kNumBatches = 2;
+  std::atomic<int> num_batches = 0;
+  BatchingHelperSender::BatchSenderFn echoing_sender =
+      CreateEchoingBatchSender(num_batches);
+  // Each batch waits for the other one to be in flight before it is answered.
+  std::atomic<int> batches_in_flight = 0;
+  absl::Notification all_batches_in_flight;
+  std::atomic<bool> timed_out = false;
+  Options options;
+  options.max_delay = absl::InfiniteDuration();
+  options.max_batch_size = kNumRequests / kNumBatches;
+  options.num_sender_threads = kNumBatches;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender,
+      BatchingHelperSender::Create(
+          [&](const PirRequest& batched_helper_request) {
+            if (++batches_in_flight == kNumBatches) {
+              all_batches_in_flight.Notify();
+            }
+            if (!all_batches_in_flight.WaitForNotificationWithTimeout(
+                    absl::Seconds(10))) {
+              timed_out = true;
+            }
+            return echoing_sender(batched_helper_request);
+          },
+          options));
+
+  for (const absl::StatusOr<PirResponse>& response :
+       SendConcurrently(*sender, kNumRequests)) {
+    DPF_EXPECT_OK(response);
+  }
+  EXPECT_FALSE(timed_out);
+  EXPECT_EQ(num_batches, kNumBatches);
+}
+
+TEST(BatchingHelperSender, BatchSenderErrorIsReturnedForAllRequests) {
+  constexpr int kNumRequests = 3;
+  Options options;
+  options.max_delay = absl::InfiniteDuration();
+  options.max_batch_size = kNumRequests;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender,
+      BatchingHelperSender::Create(
+          [](const PirRequest&) -> absl::StatusOr<PirResponse> {
+            return absl::UnavailableError("Helper is down");
+          },
+          options));
+
+  for (const absl::StatusOr<PirResponse>& response :
+       SendConcurrently(*sender, kNumRequests)) {
+    EXPECT_THAT(response, StatusIs(absl::StatusCode::kUnavailable,
+                                   HasSubstr("Helper is down")));
+  }
+  EXPECT_EQ(sender->GetStats().failed_batches, 1);
+}
+
+TEST(BatchingHelperSender, SendFailsIfHelperReturnsWrongNumberOfResponses) {
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender,
+      BatchingHelperSender::Create(
+          [](const PirRequest&) -> absl::StatusOr<PirResponse> {
+            PirResponse response;
+            response.mutable_batched_dpf_pir_response();
+            return response;
+          },
+          Options()));
+
+  EXPECT_THAT(sender->Send(CreateHelperRequest("request"), [] {}),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("0 responses for a batch of 1 requests")));
+}
+
+TEST(BatchingHelperSender, HelperErrorIsOnlyReturnedForFailedRequest) {
+  constexpr int kNumRequests = 2;
+  Options options;
+  options.max_delay = absl::InfiniteDuration();
+  options.max_batch_size = kNumRequests;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender,
+      BatchingHelperSender::Create(
+          [](const PirRequest& batched_helper_request)
+              -> absl::StatusOr<PirResponse> {
+            PirResponse response;
+            for (const auto& request : batched_helper_request.dpf_pir_request()
+                                           .batched_helper_request()
+                                           .encrypted_helper_requests()) {
+              BatchedDpfPirResponse::Entry* entry =
+                  response.mutable_batched_dpf_pir_response()->add_responses();
+              if (request.encrypted_request() == "request 1") {
+                entry->set_status_code(
+                    static_cast<int>(absl::StatusCode::kInvalidArgument));
+                entry->set_status_message("invalid request");
+              } else {
+                entry->mutable_response()->add_masked_response("response");
+              }
+            }
+            return response;
+          },
+          options));
+
+  std::vector<absl::StatusOr<PirResponse>> responses =
+      SendConcurrently(*sender, kNumRequests);
+
+  DPF_ASSERT_OK(responses[0]);
+  EXPECT_THAT(responses[0]->dpf_pir_response().masked_response(),
+              ElementsAre("response"));
+  EXPECT_THAT(responses[1], StatusIs(absl::StatusCode::kInvalidArgument,
+                                     HasSubstr("invalid request")));
+}
+
+TEST(BatchingHelperSender, EndToEndWithDenseDpfPirServers) {
+  constexpr int kNumClients = 16;
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(
+      kTestDatabaseElements);
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<std::string> elements,
+                           pir_testing::GenerateCountingStrings(
+                               kTestDatabaseElements, "Element "));
+
+  // Set up the Helper.
+  DPF_ASSERT_OK_AND_ASSIGN(auto hybrid_decrypt,
+                           pir_testing::CreateFakeHybridDecrypt());
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto helper_database,
+      pir_testing::CreateFakeDatabase<DenseDpfPirDatabase>(elements));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto helper,
+      DenseDpfPirServer::CreateHelper(
+          config, std::move(helper_database),
+          [&hybrid_decrypt](absl::string_view ciphertext,
+                            absl::string_view context_info) {
+            return hybrid_decrypt->Decrypt(ciphertext, context_info);
+          }));
+
+  // Set up the Leader, forwarding to the Helper in batches.
+  Options options;
+  options.max_delay = absl::InfiniteDuration();
+  options.max_batch_size = kNumClients / 2;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<BatchingHelperSender> batching_sender,
+      BatchingHelperSender::Create(
+          pir_testing::CreateInProcessBatchSender(*helper), options));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto leader_database,
+      pir_testing::CreateFakeDatabase<DenseDpfPirDatabase>(elements));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto leader,
+      DenseDpfPirServer::CreateLeader(
+          config, std::move(leader_database),
+          BatchingHelperSender::AsForwardHelperRequestFn(batching_sender)));
+
+  // Set up the client.
+  DPF_ASSERT_OK_AND_ASSIGN(auto hybrid_encrypt,
+                           pir_testing::CreateFakeHybridEncrypt());
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto client,
+      DenseDpfPirClient::Create(
+          config, [&hybrid_encrypt](absl::string_view plain_pir_request,
+                                    absl::string_view context_info) {
+            return hybrid_encrypt->Encrypt(plain_pir_request, context_info);
+          }));
+
+  // Each client queries a different pair of records.
+  std::vector<absl::StatusOr<std::vector<std::string>>> results(kNumClients);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumClients; ++i) {
+    threads.emplace_back([&, i] {
+      results[i] = [&]() -> absl::StatusOr<std::vector<std::string>> {
+        DPF_ASSIGN_OR_RETURN(auto request,
+                             client->CreateRequest({i, 2 * i + 1}));
+        DPF_ASSIGN_OR_RETURN(PirResponse response,
+                             leader->HandleRequest(request.first));
+        return client->HandleResponse(response, request.second);
+      }();
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (int i = 0; i < kNumClients; ++i) {
+    DPF_ASSERT_OK(results[i]);
+    // Using StartsWith because of trailing null bytes.
+    EXPECT_THAT(*results[i], ElementsAre(StartsWith(elements[i]),
+                                         StartsWith(elements[2 * i + 1])));
+  }
+  BatchingHelperSender::Stats stats = batching_sender->GetStats();
+  EXPECT_EQ(stats.requests, kNumClients);
+  EXPECT_EQ(stats.batches, 2);
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
@@ -0,0 +1,159 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/columnar_dense_dpf_pir_database.h"
+
+#include <stddef.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "dpf/status_macros.h"
+#include "pir/dense_dpf_pir_database.h"
+
+namespace distributed_point_functions {
+
+ColumnarDenseDpfPirDatabase::Builder::Builder() : has_been_built_(false) {}
+
+std::unique_ptr<ColumnarDenseDpfPirDatabase::Interface::Builder>
+ColumnarDenseDpfPirDatabase::Builder::Clone() const {
+  auto result = std::make_unique<Builder>();
+  result->column_sizes_ = column_sizes_;
+  result->values_ = values_;
+  result->has_been_built_ = has_been_built_;
+  return result;
+}
+
+ColumnarDenseDpfPirDatabase::Builder&
+ColumnarDenseDpfPirDatabase::Builder::Insert(std::string value) {
+  values_.push_back(std::move(value));
+  return *this;
+}
+
+ColumnarDenseDpfPirDatabase::Builder&
+ColumnarDenseDpfPirDatabase::Builder::Clear() {
+  values_.clear();
+  has_been_built_ = false;
+  return *this;
+}
+
+ColumnarDenseDpfPirDatabase::Builder&
+ColumnarDenseDpfPirDatabase::Builder::SetColumnSizes(
+    std::vector<int64_t> column_sizes) {
+  column_sizes_ = std::move(column_sizes);
+  return *this;
+}
+
+absl::StatusOr<std::unique_ptr<ColumnarDenseDpfPirDatabase::Interface>>
+ColumnarDenseDpfPirDatabase::Builder::Build() {
+  if (has_been_built_) {
+    return absl::FailedPreconditionError("Database already built");
+  }
+  has_been_built_ = true;
+  if (column_sizes_.empty()) {
+    return absl::InvalidArgumentError("`column_sizes` must not be empty");
+  }
+  int64_t record_size = 0;
+  for (int64_t column_size : column_sizes_) {
+    if (column_size <= 0) {
+      return absl::InvalidArgumentError("`column_sizes` must be positive");
+    }
+    record_size += column_size;
+  }
+  for (size_t i = 0; i < values_.size(); ++i) {
+    if (values_[i].size() > record_size) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Record ", i, " has size ", values_[i].size(),
+          ", which is larger than the sum of the column sizes (=", record_size,
+          ")"));
+    }
+  }
+
+  // Split the records column by column, padding each column to its full size
+  // so that all responses for a column have the same size.
+  std::vector<std::string> values = std::move(values_);
+  std::vector<std::unique_ptr<DenseDatabase>> columns;
+  columns.reserve(column_sizes_.size());
+  int64_t column_offset = 0;
+  for (int64_t column_size : column_sizes_) {
+    DenseDpfPirDatabase::Builder column_builder;
+    for (const std::string& value : values) {
+      std::string column_value;
+      if (column_offset < value.size()) {
+        column_value = value.substr(column_offset, column_size);
+      }
+      column_value.resize(column_size, '\0');
+      column_builder.Insert(std::move(column_value));
+    }
+    DPF_ASSIGN_OR_RETURN(std::unique_ptr<DenseDatabase> column,
+                         column_builder.Build());
+    columns.push_back(std::move(column));
+    column_offset += column_size;
+  }
+  return absl::WrapUnique(new ColumnarDenseDpfPirDatabase(
+      std::move(columns), column_sizes_, values.size()));
+}
+
+ColumnarDenseDpfPirDatabase::ColumnarDenseDpfPirDatabase(
+    std::vector<std::unique_ptr<DenseDatabase>> columns,
+    std::vector<int64_t> column_sizes, size_t size)
+    : columns_(std::move(columns)),
+      column_sizes_(std::move(column_sizes)),
+      size_(size) {}
+
+absl::StatusOr<std::vector<std::string>>
+ColumnarDenseDpfPirDatabase::InnerProductWith(
+    absl::Span<const std::vector<BlockType>> selections) const {
+  std::vector<std::string> result(selections.size());
+  for (const std::unique_ptr<DenseDatabase>& column : columns_) {
+    DPF_ASSIGN_OR_RETURN(std::vector<std::string> inner_products,
+                         column->InnerProductWith(selections));
+    for (size_t k = 0; k < selections.size(); ++k) {
+      result[k].append(inner_products[k]);
+    }
+  }
+  return result;
+}
+
+absl::StatusOr<std::vector<std::string>>
+ColumnarDenseDpfPirDatabase::InnerProductWithColumns(
+    absl::Span<const std::vector<BlockType>> selections,
+    absl::Span<const int> columns) const {
+  for (int column : columns) {
+    if (column < 0 || column >= num_columns()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Column ", column, " out of bounds for a database with ",
+          num_columns(), " columns"));
+    }
+  }
+  std::vector<std::string> result(selections.size() * columns.size());
+  for (size_t j = 0; j < columns.size(); ++j) {
+    DPF_ASSIGN_OR_RETURN(std::vector<std::string> inner_products,
+                         columns_[columns[j]]->InnerProductWith(selections));
+    for (size_t k = 0; k < selections.size(); ++k) {
+      result[k * columns.size() + j] = std::move(inner_products[k]);
+    }
+  }
+  return result;
+}
+
+}  // namespace distributed_point_functions
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_COLUMNAR_DENSE_DPF_PIR_DATABASE_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_COLUMNAR_DENSE_DPF_PIR_DATABASE_H_
+
+#include <stddef.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "dpf/xor_wrapper.h"
+#include "pir/pir_database_interface.h"
+
+namespace distributed_point_functions {
+
+// Dense database for fixed-layout records that consist of several columns
+// (e.g., the fields of a struct). Each column is stored in its own dense
+// database, so that queries for a subset of the columns only read the bytes
+// of these columns (see InnerProductWithColumns). Can be used with
+// DenseDpfPirServer in place of DenseDpfPirDatabase. Queries for whole records
+// return the concatenation of all columns, padded with null bytes to the full
+// record size.
+class ColumnarDenseDpfPirDatabase
+    : public PirDatabaseInterface<XorWrapper<absl::uint128>, std::string> {
+ public:
+  using Interface = PirDatabaseInterface;
+  // Type of the underlying database implementation that stores each column.
+  using DenseDatabase =
+      PirDatabaseInterface<XorWrapper<absl::uint128>, std::string>;
+
+  // The concrete Builder for ColumnarDenseDpfPirDatabase.
+  class Builder : public PirDatabaseInterface::Builder {
+   public:
+    Builder();
+    // Appends a record `value` at the end of the database. On Build(), the
+    // record is split into columns of the sizes passed to SetColumnSizes.
+    // Records shorter than the sum of the column sizes are padded with null
+    // bytes.
+    Builder& Insert(std::string) override;
+    // Clears all elements inserted into this builder, but leaves any other
+    // configuration intact.
+    Builder& Clear() override;
+    // Sets the size in bytes of each column, in the order in which they appear
+    // in a record. Must be called before calling `Build`.
+    Builder& SetColumnSizes(std::vector<int64_t> column_sizes);
+    // Returns a copy of this builder.
+    std::unique_ptr<PirDatabaseInterface::Builder> Clone() const override;
+    // Builds the database and invalidated the builder. All subsequent calls to
+    // Build() will fail with FAILED_PRECONDITION. Returns INVALID_ARGUMENT if
+    // no or non-positive column sizes were set, or if a record is longer than
+    // the sum of the column sizes.
+    absl::StatusOr<std::unique_ptr<PirDatabaseInterface>> Build() override;
+
+   private:
+    std::vector<int64_t> column_sizes_;
+    std::vector<std::string> values_;
+    bool has_been_built_;
+  };
+
+  // Returns the number of records contained in the database.
+  size_t size() const override { return size_; }
+
+  // The number of selection bits is equal to the number of records.
+  size_t num_selection_bits() const override { return size(); }
+
+  // Returns the inner product between the whole database records and a bit
+  // vector (packed in blocks). Each response has the size of a full record.
+  absl::StatusOr<std::vector<RecordType>> InnerProductWith(
+      absl::Span<const std::vector<BlockType>> selections) const override;
+
+  // Returns the inner products restricted to the given `columns`, without
+  // reading any of the other columns. Each response has the size of its
+  // column. Returns INVALID_ARGUMENT if any column is out of bounds.
+  absl::StatusOr<std::vector<RecordType>> InnerProductWithColumns(
+      absl::Span<const std::vector<BlockType>> selections,
+      absl::Span<const int> columns) const override;
+
+  // Returns the number of columns of each record.
+  int num_columns() const { return columns_.size(); }
+
+  // Returns the size in bytes of each column.
+  absl::Span<const int64_t> column_sizes() const { return column_sizes_; }
+
+ private:
+  ColumnarDenseDpfPirDatabase(
+      std::vector<std::unique_ptr<DenseDatabase>> columns,
+      std::vector<int64_t> column_sizes, size_t size);
+
+  // One dense database per column, each holding the column's bytes of all
+  // records.
+  std::vector<std::unique_ptr<DenseDatabase>> columns_;
+  std::vector<int64_t> column_sizes_;
+  // Number of records in the database.
+  size_t size_;
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_COLUMNAR_DENSE_DPF_PIR_DATABASE_H_
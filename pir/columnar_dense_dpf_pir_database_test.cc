@@ -0,0 +1,188 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/columnar_dense_dpf_pir_database.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "pir/testing/mock_pir_database.h"
+#include "pir/testing/pir_selection_bits.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::IsOkAndHolds;
+using dpf_internal::StatusIs;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using BlockType = ColumnarDenseDpfPirDatabase::BlockType;
+using InterfacePtr = std::unique_ptr<ColumnarDenseDpfPirDatabase::Interface>;
+
+constexpr int kNumValues = 300;
+constexpr int kMaxValueBytes = 40;
+const std::vector<int64_t> kColumnSizes = {4, 20, 16};
+
+TEST(ColumnarDenseDpfPirDatabaseBuilder, BuildFailsIfColumnSizesAreNotSet) {
+  ColumnarDenseDpfPirDatabase::Builder builder;
+
+  EXPECT_THAT(builder.Build(), StatusIs(absl::StatusCode::kInvalidArgument,
+                                        HasSubstr("column_sizes")));
+}
+
+TEST(ColumnarDenseDpfPirDatabaseBuilder, BuildFailsIfColumnSizeIsZero) {
+  ColumnarDenseDpfPirDatabase::Builder builder;
+  builder.SetColumnSizes({4, 0});
+
+  EXPECT_THAT(builder.Build(), StatusIs(absl::StatusCode::kInvalidArgument,
+                                        HasSubstr("positive")));
+}
+
+TEST(ColumnarDenseDpfPirDatabaseBuilder, BuildFailsIfRecordIsTooLong) {
+  ColumnarDenseDpfPirDatabase::Builder builder;
+  builder.SetColumnSizes({2, 2}).Insert("12345");
+
+  EXPECT_THAT(builder.Build(), StatusIs(absl::StatusCode::kInvalidArgument,
+                                        HasSubstr("larger")));
+}
+
+TEST(ColumnarDenseDpfPirDatabaseBuilder, BuildFailsIfAlreadyBuilt) {
+  ColumnarDenseDpfPirDatabase::Builder builder;
+  builder.SetColumnSizes(kColumnSizes).Insert("Record");
+  DPF_ASSERT_OK(builder.Build());
+
+  EXPECT_THAT(builder.Build(),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST(ColumnarDenseDpfPirDatabaseBuilder, ClonedBuilderBuildsSameDatabase) {
+  ColumnarDenseDpfPirDatabase::Builder builder;
+  builder.SetColumnSizes(kColumnSizes).Insert("Record");
+  std::unique_ptr<ColumnarDenseDpfPirDatabase::Interface::Builder> clone =
+      builder.Clone();
+  DPF_ASSERT_OK_AND_ASSIGN(InterfacePtr database, builder.Build());
+  DPF_ASSERT_OK_AND_ASSIGN(InterfacePtr cloned_database, clone->Build());
+
+  EXPECT_EQ(database->size(), cloned_database->size());
+  std::vector<std::vector<BlockType>> selections = {
+      pir_testing::PackSelectionBits<BlockType>({true})};
+  EXPECT_EQ(database->InnerProductWith(selections).value(),
+            cloned_database->InnerProductWith(selections).value());
+}
+
+class ColumnarDenseDpfPirDatabaseTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    DPF_ASSERT_OK_AND_ASSIGN(values_,
+                             pir_testing::GenerateRandomStringsVariableSize(
+                                 kNumValues, kMaxValueBytes / 2,
+                                 kMaxValueBytes / 2));
+    ColumnarDenseDpfPirDatabase::Builder builder;
+    builder.SetColumnSizes(kColumnSizes);
+    for (const std::string& value : values_) {
+      builder.Insert(value);
+    }
+    DPF_ASSERT_OK_AND_ASSIGN(database_, builder.Build());
+  }
+
+  // Returns `length` bytes of `value` starting at `offset`, padded with null
+  // bytes.
+  static std::string Slice(const std::string& value, int64_t offset,
+                           int64_t length) {
+    std::string result =
+        offset < value.size() ? value.substr(offset, length) : "";
+    result.resize(length, '\0');
+    return result;
+  }
+
+  // Returns one random selection bit per record.
+  std::vector<bool> RandomSelections() {
+    std::vector<bool> selections(kNumValues);
+    for (int i = 0; i < kNumValues; ++i) {
+      selections[i] = absl::Uniform(bitgen_, 0u, 2u);
+    }
+    return selections;
+  }
+
+  // Returns the expected inner product of `selections` with the given bytes of
+  // each record.
+  std::string ExpectedInnerProduct(const std::vector<bool>& selections,
+                                   int64_t offset, int64_t length) {
+    std::vector<std::string> slices;
+    slices.reserve(values_.size());
+    for (const std::string& value : values_) {
+      slices.push_back(Slice(value, offset, length));
+    }
+    return pir_testing::InnerProductWithUnpacked(selections, slices).value();
+  }
+
+  absl::BitGen bitgen_;
+  std::vector<std::string> values_;
+  InterfacePtr database_;
+};
+
+TEST_F(ColumnarDenseDpfPirDatabaseTest, SizeIsNumberOfRecords) {
+  EXPECT_EQ(database_->size(), kNumValues);
+  EXPECT_EQ(database_->num_selection_bits(), kNumValues);
+}
+
+TEST_F(ColumnarDenseDpfPirDatabaseTest, InnerProductReturnsWholeRecords) {
+  std::vector<bool> selections = RandomSelections();
+  std::vector<std::vector<BlockType>> packed_selections = {
+      pir_testing::PackSelectionBits<BlockType>(selections)};
+
+  EXPECT_THAT(database_->InnerProductWith(packed_selections),
+              IsOkAndHolds(ElementsAre(
+                  ExpectedInnerProduct(selections, 0, kMaxValueBytes))));
+}
+
+TEST_F(ColumnarDenseDpfPirDatabaseTest,
+       InnerProductWithColumnsReturnsProjectedColumns) {
+  std::vector<bool> selections1 = RandomSelections();
+  std::vector<bool> selections2 = RandomSelections();
+  std::vector<std::vector<BlockType>> packed_selections = {
+      pir_testing::PackSelectionBits<BlockType>(selections1),
+      pir_testing::PackSelectionBits<BlockType>(selections2)};
+  const std::vector<int> columns = {2, 0};
+
+  // Responses are ordered by selection vector first, then by column.
+  EXPECT_THAT(
+      database_->InnerProductWithColumns(packed_selections, columns),
+      IsOkAndHolds(ElementsAre(ExpectedInnerProduct(selections1, 24, 16),
+                               ExpectedInnerProduct(selections1, 0, 4),
+                               ExpectedInnerProduct(selections2, 24, 16),
+                               ExpectedInnerProduct(selections2, 0, 4))));
+}
+
+TEST_F(ColumnarDenseDpfPirDatabaseTest,
+       InnerProductWithColumnsFailsIfColumnIsOutOfBounds) {
+  std::vector<std::vector<BlockType>> packed_selections = {
+      pir_testing::PackSelectionBits<BlockType>(RandomSelections())};
+  const std::vector<int> columns = {0, 3};
+
+  EXPECT_THAT(database_->InnerProductWithColumns(packed_selections, columns),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("out of bounds")));
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
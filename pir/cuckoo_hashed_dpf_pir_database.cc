@@ -32,8 +32,10 @@
 #include "dpf/status_macros.h"
 #include "pir/dense_dpf_pir_database.h"
 #include "pir/hashing/cuckoo_hash_table.h"
+#include "pir/hashing/fingerprint_function.h"
 #include "pir/hashing/hash_family.h"
 #include "pir/hashing/hash_family_config.h"
+#include "pir/record_compression.h"
 
 namespace distributed_point_functions {
 
@@ -124,9 +126,23 @@ CuckooHashedDpfPirDatabase::Builder::Build() {
   if (params_.num_hash_functions() <= 0) {
     return absl::InvalidArgumentError("`num_hash_functions` must be positive");
   }
+  if (params_.fingerprint_bytes() < 0) {
+    return absl::InvalidArgumentError(
+        "`fingerprint_bytes` must not be negative");
+  }
   DPF_ASSIGN_OR_RETURN(
       HashFamily hash_family,
       CreateHashFamilyFromConfig(params_.hash_family_config()));
+  absl::optional<FingerprintFunction> fingerprint;
+  if (params_.fingerprint_bytes() > 0) {
+    DPF_ASSIGN_OR_RETURN(
+        HashFamily fingerprint_hash_family,
+        CreateHashFamilyFromConfig(params_.hash_family_config()));
+    DPF_ASSIGN_OR_RETURN(
+        fingerprint,
+        FingerprintFunction::Create(std::move(fingerprint_hash_family),
+                                    params_.fingerprint_bytes()));
+  }
 
   // Create dense database builders if not set already.
   if (key_database_builder_ == nullptr) {
@@ -136,6 +152,12 @@ CuckooHashedDpfPirDatabase::Builder::Build() {
     value_database_builder_ = std::make_unique<DenseDpfPirDatabase::Builder>();
   }
 
+  std::unique_ptr<RecordCompressor> compressor;
+  if (params_.has_record_compression()) {
+    DPF_ASSIGN_OR_RETURN(
+        compressor, RecordCompressor::Create(params_.record_compression()));
+  }
+
   // Cuckoo hash all the keys.
   int64_t num_records = records_.size();
   DPF_ASSIGN_OR_RETURN(
@@ -149,18 +171,28 @@ CuckooHashedDpfPirDatabase::Builder::Build() {
     DPF_RETURN_IF_ERROR(cuckoo_hasher->Insert(key));
   }
 
-  // For each key in the cuckoo hash table, insert it into key_database_ and
-  // the corresponding value into value_database_.
+  // For each key in the cuckoo hash table, insert it (or its fingerprint) into
+  // key_database_ and the corresponding value into value_database_. With
+  // fingerprints, empty buckets hold zero bytes, so that all entries of the key
+  // database have the same size.
   absl::Span<const absl::optional<std::string>> cuckoo_table =
       cuckoo_hasher->GetTable();
-  for (int i = 0; i < cuckoo_table.size(); ++i) {
+  for (int64_t i = 0; i < cuckoo_table.size(); ++i) {
     if (cuckoo_table[i].has_value()) {
       const std::string& key = cuckoo_table[i].value();
-      key_database_builder_->Insert(key);
-      value_database_builder_->Insert(
-          std::move(records_.extract(key).mapped()));
+      if (fingerprint.has_value()) {
+        key_database_builder_->Insert((*fingerprint)(key));
+      } else {
+        key_database_builder_->Insert(key);
+      }
+      std::string value = std::move(records_.extract(key).mapped());
+      if (compressor != nullptr) {
+        DPF_ASSIGN_OR_RETURN(value, compressor->Compress(value));
+      }
+      value_database_builder_->Insert(std::move(value));
     } else {  // Insert dummy strings.
-      key_database_builder_->Insert("");
+      key_database_builder_->Insert(
+          std::string(params_.fingerprint_bytes(), '\0'));
       value_database_builder_->Insert("");
     }
   }
@@ -201,6 +233,18 @@ CuckooHashedDpfPirDatabase::InnerProductWith(
   return result;
 }
 
+absl::Status CuckooHashedDpfPirDatabase::InnerProductWithInto(
+    absl::Span<const BlockType> selections,
+    InnerProductOutputs outputs) const {
+  if (response_part_sizes_.empty()) {
+    return absl::UnimplementedError(
+        "InnerProductWithInto is not supported by the underlying databases");
+  }
+  DPF_RETURN_IF_ERROR(key_database_->InnerProductWithInto(selections, outputs));
+  return value_database_->InnerProductWithInto(
+      selections, outputs.WithOffset(value_response_offset_));
+}
+
 CuckooHashedDpfPirDatabase::CuckooHashedDpfPirDatabase(
     std::unique_ptr<DenseDatabase> key_database,
     std::unique_ptr<DenseDatabase> value_database, size_t size,
@@ -208,6 +252,22 @@ CuckooHashedDpfPirDatabase::CuckooHashedDpfPirDatabase(
     : key_database_(std::move(key_database)),
       value_database_(std::move(value_database)),
       size_(size),
-      num_selection_bits_(num_selection_bits) {}
+      num_selection_bits_(num_selection_bits),
+      value_response_offset_(0) {
+  absl::Span<const int64_t> key_part_sizes =
+      key_database_->response_part_sizes();
+  absl::Span<const int64_t> value_part_sizes =
+      value_database_->response_part_sizes();
+  if (key_part_sizes.empty() || value_part_sizes.empty()) {
+    return;
+  }
+  for (int64_t part_size : key_part_sizes) {
+    value_response_offset_ += AlignInnerProductOutputSize(part_size);
+  }
+  response_part_sizes_.assign(key_part_sizes.begin(), key_part_sizes.end());
+  response_part_sizes_.insert(response_part_sizes_.end(),
+                              value_part_sizes.begin(),
+                              value_part_sizes.end());
+}
 
 }  // namespace distributed_point_functions
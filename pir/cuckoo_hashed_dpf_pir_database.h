@@ -18,6 +18,7 @@
 #define DISTRIBUTED_POINT_FUNCTIONS_PIR_SPARSE_DPF_PIR_DATABASE_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -25,6 +26,7 @@
 
 #include "absl/container/btree_map.h"
 #include "absl/numeric/int128.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/types/span.h"
 #include "dpf/xor_wrapper.h"
@@ -39,6 +41,9 @@ namespace distributed_point_functions {
 // are used to to store keys and values separately. When computing the inner
 // product with a selection vector, this class computes the two inner products
 // with the key and value databases, and combines the results into a std;:pair.
+// If `CuckooHashingParams.fingerprint_bytes` is positive, the key database
+// holds fixed-size keyed fingerprints of the keys instead of the keys
+// themselves, which makes it cheaper to scan for long keys.
 class CuckooHashedDpfPirDatabase
     : public PirDatabaseInterface<XorWrapper<absl::uint128>,
                                   std::pair<std::string, std::string>> {
@@ -96,6 +101,17 @@ class CuckooHashedDpfPirDatabase
   absl::StatusOr<std::vector<RecordType>> InnerProductWith(
       absl::Span<const std::vector<BlockType>> selections) const override;
 
+  // Each response consists of the parts of the key database's response,
+  // followed by the parts of the value database's response. Empty if either
+  // database does not support `InnerProductWithInto`.
+  absl::Span<const int64_t> response_part_sizes() const override {
+    return response_part_sizes_;
+  }
+
+  // As `InnerProductWith`, but without allocating. See PirDatabaseInterface.
+  absl::Status InnerProductWithInto(absl::Span<const BlockType> selections,
+                                    InnerProductOutputs outputs) const override;
+
  private:
   CuckooHashedDpfPirDatabase(std::unique_ptr<DenseDatabase> key_database,
                              std::unique_ptr<DenseDatabase> value_database,
@@ -107,6 +123,11 @@ class CuckooHashedDpfPirDatabase
   size_t size_;
   // Number of selection bits required for InnerProductWith.
   size_t num_selection_bits_;
+  // Part sizes of the responses computed by InnerProductWithInto.
+  std::vector<int64_t> response_part_sizes_;
+  // Offset of the value database's response within each output of
+  // InnerProductWithInto.
+  int64_t value_response_offset_;
 };
 
 }  // namespace distributed_point_functions
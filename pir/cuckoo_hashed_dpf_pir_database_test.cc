@@ -17,6 +17,7 @@
 #include <stddef.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -26,13 +27,18 @@
 #include "absl/numeric/int128.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "dpf/internal/status_matchers.h"
 #include "dpf/xor_wrapper.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "pir/dense_dpf_pir_database.h"
+#include "pir/hashing/fingerprint_function.h"
+#include "pir/hashing/hash_family.h"
+#include "pir/hashing/hash_family_config.h"
 #include "pir/hashing/hash_family_config.pb.h"
+#include "pir/pir_database_interface.h"
 #include "pir/private_information_retrieval.pb.h"
 #include "pir/testing/mock_pir_database.h"
 #include "pir/testing/pir_selection_bits.h"
@@ -53,6 +59,7 @@ using ::testing::ElementsAre;
 using ::testing::Eq;
 using ::testing::FieldsAre;
 using ::testing::HasSubstr;
+using ::testing::IsEmpty;
 using ::testing::NotNull;
 using ::testing::Pointee;
 using ::testing::Property;
@@ -66,6 +73,11 @@ using MockDenseDatabase =
     pir_testing::MockPirDatabase<XorWrapper<absl::uint128>, std::string>;
 using MockDenseBuilder = MockDenseDatabase::Builder;
 
+// Storage for aligned outputs of `InnerProductWithInto`.
+struct alignas(kInnerProductOutputAlignment) AlignedOutputBlock {
+  char bytes[kInnerProductOutputAlignment];
+};
+
 TEST(CuckooHashedDpfPirDatabaseBuilder, SetParamsFailsIfNumBucketsIsZero) {
   CuckooHashedDpfPirDatabase::Builder builder;
   CuckooHashingParams params;
@@ -93,13 +105,12 @@ class CuckooHashedDpfPirDatabaseBuilderTest : public ::testing::Test {
  protected:
   void SetUp() override {
     // Set up builder with cuckoo hashing params.
-    CuckooHashingParams params;
-    params.set_num_buckets(kNumBuckets);
-    params.set_num_hash_functions(kNumHashFunctions);
-    params.mutable_hash_family_config()->set_hash_family(
+    params_.set_num_buckets(kNumBuckets);
+    params_.set_num_hash_functions(kNumHashFunctions);
+    params_.mutable_hash_family_config()->set_hash_family(
         HashFamilyConfig::HASH_FAMILY_SHA256);
-    params.mutable_hash_family_config()->set_seed("A seed");
-    builder_.SetParams(params);
+    params_.mutable_hash_family_config()->set_seed("A seed");
+    builder_.SetParams(params_);
 
     // Set up dense mock builders for keys and values.
     mock_key_builder_ = std::make_unique<MockDenseBuilder>();
@@ -134,6 +145,7 @@ class CuckooHashedDpfPirDatabaseBuilderTest : public ::testing::Test {
   }
 
   std::vector<std::string> keys_, values_;
+  CuckooHashingParams params_;
   CuckooHashedDpfPirDatabase::Builder builder_;
   std::unique_ptr<MockDenseBuilder> mock_key_builder_, mock_value_builder_;
   std::unique_ptr<MockDenseDatabase> mock_key_database_, mock_value_database_;
@@ -203,6 +215,43 @@ TEST_F(CuckooHashedDpfPirDatabaseBuilderTest, UsesKeyBuilderCorrectly) {
   EXPECT_THAT(builder_.Build(), IsOkAndHolds(NotNull()));
 }
 
+TEST_F(CuckooHashedDpfPirDatabaseBuilderTest,
+       FailsToBuildIfFingerprintBytesIsNegative) {
+  params_.set_fingerprint_bytes(-1);
+  builder_.SetParams(params_);
+
+  EXPECT_THAT(
+      builder_.Build(),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("negative")));
+}
+
+TEST_F(CuckooHashedDpfPirDatabaseBuilderTest,
+       InsertsKeyFingerprintsIfFingerprintBytesIsSet) {
+  constexpr int kFingerprintBytes = 8;
+  const std::string key = "A key that is much longer than its fingerprint";
+  const std::string value = "Value 1";
+  params_.set_fingerprint_bytes(kFingerprintBytes);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      HashFamily hash_family,
+      CreateHashFamilyFromConfig(params_.hash_family_config()));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      FingerprintFunction fingerprint,
+      FingerprintFunction::Create(std::move(hash_family), kFingerprintBytes));
+
+  EXPECT_CALL(*mock_key_builder_, Insert(fingerprint(key))).Times(1);
+  EXPECT_CALL(*mock_key_builder_,
+              Insert(std::string(kFingerprintBytes, '\0')))
+      .Times(kNumBuckets - 1);
+  EXPECT_CALL(*mock_key_builder_, Build)
+      .WillOnce(Return(std::move(mock_key_database_)));
+
+  builder_.SetParams(params_)
+      .Insert({key, value})
+      .SetKeyDatabaseBuilder(std::move(mock_key_builder_));
+
+  EXPECT_THAT(builder_.Build(), IsOkAndHolds(NotNull()));
+}
+
 TEST_F(CuckooHashedDpfPirDatabaseBuilderTest, UsesValueBuilderCorrectly) {
   const std::string key = "Key 1";
   const std::string value = "Value 1";
@@ -313,6 +362,50 @@ TEST_F(CuckooHashedDpfPirDatabaseBuilderTest, CallsInnerProductWithCorrectly) {
                                                  StartsWith("dummy value")))));
 }
 
+TEST_F(CuckooHashedDpfPirDatabaseBuilderTest,
+       InnerProductWithIntoWritesKeysAndValuesAtAlignedOffsets) {
+  InsertElements();
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Database> database,
+                           builder_.Build());
+  auto selections =
+      pir_testing::GenerateRandomPackedSelectionBits<Database::BlockType>(
+          kNumBuckets);
+  DPF_ASSERT_OK_AND_ASSIGN(auto expected,
+                           database->InnerProductWith({selections}));
+  ASSERT_EQ(expected.size(), 1);
+  const std::string& key = expected[0].first;
+  const std::string& value = expected[0].second;
+  const int64_t key_size = key.size(), value_size = value.size();
+  ASSERT_THAT(database->response_part_sizes(),
+              ElementsAre(key_size, value_size));
+
+  const int64_t value_offset = AlignInnerProductOutputSize(key_size);
+  const int64_t stride = value_offset + AlignInnerProductOutputSize(value_size);
+  std::vector<AlignedOutputBlock> buffer(stride / kInnerProductOutputAlignment);
+  InnerProductOutputs outputs(buffer[0].bytes, 1, stride);
+  DPF_ASSERT_OK(database->InnerProductWithInto(selections, outputs));
+  EXPECT_EQ(absl::string_view(outputs[0], key.size()), key);
+  EXPECT_EQ(absl::string_view(outputs[0] + value_offset, value.size()), value);
+}
+
+TEST_F(CuckooHashedDpfPirDatabaseBuilderTest,
+       InnerProductWithIntoIsUnimplementedIfUnderlyingDatabasesAreNot) {
+  EXPECT_CALL(*mock_key_builder_, Build)
+      .WillOnce(Return(std::move(mock_key_database_)));
+  EXPECT_CALL(*mock_value_builder_, Build)
+      .WillOnce(Return(std::move(mock_value_database_)));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<Database> database,
+      builder_.SetKeyDatabaseBuilder(std::move(mock_key_builder_))
+          .SetValueDatabaseBuilder(std::move(mock_value_builder_))
+          .Build());
+
+  EXPECT_THAT(database->response_part_sizes(), IsEmpty());
+  EXPECT_THAT(database->InnerProductWithInto(
+                  {}, InnerProductOutputs(nullptr, 0, 0)),
+              StatusIs(absl::StatusCode::kUnimplemented));
+}
+
 TEST_F(CuckooHashedDpfPirDatabaseBuilderTest,
        InnerProductFromClonedBuilderIsTheSame) {
   InsertElements();
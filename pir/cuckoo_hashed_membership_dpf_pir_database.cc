@@ -0,0 +1,183 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/cuckoo_hashed_membership_dpf_pir_database.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "dpf/status_macros.h"
+#include "pir/dense_dpf_pir_database.h"
+#include "pir/hashing/cuckoo_hash_table.h"
+#include "pir/hashing/fingerprint_function.h"
+#include "pir/hashing/hash_family.h"
+#include "pir/hashing/hash_family_config.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+namespace {
+absl::Status CheckHasNotBeenBuilt(bool has_been_built) {
+  if (has_been_built) {
+    return absl::FailedPreconditionError("Database already built");
+  }
+  return absl::OkStatus();
+}
+}  // namespace
+
+CuckooHashedMembershipDpfPirDatabase::Builder::Builder()
+    : params_(), dense_database_builder_(nullptr), has_been_built_(false) {}
+
+std::unique_ptr<CuckooHashedMembershipDpfPirDatabase::Interface::Builder>
+CuckooHashedMembershipDpfPirDatabase::Builder::Clone() const {
+  auto result = std::make_unique<Builder>();
+  result->params_ = params_;
+  if (dense_database_builder_ != nullptr) {
+    result->dense_database_builder_ = dense_database_builder_->Clone();
+  }
+  result->keys_ = keys_;
+  result->has_been_built_ = has_been_built_;
+  return result;
+}
+
+CuckooHashedMembershipDpfPirDatabase::Builder&
+CuckooHashedMembershipDpfPirDatabase::Builder::Clear() {
+  if (dense_database_builder_ != nullptr) {
+    dense_database_builder_->Clear();
+  }
+  keys_.clear();
+  has_been_built_ = false;
+  return *this;
+}
+
+CuckooHashedMembershipDpfPirDatabase::Builder&
+CuckooHashedMembershipDpfPirDatabase::Builder::SetParams(
+    CuckooHashingParams params) {
+  params_ = std::move(params);
+  return *this;
+}
+
+CuckooHashedMembershipDpfPirDatabase::Builder&
+CuckooHashedMembershipDpfPirDatabase::Builder::SetDenseDatabaseBuilder(
+    std::unique_ptr<DenseDatabase::Builder> builder) {
+  if (builder != nullptr) {
+    builder->Clear();
+  }
+  dense_database_builder_ = std::move(builder);
+  return *this;
+}
+
+CuckooHashedMembershipDpfPirDatabase::Builder&
+CuckooHashedMembershipDpfPirDatabase::Builder::Insert(std::string key) {
+  keys_.push_back(std::move(key));
+  return *this;
+}
+
+absl::StatusOr<std::unique_ptr<CuckooHashedMembershipDpfPirDatabase::Interface>>
+CuckooHashedMembershipDpfPirDatabase::Builder::Build() {
+  DPF_RETURN_IF_ERROR(CheckHasNotBeenBuilt(has_been_built_));
+  has_been_built_ = true;
+
+  if (params_.num_buckets() <= 0) {
+    return absl::InvalidArgumentError("`num_buckets` must be positive");
+  }
+  if (params_.num_hash_functions() <= 0) {
+    return absl::InvalidArgumentError("`num_hash_functions` must be positive");
+  }
+  if (params_.fingerprint_bytes() <= 0) {
+    return absl::InvalidArgumentError("`fingerprint_bytes` must be positive");
+  }
+  DPF_ASSIGN_OR_RETURN(
+      HashFamily hash_family,
+      CreateHashFamilyFromConfig(params_.hash_family_config()));
+  DPF_ASSIGN_OR_RETURN(
+      HashFamily fingerprint_hash_family,
+      CreateHashFamilyFromConfig(params_.hash_family_config()));
+  DPF_ASSIGN_OR_RETURN(
+      FingerprintFunction fingerprint,
+      FingerprintFunction::Create(std::move(fingerprint_hash_family),
+                                  params_.fingerprint_bytes()));
+
+  // Create dense database builder if not set already.
+  if (dense_database_builder_ == nullptr) {
+    dense_database_builder_ = std::make_unique<DenseDpfPirDatabase::Builder>();
+  }
+
+  // Cuckoo hash all the keys.
+  int64_t num_keys = keys_.size();
+  DPF_ASSIGN_OR_RETURN(
+      auto cuckoo_hasher,
+      CuckooHashTable::Create(std::move(hash_family), params_.num_buckets(),
+                              params_.num_hash_functions(), num_keys));
+  for (const std::string& key : keys_) {
+    if (key.empty()) {
+      return absl::InvalidArgumentError("Key cannot be empty");
+    }
+    DPF_RETURN_IF_ERROR(cuckoo_hasher->Insert(key));
+  }
+  keys_.clear();
+
+  // Insert the fingerprint of each bucket's key into the dense database. Empty
+  // buckets hold zero bytes, so that all entries have the same size.
+  absl::Span<const absl::optional<std::string>> cuckoo_table =
+      cuckoo_hasher->GetTable();
+  for (const absl::optional<std::string>& key : cuckoo_table) {
+    if (key.has_value()) {
+      dense_database_builder_->Insert(fingerprint(*key));
+    } else {
+      dense_database_builder_->Insert(
+          std::string(params_.fingerprint_bytes(), '\0'));
+    }
+  }
+
+  DPF_ASSIGN_OR_RETURN(std::unique_ptr<DenseDatabase> dense_database,
+                       dense_database_builder_->Build());
+  size_t num_selection_bits = dense_database->num_selection_bits();
+  if (num_selection_bits != params_.num_buckets()) {
+    return absl::InternalError(
+        "Number of selection bits in underlying database doesn't match");
+  }
+  return absl::WrapUnique(new CuckooHashedMembershipDpfPirDatabase(
+      std::move(dense_database), num_keys, num_selection_bits));
+}
+
+CuckooHashedMembershipDpfPirDatabase::CuckooHashedMembershipDpfPirDatabase(
+    std::unique_ptr<DenseDatabase> dense_database, size_t size,
+    size_t num_selection_bits)
+    : dense_database_(std::move(dense_database)),
+      size_(size),
+      num_selection_bits_(num_selection_bits) {}
+
+absl::StatusOr<std::vector<CuckooHashedMembershipDpfPirDatabase::ResponseType>>
+CuckooHashedMembershipDpfPirDatabase::InnerProductWith(
+    absl::Span<const std::vector<BlockType>> selections) const {
+  return dense_database_->InnerProductWith(selections);
+}
+
+absl::Status CuckooHashedMembershipDpfPirDatabase::InnerProductWithInto(
+    absl::Span<const BlockType> selections,
+    InnerProductOutputs outputs) const {
+  return dense_database_->InnerProductWithInto(selections, outputs);
+}
+
+}  // namespace distributed_point_functions
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_CUCKOO_HASHED_MEMBERSHIP_DPF_PIR_DATABASE_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_CUCKOO_HASHED_MEMBERSHIP_DPF_PIR_DATABASE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "dpf/xor_wrapper.h"
+#include "pir/pir_database_interface.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+// Database for private set-membership queries. Keys are cuckoo hashed into
+// `params.num_buckets` buckets, and each bucket stores a fixed-size keyed
+// fingerprint of its key (or zero bytes if it is empty) in a dense database.
+// The inner product with a selection vector is therefore the XOR of the
+// selected fingerprints, which lets the client check whether its key is
+// present without retrieving any keys or values.
+class CuckooHashedMembershipDpfPirDatabase
+    : public PirDatabaseInterface<XorWrapper<absl::uint128>, std::string> {
+ public:
+  using Interface = PirDatabaseInterface;
+  // Type of the underlying database implementation that stores the
+  // fingerprints.
+  using DenseDatabase =
+      PirDatabaseInterface<XorWrapper<absl::uint128>, std::string>;
+
+  // The concrete Builder for CuckooHashedMembershipDpfPirDatabase.
+  class Builder : public PirDatabaseInterface::Builder {
+   public:
+    Builder();
+    // Inserts the given key into the database once Build() is called.
+    Builder& Insert(std::string key) override;
+    // Clears all keys inserted into this builder, but leaves any other
+    // configuration intact.
+    Builder& Clear() override;
+    // Sets the hashing parameters used for this database. Must be called before
+    // calling `Build`.
+    Builder& SetParams(CuckooHashingParams params);
+    // Uses `builder` to build the dense database that stores the fingerprint of
+    // each bucket. Defaults to a newly constructed
+    // DenseDpfPirDatabase::Builder.
+    Builder& SetDenseDatabaseBuilder(
+        std::unique_ptr<DenseDatabase::Builder> builder);
+    // Returns a copy of this builder.
+    std::unique_ptr<PirDatabaseInterface::Builder> Clone() const override;
+    // Builds the database and invalidated the builder. All subsequent calls to
+    // Build() will fail with FAILED_PRECONDITION.
+    absl::StatusOr<std::unique_ptr<PirDatabaseInterface>> Build() override;
+
+   private:
+    CuckooHashingParams params_;
+    std::unique_ptr<DenseDatabase::Builder> dense_database_builder_;
+    std::vector<std::string> keys_;
+    bool has_been_built_;
+  };
+
+  // Returns the number of keys contained in the database.
+  size_t size() const override { return size_; }
+
+  // The number of selection bits is the number of cuckoo hashing buckets.
+  size_t num_selection_bits() const override { return num_selection_bits_; }
+
+  // Returns the XOR of the fingerprints selected by each of `selections`.
+  absl::StatusOr<std::vector<ResponseType>> InnerProductWith(
+      absl::Span<const std::vector<BlockType>> selections) const override;
+
+  // Responses are laid out as in the underlying dense database.
+  absl::Span<const int64_t> response_part_sizes() const override {
+    return dense_database_->response_part_sizes();
+  }
+
+  // As `InnerProductWith`, but without allocating. See PirDatabaseInterface.
+  absl::Status InnerProductWithInto(absl::Span<const BlockType> selections,
+                                    InnerProductOutputs outputs) const override;
+
+ private:
+  CuckooHashedMembershipDpfPirDatabase(
+      std::unique_ptr<DenseDatabase> dense_database, size_t size,
+      size_t num_selection_bits);
+
+  std::unique_ptr<DenseDatabase> dense_database_;
+  // Number of keys in the database.
+  size_t size_;
+  // Number of selection bits required for InnerProductWith.
+  size_t num_selection_bits_;
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_CUCKOO_HASHED_MEMBERSHIP_DPF_PIR_DATABASE_H_
@@ -0,0 +1,194 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/cuckoo_hashed_membership_dpf_pir_database.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "dpf/internal/status_matchers.h"
+#include "dpf/xor_wrapper.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "pir/hashing/fingerprint_function.h"
+#include "pir/hashing/hash_family.h"
+#include "pir/hashing/hash_family_config.h"
+#include "pir/hashing/hash_family_config.pb.h"
+#include "pir/private_information_retrieval.pb.h"
+#include "pir/testing/mock_pir_database.h"
+#include "pir/testing/pir_selection_bits.h"
+
+namespace distributed_point_functions {
+namespace {
+
+constexpr int kNumDatabaseElements = 1234;
+constexpr int kNumBuckets = static_cast<int>(1.5 * kNumDatabaseElements);
+constexpr int kNumHashFunctions = 3;
+constexpr int kFingerprintBytes = 8;
+
+using dpf_internal::StatusIs;
+using ::testing::Contains;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::Not;
+using ::testing::SizeIs;
+using BlockType = CuckooHashedMembershipDpfPirDatabase::BlockType;
+
+CuckooHashingParams GetDefaultParams() {
+  CuckooHashingParams params;
+  params.set_num_buckets(kNumBuckets);
+  params.set_num_hash_functions(kNumHashFunctions);
+  params.set_fingerprint_bytes(kFingerprintBytes);
+  params.mutable_hash_family_config()->set_hash_family(
+      HashFamilyConfig::HASH_FAMILY_SHA256);
+  params.mutable_hash_family_config()->set_seed("A seed");
+  return params;
+}
+
+TEST(CuckooHashedMembershipDpfPirDatabaseBuilder,
+     BuildFailsIfNumBucketsIsZero) {
+  CuckooHashedMembershipDpfPirDatabase::Builder builder;
+  CuckooHashingParams params = GetDefaultParams();
+  params.set_num_buckets(0);
+
+  EXPECT_THAT(
+      builder.SetParams(params).Build(),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("num_buckets")));
+}
+
+TEST(CuckooHashedMembershipDpfPirDatabaseBuilder,
+     BuildFailsIfNumHashFunctionsIsZero) {
+  CuckooHashedMembershipDpfPirDatabase::Builder builder;
+  CuckooHashingParams params = GetDefaultParams();
+  params.set_num_hash_functions(0);
+
+  EXPECT_THAT(builder.SetParams(params).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("num_hash_functions")));
+}
+
+TEST(CuckooHashedMembershipDpfPirDatabaseBuilder,
+     BuildFailsIfFingerprintBytesIsZero) {
+  CuckooHashedMembershipDpfPirDatabase::Builder builder;
+  CuckooHashingParams params = GetDefaultParams();
+  params.set_fingerprint_bytes(0);
+
+  EXPECT_THAT(builder.SetParams(params).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("fingerprint_bytes")));
+}
+
+TEST(CuckooHashedMembershipDpfPirDatabaseBuilder, BuildFailsIfKeyIsEmpty) {
+  CuckooHashedMembershipDpfPirDatabase::Builder builder;
+  builder.SetParams(GetDefaultParams()).Insert("");
+
+  EXPECT_THAT(builder.Build(), StatusIs(absl::StatusCode::kInvalidArgument,
+                                        HasSubstr("empty")));
+}
+
+TEST(CuckooHashedMembershipDpfPirDatabaseBuilder, BuildFailsIfCalledTwice) {
+  CuckooHashedMembershipDpfPirDatabase::Builder builder;
+  builder.SetParams(GetDefaultParams()).Insert("Key");
+  DPF_ASSERT_OK(builder.Build());
+
+  EXPECT_THAT(builder.Build(),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+class CuckooHashedMembershipDpfPirDatabaseTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    params_ = GetDefaultParams();
+    DPF_ASSERT_OK_AND_ASSIGN(keys_, pir_testing::GenerateCountingStrings(
+                                        kNumDatabaseElements, "Key "));
+    CuckooHashedMembershipDpfPirDatabase::Builder builder;
+    builder.SetParams(params_);
+    DPF_ASSERT_OK_AND_ASSIGN(
+        database_,
+        pir_testing::CreateFakeDatabase<CuckooHashedMembershipDpfPirDatabase>(
+            keys_, &builder));
+
+    DPF_ASSERT_OK_AND_ASSIGN(
+        HashFamily hash_family,
+        CreateHashFamilyFromConfig(params_.hash_family_config()));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        hash_functions_,
+        CreateHashFunctions(std::move(hash_family),
+                            params_.num_hash_functions()));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        HashFamily fingerprint_family,
+        CreateHashFamilyFromConfig(params_.hash_family_config()));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        FingerprintFunction fingerprint,
+        FingerprintFunction::Create(std::move(fingerprint_family),
+                                    params_.fingerprint_bytes()));
+    fingerprint_ =
+        std::make_unique<FingerprintFunction>(std::move(fingerprint));
+  }
+
+  // Returns the database entries at the candidate buckets of `key`.
+  std::vector<std::string> CandidateBuckets(const std::string& key) {
+    std::vector<std::string> result;
+    for (const HashFunction& hash_function : hash_functions_) {
+      std::vector<bool> selections(kNumBuckets, false);
+      selections[hash_function(key, kNumBuckets)] = true;
+      std::vector<std::vector<BlockType>> packed = {
+          pir_testing::PackSelectionBits<BlockType>(selections)};
+      result.push_back(database_->InnerProductWith(packed).value()[0]);
+    }
+    return result;
+  }
+
+  CuckooHashingParams params_;
+  std::vector<std::string> keys_;
+  std::unique_ptr<CuckooHashedMembershipDpfPirDatabase::Interface> database_;
+  std::vector<HashFunction> hash_functions_;
+  std::unique_ptr<FingerprintFunction> fingerprint_;
+};
+
+TEST_F(CuckooHashedMembershipDpfPirDatabaseTest, SizeIsNumberOfKeys) {
+  EXPECT_EQ(database_->size(), kNumDatabaseElements);
+  EXPECT_EQ(database_->num_selection_bits(), kNumBuckets);
+}
+
+TEST_F(CuckooHashedMembershipDpfPirDatabaseTest,
+       EveryKeyHasItsFingerprintInACandidateBucket) {
+  for (const std::string& key : keys_) {
+    EXPECT_THAT(CandidateBuckets(key), Contains((*fingerprint_)(key))) << key;
+  }
+}
+
+TEST_F(CuckooHashedMembershipDpfPirDatabaseTest,
+       AbsentKeyHasNoFingerprintInACandidateBucket) {
+  const std::string key = "Absent key";
+  EXPECT_THAT(CandidateBuckets(key), Not(Contains((*fingerprint_)(key))));
+}
+
+TEST_F(CuckooHashedMembershipDpfPirDatabaseTest,
+       ResponsesHaveFingerprintSize) {
+  std::vector<std::vector<BlockType>> selections = {
+      pir_testing::GenerateRandomPackedSelectionBits<BlockType>(kNumBuckets)};
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<std::string> responses,
+                           database_->InnerProductWith(selections));
+
+  EXPECT_THAT(responses, ElementsAre(SizeIs(kFingerprintBytes)));
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
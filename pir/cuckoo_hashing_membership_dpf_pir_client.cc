@@ -0,0 +1,150 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/cuckoo_hashing_membership_dpf_pir_client.h"
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "dpf/status_macros.h"
+#include "pir/dense_dpf_pir_client.h"
+#include "pir/dpf_pir_client.h"
+#include "pir/hashing/fingerprint_function.h"
+#include "pir/hashing/hash_family.h"
+#include "pir/internal/cuckoo_hashing.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+CuckooHashingMembershipDpfPirClient::CuckooHashingMembershipDpfPirClient(
+    EncryptHelperRequestFn encrypter, std::string encryption_context_info,
+    std::unique_ptr<DenseDpfPirClient> wrapped_client,
+    std::vector<HashFunction> hash_functions, FingerprintFunction fingerprint,
+    int64_t num_buckets, int seed_fingerprint)
+    : DpfPirClient(std::move(encrypter), std::move(encryption_context_info)),
+      wrapped_client_(std::move(wrapped_client)),
+      hash_functions_(std::move(hash_functions)),
+      fingerprint_(std::move(fingerprint)),
+      num_buckets_(num_buckets),
+      seed_fingerprint_(seed_fingerprint) {}
+
+absl::StatusOr<std::unique_ptr<CuckooHashingMembershipDpfPirClient>>
+CuckooHashingMembershipDpfPirClient::Create(
+    const PirServerPublicParams& params, EncryptHelperRequestFn encrypter,
+    absl::string_view encryption_context_info) {
+  if (encrypter == nullptr) {
+    return absl::InvalidArgumentError("`enrypter` may not be null");
+  }
+  if (params.wrapped_pir_server_public_params_case() !=
+      PirServerPublicParams::kCuckooHashingMembershipDpfPirServerParams) {
+    return absl::InvalidArgumentError(
+        "`params` does not contain valid "
+        "CuckooHashingMembershipDpfPirServerParams");
+  }
+  const CuckooHashingParams& cuckoo_params =
+      params.cuckoo_hashing_membership_dpf_pir_server_params();
+  DPF_RETURN_IF_ERROR(pir_internal::ValidateCuckooHashingParams(cuckoo_params));
+
+  DPF_ASSIGN_OR_RETURN(std::vector<HashFunction> hash_functions,
+                       pir_internal::CreateBucketHashFunctions(cuckoo_params));
+  DPF_ASSIGN_OR_RETURN(
+      FingerprintFunction fingerprint,
+      pir_internal::CreateKeyFingerprintFunction(cuckoo_params));
+  DPF_ASSIGN_OR_RETURN(
+      std::unique_ptr<DenseDpfPirClient> wrapped_client,
+      pir_internal::CreateBucketClient(cuckoo_params.num_buckets()));
+
+  return absl::WrapUnique(new CuckooHashingMembershipDpfPirClient(
+      std::move(encrypter), std::string(encryption_context_info),
+      std::move(wrapped_client), std::move(hash_functions),
+      std::move(fingerprint), cuckoo_params.num_buckets(),
+      pir_internal::ComputeSeedFingerprint(cuckoo_params)));
+}
+
+absl::StatusOr<std::tuple<DpfPirRequest::PlainRequest,
+                          DpfPirRequest::HelperRequest, PirRequestClientState>>
+CuckooHashingMembershipDpfPirClient::CreatePlainRequests(
+    absl::Span<const std::string> query) const {
+  DpfPirRequest::PlainRequest leader_request;
+  DpfPirRequest::HelperRequest helper_request;
+  std::string otp_seed;
+  DPF_ASSIGN_OR_RETURN(
+      std::tie(leader_request, helper_request, otp_seed),
+      pir_internal::CreateBucketRequests(*wrapped_client_, hash_functions_,
+                                         num_buckets_, seed_fingerprint_,
+                                         query));
+  PirRequestClientState request_client_state;
+  CuckooHashingMembershipDpfPirRequestClientState* membership_state =
+      request_client_state
+          .mutable_cuckoo_hashing_membership_dpf_pir_request_client_state();
+  membership_state->set_one_time_pad_seed(std::move(otp_seed));
+  for (const std::string& query_string : query) {
+    membership_state->add_query_strings(query_string);
+  }
+  return std::make_tuple(std::move(leader_request), std::move(helper_request),
+                         std::move(request_client_state));
+}
+
+absl::StatusOr<std::vector<bool>>
+CuckooHashingMembershipDpfPirClient::HandleResponse(
+    const PirResponse& pir_response,
+    const PirRequestClientState& request_client_state) const {
+  if (pir_response.wrapped_pir_response_case() !=
+      PirResponse::kDpfPirResponse) {
+    return absl::InvalidArgumentError(
+        "`pir_response` does not contain a valid DpfPirResponse");
+  }
+  if (request_client_state.wrapped_pir_request_client_state_case() !=
+      PirRequestClientState::kCuckooHashingMembershipDpfPirRequestClientState) {
+    return absl::InvalidArgumentError(
+        "`request_client_state` does not contain a valid "
+        "CuckooHashingMembershipDpfPirRequestClientState");
+  }
+  const CuckooHashingMembershipDpfPirRequestClientState& membership_state =
+      request_client_state
+          .cuckoo_hashing_membership_dpf_pir_request_client_state();
+  if (membership_state.query_strings_size() * hash_functions_.size() !=
+      pir_response.dpf_pir_response().masked_response_size()) {
+    // We should get one fingerprint for each candidate bucket of each query.
+    return absl::InvalidArgumentError(
+        "Number of responses must be equal to the number of queries times the "
+        "number of hash functions");
+  }
+
+  DPF_ASSIGN_OR_RETURN(std::vector<std::string> fingerprints,
+                       pir_internal::HandleBucketResponse(
+                           *wrapped_client_, pir_response,
+                           membership_state.one_time_pad_seed()));
+  std::vector<bool> result(membership_state.query_strings_size(), false);
+  for (int i = 0; i < result.size(); ++i) {
+    const std::string expected =
+        fingerprint_(membership_state.query_strings(i));
+    for (int j = 0; j < hash_functions_.size(); ++j) {
+      if (fingerprints[hash_functions_.size() * i + j] == expected) {
+        result[i] = true;
+      }
+    }
+  }
+  return result;
+}
+
+}  // namespace distributed_point_functions
@@ -0,0 +1,152 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/cuckoo_hashing_membership_dpf_pir_server.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "dpf/status_macros.h"
+#include "dpf/xor_wrapper.h"
+#include "pir/internal/cuckoo_hashing.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+CuckooHashingMembershipDpfPirServer::CuckooHashingMembershipDpfPirServer(
+    PirServerPublicParams params, std::unique_ptr<DistributedPointFunction> dpf,
+    std::unique_ptr<Database> database, int seed_fingerprint)
+    : params_(std::move(params)),
+      dpf_(std::move(dpf)),
+      database_(std::move(database)),
+      seed_fingerprint_(seed_fingerprint) {}
+
+absl::StatusOr<CuckooHashingParams>
+CuckooHashingMembershipDpfPirServer::GenerateParams(const PirConfig& config) {
+  if (config.wrapped_pir_config_case() !=
+      PirConfig::kCuckooHashingMembershipDpfPirConfig) {
+    return absl::InvalidArgumentError(
+        "`config` must be a valid CuckooHashingMembershipDpfPirConfig");
+  }
+  const CuckooHashingMembershipDpfPirConfig& membership_config =
+      config.cuckoo_hashing_membership_dpf_pir_config();
+  DPF_ASSIGN_OR_RETURN(CuckooHashingParams params,
+                       pir_internal::GenerateCuckooHashingParams(
+                           membership_config.num_elements(),
+                           membership_config.hash_family()));
+  if (membership_config.fingerprint_bytes() < 0) {
+    return absl::InvalidArgumentError(
+        "`fingerprint_bytes` must not be negative");
+  }
+  params.set_fingerprint_bytes(membership_config.fingerprint_bytes() > 0
+                                   ? membership_config.fingerprint_bytes()
+                                   : kDefaultFingerprintBytes);
+  return params;
+}
+
+absl::StatusOr<std::unique_ptr<CuckooHashingMembershipDpfPirServer>>
+CuckooHashingMembershipDpfPirServer::CreateLeader(
+    CuckooHashingParams params, std::unique_ptr<Database> database,
+    ForwardHelperRequestFn sender) {
+  DPF_ASSIGN_OR_RETURN(auto leader, CreatePlain(params, std::move(database)));
+  DPF_RETURN_IF_ERROR(leader->MakeLeader(std::move(sender)));
+  return leader;
+}
+
+absl::StatusOr<std::unique_ptr<CuckooHashingMembershipDpfPirServer>>
+CuckooHashingMembershipDpfPirServer::CreateHelper(
+    CuckooHashingParams params, std::unique_ptr<Database> database,
+    DecryptHelperRequestFn decrypter) {
+  DPF_ASSIGN_OR_RETURN(auto helper, CreatePlain(params, std::move(database)));
+  DPF_RETURN_IF_ERROR(
+      helper->MakeHelper(std::move(decrypter), kEncryptionContextInfo));
+  return helper;
+}
+
+absl::StatusOr<std::unique_ptr<CuckooHashingMembershipDpfPirServer>>
+CuckooHashingMembershipDpfPirServer::CreatePlain(
+    CuckooHashingParams params, std::unique_ptr<Database> database) {
+  DPF_RETURN_IF_ERROR(pir_internal::ValidateCuckooHashingParams(params));
+  if (params.fingerprint_bytes() <= 0) {
+    return absl::InvalidArgumentError("`fingerprint_bytes` must be positive");
+  }
+  if (database == nullptr) {
+    return absl::InvalidArgumentError("`database` cannot be null");
+  }
+  if (database->num_selection_bits() != params.num_buckets()) {
+    return absl::InvalidArgumentError(
+        "Number of selection bits in the database does not match "
+        "`params.num_buckets`");
+  }
+
+  DPF_ASSIGN_OR_RETURN(
+      auto dpf, pir_internal::CreateBucketSelectionDpf(params.num_buckets()));
+  int seed_fingerprint = pir_internal::ComputeSeedFingerprint(params);
+
+  PirServerPublicParams server_params;
+  *(server_params.mutable_cuckoo_hashing_membership_dpf_pir_server_params()) =
+      std::move(params);
+
+  return absl::WrapUnique(new CuckooHashingMembershipDpfPirServer(
+      std::move(server_params), std::move(dpf), std::move(database),
+      seed_fingerprint));
+}
+
+// Computes the response to the client's `request`.
+absl::StatusOr<PirResponse>
+CuckooHashingMembershipDpfPirServer::HandlePlainRequest(
+    const PirRequest& request) const {
+  DPF_ASSIGN_OR_RETURN(
+      const DpfPirRequest::PlainRequest* plain_request,
+      pir_internal::GetCuckooHashingPlainRequest(request, seed_fingerprint_));
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<XorWrapper<absl::uint128>> selections,
+      pir_internal::EvaluateBucketSelections(
+          *dpf_,
+          params_.cuckoo_hashing_membership_dpf_pir_server_params()
+              .num_buckets(),
+          *plain_request));
+
+  // Each response is the XOR of the fingerprints selected by one key.
+  PirResponse response;
+  absl::Status status =
+      AppendInnerProducts(*database_, absl::MakeConstSpan(selections),
+                          plain_request->dpf_key_size(), response);
+  if (!absl::IsUnimplemented(status)) {
+    DPF_RETURN_IF_ERROR(status);
+    return response;
+  }
+
+  // The database can only return newly allocated inner products.
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<std::string> inner_products,
+      database_->InnerProductWith(SplitSelections(
+          absl::MakeConstSpan(selections), plain_request->dpf_key_size())));
+  response.mutable_dpf_pir_response()->mutable_masked_response()->Reserve(
+      inner_products.size());
+  for (std::string& inner_product : inner_products) {
+    *(response.mutable_dpf_pir_response()->add_masked_response()) =
+        std::move(inner_product);
+  }
+  return response;
+}
+
+}  // namespace distributed_point_functions
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_CUCKOO_HASHING_MEMBERSHIP_DPF_PIR_SERVER_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_CUCKOO_HASHING_MEMBERSHIP_DPF_PIR_SERVER_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/xor_wrapper.h"
+#include "pir/dpf_pir_server.h"
+#include "pir/pir_database_interface.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+// Implements two-server private set-membership queries with DPFs. Like
+// CuckooHashingSparseDpfPirServer, keys are cuckoo hashed into a dense table,
+// but each bucket only stores a short keyed fingerprint of its key (see
+// CuckooHashedMembershipDpfPirDatabase). The client queries all candidate
+// buckets of a key and learns whether any of them holds the key's fingerprint,
+// so each query only scans and returns a few bytes per bucket instead of whole
+// keys and values.
+//
+class CuckooHashingMembershipDpfPirServer : public DpfPirServer {
+ public:
+  using Database = PirDatabaseInterface<XorWrapper<absl::uint128>, std::string>;
+
+  // Function type for the `sender` argument passed to CreateLeader. See
+  // DpfPirServer documentation for details.
+  using DpfPirServer::ForwardHelperRequestFn;
+
+  // Function type for the `decrypter` argument passed to CreateHelper. See
+  // DpfPirServer documentation for details.
+  using DpfPirServer::DecryptHelperRequestFn;
+
+  // Context Info passed to the decrypter when created as Helper. Should be the
+  // same as used on the client for encryption.
+  static inline constexpr absl::string_view kEncryptionContextInfo =
+      "CuckooHashingMembershipDpfPirServer";
+
+  // Fingerprint size used if the config does not specify one.
+  static constexpr int kDefaultFingerprintBytes = 8;
+
+  // Generates parameters to be used by the client and for constructing the
+  // database from a CuckooHashingMembershipDpfPirConfig.
+  static absl::StatusOr<CuckooHashingParams> GenerateParams(
+      const PirConfig& config);
+
+  // Creates a new CuckooHashingMembershipDpfPirServer instance with the given
+  // CuckooHashingParams and Database, acting as a Leader server. See
+  // CuckooHashingSparseDpfPirServer::CreateLeader for details.
+  //
+  // Returns INVALID_ARGUMENT if `sender` or `database` is NULL, or if `params`
+  // is invalid.
+  static absl::StatusOr<std::unique_ptr<CuckooHashingMembershipDpfPirServer>>
+  CreateLeader(CuckooHashingParams params, std::unique_ptr<Database> database,
+               ForwardHelperRequestFn sender);
+
+  // Creates a new CuckooHashingMembershipDpfPirServer instance with the given
+  // CuckooHashingParams and Database, acting as a Helper server. See
+  // CuckooHashingSparseDpfPirServer::CreateHelper for details.
+  //
+  // Returns INVALID_ARGUMENT if `decrypter` or `database` is NULL, or if
+  // `params` is invalid.
+  static absl::StatusOr<std::unique_ptr<CuckooHashingMembershipDpfPirServer>>
+  CreateHelper(CuckooHashingParams params, std::unique_ptr<Database> database,
+               DecryptHelperRequestFn decrypter);
+
+  // Creates a new CuckooHashingMembershipDpfPirServer instance with the given
+  // CuckooHashingParams and Database, acting as a plain server. For
+  // correctness, `params` must match the parameters used to construct
+  // `database`.
+  //
+  // Returns INVALID_ARGUMENT if `database` is NULL, or if `params` is invalid.
+  static absl::StatusOr<std::unique_ptr<CuckooHashingMembershipDpfPirServer>>
+  CreatePlain(CuckooHashingParams params, std::unique_ptr<Database> database);
+
+  // Returns this server's public parameters to be used at the Client.
+  const PirServerPublicParams& GetPublicParams() const override {
+    return params_;
+  }
+
+ protected:
+  // Computes the response to the client's `request`. Should not be called
+  // by users, but only from DpfPirServer::HandleRequest.
+  absl::StatusOr<PirResponse> HandlePlainRequest(
+      const PirRequest& request) const override;
+
+ private:
+  CuckooHashingMembershipDpfPirServer(
+      PirServerPublicParams params,
+      std::unique_ptr<DistributedPointFunction> dpf,
+      std::unique_ptr<Database> database, int seed_fingerprint);
+
+  PirServerPublicParams params_;
+  std::unique_ptr<DistributedPointFunction> dpf_;
+  std::unique_ptr<Database> database_;
+  int seed_fingerprint_;
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_CUCKOO_HASHING_MEMBERSHIP_DPF_PIR_SERVER_H_
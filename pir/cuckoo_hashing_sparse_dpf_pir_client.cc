@@ -14,14 +14,12 @@
 
 #include "pir/cuckoo_hashing_sparse_dpf_pir_client.h"
 
-#include <limits>
 #include <memory>
 #include <string>
 #include <tuple>
 #include <utility>
 #include <vector>
 
-#include "absl/functional/any_invocable.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -31,10 +29,11 @@
 #include "dpf/status_macros.h"
 #include "pir/dense_dpf_pir_client.h"
 #include "pir/dpf_pir_client.h"
+#include "pir/hashing/fingerprint_function.h"
 #include "pir/hashing/hash_family.h"
-#include "pir/hashing/hash_family_config.h"
-#include "pir/hashing/sha256_hash_family.h"
+#include "pir/internal/cuckoo_hashing.h"
 #include "pir/private_information_retrieval.pb.h"
+#include "pir/record_compression.h"
 
 namespace distributed_point_functions {
 
@@ -54,27 +53,21 @@ bool IsPrefixPaddedWithZeros(absl::string_view input,
   return true;
 }
 
-// Always returns an InternalError. Used in the constructor for the wrapped PIR
-// client, which should never be called directly.
-absl::StatusOr<std::string> DummyEncrypter(absl::string_view plaintext,
-                                           absl::string_view context_info) {
-  return absl::InternalError(
-      "This PIR client is wrapped by a CuckooHashingSparseDpfPirClient and "
-      "should never be called directly");
-}
-
 }  // namespace
 
 CuckooHashingSparseDpfPirClient::CuckooHashingSparseDpfPirClient(
     EncryptHelperRequestFn encrypter, std::string encryption_context_info,
     std::unique_ptr<DenseDpfPirClient> wrapped_client,
-    std::vector<HashFunction> hash_functions, int num_buckets,
-    int seed_fingerprint)
+    std::vector<HashFunction> hash_functions, int64_t num_buckets,
+    int seed_fingerprint, std::unique_ptr<RecordCompressor> compressor,
+    absl::optional<FingerprintFunction> key_fingerprint)
     : DpfPirClient(std::move(encrypter), std::move(encryption_context_info)),
       wrapped_client_(std::move(wrapped_client)),
       hash_functions_(std::move(hash_functions)),
       num_buckets_(num_buckets),
-      seed_fingerprint_(seed_fingerprint) {}
+      seed_fingerprint_(seed_fingerprint),
+      compressor_(std::move(compressor)),
+      key_fingerprint_(std::move(key_fingerprint)) {}
 
 absl::StatusOr<std::unique_ptr<CuckooHashingSparseDpfPirClient>>
 CuckooHashingSparseDpfPirClient::Create(
@@ -89,77 +82,62 @@ CuckooHashingSparseDpfPirClient::Create(
         "`params` does not contain valid valid "
         "CuckooHashingSparseDpfPirServerParams");
   }
-  if (params.cuckoo_hashing_sparse_dpf_pir_server_params().num_buckets() <= 0) {
-    return absl::InvalidArgumentError("`num_buckets` must be positive");
-  }
-  if (params.cuckoo_hashing_sparse_dpf_pir_server_params()
-          .num_hash_functions() <= 0) {
-    return absl::InvalidArgumentError("`num_hash_functions` must be positive");
+  const CuckooHashingParams& cuckoo_params =
+      params.cuckoo_hashing_sparse_dpf_pir_server_params();
+  DPF_RETURN_IF_ERROR(pir_internal::ValidateCuckooHashingParams(cuckoo_params));
+  if (cuckoo_params.fingerprint_bytes() < 0) {
+    return absl::InvalidArgumentError(
+        "`fingerprint_bytes` must not be negative");
   }
 
-  DPF_ASSIGN_OR_RETURN(HashFamily hash_family,
-                       CreateHashFamilyFromConfig(
-                           params.cuckoo_hashing_sparse_dpf_pir_server_params()
-                               .hash_family_config()));
-
-  // The first 31 bits of the SHA256 hash of the seed. Used to check that client
-  // and both servers use the same key.
-  int seed_fingerprint = SHA256HashFunction("")(
-      params.cuckoo_hashing_sparse_dpf_pir_server_params()
-          .hash_family_config()
-          .seed(),
-      std::numeric_limits<int>::max());
-
-  DPF_ASSIGN_OR_RETURN(
-      std::vector<HashFunction> hash_functions,
-      CreateHashFunctions(std::move(hash_family),
-                          params.cuckoo_hashing_sparse_dpf_pir_server_params()
-                              .num_hash_functions()));
-
-  PirConfig wrapped_client_config;
-  wrapped_client_config.mutable_dense_dpf_pir_config()->set_num_elements(
-      params.cuckoo_hashing_sparse_dpf_pir_server_params().num_buckets());
+  DPF_ASSIGN_OR_RETURN(std::vector<HashFunction> hash_functions,
+                       pir_internal::CreateBucketHashFunctions(cuckoo_params));
   DPF_ASSIGN_OR_RETURN(
       std::unique_ptr<DenseDpfPirClient> wrapped_client,
-      DenseDpfPirClient::Create(wrapped_client_config, DummyEncrypter, ""));
+      pir_internal::CreateBucketClient(cuckoo_params.num_buckets()));
+  // Only values are compressed, so they are decompressed here instead of in
+  // the wrapped client.
+  std::unique_ptr<RecordCompressor> compressor;
+  if (cuckoo_params.has_record_compression()) {
+    DPF_ASSIGN_OR_RETURN(compressor, RecordCompressor::Create(
+                                         cuckoo_params.record_compression()));
+  }
+
+  absl::optional<FingerprintFunction> key_fingerprint;
+  if (cuckoo_params.fingerprint_bytes() > 0) {
+    DPF_ASSIGN_OR_RETURN(
+        key_fingerprint,
+        pir_internal::CreateKeyFingerprintFunction(cuckoo_params));
+  }
 
   return absl::WrapUnique(new CuckooHashingSparseDpfPirClient(
       std::move(encrypter), std::string(encryption_context_info),
       std::move(wrapped_client), std::move(hash_functions),
-      params.cuckoo_hashing_sparse_dpf_pir_server_params().num_buckets(),
-      seed_fingerprint));
+      cuckoo_params.num_buckets(),
+      pir_internal::ComputeSeedFingerprint(cuckoo_params),
+      std::move(compressor), std::move(key_fingerprint)));
 }
+
 absl::StatusOr<std::tuple<DpfPirRequest::PlainRequest,
                           DpfPirRequest::HelperRequest, PirRequestClientState>>
 CuckooHashingSparseDpfPirClient::CreatePlainRequests(
     absl::Span<const std::string> query) const {
-  std::vector<int> indices;
-  indices.reserve(hash_functions_.size() * query.size());
-  for (int i = 0; i < query.size(); ++i) {
-    for (int j = 0; j < hash_functions_.size(); ++j) {
-      indices.push_back(hash_functions_[j](query[i], num_buckets_));
-    }
-  }
   DpfPirRequest::PlainRequest leader_request;
   DpfPirRequest::HelperRequest helper_request;
-  PirRequestClientState request_client_state;
+  std::string otp_seed;
   DPF_ASSIGN_OR_RETURN(
-      std::tie(leader_request, helper_request, request_client_state),
-      wrapped_client_->CreatePlainRequests(indices));
-  std::string otp_seed =
-      request_client_state.dense_dpf_pir_request_client_state()
-          .one_time_pad_seed();
-  request_client_state
-      .mutable_cuckoo_hashing_sparse_dpf_pir_request_client_state()
-      ->set_one_time_pad_seed(std::move(otp_seed));
-  for (int i = 0; i < query.size(); ++i) {
-    request_client_state
-        .mutable_cuckoo_hashing_sparse_dpf_pir_request_client_state()
-        ->add_query_strings(query[i]);
+      std::tie(leader_request, helper_request, otp_seed),
+      pir_internal::CreateBucketRequests(*wrapped_client_, hash_functions_,
+                                         num_buckets_, seed_fingerprint_,
+                                         query));
+  PirRequestClientState request_client_state;
+  CuckooHashingSparseDpfPirRequestClientState* sparse_state =
+      request_client_state
+          .mutable_cuckoo_hashing_sparse_dpf_pir_request_client_state();
+  sparse_state->set_one_time_pad_seed(std::move(otp_seed));
+  for (const std::string& query_string : query) {
+    sparse_state->add_query_strings(query_string);
   }
-  leader_request.set_seed_fingerprint(seed_fingerprint_);
-  helper_request.mutable_plain_request()->set_seed_fingerprint(
-      seed_fingerprint_);
   return std::make_tuple(std::move(leader_request), std::move(helper_request),
                          std::move(request_client_state));
 }
@@ -190,27 +168,38 @@ CuckooHashingSparseDpfPirClient::HandleResponse(
         "number of hash functions times 2");
   }
 
-  PirRequestClientState wrapped_client_state;
-  wrapped_client_state.mutable_dense_dpf_pir_request_client_state()
-      ->set_one_time_pad_seed(
-          request_client_state
-              .cuckoo_hashing_sparse_dpf_pir_request_client_state()
-              .one_time_pad_seed());
   DPF_ASSIGN_OR_RETURN(
       std::vector<std::string> raw_responses,
-      wrapped_client_->HandleResponse(pir_response, wrapped_client_state));
+      pir_internal::HandleBucketResponse(
+          *wrapped_client_, pir_response,
+          request_client_state
+              .cuckoo_hashing_sparse_dpf_pir_request_client_state()
+              .one_time_pad_seed()));
   std::vector<absl::optional<std::string>> result(
       raw_responses.size() / hash_functions_.size() / 2, absl::nullopt);
   for (int i = 0; i < result.size(); ++i) {
+    const std::string& query_string =
+        request_client_state
+            .cuckoo_hashing_sparse_dpf_pir_request_client_state()
+            .query_strings(i);
+    // All entries of a fingerprint key database have the same size, so the
+    // returned keys are compared without padding.
+    std::string query_fingerprint;
+    if (key_fingerprint_.has_value()) {
+      query_fingerprint = (*key_fingerprint_)(query_string);
+    }
     for (int j = 0; j < hash_functions_.size(); ++j) {
       int raw_index = 2 * (hash_functions_.size() * i + j);
-      if (!result[i].has_value() &&
-          IsPrefixPaddedWithZeros(
-              raw_responses[raw_index],
-              request_client_state
-                  .cuckoo_hashing_sparse_dpf_pir_request_client_state()
-                  .query_strings(i))) {
+      bool key_matches =
+          key_fingerprint_.has_value()
+              ? raw_responses[raw_index] == query_fingerprint
+              : IsPrefixPaddedWithZeros(raw_responses[raw_index],
+                                        query_string);
+      if (!result[i].has_value() && key_matches) {
         result[i] = raw_responses[raw_index + 1];
+        if (compressor_ != nullptr) {
+          DPF_ASSIGN_OR_RETURN(result[i], compressor_->Decompress(*result[i]));
+        }
       }
     }
   }
@@ -17,6 +17,7 @@
 #ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_CUCKOO_HASHING_SPARSE_DPF_PIR_CLIENT_H_
 #define DISTRIBUTED_POINT_FUNCTIONS_PIR_CUCKOO_HASHING_SPARSE_DPF_PIR_CLIENT_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -30,8 +31,10 @@
 #include "pir/cuckoo_hashing_sparse_dpf_pir_server.h"
 #include "pir/dense_dpf_pir_client.h"
 #include "pir/dpf_pir_client.h"
+#include "pir/hashing/fingerprint_function.h"
 #include "pir/hashing/hash_family.h"
 #include "pir/private_information_retrieval.pb.h"
+#include "pir/record_compression.h"
 
 namespace distributed_point_functions {
 
@@ -63,8 +66,12 @@ class CuckooHashingSparseDpfPirClient
   //
   // For each query key passed to the corresponding `CreateRequest` call,
   // returns the database value at that key. The returned values will be padded
-  // with null bytes to the size of the largest database entry. Returns
-  // INVALID_ARGUMENT if either the response or the client state is invalid.
+  // with null bytes to the size of the largest database entry, unless `params`
+  // specify record compression. If `params.fingerprint_bytes` is positive,
+  // keys are matched by their fingerprints, so a key not in the database
+  // returns another key's value with probability about
+  // `num_hash_functions * 2^(-8 * fingerprint_bytes)`. Returns INVALID_ARGUMENT
+  // if either the response or the client state is invalid.
   absl::StatusOr<std::vector<absl::optional<std::string>>> HandleResponse(
       const PirResponse& pir_response,
       const PirRequestClientState& request_client_state) const override;
@@ -73,13 +80,18 @@ class CuckooHashingSparseDpfPirClient
   CuckooHashingSparseDpfPirClient(
       EncryptHelperRequestFn encrypter, std::string encryption_context_info,
       std::unique_ptr<DenseDpfPirClient> wrapped_client,
-      std::vector<HashFunction> hash_functions, int num_buckets,
-      int seed_fingerprint);
+      std::vector<HashFunction> hash_functions, int64_t num_buckets,
+      int seed_fingerprint, std::unique_ptr<RecordCompressor> compressor,
+      absl::optional<FingerprintFunction> key_fingerprint);
 
   std::unique_ptr<DenseDpfPirClient> wrapped_client_;
   std::vector<HashFunction> hash_functions_;
-  int num_buckets_;
+  int64_t num_buckets_;
   int seed_fingerprint_;
+  // Null if values are not compressed.
+  std::unique_ptr<RecordCompressor> compressor_;
+  // Set if the database stores key fingerprints instead of full keys.
+  absl::optional<FingerprintFunction> key_fingerprint_;
 };
 
 }  // namespace distributed_point_functions
@@ -47,6 +47,7 @@ inline constexpr absl::string_view kTestHashFamilySeed = "kTestHashFamilySeed";
 
 using dpf_internal::IsOkAndHolds;
 using dpf_internal::StatusIs;
+using ::testing::ElementsAre;
 using ::testing::HasSubstr;
 using ::testing::NotNull;
 using ::testing::Optional;
@@ -111,6 +112,16 @@ TEST(CuckooHashingSparseDpfPirClient, CreateFailsIfNumHashFunctionsIsZero) {
       StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("positive")));
 }
 
+TEST(CuckooHashingSparseDpfPirClient, CreateFailsIfFingerprintBytesIsNegative) {
+  PirServerPublicParams params = GetDefaultParams();
+  params.mutable_cuckoo_hashing_sparse_dpf_pir_server_params()
+      ->set_fingerprint_bytes(-1);
+
+  EXPECT_THAT(
+      CuckooHashingSparseDpfPirClient::Create(params, GetEncrypter()),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("negative")));
+}
+
 TEST(CuckooHashingSparseDpfPirClient, CreateSucceeds) {
   EXPECT_THAT(CuckooHashingSparseDpfPirClient::Create(GetDefaultParams(),
                                                       GetEncrypter()),
@@ -125,6 +136,12 @@ class CuckooHashingSparseDpfPirClientTest : public ::testing::Test {
         HashFamilyConfig::HASH_FAMILY_SHA256);
     config.mutable_cuckoo_hashing_sparse_dpf_pir_config()->set_num_elements(
         kTestDatabaseNumElements);
+    if (record_compression_.has_value()) {
+      *config.mutable_cuckoo_hashing_sparse_dpf_pir_config()
+           ->mutable_record_compression() = *record_compression_;
+    }
+    config.mutable_cuckoo_hashing_sparse_dpf_pir_config()
+        ->set_key_fingerprint_bytes(key_fingerprint_bytes_);
     DPF_ASSERT_OK_AND_ASSIGN(
         CuckooHashingParams params,
         CuckooHashingSparseDpfPirServer::GenerateParams(config));
@@ -169,6 +186,10 @@ class CuckooHashingSparseDpfPirClientTest : public ::testing::Test {
                              CuckooHashingSparseDpfPirClient::Create(
                                  leader_->GetPublicParams(), GetEncrypter()));
   }
+  // Set by subclasses before SetUp() to compress the database.
+  absl::optional<RecordCompressionParams> record_compression_;
+  // Set by subclasses before SetUp() to store key fingerprints.
+  int key_fingerprint_bytes_ = 0;
   std::unique_ptr<CuckooHashingSparseDpfPirClient> client_;
   std::unique_ptr<CuckooHashingSparseDpfPirServer> leader_, helper_;
   std::vector<std::string> keys_, values_;
@@ -256,5 +277,65 @@ TEST_F(CuckooHashingSparseDpfPirClientTest,
   EXPECT_THAT(result[2], Optional(StartsWith(values_[42])));
 }
 
+class CuckooHashingSparseDpfPirClientCompressionTest
+    : public CuckooHashingSparseDpfPirClientTest {
+ protected:
+  CuckooHashingSparseDpfPirClientCompressionTest() {
+    record_compression_.emplace();
+    record_compression_->set_codec(RecordCompressionParams::CODEC_DEFLATE);
+    record_compression_->set_dictionary("Key Value ");
+  }
+};
+
+TEST_F(CuckooHashingSparseDpfPirClientCompressionTest, EndToEndSucceeds) {
+  std::vector<std::string> queries = {"Key 1", "Key", "Key 42"};
+
+  PirRequest request;
+  PirRequestClientState client_state;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(request, client_state),
+                           client_->CreateRequest(queries));
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response,
+                           leader_->HandleRequest(request));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::optional<std::string>> result,
+                           client_->HandleResponse(response, client_state));
+
+  // Decompressed values have no trailing null bytes.
+  EXPECT_THAT(result, ElementsAre(Optional(values_[1]), absl::nullopt,
+                                  Optional(values_[42])));
+}
+
+class CuckooHashingSparseDpfPirClientFingerprintTest
+    : public CuckooHashingSparseDpfPirClientTest,
+      public ::testing::WithParamInterface<int> {
+ protected:
+  CuckooHashingSparseDpfPirClientFingerprintTest() {
+    key_fingerprint_bytes_ = GetParam();
+  }
+};
+
+TEST_P(CuckooHashingSparseDpfPirClientFingerprintTest, EndToEndSucceeds) {
+  std::vector<std::string> queries = {"Key 1", "Key", "Key 42",
+                                      std::string(100, 'x')};
+
+  PirRequest request;
+  PirRequestClientState client_state;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(request, client_state),
+                           client_->CreateRequest(queries));
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response,
+                           leader_->HandleRequest(request));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::optional<std::string>> result,
+                           client_->HandleResponse(response, client_state));
+
+  EXPECT_EQ(result.size(), queries.size());
+  EXPECT_THAT(result[0], Optional(StartsWith(values_[1])));
+  EXPECT_EQ(result[1], absl::nullopt);
+  EXPECT_THAT(result[2], Optional(StartsWith(values_[42])));
+  EXPECT_EQ(result[3], absl::nullopt);
+}
+
+INSTANTIATE_TEST_SUITE_P(FingerprintBytes,
+                         CuckooHashingSparseDpfPirClientFingerprintTest,
+                         testing::Values(8, 16));
+
 }  // namespace
 }  // namespace distributed_point_functions
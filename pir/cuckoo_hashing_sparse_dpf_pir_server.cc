@@ -14,11 +14,7 @@
 
 #include "pir/cuckoo_hashing_sparse_dpf_pir_server.h"
 
-#include <cmath>
-#include <limits>
 #include <memory>
-#include <new>
-#include <string>
 #include <utility>
 #include <vector>
 
@@ -26,18 +22,13 @@
 #include "absl/numeric/int128.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
-#include "dpf/distributed_point_function.pb.h"
+#include "absl/types/span.h"
 #include "dpf/status_macros.h"
-#include "openssl/rand.h"
-#include "pir/hashing/hash_family_config.pb.h"
-#include "pir/hashing/sha256_hash_family.h"
+#include "dpf/xor_wrapper.h"
+#include "pir/internal/cuckoo_hashing.h"
 #include "pir/private_information_retrieval.pb.h"
 
 namespace distributed_point_functions {
-namespace {
-static constexpr int kNumHashFunctions = 3;
-static constexpr double kBucketsPerElement = 1.5;
-}  // namespace
 
 CuckooHashingSparseDpfPirServer::CuckooHashingSparseDpfPirServer(
     PirServerPublicParams params, std::unique_ptr<DistributedPointFunction> dpf,
@@ -54,23 +45,20 @@ CuckooHashingSparseDpfPirServer::GenerateParams(const PirConfig& config) {
     return absl::InvalidArgumentError(
         "`config` must be a valid CuckooHashingSparseDpfPirConfig");
   }
-  if (config.cuckoo_hashing_sparse_dpf_pir_config().num_elements() <= 0) {
-    return absl::InvalidArgumentError("`num_elements` must be positive");
+  const CuckooHashingSparseDpfPirConfig& sparse_config =
+      config.cuckoo_hashing_sparse_dpf_pir_config();
+  DPF_ASSIGN_OR_RETURN(
+      CuckooHashingParams params,
+      pir_internal::GenerateCuckooHashingParams(sparse_config.num_elements(),
+                                                sparse_config.hash_family()));
+  if (sparse_config.key_fingerprint_bytes() < 0) {
+    return absl::InvalidArgumentError(
+        "`key_fingerprint_bytes` must not be negative");
   }
-  if (config.cuckoo_hashing_sparse_dpf_pir_config().hash_family() ==
-      HashFamilyConfig::HASH_FAMILY_UNSPECIFIED) {
-    return absl::InvalidArgumentError("`hash_family` must be set");
+  if (sparse_config.has_record_compression()) {
+    *params.mutable_record_compression() = sparse_config.record_compression();
   }
-  CuckooHashingParams params;
-  std::string seed(kHashFunctionSeedLengthBytes, '\0');
-  RAND_bytes(reinterpret_cast<uint8_t*>(&seed[0]), seed.size());
-  params.mutable_hash_family_config()->set_seed(std::move(seed));
-  params.mutable_hash_family_config()->set_hash_family(
-      config.cuckoo_hashing_sparse_dpf_pir_config().hash_family());
-  params.set_num_hash_functions(kNumHashFunctions);
-  params.set_num_buckets(
-      kBucketsPerElement *
-      config.cuckoo_hashing_sparse_dpf_pir_config().num_elements());
+  params.set_fingerprint_bytes(sparse_config.key_fingerprint_bytes());
   return params;
 }
 
@@ -96,16 +84,10 @@ CuckooHashingSparseDpfPirServer::CreateHelper(
 absl::StatusOr<std::unique_ptr<CuckooHashingSparseDpfPirServer>>
 CuckooHashingSparseDpfPirServer::CreatePlain(
     CuckooHashingParams params, std::unique_ptr<Database> database) {
-  if (params.num_buckets() <= 0) {
-    return absl::InvalidArgumentError("`num_buckets` must be positive");
-  }
-  if (params.num_hash_functions() <= 0) {
-    return absl::InvalidArgumentError("`num_hash_functions` must be positive");
-  }
-  if (params.hash_family_config().hash_family() ==
-      HashFamilyConfig::HASH_FAMILY_UNSPECIFIED) {
+  DPF_RETURN_IF_ERROR(pir_internal::ValidateCuckooHashingParams(params));
+  if (params.fingerprint_bytes() < 0) {
     return absl::InvalidArgumentError(
-        "params.hash_family_config.hash_family must be set");
+        "`fingerprint_bytes` must not be negative");
   }
   if (database == nullptr) {
     return absl::InvalidArgumentError("`database` cannot be null");
@@ -116,18 +98,9 @@ CuckooHashingSparseDpfPirServer::CreatePlain(
         "`params.num_buckets`");
   }
 
-  DpfParameters dpf_parameters;
-  dpf_parameters.set_log_domain_size(
-      static_cast<int>(std::ceil(std::log2(params.num_buckets()))));
-  dpf_parameters.mutable_value_type()->mutable_xor_wrapper()->set_bitsize(
-      kDpfBlockSizeBits);
-  DPF_ASSIGN_OR_RETURN(auto dpf,
-                       DistributedPointFunction::Create(dpf_parameters));
-
-  // The first 31 bits of the SHA256 hash of the seed. Used to check that client
-  // and both servers use the same key.
-  int seed_fingerprint = SHA256HashFunction("")(
-      params.hash_family_config().seed(), std::numeric_limits<int>::max());
+  DPF_ASSIGN_OR_RETURN(
+      auto dpf, pir_internal::CreateBucketSelectionDpf(params.num_buckets()));
+  int seed_fingerprint = pir_internal::ComputeSeedFingerprint(params);
 
   PirServerPublicParams server_params;
   *(server_params.mutable_cuckoo_hashing_sparse_dpf_pir_server_params()) =
@@ -141,40 +114,32 @@ CuckooHashingSparseDpfPirServer::CreatePlain(
 // Computes the response to the client's `request`.
 absl::StatusOr<PirResponse> CuckooHashingSparseDpfPirServer::HandlePlainRequest(
     const PirRequest& request) const {
-  if (request.wrapped_pir_request_case() != PirRequest::kDpfPirRequest) {
-    return absl::InvalidArgumentError(
-        "`request` does not contain a valid DpfPirRequest");
-  }
-  if (request.dpf_pir_request().wrapped_request_case() !=
-      DpfPirRequest::kPlainRequest) {
-    return absl::InvalidArgumentError(
-        "`request` does not contain a valid DpfPirRequest::PlainRequest");
-  }
-  const DpfPirRequest::PlainRequest& plain_request =
-      request.dpf_pir_request().plain_request();
-  if (plain_request.dpf_key_size() == 0) {
-    return absl::InvalidArgumentError("`dpf_key` must not be empty");
-  }
-  if (plain_request.seed_fingerprint() != 0 &&
-      plain_request.seed_fingerprint() != seed_fingerprint_) {
-    return absl::InvalidArgumentError(
-        "`seed_fingerprint` does not match. Please ensure that all servers and "
-        "the client are initialized with the same parameters.");
-  }
-
-  std::vector<std::vector<XorWrapper<absl::uint128>>> selections(
-      plain_request.dpf_key_size());
-  for (int i = 0; i < plain_request.dpf_key_size(); ++i) {
-    // Evaluate DPF and compute inner product with the database.
-    DPF_ASSIGN_OR_RETURN(
-        auto ctx, dpf_->CreateEvaluationContext(plain_request.dpf_key(i)));
-    DPF_ASSIGN_OR_RETURN(
-        selections[i], dpf_->EvaluateNext<XorWrapper<absl::uint128>>({}, ctx));
+  DPF_ASSIGN_OR_RETURN(
+      const DpfPirRequest::PlainRequest* plain_request,
+      pir_internal::GetCuckooHashingPlainRequest(request, seed_fingerprint_));
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<XorWrapper<absl::uint128>> selections,
+      pir_internal::EvaluateBucketSelections(
+          *dpf_,
+          params_.cuckoo_hashing_sparse_dpf_pir_server_params().num_buckets(),
+          *plain_request));
+
+  // The outputs of each key are contiguous, so they can be passed to the
+  // database as they are.
+  PirResponse response;
+  absl::Status status =
+      AppendInnerProducts(*database_, absl::MakeConstSpan(selections),
+                          plain_request->dpf_key_size(), response);
+  if (!absl::IsUnimplemented(status)) {
+    DPF_RETURN_IF_ERROR(status);
+    return response;
   }
 
-  DPF_ASSIGN_OR_RETURN(std::vector<Database::RecordType> inner_products,
-                       database_->InnerProductWith(selections));
-  PirResponse response;
+  // The database can only return newly allocated inner products.
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<Database::RecordType> inner_products,
+      database_->InnerProductWith(SplitSelections(
+          absl::MakeConstSpan(selections), plain_request->dpf_key_size())));
   response.mutable_dpf_pir_response()->mutable_masked_response()->Reserve(
       2 * inner_products.size());
   for (int i = 0; i < inner_products.size(); ++i) {
@@ -108,9 +108,6 @@ class CuckooHashingSparseDpfPirServer : public DpfPirServer {
       const PirRequest& request) const override;
 
  private:
-  static constexpr int kHashFunctionSeedLengthBytes = 16;
-  static constexpr int kDpfBlockSizeBits = 8 * sizeof(absl::uint128);
-
   CuckooHashingSparseDpfPirServer(PirServerPublicParams params,
                                   std::unique_ptr<DistributedPointFunction> dpf,
                                   std::unique_ptr<Database> database,
@@ -23,6 +23,7 @@
 #include "absl/random/random.h"
 #include "absl/types/span.h"
 #include "benchmark/benchmark.h"  // third_party/benchmark
+#include "dpf/internal/memory_counters.h"
 #include "dpf/internal/status_matchers.h"
 #include "pir/cuckoo_hashed_dpf_pir_database.h"
 #include "pir/cuckoo_hashing_sparse_dpf_pir_server.h"
@@ -40,6 +41,9 @@ ABSL_FLAG(int, num_bytes_per_key, 6, "The number of bytes in each key.");
 ABSL_FLAG(int, num_bytes_per_value, 8, "The number of bytes in each value.");
 ABSL_FLAG(int, num_keys_per_request, 1,
           "The number of query keys in each PIR request.");
+ABSL_FLAG(int, key_fingerprint_bytes, 0,
+          "If positive, the size of the key fingerprints stored instead of the "
+          "full keys.");
 
 namespace distributed_point_functions {
 namespace {
@@ -56,6 +60,7 @@ void BM_HandlePlainRequest(benchmark::State& state) {
   int num_bytes_per_key = absl::GetFlag(FLAGS_num_bytes_per_key);
   int num_bytes_per_value = absl::GetFlag(FLAGS_num_bytes_per_value);
   int num_keys_per_request = absl::GetFlag(FLAGS_num_keys_per_request);
+  int key_fingerprint_bytes = absl::GetFlag(FLAGS_key_fingerprint_bytes);
 
   // Setup cuckoo hashing parameters.
   PirConfig config;
@@ -63,6 +68,8 @@ void BM_HandlePlainRequest(benchmark::State& state) {
       num_records);
   config.mutable_cuckoo_hashing_sparse_dpf_pir_config()->set_hash_family(
       kHashFamily);
+  config.mutable_cuckoo_hashing_sparse_dpf_pir_config()
+      ->set_key_fingerprint_bytes(key_fingerprint_bytes);
   DPF_ASSERT_OK_AND_ASSIGN(
       CuckooHashingParams params,
       CuckooHashingSparseDpfPirServer::GenerateParams(config));
@@ -107,13 +114,14 @@ void BM_HandlePlainRequest(benchmark::State& state) {
           CuckooHashingSparseDpfPirServer::kEncryptionContextInfo));
 
   absl::BitGen bitgen;
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto _ : state) {
     state.PauseTiming();
 
     // Generate `num_keys_per_request` many queries with random keys. Every
     // query key is hashed into indices using all the hash functions. So we will
     // have `num_keys_per_request * hash_functions.size()` many indices.
-    std::vector<int> indices;
+    std::vector<int64_t> indices;
     indices.reserve(num_keys_per_request * hash_functions.size());
     for (int i = 0; i < num_keys_per_request; ++i) {
       int query_index = absl::Uniform<int>(bitgen, 0, keys.size());
@@ -51,6 +51,7 @@ using dpf_internal::StatusIs;
 using ::testing::Contains;
 using ::testing::HasSubstr;
 using ::testing::NotNull;
+using ::testing::Property;
 using ::testing::StartsWith;
 using ::testing::Truly;
 using Database = CuckooHashingSparseDpfPirServer::Database;
@@ -155,6 +156,40 @@ TEST_F(CuckooHashingSparseDpfPirServerTest, GenerateParamsReturnsValidParams) {
               })));
 }
 
+TEST_F(CuckooHashingSparseDpfPirServerTest,
+       GenerateParamsCopiesKeyFingerprintBytes) {
+  SetUpConfig();
+  config_.mutable_cuckoo_hashing_sparse_dpf_pir_config()
+      ->set_key_fingerprint_bytes(8);
+
+  EXPECT_THAT(CuckooHashingSparseDpfPirServer::GenerateParams(config_),
+              IsOkAndHolds(Property(&CuckooHashingParams::fingerprint_bytes,
+                                    8)));
+}
+
+TEST_F(CuckooHashingSparseDpfPirServerTest,
+       GenerateParamsFailsWhenKeyFingerprintBytesIsNegative) {
+  SetUpConfig();
+  config_.mutable_cuckoo_hashing_sparse_dpf_pir_config()
+      ->set_key_fingerprint_bytes(-1);
+
+  EXPECT_THAT(CuckooHashingSparseDpfPirServer::GenerateParams(config_),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("key_fingerprint_bytes")));
+}
+
+TEST_F(CuckooHashingSparseDpfPirServerTest,
+       CreatePlainFailsWhenFingerprintBytesIsNegative) {
+  SetUpDatabase();
+
+  params_.set_fingerprint_bytes(-1);
+
+  EXPECT_THAT(CuckooHashingSparseDpfPirServer::CreatePlain(
+                  params_, std::move(database_)),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("fingerprint_bytes")));
+}
+
 TEST_F(CuckooHashingSparseDpfPirServerTest,
        CreatePlainFailsWhenNumBucketsIsZero) {
   SetUpDatabase();
@@ -297,7 +332,7 @@ TEST_F(CuckooHashingSparseDpfPirServerTest, HandleRequestSucceeds) {
                                                params_.num_hash_functions()));
   ASSERT_EQ(hash_functions.size(), params_.num_hash_functions());
   constexpr absl::string_view query = "Key 42";
-  std::vector<int> indices;
+  std::vector<int64_t> indices;
   for (const HashFunction& hash_function : hash_functions) {
     indices.push_back(hash_function(query, params_.num_buckets()));
   }
@@ -346,7 +381,7 @@ TEST_F(CuckooHashingSparseDpfPirServerTest, HandleRequestSucceeds) {
 TEST_F(CuckooHashingSparseDpfPirServerTest,
        HandlePlainRequestCanBeCalledConcurrently) {
   SetUpServer();
-  std::vector<int> indices = {1, 2, 3};
+  std::vector<int64_t> indices = {1, 2, 3};
   constexpr int kNumThreads = 1024;
 
   // Create plain request for `indices`.
@@ -0,0 +1,207 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/dense_additive_dpf_pir_server.h"
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/status_macros.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+namespace {
+
+constexpr int kBytesPerWord = sizeof(uint64_t);
+
+uint64_t ReadLittleEndianWord(const char* bytes) {
+  uint64_t result = 0;
+  for (int i = kBytesPerWord - 1; i >= 0; --i) {
+    result = (result << 8) | static_cast<uint8_t>(bytes[i]);
+  }
+  return result;
+}
+
+void WriteLittleEndianWord(uint64_t value, char* bytes) {
+  for (int i = 0; i < kBytesPerWord; ++i) {
+    bytes[i] = static_cast<char>(value & 0xff);
+    value >>= 8;
+  }
+}
+
+}  // namespace
+
+DenseAdditiveDpfPirServer::DenseAdditiveDpfPirServer(
+    std::unique_ptr<DistributedPointFunction> dpf,
+    std::unique_ptr<Database> database)
+    : dpf_(std::move(dpf)), database_(std::move(database)) {}
+
+absl::StatusOr<std::unique_ptr<DenseAdditiveDpfPirServer>>
+DenseAdditiveDpfPirServer::CreateLeader(const PirConfig& config,
+                                        std::unique_ptr<Database> database,
+                                        ForwardHelperRequestFn sender) {
+  DPF_ASSIGN_OR_RETURN(auto leader, CreatePlain(config, std::move(database)));
+  DPF_RETURN_IF_ERROR(leader->MakeLeader(std::move(sender)));
+  return leader;
+}
+
+absl::StatusOr<std::unique_ptr<DenseAdditiveDpfPirServer>>
+DenseAdditiveDpfPirServer::CreateHelper(const PirConfig& config,
+                                        std::unique_ptr<Database> database,
+                                        DecryptHelperRequestFn decrypter) {
+  DPF_ASSIGN_OR_RETURN(auto helper, CreatePlain(config, std::move(database)));
+  DPF_RETURN_IF_ERROR(
+      helper->MakeHelper(std::move(decrypter), kEncryptionContextInfo));
+  return helper;
+}
+
+absl::StatusOr<DpfParameters> DenseAdditiveDpfPirServer::GetDpfParameters(
+    const PirConfig& config) {
+  if (config.wrapped_pir_config_case() !=
+      PirConfig::kDenseAdditiveDpfPirConfig) {
+    return absl::InvalidArgumentError(
+        "`config` does not contain a valid DenseAdditiveDpfPirConfig");
+  }
+  if (config.dense_additive_dpf_pir_config().num_elements() <= 0) {
+    return absl::InvalidArgumentError("`num_elements` must be positive");
+  }
+  DpfParameters parameters;
+  parameters.set_log_domain_size(static_cast<int>(std::ceil(
+      std::log2(config.dense_additive_dpf_pir_config().num_elements()))));
+  parameters.mutable_value_type()->mutable_integer()->set_bitsize(64);
+  return parameters;
+}
+
+absl::StatusOr<std::unique_ptr<DenseAdditiveDpfPirServer>>
+DenseAdditiveDpfPirServer::CreatePlain(const PirConfig& config,
+                                       std::unique_ptr<Database> database) {
+  DPF_ASSIGN_OR_RETURN(DpfParameters parameters, GetDpfParameters(config));
+  if (database == nullptr) {
+    return absl::InvalidArgumentError("`database` cannot be null");
+  }
+  if (database->size() !=
+      config.dense_additive_dpf_pir_config().num_elements()) {
+    return absl::InvalidArgumentError(
+        "Database size does not match the config size");
+  }
+  DPF_ASSIGN_OR_RETURN(auto dpf, DistributedPointFunction::Create(parameters));
+
+  return absl::WrapUnique(
+      new DenseAdditiveDpfPirServer(std::move(dpf), std::move(database)));
+}
+
+std::string DenseAdditiveDpfPirServer::SerializeResponse(
+    absl::Span<const uint64_t> values) {
+  std::string result(values.size() * kBytesPerWord, '\0');
+  for (int i = 0; i < values.size(); ++i) {
+    WriteLittleEndianWord(values[i], &result[i * kBytesPerWord]);
+  }
+  return result;
+}
+
+absl::StatusOr<std::vector<uint64_t>> DenseAdditiveDpfPirServer::ParseResponse(
+    absl::string_view response) {
+  if (response.size() % kBytesPerWord != 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Response size (=", response.size(),
+                     ") must be a multiple of ", kBytesPerWord));
+  }
+  std::vector<uint64_t> result(response.size() / kBytesPerWord);
+  for (int i = 0; i < result.size(); ++i) {
+    result[i] = ReadLittleEndianWord(&response[i * kBytesPerWord]);
+  }
+  return result;
+}
+
+const PirServerPublicParams& DenseAdditiveDpfPirServer::GetPublicParams()
+    const {
+  return PirServerPublicParams::default_instance();
+}
+
+absl::Status DenseAdditiveDpfPirServer::CombineResponseShares(
+    absl::string_view share, std::string& accumulator) const {
+  if (share.size() % kBytesPerWord != 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Response share size (=", share.size(),
+                     ") must be a multiple of ", kBytesPerWord));
+  }
+  for (int i = 0; i < accumulator.size(); i += kBytesPerWord) {
+    WriteLittleEndianWord(ReadLittleEndianWord(&accumulator[i]) +
+                              ReadLittleEndianWord(&share[i]),
+                          &accumulator[i]);
+  }
+  return absl::OkStatus();
+}
+
+// Computes the response to the client's `request`.
+absl::StatusOr<PirResponse> DenseAdditiveDpfPirServer::HandlePlainRequest(
+    const PirRequest& request) const {
+  if (request.wrapped_pir_request_case() != PirRequest::kDpfPirRequest) {
+    return absl::InvalidArgumentError(
+        "`request` does not contain a valid DpfPirRequest");
+  }
+  if (request.dpf_pir_request().wrapped_request_case() !=
+      DpfPirRequest::kPlainRequest) {
+    return absl::InvalidArgumentError(
+        "`request` does not contain a valid DpfPirRequest::PlainRequest");
+  }
+  const DpfPirRequest::PlainRequest& plain_request =
+      request.dpf_pir_request().plain_request();
+  if (plain_request.dpf_key_size() == 0) {
+    return absl::InvalidArgumentError("`dpf_key` must not be empty");
+  }
+
+  // Evaluate all keys together, so that their trees share AES batches. Only
+  // the first `database_->size()` elements of the domain are expanded.
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<uint64_t> expansions,
+      dpf_->EvaluateUntilBatch<uint64_t>(
+          0,
+          absl::MakeConstSpan(plain_request.dpf_key().data(),
+                              plain_request.dpf_key_size()),
+          database_->size()));
+  PirResponse response;
+  absl::Status status =
+      AppendInnerProducts(*database_, absl::MakeConstSpan(expansions),
+                          plain_request.dpf_key_size(), response);
+  if (!absl::IsUnimplemented(status)) {
+    DPF_RETURN_IF_ERROR(status);
+    return response;
+  }
+
+  // The database only supports separate selection vectors.
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<std::vector<uint64_t>> inner_products,
+      database_->InnerProductWith(SplitSelections(
+          absl::MakeConstSpan(expansions), plain_request.dpf_key_size())));
+  for (int i = 0; i < inner_products.size(); ++i) {
+    *(response.mutable_dpf_pir_response()->add_masked_response()) =
+        SerializeResponse(inner_products[i]);
+  }
+  return response;
+}
+
+}  // namespace distributed_point_functions
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_DENSE_ADDITIVE_DPF_PIR_SERVER_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_DENSE_ADDITIVE_DPF_PIR_SERVER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "dpf/distributed_point_function.h"
+#include "pir/dpf_pir_server.h"
+#include "pir/pir_database_interface.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+// Implements the server of a DPF-based two-server PIR scheme with additive
+// output shares over a dense database of integer records indexed by numbers in
+// [0, database_size). Each DPF key is evaluated as a `uint64_t` DPF, i.e., the
+// two servers obtain additive shares modulo 2^64 of a vector that is zero
+// everywhere except at the client's index, where it holds the DPF's value
+// (e.g., 1 for plain retrieval). The response to each key is the dot product
+// of that vector with every database column, serialized as one little-endian
+// `uint64_t` per column. Adding both servers' responses modulo 2^64 yields the
+// selected record scaled by the DPF value. Summing the responses to multiple
+// keys yields private weighted sums over the database.
+//
+// This class can be instantiated as a Leader, Helper, or plain server. See the
+// documentation of DpfPirServer for details. In the Leader/Helper model, the
+// Helper adds (rather than XORs) its one-time-pad to each response word, so
+// the client must subtract it after receiving the combined response.
+class DenseAdditiveDpfPirServer : public DpfPirServer {
+ public:
+  // The Database interface used for additive dense DPF PIR. Block type is
+  // `uint64_t` (one additive share per record), and records are vectors of
+  // column values.
+  using Database = PirDatabaseInterface<uint64_t, std::vector<uint64_t>>;
+
+  // Function type for the `sender` argument passed to CreateLeader. See
+  // DpfPirServer documentation for details.
+  using DpfPirServer::ForwardHelperRequestFn;
+
+  // Function type for the `decrypter` argument passed to CreateHelper. See
+  // DpfPirServer documentation for details.
+  using DpfPirServer::DecryptHelperRequestFn;
+
+  // Context Info passed to the decrypter when created as Helper. Should be the
+  // same as used on the client for encryption.
+  static inline constexpr absl::string_view kEncryptionContextInfo =
+      "DenseAdditiveDpfPirServer";
+
+  // Creates a new DenseAdditiveDpfPirServer instance with the given PirConfig
+  // and Database, acting as a Leader server. `sender` should be a function
+  // that forwards the EncryptedHelperRequest to the Helper, and executes its
+  // callback while waiting for the response (which will in turn compute the
+  // Leader's response).
+  //
+  // Returns INVALID_ARGUMENT if `sender` or `database` is NULL, or if `config`
+  // is invalid.
+  static absl::StatusOr<std::unique_ptr<DenseAdditiveDpfPirServer>>
+  CreateLeader(const PirConfig& config, std::unique_ptr<Database> database,
+               ForwardHelperRequestFn sender);
+
+  // Creates a new DenseAdditiveDpfPirServer instance with the given PirConfig
+  // and Database, acting as a Helper server. `decrypter` should wrap around an
+  // implementation of crypto::tink::HybridDecrypt::Decrypt for which the client
+  // has the public key that is used to encrypt the helper's request.
+  // See DpfPirServer documentation for more details.
+  //
+  // Returns INVALID_ARGUMENT if `decrypter` or `database` is NULL, or if
+  // `config` is invalid.
+  static absl::StatusOr<std::unique_ptr<DenseAdditiveDpfPirServer>>
+  CreateHelper(const PirConfig& config, std::unique_ptr<Database> database,
+               DecryptHelperRequestFn decrypter);
+
+  // Creates a new DenseAdditiveDpfPirServer instance with the given PirConfig
+  // and Database, acting as a plain server.
+  //
+  // Returns INVALID_ARGUMENT if `database` is NULL, or if `config` is invalid.
+  static absl::StatusOr<std::unique_ptr<DenseAdditiveDpfPirServer>>
+  CreatePlain(const PirConfig& config, std::unique_ptr<Database> database);
+
+  // Returns the DpfParameters used by this server. Clients must use the same
+  // parameters to generate keys.
+  static absl::StatusOr<DpfParameters> GetDpfParameters(
+      const PirConfig& config);
+
+  // Serializes `values` as a sequence of little-endian 64-bit words, which is
+  // the format of each `masked_response` returned by this server.
+  static std::string SerializeResponse(absl::Span<const uint64_t> values);
+
+  // Parses a `masked_response` returned by this server. Returns
+  // INVALID_ARGUMENT if the size of `response` is not a multiple of 8.
+  static absl::StatusOr<std::vector<uint64_t>> ParseResponse(
+      absl::string_view response);
+
+  // Returns a reference to the server's database.
+  const Database& database() const { return *database_; }
+
+  virtual ~DenseAdditiveDpfPirServer() = default;
+
+  // Returns an empty PirServerPublicParams proto. DenseAdditiveDpfPirServer
+  // does not have any public parameters.
+  const PirServerPublicParams& GetPublicParams() const override;
+
+ protected:
+  // Computes the response to the client's `request`. Should not be called by
+  // users, but only from DpfPirServer::HandleRequest.
+  absl::StatusOr<PirResponse> HandlePlainRequest(
+      const PirRequest& request) const override;
+
+  // Adds `share` to `accumulator` word-wise modulo 2^64.
+  absl::Status CombineResponseShares(absl::string_view share,
+                                     std::string& accumulator) const override;
+
+ private:
+  DenseAdditiveDpfPirServer(std::unique_ptr<DistributedPointFunction> dpf,
+                            std::unique_ptr<Database> database);
+
+  std::unique_ptr<DistributedPointFunction> dpf_;
+  std::unique_ptr<Database> database_;
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_DENSE_ADDITIVE_DPF_PIR_SERVER_H_
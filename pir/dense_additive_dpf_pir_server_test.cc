@@ -0,0 +1,295 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/dense_additive_dpf_pir_server.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/functional/any_invocable.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "pir/dense_additive_pir_database.h"
+#include "pir/private_information_retrieval.pb.h"
+#include "pir/prng/aes_128_ctr_seeded_prng.h"
+#include "pir/testing/encrypt_decrypt.h"
+#include "pir/testing/mock_pir_database.h"
+#include "tink/hybrid_decrypt.h"
+#include "tink/hybrid_encrypt.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::IsOkAndHolds;
+using dpf_internal::StatusIs;
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::HasSubstr;
+using ::testing::NotNull;
+using ::testing::Return;
+using MockDenseAdditiveDpfPirDatabase =
+    pir_testing::MockPirDatabase<uint64_t, std::vector<uint64_t>>;
+
+constexpr int kTestDatabaseElements = 1234;
+constexpr int kNumColumns = 3;
+
+PirConfig CreateConfig(int num_elements) {
+  PirConfig config;
+  config.mutable_dense_additive_dpf_pir_config()->set_num_elements(
+      num_elements);
+  return config;
+}
+
+TEST(DenseAdditiveDpfPirServer, CreateSucceeds) {
+  auto database = std::make_unique<MockDenseAdditiveDpfPirDatabase>();
+  EXPECT_CALL(*database, size()).WillOnce(Return(kTestDatabaseElements));
+
+  EXPECT_THAT(DenseAdditiveDpfPirServer::CreatePlain(
+                  CreateConfig(kTestDatabaseElements), std::move(database)),
+              IsOkAndHolds(NotNull()));
+}
+
+TEST(DenseAdditiveDpfPirServer, CreateFailsIfConfigUninitialized) {
+  auto database = std::make_unique<MockDenseAdditiveDpfPirDatabase>();
+
+  EXPECT_THAT(
+      DenseAdditiveDpfPirServer::CreatePlain(PirConfig(), std::move(database)),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("DenseAdditiveDpfPirConfig")));
+}
+
+TEST(DenseAdditiveDpfPirServer, CreateFailsIfDatabaseIsNull) {
+  EXPECT_THAT(DenseAdditiveDpfPirServer::CreatePlain(
+                  CreateConfig(kTestDatabaseElements), nullptr),
+              StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("null")));
+}
+
+TEST(DenseAdditiveDpfPirServer, CreateFailsIfDatabaseSizeIsZero) {
+  auto database = std::make_unique<MockDenseAdditiveDpfPirDatabase>();
+
+  EXPECT_THAT(
+      DenseAdditiveDpfPirServer::CreatePlain(CreateConfig(0),
+                                             std::move(database)),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("positive")));
+}
+
+TEST(DenseAdditiveDpfPirServer, CreateFailsIfDatabaseSizeDoesNotMatchConfig) {
+  auto database = std::make_unique<MockDenseAdditiveDpfPirDatabase>();
+  EXPECT_CALL(*database, size()).WillOnce(Return(kTestDatabaseElements + 1));
+
+  EXPECT_THAT(DenseAdditiveDpfPirServer::CreatePlain(
+                  CreateConfig(kTestDatabaseElements), std::move(database)),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("size does not match")));
+}
+
+TEST(DenseAdditiveDpfPirServer, SerializeAndParseResponseRoundTrip) {
+  std::vector<uint64_t> values = {0, 1, 0x0123456789abcdef, ~uint64_t{0}};
+  std::string serialized =
+      DenseAdditiveDpfPirServer::SerializeResponse(values);
+  EXPECT_EQ(serialized.size(), values.size() * sizeof(uint64_t));
+  EXPECT_EQ(serialized[2 * sizeof(uint64_t)], '\xef');  // Little endian.
+  EXPECT_THAT(DenseAdditiveDpfPirServer::ParseResponse(serialized),
+              IsOkAndHolds(ElementsAreArray(values)));
+}
+
+TEST(DenseAdditiveDpfPirServer, ParseResponseFailsWithWrongSize) {
+  EXPECT_THAT(DenseAdditiveDpfPirServer::ParseResponse("1234567"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("multiple of 8")));
+}
+
+class DenseAdditiveDpfPirServerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    config_ = CreateConfig(kTestDatabaseElements);
+    records_.resize(kTestDatabaseElements);
+    for (int i = 0; i < kTestDatabaseElements; ++i) {
+      records_[i] = {static_cast<uint64_t>(i), uint64_t{1} << (i % 64),
+                     static_cast<uint64_t>(3 * i + 7)};
+    }
+    DPF_ASSERT_OK_AND_ASSIGN(
+        DpfParameters parameters,
+        DenseAdditiveDpfPirServer::GetDpfParameters(config_));
+    DPF_ASSERT_OK_AND_ASSIGN(dpf_,
+                             DistributedPointFunction::Create(parameters));
+  }
+
+  absl::StatusOr<std::unique_ptr<DenseAdditiveDpfPirServer::Database>>
+  CreateDatabase() const {
+    DenseAdditivePirDatabase::Builder builder(
+        std::vector<int>(kNumColumns, 64));
+    for (const std::vector<uint64_t>& record : records_) {
+      builder.Insert(record);
+    }
+    return builder.Build();
+  }
+
+  // Generates keys for the point function that is `weight` at `index`, and
+  // appends them to the respective plain requests.
+  void AddKeys(int index, uint64_t weight,
+               DpfPirRequest::PlainRequest& request0,
+               DpfPirRequest::PlainRequest& request1) const {
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::tie(*request0.add_dpf_key(), *request1.add_dpf_key()),
+        dpf_->GenerateKeys(index, weight));
+  }
+
+  PirConfig config_;
+  std::vector<std::vector<uint64_t>> records_;
+  std::unique_ptr<DistributedPointFunction> dpf_;
+};
+
+TEST_F(DenseAdditiveDpfPirServerTest, HandleRequestFailsIfRequestIsEmpty) {
+  DPF_ASSERT_OK_AND_ASSIGN(auto database, CreateDatabase());
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto server,
+      DenseAdditiveDpfPirServer::CreatePlain(config_, std::move(database)));
+  PirRequest request;
+  request.mutable_dpf_pir_request()->mutable_plain_request();
+
+  EXPECT_THAT(server->HandleRequest(request),
+              StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("empty")));
+}
+
+TEST_F(DenseAdditiveDpfPirServerTest, PlainResponsesSumToSelectedRecords) {
+  DPF_ASSERT_OK_AND_ASSIGN(auto database0, CreateDatabase());
+  DPF_ASSERT_OK_AND_ASSIGN(auto database1, CreateDatabase());
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto server0,
+      DenseAdditiveDpfPirServer::CreatePlain(config_, std::move(database0)));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto server1,
+      DenseAdditiveDpfPirServer::CreatePlain(config_, std::move(database1)));
+
+  // Retrieve records 123 and 1000, the latter scaled by 5.
+  PirRequest request0, request1;
+  auto& plain_request0 =
+      *request0.mutable_dpf_pir_request()->mutable_plain_request();
+  auto& plain_request1 =
+      *request1.mutable_dpf_pir_request()->mutable_plain_request();
+  AddKeys(123, 1, plain_request0, plain_request1);
+  AddKeys(1000, 5, plain_request0, plain_request1);
+
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response0,
+                           server0->HandleRequest(request0));
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response1,
+                           server1->HandleRequest(request1));
+  ASSERT_EQ(response0.dpf_pir_response().masked_response_size(), 2);
+  ASSERT_EQ(response1.dpf_pir_response().masked_response_size(), 2);
+  std::vector<std::vector<uint64_t>> results(2);
+  for (int i = 0; i < 2; ++i) {
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<uint64_t> share0,
+        DenseAdditiveDpfPirServer::ParseResponse(
+            response0.dpf_pir_response().masked_response(i)));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<uint64_t> share1,
+        DenseAdditiveDpfPirServer::ParseResponse(
+            response1.dpf_pir_response().masked_response(i)));
+    ASSERT_EQ(share0.size(), kNumColumns);
+    ASSERT_EQ(share1.size(), kNumColumns);
+    for (int j = 0; j < kNumColumns; ++j) {
+      results[i].push_back(share0[j] + share1[j]);
+    }
+  }
+  EXPECT_THAT(results[0], ElementsAreArray(records_[123]));
+  EXPECT_THAT(results[1], ElementsAre(5 * records_[1000][0],
+                                      5 * records_[1000][1],
+                                      5 * records_[1000][2]));
+}
+
+TEST_F(DenseAdditiveDpfPirServerTest, LeaderHelperResponseIsAdditivelyMasked) {
+  DPF_ASSERT_OK_AND_ASSIGN(auto leader_database, CreateDatabase());
+  DPF_ASSERT_OK_AND_ASSIGN(auto helper_database, CreateDatabase());
+
+  // Create the Helper.
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<const crypto::tink::HybridDecrypt> hybrid_decrypt,
+      pir_testing::CreateFakeHybridDecrypt());
+  auto decrypter = [&hybrid_decrypt](absl::string_view ciphertext,
+                                     absl::string_view context_info) {
+    return hybrid_decrypt->Decrypt(ciphertext, context_info);
+  };
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto helper,
+      DenseAdditiveDpfPirServer::CreateHelper(
+          config_, std::move(helper_database), std::move(decrypter)));
+
+  // Create the Leader, forwarding requests directly to the Helper.
+  auto sender = [&helper](const PirRequest& request,
+                          absl::AnyInvocable<void()> while_waiting)
+      -> absl::StatusOr<PirResponse> {
+    while_waiting();
+    return helper->HandleRequest(request);
+  };
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto leader, DenseAdditiveDpfPirServer::CreateLeader(
+                       config_, std::move(leader_database), std::move(sender)));
+
+  // Create the client request.
+  DpfPirRequest::PlainRequest leader_plain_request;
+  DpfPirRequest::HelperRequest helper_request;
+  AddKeys(42, 1, leader_plain_request, *helper_request.mutable_plain_request());
+  DPF_ASSERT_OK_AND_ASSIGN(*helper_request.mutable_one_time_pad_seed(),
+                           Aes128CtrSeededPrng::GenerateSeed());
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<crypto::tink::HybridEncrypt> hybrid_encrypt,
+      pir_testing::CreateFakeHybridEncrypt());
+  PirRequest request;
+  auto& leader_request = *request.mutable_dpf_pir_request()
+                              ->mutable_leader_request();
+  *leader_request.mutable_plain_request() = leader_plain_request;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      *leader_request.mutable_encrypted_helper_request()
+           ->mutable_encrypted_request(),
+      hybrid_encrypt->Encrypt(
+          helper_request.SerializeAsString(),
+          DenseAdditiveDpfPirServer::kEncryptionContextInfo));
+
+  // Handle the request, and remove the one-time-pad by subtraction.
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response,
+                           leader->HandleRequest(request));
+  ASSERT_EQ(response.dpf_pir_response().masked_response_size(), 1);
+  const std::string& masked_response =
+      response.dpf_pir_response().masked_response(0);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto prng,
+      Aes128CtrSeededPrng::Create(helper_request.one_time_pad_seed()));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<uint64_t> pad,
+      DenseAdditiveDpfPirServer::ParseResponse(
+          prng->GetRandomBytes(masked_response.size())));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<uint64_t> result,
+      DenseAdditiveDpfPirServer::ParseResponse(masked_response));
+  ASSERT_EQ(result.size(), kNumColumns);
+  for (int j = 0; j < kNumColumns; ++j) {
+    result[j] -= pad[j];
+  }
+  EXPECT_THAT(result, ElementsAreArray(records_[42]));
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
@@ -0,0 +1,317 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/dense_additive_pir_database.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "dpf/status_macros.h"
+#include "pir/internal/dot_product_hwy.h"
+
+namespace distributed_point_functions {
+
+namespace {
+
+// Minimum number of records processed by a single thread in
+// InnerProductWith(). Below this, the cost of handing work to a worker thread
+// outweighs the gain from parallelization.
+constexpr int64_t kMinRecordsPerThread = 1 << 14;
+
+// Writes `value` to the 8 bytes starting at `bytes` in little-endian order.
+void WriteLittleEndianWord(uint64_t value, char* bytes) {
+  for (int i = 0; i < sizeof(uint64_t); ++i) {
+    bytes[i] = static_cast<char>(value & 0xff);
+    value >>= 8;
+  }
+}
+
+absl::Status CheckHasNotBeenBuilt(bool has_been_built) {
+  if (has_been_built) {
+    return absl::FailedPreconditionError("Database already built");
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+class DenseAdditivePirDatabase::WorkerPool {
+ public:
+  explicit WorkerPool(int num_threads) {
+    threads_.reserve(num_threads);
+    for (int i = 0; i < num_threads; ++i) {
+      threads_.emplace_back([this] { RunTasks(); });
+    }
+  }
+
+  // Runs all scheduled tasks and then joins the worker threads.
+  ~WorkerPool() {
+    {
+      absl::MutexLock lock(&mu_);
+      stopping_ = true;
+    }
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  // Runs `task` on the next idle worker thread.
+  void Schedule(absl::AnyInvocable<void()> task) {
+    absl::MutexLock lock(&mu_);
+    tasks_.push_back(std::move(task));
+  }
+
+ private:
+  bool HasTasksOrStopping() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return !tasks_.empty() || stopping_;
+  }
+
+  void RunTasks() {
+    while (true) {
+      absl::AnyInvocable<void()> task;
+      {
+        absl::MutexLock lock(&mu_);
+        mu_.Await(absl::Condition(this, &WorkerPool::HasTasksOrStopping));
+        if (tasks_.empty()) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  absl::Mutex mu_;
+  std::deque<absl::AnyInvocable<void()>> tasks_ ABSL_GUARDED_BY(mu_);
+  bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+  std::vector<std::thread> threads_;
+};
+
+DenseAdditivePirDatabase::Builder::Builder(std::vector<int> column_bit_sizes)
+    : column_bit_sizes_(std::move(column_bit_sizes)),
+      num_threads_(1),
+      has_been_built_(false) {}
+
+std::unique_ptr<DenseAdditivePirDatabase::Interface::Builder>
+DenseAdditivePirDatabase::Builder::Clone() const {
+  auto result = std::make_unique<Builder>(column_bit_sizes_);
+  result->records_ = records_;
+  result->num_threads_ = num_threads_;
+  result->has_been_built_ = has_been_built_;
+  return result;
+}
+
+DenseAdditivePirDatabase::Builder& DenseAdditivePirDatabase::Builder::Insert(
+    std::vector<uint64_t> values) {
+  records_.push_back(std::move(values));
+  return *this;
+}
+
+DenseAdditivePirDatabase::Builder& DenseAdditivePirDatabase::Builder::Clear() {
+  records_.clear();
+  has_been_built_ = false;
+  return *this;
+}
+
+DenseAdditivePirDatabase::Builder&
+DenseAdditivePirDatabase::Builder::SetNumThreads(int num_threads) {
+  num_threads_ = std::max(num_threads, 1);
+  return *this;
+}
+
+absl::StatusOr<std::unique_ptr<DenseAdditivePirDatabase::Interface>>
+DenseAdditivePirDatabase::Builder::Build() {
+  DPF_RETURN_IF_ERROR(CheckHasNotBeenBuilt(has_been_built_));
+  if (column_bit_sizes_.empty()) {
+    return absl::InvalidArgumentError("At least one column is required");
+  }
+  const int64_t num_records = records_.size();
+  std::vector<Column> columns(column_bit_sizes_.size());
+  for (int i = 0; i < column_bit_sizes_.size(); ++i) {
+    columns[i].bit_size = column_bit_sizes_[i];
+    if (column_bit_sizes_[i] == 32) {
+      columns[i].values32.reserve(num_records);
+    } else if (column_bit_sizes_[i] == 64) {
+      columns[i].values64.reserve(num_records);
+    } else {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Column bit sizes must be 32 or 64, got ",
+                       column_bit_sizes_[i], " for column ", i));
+    }
+  }
+  has_been_built_ = true;
+
+  // Ensures records are freed after returning.
+  std::vector<std::vector<uint64_t>> records = std::move(records_);
+  for (int64_t i = 0; i < num_records; ++i) {
+    if (records[i].size() != columns.size()) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Record ", i, " has ", records[i].size(),
+                       " values, but the database has ", columns.size(),
+                       " columns"));
+    }
+    for (int j = 0; j < columns.size(); ++j) {
+      if (columns[j].bit_size == 64) {
+        columns[j].values64.push_back(records[i][j]);
+        continue;
+      }
+      if (records[i][j] > std::numeric_limits<uint32_t>::max()) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("Value ", records[i][j], " of record ", i,
+                         " does not fit into 32-bit column ", j));
+      }
+      columns[j].values32.push_back(static_cast<uint32_t>(records[i][j]));
+    }
+  }
+  return absl::WrapUnique(new DenseAdditivePirDatabase(
+      std::move(columns), num_records, num_threads_));
+}
+
+DenseAdditivePirDatabase::DenseAdditivePirDatabase(std::vector<Column> columns,
+                                                   int64_t num_records,
+                                                   int num_threads)
+    : columns_(std::move(columns)),
+      num_records_(num_records),
+      num_threads_(num_threads),
+      response_part_sizes_{static_cast<int64_t>(columns_.size() *
+                                                sizeof(uint64_t))} {
+  if (num_threads_ > 1) {
+    workers_ = std::make_unique<WorkerPool>(num_threads_ - 1);
+  }
+}
+
+DenseAdditivePirDatabase::~DenseAdditivePirDatabase() = default;
+
+absl::Status DenseAdditivePirDatabase::InnerProductWithRange(
+    absl::Span<const absl::Span<const BlockType>> selections, int64_t begin,
+    int64_t end, std::vector<ResponseType>& result) const {
+  for (int i = 0; i < selections.size(); ++i) {
+    auto selection = selections[i].subspan(begin, end - begin);
+    for (int j = 0; j < columns_.size(); ++j) {
+      uint64_t dot_product;
+      if (columns_[j].bit_size == 32) {
+        DPF_ASSIGN_OR_RETURN(
+            dot_product,
+            pir_internal::DotProduct(
+                selection, absl::MakeConstSpan(columns_[j].values32)
+                               .subspan(begin, end - begin)));
+      } else {
+        DPF_ASSIGN_OR_RETURN(
+            dot_product,
+            pir_internal::DotProduct(
+                selection, absl::MakeConstSpan(columns_[j].values64)
+                               .subspan(begin, end - begin)));
+      }
+      result[i][j] += dot_product;
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<DenseAdditivePirDatabase::ResponseType>>
+DenseAdditivePirDatabase::InnerProductWithSpans(
+    absl::Span<const absl::Span<const BlockType>> selections) const {
+  // Split the records into contiguous ranges, one per thread. Each thread
+  // accumulates partial dot products, which are summed up at the end.
+  const int64_t num_threads = std::max<int64_t>(
+      1, std::min<int64_t>(num_threads_, num_records_ / kMinRecordsPerThread));
+  const int64_t records_per_thread =
+      (num_records_ + num_threads - 1) / num_threads;
+  std::vector<std::vector<ResponseType>> partial_results(
+      num_threads, std::vector<ResponseType>(
+                       selections.size(), ResponseType(columns_.size(), 0)));
+  std::vector<absl::Status> statuses(num_threads);
+  absl::BlockingCounter pending_ranges(num_threads - 1);
+  for (int64_t t = 1; t < num_threads; ++t) {
+    const int64_t begin = t * records_per_thread;
+    const int64_t end = std::min(begin + records_per_thread, num_records_);
+    workers_->Schedule([&, t, begin, end] {
+      statuses[t] =
+          InnerProductWithRange(selections, begin, end, partial_results[t]);
+      pending_ranges.DecrementCount();
+    });
+  }
+  statuses[0] = InnerProductWithRange(
+      selections, 0, std::min(records_per_thread, num_records_),
+      partial_results[0]);
+  pending_ranges.Wait();
+
+  for (const absl::Status& status : statuses) {
+    DPF_RETURN_IF_ERROR(status);
+  }
+  std::vector<ResponseType> result = std::move(partial_results[0]);
+  for (int64_t t = 1; t < num_threads; ++t) {
+    for (int i = 0; i < selections.size(); ++i) {
+      for (int j = 0; j < columns_.size(); ++j) {
+        result[i][j] += partial_results[t][i][j];
+      }
+    }
+  }
+  return result;
+}
+
+absl::StatusOr<std::vector<DenseAdditivePirDatabase::ResponseType>>
+DenseAdditivePirDatabase::InnerProductWith(
+    absl::Span<const std::vector<BlockType>> selections) const {
+  std::vector<absl::Span<const BlockType>> selection_spans(selections.size());
+  for (int i = 0; i < selections.size(); ++i) {
+    if (selections[i].size() != num_records_) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Selection vector ", i, " has size ",
+                       selections[i].size(), ", expected ", num_records_));
+    }
+    selection_spans[i] = selections[i];
+  }
+  return InnerProductWithSpans(selection_spans);
+}
+
+absl::Status DenseAdditivePirDatabase::InnerProductWithInto(
+    absl::Span<const BlockType> selections, InnerProductOutputs outputs) const {
+  if (selections.size() != outputs.size() * num_records_) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "`selections` has size ", selections.size(), ", expected ",
+        outputs.size() * num_records_));
+  }
+  std::vector<absl::Span<const BlockType>> selection_spans(outputs.size());
+  for (int64_t k = 0; k < outputs.size(); ++k) {
+    selection_spans[k] = selections.subspan(k * num_records_, num_records_);
+  }
+  DPF_ASSIGN_OR_RETURN(std::vector<ResponseType> responses,
+                       InnerProductWithSpans(selection_spans));
+  for (int64_t k = 0; k < outputs.size(); ++k) {
+    for (int j = 0; j < responses[k].size(); ++j) {
+      WriteLittleEndianWord(responses[k][j],
+                            outputs[k] + j * sizeof(uint64_t));
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace distributed_point_functions
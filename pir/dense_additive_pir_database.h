@@ -0,0 +1,157 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_DENSE_ADDITIVE_PIR_DATABASE_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_DENSE_ADDITIVE_PIR_DATABASE_H_
+
+#include <stddef.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "pir/pir_database_interface.h"
+
+namespace distributed_point_functions {
+
+// This database class is intended to be used with additive DPF PIR over a
+// dense key space, where keys are integers in the space [0, .size()). Each
+// record is a row of unsigned integers, one per column, and the database is
+// stored column by column. Each column holds either 32-bit or 64-bit values.
+//
+// Instead of XOR-selecting records, `InnerProductWith` computes for every
+// column the dot product modulo 2^64 between the column and a selection vector
+// holding one additive share (as a `uint64_t`) per record. When the selection
+// vectors of two servers are additive shares of a weight vector w, the two
+// responses are additive shares of sum_i w[i] * record_i, which allows private
+// retrieval as well as private weighted sums over the database.
+class DenseAdditivePirDatabase
+    : public PirDatabaseInterface<uint64_t, std::vector<uint64_t>> {
+ public:
+  using Interface = PirDatabaseInterface;
+
+  // The concrete Builder for DenseAdditivePirDatabase.
+  class Builder : public PirDatabaseInterface::Builder {
+   public:
+    // Creates a builder for a database with `column_bit_sizes.size()` columns,
+    // where the i-th column stores `column_bit_sizes[i]`-bit values. Each bit
+    // size must be either 32 or 64; this is checked in Build().
+    explicit Builder(std::vector<int> column_bit_sizes);
+    // Appends a record `values` at the end of the database. `values` must
+    // contain exactly one value per column, and each value must fit into the
+    // bit size of its column. This is checked in Build().
+    Builder& Insert(std::vector<uint64_t> values) override;
+    // Clears all elements inserted into this builder, but leaves any other
+    // configuration intact.
+    Builder& Clear() override;
+    // Returns a copy of this builder.
+    std::unique_ptr<PirDatabaseInterface::Builder> Clone() const override;
+    // Sets the number of threads used by InnerProductWith() of the built
+    // database. Values smaller than 1 are treated as 1. Defaults to 1.
+    Builder& SetNumThreads(int num_threads);
+    // Builds the database and invalidated the builder. All subsequent calls to
+    // Build() will fail with FAILED_PRECONDITION.
+    absl::StatusOr<std::unique_ptr<PirDatabaseInterface>> Build() override;
+
+   private:
+    std::vector<int> column_bit_sizes_;
+    std::vector<std::vector<uint64_t>> records_;
+    int num_threads_;
+    bool has_been_built_;
+  };
+
+  // Returns the number of records contained in the database.
+  size_t size() const override { return num_records_; }
+
+  // Additive PIR uses one selection element (not bit) per record.
+  size_t num_selection_bits() const override { return size(); }
+
+  // Returns the number of columns of each record.
+  int num_columns() const { return static_cast<int>(columns_.size()); }
+
+  // Returns the bit size of the given `column`.
+  int column_bit_size(int column) const { return columns_[column].bit_size; }
+
+  ~DenseAdditivePirDatabase() override;
+
+  // Returns the number of threads used by InnerProductWith().
+  int num_threads() const { return num_threads_; }
+
+  // Returns, for each selection vector, the vector of dot products modulo 2^64
+  // between the selection vector and each column of the database. Returns
+  // INVALID_ARGUMENT if any selection vector does not contain exactly `size()`
+  // elements.
+  absl::StatusOr<std::vector<ResponseType>> InnerProductWith(
+      absl::Span<const std::vector<BlockType>> selections) const override;
+
+  // Each response is a single part holding the dot products with all columns,
+  // serialized as 64-bit little-endian words.
+  absl::Span<const int64_t> response_part_sizes() const override {
+    return response_part_sizes_;
+  }
+
+  // As InnerProductWith, but reads the selection vectors back to back from
+  // `selections`, and writes the serialized response to each selection vector
+  // to `outputs`. Returns INVALID_ARGUMENT if `selections` does not contain
+  // exactly `size()` elements per output.
+  absl::Status InnerProductWithInto(absl::Span<const BlockType> selections,
+                                    InnerProductOutputs outputs) const override;
+
+ private:
+  // A single column of the database. Exactly one of `values32` and `values64`
+  // is used, depending on `bit_size`.
+  struct Column {
+    int bit_size;
+    std::vector<uint32_t> values32;
+    std::vector<uint64_t> values64;
+  };
+
+  // Constructs a DenseAdditivePirDatabase object.
+  DenseAdditivePirDatabase(std::vector<Column> columns, int64_t num_records,
+                           int num_threads);
+
+  // Computes the dot products of all `selections` with all columns, splitting
+  // the records among the worker threads. Each selection must contain exactly
+  // `size()` elements.
+  absl::StatusOr<std::vector<ResponseType>> InnerProductWithSpans(
+      absl::Span<const absl::Span<const BlockType>> selections) const;
+
+  // Computes the dot products of all `selections` with all columns, restricted
+  // to the records in [begin, end), and adds them to `result`.
+  absl::Status InnerProductWithRange(
+      absl::Span<const absl::Span<const BlockType>> selections, int64_t begin,
+      int64_t end, std::vector<ResponseType>& result) const;
+
+  // A fixed set of worker threads running tasks from a queue. Defined in the
+  // .cc file.
+  class WorkerPool;
+
+  std::vector<Column> columns_;
+  int64_t num_records_;
+  int num_threads_;
+  std::vector<int64_t> response_part_sizes_;
+  // Runs the ranges of InnerProductWith() not handled by the calling thread.
+  // Holds `num_threads_ - 1` threads that live as long as the database, and is
+  // null if `num_threads_` is 1.
+  std::unique_ptr<WorkerPool> workers_;
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_DENSE_ADDITIVE_PIR_DATABASE_H_
@@ -0,0 +1,100 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "benchmark/benchmark.h"  // third_party/benchmark
+#include "dpf/internal/memory_counters.h"
+#include "dpf/internal/status_matchers.h"
+#include "pir/dense_additive_pir_database.h"
+
+namespace distributed_point_functions {
+namespace {
+
+void BM_AdditiveInnerProduct(benchmark::State& state) {
+  int num_records = state.range(0);
+  int num_columns = state.range(1);
+  int column_bit_size = state.range(2);
+  int num_threads = state.range(3);
+  int batch_size = state.range(4);
+
+  // Insert random records into the database.
+  absl::BitGen gen;
+  DenseAdditivePirDatabase::Builder builder(
+      std::vector<int>(num_columns, column_bit_size));
+  builder.SetNumThreads(num_threads);
+  for (int i = 0; i < num_records; ++i) {
+    std::vector<uint64_t> record(num_columns);
+    for (uint64_t& value : record) {
+      value = column_bit_size == 32 ? absl::Uniform<uint32_t>(gen)
+                                    : absl::Uniform<uint64_t>(gen);
+    }
+    builder.Insert(std::move(record));
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(auto database, builder.Build());
+
+  // Random additive selection shares.
+  std::vector<std::vector<uint64_t>> selections(
+      batch_size, std::vector<uint64_t>(num_records));
+  for (auto& selection : selections) {
+    for (uint64_t& share : selection) {
+      share = absl::Uniform<uint64_t>(gen);
+    }
+  }
+
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto _ : state) {
+    auto result = database->InnerProductWith(selections);
+    benchmark::DoNotOptimize(result);
+  }
+  const int64_t bytes_per_record =
+      sizeof(uint64_t) + num_columns * column_bit_size / 8;
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          batch_size * num_records * bytes_per_record);
+}
+
+BENCHMARK(BM_AdditiveInnerProduct)
+    ->ArgNames({"records", "columns", "bits", "threads", "batch"})
+    ->ArgsProduct({{1 << 16, 1 << 20, 1 << 22},
+                   {1, 4},
+                   {32, 64},
+                   {1, 2, 4, 8},
+                   {1, 8}})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace distributed_point_functions
+
+// Declare benchmark_filter flag, which will be defined by benchmark library.
+// Use it to check if any benchmarks were specified explicitly.
+//
+namespace benchmark {
+extern std::string FLAGS_benchmark_filter;
+}
+using benchmark::FLAGS_benchmark_filter;
+
+int main(int argc, char* argv[]) {
+  FLAGS_benchmark_filter = "";
+  benchmark::Initialize(&argc, argv);
+  if (!FLAGS_benchmark_filter.empty()) {
+    benchmark::RunSpecifiedBenchmarks();
+  }
+  benchmark::Shutdown();
+  return 0;
+}
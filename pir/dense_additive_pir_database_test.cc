@@ -0,0 +1,250 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/dense_additive_pir_database.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::IsOkAndHolds;
+using dpf_internal::StatusIs;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+using InterfacePtr = std::unique_ptr<DenseAdditivePirDatabase::Interface>;
+
+constexpr int kNumRecords = 300;
+
+TEST(DenseAdditivePirDatabaseBuilder, BuildFailsWithoutColumns) {
+  EXPECT_THAT(DenseAdditivePirDatabase::Builder({}).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("At least one column")));
+}
+
+TEST(DenseAdditivePirDatabaseBuilder, BuildFailsWithInvalidColumnBitSize) {
+  EXPECT_THAT(DenseAdditivePirDatabase::Builder({64, 16}).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("must be 32 or 64")));
+}
+
+TEST(DenseAdditivePirDatabaseBuilder, BuildFailsWithWrongRecordSize) {
+  DenseAdditivePirDatabase::Builder builder({32, 64});
+  builder.Insert({1, 2}).Insert({3});
+  EXPECT_THAT(builder.Build(), StatusIs(absl::StatusCode::kInvalidArgument,
+                                        HasSubstr("Record 1 has 1 values")));
+}
+
+TEST(DenseAdditivePirDatabaseBuilder, BuildFailsWithValueTooLargeForColumn) {
+  DenseAdditivePirDatabase::Builder builder({64, 32});
+  builder.Insert({uint64_t{1} << 40, uint64_t{1} << 32});
+  EXPECT_THAT(builder.Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("does not fit into 32-bit column 1")));
+}
+
+TEST(DenseAdditivePirDatabaseBuilder, BuildFailsWhenCalledTwice) {
+  DenseAdditivePirDatabase::Builder builder({64});
+  DPF_ASSERT_OK(builder.Build());
+  EXPECT_THAT(builder.Build(),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST(DenseAdditivePirDatabaseBuilder, ClonedBuilderBuildsSameDatabase) {
+  DenseAdditivePirDatabase::Builder builder({32, 64});
+  builder.SetNumThreads(4).Insert({1, 2}).Insert({3, 4});
+  std::unique_ptr<DenseAdditivePirDatabase::Interface::Builder> clone =
+      builder.Clone();
+
+  DPF_ASSERT_OK_AND_ASSIGN(InterfacePtr database1, builder.Build());
+  DPF_ASSERT_OK_AND_ASSIGN(InterfacePtr database2, clone->Build());
+  auto* additive_database2 =
+      dynamic_cast<DenseAdditivePirDatabase*>(database2.get());
+  ASSERT_NE(additive_database2, nullptr);
+  EXPECT_EQ(additive_database2->num_threads(), 4);
+  EXPECT_EQ(additive_database2->column_bit_size(0), 32);
+  EXPECT_EQ(additive_database2->column_bit_size(1), 64);
+
+  std::vector<std::vector<uint64_t>> selections = {{5, 7}};
+  DPF_ASSERT_OK_AND_ASSIGN(auto result1,
+                           database1->InnerProductWith(selections));
+  DPF_ASSERT_OK_AND_ASSIGN(auto result2,
+                           database2->InnerProductWith(selections));
+  EXPECT_EQ(result1, result2);
+  EXPECT_THAT(result1, ElementsAre(ElementsAre(5 * 1 + 7 * 3, 5 * 2 + 7 * 4)));
+}
+
+TEST(DenseAdditivePirDatabaseBuilder, ClearedBuilderBuildsEmptyDatabase) {
+  DenseAdditivePirDatabase::Builder builder({64});
+  builder.Insert({1}).Clear();
+  DPF_ASSERT_OK_AND_ASSIGN(InterfacePtr database, builder.Build());
+  EXPECT_EQ(database->size(), 0);
+}
+
+TEST(DenseAdditivePirDatabase, InnerProductFailsWithWrongSelectionSize) {
+  DenseAdditivePirDatabase::Builder builder({64});
+  builder.Insert({1}).Insert({2});
+  DPF_ASSERT_OK_AND_ASSIGN(InterfacePtr database, builder.Build());
+  std::vector<std::vector<uint64_t>> selections = {{1, 2}, {1, 2, 3}};
+  EXPECT_THAT(database->InnerProductWith(selections),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Selection vector 1 has size 3")));
+}
+
+TEST(DenseAdditivePirDatabase, InnerProductWithNoSelectionsIsEmpty) {
+  DenseAdditivePirDatabase::Builder builder({64});
+  builder.Insert({1});
+  DPF_ASSERT_OK_AND_ASSIGN(InterfacePtr database, builder.Build());
+  EXPECT_THAT(database->InnerProductWith({}), IsOkAndHolds(IsEmpty()));
+}
+
+class DenseAdditivePirDatabaseTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(DenseAdditivePirDatabaseTest, InnerProductOfSharesSumsWeightedRecords) {
+  const int num_threads = GetParam();
+  // Use enough records to actually spread the work across threads.
+  const int num_records = num_threads == 1 ? kNumRecords : 100000;
+  absl::BitGen gen;
+  DenseAdditivePirDatabase::Builder builder({32, 64, 32});
+  builder.SetNumThreads(num_threads);
+  std::vector<std::vector<uint64_t>> records(num_records);
+  for (auto& record : records) {
+    record = {absl::Uniform<uint32_t>(gen), absl::Uniform<uint64_t>(gen),
+              absl::Uniform<uint32_t>(gen)};
+    builder.Insert(record);
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(InterfacePtr database, builder.Build());
+  ASSERT_EQ(database->size(), num_records);
+  ASSERT_EQ(database->num_selection_bits(), num_records);
+
+  // Split a sparse weight vector into two additive shares.
+  std::vector<uint64_t> weights(num_records, 0);
+  weights[0] = 1;
+  weights[num_records / 2] = 42;
+  weights[num_records - 1] = -1;
+  std::vector<std::vector<uint64_t>> shares0(1), shares1(1);
+  for (int i = 0; i < num_records; ++i) {
+    shares0[0].push_back(absl::Uniform<uint64_t>(gen));
+    shares1[0].push_back(weights[i] - shares0[0].back());
+  }
+
+  DPF_ASSERT_OK_AND_ASSIGN(auto result0, database->InnerProductWith(shares0));
+  DPF_ASSERT_OK_AND_ASSIGN(auto result1, database->InnerProductWith(shares1));
+  ASSERT_EQ(result0.size(), 1);
+  ASSERT_EQ(result1.size(), 1);
+  for (int j = 0; j < 3; ++j) {
+    uint64_t expected = records[0][j] + 42 * records[num_records / 2][j] -
+                        records[num_records - 1][j];
+    EXPECT_EQ(result0[0][j] + result1[0][j], expected);
+  }
+}
+
+TEST_P(DenseAdditivePirDatabaseTest, ConcurrentCallsReturnTheSameResult) {
+  const int num_threads = GetParam();
+  const int num_records = 100000;
+  absl::BitGen gen;
+  DenseAdditivePirDatabase::Builder builder({64});
+  builder.SetNumThreads(num_threads);
+  std::vector<std::vector<uint64_t>> selections(1);
+  for (int i = 0; i < num_records; ++i) {
+    builder.Insert({absl::Uniform<uint64_t>(gen)});
+    selections[0].push_back(absl::Uniform<uint64_t>(gen));
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(InterfacePtr database, builder.Build());
+  DPF_ASSERT_OK_AND_ASSIGN(auto expected,
+                           database->InnerProductWith(selections));
+
+  // Calls from several threads share the database's worker threads.
+  constexpr int kNumCallers = 4;
+  std::vector<absl::StatusOr<std::vector<std::vector<uint64_t>>>> results(
+      kNumCallers);
+  std::vector<std::thread> callers;
+  for (int i = 0; i < kNumCallers; ++i) {
+    callers.emplace_back(
+        [&, i] { results[i] = database->InnerProductWith(selections); });
+  }
+  for (std::thread& caller : callers) {
+    caller.join();
+  }
+  for (const auto& result : results) {
+    EXPECT_THAT(result, IsOkAndHolds(expected));
+  }
+}
+
+TEST_P(DenseAdditivePirDatabaseTest,
+       InnerProductWithIntoMatchesInnerProductWith) {
+  const int num_threads = GetParam();
+  const int num_records = 100000;
+  constexpr int kNumSelections = 3;
+  absl::BitGen gen;
+  DenseAdditivePirDatabase::Builder builder({32, 64});
+  builder.SetNumThreads(num_threads);
+  std::vector<std::vector<uint64_t>> selections(kNumSelections);
+  std::vector<uint64_t> flat_selections;
+  for (int i = 0; i < num_records; ++i) {
+    builder.Insert(
+        {absl::Uniform<uint32_t>(gen), absl::Uniform<uint64_t>(gen)});
+  }
+  for (std::vector<uint64_t>& selection : selections) {
+    for (int i = 0; i < num_records; ++i) {
+      selection.push_back(absl::Uniform<uint64_t>(gen));
+    }
+    flat_selections.insert(flat_selections.end(), selection.begin(),
+                           selection.end());
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(InterfacePtr database, builder.Build());
+  DPF_ASSERT_OK_AND_ASSIGN(auto expected,
+                           database->InnerProductWith(selections));
+  ASSERT_THAT(database->response_part_sizes(), ElementsAre(16));
+
+  const int64_t stride = AlignInnerProductOutputSize(16);
+  std::vector<char> buffer(kNumSelections * stride +
+                           kInnerProductOutputAlignment - 1);
+  char* const data = reinterpret_cast<char*>(AlignInnerProductOutputSize(
+      reinterpret_cast<uintptr_t>(buffer.data())));
+  InnerProductOutputs outputs(data, kNumSelections, stride);
+  DPF_ASSERT_OK(database->InnerProductWithInto(flat_selections, outputs));
+  for (int k = 0; k < kNumSelections; ++k) {
+    for (int j = 0; j < 2; ++j) {
+      uint64_t value = 0;
+      for (int b = sizeof(uint64_t) - 1; b >= 0; --b) {
+        value = (value << 8) |
+                static_cast<uint8_t>(outputs[k][j * sizeof(uint64_t) + b]);
+      }
+      EXPECT_EQ(value, expected[k][j]);
+    }
+  }
+
+  flat_selections.pop_back();
+  EXPECT_THAT(database->InnerProductWithInto(flat_selections, outputs),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`selections` has size")));
+}
+
+INSTANTIATE_TEST_SUITE_P(NumThreads, DenseAdditivePirDatabaseTest,
+                         ::testing::Values(1, 2, 4));
+
+}  // namespace
+}  // namespace distributed_point_functions
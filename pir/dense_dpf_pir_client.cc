@@ -14,6 +14,7 @@
 
 #include "pir/dense_dpf_pir_client.h"
 
+#include <algorithm>
 #include <cmath>
 #include <memory>
 #include <new>
@@ -27,25 +28,31 @@
 #include "absl/numeric/int128.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "dpf/distributed_point_function.h"
 #include "dpf/distributed_point_function.pb.h"
 #include "dpf/status_macros.h"
+#include "pir/dense_dpf_pir_key_pool.h"
 #include "pir/dense_dpf_pir_server.h"
 #include "pir/dpf_pir_client.h"
 #include "pir/private_information_retrieval.pb.h"
 #include "pir/prng/aes_128_ctr_seeded_prng.h"
+#include "pir/record_compression.h"
 
 namespace distributed_point_functions {
 
 DenseDpfPirClient::DenseDpfPirClient(
     std::unique_ptr<DistributedPointFunction> dpf,
     EncryptHelperRequestFn encrypter, std::string encryption_context_info,
-    int database_size)
+    int64_t database_size, int64_t records_per_row,
+    std::unique_ptr<RecordCompressor> compressor)
     : DpfPirClient(std::move(encrypter), std::move(encryption_context_info)),
       dpf_(std::move(dpf)),
-      database_size_(database_size) {}
+      database_size_(database_size),
+      records_per_row_(records_per_row),
+      compressor_(std::move(compressor)) {}
 
 absl::StatusOr<std::unique_ptr<DenseDpfPirClient>> DenseDpfPirClient::Create(
     const PirConfig& config, EncryptHelperRequestFn encrypter,
@@ -57,28 +64,39 @@ absl::StatusOr<std::unique_ptr<DenseDpfPirClient>> DenseDpfPirClient::Create(
   if (config.dense_dpf_pir_config().num_elements() <= 0) {
     return absl::InvalidArgumentError("`num_elements` must be positive");
   }
+  if (config.dense_dpf_pir_config().records_per_row() < 0) {
+    return absl::InvalidArgumentError("`records_per_row` must not be negative");
+  }
   if (encrypter == nullptr) {
     return absl::InvalidArgumentError("`encrypter` must not be null");
   }
 
   DpfParameters parameters;
-  parameters.set_log_domain_size(static_cast<int>(
-      std::ceil(std::log2(config.dense_dpf_pir_config().num_elements()))));
+  parameters.set_log_domain_size(static_cast<int>(std::ceil(
+      std::log2(DenseDpfPirServer::NumRows(config.dense_dpf_pir_config())))));
   parameters.mutable_value_type()->mutable_xor_wrapper()->set_bitsize(
       kBitsPerBlock);
   DPF_ASSIGN_OR_RETURN(auto dpf, DistributedPointFunction::Create(parameters));
+  std::unique_ptr<RecordCompressor> compressor;
+  if (config.dense_dpf_pir_config().has_record_compression()) {
+    DPF_ASSIGN_OR_RETURN(
+        compressor, RecordCompressor::Create(
+                        config.dense_dpf_pir_config().record_compression()));
+  }
 
-  return absl::WrapUnique(
-      new DenseDpfPirClient(std::move(dpf), std::move(encrypter),
-                            std::string(encryption_context_info),
-                            config.dense_dpf_pir_config().num_elements()));
+  return absl::WrapUnique(new DenseDpfPirClient(
+      std::move(dpf), std::move(encrypter),
+      std::string(encryption_context_info),
+      config.dense_dpf_pir_config().num_elements(),
+      std::max<int64_t>(config.dense_dpf_pir_config().records_per_row(), 1),
+      std::move(compressor)));
 }
 
 absl::StatusOr<std::tuple<DpfPirRequest::PlainRequest,
                           DpfPirRequest::HelperRequest, PirRequestClientState>>
 DenseDpfPirClient::CreatePlainRequests(
-    absl::Span<const int> query_indices) const {
-  for (const int query : query_indices) {
+    absl::Span<const int64_t> query_indices) const {
+  for (const int64_t query : query_indices) {
     if (query < 0) {
       return absl::InvalidArgumentError(
           "All `query_indices` must be non-negative");
@@ -88,18 +106,38 @@ DenseDpfPirClient::CreatePlainRequests(
     }
   }
 
-  // Generate plain requests for each index.
+  // Generate plain requests for each index. With a matrix layout, the DPF
+  // selects the row containing the index.
   DpfPirRequest::PlainRequest leader_request;
   DpfPirRequest::HelperRequest helper_request;
-  for (int i = 0; i < query_indices.size(); ++i) {
-    absl::uint128 alpha = query_indices[i] / kBitsPerBlock;
-    XorWrapper<absl::uint128> beta(absl::uint128{1}
-                                   << (query_indices[i] % kBitsPerBlock));
-    DPF_ASSIGN_OR_RETURN(std::tie(*(leader_request.mutable_dpf_key()->Add()),
-                                  *(helper_request.mutable_plain_request()
-                                        ->mutable_dpf_key()
-                                        ->Add())),
-                         dpf_->GenerateKeys(alpha, beta));
+  if (key_pool_ != nullptr) {
+    // Use pooled keys for random rows, and let the servers shift them to the
+    // queried rows.
+    DPF_ASSIGN_OR_RETURN(std::vector<DenseDpfPirKeyPool::KeyPair> key_pairs,
+                         key_pool_->Take(query_indices.size()));
+    const int64_t num_rows = key_pool_->num_rows();
+    for (int i = 0; i < query_indices.size(); ++i) {
+      const int64_t row = query_indices[i] / records_per_row_;
+      const int64_t shift = (row - key_pairs[i].row + num_rows) % num_rows;
+      *(leader_request.add_dpf_key()) = std::move(key_pairs[i].leader_key);
+      leader_request.add_index_shifts(shift);
+      *(helper_request.mutable_plain_request()->add_dpf_key()) =
+          std::move(key_pairs[i].helper_key);
+      helper_request.mutable_plain_request()->add_index_shifts(shift);
+    }
+  } else {
+    for (int i = 0; i < query_indices.size(); ++i) {
+      const int64_t row = query_indices[i] / records_per_row_;
+      absl::uint128 alpha = row / kBitsPerBlock;
+      XorWrapper<absl::uint128> beta(absl::uint128{1}
+                                     << (row % kBitsPerBlock));
+      DPF_ASSIGN_OR_RETURN(
+          std::tie(*(leader_request.mutable_dpf_key()->Add()),
+                   *(helper_request.mutable_plain_request()
+                         ->mutable_dpf_key()
+                         ->Add())),
+          dpf_->GenerateKeys(alpha, beta));
+    }
   }
 
   // Generate OTP seed.
@@ -110,10 +148,62 @@ DenseDpfPirClient::CreatePlainRequests(
   PirRequestClientState client_state;
   client_state.mutable_dense_dpf_pir_request_client_state()
       ->set_one_time_pad_seed(helper_request.one_time_pad_seed());
+  if (records_per_row_ > 1) {
+    for (const int64_t query : query_indices) {
+      client_state.mutable_dense_dpf_pir_request_client_state()
+          ->add_column_indices(query % records_per_row_);
+    }
+  }
   return std::make_tuple(std::move(leader_request), std::move(helper_request),
                          std::move(client_state));
 }
 
+absl::StatusOr<std::pair<PirRequest, PirRequestClientState>>
+DenseDpfPirClient::CreateProjectedRequest(
+    absl::Span<const int64_t> query_indices,
+    absl::Span<const int> columns) const {
+  if (columns.empty()) {
+    return absl::InvalidArgumentError("`columns` must not be empty");
+  }
+  for (const int column : columns) {
+    if (column < 0) {
+      return absl::InvalidArgumentError("All `columns` must be non-negative");
+    }
+  }
+  if (records_per_row_ > 1 || compressor_ != nullptr) {
+    return absl::InvalidArgumentError(
+        "Column projection is not supported with a matrix layout or record "
+        "compression");
+  }
+
+  DpfPirRequest::PlainRequest leader_request;
+  DpfPirRequest::HelperRequest helper_request;
+  PirRequestClientState client_state;
+  DPF_ASSIGN_OR_RETURN(
+      std::tie(leader_request, helper_request, client_state),
+      CreatePlainRequests(query_indices));
+  for (const int column : columns) {
+    leader_request.add_projected_columns(column);
+    helper_request.mutable_plain_request()->add_projected_columns(column);
+  }
+  DPF_ASSIGN_OR_RETURN(PirRequest request,
+                       PlainRequestsToLeaderRequest(std::move(leader_request),
+                                                    std::move(helper_request)));
+  return std::make_pair(std::move(request), std::move(client_state));
+}
+
+absl::Status DenseDpfPirClient::SetKeyPool(
+    std::shared_ptr<DenseDpfPirKeyPool> key_pool) {
+  if (key_pool != nullptr &&
+      key_pool->num_rows() !=
+          (database_size_ + records_per_row_ - 1) / records_per_row_) {
+    return absl::InvalidArgumentError(
+        "`key_pool` does not match the number of rows of the config");
+  }
+  key_pool_ = std::move(key_pool);
+  return absl::OkStatus();
+}
+
 absl::StatusOr<std::vector<std::string>> DenseDpfPirClient::HandleResponse(
     const PirResponse& pir_response,
     const PirRequestClientState& request_client_state) const {
@@ -141,6 +231,15 @@ absl::StatusOr<std::vector<std::string>> DenseDpfPirClient::HandleResponse(
       auto prng, Aes128CtrSeededPrng::Create(
                      request_client_state.dense_dpf_pir_request_client_state()
                          .one_time_pad_seed()));
+  const auto& column_indices =
+      request_client_state.dense_dpf_pir_request_client_state()
+          .column_indices();
+  if (records_per_row_ > 1 &&
+      column_indices.size() !=
+          pir_response.dpf_pir_response().masked_response_size()) {
+    return absl::InvalidArgumentError(
+        "Number of `column_indices` does not match the number of responses");
+  }
   std::vector<std::string> result(
       pir_response.dpf_pir_response().masked_response_size());
   for (int i = 0; i < result.size(); ++i) {
@@ -149,8 +248,36 @@ absl::StatusOr<std::vector<std::string>> DenseDpfPirClient::HandleResponse(
     for (int j = 0; j < result[i].size(); ++j) {
       result[i][j] ^= mask[j];
     }
+    if (records_per_row_ > 1) {
+      // Extract the queried record from the row.
+      if (result[i].size() % records_per_row_ != 0) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "Response size (=", result[i].size(),
+            ") is not a multiple of `records_per_row` (=", records_per_row_,
+            ")"));
+      }
+      if (column_indices[i] < 0 || column_indices[i] >= records_per_row_) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("`column_indices` out of bounds at index ", i));
+      }
+      const int record_size = result[i].size() / records_per_row_;
+      result[i] =
+          result[i].substr(column_indices[i] * record_size, record_size);
+    }
+    if (compressor_ != nullptr) {
+      DPF_ASSIGN_OR_RETURN(result[i], compressor_->Decompress(result[i]));
+    }
   }
   return result;
 }
 
+absl::StatusOr<std::vector<std::string>>
+DenseDpfPirClient::HandleResponseChunks(
+    absl::Span<const PirResponse> chunks,
+    const PirRequestClientState& request_client_state) const {
+  DPF_ASSIGN_OR_RETURN(PirResponse response,
+                       DpfPirServer::AssembleResponseChunks(chunks));
+  return HandleResponse(response, request_client_state);
+}
+
 }  // namespace distributed_point_functions
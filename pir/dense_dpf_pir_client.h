@@ -17,6 +17,7 @@
 #ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_DENSE_DPF_PIR_CLIENT_H_
 #define DISTRIBUTED_POINT_FUNCTIONS_PIR_DENSE_DPF_PIR_CLIENT_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -24,18 +25,21 @@
 #include <vector>
 
 #include "absl/numeric/int128.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "dpf/distributed_point_function.h"
+#include "pir/dense_dpf_pir_key_pool.h"
 #include "pir/dense_dpf_pir_server.h"
 #include "pir/dpf_pir_client.h"
 #include "pir/private_information_retrieval.pb.h"
+#include "pir/record_compression.h"
 
 namespace distributed_point_functions {
 
 class DenseDpfPirClient
-    : public DpfPirClient<absl::Span<const int>, std::vector<std::string>> {
+    : public DpfPirClient<absl::Span<const int64_t>, std::vector<std::string>> {
  public:
   // Creates a new DenseDpfPirClient instance with the given PirConfig and
   // an `encrypter` function that should wrap around an implementation of
@@ -60,28 +64,68 @@ class DenseDpfPirClient
   virtual absl::StatusOr<
       std::tuple<DpfPirRequest::PlainRequest, DpfPirRequest::HelperRequest,
                  PirRequestClientState>>
-  CreatePlainRequests(absl::Span<const int> query_indices) const override;
+  CreatePlainRequests(absl::Span<const int64_t> query_indices) const override;
+
+  // As CreateRequest, but asks the servers to return only the given `columns`
+  // of each queried record, which requires a columnar database on the servers
+  // (see ColumnarDenseDpfPirDatabase). The servers learn `columns`, but not
+  // `query_indices`. HandleResponse then returns one value per query index and
+  // column, where the value for `query_indices[i]` and `columns[j]` is at index
+  // `i * columns.size() + j`.
+  //
+  // Returns INVALID_ARGUMENT if `columns` is empty or contains negative values,
+  // or if the config specifies a matrix layout or record compression.
+  absl::StatusOr<std::pair<PirRequest, PirRequestClientState>>
+  CreateProjectedRequest(absl::Span<const int64_t> query_indices,
+                         absl::Span<const int> columns) const;
+
+  // Takes the DPF keys of all subsequent requests from `key_pool`, which moves
+  // key generation off the critical path. The requests then carry the public
+  // `index_shifts` from the pooled keys' random rows to the queried rows, which
+  // are supported by DenseDpfPirServer. Passing NULL generates keys on demand
+  // again.
+  //
+  // Returns INVALID_ARGUMENT if `key_pool` was created for a different number
+  // of rows than this client's config.
+  absl::Status SetKeyPool(std::shared_ptr<DenseDpfPirKeyPool> key_pool);
 
   // Handles the server's `pir_response`. `request_client_state` is the
   // per-request client state corresponding to the request sent to the server.
   //
   // For each query index passed to the corresponding `CreateRequest` call,
   // returns the database value at that index. The returned values will be
-  // padded with null bytes to the size of the largest database entry. Returns
+  // padded with null bytes to the size of the largest database entry. If the
+  // config specifies a matrix layout, the value is extracted from the row
+  // returned by the server. If the config specifies record compression, the
+  // value is decompressed and returned without padding. Returns
   // INVALID_ARGUMENT if either the response or the client state is invalid.
   virtual absl::StatusOr<std::vector<std::string>> HandleResponse(
       const PirResponse& pir_response,
       const PirRequestClientState& request_client_state) const override;
 
+  // As HandleResponse, but takes the chunks of a response streamed by
+  // DpfPirServer::HandleRequestChunked, in the order they were produced.
+  // Returns INVALID_ARGUMENT if the chunks do not form a complete response.
+  absl::StatusOr<std::vector<std::string>> HandleResponseChunks(
+      absl::Span<const PirResponse> chunks,
+      const PirRequestClientState& request_client_state) const;
+
  private:
   static constexpr int kBitsPerBlock = 8 * sizeof(absl::uint128);
 
   DenseDpfPirClient(std::unique_ptr<DistributedPointFunction> dpf,
                     EncryptHelperRequestFn encrypter,
-                    std::string encryption_context_info, int database_size);
+                    std::string encryption_context_info, int64_t database_size,
+                    int64_t records_per_row,
+                    std::unique_ptr<RecordCompressor> compressor);
 
   std::unique_ptr<DistributedPointFunction> dpf_;
-  int database_size_;
+  int64_t database_size_;
+  int64_t records_per_row_;
+  // Null if records are not compressed.
+  std::unique_ptr<RecordCompressor> compressor_;
+  // Null if keys are generated on demand.
+  std::shared_ptr<DenseDpfPirKeyPool> key_pool_;
 };
 
 }  // namespace distributed_point_functions
@@ -0,0 +1,142 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/random/random.h"
+#include "absl/strings/string_view.h"
+#include "benchmark/benchmark.h"  // third_party/benchmark
+#include "dpf/internal/memory_counters.h"
+#include "dpf/internal/status_matchers.h"
+#include "pir/dense_dpf_pir_client.h"
+#include "pir/dense_dpf_pir_key_pool.h"
+#include "pir/private_information_retrieval.pb.h"
+#include "pir/testing/encrypt_decrypt.h"
+
+ABSL_FLAG(int, num_indices_per_request, 1,
+          "The number of query indices in each PIR request.");
+
+namespace distributed_point_functions {
+namespace {
+
+// Benchmarks `CreateRequest()` for a database with `2^state.range(0)` records.
+// The databases are never built, so this covers domains beyond 2^32 records.
+void BM_CreateRequest(benchmark::State& state) {
+  const int64_t num_records = int64_t{1} << state.range(0);
+  const int num_indices_per_request =
+      absl::GetFlag(FLAGS_num_indices_per_request);
+
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(num_records);
+  DPF_ASSERT_OK_AND_ASSIGN(auto hybrid_encrypt,
+                           pir_testing::CreateFakeHybridEncrypt());
+  auto encrypter = [&hybrid_encrypt](absl::string_view plain_pir_request,
+                                     absl::string_view context_info) {
+    return hybrid_encrypt->Encrypt(plain_pir_request, context_info);
+  };
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<DenseDpfPirClient> client,
+                           DenseDpfPirClient::Create(config, encrypter));
+  absl::BitGen bitgen;
+
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<int64_t> indices;
+    indices.reserve(num_indices_per_request);
+    for (int i = 0; i < num_indices_per_request; ++i) {
+      indices.push_back(absl::Uniform<int64_t>(bitgen, 0, num_records));
+    }
+    state.ResumeTiming();
+
+    auto request = client->CreateRequest(indices);
+    benchmark::DoNotOptimize(request);
+  }
+}
+BENCHMARK(BM_CreateRequest)
+    ->ArgName("log_num_records")
+    ->DenseRange(20, 40, 4);
+
+// As BM_CreateRequest, but takes the DPF keys from a pre-filled
+// DenseDpfPirKeyPool, so that only the index shifts are computed per request.
+void BM_CreateRequestWithKeyPool(benchmark::State& state) {
+  const int64_t num_records = int64_t{1} << state.range(0);
+  const int num_indices_per_request =
+      absl::GetFlag(FLAGS_num_indices_per_request);
+
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(num_records);
+  DPF_ASSERT_OK_AND_ASSIGN(auto hybrid_encrypt,
+                           pir_testing::CreateFakeHybridEncrypt());
+  auto encrypter = [&hybrid_encrypt](absl::string_view plain_pir_request,
+                                     absl::string_view context_info) {
+    return hybrid_encrypt->Encrypt(plain_pir_request, context_info);
+  };
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<DenseDpfPirClient> client,
+                           DenseDpfPirClient::Create(config, encrypter));
+  DenseDpfPirKeyPool::Options options;
+  options.capacity = 64 * num_indices_per_request;
+  options.refill_threshold = 0;
+  options.refill_in_background = false;
+  DPF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<DenseDpfPirKeyPool> key_pool,
+                           DenseDpfPirKeyPool::Create(config, options));
+  DPF_ASSERT_OK(client->SetKeyPool(key_pool));
+  absl::BitGen bitgen;
+
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    if (key_pool->size() < num_indices_per_request) {
+      DPF_ASSERT_OK(key_pool->Fill());
+    }
+    std::vector<int64_t> indices;
+    indices.reserve(num_indices_per_request);
+    for (int i = 0; i < num_indices_per_request; ++i) {
+      indices.push_back(absl::Uniform<int64_t>(bitgen, 0, num_records));
+    }
+    state.ResumeTiming();
+
+    auto request = client->CreateRequest(indices);
+    benchmark::DoNotOptimize(request);
+  }
+}
+BENCHMARK(BM_CreateRequestWithKeyPool)
+    ->ArgName("log_num_records")
+    ->DenseRange(20, 40, 4);
+
+}  // namespace
+}  // namespace distributed_point_functions
+
+// Declare benchmark_filter flag, which will be defined by benchmark library.
+// Use it to check if any benchmarks were specified explicitly.
+//
+namespace benchmark {
+extern std::string FLAGS_benchmark_filter;
+}
+using benchmark::FLAGS_benchmark_filter;
+
+int main(int argc, char* argv[]) {
+  FLAGS_benchmark_filter = "";
+  benchmark::Initialize(&argc, argv);
+  absl::ParseCommandLine(argc, argv);
+  if (!FLAGS_benchmark_filter.empty()) {
+    benchmark::RunSpecifiedBenchmarks();
+  }
+  benchmark::Shutdown();
+  return 0;
+}
@@ -14,25 +14,38 @@
 
 #include "pir/dense_dpf_pir_client.h"
 
+#include <cmath>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <tuple>
 #include <utility>
 #include <vector>
 
 #include "absl/functional/any_invocable.h"
+#include "absl/numeric/int128.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "absl/types/span.h"
+#include "dpf/distributed_point_function.h"
 #include "dpf/internal/status_matchers.h"
+#include "dpf/xor_wrapper.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "pir/batching_helper_sender.h"
+#include "pir/columnar_dense_dpf_pir_database.h"
 #include "pir/dense_dpf_pir_database.h"
+#include "pir/dense_dpf_pir_key_pool.h"
 #include "pir/dense_dpf_pir_server.h"
 #include "pir/private_information_retrieval.pb.h"
 #include "pir/prng/aes_128_ctr_seeded_prng.h"
+#include "pir/record_compression.h"
 #include "pir/testing/encrypt_decrypt.h"
+#include "pir/testing/in_process_helper_transport.h"
 #include "pir/testing/mock_pir_database.h"
 
 namespace distributed_point_functions {
@@ -154,6 +167,59 @@ TEST_F(DenseDpfPirClientTest, CreateRequestFailsIfIndexIsNegative) {
       StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("negative")));
 }
 
+TEST(DenseDpfPirClient, CreatePlainRequestsSupportsIndicesAbove32Bits) {
+  // The database is too large to be built in a test, so we check the DPF keys
+  // directly instead of running the servers.
+  constexpr int64_t kNumElements = (int64_t{1} << 33) + 5;
+  const std::vector<int64_t> kIndices = {int64_t{1} << 31,
+                                         (int64_t{1} << 32) + 1000,
+                                         kNumElements - 1};
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(kNumElements);
+  DPF_ASSERT_OK_AND_ASSIGN(auto hybrid_encrypt, CreateFakeHybridEncrypt());
+  auto encrypter = [&hybrid_encrypt](absl::string_view plain_pir_request,
+                                     absl::string_view context_info) {
+    return hybrid_encrypt->Encrypt(plain_pir_request, context_info);
+  };
+  DPF_ASSERT_OK_AND_ASSIGN(auto client,
+                           DenseDpfPirClient::Create(config, encrypter));
+
+  EXPECT_THAT(
+      client->CreatePlainRequests({kNumElements}),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("out of bounds")));
+  DpfPirRequest::PlainRequest leader_request;
+  DpfPirRequest::HelperRequest helper_request;
+  PirRequestClientState client_state;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::tie(leader_request, helper_request, client_state),
+      client->CreatePlainRequests(kIndices));
+  ASSERT_EQ(leader_request.dpf_key_size(), kIndices.size());
+
+  constexpr int kBitsPerBlock = 128;
+  DpfParameters parameters;
+  parameters.set_log_domain_size(static_cast<int>(std::ceil(
+      std::log2(DenseDpfPirServer::NumRows(config.dense_dpf_pir_config())))));
+  parameters.mutable_value_type()->mutable_xor_wrapper()->set_bitsize(
+      kBitsPerBlock);
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+  for (int i = 0; i < kIndices.size(); ++i) {
+    const absl::uint128 block = kIndices[i] / kBitsPerBlock;
+    const std::vector<absl::uint128> evaluation_points = {block, block + 1};
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<XorWrapper<absl::uint128>> leader_shares,
+        dpf->EvaluateAt<XorWrapper<absl::uint128>>(
+            leader_request.dpf_key(i), 0, evaluation_points));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<XorWrapper<absl::uint128>> helper_shares,
+        dpf->EvaluateAt<XorWrapper<absl::uint128>>(
+            helper_request.plain_request().dpf_key(i), 0, evaluation_points));
+    EXPECT_EQ((leader_shares[0] + helper_shares[0]).value(),
+              absl::uint128{1} << (kIndices[i] % kBitsPerBlock));
+    EXPECT_EQ((leader_shares[1] + helper_shares[1]).value(), 0);
+  }
+}
+
 TEST_F(DenseDpfPirClientTest, HandleResponseFailsIfResponseHasWrongType) {
   PirResponse response;
   PirRequestClientState request_client_state;
@@ -243,5 +309,431 @@ TEST_F(DenseDpfPirClientTest, TestPirEndToEnd) {
                                            StartsWith("Element 42")));
 }
 
+TEST_F(DenseDpfPirClientTest, TestPirEndToEndWithKeyPool) {
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(
+      kTestDatabaseElements);
+  DenseDpfPirKeyPool::Options options;
+  options.capacity = 3;
+  options.refill_threshold = 0;
+  options.refill_in_background = false;
+  DPF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<DenseDpfPirKeyPool> key_pool,
+                           DenseDpfPirKeyPool::Create(config, options));
+  DPF_ASSERT_OK(key_pool->Fill());
+  DPF_ASSERT_OK(client_->SetKeyPool(key_pool));
+
+  // The last key pair is generated on demand.
+  PirRequest request;
+  PirRequestClientState request_client_state;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::tie(request, request_client_state),
+      client_->CreateRequest({0, 23, 42, kTestDatabaseElements - 1}));
+  EXPECT_EQ(request.dpf_pir_request()
+                .leader_request()
+                .plain_request()
+                .index_shifts_size(),
+            4);
+  EXPECT_EQ(key_pool->GetStats().misses, 1);
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response,
+                           leader_->HandleRequest(request));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::string> result,
+      client_->HandleResponse(response, request_client_state));
+
+  // Using StartsWith because of trailing null bytes.
+  EXPECT_THAT(result,
+              testing::ElementsAre(
+                  StartsWith("Element 0"), StartsWith("Element 23"),
+                  StartsWith("Element 42"),
+                  StartsWith(absl::StrCat("Element ",
+                                          kTestDatabaseElements - 1))));
+}
+
+TEST_F(DenseDpfPirClientTest, TestPirEndToEndWithKeyPoolAndBatching) {
+  // Let the Helper merge pooled requests with an unpooled one.
+  constexpr int kNumRequests = 3;
+  BatchingHelperSender::Options batching_options;
+  batching_options.max_delay = absl::InfiniteDuration();
+  batching_options.max_batch_size = kNumRequests;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<BatchingHelperSender> batching_sender,
+      BatchingHelperSender::Create(
+          pir_testing::CreateInProcessBatchSender(*helper_),
+          batching_options));
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(
+      kTestDatabaseElements);
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<std::string> elements,
+                           pir_testing::GenerateCountingStrings(
+                               kTestDatabaseElements, "Element "));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto database,
+      pir_testing::CreateFakeDatabase<DenseDpfPirDatabase>(elements));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto leader,
+      DenseDpfPirServer::CreateLeader(
+          config, std::move(database),
+          BatchingHelperSender::AsForwardHelperRequestFn(batching_sender)));
+
+  const std::vector<std::vector<int64_t>> indices = {{5}, {23, 42}, {100}};
+  std::vector<PirRequest> requests(kNumRequests);
+  std::vector<PirRequestClientState> request_client_states(kNumRequests);
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(requests[0], request_client_states[0]),
+                           client_->CreateRequest(indices[0]));
+  DenseDpfPirKeyPool::Options options;
+  options.capacity = 3;
+  options.refill_threshold = 0;
+  options.refill_in_background = false;
+  DPF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<DenseDpfPirKeyPool> key_pool,
+                           DenseDpfPirKeyPool::Create(config, options));
+  DPF_ASSERT_OK(key_pool->Fill());
+  DPF_ASSERT_OK(client_->SetKeyPool(key_pool));
+  for (int i = 1; i < kNumRequests; ++i) {
+    DPF_ASSERT_OK_AND_ASSIGN(std::tie(requests[i], request_client_states[i]),
+                             client_->CreateRequest(indices[i]));
+  }
+
+  std::vector<absl::StatusOr<PirResponse>> responses(kNumRequests);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumRequests; ++i) {
+    threads.emplace_back([&, i] {
+      responses[i] = leader->HandleRequest(requests[i]);
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(batching_sender->GetStats().batches, 1);
+  for (int i = 0; i < kNumRequests; ++i) {
+    DPF_ASSERT_OK(responses[i]);
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<std::string> result,
+        client_->HandleResponse(*responses[i], request_client_states[i]));
+    ASSERT_EQ(result.size(), indices[i].size());
+    for (int j = 0; j < result.size(); ++j) {
+      // Using StartsWith because of trailing null bytes.
+      EXPECT_THAT(result[j],
+                  StartsWith(absl::StrCat("Element ", indices[i][j])));
+    }
+  }
+}
+
+TEST_F(DenseDpfPirClientTest, SetKeyPoolFailsIfNumRowsDontMatch) {
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(
+      kTestDatabaseElements + 1);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<DenseDpfPirKeyPool> key_pool,
+      DenseDpfPirKeyPool::Create(config, DenseDpfPirKeyPool::Options()));
+  EXPECT_THAT(client_->SetKeyPool(key_pool),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("number of rows")));
+}
+
+TEST_F(DenseDpfPirClientTest, TestChunkedPirEndToEnd) {
+  // Use records spanning several chunks.
+  const std::string prefix(150, 'x');
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(
+      kTestDatabaseElements);
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<std::string> elements,
+                           pir_testing::GenerateCountingStrings(
+                               kTestDatabaseElements, prefix + "Element "));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto database1,
+      pir_testing::CreateFakeDatabase<DenseDpfPirDatabase>(elements));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto database2,
+      pir_testing::CreateFakeDatabase<DenseDpfPirDatabase>(elements));
+  auto decrypter = [this](absl::string_view ciphertext,
+                          absl::string_view context_info) {
+    return hybrid_decrypt_->Decrypt(ciphertext, context_info);
+  };
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto helper, DenseDpfPirServer::CreateHelper(config, std::move(database2),
+                                                   std::move(decrypter)));
+  auto sender = [&helper](const PirRequest& helper_request,
+                          absl::AnyInvocable<void()> while_waiting) {
+    while_waiting();
+    return helper->HandleRequest(helper_request);
+  };
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto leader, DenseDpfPirServer::CreateLeader(config, std::move(database1),
+                                                   std::move(sender)));
+
+  PirRequest request;
+  PirRequestClientState request_client_state;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(request, request_client_state),
+                           client_->CreateRequest({23, 42}));
+  std::vector<PirResponse> chunks;
+  DPF_ASSERT_OK(leader->HandleRequestChunked(request, 64,
+                                             [&chunks](PirResponse chunk) {
+                                               chunks.push_back(
+                                                   std::move(chunk));
+                                               return absl::OkStatus();
+                                             }));
+  EXPECT_EQ(chunks.size(), 3);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::string> result,
+      client_->HandleResponseChunks(chunks, request_client_state));
+
+  // Using StartsWith because of trailing null bytes.
+  EXPECT_THAT(result,
+              testing::ElementsAre(StartsWith(prefix + "Element 23"),
+                                   StartsWith(prefix + "Element 42")));
+
+  // Streaming the Helper's chunks must give the same result.
+  DPF_ASSERT_OK(leader->SetChunkedHelperSender(
+      pir_testing::CreateInProcessChunkedHelperSender(*helper)));
+  std::vector<PirResponse> streamed_chunks;
+  DPF_ASSERT_OK(leader->HandleRequestChunked(
+      request, 64, [&streamed_chunks](PirResponse chunk) {
+        streamed_chunks.push_back(std::move(chunk));
+        return absl::OkStatus();
+      }));
+  EXPECT_EQ(streamed_chunks.size(), 3);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      result,
+      client_->HandleResponseChunks(streamed_chunks, request_client_state));
+  EXPECT_THAT(result,
+              testing::ElementsAre(StartsWith(prefix + "Element 23"),
+                                   StartsWith(prefix + "Element 42")));
+}
+
+TEST_F(DenseDpfPirClientTest, CreateProjectedRequestFailsIfColumnsAreEmpty) {
+  EXPECT_THAT(client_->CreateProjectedRequest({23}, {}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("must not be empty")));
+}
+
+TEST_F(DenseDpfPirClientTest, CreateProjectedRequestFailsIfColumnIsNegative) {
+  EXPECT_THAT(
+      client_->CreateProjectedRequest({23}, {-1}),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("negative")));
+}
+
+TEST_F(DenseDpfPirClientTest, TestProjectedPirEndToEnd) {
+  // Records with three fixed-size columns.
+  const std::vector<int64_t> column_sizes = {8, 16, 24};
+  auto pad = [](std::string value, int64_t size) {
+    value.resize(size, '\0');
+    return value;
+  };
+  std::vector<std::string> records(kTestDatabaseElements);
+  for (int i = 0; i < kTestDatabaseElements; ++i) {
+    records[i] = pad(absl::StrCat("Id ", i), column_sizes[0]) +
+                 pad(absl::StrCat("Name ", i), column_sizes[1]) +
+                 pad(absl::StrCat("Email ", i), column_sizes[2]);
+  }
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(
+      kTestDatabaseElements);
+  ColumnarDenseDpfPirDatabase::Builder builder1, builder2;
+  builder1.SetColumnSizes(column_sizes);
+  builder2.SetColumnSizes(column_sizes);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto database1,
+      pir_testing::CreateFakeDatabase<ColumnarDenseDpfPirDatabase>(records,
+                                                                   &builder1));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto database2,
+      pir_testing::CreateFakeDatabase<ColumnarDenseDpfPirDatabase>(records,
+                                                                   &builder2));
+  auto decrypter = [this](absl::string_view ciphertext,
+                          absl::string_view context_info) {
+    return hybrid_decrypt_->Decrypt(ciphertext, context_info);
+  };
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto helper, DenseDpfPirServer::CreateHelper(config, std::move(database2),
+                                                   std::move(decrypter)));
+  auto sender = [&helper](const PirRequest& helper_request,
+                          absl::AnyInvocable<void()> while_waiting) {
+    while_waiting();
+    return helper->HandleRequest(helper_request);
+  };
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto leader, DenseDpfPirServer::CreateLeader(config, std::move(database1),
+                                                   std::move(sender)));
+
+  PirRequest request;
+  PirRequestClientState request_client_state;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(request, request_client_state),
+                           client_->CreateProjectedRequest({23, 42}, {2, 0}));
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response,
+                           leader->HandleRequest(request));
+
+  EXPECT_THAT(client_->HandleResponse(response, request_client_state),
+              IsOkAndHolds(testing::ElementsAre(
+                  pad("Email 23", column_sizes[2]),
+                  pad("Id 23", column_sizes[0]),
+                  pad("Email 42", column_sizes[2]),
+                  pad("Id 42", column_sizes[0]))));
+}
+
+class DenseDpfPirClientMatrixLayoutTest
+    : public ::testing::TestWithParam<int> {};
+
+TEST_P(DenseDpfPirClientMatrixLayoutTest, TestPirEndToEnd) {
+  const int records_per_row = GetParam();
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(
+      kTestDatabaseElements);
+  config.mutable_dense_dpf_pir_config()->set_records_per_row(records_per_row);
+
+  // Set up the client and a pair of plain servers.
+  DPF_ASSERT_OK_AND_ASSIGN(auto hybrid_encrypt, CreateFakeHybridEncrypt());
+  auto encrypter = [&hybrid_encrypt](absl::string_view plain_pir_request,
+                                     absl::string_view context_info) {
+    return hybrid_encrypt->Encrypt(plain_pir_request, context_info);
+  };
+  DPF_ASSERT_OK_AND_ASSIGN(auto client,
+                           DenseDpfPirClient::Create(config, encrypter));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<std::string> elements,
+                           pir_testing::GenerateCountingStrings(
+                               kTestDatabaseElements, "Element "));
+  std::vector<std::unique_ptr<DenseDpfPirServer>> servers;
+  for (int i = 0; i < 2; ++i) {
+    DenseDpfPirDatabase::Builder builder;
+    builder.SetRecordsPerRow(records_per_row);
+    for (const std::string& element : elements) {
+      builder.Insert(element);
+    }
+    DPF_ASSERT_OK_AND_ASSIGN(auto database, builder.Build());
+    EXPECT_EQ(database->size(),
+              DenseDpfPirServer::NumRows(config.dense_dpf_pir_config()));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        servers.emplace_back(),
+        DenseDpfPirServer::CreatePlain(config, std::move(database)));
+  }
+
+  // Query records at the start, in the middle, and in the last row.
+  DpfPirRequest::PlainRequest request1;
+  DpfPirRequest::HelperRequest request2;
+  PirRequestClientState request_client_state;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::tie(request1, request2, request_client_state),
+      client->CreatePlainRequests({0, 23, kTestDatabaseElements - 1}));
+  PirRequest plain_request1, plain_request2;
+  *plain_request1.mutable_dpf_pir_request()->mutable_plain_request() =
+      request1;
+  *plain_request2.mutable_dpf_pir_request()->mutable_plain_request() =
+      request2.plain_request();
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response1,
+                           servers[0]->HandleRequest(plain_request1));
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response2,
+                           servers[1]->HandleRequest(plain_request2));
+
+  // Combine the responses and mask them as the Helper would, so that
+  // HandleResponse can remove the one-time-pad.
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto prng, Aes128CtrSeededPrng::Create(request2.one_time_pad_seed()));
+  PirResponse response;
+  for (int i = 0; i < response1.dpf_pir_response().masked_response_size();
+       ++i) {
+    std::string combined = response1.dpf_pir_response().masked_response(i);
+    const std::string& other = response2.dpf_pir_response().masked_response(i);
+    const std::string mask = prng->GetRandomBytes(combined.size());
+    ASSERT_EQ(combined.size(), other.size());
+    for (int j = 0; j < combined.size(); ++j) {
+      combined[j] ^= other[j] ^ mask[j];
+    }
+    response.mutable_dpf_pir_response()->add_masked_response(combined);
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::string> result,
+      client->HandleResponse(response, request_client_state));
+
+  // Using StartsWith because of trailing null bytes.
+  EXPECT_THAT(result,
+              testing::ElementsAre(
+                  StartsWith("Element 0"), StartsWith("Element 23"),
+                  StartsWith(elements[kTestDatabaseElements - 1])));
+}
+
+INSTANTIATE_TEST_SUITE_P(RecordsPerRow, DenseDpfPirClientMatrixLayoutTest,
+                         ::testing::Values(1, 2, 7, 64));
+
+class DenseDpfPirClientCompressionTest : public ::testing::TestWithParam<int> {
+};
+
+TEST_P(DenseDpfPirClientCompressionTest, TestPirEndToEnd) {
+  const int records_per_row = GetParam();
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::string> elements,
+      pir_testing::GenerateCountingStrings(
+          kTestDatabaseElements, std::string(100, 'x') + "Element "));
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(
+      kTestDatabaseElements);
+  config.mutable_dense_dpf_pir_config()->set_records_per_row(records_per_row);
+  RecordCompressionParams& compression =
+      *config.mutable_dense_dpf_pir_config()->mutable_record_compression();
+  compression.set_codec(RecordCompressionParams::CODEC_DEFLATE);
+  compression.set_dictionary(TrainCompressionDictionary(
+      absl::MakeConstSpan(elements).subspan(0, 100)));
+  compression.set_size_bucket_bytes(8);
+
+  std::unique_ptr<DenseDpfPirServer> servers[2];
+  for (int i = 0; i < 2; ++i) {
+    DenseDpfPirDatabase::Builder builder;
+    builder.SetRecordsPerRow(records_per_row);
+    builder.SetRecordCompression(compression);
+    for (const std::string& element : elements) {
+      builder.Insert(element);
+    }
+    DPF_ASSERT_OK_AND_ASSIGN(auto database, builder.Build());
+    EXPECT_LT(static_cast<DenseDpfPirDatabase*>(database.get())
+                  ->max_value_size_in_bytes(),
+              records_per_row * elements.back().size());
+    if (i == 0) {
+      auto sender = [&servers](const PirRequest& helper_request,
+                               absl::AnyInvocable<void()> while_waiting) {
+        while_waiting();
+        return servers[1]->HandleRequest(helper_request);
+      };
+      DPF_ASSERT_OK_AND_ASSIGN(
+          servers[i], DenseDpfPirServer::CreateLeader(
+                          config, std::move(database), std::move(sender)));
+    } else {
+      DPF_ASSERT_OK_AND_ASSIGN(auto hybrid_decrypt, CreateFakeHybridDecrypt());
+      auto decrypter = [hybrid_decrypt = std::shared_ptr<
+                            const crypto::tink::HybridDecrypt>(
+                            std::move(hybrid_decrypt))](
+                           absl::string_view ciphertext,
+                           absl::string_view context_info) {
+        return hybrid_decrypt->Decrypt(ciphertext, context_info);
+      };
+      DPF_ASSERT_OK_AND_ASSIGN(
+          servers[i], DenseDpfPirServer::CreateHelper(
+                          config, std::move(database), std::move(decrypter)));
+    }
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(auto hybrid_encrypt, CreateFakeHybridEncrypt());
+  auto encrypter = [&hybrid_encrypt](absl::string_view plain_pir_request,
+                                     absl::string_view context_info) {
+    return hybrid_encrypt->Encrypt(plain_pir_request, context_info);
+  };
+  DPF_ASSERT_OK_AND_ASSIGN(auto client,
+                           DenseDpfPirClient::Create(config, encrypter));
+
+  PirRequest request;
+  PirRequestClientState request_client_state;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::tie(request, request_client_state),
+      client->CreateRequest({0, 23, kTestDatabaseElements - 1}));
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response,
+                           servers[0]->HandleRequest(request));
+
+  // Decompressed records have no trailing null bytes.
+  EXPECT_THAT(client->HandleResponse(response, request_client_state),
+              IsOkAndHolds(testing::ElementsAre(
+                  elements[0], elements[23],
+                  elements[kTestDatabaseElements - 1])));
+}
+
+INSTANTIATE_TEST_SUITE_P(RecordsPerRow, DenseDpfPirClientCompressionTest,
+                         ::testing::Values(1, 7));
+
 }  // namespace
 }  // namespace distributed_point_functions
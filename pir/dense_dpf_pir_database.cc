@@ -16,6 +16,7 @@
 
 #include <stddef.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -30,6 +31,8 @@
 #include "absl/types/span.h"
 #include "dpf/status_macros.h"
 #include "pir/internal/inner_product_hwy.h"
+#include "pir/private_information_retrieval.pb.h"
+#include "pir/record_compression.h"
 
 namespace distributed_point_functions {
 
@@ -63,16 +66,44 @@ inline constexpr int64_t NumBytesToNumBlocks(int64_t num_bytes) {
          sizeof(DenseDpfPirDatabase::BlockType);
 }
 
+// Concatenates every `records_per_row` consecutive `values` into a single row,
+// padding each value to the size of the largest one.
+std::vector<std::string> GroupIntoRows(std::vector<std::string> values,
+                                       int64_t records_per_row) {
+  size_t max_value_size = 0;
+  for (const std::string& value : values) {
+    max_value_size = std::max(max_value_size, value.size());
+  }
+  const size_t num_rows =
+      (values.size() + records_per_row - 1) / records_per_row;
+  std::vector<std::string> rows(num_rows);
+  for (size_t i = 0; i < values.size(); ++i) {
+    std::string& row = rows[i / records_per_row];
+    if (row.empty()) {
+      row.reserve(records_per_row * max_value_size);
+    }
+    row.append(values[i]);
+    row.resize((i % records_per_row + 1) * max_value_size, '\0');
+    std::string().swap(values[i]);  // Free memory early.
+  }
+  if (!rows.empty()) {
+    rows.back().resize(records_per_row * max_value_size, '\0');
+  }
+  return rows;
+}
+
 }  // namespace
 
 DenseDpfPirDatabase::Builder::Builder()
-    : total_database_bytes_(0), has_been_built_(false) {}
+    : total_database_bytes_(0), records_per_row_(1), has_been_built_(false) {}
 
 std::unique_ptr<DenseDpfPirDatabase::Interface::Builder>
 DenseDpfPirDatabase::Builder::Clone() const {
   auto result = std::make_unique<Builder>();
   result->total_database_bytes_ = total_database_bytes_;
   result->values_ = values_;
+  result->records_per_row_ = records_per_row_;
+  result->record_compression_ = record_compression_;
   result->has_been_built_ = has_been_built_;
   return result;
 }
@@ -91,10 +122,39 @@ DenseDpfPirDatabase::Builder& DenseDpfPirDatabase::Builder::Clear() {
   return *this;
 }
 
+DenseDpfPirDatabase::Builder& DenseDpfPirDatabase::Builder::SetRecordsPerRow(
+    int64_t records_per_row) {
+  records_per_row_ = std::max<int64_t>(records_per_row, 1);
+  return *this;
+}
+
+DenseDpfPirDatabase::Builder&
+DenseDpfPirDatabase::Builder::SetRecordCompression(
+    RecordCompressionParams params) {
+  record_compression_ = std::move(params);
+  return *this;
+}
+
 absl::StatusOr<std::unique_ptr<DenseDpfPirDatabase::Interface>>
 DenseDpfPirDatabase::Builder::Build() {
   DPF_RETURN_IF_ERROR(CheckHasNotBeenBuilt(has_been_built_));
   has_been_built_ = true;
+  if (record_compression_.has_value()) {
+    DPF_ASSIGN_OR_RETURN(std::unique_ptr<RecordCompressor> compressor,
+                         RecordCompressor::Create(*record_compression_));
+    total_database_bytes_ = 0;
+    for (std::string& value : values_) {
+      DPF_ASSIGN_OR_RETURN(value, compressor->Compress(value));
+      total_database_bytes_ += AlignBytes(value.size());
+    }
+  }
+  if (records_per_row_ > 1) {
+    values_ = GroupIntoRows(std::move(values_), records_per_row_);
+    total_database_bytes_ = 0;
+    for (const std::string& row : values_) {
+      total_database_bytes_ += AlignBytes(row.size());
+    }
+  }
   auto database = absl::WrapUnique(
       new DenseDpfPirDatabase(values_.size(), total_database_bytes_));
   std::vector<std::string> values =
@@ -149,7 +209,7 @@ absl::Status DenseDpfPirDatabase::Append(std::string value) {
   // Append the value to the buffer
   char* const buffer_at_offset = reinterpret_cast<char*>(&buffer_.at(offset));
   value.copy(buffer_at_offset, value_size);
-  if (value_size > max_value_size_) {
+  if (static_cast<int64_t>(value_size) > max_value_size_) {
     max_value_size_ = value_size;
   }
 
@@ -167,4 +227,22 @@ absl::StatusOr<std::vector<std::string>> DenseDpfPirDatabase::InnerProductWith(
                                     max_value_size_);
 }
 
+absl::Status DenseDpfPirDatabase::InnerProductWithInto(
+    absl::Span<const BlockType> selections,
+    InnerProductOutputs outputs) const {
+  return pir_internal::InnerProductInto(content_views_, selections,
+                                        max_value_size_, outputs);
+}
+
+absl::Status DenseDpfPirDatabase::InnerProductWithChunked(
+    absl::Span<const std::vector<BlockType>> selections, int64_t chunk_size,
+    ChunkSink sink) const {
+  const int64_t response_size = max_value_size_;
+  return pir_internal::InnerProductChunked(
+      content_views_, selections, max_value_size_, chunk_size,
+      [sink, response_size](int64_t offset, std::vector<std::string> chunks) {
+        return sink(offset, response_size, std::move(chunks));
+      });
+}
+
 }  // namespace distributed_point_functions
@@ -29,9 +29,11 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "dpf/xor_wrapper.h"
 #include "pir/pir_database_interface.h"
+#include "pir/private_information_retrieval.pb.h"
 
 namespace distributed_point_functions {
 
@@ -58,6 +60,18 @@ class DenseDpfPirDatabase
     Builder& Clear() override;
     // Returns a copy of this builder.
     std::unique_ptr<PirDatabaseInterface::Builder> Clone() const override;
+    // Lays out the database as a matrix with `records_per_row` records per
+    // row, to be used with DenseDpfPirConfig.records_per_row. On Build(),
+    // every `records_per_row` consecutive records are padded with null bytes
+    // to the size of the largest record and concatenated into a single
+    // database entry, so that the inner product returns whole rows. The last
+    // row is padded to full length. Values smaller than 2 disable the matrix
+    // layout, which is the default.
+    Builder& SetRecordsPerRow(int64_t records_per_row);
+    // Compresses every record with `params` on Build(), before the matrix
+    // layout is applied. Clients must be configured with the same `params` to
+    // decompress the records, see DenseDpfPirConfig.record_compression.
+    Builder& SetRecordCompression(RecordCompressionParams params);
     // Builds the database and invalidated the builder. All subsequent calls to
     // Build() will fail with FAILED_PRECONDITION.
     absl::StatusOr<std::unique_ptr<PirDatabaseInterface>> Build() override;
@@ -68,10 +82,13 @@ class DenseDpfPirDatabase
    private:
     std::vector<std::string> values_;
     int64_t total_database_bytes_;
+    int64_t records_per_row_;
+    absl::optional<RecordCompressionParams> record_compression_;
     bool has_been_built_;
   };
 
-  // Returns the number of records contained in the database.
+  // Returns the number of records contained in the database. If the database
+  // was built with a matrix layout, this is the number of rows.
   size_t size() const override { return content_views_.size(); }
 
   // The number of selection bits for dense PIR is equal to the number of
@@ -83,6 +100,25 @@ class DenseDpfPirDatabase
   absl::StatusOr<std::vector<RecordType>> InnerProductWith(
       absl::Span<const std::vector<BlockType>> selections) const override;
 
+  // Each response consists of a single part holding the inner product of the
+  // records, which has the size of the largest record.
+  absl::Span<const int64_t> response_part_sizes() const override {
+    return absl::MakeConstSpan(&max_value_size_, 1);
+  }
+
+  // As `InnerProductWith`, but without allocating. See PirDatabaseInterface.
+  absl::Status InnerProductWithInto(absl::Span<const BlockType> selections,
+                                    InnerProductOutputs outputs) const override;
+
+  // Computes the inner products in byte ranges of `chunk_size` bytes (rounded
+  // up to a multiple of 64), passing each range of all inner products to `sink`
+  // as soon as it is complete. This bounds the memory used for intermediate
+  // results to one chunk per selection vector, which matters for databases with
+  // very large records.
+  absl::Status InnerProductWithChunked(
+      absl::Span<const std::vector<BlockType>> selections, int64_t chunk_size,
+      ChunkSink sink) const override;
+
   // Returns a flat array holding all values of the database. Used for testing.
   absl::Span<const absl::string_view> content() const { return content_views_; }
 
@@ -100,7 +136,7 @@ class DenseDpfPirDatabase
   absl::Status Append(std::string value);
 
   // Maximal size (in bytes) of values in the database
-  size_t max_value_size_;
+  int64_t max_value_size_;
 
   // Stores all the values of the database. For better memory access performance
   // when computing the inner product, the beginning address of each value will
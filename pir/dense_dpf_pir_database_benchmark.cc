@@ -20,10 +20,15 @@
 #include <vector>
 
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/types/span.h"
 #include "benchmark/benchmark.h"  // third_party/benchmark
+#include "dpf/internal/memory_counters.h"
 #include "dpf/internal/status_matchers.h"
+#include "pir/columnar_dense_dpf_pir_database.h"
 #include "pir/dense_dpf_pir_database.h"
+#include "pir/private_information_retrieval.pb.h"
+#include "pir/record_compression.h"
 #include "pir/testing/mock_pir_database.h"
 #include "pir/testing/pir_selection_bits.h"
 
@@ -53,6 +58,7 @@ void BM_InnerProductOnEqualSizeValues(benchmark::State& state) {
       pir_testing::GenerateRandomPackedSelectionBits<BlockType>(num_values);
 
   // Compute the inner product
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto _ : state) {
     auto result = database->InnerProductWith({selections});
     benchmark::DoNotOptimize(result);
@@ -111,6 +117,7 @@ void BM_InnerProductOnVariableSizeValues(benchmark::State& state) {
       pir_testing::GenerateRandomPackedSelectionBits<BlockType>(num_values);
 
   // Compute the inner product
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto _ : state) {
     auto result = database->InnerProductWith({selections});
     benchmark::DoNotOptimize(result);
@@ -145,12 +152,121 @@ void BM_BatchedInnerProductOnVariableSizeValues(benchmark::State& state) {
       pir_testing::GenerateRandomPackedSelectionBits<BlockType>(num_values));
 
   // Compute the inner product
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto _ : state) {
     auto result = database->InnerProductWith(selections);
     benchmark::DoNotOptimize(result);
   }
 }
 
+// Returns `num_values` JSON records of about 400 bytes sharing most of their
+// structure, as is typical for serialized structured data.
+std::vector<std::string> GenerateJsonValues(int num_values) {
+  std::vector<std::string> values(num_values);
+  for (int i = 0; i < num_values; ++i) {
+    values[i] = absl::StrCat(
+        R"({"id": )", i, R"(, "name": "user)", i * 7919 % 100003,
+        R"(", "email": "user)", i, R"(@example.com", "active": )",
+        i % 2 == 0 ? "true" : "false", R"(, "roles": ["reader", "writer"], )",
+        R"("address": {"street": "Main Street )", i % 977,
+        R"(", "city": "Zurich", "country": "CH", "zip": ")", 8000 + i % 100,
+        R"("}, "preferences": {"language": "en", "newsletter": false, )",
+        R"("theme": "dark", "notifications": {"email": true, "sms": false}}, )",
+        R"("created": "2023-01-)", 10 + i % 20, R"(T12:00:00Z"})");
+  }
+  return values;
+}
+
+// Compares the inner product on compressible records stored as is (range(1) =
+// 0) and compressed with a trained dictionary (range(1) = 1). The time is
+// proportional to the stored bytes per record, reported as `record_bytes`.
+void BM_InnerProductOnCompressedValues(benchmark::State& state) {
+  int num_values = state.range(0);
+  bool compress = state.range(1) != 0;
+
+  std::vector<std::string> values = GenerateJsonValues(num_values);
+  DenseDpfPirDatabase::Builder builder;
+  if (compress) {
+    RecordCompressionParams params;
+    params.set_codec(RecordCompressionParams::CODEC_DEFLATE);
+    params.set_dictionary(TrainCompressionDictionary(
+        absl::MakeConstSpan(values).subspan(0, 1000)));
+    params.set_size_bucket_bytes(sizeof(BlockType));
+    builder.SetRecordCompression(std::move(params));
+  }
+  for (auto& value : values) {
+    builder.Insert(std::move(value));
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(auto database, builder.Build());
+  state.counters["record_bytes"] =
+      static_cast<double>(builder.total_database_bytes()) / num_values;
+
+  // Random selection bits packed in blocks.
+  std::vector<BlockType> selections =
+      pir_testing::GenerateRandomPackedSelectionBits<BlockType>(num_values);
+
+  // Compute the inner product
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto _ : state) {
+    auto result = database->InnerProductWith({selections});
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+BENCHMARK(BM_InnerProductOnCompressedValues)
+    ->Args({1 << 16, 0})
+    ->Args({1 << 16, 1})
+    ->Args({1 << 20, 0})
+    ->Args({1 << 20, 1});
+
+// Compares the inner product over whole records of 8 columns of 32 bytes each
+// (range(1) = 0) with inner products projected to the first range(1) columns
+// of a columnar database. The time is proportional to the projected bytes.
+void BM_InnerProductOnProjectedColumns(benchmark::State& state) {
+  constexpr int kNumColumns = 8;
+  constexpr int kColumnSize = 32;
+  int num_values = state.range(0);
+  int num_projected_columns = state.range(1);
+
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<std::string> values,
+                           pir_testing::GenerateRandomStringsEqualSize(
+                               num_values, kNumColumns * kColumnSize));
+  ColumnarDenseDpfPirDatabase::Builder builder;
+  builder.SetColumnSizes(std::vector<int64_t>(kNumColumns, kColumnSize));
+  for (auto& value : values) {
+    builder.Insert(std::move(value));
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(auto database, builder.Build());
+  std::vector<int> columns(num_projected_columns);
+  for (int i = 0; i < num_projected_columns; ++i) {
+    columns[i] = i;
+  }
+
+  // Random selection bits packed in blocks.
+  std::vector<BlockType> selections =
+      pir_testing::GenerateRandomPackedSelectionBits<BlockType>(num_values);
+
+  // Compute the inner product
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto _ : state) {
+    if (columns.empty()) {
+      auto result = database->InnerProductWith({selections});
+      benchmark::DoNotOptimize(result);
+    } else {
+      auto result = database->InnerProductWithColumns({selections}, columns);
+      benchmark::DoNotOptimize(result);
+    }
+  }
+}
+
+BENCHMARK(BM_InnerProductOnProjectedColumns)
+    ->Args({1 << 16, 0})
+    ->Args({1 << 16, 1})
+    ->Args({1 << 16, 2})
+    ->Args({1 << 20, 0})
+    ->Args({1 << 20, 1})
+    ->Args({1 << 20, 2});
+
 BENCHMARK(BM_BatchedInnerProductOnVariableSizeValues)
     ->Args({1 << 16, 2, 1})
     ->Args({1 << 20, 2, 1})
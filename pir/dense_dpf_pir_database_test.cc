@@ -16,6 +16,7 @@
 
 #include <stddef.h>
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -30,6 +31,9 @@
 #include "dpf/internal/status_matchers.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "pir/pir_database_interface.h"
+#include "pir/private_information_retrieval.pb.h"
+#include "pir/record_compression.h"
 #include "pir/testing/mock_pir_database.h"
 #include "pir/testing/pir_selection_bits.h"
 
@@ -56,6 +60,11 @@ constexpr int kMaxValueBytes = 80;
 constexpr int kLevelsToPack = 7;
 constexpr int kBitsPerBlock = 8 * sizeof(BlockType);
 
+// Storage for aligned outputs of `InnerProductWithInto`.
+struct alignas(kInnerProductOutputAlignment) AlignedOutputBlock {
+  char bytes[kInnerProductOutputAlignment];
+};
+
 // Use default setting to build a database.
 TEST(DenseDpfPirDatabaseBuilder, CreateWithAllDefaultArguments) {
   DPF_ASSERT_OK_AND_ASSIGN(InterfacePtr database,
@@ -175,6 +184,50 @@ TEST_F(DenseDpfPirDatabaseBuilderInsertTest,
   }
 }
 
+// Records are grouped into rows of equal size when using a matrix layout.
+TEST_F(DenseDpfPirDatabaseBuilderInsertTest,
+       SetRecordsPerRowGroupsRecordsIntoPaddedRows) {
+  DenseDpfPirDatabase::Builder builder;
+  builder.SetRecordsPerRow(2);
+  for (const std::string value : {"a", "bb", "ccc", "d", ""}) {
+    builder.Insert(value);
+  }
+  std::unique_ptr<DenseDpfPirDatabase::Interface::Builder> clone =
+      builder.Clone();
+
+  using std::string_literals::operator""s;
+  std::vector<std::string> expected_rows = {"a\0\0bb\0"s, "cccd\0\0"s,
+                                            std::string(6, '\0')};
+  EXPECT_THAT(builder.Build(), IsOkAndHolds(IsContentEqual(expected_rows)));
+  EXPECT_THAT(clone->Build(), IsOkAndHolds(IsContentEqual(expected_rows)));
+}
+
+// Records are stored compressed when using record compression.
+TEST_F(DenseDpfPirDatabaseBuilderInsertTest,
+       SetRecordCompressionStoresCompressedRecords) {
+  RecordCompressionParams params;
+  params.set_codec(RecordCompressionParams::CODEC_DEFLATE);
+  params.set_size_bucket_bytes(32);
+  DPF_ASSERT_OK_AND_ASSIGN(auto compressor, RecordCompressor::Create(params));
+  const std::vector<std::string> values = {std::string(1000, 'a'), "b", ""};
+  DenseDpfPirDatabase::Builder builder;
+  builder.SetRecordCompression(params);
+  for (const std::string& value : values) {
+    builder.Insert(value);
+  }
+  std::unique_ptr<DenseDpfPirDatabase::Interface::Builder> clone =
+      builder.Clone();
+
+  std::vector<std::string> expected;
+  for (const std::string& value : values) {
+    DPF_ASSERT_OK_AND_ASSIGN(expected.emplace_back(),
+                             compressor->Compress(value));
+    EXPECT_EQ(expected.back().size(), 32);
+  }
+  EXPECT_THAT(builder.Build(), IsOkAndHolds(IsContentEqual(expected)));
+  EXPECT_THAT(clone->Build(), IsOkAndHolds(IsContentEqual(expected)));
+}
+
 // Checks that the content view of the database, accessed via `content()`, is
 // correct and contains all the inserted values after inserting values of
 // different sizes.
@@ -357,6 +410,57 @@ TEST_F(DenseDpfPirDatabaseInnerProductTest,
       IsOkAndHolds(ElementsAre(StartsWith(target1), StartsWith(target2))));
 }
 
+TEST_F(DenseDpfPirDatabaseInnerProductTest,
+       InnerProductWithChunkedConcatenatesToInnerProduct) {
+  const std::vector<std::vector<BlockType>> selections = {
+      pir_testing::GenerateRandomPackedSelectionBits<BlockType>(kNumValues),
+      pir_testing::GenerateRandomPackedSelectionBits<BlockType>(kNumValues)};
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<std::string> expected,
+                           this->database_->InnerProductWith(selections));
+
+  // Chunks of 1 byte are rounded up to 64 bytes, so this yields two chunks.
+  std::vector<std::string> result(selections.size());
+  int num_chunks = 0;
+  DPF_ASSERT_OK(this->database_->InnerProductWithChunked(
+      selections, 1,
+      [&](int64_t offset, int64_t response_size,
+          std::vector<std::string> chunks) {
+        EXPECT_EQ(response_size, expected[0].size());
+        for (int i = 0; i < chunks.size(); ++i) {
+          EXPECT_EQ(offset, result[i].size());
+          result[i] += chunks[i];
+        }
+        ++num_chunks;
+        return absl::OkStatus();
+      }));
+  EXPECT_EQ(num_chunks, 2);
+  EXPECT_EQ(result, expected);
+}
+
+TEST_F(DenseDpfPirDatabaseInnerProductTest,
+       InnerProductWithIntoMatchesInnerProductWith) {
+  const std::vector<std::vector<BlockType>> selections = {
+      pir_testing::GenerateRandomPackedSelectionBits<BlockType>(kNumValues),
+      pir_testing::GenerateRandomPackedSelectionBits<BlockType>(kNumValues)};
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<std::string> expected,
+                           this->database_->InnerProductWith(selections));
+  ASSERT_THAT(this->database_->response_part_sizes(),
+              ElementsAre(static_cast<int64_t>(expected[0].size())));
+
+  std::vector<BlockType> selection_matrix = selections[0];
+  selection_matrix.insert(selection_matrix.end(), selections[1].begin(),
+                          selections[1].end());
+  const int64_t stride = AlignInnerProductOutputSize(expected[0].size());
+  std::vector<AlignedOutputBlock> buffer(2 * stride /
+                                         kInnerProductOutputAlignment);
+  InnerProductOutputs outputs(buffer[0].bytes, 2, stride);
+  DPF_ASSERT_OK(
+      this->database_->InnerProductWithInto(selection_matrix, outputs));
+  for (int k = 0; k < 2; ++k) {
+    EXPECT_EQ(absl::string_view(outputs[k], expected[k].size()), expected[k]);
+  }
+}
+
 TEST_F(DenseDpfPirDatabaseInnerProductTest,
        InnerProductWithClonedBuilderIsTheSame) {
   auto selections =
@@ -0,0 +1,227 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/dense_dpf_pir_key_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/status_macros.h"
+#include "dpf/xor_wrapper.h"
+#include "pir/dense_dpf_pir_server.h"
+#include "pir/private_information_retrieval.pb.h"
+#include "pir/prng/aes_128_ctr_seeded_prng.h"
+
+namespace distributed_point_functions {
+
+namespace {
+
+// Number of key pairs generated by the background thread before adding them to
+// the pool, so that waiting clients don't have to wait for a full refill.
+constexpr int64_t kRefillBatchSize = 64;
+
+}  // namespace
+
+DenseDpfPirKeyPool::DenseDpfPirKeyPool(
+    std::unique_ptr<DistributedPointFunction> dpf, int64_t num_rows,
+    Options options)
+    : dpf_(std::move(dpf)), num_rows_(num_rows), options_(options) {}
+
+absl::StatusOr<std::shared_ptr<DenseDpfPirKeyPool>> DenseDpfPirKeyPool::Create(
+    const PirConfig& config, Options options) {
+  if (config.wrapped_pir_config_case() != PirConfig::kDenseDpfPirConfig) {
+    return absl::InvalidArgumentError(
+        "`config` does not contain a valid DenseDpfPirConfig");
+  }
+  if (config.dense_dpf_pir_config().num_elements() <= 0) {
+    return absl::InvalidArgumentError("`num_elements` must be positive");
+  }
+  if (config.dense_dpf_pir_config().records_per_row() < 0) {
+    return absl::InvalidArgumentError("`records_per_row` must not be negative");
+  }
+  if (options.capacity <= 0) {
+    return absl::InvalidArgumentError("`capacity` must be positive");
+  }
+  if (options.refill_threshold < 0 ||
+      options.refill_threshold > options.capacity) {
+    return absl::InvalidArgumentError(
+        "`refill_threshold` must be between 0 and `capacity`");
+  }
+
+  // Use the same DPF parameters as DenseDpfPirClient.
+  const int64_t num_rows =
+      DenseDpfPirServer::NumRows(config.dense_dpf_pir_config());
+  DpfParameters parameters;
+  parameters.set_log_domain_size(
+      static_cast<int>(std::ceil(std::log2(num_rows))));
+  parameters.mutable_value_type()->mutable_xor_wrapper()->set_bitsize(
+      kBitsPerBlock);
+  DPF_ASSIGN_OR_RETURN(auto dpf, DistributedPointFunction::Create(parameters));
+
+  std::shared_ptr<DenseDpfPirKeyPool> pool(
+      new DenseDpfPirKeyPool(std::move(dpf), num_rows, options));
+  if (options.refill_in_background) {
+    pool->refill_thread_ = std::thread([pool = pool.get()] {
+      pool->RefillLoop();
+    });
+  }
+  return pool;
+}
+
+DenseDpfPirKeyPool::~DenseDpfPirKeyPool() {
+  {
+    absl::MutexLock lock(&mu_);
+    stopping_ = true;
+  }
+  if (refill_thread_.joinable()) {
+    refill_thread_.join();
+  }
+}
+
+absl::StatusOr<std::vector<DenseDpfPirKeyPool::KeyPair>>
+DenseDpfPirKeyPool::GenerateKeyPairs(int64_t count) const {
+  DPF_ASSIGN_OR_RETURN(std::string seed, Aes128CtrSeededPrng::GenerateSeed());
+  DPF_ASSIGN_OR_RETURN(auto prng, Aes128CtrSeededPrng::Create(seed));
+
+  // Sample rows by rejection sampling, so that they are uniformly distributed.
+  const uint64_t num_rows = num_rows_;
+  const uint64_t limit = std::numeric_limits<uint64_t>::max() -
+                         std::numeric_limits<uint64_t>::max() % num_rows;
+  std::vector<KeyPair> result(count);
+  for (KeyPair& key_pair : result) {
+    uint64_t random;
+    do {
+      std::string bytes = prng->GetRandomBytes(sizeof(random));
+      std::memcpy(&random, bytes.data(), sizeof(random));
+    } while (random >= limit);
+    key_pair.row = random % num_rows;
+
+    absl::uint128 alpha = key_pair.row / kBitsPerBlock;
+    XorWrapper<absl::uint128> beta(absl::uint128{1}
+                                   << (key_pair.row % kBitsPerBlock));
+    DPF_ASSIGN_OR_RETURN(std::tie(key_pair.leader_key, key_pair.helper_key),
+                         dpf_->GenerateKeys(alpha, beta));
+  }
+  return result;
+}
+
+void DenseDpfPirKeyPool::AddKeyPairs(std::vector<KeyPair> key_pairs) {
+  absl::MutexLock lock(&mu_);
+  stats_.keys_generated += key_pairs.size();
+  for (KeyPair& key_pair : key_pairs) {
+    if (key_pairs_.size() >= options_.capacity) {
+      break;
+    }
+    key_pairs_.push_back(std::move(key_pair));
+  }
+}
+
+absl::StatusOr<std::vector<DenseDpfPirKeyPool::KeyPair>>
+DenseDpfPirKeyPool::Take(int64_t count) {
+  if (count < 0) {
+    return absl::InvalidArgumentError("`count` must not be negative");
+  }
+  std::vector<KeyPair> result;
+  result.reserve(count);
+  {
+    absl::MutexLock lock(&mu_);
+    stats_.keys_taken += count;
+    while (result.size() < count && !key_pairs_.empty()) {
+      result.push_back(std::move(key_pairs_.back()));
+      key_pairs_.pop_back();
+    }
+    stats_.misses += count - result.size();
+  }
+
+  // Generate the missing key pairs on the calling thread.
+  if (result.size() < count) {
+    DPF_ASSIGN_OR_RETURN(std::vector<KeyPair> missing,
+                         GenerateKeyPairs(count - result.size()));
+    for (KeyPair& key_pair : missing) {
+      result.push_back(std::move(key_pair));
+    }
+  }
+  return result;
+}
+
+absl::Status DenseDpfPirKeyPool::Fill() {
+  DPF_ASSIGN_OR_RETURN(std::vector<KeyPair> key_pairs,
+                       GenerateKeyPairs(options_.capacity - size()));
+  AddKeyPairs(std::move(key_pairs));
+  return absl::OkStatus();
+}
+
+int64_t DenseDpfPirKeyPool::size() const {
+  absl::MutexLock lock(&mu_);
+  return key_pairs_.size();
+}
+
+DenseDpfPirKeyPool::Stats DenseDpfPirKeyPool::GetStats() const {
+  absl::MutexLock lock(&mu_);
+  return stats_;
+}
+
+bool DenseDpfPirKeyPool::NeedsRefillOrStopping() const {
+  return stopping_ || key_pairs_.size() < options_.refill_threshold;
+}
+
+void DenseDpfPirKeyPool::RefillLoop() {
+  while (true) {
+    int64_t missing;
+    {
+      absl::MutexLock lock(&mu_);
+      mu_.Await(
+          absl::Condition(this, &DenseDpfPirKeyPool::NeedsRefillOrStopping));
+      if (stopping_) {
+        return;
+      }
+      missing = options_.capacity - key_pairs_.size();
+    }
+
+    // Refill in batches, without holding the lock.
+    while (missing > 0) {
+      const int64_t batch_size = std::min(missing, kRefillBatchSize);
+      absl::StatusOr<std::vector<KeyPair>> key_pairs =
+          GenerateKeyPairs(batch_size);
+      if (!key_pairs.ok()) {
+        // Key generation only fails for invalid parameters, which are checked
+        // in `Create`. Leave it to `Take` to report the error.
+        return;
+      }
+      AddKeyPairs(*std::move(key_pairs));
+      missing -= batch_size;
+      absl::MutexLock lock(&mu_);
+      if (stopping_) {
+        return;
+      }
+    }
+  }
+}
+
+}  // namespace distributed_point_functions
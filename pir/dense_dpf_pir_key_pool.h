@@ -0,0 +1,157 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_DENSE_DPF_PIR_KEY_POOL_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_DENSE_DPF_PIR_KEY_POOL_H_
+
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+// Pool of DPF key pairs for dense DPF PIR, generated ahead of time for random
+// rows. Key generation dominates the latency of creating a request. With a key
+// pool, DenseDpfPirClient instead takes a key pair for a random row `r` from
+// the pool, and sends the public offset `(row - r) mod num_rows` along with it
+// in DpfPirRequest::PlainRequest.index_shifts. The servers then cyclically
+// shift the evaluated selection vector by that offset before computing the
+// inner product. Since `r` is uniformly random and every key pair is used only
+// once, the offset does not reveal anything about `row`.
+//
+// A background thread refills the pool to `Options::capacity` whenever fewer
+// than `Options::refill_threshold` key pairs are left. If the pool runs empty,
+// key pairs are generated on the calling thread.
+//
+// Usage:
+//
+//   DPF_ASSIGN_OR_RETURN(std::shared_ptr<DenseDpfPirKeyPool> key_pool,
+//                        DenseDpfPirKeyPool::Create(config, options));
+//   DPF_RETURN_IF_ERROR(client->SetKeyPool(key_pool));
+//
+// This class is thread-safe.
+class DenseDpfPirKeyPool {
+ public:
+  struct Options {
+    // Maximum number of key pairs held by the pool. Must be positive.
+    int64_t capacity = 1024;
+
+    // The pool is refilled once fewer than this many key pairs are left. Must
+    // be between 0 and `capacity`.
+    int64_t refill_threshold = 256;
+
+    // If false, no background thread is started, and the pool is only filled
+    // by calling `Fill`.
+    bool refill_in_background = true;
+  };
+
+  // Counters to be exported as metrics.
+  struct Stats {
+    // Total number of key pairs generated ahead of time.
+    int64_t keys_generated = 0;
+    // Total number of key pairs taken from the pool.
+    int64_t keys_taken = 0;
+    // Number of key pairs that had to be generated on the calling thread
+    // because the pool was empty.
+    int64_t misses = 0;
+  };
+
+  // A pair of DPF keys selecting the given `row`, one for each server.
+  struct KeyPair {
+    int64_t row;
+    DpfKey leader_key;
+    DpfKey helper_key;
+  };
+
+  // Creates a new key pool for the dense PIR database specified by `config`,
+  // and starts the background refill if enabled in `options`.
+  //
+  // Returns INVALID_ARGUMENT if `config` does not contain a valid
+  // DenseDpfPirConfig, or if `options` are invalid.
+  static absl::StatusOr<std::shared_ptr<DenseDpfPirKeyPool>> Create(
+      const PirConfig& config, Options options);
+
+  // Stops the background refill.
+  ~DenseDpfPirKeyPool();
+
+  // DenseDpfPirKeyPool is neither copyable nor movable.
+  DenseDpfPirKeyPool(const DenseDpfPirKeyPool&) = delete;
+  DenseDpfPirKeyPool& operator=(const DenseDpfPirKeyPool&) = delete;
+
+  // Removes `count` key pairs from the pool and returns them. Key pairs missing
+  // from the pool are generated on the calling thread.
+  //
+  // Returns INVALID_ARGUMENT if `count` is negative.
+  absl::StatusOr<std::vector<KeyPair>> Take(int64_t count);
+
+  // Fills the pool to its capacity on the calling thread, e.g., during
+  // start-up.
+  absl::Status Fill();
+
+  // Returns the number of rows that the key pairs select from, i.e., the DPF
+  // domain used by the servers. Shifts are taken modulo this number.
+  int64_t num_rows() const { return num_rows_; }
+
+  // Returns the number of key pairs currently in the pool.
+  int64_t size() const;
+
+  // Returns a snapshot of the current counters.
+  Stats GetStats() const;
+
+ private:
+  static constexpr int kBitsPerBlock = 8 * sizeof(absl::uint128);
+
+  DenseDpfPirKeyPool(std::unique_ptr<DistributedPointFunction> dpf,
+                     int64_t num_rows, Options options);
+
+  // Generates `count` key pairs for uniformly random rows.
+  absl::StatusOr<std::vector<KeyPair>> GenerateKeyPairs(int64_t count) const;
+
+  // Adds `key_pairs` to the pool, up to its capacity.
+  void AddKeyPairs(std::vector<KeyPair> key_pairs);
+
+  // Body of the background thread.
+  void RefillLoop();
+
+  // Condition for the background thread to wake up.
+  bool NeedsRefillOrStopping() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const std::unique_ptr<DistributedPointFunction> dpf_;
+  const int64_t num_rows_;
+  const Options options_;
+
+  mutable absl::Mutex mu_;
+  std::vector<KeyPair> key_pairs_ ABSL_GUARDED_BY(mu_);
+  Stats stats_ ABSL_GUARDED_BY(mu_);
+  bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+
+  // Started last in `Create`, and joined in the destructor.
+  std::thread refill_thread_;
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_DENSE_DPF_PIR_KEY_POOL_H_
@@ -0,0 +1,174 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/dense_dpf_pir_key_pool.h"
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/internal/status_matchers.h"
+#include "dpf/xor_wrapper.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "pir/dense_dpf_pir_server.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::StatusIs;
+using ::testing::HasSubstr;
+using Options = DenseDpfPirKeyPool::Options;
+
+constexpr int kTestDatabaseElements = 1234;
+constexpr int kBitsPerBlock = 128;
+
+PirConfig CreateConfig(int64_t records_per_row = 1) {
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(
+      kTestDatabaseElements);
+  config.mutable_dense_dpf_pir_config()->set_records_per_row(records_per_row);
+  return config;
+}
+
+Options ForegroundOptions(int64_t capacity) {
+  Options options;
+  options.capacity = capacity;
+  options.refill_threshold = 0;
+  options.refill_in_background = false;
+  return options;
+}
+
+TEST(DenseDpfPirKeyPool, CreateFailsIfConfigIsInvalid) {
+  EXPECT_THAT(DenseDpfPirKeyPool::Create(PirConfig(), Options()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("DenseDpfPirConfig")));
+}
+
+TEST(DenseDpfPirKeyPool, CreateFailsIfOptionsAreInvalid) {
+  Options options;
+  options.capacity = 0;
+  EXPECT_THAT(DenseDpfPirKeyPool::Create(CreateConfig(), options),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`capacity` must be positive"));
+  options.capacity = 10;
+  options.refill_threshold = 11;
+  EXPECT_THAT(DenseDpfPirKeyPool::Create(CreateConfig(), options),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`refill_threshold`")));
+}
+
+TEST(DenseDpfPirKeyPool, NumRowsMatchesServer) {
+  for (int64_t records_per_row : {1, 7}) {
+    const PirConfig config = CreateConfig(records_per_row);
+    DPF_ASSERT_OK_AND_ASSIGN(
+        auto pool, DenseDpfPirKeyPool::Create(config, ForegroundOptions(1)));
+    EXPECT_EQ(pool->num_rows(),
+              DenseDpfPirServer::NumRows(config.dense_dpf_pir_config()));
+  }
+}
+
+TEST(DenseDpfPirKeyPool, TakeFailsIfCountIsNegative) {
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto pool,
+      DenseDpfPirKeyPool::Create(CreateConfig(), ForegroundOptions(1)));
+  EXPECT_THAT(pool->Take(-1), StatusIs(absl::StatusCode::kInvalidArgument,
+                                       "`count` must not be negative"));
+}
+
+TEST(DenseDpfPirKeyPool, KeyPairsSelectTheirRow) {
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto pool,
+      DenseDpfPirKeyPool::Create(CreateConfig(), ForegroundOptions(20)));
+  DpfParameters parameters;
+  parameters.mutable_value_type()->mutable_xor_wrapper()->set_bitsize(
+      kBitsPerBlock);
+  parameters.set_log_domain_size(
+      static_cast<int>(std::ceil(std::log2(kTestDatabaseElements))));
+  DPF_ASSERT_OK_AND_ASSIGN(auto dpf,
+                           DistributedPointFunction::Create(parameters));
+
+  DPF_ASSERT_OK(pool->Fill());
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<DenseDpfPirKeyPool::KeyPair> key_pairs,
+                           pool->Take(20));
+  ASSERT_EQ(key_pairs.size(), 20);
+  absl::flat_hash_set<int64_t> rows;
+  for (const DenseDpfPirKeyPool::KeyPair& key_pair : key_pairs) {
+    ASSERT_GE(key_pair.row, 0);
+    ASSERT_LT(key_pair.row, kTestDatabaseElements);
+    rows.insert(key_pair.row);
+    const absl::uint128 block = key_pair.row / kBitsPerBlock;
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<XorWrapper<absl::uint128>> leader_share,
+        dpf->EvaluateAt<XorWrapper<absl::uint128>>(key_pair.leader_key, 0,
+                                                   {block}));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::vector<XorWrapper<absl::uint128>> helper_share,
+        dpf->EvaluateAt<XorWrapper<absl::uint128>>(key_pair.helper_key, 0,
+                                                   {block}));
+    EXPECT_EQ((leader_share[0] + helper_share[0]).value(),
+              absl::uint128{1} << (key_pair.row % kBitsPerBlock));
+  }
+
+  // Rows are random, so they should not all be equal.
+  EXPECT_GT(rows.size(), 1);
+}
+
+TEST(DenseDpfPirKeyPool, TakeGeneratesMissingKeyPairs) {
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto pool,
+      DenseDpfPirKeyPool::Create(CreateConfig(), ForegroundOptions(5)));
+  DPF_ASSERT_OK(pool->Fill());
+  EXPECT_EQ(pool->size(), 5);
+
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<DenseDpfPirKeyPool::KeyPair> key_pairs,
+                           pool->Take(8));
+  EXPECT_EQ(key_pairs.size(), 8);
+  EXPECT_EQ(pool->size(), 0);
+  DenseDpfPirKeyPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(stats.keys_generated, 5);
+  EXPECT_EQ(stats.keys_taken, 8);
+  EXPECT_EQ(stats.misses, 3);
+}
+
+TEST(DenseDpfPirKeyPool, RefillsInBackground) {
+  Options options;
+  options.capacity = 100;
+  options.refill_threshold = 50;
+  DPF_ASSERT_OK_AND_ASSIGN(auto pool,
+                           DenseDpfPirKeyPool::Create(CreateConfig(), options));
+
+  // Wait for the initial fill, then drain the pool below the threshold and
+  // wait for the refill.
+  for (int round = 0; round < 2; ++round) {
+    const absl::Time deadline = absl::Now() + absl::Seconds(60);
+    while (pool->size() < options.capacity && absl::Now() < deadline) {
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+    ASSERT_EQ(pool->size(), options.capacity);
+    DPF_ASSERT_OK(pool->Take(60).status());
+  }
+  EXPECT_GE(pool->GetStats().keys_generated, 2 * options.capacity - 40);
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
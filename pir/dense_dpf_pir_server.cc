@@ -14,7 +14,9 @@
 
 #include "pir/dense_dpf_pir_server.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <memory>
 #include <new>
 #include <string>
@@ -25,16 +27,75 @@
 #include "absl/numeric/int128.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "dpf/distributed_point_function.h"
 #include "dpf/status_macros.h"
+#include "dpf/xor_wrapper.h"
 #include "pir/private_information_retrieval.pb.h"
 
 namespace distributed_point_functions {
 
+namespace {
+
+// Wraps `inner_products` into a PirResponse, one masked response each.
+PirResponse InnerProductsToResponse(std::vector<std::string> inner_products) {
+  PirResponse response;
+  for (std::string& inner_product : inner_products) {
+    *(response.mutable_dpf_pir_response()->add_masked_response()) =
+        std::move(inner_product);
+  }
+  return response;
+}
+
+constexpr int kBitsPerBlock = 8 * sizeof(absl::uint128);
+
+// Writes the first `num_bits` bits of `input` to `output`, cyclically shifted
+// by `shift`, i.e., bit `(j + shift) mod num_bits` of `output` is bit `j` of
+// `input`. Bits of `output` beyond `num_bits` are set to zero. `shift` must be
+// in [0, num_bits).
+void ShiftSelectionBits(absl::Span<const XorWrapper<absl::uint128>> input,
+                        int64_t num_bits, int64_t shift,
+                        absl::Span<XorWrapper<absl::uint128>> output) {
+  for (int64_t k = 0; k < output.size(); ++k) {
+    const int64_t begin = k * kBitsPerBlock;
+    const int64_t end = std::min(begin + kBitsPerBlock, num_bits);
+    int64_t source = begin - shift;
+    if (source < 0) {
+      source += num_bits;
+    }
+    absl::uint128 block = 0;
+    if (end - begin == kBitsPerBlock && source + kBitsPerBlock <= num_bits) {
+      // The source bits are contiguous, so we can copy them as a whole.
+      const int64_t index = source / kBitsPerBlock;
+      const int offset = source % kBitsPerBlock;
+      block = input[index].value() >> offset;
+      if (offset != 0) {
+        block |= input[index + 1].value() << (kBitsPerBlock - offset);
+      }
+    } else {
+      // Only happens for the blocks where the source wraps around, and for the
+      // last block.
+      for (int64_t j = begin; j < end; ++j, ++source) {
+        if (source == num_bits) {
+          source = 0;
+        }
+        const absl::uint128 bit =
+            input[source / kBitsPerBlock].value() >> (source % kBitsPerBlock);
+        block |= (bit & 1) << (j - begin);
+      }
+    }
+    output[k] = XorWrapper<absl::uint128>(block);
+  }
+}
+
+}  // namespace
+
 DenseDpfPirServer::DenseDpfPirServer(
     std::unique_ptr<DistributedPointFunction> dpf,
-    std::unique_ptr<Database> database)
-    : dpf_(std::move(dpf)), database_(std::move(database)) {}
+    std::unique_ptr<Database> database, int64_t num_rows)
+    : dpf_(std::move(dpf)),
+      database_(std::move(database)),
+      num_rows_(num_rows) {}
 
 absl::StatusOr<std::unique_ptr<DenseDpfPirServer>>
 DenseDpfPirServer::CreateLeader(const PirConfig& config,
@@ -68,29 +129,38 @@ DenseDpfPirServer::CreatePlain(const PirConfig& config,
   if (config.dense_dpf_pir_config().num_elements() <= 0) {
     return absl::InvalidArgumentError("`num_elements` must be positive");
   }
-  if (database->size() != config.dense_dpf_pir_config().num_elements()) {
+  if (config.dense_dpf_pir_config().records_per_row() < 0) {
+    return absl::InvalidArgumentError("`records_per_row` must not be negative");
+  }
+  const int64_t num_rows = NumRows(config.dense_dpf_pir_config());
+  if (database->size() != num_rows) {
     return absl::InvalidArgumentError(
         "Database size does not match the config size");
   }
 
   DpfParameters parameters;
-  parameters.set_log_domain_size(static_cast<int>(
-      std::ceil(std::log2(config.dense_dpf_pir_config().num_elements()))));
+  parameters.set_log_domain_size(
+      static_cast<int>(std::ceil(std::log2(num_rows))));
   parameters.mutable_value_type()->mutable_xor_wrapper()->set_bitsize(
       kDpfBlockSize);
   DPF_ASSIGN_OR_RETURN(auto dpf, DistributedPointFunction::Create(parameters));
 
   return absl::WrapUnique(
-      new DenseDpfPirServer(std::move(dpf), std::move(database)));
+      new DenseDpfPirServer(std::move(dpf), std::move(database), num_rows));
+}
+
+int64_t DenseDpfPirServer::NumRows(const DenseDpfPirConfig& config) {
+  const int64_t records_per_row =
+      std::max<int64_t>(config.records_per_row(), 1);
+  return (config.num_elements() + records_per_row - 1) / records_per_row;
 }
 
 const PirServerPublicParams& DenseDpfPirServer::GetPublicParams() const {
   return PirServerPublicParams::default_instance();
 }
 
-// Computes the response to the client's `request`.
-absl::StatusOr<PirResponse> DenseDpfPirServer::HandlePlainRequest(
-    const PirRequest& request) const {
+absl::StatusOr<std::vector<XorWrapper<absl::uint128>>>
+DenseDpfPirServer::EvaluateSelections(const PirRequest& request) const {
   if (request.wrapped_pir_request_case() != PirRequest::kDpfPirRequest) {
     return absl::InvalidArgumentError(
         "`request` does not contain a valid DpfPirRequest");
@@ -105,25 +175,117 @@ absl::StatusOr<PirResponse> DenseDpfPirServer::HandlePlainRequest(
   if (plain_request.dpf_key_size() == 0) {
     return absl::InvalidArgumentError("`dpf_key` must not be empty");
   }
+  const int num_shifts = plain_request.index_shifts_size();
+  if (num_shifts != 0 && num_shifts != plain_request.dpf_key_size()) {
+    return absl::InvalidArgumentError(
+        "Number of `index_shifts` must match the number of DPF keys");
+  }
+  for (const int64_t shift : plain_request.index_shifts()) {
+    if (shift < 0 || shift >= num_rows_) {
+      return absl::InvalidArgumentError(
+          "All `index_shifts` must be in [0, num_rows)");
+    }
+  }
 
-  std::vector<std::vector<XorWrapper<absl::uint128>>> selections(
-      plain_request.dpf_key_size());
-  for (int i = 0; i < plain_request.dpf_key_size(); ++i) {
-    // Evaluate DPF and compute inner product with the database.
-    DPF_ASSIGN_OR_RETURN(
-        auto ctx, dpf_->CreateEvaluationContext(plain_request.dpf_key(i)));
+  // Evaluate all keys together, so that their (small) trees share AES batches.
+  // Each output holds the selection bits of kDpfBlockSize rows, so the domain
+  // beyond the last row doesn't need to be expanded. The outputs of each key
+  // are contiguous, so they can be passed to the database as they are.
+  const int64_t blocks_per_key =
+      (num_rows_ + kDpfBlockSize - 1) / kDpfBlockSize;
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<XorWrapper<absl::uint128>> selections,
+      dpf_->EvaluateUntilBatch<XorWrapper<absl::uint128>>(
+          0,
+          absl::MakeConstSpan(plain_request.dpf_key().data(),
+                              plain_request.dpf_key_size()),
+          blocks_per_key));
+
+  // Move the selected rows of keys generated for random rows to the queried
+  // rows. This is linear in the number of rows, but cheap compared to the inner
+  // product with the database.
+  std::vector<XorWrapper<absl::uint128>> unshifted;
+  for (int k = 0; k < num_shifts; ++k) {
+    if (plain_request.index_shifts(k) == 0) {
+      continue;
+    }
+    const absl::Span<XorWrapper<absl::uint128>> selection =
+        absl::MakeSpan(selections).subspan(k * blocks_per_key, blocks_per_key);
+    unshifted.assign(selection.begin(), selection.end());
+    ShiftSelectionBits(unshifted, num_rows_, plain_request.index_shifts(k),
+                       selection);
+  }
+  return selections;
+}
+
+// Computes the response to the client's `request`.
+absl::StatusOr<PirResponse> DenseDpfPirServer::HandlePlainRequest(
+    const PirRequest& request) const {
+  // Evaluate DPF and compute inner product with the database.
+  DPF_ASSIGN_OR_RETURN(std::vector<XorWrapper<absl::uint128>> selections,
+                       EvaluateSelections(request));
+  const DpfPirRequest::PlainRequest& plain_request =
+      request.dpf_pir_request().plain_request();
+  const int num_keys = plain_request.dpf_key_size();
+  if (!plain_request.projected_columns().empty()) {
+    // Only the requested columns are read from the database.
     DPF_ASSIGN_OR_RETURN(
-        selections[i], dpf_->EvaluateNext<XorWrapper<absl::uint128>>({}, ctx));
+        std::vector<std::string> inner_products,
+        database_->InnerProductWithColumns(
+            SplitSelections(absl::MakeConstSpan(selections), num_keys),
+            plain_request.projected_columns()));
+    return InnerProductsToResponse(std::move(inner_products));
+  }
+  PirResponse response;
+  absl::Status status =
+      AppendInnerProducts(*database_, absl::MakeConstSpan(selections),
+                          num_keys, response);
+  if (!absl::IsUnimplemented(status)) {
+    DPF_RETURN_IF_ERROR(status);
+    return response;
   }
 
+  // The database can only return newly allocated inner products.
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<std::string> inner_products,
+      database_->InnerProductWith(SplitSelections(
+          absl::MakeConstSpan(selections), num_keys)));
+  return InnerProductsToResponse(std::move(inner_products));
+}
+
+absl::Status DenseDpfPirServer::HandlePlainRequestChunked(
+    const PirRequest& request, int64_t chunk_size,
+    ResponseChunkSink sink) const {
+  if (!request.dpf_pir_request().plain_request().projected_columns().empty()) {
+    // Chunked responses require all masked responses to have the same size,
+    // which does not hold for columns of different sizes.
+    return absl::InvalidArgumentError(
+        "`projected_columns` is not supported for chunked requests");
+  }
+  DPF_ASSIGN_OR_RETURN(std::vector<XorWrapper<absl::uint128>> flat_selections,
+                       EvaluateSelections(request));
+  const std::vector<std::vector<XorWrapper<absl::uint128>>> selections =
+      SplitSelections(
+          absl::MakeConstSpan(flat_selections),
+          request.dpf_pir_request().plain_request().dpf_key_size());
+  absl::Status status = database_->InnerProductWithChunked(
+      selections, chunk_size,
+      [sink](int64_t offset, int64_t response_size,
+             std::vector<std::string> chunks) {
+        PirResponse chunk = InnerProductsToResponse(std::move(chunks));
+        chunk.mutable_dpf_pir_response()->set_chunk_offset(offset);
+        chunk.mutable_dpf_pir_response()->set_response_size(response_size);
+        return sink(std::move(chunk));
+      });
+  if (!absl::IsUnimplemented(status)) {
+    return status;
+  }
+
+  // The database can only compute whole records.
   DPF_ASSIGN_OR_RETURN(std::vector<std::string> inner_products,
                        database_->InnerProductWith(selections));
-  PirResponse response;
-  for (int i = 0; i < inner_products.size(); ++i) {
-    *(response.mutable_dpf_pir_response()->add_masked_response()) =
-        std::move(inner_products[i]);
-  }
-  return response;
+  return SplitResponseIntoChunks(
+      InnerProductsToResponse(std::move(inner_products)), chunk_size, sink);
 }
 
 }  // namespace distributed_point_functions
@@ -17,14 +17,18 @@
 #ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_DENSE_DPF_PIR_SERVER_H_
 #define DISTRIBUTED_POINT_FUNCTIONS_PIR_DENSE_DPF_PIR_SERVER_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/functional/any_invocable.h"
 #include "absl/numeric/int128.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "dpf/distributed_point_function.h"
+#include "dpf/xor_wrapper.h"
 #include "pir/dpf_pir_server.h"
 #include "pir/pir_database_interface.h"
 #include "pir/private_information_retrieval.pb.h"
@@ -85,6 +89,11 @@ class DenseDpfPirServer : public DpfPirServer {
   static absl::StatusOr<std::unique_ptr<DenseDpfPirServer>> CreatePlain(
       const PirConfig& config, std::unique_ptr<Database> database);
 
+  // Returns the number of database entries (i.e., DPF domain elements) needed
+  // for the given `config`. This is `config.num_elements()` divided by
+  // `config.records_per_row()`, rounded up.
+  static int64_t NumRows(const DenseDpfPirConfig& config);
+
   // Returns a reference to the server's database.
   const Database& database() const { return *database_; }
 
@@ -95,19 +104,40 @@ class DenseDpfPirServer : public DpfPirServer {
   const PirServerPublicParams& GetPublicParams() const override;
 
  protected:
-  // Computes the response to the client's `request`. Should not be called by
+  // Computes the response to the client's `request`. If the request lists
+  // `projected_columns`, only these columns of each selected record are
+  // returned, which requires a database supporting
+  // `InnerProductWithColumns`, such as ColumnarDenseDpfPirDatabase. If the
+  // request has `index_shifts`, the selection vector of each key is shifted
+  // cyclically before computing the inner product. Should not be called by
   // users, but only from DpfPirServer::HandleRequest.
   absl::StatusOr<PirResponse> HandlePlainRequest(
       const PirRequest& request) const override;
 
+  // Computes the response to the client's `request` in chunks of
+  // `chunk_size` bytes (rounded up to a multiple of 64) per DPF key, if
+  // supported by the database. Should not be called by users, but only from
+  // DpfPirServer::HandleRequestChunked.
+  absl::Status HandlePlainRequestChunked(const PirRequest& request,
+                                         int64_t chunk_size,
+                                         ResponseChunkSink sink) const override;
+
  private:
   static constexpr int kDpfBlockSize = 8 * sizeof(absl::uint128);
 
   DenseDpfPirServer(std::unique_ptr<DistributedPointFunction> dpf,
-                    std::unique_ptr<Database> database);
+                    std::unique_ptr<Database> database, int64_t num_rows);
+
+  // Checks that `request` is a valid PlainRequest and evaluates its DPF keys
+  // on the blocks of selection bits covering all rows, applying the request's
+  // `index_shifts` if present. Returns the selection vectors of all keys back
+  // to back.
+  absl::StatusOr<std::vector<XorWrapper<absl::uint128>>> EvaluateSelections(
+      const PirRequest& request) const;
 
   std::unique_ptr<DistributedPointFunction> dpf_;
   std::unique_ptr<Database> database_;
+  int64_t num_rows_;
 };
 
 }  // namespace distributed_point_functions
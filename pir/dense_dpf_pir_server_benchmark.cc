@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -23,6 +24,7 @@
 #include "absl/random/random.h"
 #include "absl/types/span.h"
 #include "benchmark/benchmark.h"  // third_party/benchmark
+#include "dpf/internal/memory_counters.h"
 #include "dpf/internal/status_matchers.h"
 #include "pir/dense_dpf_pir_database.h"
 #include "pir/dense_dpf_pir_server.h"
@@ -31,7 +33,7 @@
 
 // We use the following flags instead of benchmark arguments to set the database
 // dimension and query size for all the benchmarks to avoid recompilation.
-ABSL_FLAG(int, num_records, 1 << 16,
+ABSL_FLAG(int64_t, num_records, 1 << 16,
           "The number of records in the dense database.");
 ABSL_FLAG(int, num_bytes_per_record, 128,
           "The number of bytes in each record.");
@@ -44,7 +46,7 @@ namespace {
 // Benchmarks `HandlePlainRequest()` which is the core part of `HandleRequest()`
 // on both the main and the helper server.
 void BM_HandlePlainRequestWithEqualSizeRecords(benchmark::State& state) {
-  int num_records = absl::GetFlag(FLAGS_num_records);
+  int64_t num_records = absl::GetFlag(FLAGS_num_records);
   int num_bytes_per_record = absl::GetFlag(FLAGS_num_bytes_per_record);
   int num_indices_per_request = absl::GetFlag(FLAGS_num_indices_per_request);
 
@@ -73,14 +75,15 @@ void BM_HandlePlainRequestWithEqualSizeRecords(benchmark::State& state) {
           num_records, DenseDpfPirServer::kEncryptionContextInfo));
   absl::BitGen bitgen;
 
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto _ : state) {
     state.PauseTiming();
 
     // Generate dense PIR queries for random indices.
-    std::vector<int> indices;
+    std::vector<int64_t> indices;
     indices.reserve(num_indices_per_request);
     for (int i = 0; i < num_indices_per_request; ++i) {
-      indices.push_back(absl::Uniform<int>(bitgen, 0, num_records));
+      indices.push_back(absl::Uniform<int64_t>(bitgen, 0, num_records));
     }
 
     PirRequest request1, request2;
@@ -97,6 +100,79 @@ void BM_HandlePlainRequestWithEqualSizeRecords(benchmark::State& state) {
 }
 BENCHMARK(BM_HandlePlainRequestWithEqualSizeRecords);
 
+// Benchmarks `HandlePlainRequest()` with the database laid out as a matrix
+// with `state.range(0)` records per row. Larger rows reduce the DPF domain size
+// at the cost of larger responses.
+void BM_HandlePlainRequestWithMatrixLayout(benchmark::State& state) {
+  int64_t num_records = absl::GetFlag(FLAGS_num_records);
+  int num_bytes_per_record = absl::GetFlag(FLAGS_num_bytes_per_record);
+  int num_indices_per_request = absl::GetFlag(FLAGS_num_indices_per_request);
+  int records_per_row = state.range(0);
+
+  // Setup PIR parameters.
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(num_records);
+  config.mutable_dense_dpf_pir_config()->set_records_per_row(records_per_row);
+  const int64_t num_rows =
+      DenseDpfPirServer::NumRows(config.dense_dpf_pir_config());
+
+  // Build a dense database with random records grouped into rows.
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<std::string> values,
+                           pir_testing::GenerateRandomStringsEqualSize(
+                               num_records, num_bytes_per_record));
+  DenseDpfPirDatabase::Builder builder;
+  builder.SetRecordsPerRow(records_per_row);
+  for (auto& value : values) {
+    builder.Insert(std::move(value));
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(auto database, builder.Build());
+
+  // Create the server.
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<DenseDpfPirServer> server,
+      DenseDpfPirServer::CreatePlain(config, std::move(database)));
+
+  // The DPF domain consists of the rows of the database.
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto request_generator,
+      pir_testing::RequestGenerator::Create(
+          num_rows, DenseDpfPirServer::kEncryptionContextInfo));
+  absl::BitGen bitgen;
+
+  int64_t response_bytes = 0;
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+
+    // Generate dense PIR queries for random rows.
+    std::vector<int64_t> indices;
+    indices.reserve(num_indices_per_request);
+    for (int i = 0; i < num_indices_per_request; ++i) {
+      indices.push_back(absl::Uniform<int64_t>(bitgen, 0, num_rows));
+    }
+
+    PirRequest request1, request2;
+    DPF_ASSERT_OK_AND_ASSIGN(
+        std::tie(*request1.mutable_dpf_pir_request()->mutable_plain_request(),
+                 *request2.mutable_dpf_pir_request()->mutable_plain_request()),
+        request_generator->CreateDpfPirPlainRequests(indices));
+
+    // Record the time to handle the request on a single server.
+    state.ResumeTiming();
+    auto response = server->HandleRequest(request1);
+    benchmark::DoNotOptimize(response);
+    state.PauseTiming();
+    DPF_ASSERT_OK(response);
+    response_bytes = response->ByteSizeLong();
+    state.ResumeTiming();
+  }
+  state.counters["response_bytes"] = response_bytes;
+}
+BENCHMARK(BM_HandlePlainRequestWithMatrixLayout)
+    ->ArgName("records_per_row")
+    ->RangeMultiplier(4)
+    ->Range(1, 1 << 10);
+
 }  // namespace
 }  // namespace distributed_point_functions
 
@@ -148,6 +148,41 @@ TEST(DenseDpfPirServer, CreateFailsIfDatabaseSizeDoesNotMatchConfig) {
                        HasSubstr("size does not match")));
 }
 
+TEST(DenseDpfPirServer, CreateFailsIfRecordsPerRowIsNegative) {
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(
+      kTestDatabaseElements);
+  config.mutable_dense_dpf_pir_config()->set_records_per_row(-1);
+  auto database = std::make_unique<MockDenseDpfPirDatbase>();
+
+  EXPECT_THAT(DenseDpfPirServer::CreatePlain(config, std::move(database)),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("records_per_row")));
+}
+
+TEST(DenseDpfPirServer, CreateWithMatrixLayoutExpectsOneEntryPerRow) {
+  constexpr int kRecordsPerRow = 10;
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(
+      kTestDatabaseElements);
+  config.mutable_dense_dpf_pir_config()->set_records_per_row(kRecordsPerRow);
+  const int num_rows =
+      DenseDpfPirServer::NumRows(config.dense_dpf_pir_config());
+  EXPECT_EQ(num_rows, (kTestDatabaseElements + kRecordsPerRow - 1) /
+                          kRecordsPerRow);
+
+  auto database1 = std::make_unique<MockDenseDpfPirDatbase>();
+  EXPECT_CALL(*database1, size()).WillOnce(Return(kTestDatabaseElements));
+  EXPECT_THAT(DenseDpfPirServer::CreatePlain(config, std::move(database1)),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("size does not match")));
+
+  auto database2 = std::make_unique<MockDenseDpfPirDatbase>();
+  EXPECT_CALL(*database2, size()).WillOnce(Return(num_rows));
+  EXPECT_THAT(DenseDpfPirServer::CreatePlain(config, std::move(database2)),
+              IsOkAndHolds(NotNull()));
+}
+
 class DenseDpfPirServerTest : public ::testing::Test {
  protected:
   void SetUp() override {
@@ -362,5 +397,102 @@ TEST_F(DenseDpfPirServerTest,
             result3.dpf_pir_response().masked_response(1));
 }
 
+TEST_F(DenseDpfPirServerTest,
+       HandleRequestWithProjectedColumnsFailsIfDatabaseIsNotColumnar) {
+  PirRequest request;
+  SetupFakeRequest(123, request);
+  request.mutable_dpf_pir_request()
+      ->mutable_plain_request()
+      ->add_projected_columns(0);
+
+  EXPECT_THAT(server_->HandleRequest(request),
+              StatusIs(absl::StatusCode::kUnimplemented,
+                       HasSubstr("InnerProductWithColumns")));
+}
+
+TEST_F(DenseDpfPirServerTest,
+       HandleRequestChunkedFailsIfRequestHasProjectedColumns) {
+  PirRequest request;
+  SetupFakeRequest(123, request);
+  request.mutable_dpf_pir_request()
+      ->mutable_plain_request()
+      ->add_projected_columns(0);
+
+  EXPECT_THAT(
+      server_->HandleRequestChunked(
+          request, 64, [](PirResponse chunk) { return absl::OkStatus(); }),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("projected_columns")));
+}
+
+TEST_F(DenseDpfPirServerTest, HandleRequestFailsIfIndexShiftsDontMatchKeys) {
+  PirRequest request;
+  SetupFakeRequest(123, request);
+  request.mutable_dpf_pir_request()->mutable_plain_request()->add_index_shifts(
+      1);
+  request.mutable_dpf_pir_request()->mutable_plain_request()->add_index_shifts(
+      2);
+
+  EXPECT_THAT(server_->HandleRequest(request),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Number of `index_shifts`")));
+}
+
+TEST_F(DenseDpfPirServerTest, HandleRequestFailsIfIndexShiftIsOutOfRange) {
+  for (int64_t shift : {int64_t{-1}, int64_t{kTestDatabaseElements}}) {
+    PirRequest request;
+    SetupFakeRequest(123, request);
+    request.mutable_dpf_pir_request()
+        ->mutable_plain_request()
+        ->add_index_shifts(shift);
+
+    EXPECT_THAT(server_->HandleRequest(request),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("index_shifts")));
+  }
+}
+
+TEST_F(DenseDpfPirServerTest, HandleRequestShiftsSelectionsCyclically) {
+  const int num_blocks = (kTestDatabaseElements + kBitsPerBlock - 1) /
+                         kBitsPerBlock;
+  for (int64_t shift : {0, 1, 5, 127, 128, 129, 1000, 1106,
+                        kTestDatabaseElements - 1}) {
+    PirRequest request;
+    SetupFakeRequest(1200, request);
+    request.mutable_dpf_pir_request()
+        ->mutable_plain_request()
+        ->add_index_shifts(shift);
+    DPF_ASSERT_OK_AND_ASSIGN(
+        auto ctx, dpf_->CreateEvaluationContext(
+                      request.dpf_pir_request().plain_request().dpf_key(0)));
+    DPF_ASSERT_OK_AND_ASSIGN(
+        auto expansion,
+        dpf_->EvaluateNext<XorWrapper<absl::uint128>>({}, ctx));
+
+    // Capture the selection vector passed to the database.
+    std::vector<XorWrapper<absl::uint128>> selection;
+    EXPECT_CALL(*database_, InnerProductWith(::testing::SizeIs(1)))
+        .WillOnce([this, &selection](auto selections) {
+          selection = selections[0];
+          return this->InnerProductWith(selections);
+        });
+    DPF_ASSERT_OK(server_->HandleRequest(request).status());
+
+    // Each server only holds a share of the selection bits, so all bits have
+    // to be moved, not only the selected one.
+    ASSERT_EQ(selection.size(), num_blocks);
+    for (int64_t j = 0; j < kTestDatabaseElements; ++j) {
+      const int64_t shifted = (j + shift) % kTestDatabaseElements;
+      const absl::uint128 expected =
+          (expansion[j / kBitsPerBlock].value() >> (j % kBitsPerBlock)) & 1;
+      const absl::uint128 actual =
+          (selection[shifted / kBitsPerBlock].value() >>
+           (shifted % kBitsPerBlock)) &
+          1;
+      ASSERT_EQ(actual, expected) << "shift=" << shift << " j=" << j;
+    }
+  }
+}
+
 }  // namespace
 }  // namespace distributed_point_functions
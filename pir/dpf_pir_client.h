@@ -91,11 +91,14 @@ class DpfPirClient : public PirClient<QueryType, ResponseType> {
       : encrypter_(std::move(encrypter)),
         encryption_context_info_(std::move(encryption_context_info)) {}
 
- private:
+  // Encrypts `helper_plain_request` and wraps it together with
+  // `leader_plain_request` into a request to the Leader. Used by CreateRequest,
+  // and by subclasses that modify the plain requests before sending them.
   absl::StatusOr<PirRequest> PlainRequestsToLeaderRequest(
       DpfPirRequest::PlainRequest leader_plain_request,
       DpfPirRequest::HelperRequest helper_plain_request) const;
 
+ private:
   EncryptHelperRequestFn encrypter_;
   std::string encryption_context_info_;
 };
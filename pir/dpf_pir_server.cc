@@ -14,33 +14,125 @@
 
 #include "pir/dpf_pir_server.h"
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/functional/any_invocable.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "absl/types/variant.h"
+#include "dpf/distributed_point_function.pb.h"
 #include "dpf/status_macros.h"
 #include "pir/prng/aes_128_ctr_seeded_prng.h"
 #include "tink/hybrid_decrypt.h"
 
 namespace distributed_point_functions {
 
+namespace {
+
+// Hands the chunks computed by the Leader in HandleLeaderRequestChunked over
+// to the thread receiving the Helper's chunks, one at a time. This bounds the
+// number of Leader chunks held in memory, since the Leader pauses whenever it
+// is ahead of the Helper.
+class LeaderChunkHandoff {
+ public:
+  // Called by the Leader. Blocks until the previous chunk has been taken.
+  // Returns CANCELLED if no more chunks will be taken.
+  absl::Status Put(PirResponse chunk) {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(this, &LeaderChunkHandoff::CanPut));
+    if (cancelled_) {
+      return absl::CancelledError("The Helper's response has ended");
+    }
+    chunk_ = std::move(chunk);
+    return absl::OkStatus();
+  }
+
+  // Called by the Leader once it has computed all chunks, or failed.
+  void Finish(absl::Status status) {
+    absl::MutexLock lock(&mutex_);
+    // Errors caused by Cancel() are not the Leader's.
+    if (!cancelled_) {
+      status_ = std::move(status);
+    }
+    finished_ = true;
+  }
+
+  // Blocks until the Leader's next chunk is available, and returns it. Returns
+  // nullopt if the Leader has finished.
+  absl::optional<PirResponse> Take() {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(this, &LeaderChunkHandoff::CanTake));
+    absl::optional<PirResponse> chunk = std::move(chunk_);
+    chunk_.reset();
+    return chunk;
+  }
+
+  // Makes all current and future calls to Put return immediately.
+  void Cancel() {
+    absl::MutexLock lock(&mutex_);
+    cancelled_ = true;
+  }
+
+  // Returns the status passed to Finish.
+  absl::Status status() const {
+    absl::MutexLock lock(&mutex_);
+    return status_;
+  }
+
+ private:
+  bool CanPut() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return !chunk_.has_value() || cancelled_;
+  }
+  bool CanTake() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return chunk_.has_value() || finished_;
+  }
+
+  mutable absl::Mutex mutex_;
+  absl::optional<PirResponse> chunk_ ABSL_GUARDED_BY(mutex_);
+  absl::Status status_ ABSL_GUARDED_BY(mutex_);
+  bool finished_ ABSL_GUARDED_BY(mutex_) = false;
+  bool cancelled_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace
+
 DpfPirServer::DpfPirServer() : role_(Role::kPlain) {}
 
 absl::Status DpfPirServer::MakeLeader(ForwardHelperRequestFn sender) {
   if (sender == nullptr) {
     return absl::InvalidArgumentError("`sender` may not be null");
   }
-  role_storage_ = DpfPirLeader{std::move(sender)};
+  role_storage_ = DpfPirLeader{std::move(sender), nullptr};
   role_ = Role::kLeader;
   return absl::OkStatus();
 }
 
+absl::Status DpfPirServer::SetChunkedHelperSender(
+    ForwardHelperRequestChunkedFn sender) {
+  DpfPirLeader* leader = absl::get_if<DpfPirLeader>(&role_storage_);
+  if (leader == nullptr || role_ != Role::kLeader) {
+    return absl::FailedPreconditionError(
+        "SetChunkedHelperSender may only be called on a Leader");
+  }
+  if (sender == nullptr) {
+    return absl::InvalidArgumentError("`sender` may not be null");
+  }
+  leader->chunked_sender = std::move(sender);
+  return absl::OkStatus();
+}
+
 absl::Status DpfPirServer::MakeHelper(
     DecryptHelperRequestFn decrypter,
     absl::string_view encryption_context_info) {
@@ -52,6 +144,14 @@ absl::Status DpfPirServer::MakeHelper(
   return absl::OkStatus();
 }
 
+absl::Status DpfPirServer::CombineResponseShares(
+    absl::string_view share, std::string& accumulator) const {
+  for (int i = 0; i < accumulator.size(); ++i) {
+    accumulator[i] ^= share[i];
+  }
+  return absl::OkStatus();
+}
+
 absl::StatusOr<PirResponse> DpfPirServer::HandleRequest(
     const PirRequest& request) const {
   switch (role_) {
@@ -64,8 +164,117 @@ absl::StatusOr<PirResponse> DpfPirServer::HandleRequest(
   }
 }
 
-absl::StatusOr<PirResponse> DpfPirServer::HandleLeaderRequest(
-    const PirRequest& request) const {
+absl::Status DpfPirServer::HandleRequestChunked(
+    const PirRequest& request, int64_t chunk_size,
+    ResponseChunkSink sink) const {
+  if (chunk_size <= 0) {
+    return absl::InvalidArgumentError("`chunk_size` must be positive");
+  }
+  switch (role_) {
+    case Role::kPlain:
+      return HandlePlainRequestChunked(request, chunk_size, sink);
+    case Role::kLeader:
+      return HandleLeaderRequestChunked(request, chunk_size, sink);
+    case Role::kHelper:
+      return HandleHelperRequestChunked(request, chunk_size, sink);
+  }
+}
+
+absl::Status DpfPirServer::HandlePlainRequestChunked(
+    const PirRequest& request, int64_t chunk_size,
+    ResponseChunkSink sink) const {
+  DPF_ASSIGN_OR_RETURN(PirResponse response, HandlePlainRequest(request));
+  return SplitResponseIntoChunks(std::move(response), chunk_size, sink);
+}
+
+absl::Status DpfPirServer::SplitResponseIntoChunks(PirResponse response,
+                                                   int64_t chunk_size,
+                                                   ResponseChunkSink sink) {
+  if (chunk_size <= 0) {
+    return absl::InvalidArgumentError("`chunk_size` must be positive");
+  }
+  const DpfPirResponse& full_response = response.dpf_pir_response();
+  const int64_t response_size = full_response.masked_response_size() > 0
+                                    ? full_response.masked_response(0).size()
+                                    : 0;
+  for (int i = 0; i < full_response.masked_response_size(); ++i) {
+    if (full_response.masked_response(i).size() != response_size) {
+      return absl::InternalError(absl::StrCat(
+          "All responses must have the same size to be split into chunks, but "
+          "response ",
+          i, " has size ", full_response.masked_response(i).size(),
+          " instead of ", response_size));
+    }
+  }
+
+  // Always emit at least one chunk, so that the client learns the number of
+  // responses even if they are empty.
+  int64_t offset = 0;
+  do {
+    PirResponse chunk;
+    DpfPirResponse* dpf_chunk = chunk.mutable_dpf_pir_response();
+    dpf_chunk->set_chunk_offset(offset);
+    dpf_chunk->set_response_size(response_size);
+    for (const std::string& masked_response : full_response.masked_response()) {
+      dpf_chunk->add_masked_response(
+          masked_response.substr(offset, chunk_size));
+    }
+    DPF_RETURN_IF_ERROR(sink(std::move(chunk)));
+    offset += chunk_size;
+  } while (offset < response_size);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<PirResponse> DpfPirServer::AssembleResponseChunks(
+    absl::Span<const PirResponse> chunks) {
+  if (chunks.empty()) {
+    return absl::InvalidArgumentError("`chunks` must not be empty");
+  }
+  const DpfPirResponse& first_chunk = chunks[0].dpf_pir_response();
+  const int num_responses = first_chunk.masked_response_size();
+  const int64_t response_size = first_chunk.response_size();
+
+  PirResponse response;
+  DpfPirResponse* dpf_response = response.mutable_dpf_pir_response();
+  for (int i = 0; i < num_responses; ++i) {
+    dpf_response->add_masked_response()->reserve(response_size);
+  }
+  int64_t offset = 0;
+  for (int i = 0; i < chunks.size(); ++i) {
+    const DpfPirResponse& chunk = chunks[i].dpf_pir_response();
+    if (chunk.masked_response_size() != num_responses ||
+        chunk.response_size() != response_size) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Chunk ", i, " does not belong to the same response"));
+    }
+    if (chunk.chunk_offset() != offset) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Chunk ", i, " starts at offset ", chunk.chunk_offset(),
+                       ", expected ", offset));
+    }
+    const int64_t current_chunk_size =
+        num_responses > 0 ? chunk.masked_response(0).size() : 0;
+    for (int j = 0; j < num_responses; ++j) {
+      if (chunk.masked_response(j).size() != current_chunk_size ||
+          offset + current_chunk_size > response_size) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("Chunk ", i, " has an invalid size"));
+      }
+      dpf_response->mutable_masked_response(j)->append(
+          chunk.masked_response(j));
+    }
+    offset += current_chunk_size;
+  }
+  if (offset != response_size) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Chunks only cover ", offset, " of ", response_size,
+                     " bytes of each response"));
+  }
+  return response;
+}
+
+absl::StatusOr<std::pair<PirRequest, PirRequest>>
+DpfPirServer::SplitLeaderRequest(const PirRequest& request) {
   if (request.dpf_pir_request().wrapped_request_case() !=
       DpfPirRequest::kLeaderRequest) {
     return absl::InvalidArgumentError(
@@ -87,6 +296,14 @@ absl::StatusOr<PirResponse> DpfPirServer::HandleLeaderRequest(
   *(helper_request.mutable_dpf_pir_request()
         ->mutable_encrypted_helper_request()) =
       leader_request.encrypted_helper_request();
+  return std::make_pair(std::move(plain_request), std::move(helper_request));
+}
+
+absl::StatusOr<PirResponse> DpfPirServer::HandleLeaderRequest(
+    const PirRequest& request) const {
+  DPF_ASSIGN_OR_RETURN(auto requests, SplitLeaderRequest(request));
+  const PirRequest& plain_request = requests.first;
+  const PirRequest& helper_request = requests.second;
 
   // Lambda for the callback executed by `sender`. We make sure that it is
   // actually run, to avoid accidental misuse.
@@ -137,21 +354,107 @@ absl::StatusOr<PirResponse> DpfPirServer::HandleLeaderRequest(
                        current_helper_response.size(), " (Helper) vs. ",
                        current_leader_response.size(), " (Leader)"));
     }
-    for (int j = 0; j < current_helper_response.size(); ++j) {
-      current_leader_response[j] ^= current_helper_response[j];
-    }
+    DPF_RETURN_IF_ERROR(CombineResponseShares(current_helper_response,
+                                              current_leader_response));
   }
   return leader_response;
 }
 
-absl::StatusOr<PirResponse> DpfPirServer::HandleHelperRequest(
+absl::Status DpfPirServer::HandleLeaderRequestChunked(
+    const PirRequest& request, int64_t chunk_size,
+    ResponseChunkSink sink) const {
+  const DpfPirLeader* leader = absl::get_if<DpfPirLeader>(&role_storage_);
+  if (leader == nullptr || role_ != Role::kLeader) {
+    return absl::InternalError(
+        "`HandleLeaderRequestChunked` called when DpfPirServer was not "
+        "initialized as a Leader. This should never happen.");
+  }
+  if (leader->chunked_sender == nullptr) {
+    // The Helper's response can only be combined with our own once it has
+    // arrived as a whole.
+    DPF_ASSIGN_OR_RETURN(PirResponse response, HandleLeaderRequest(request));
+    return SplitResponseIntoChunks(std::move(response), chunk_size, sink);
+  }
+  DPF_ASSIGN_OR_RETURN(auto requests, SplitLeaderRequest(request));
+
+  // Compute our chunks on a separate thread while the Helper streams its own,
+  // and combine each of our chunks with the Helper's chunk at the same offset.
+  LeaderChunkHandoff handoff;
+  std::thread leader_thread([this, &requests, chunk_size, &handoff] {
+    handoff.Finish(HandlePlainRequestChunked(
+        requests.first, chunk_size,
+        [&handoff](PirResponse chunk) {
+          return handoff.Put(std::move(chunk));
+        }));
+  });
+  absl::Status status = leader->chunked_sender(
+      requests.second, chunk_size,
+      [this, &handoff, &sink](PirResponse helper_chunk) -> absl::Status {
+        absl::optional<PirResponse> leader_chunk = handoff.Take();
+        if (!leader_chunk.has_value()) {
+          DPF_RETURN_IF_ERROR(handoff.status());
+          return absl::InternalError(
+              "Helper sent more chunks than the Leader computed");
+        }
+        DPF_RETURN_IF_ERROR(CombineResponseChunks(
+            helper_chunk.dpf_pir_response(),
+            *(leader_chunk->mutable_dpf_pir_response())));
+        return sink(*std::move(leader_chunk));
+      });
+  if (status.ok() && handoff.Take().has_value()) {
+    status = absl::InternalError(
+        "Leader computed more chunks than the Helper sent");
+  }
+  handoff.Cancel();
+  leader_thread.join();
+  DPF_RETURN_IF_ERROR(handoff.status());
+  return status;
+}
+
+absl::Status DpfPirServer::CombineResponseChunks(
+    const DpfPirResponse& helper_chunk, DpfPirResponse& leader_chunk) const {
+  if (helper_chunk.masked_response_size() !=
+      leader_chunk.masked_response_size()) {
+    return absl::InternalError(absl::StrCat(
+        "Number of responses from Helper (=",
+        helper_chunk.masked_response_size(),
+        ")  does not match the number of responses from Leader (=",
+        leader_chunk.masked_response_size(), ")"));
+  }
+  if (helper_chunk.chunk_offset() != leader_chunk.chunk_offset() ||
+      helper_chunk.response_size() != leader_chunk.response_size()) {
+    return absl::InternalError(absl::StrCat(
+        "Chunk mismatch: Helper sent offset ", helper_chunk.chunk_offset(),
+        " of ", helper_chunk.response_size(), " bytes, Leader computed offset ",
+        leader_chunk.chunk_offset(), " of ", leader_chunk.response_size(),
+        " bytes"));
+  }
+  for (int i = 0; i < leader_chunk.masked_response_size(); ++i) {
+    absl::string_view helper_share = helper_chunk.masked_response(i);
+    std::string& leader_share = *(leader_chunk.mutable_masked_response(i));
+    if (helper_share.size() != leader_share.size()) {
+      return absl::InternalError(absl::StrCat(
+          "Response size mismatch at index ", i, ": Got ", helper_share.size(),
+          " (Helper) vs. ", leader_share.size(), " (Leader)"));
+    }
+    DPF_RETURN_IF_ERROR(CombineResponseShares(helper_share, leader_share));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<DpfPirRequest::HelperRequest> DpfPirServer::DecryptHelperRequest(
     const PirRequest& request) const {
   if (request.dpf_pir_request().wrapped_request_case() !=
       DpfPirRequest::kEncryptedHelperRequest) {
     return absl::InvalidArgumentError(
         "`request` must be a valid EncryptedHelperRequest");
   }
+  return DecryptHelperRequest(
+      request.dpf_pir_request().encrypted_helper_request());
+}
 
+absl::StatusOr<DpfPirRequest::HelperRequest> DpfPirServer::DecryptHelperRequest(
+    const DpfPirRequest::EncryptedHelperRequest& encrypted_request) const {
   const DpfPirHelper* helper = absl::get_if<DpfPirHelper>(&role_storage_);
   if (helper == nullptr || role_ != Role::kHelper) {
     return absl::InternalError(
@@ -161,15 +464,38 @@ absl::StatusOr<PirResponse> DpfPirServer::HandleHelperRequest(
 
   // Decrypt the request.
   DPF_ASSIGN_OR_RETURN(std::string decrypted_request,
-                       helper->decrypter(request.dpf_pir_request()
-                                             .encrypted_helper_request()
-                                             .encrypted_request(),
+                       helper->decrypter(encrypted_request.encrypted_request(),
                                          helper->encryption_context_info));
   DpfPirRequest::HelperRequest inner_request;
   if (!inner_request.ParseFromString(decrypted_request)) {
     return absl::InvalidArgumentError(
         "`request` does not encrypt a valid DpfPirRequest::HelperRequest");
   }
+  return inner_request;
+}
+
+absl::Status DpfPirServer::MaskWithOneTimePad(
+    absl::string_view one_time_pad_seed, DpfPirResponse& response) const {
+  DPF_ASSIGN_OR_RETURN(auto prng,
+                       Aes128CtrSeededPrng::Create(one_time_pad_seed));
+  for (int i = 0; i < response.masked_response_size(); ++i) {
+    std::string& current_response = *(response.mutable_masked_response(i));
+    const std::string one_time_pad =
+        prng->GetRandomBytes(current_response.size());
+    DPF_RETURN_IF_ERROR(CombineResponseShares(one_time_pad, current_response));
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<PirResponse> DpfPirServer::HandleHelperRequest(
+    const PirRequest& request) const {
+  if (request.dpf_pir_request().wrapped_request_case() ==
+      DpfPirRequest::kBatchedHelperRequest) {
+    return HandleBatchedHelperRequest(
+        request.dpf_pir_request().batched_helper_request());
+  }
+  DPF_ASSIGN_OR_RETURN(DpfPirRequest::HelperRequest inner_request,
+                       DecryptHelperRequest(request));
 
   // Pass the plain request to server_common_.
   PirRequest plain_request;
@@ -177,19 +503,193 @@ absl::StatusOr<PirResponse> DpfPirServer::HandleHelperRequest(
       std::move(*(inner_request.mutable_plain_request()));
   DPF_ASSIGN_OR_RETURN(auto response, this->HandlePlainRequest(plain_request));
 
-  // Expand one-time-pad and XOR with the response.
-  DPF_ASSIGN_OR_RETURN(auto prng, Aes128CtrSeededPrng::Create(
-                                      inner_request.one_time_pad_seed()));
-  for (int i = 0; i < response.dpf_pir_response().masked_response_size(); ++i) {
-    std::string& current_response =
-        *(response.mutable_dpf_pir_response()->mutable_masked_response(i));
-    const std::string one_time_pad =
-        prng->GetRandomBytes(current_response.size());
-    for (int j = 0; j < current_response.size(); ++j) {
-      current_response[j] ^= one_time_pad[j];
+  // Expand one-time-pad and combine it with the response.
+  DPF_RETURN_IF_ERROR(MaskWithOneTimePad(inner_request.one_time_pad_seed(),
+                                         *response.mutable_dpf_pir_response()));
+  return response;
+}
+
+absl::StatusOr<PirResponse> DpfPirServer::HandleBatchedHelperRequest(
+    const DpfPirRequest::BatchedHelperRequest& batch) const {
+  const int num_requests = batch.encrypted_helper_requests_size();
+  std::vector<DpfPirRequest::HelperRequest> inner_requests(num_requests);
+  std::vector<absl::StatusOr<DpfPirResponse>> responses(
+      num_requests, absl::InternalError("Request was not handled"));
+
+  // Decrypt all requests and group them by everything but their DPF keys and
+  // index shifts. Requests without keys, or with a number of shifts that does
+  // not match their keys, are rejected by HandlePlainRequest, so they are not
+  // merged with others.
+  std::vector<std::vector<int>> groups;
+  absl::flat_hash_map<std::string, int> group_indices;
+  for (int i = 0; i < num_requests; ++i) {
+    absl::StatusOr<DpfPirRequest::HelperRequest> inner_request =
+        DecryptHelperRequest(batch.encrypted_helper_requests(i));
+    if (!inner_request.ok()) {
+      responses[i] = inner_request.status();
+      continue;
     }
+    inner_requests[i] = *std::move(inner_request);
+    const DpfPirRequest::PlainRequest& plain_request =
+        inner_requests[i].plain_request();
+    if (plain_request.dpf_key_size() == 0 ||
+        (plain_request.index_shifts_size() != 0 &&
+         plain_request.index_shifts_size() != plain_request.dpf_key_size())) {
+      groups.push_back({i});
+      continue;
+    }
+    DpfPirRequest::PlainRequest shape = plain_request;
+    shape.clear_dpf_key();
+    shape.clear_index_shifts();
+    auto [it, inserted] =
+        group_indices.try_emplace(shape.SerializeAsString(), groups.size());
+    if (inserted) {
+      groups.emplace_back();
+    }
+    groups[it->second].push_back(i);
   }
-  return response;
+
+  // Handles the requests in `indices` with a single call to
+  // HandlePlainRequest, and splits the response into `responses`.
+  auto handle_merged = [&](absl::Span<const int> indices) -> absl::Status {
+    PirRequest merged_request;
+    DpfPirRequest::PlainRequest& merged_plain_request =
+        *(merged_request.mutable_dpf_pir_request()->mutable_plain_request());
+    merged_plain_request = inner_requests[indices[0]].plain_request();
+    bool has_index_shifts = merged_plain_request.index_shifts_size() > 0;
+    for (int j = 1; j < indices.size(); ++j) {
+      const DpfPirRequest::PlainRequest& plain_request =
+          inner_requests[indices[j]].plain_request();
+      for (const DpfKey& key : plain_request.dpf_key()) {
+        *(merged_plain_request.add_dpf_key()) = key;
+      }
+      has_index_shifts |= plain_request.index_shifts_size() > 0;
+    }
+    // Shifts apply to keys one by one, so requests without shifts get a zero
+    // shift per key once any request in the group has shifts.
+    if (has_index_shifts) {
+      merged_plain_request.clear_index_shifts();
+      for (int index : indices) {
+        const DpfPirRequest::PlainRequest& plain_request =
+            inner_requests[index].plain_request();
+        if (plain_request.index_shifts_size() > 0) {
+          merged_plain_request.mutable_index_shifts()->Add(
+              plain_request.index_shifts().begin(),
+              plain_request.index_shifts().end());
+        } else {
+          merged_plain_request.mutable_index_shifts()->Resize(
+              merged_plain_request.index_shifts_size() +
+                  plain_request.dpf_key_size(),
+              0);
+        }
+      }
+    }
+    DPF_ASSIGN_OR_RETURN(PirResponse merged_response,
+                         this->HandlePlainRequest(merged_request));
+    DpfPirResponse& merged_dpf_response =
+        *(merged_response.mutable_dpf_pir_response());
+    if (indices.size() == 1) {
+      responses[indices[0]] = std::move(merged_dpf_response);
+      return absl::OkStatus();
+    }
+
+    // All servers return the same number of responses per key, ordered by key.
+    const int num_keys = merged_plain_request.dpf_key_size();
+    if (merged_dpf_response.masked_response_size() % num_keys != 0) {
+      return absl::InternalError(absl::StrCat(
+          "Number of responses (=", merged_dpf_response.masked_response_size(),
+          ") is not a multiple of the number of DPF keys (=", num_keys, ")"));
+    }
+    const int responses_per_key =
+        merged_dpf_response.masked_response_size() / num_keys;
+    int offset = 0;
+    for (int index : indices) {
+      DpfPirResponse response;
+      const int num_responses =
+          responses_per_key *
+          inner_requests[index].plain_request().dpf_key_size();
+      for (int j = 0; j < num_responses; ++j) {
+        *(response.add_masked_response()) =
+            std::move(*(merged_dpf_response.mutable_masked_response(offset++)));
+      }
+      responses[index] = std::move(response);
+    }
+    return absl::OkStatus();
+  };
+
+  for (const std::vector<int>& group : groups) {
+    absl::Status status = handle_merged(group);
+    if (!status.ok() && group.size() == 1) {
+      responses[group.front()] = status;
+    } else if (!status.ok()) {
+      // Find out which of the requests caused the error.
+      for (int index : group) {
+        status = handle_merged(absl::MakeConstSpan(&index, 1));
+        if (!status.ok()) {
+          responses[index] = status;
+        }
+      }
+    }
+  }
+
+  PirResponse result;
+  BatchedDpfPirResponse& batched_response =
+      *(result.mutable_batched_dpf_pir_response());
+  for (int i = 0; i < num_requests; ++i) {
+    BatchedDpfPirResponse::Entry& entry = *(batched_response.add_responses());
+    absl::Status status = responses[i].status();
+    if (status.ok()) {
+      status = MaskWithOneTimePad(inner_requests[i].one_time_pad_seed(),
+                                  *responses[i]);
+    }
+    if (!status.ok()) {
+      entry.set_status_code(static_cast<int>(status.code()));
+      entry.set_status_message(std::string(status.message()));
+      continue;
+    }
+    *(entry.mutable_response()) = *std::move(responses[i]);
+  }
+  return result;
+}
+
+absl::Status DpfPirServer::HandleHelperRequestChunked(
+    const PirRequest& request, int64_t chunk_size,
+    ResponseChunkSink sink) const {
+  DPF_ASSIGN_OR_RETURN(DpfPirRequest::HelperRequest inner_request,
+                       DecryptHelperRequest(request));
+  PirRequest plain_request;
+  *(plain_request.mutable_dpf_pir_request()->mutable_plain_request()) =
+      std::move(*(inner_request.mutable_plain_request()));
+
+  // HandleHelperRequest masks all responses with consecutive parts of a single
+  // one-time-pad. To produce the same pad chunk by chunk, keep one PRNG per
+  // response, starting at that response's part of the pad.
+  std::vector<std::unique_ptr<Aes128CtrSeededPrng>> prngs;
+  return HandlePlainRequestChunked(
+      plain_request, chunk_size, [&](PirResponse chunk) -> absl::Status {
+        DpfPirResponse& dpf_chunk = *(chunk.mutable_dpf_pir_response());
+        if (prngs.empty()) {
+          prngs.resize(dpf_chunk.masked_response_size());
+          for (int i = 0; i < prngs.size(); ++i) {
+            DPF_ASSIGN_OR_RETURN(prngs[i],
+                                 Aes128CtrSeededPrng::Create(
+                                     inner_request.one_time_pad_seed()));
+            prngs[i]->Skip(i * dpf_chunk.response_size());
+          }
+        }
+        if (prngs.size() != dpf_chunk.masked_response_size()) {
+          return absl::InternalError(
+              "Number of responses changed between chunks");
+        }
+        for (int i = 0; i < dpf_chunk.masked_response_size(); ++i) {
+          std::string& current_chunk = *(dpf_chunk.mutable_masked_response(i));
+          const std::string one_time_pad =
+              prngs[i]->GetRandomBytes(current_chunk.size());
+          DPF_RETURN_IF_ERROR(
+              CombineResponseShares(one_time_pad, current_chunk));
+        }
+        return sink(std::move(chunk));
+      });
 }
 
 }  // namespace distributed_point_functions
@@ -17,13 +17,21 @@
 #ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_DPF_PIR_SERVER_H_
 #define DISTRIBUTED_POINT_FUNCTIONS_PIR_DPF_PIR_SERVER_H_
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/functional/any_invocable.h"
+#include "absl/functional/function_ref.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "absl/types/variant.h"
+#include "dpf/status_macros.h"
+#include "pir/pir_database_interface.h"
 #include "pir/pir_server.h"
 #include "pir/private_information_retrieval.pb.h"
 
@@ -88,11 +96,26 @@ class DpfPirServer : public PirServer {
   // waiting for the response. The callback `while_waiting` is provided by this
   // class, whereas the the `sender` function should be provided by the caller
   // of `MakeLeader` (or the factory function of the derived class). Should
-  // return the result of the RPC call to the Helper's HandleRequest.
+  // return the result of the RPC call to the Helper's HandleRequest. To spread
+  // requests over several Helper replicas, see HedgedHelperSender.
   using ForwardHelperRequestFn = absl::AnyInvocable<absl::StatusOr<PirResponse>(
       const PirRequest& helper_request,
       absl::AnyInvocable<void()> while_waiting) const>;
 
+  // Function type for the `sink` argument to HandleRequestChunked. Receives the
+  // chunks of a response one by one, in order of increasing
+  // `DpfPirResponse.chunk_offset`.
+  using ResponseChunkSink = absl::FunctionRef<absl::Status(PirResponse chunk)>;
+
+  // Function type for the `sender` argument to SetChunkedHelperSender. Takes a
+  // PirRequest to be sent to the Helper and should pass the chunks of the
+  // Helper's response to `sink` as they arrive, i.e., return the result of the
+  // RPC call to the Helper's HandleRequestChunked with the same `chunk_size`.
+  // Should stop and return the error if `sink` returns one.
+  using ForwardHelperRequestChunkedFn = absl::AnyInvocable<absl::Status(
+      const PirRequest& helper_request, int64_t chunk_size,
+      ResponseChunkSink sink) const>;
+
   // Function type for the helper to decrypt the encrypted helper request. This
   // function has the same parameter and return types as
   // `crypto::tink::HybridDecrypt::Decrypt()`: it takes a byte array
@@ -115,14 +138,49 @@ class DpfPirServer : public PirServer {
   // EncryptedHelperRequest to the Helper, and comptutes the Leader response
   // while waiting for a response from the Helper. If this is a Helper server,
   // decrypts the EncryptedHelperRequest and returns a response masked with the
-  // one-time-pad derived from the seed contained therein. If this is a plain
-  // server, simply computes the response to the given PlainRequest.
+  // one-time-pad derived from the seed contained therein. A Helper also accepts
+  // a BatchedHelperRequest forwarded by a BatchingHelperSender, and answers all
+  // requests contained therein with a single BatchedDpfPirResponse. If this is
+  // a plain server, simply computes the response to the given PlainRequest.
   //
   // Returns INVALID_ARGUMENT if the request does not have the right type, or is
   // malformed.
   absl::StatusOr<PirResponse> HandleRequest(
       const PirRequest& request) const final;
 
+  // As HandleRequest, but passes the response to `sink` in chunks holding about
+  // `chunk_size` bytes of each masked response. If the derived class computes
+  // responses in chunks (see HandlePlainRequestChunked), only one chunk per
+  // DPF key is held in memory at a time, and the first chunk is available long
+  // before the whole database has been scanned. A Leader with a chunked sender
+  // (see SetChunkedHelperSender) computes its chunks while the Helper streams
+  // its own, and combines them chunk by chunk. Otherwise, the Leader has to
+  // wait for the Helper's whole response, so its memory use and latency are
+  // the same as for HandleRequest. Use AssembleResponseChunks to reassemble
+  // the chunks on the client.
+  //
+  // Returns INVALID_ARGUMENT if `chunk_size` is not positive, or under the
+  // same conditions as HandleRequest. Returns the first error returned by
+  // `sink`.
+  absl::Status HandleRequestChunked(const PirRequest& request,
+                                    int64_t chunk_size,
+                                    ResponseChunkSink sink) const;
+
+  // Lets a Leader stream the Helper's response in HandleRequestChunked. The
+  // `sender` passed to MakeLeader is still used for HandleRequest.
+  //
+  // Returns FAILED_PRECONDITION if this server is not a Leader, and
+  // INVALID_ARGUMENT if `sender` is NULL.
+  absl::Status SetChunkedHelperSender(ForwardHelperRequestChunkedFn sender);
+
+  // Concatenates the `chunks` passed to the sink of HandleRequestChunked,
+  // returning the same response as HandleRequest.
+  //
+  // Returns INVALID_ARGUMENT if `chunks` are missing, out of order, or do not
+  // belong to the same response.
+  static absl::StatusOr<PirResponse> AssembleResponseChunks(
+      absl::Span<const PirResponse> chunks);
+
  protected:
   // Protected constructor for derived classes.
   DpfPirServer();
@@ -134,6 +192,44 @@ class DpfPirServer : public PirServer {
   virtual absl::StatusOr<PirResponse> HandlePlainRequest(
       const PirRequest& request) const = 0;
 
+  // Chunked version of HandlePlainRequest, called from HandleRequestChunked
+  // with the same kind of requests. The default implementation computes the
+  // whole response with HandlePlainRequest and splits it using
+  // SplitResponseIntoChunks. Derived classes that can compute their responses
+  // in chunks directly should override this. All masked responses to a single
+  // request must have the same size.
+  virtual absl::Status HandlePlainRequestChunked(const PirRequest& request,
+                                                 int64_t chunk_size,
+                                                 ResponseChunkSink sink) const;
+
+  // Splits `response` into chunks of `chunk_size` bytes per masked response
+  // and passes them to `sink`.
+  //
+  // Returns INTERNAL if the masked responses have different sizes.
+  static absl::Status SplitResponseIntoChunks(PirResponse response,
+                                              int64_t chunk_size,
+                                              ResponseChunkSink sink);
+
+  // Computes the responses of `database` to the `num_selections` selection
+  // vectors stored back to back in `selections` using
+  // `Database::InnerProductWithInto`, and appends all parts of each response to
+  // `response` as masked responses. Only a single output buffer is allocated
+  // per call, and the database layer does not allocate at all.
+  //
+  // Returns UNIMPLEMENTED if `database` does not support InnerProductWithInto,
+  // in which case callers should fall back to `Database::InnerProductWith`.
+  template <typename Database>
+  static absl::Status AppendInnerProducts(
+      const Database& database,
+      absl::Span<const typename Database::BlockType> selections,
+      int64_t num_selections, PirResponse& response);
+
+  // Splits `selections` into `num_selections` vectors of equal size, as
+  // expected by `PirDatabaseInterface::InnerProductWith`.
+  template <typename BlockType>
+  static std::vector<std::vector<BlockType>> SplitSelections(
+      absl::Span<const BlockType> selections, int64_t num_selections);
+
   // To be called by the derived class if this server should act as a Leader.
   // `sender` should be a function that forwards the EncryptedHelperRequest to
   // the Helper, and executes its callback while waiting for the response (which
@@ -153,10 +249,22 @@ class DpfPirServer : public PirServer {
   absl::Status MakeHelper(DecryptHelperRequestFn decrypter,
                           absl::string_view encryption_context_info);
 
+  // Combines the response share `share` into `accumulator` in place. Used by
+  // the Leader to combine its response with the Helper's, and by the Helper to
+  // mask its response with the one-time-pad. `share` and `accumulator` are
+  // guaranteed to have the same size. The default implementation XORs both,
+  // which is correct for all schemes whose DPF output group is XOR-based.
+  // Schemes with other output groups (e.g., additive PIR) should override this.
+  //
+  // Returns INVALID_ARGUMENT if `share` is not a valid response share.
+  virtual absl::Status CombineResponseShares(absl::string_view share,
+                                             std::string& accumulator) const;
+
  private:
   struct DpfPirPlain {};
   struct DpfPirLeader {
     ForwardHelperRequestFn sender;
+    ForwardHelperRequestChunkedFn chunked_sender;
   };
   struct DpfPirHelper {
     DecryptHelperRequestFn decrypter;
@@ -169,10 +277,97 @@ class DpfPirServer : public PirServer {
   virtual absl::StatusOr<PirResponse> HandleHelperRequest(
       const PirRequest& request) const;
 
+  absl::Status HandleLeaderRequestChunked(const PirRequest& request,
+                                          int64_t chunk_size,
+                                          ResponseChunkSink sink) const;
+
+  absl::Status HandleHelperRequestChunked(const PirRequest& request,
+                                          int64_t chunk_size,
+                                          ResponseChunkSink sink) const;
+
+  // Combines `helper_chunk` into `leader_chunk` in place.
+  //
+  // Returns INTERNAL if the chunks do not cover the same part of the response.
+  absl::Status CombineResponseChunks(const DpfPirResponse& helper_chunk,
+                                     DpfPirResponse& leader_chunk) const;
+
+  // Splits a LeaderRequest into the PlainRequest for this server and the
+  // EncryptedHelperRequest to be forwarded to the Helper.
+  static absl::StatusOr<std::pair<PirRequest, PirRequest>> SplitLeaderRequest(
+      const PirRequest& request);
+
+  // Decrypts the EncryptedHelperRequest contained in `request`.
+  absl::StatusOr<DpfPirRequest::HelperRequest> DecryptHelperRequest(
+      const PirRequest& request) const;
+
+  // Decrypts `encrypted_request` into a HelperRequest.
+  absl::StatusOr<DpfPirRequest::HelperRequest> DecryptHelperRequest(
+      const DpfPirRequest::EncryptedHelperRequest& encrypted_request) const;
+
+  // Masks all responses in `response` with consecutive parts of the
+  // one-time-pad expanded from `one_time_pad_seed`.
+  absl::Status MaskWithOneTimePad(absl::string_view one_time_pad_seed,
+                                  DpfPirResponse& response) const;
+
+  // Answers all requests in `batch`. Requests that only differ in their DPF
+  // keys are merged into a single PlainRequest, so that they are answered with
+  // a single call to HandlePlainRequest, and thus a single database pass. If a
+  // merged request fails, its requests are retried one by one, so that a
+  // malformed request only fails its own entry of the response.
+  absl::StatusOr<PirResponse> HandleBatchedHelperRequest(
+      const DpfPirRequest::BatchedHelperRequest& batch) const;
+
   absl::variant<DpfPirPlain, DpfPirLeader, DpfPirHelper> role_storage_;
   Role role_;
 };
 
+template <typename Database>
+absl::Status DpfPirServer::AppendInnerProducts(
+    const Database& database,
+    absl::Span<const typename Database::BlockType> selections,
+    int64_t num_selections, PirResponse& response) {
+  const absl::Span<const int64_t> part_sizes = database.response_part_sizes();
+  if (part_sizes.empty()) {
+    return absl::UnimplementedError(
+        "InnerProductWithInto is not supported by this database");
+  }
+  int64_t stride = 0;
+  for (int64_t part_size : part_sizes) {
+    stride += AlignInnerProductOutputSize(part_size);
+  }
+  auto buffer = std::make_unique<char[]>(num_selections * stride +
+                                         kInnerProductOutputAlignment - 1);
+  char* const data = reinterpret_cast<char*>(AlignInnerProductOutputSize(
+      reinterpret_cast<uintptr_t>(buffer.get())));
+  InnerProductOutputs outputs(data, num_selections, stride);
+  DPF_RETURN_IF_ERROR(database.InnerProductWithInto(selections, outputs));
+
+  auto* masked_responses =
+      response.mutable_dpf_pir_response()->mutable_masked_response();
+  masked_responses->Reserve(masked_responses->size() +
+                            num_selections * part_sizes.size());
+  for (int64_t k = 0; k < num_selections; ++k) {
+    int64_t offset = 0;
+    for (int64_t part_size : part_sizes) {
+      masked_responses->Add()->assign(outputs[k] + offset, part_size);
+      offset += AlignInnerProductOutputSize(part_size);
+    }
+  }
+  return absl::OkStatus();
+}
+
+template <typename BlockType>
+std::vector<std::vector<BlockType>> DpfPirServer::SplitSelections(
+    absl::Span<const BlockType> selections, int64_t num_selections) {
+  const int64_t selection_size = selections.size() / num_selections;
+  std::vector<std::vector<BlockType>> result(num_selections);
+  for (int64_t i = 0; i < num_selections; ++i) {
+    result[i].assign(selections.begin() + i * selection_size,
+                     selections.begin() + (i + 1) * selection_size);
+  }
+  return result;
+}
+
 }  // namespace distributed_point_functions
 
 #endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_DPF_PIR_SERVER_H_
@@ -14,6 +14,7 @@
 
 #include "pir/dpf_pir_server.h"
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -41,6 +42,7 @@ namespace {
 
 using dpf_internal::StatusIs;
 using ::testing::AllOf;
+using ::testing::ElementsAreArray;
 using ::testing::HasSubstr;
 using ::testing::StartsWith;
 
@@ -53,7 +55,9 @@ class DpfPirServerTestBase : public DpfPirServer {
   using DpfPirServer::MakeHelper, DpfPirServer::MakeLeader;
   using Database = DenseDpfPirDatabase::Interface;
 
-  virtual void SetIndices(absl::Span<const int> indices) { indices_ = indices; }
+  virtual void SetIndices(absl::Span<const int64_t> indices) {
+    indices_ = indices;
+  }
 
  protected:
   static absl::StatusOr<const DenseDpfPirDatabase*> DatabaseSingleton() {
@@ -84,6 +88,7 @@ class DpfPirServerTestBase : public DpfPirServer {
       const PirRequest& request) const override {
     DPF_ASSIGN_OR_RETURN(const DenseDpfPirDatabase* database,
                          DatabaseSingleton());
+    handled_requests_.push_back(request.dpf_pir_request().plain_request());
     PirResponse response;
     for (int i = 0;
          i < request.dpf_pir_request().plain_request().dpf_key_size(); ++i) {
@@ -101,7 +106,9 @@ class DpfPirServerTestBase : public DpfPirServer {
     return PirServerPublicParams::default_instance();
   }
 
-  absl::Span<const int> indices_;
+  absl::Span<const int64_t> indices_;
+  // All requests passed to HandlePlainRequest.
+  mutable std::vector<DpfPirRequest::PlainRequest> handled_requests_;
 };
 
 class DpfPirServerTest : public ::testing::Test, public DpfPirServerTestBase {};
@@ -142,6 +149,61 @@ TEST_F(DpfPirServerTest, MakeHelperSucceeds) {
   EXPECT_EQ(this->role(), Role::kHelper);
 }
 
+TEST_F(DpfPirServerTest, HandleRequestChunkedFailsIfChunkSizeIsNotPositive) {
+  EXPECT_THAT(
+      this->HandleRequestChunked(PirRequest(), 0,
+                                 [](PirResponse) { return absl::OkStatus(); }),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("`chunk_size` must be positive")));
+}
+
+TEST_F(DpfPirServerTest, ChunkedResponseAssemblesToFullResponse) {
+  DPF_ASSERT_OK_AND_ASSIGN(auto request_generator,
+                           pir_testing::RequestGenerator::Create(
+                               kTestDatabaseElements, kEncryptionContextInfo));
+  std::vector<int64_t> indices{23, 24};
+  SetIndices(indices);
+  PirRequest request;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::tie(*(request.mutable_dpf_pir_request()->mutable_plain_request()),
+               std::ignore),
+      request_generator->CreateDpfPirPlainRequests(indices));
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse expected, this->HandleRequest(request));
+
+  std::vector<PirResponse> chunks;
+  DPF_ASSERT_OK(this->HandleRequestChunked(request, 3, [&](PirResponse chunk) {
+    chunks.push_back(std::move(chunk));
+    return absl::OkStatus();
+  }));
+  const int64_t response_size =
+      expected.dpf_pir_response().masked_response(0).size();
+  EXPECT_EQ(chunks.size(), (response_size + 2) / 3);
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse assembled,
+                           AssembleResponseChunks(chunks));
+  EXPECT_THAT(assembled.dpf_pir_response().masked_response(),
+              ElementsAreArray(expected.dpf_pir_response().masked_response()));
+
+  // Dropping a chunk must be detected.
+  chunks.erase(chunks.begin() + 1);
+  EXPECT_THAT(AssembleResponseChunks(chunks),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("expected 3")));
+  chunks.pop_back();
+  chunks.erase(chunks.begin() + 1, chunks.end());
+  EXPECT_THAT(AssembleResponseChunks(chunks),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Chunks only cover 3")));
+}
+
+TEST_F(DpfPirServerTest, SetChunkedHelperSenderFailsIfNotLeader) {
+  EXPECT_THAT(
+      this->SetChunkedHelperSender(
+          [](const PirRequest&, int64_t, ResponseChunkSink) {
+            return absl::OkStatus();
+          }),
+      StatusIs(absl::StatusCode::kFailedPrecondition, HasSubstr("Leader")));
+}
+
 class DpfPirLeaderTest : public DpfPirServerTest {
  protected:
   void SetUp() override {
@@ -164,7 +226,7 @@ class DpfPirLeaderTest : public DpfPirServerTest {
                                 kTestDatabaseElements, kEncryptionContextInfo));
   }
 
-  void SetIndices(absl::Span<const int> indices) override {
+  void SetIndices(absl::Span<const int64_t> indices) override {
     helper_->SetIndices(indices);
     this->DpfPirServerTestBase::SetIndices(indices);
   }
@@ -226,7 +288,7 @@ TEST_F(DpfPirLeaderTest, HandleRequestFailsIfEncryptedHelperRequestMissing) {
 }
 
 TEST_F(DpfPirLeaderTest, HandleRequestFailsIfProcessPlainRequestNotCalled) {
-  std::vector<int> indices{23};
+  std::vector<int64_t> indices{23};
   SetIndices(indices);
   PirRequest request;
   DPF_ASSERT_OK_AND_ASSIGN(
@@ -250,7 +312,7 @@ TEST_F(DpfPirLeaderTest, HandleRequestFailsIfProcessPlainRequestNotCalled) {
 }
 
 TEST_F(DpfPirLeaderTest, HandleRequestFailsIfNumbersOfResponsesDontMatch) {
-  std::vector<int> indices{23, 24};
+  std::vector<int64_t> indices{23, 24};
   SetIndices(indices);
   PirRequest request;
   DPF_ASSERT_OK_AND_ASSIGN(
@@ -282,7 +344,7 @@ TEST_F(DpfPirLeaderTest, HandleRequestFailsIfNumbersOfResponsesDontMatch) {
 }
 
 TEST_F(DpfPirLeaderTest, HandleRequestFailsIfResponseSizeDoesntMatch) {
-  std::vector<int> indices{23};
+  std::vector<int64_t> indices{23};
   SetIndices(indices);
   PirRequest request;
   DPF_ASSERT_OK_AND_ASSIGN(
@@ -311,7 +373,7 @@ TEST_F(DpfPirLeaderTest, HandleRequestFailsIfResponseSizeDoesntMatch) {
 }
 
 TEST_F(DpfPirLeaderTest, HandleRequestSucceeds) {
-  std::vector<int> indices{23, 24};
+  std::vector<int64_t> indices{23, 24};
   SetIndices(indices);
   PirRequest request;
   DPF_ASSERT_OK_AND_ASSIGN(
@@ -344,6 +406,117 @@ TEST_F(DpfPirLeaderTest, HandleRequestSucceeds) {
   }
 }
 
+TEST_F(DpfPirLeaderTest, HandleRequestChunkedMatchesHandleRequest) {
+  std::vector<int64_t> indices{23, 24};
+  SetIndices(indices);
+  PirRequest request;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      *(request.mutable_dpf_pir_request()->mutable_leader_request()),
+      request_generator_->CreateDpfPirLeaderRequest(indices));
+
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse expected, this->HandleRequest(request));
+  std::vector<PirResponse> chunks;
+  DPF_ASSERT_OK(this->HandleRequestChunked(request, 4, [&](PirResponse chunk) {
+    chunks.push_back(std::move(chunk));
+    return absl::OkStatus();
+  }));
+  EXPECT_GT(chunks.size(), 1);
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse assembled,
+                           AssembleResponseChunks(chunks));
+  EXPECT_THAT(assembled.dpf_pir_response().masked_response(),
+              ElementsAreArray(expected.dpf_pir_response().masked_response()));
+}
+
+TEST_F(DpfPirLeaderTest, SetChunkedHelperSenderFailsIfSenderIsNull) {
+  EXPECT_THAT(this->SetChunkedHelperSender(nullptr),
+              StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("null")));
+}
+
+TEST_F(DpfPirLeaderTest, HandleRequestChunkedCombinesStreamedHelperChunks) {
+  std::vector<int64_t> indices{23, 24};
+  SetIndices(indices);
+  PirRequest request;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      *(request.mutable_dpf_pir_request()->mutable_leader_request()),
+      request_generator_->CreateDpfPirLeaderRequest(indices));
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse expected, this->HandleRequest(request));
+
+  // Each Helper chunk must be combined and passed on before the next one is
+  // sent, instead of waiting for the Helper's whole response.
+  std::vector<PirResponse> chunks;
+  int helper_chunks_sent = 0;
+  DPF_ASSERT_OK(this->SetChunkedHelperSender(
+      [this, &chunks, &helper_chunks_sent](const PirRequest& helper_request,
+                                           int64_t chunk_size,
+                                           ResponseChunkSink sink) {
+        return helper_->HandleRequestChunked(
+            helper_request, chunk_size, [&](PirResponse chunk) {
+              EXPECT_EQ(chunks.size(), helper_chunks_sent);
+              ++helper_chunks_sent;
+              return sink(std::move(chunk));
+            });
+      }));
+  DPF_ASSERT_OK(this->HandleRequestChunked(request, 4, [&](PirResponse chunk) {
+    chunks.push_back(std::move(chunk));
+    return absl::OkStatus();
+  }));
+  EXPECT_GT(chunks.size(), 1);
+  EXPECT_EQ(chunks.size(), helper_chunks_sent);
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse assembled,
+                           AssembleResponseChunks(chunks));
+  EXPECT_THAT(assembled.dpf_pir_response().masked_response(),
+              ElementsAreArray(expected.dpf_pir_response().masked_response()));
+}
+
+TEST_F(DpfPirLeaderTest, HandleRequestChunkedFailsIfHelperChunksAreMissing) {
+  std::vector<int64_t> indices{23};
+  SetIndices(indices);
+  PirRequest request;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      *(request.mutable_dpf_pir_request()->mutable_leader_request()),
+      request_generator_->CreateDpfPirLeaderRequest(indices));
+
+  // Only forward the Helper's first chunk.
+  DPF_ASSERT_OK(this->SetChunkedHelperSender(
+      [this](const PirRequest& helper_request, int64_t chunk_size,
+             ResponseChunkSink sink) -> absl::Status {
+        std::vector<PirResponse> chunks;
+        DPF_RETURN_IF_ERROR(helper_->HandleRequestChunked(
+            helper_request, chunk_size, [&chunks](PirResponse chunk) {
+              chunks.push_back(std::move(chunk));
+              return absl::OkStatus();
+            }));
+        return sink(std::move(chunks[0]));
+      }));
+
+  EXPECT_THAT(this->HandleRequestChunked(
+                  request, 4, [](PirResponse) { return absl::OkStatus(); }),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("more chunks than the Helper sent")));
+}
+
+TEST_F(DpfPirLeaderTest, HandleRequestChunkedFailsIfHelperChunksDontMatch) {
+  std::vector<int64_t> indices{23};
+  SetIndices(indices);
+  PirRequest request;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      *(request.mutable_dpf_pir_request()->mutable_leader_request()),
+      request_generator_->CreateDpfPirLeaderRequest(indices));
+
+  // Let the Helper chunk its response differently from the Leader.
+  DPF_ASSERT_OK(this->SetChunkedHelperSender(
+      [this](const PirRequest& helper_request, int64_t chunk_size,
+             ResponseChunkSink sink) {
+        return helper_->HandleRequestChunked(helper_request, chunk_size + 1,
+                                             sink);
+      }));
+
+  EXPECT_THAT(this->HandleRequestChunked(
+                  request, 4, [](PirResponse) { return absl::OkStatus(); }),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("Response size mismatch at index 0")));
+}
+
 class DpfPirHelperTest : public DpfPirServerTest {
  protected:
   void SetUp() override {
@@ -400,7 +573,7 @@ TEST_F(DpfPirHelperTest, HandleRequestSucceeds) {
   DPF_ASSERT_OK_AND_ASSIGN(auto request_generator,
                            pir_testing::RequestGenerator::Create(
                                kTestDatabaseElements, kEncryptionContextInfo));
-  std::vector<int> indices{23, 24};
+  std::vector<int64_t> indices{23, 24};
   SetIndices(indices);
 
   // Set up encrypted inner request. Create two batched requests (to check that
@@ -444,5 +617,189 @@ TEST_F(DpfPirHelperTest, HandleRequestSucceeds) {
   }
 }
 
+TEST_F(DpfPirHelperTest, HandleRequestChunkedMatchesHandleRequest) {
+  DPF_ASSERT_OK_AND_ASSIGN(auto request_generator,
+                           pir_testing::RequestGenerator::Create(
+                               kTestDatabaseElements, kEncryptionContextInfo));
+  std::vector<int64_t> indices{23, 24, 25};
+  SetIndices(indices);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      DpfPirRequest::LeaderRequest leader_request,
+      request_generator->CreateDpfPirLeaderRequest(indices));
+  PirRequest request;
+  *(request.mutable_dpf_pir_request()->mutable_encrypted_helper_request()) =
+      leader_request.encrypted_helper_request();
+
+  // The one-time-pad must be applied at the right offsets of every response.
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse expected, this->HandleRequest(request));
+  std::vector<PirResponse> chunks;
+  DPF_ASSERT_OK(this->HandleRequestChunked(request, 5, [&](PirResponse chunk) {
+    chunks.push_back(std::move(chunk));
+    return absl::OkStatus();
+  }));
+  EXPECT_GT(chunks.size(), 1);
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse assembled,
+                           AssembleResponseChunks(chunks));
+  EXPECT_THAT(assembled.dpf_pir_response().masked_response(),
+              ElementsAreArray(expected.dpf_pir_response().masked_response()));
+}
+
+TEST_F(DpfPirHelperTest, HandleBatchedRequestMergesPlainRequests) {
+  DPF_ASSERT_OK_AND_ASSIGN(auto request_generator,
+                           pir_testing::RequestGenerator::Create(
+                               kTestDatabaseElements, kEncryptionContextInfo));
+  // The test server answers the i-th key of a PlainRequest with the record at
+  // `indices[i]`, so merged requests are answered with consecutive records.
+  std::vector<int64_t> indices{23, 24, 25};
+  SetIndices(indices);
+  PirRequest request;
+  DpfPirRequest::BatchedHelperRequest& batch =
+      *(request.mutable_dpf_pir_request()->mutable_batched_helper_request());
+  DPF_ASSERT_OK_AND_ASSIGN(DpfPirRequest::LeaderRequest leader_request1,
+                           request_generator->CreateDpfPirLeaderRequest(
+                               absl::MakeConstSpan(indices).subspan(0, 2)));
+  DPF_ASSERT_OK_AND_ASSIGN(DpfPirRequest::LeaderRequest leader_request2,
+                           request_generator->CreateDpfPirLeaderRequest(
+                               absl::MakeConstSpan(indices).subspan(2)));
+  *(batch.add_encrypted_helper_requests()) =
+      leader_request1.encrypted_helper_request();
+  *(batch.add_encrypted_helper_requests()) =
+      leader_request2.encrypted_helper_request();
+
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse result, this->HandleRequest(request));
+  ASSERT_EQ(result.batched_dpf_pir_response().responses_size(), 2);
+  DPF_ASSERT_OK_AND_ASSIGN(const DenseDpfPirDatabase* database,
+                           DatabaseSingleton());
+  int next_index = 0;
+  for (const BatchedDpfPirResponse::Entry& entry :
+       result.batched_dpf_pir_response().responses()) {
+    EXPECT_EQ(entry.status_code(), 0);
+    // Each response is masked with its own one-time-pad.
+    DPF_ASSERT_OK_AND_ASSIGN(
+        auto prng, Aes128CtrSeededPrng::Create(request_generator->otp_seed()));
+    for (const std::string& masked_response :
+         entry.response().masked_response()) {
+      std::string expected(database->content()[indices[next_index++]]);
+      std::string otp = prng->GetRandomBytes(expected.size());
+      for (int j = 0; j < expected.size(); ++j) {
+        expected[j] ^= otp[j];
+      }
+      EXPECT_EQ(masked_response, expected);
+    }
+  }
+  EXPECT_EQ(next_index, indices.size());
+}
+
+TEST_F(DpfPirHelperTest, HandleBatchedRequestIsolatesFailedRequests) {
+  DPF_ASSERT_OK_AND_ASSIGN(auto request_generator,
+                           pir_testing::RequestGenerator::Create(
+                               kTestDatabaseElements, kEncryptionContextInfo));
+  std::vector<int64_t> indices{23};
+  SetIndices(indices);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      DpfPirRequest::LeaderRequest leader_request,
+      request_generator->CreateDpfPirLeaderRequest(indices));
+  PirRequest request;
+  DpfPirRequest::BatchedHelperRequest& batch =
+      *(request.mutable_dpf_pir_request()->mutable_batched_helper_request());
+  *(batch.add_encrypted_helper_requests()) =
+      leader_request.encrypted_helper_request();
+  batch.add_encrypted_helper_requests()->set_encrypted_request(
+      "not a valid ciphertext");
+
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse result, this->HandleRequest(request));
+  const BatchedDpfPirResponse& batched_response =
+      result.batched_dpf_pir_response();
+  ASSERT_EQ(batched_response.responses_size(), 2);
+  EXPECT_EQ(batched_response.responses(0).status_code(), 0);
+  EXPECT_EQ(batched_response.responses(0).response().masked_response_size(), 1);
+  EXPECT_NE(batched_response.responses(1).status_code(), 0);
+  EXPECT_FALSE(batched_response.responses(1).has_response());
+}
+
+TEST_F(DpfPirHelperTest,
+       HandleBatchedRequestRetriesRequestsIndividuallyIfMergedRequestFails) {
+  DPF_ASSERT_OK_AND_ASSIGN(auto request_generator,
+                           pir_testing::RequestGenerator::Create(
+                               kTestDatabaseElements, kEncryptionContextInfo));
+  // The test server fails requests with more keys than indices, so the merged
+  // request fails, while each request succeeds on its own.
+  std::vector<int64_t> indices{23};
+  SetIndices(indices);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      DpfPirRequest::LeaderRequest leader_request,
+      request_generator->CreateDpfPirLeaderRequest(indices));
+  PirRequest request;
+  DpfPirRequest::BatchedHelperRequest& batch =
+      *(request.mutable_dpf_pir_request()->mutable_batched_helper_request());
+  *(batch.add_encrypted_helper_requests()) =
+      leader_request.encrypted_helper_request();
+  *(batch.add_encrypted_helper_requests()) =
+      leader_request.encrypted_helper_request();
+
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse result, this->HandleRequest(request));
+  const BatchedDpfPirResponse& batched_response =
+      result.batched_dpf_pir_response();
+  ASSERT_EQ(batched_response.responses_size(), 2);
+  for (const BatchedDpfPirResponse::Entry& entry :
+       batched_response.responses()) {
+    EXPECT_EQ(entry.status_code(), 0);
+    EXPECT_EQ(entry.response().masked_response_size(), 1);
+  }
+  EXPECT_EQ(batched_response.responses(0).response().masked_response(0),
+            batched_response.responses(1).response().masked_response(0));
+}
+
+TEST_F(DpfPirHelperTest, HandleBatchedRequestMergesIndexShifts) {
+  DPF_ASSERT_OK_AND_ASSIGN(auto request_generator,
+                           pir_testing::RequestGenerator::Create(
+                               kTestDatabaseElements, kEncryptionContextInfo));
+  std::vector<int64_t> indices{23, 24, 25, 26};
+  SetIndices(indices);
+  DPF_ASSERT_OK_AND_ASSIGN(auto encrypter,
+                           pir_testing::CreateFakeHybridEncrypt());
+  // Creates a helper request for `num_keys` keys with the given shifts.
+  auto create_helper_request = [&](int num_keys,
+                                   std::vector<int64_t> index_shifts)
+      -> absl::StatusOr<DpfPirRequest::EncryptedHelperRequest> {
+    DpfPirRequest::HelperRequest inner_request;
+    DPF_ASSIGN_OR_RETURN(
+        std::tie(*(inner_request.mutable_plain_request()), std::ignore),
+        request_generator->CreateDpfPirPlainRequests(
+            absl::MakeConstSpan(indices).subspan(0, num_keys)));
+    inner_request.mutable_plain_request()->mutable_index_shifts()->Add(
+        index_shifts.begin(), index_shifts.end());
+    inner_request.set_one_time_pad_seed(
+        std::string(request_generator->otp_seed()));
+    DpfPirRequest::EncryptedHelperRequest encrypted_request;
+    DPF_ASSIGN_OR_RETURN(
+        *(encrypted_request.mutable_encrypted_request()),
+        encrypter->Encrypt(inner_request.SerializeAsString(),
+                           kEncryptionContextInfo));
+    return encrypted_request;
+  };
+  PirRequest request;
+  DpfPirRequest::BatchedHelperRequest& batch =
+      *(request.mutable_dpf_pir_request()->mutable_batched_helper_request());
+  // An unpooled request, two pooled requests, and one with too many shifts.
+  DPF_ASSERT_OK_AND_ASSIGN(*(batch.add_encrypted_helper_requests()),
+                           create_helper_request(1, {}));
+  DPF_ASSERT_OK_AND_ASSIGN(*(batch.add_encrypted_helper_requests()),
+                           create_helper_request(2, {5, 6}));
+  DPF_ASSERT_OK_AND_ASSIGN(*(batch.add_encrypted_helper_requests()),
+                           create_helper_request(1, {7}));
+  DPF_ASSERT_OK_AND_ASSIGN(*(batch.add_encrypted_helper_requests()),
+                           create_helper_request(1, {8, 9}));
+
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse result, this->HandleRequest(request));
+  ASSERT_EQ(result.batched_dpf_pir_response().responses_size(), 4);
+  ASSERT_EQ(handled_requests_.size(), 2);
+  EXPECT_EQ(handled_requests_[0].dpf_key_size(), 4);
+  EXPECT_THAT(handled_requests_[0].index_shifts(),
+              ElementsAreArray({0, 5, 6, 7}));
+  EXPECT_EQ(handled_requests_[1].dpf_key_size(), 1);
+  EXPECT_THAT(handled_requests_[1].index_shifts(), ElementsAreArray({8, 9}));
+}
+
 }  // namespace
 }  // namespace distributed_point_functions
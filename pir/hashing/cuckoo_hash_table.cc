@@ -31,13 +31,14 @@
 namespace distributed_point_functions {
 
 CuckooHashTable::CuckooHashTable(std::vector<HashFunction> hash_functions,
-                                 int num_buckets, int max_relocations,
+                                 int64_t num_buckets, int max_relocations,
                                  absl::optional<int> max_stash_size)
     : num_buckets_(num_buckets),
       max_relocations_(max_relocations),
       max_stash_size_(max_stash_size),
       hash_functions_(std::move(hash_functions)),
       table_(num_buckets),
+      num_relocations_(0),
       random_hash_function_(0, hash_functions_.size() - 1) {
   if (max_stash_size) {
     stash_.reserve(*max_stash_size);
@@ -45,7 +46,7 @@ CuckooHashTable::CuckooHashTable(std::vector<HashFunction> hash_functions,
 }
 
 absl::StatusOr<std::unique_ptr<CuckooHashTable>> CuckooHashTable::Create(
-    std::vector<HashFunction> hash_functions, int num_buckets,
+    std::vector<HashFunction> hash_functions, int64_t num_buckets,
     int max_relocations, absl::optional<int> max_stash_size) {
   if (num_buckets <= 0) {
     return absl::InvalidArgumentError("num_buckets must be positive");
@@ -68,11 +69,12 @@ absl::Status CuckooHashTable::Insert(absl::string_view input) {
   std::string current_element(input);
   for (int i = 0; i < max_relocations_; i++) {
     // Choose a random hash function and hash the current element.
-    int hash = hash_functions_[random_hash_function_(rng_)](current_element,
-                                                            num_buckets_);
+    int64_t hash = hash_functions_[random_hash_function_(rng_)](
+        current_element, num_buckets_);
     if (table_[hash]) {
       // If bucket is full, evict element and re-insert it recursively.
       std::swap(current_element, *table_[hash]);
+      ++num_relocations_;
     } else {
       // Otherwise just insert our current element and return.
       table_[hash] = std::move(current_element);
@@ -22,6 +22,7 @@
 #ifndef PRIVACY_PRIVATE_MEMBERSHIP_INTERNAL_HASHING_CUCKOO_HASH_TABLE_H_
 #define PRIVACY_PRIVATE_MEMBERSHIP_INTERNAL_HASHING_CUCKOO_HASH_TABLE_H_
 
+#include <cstdint>
 #include <memory>
 #include <random>
 #include <string>
@@ -46,14 +47,14 @@ class CuckooHashTable {
   // recursion during Insert. If set and positive, max_stash_size limits the
   // size of the stash, otherwise the stash size is unlimited.
   static absl::StatusOr<std::unique_ptr<CuckooHashTable>> Create(
-      std::vector<HashFunction> hash_functions, int num_buckets,
+      std::vector<HashFunction> hash_functions, int64_t num_buckets,
       int max_relocations,
       absl::optional<int> max_stash_size = absl::optional<int>());
 
   // Overload that creates num_hash_functions hash functions from the given
   // HashFamily.
   static inline absl::StatusOr<std::unique_ptr<CuckooHashTable>> Create(
-      HashFamily hash_family, int num_buckets, int num_hash_functions,
+      HashFamily hash_family, int64_t num_buckets, int num_hash_functions,
       int max_relocations,
       absl::optional<int> max_stash_size = absl::optional<int>()) {
     DPF_ASSIGN_OR_RETURN(
@@ -84,6 +85,10 @@ class CuckooHashTable {
 
   const std::vector<std::string>& GetStash() const { return stash_; }
 
+  // Returns the total number of evictions performed by all calls to Insert so
+  // far.
+  int64_t GetNumRelocations() const { return num_relocations_; }
+
   // Returns a reference to the hash functions used in this table.
   //
   // Currently being used in experiments under experimental/blinders.
@@ -92,16 +97,17 @@ class CuckooHashTable {
   }
 
  private:
-  CuckooHashTable(std::vector<HashFunction> hash_functions, int num_buckets,
+  CuckooHashTable(std::vector<HashFunction> hash_functions, int64_t num_buckets,
                   int max_relocations, absl::optional<int> max_stash_size);
 
-  const int num_buckets_;
+  const int64_t num_buckets_;
   const int max_relocations_;
   const absl::optional<int> max_stash_size_;
   const std::vector<HashFunction> hash_functions_;
 
   std::vector<absl::optional<std::string>> table_;
   std::vector<std::string> stash_;
+  int64_t num_relocations_;
   // Random number generator used to deterministically choose element to evict
   // on collisions.
   std::mt19937_64 rng_;
@@ -14,6 +14,7 @@
 
 #include "pir/hashing/cuckoo_hash_table.h"
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -68,7 +69,7 @@ class CuckooHashTableTest : public ::testing::Test {
                                         kMaxRelocations, kMaxStashSize));
   }
   std::unique_ptr<CuckooHashTable> table_;
-  std::vector<testing::MockFunction<int(absl::string_view, int)>>
+  std::vector<testing::MockFunction<int64_t(absl::string_view, int64_t)>>
       mock_hash_functions_;
   testing::MockFunction<HashFunction(absl::string_view)> mock_hash_family_;
 };
@@ -132,6 +133,19 @@ TEST(CuckooHashTable, TestDefaultUnlimitedStash) {
   EXPECT_GE(table->GetStash().size(), 1000 - kNumBuckets);
 }
 
+TEST(CuckooHashTable, TestNumRelocations) {
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto table, CuckooHashTable::Create(FarmHashFamily{}, 1,
+                                          kNumHashFunctions, kMaxRelocations));
+  DPF_ASSERT_OK(table->Insert("first"));
+  EXPECT_EQ(table->GetNumRelocations(), 0);
+
+  // With a single bucket, every attempt evicts the current element.
+  DPF_ASSERT_OK(table->Insert("second"));
+  EXPECT_EQ(table->GetNumRelocations(), kMaxRelocations);
+  EXPECT_EQ(table->GetStash().size(), 1);
+}
+
 TEST(CuckooHashTable, FailsIfNumBucketsNegative) {
   EXPECT_THAT(CuckooHashTable::Create(FarmHashFamily{}, 0, 0, 0),
               StatusIs(absl::StatusCode::kInvalidArgument,
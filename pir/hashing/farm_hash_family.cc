@@ -21,11 +21,11 @@
 
 namespace distributed_point_functions {
 
-int FarmHashFunction::operator()(absl::string_view input,
-                                 int upper_bound) const {
+int64_t FarmHashFunction::operator()(absl::string_view input,
+                                     int64_t upper_bound) const {
   auto hash = util::Hash128WithSeed(input.data(), input.length(), seed_);
   absl::uint128 absl_hash = absl::MakeUint128(hash.second, hash.first);
-  return static_cast<int>(absl_hash % absl::uint128(upper_bound));
+  return static_cast<int64_t>(absl_hash % absl::uint128(upper_bound));
 }
 
 }  // namespace distributed_point_functions
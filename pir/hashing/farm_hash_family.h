@@ -17,6 +17,8 @@
 #ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_HASHING_FARM_HASH_FAMILY_H_
 #define DISTRIBUTED_POINT_FUNCTIONS_PIR_HASHING_FARM_HASH_FAMILY_H_
 
+#include <cstdint>
+
 #include "absl/strings/string_view.h"
 #include "farmhash/farmhash.h"
 #include "pir/hashing/hash_family.h"
@@ -28,7 +30,7 @@ class FarmHashFunction {
  public:
   explicit FarmHashFunction(absl::string_view seed)
       : seed_(util::Hash128(seed)) {}
-  int operator()(absl::string_view input, int upper_bound) const;
+  int64_t operator()(absl::string_view input, int64_t upper_bound) const;
 
  private:
   util::uint128_t seed_;
@@ -14,6 +14,8 @@
 
 #include "pir/hashing/farm_hash_family.h"
 
+#include <cstdint>
+
 #include "absl/functional/any_invocable.h"
 #include "absl/numeric/int128.h"
 #include "absl/strings/string_view.h"
@@ -52,5 +54,22 @@ TEST(FarmHashFamily, HashesCorrectly) {
   }
 }
 
+TEST(FarmHashFamily, HashesCorrectlyWithUpperBoundsAbove32Bits) {
+  constexpr absl::string_view kHashFunctionSeed = "kHashFunctionSeed";
+  constexpr absl::string_view kHashInput = "kHashInput";
+  absl::uint128 hash128 = ToAbslU128(util::Hash128WithSeed(
+      kHashInput.data(), kHashInput.size(), util::Hash128(kHashFunctionSeed)));
+
+  HashFunction hasher = FarmHashFamily{}(kHashFunctionSeed);
+
+  for (int64_t upper_bound = int64_t{1} << 32; upper_bound > 0;
+       upper_bound = upper_bound * 3 + 1) {
+    int64_t wanted = static_cast<int64_t>(hash128 % upper_bound);
+    EXPECT_EQ(hasher(kHashInput, upper_bound), wanted);
+    EXPECT_GE(hasher(kHashInput, upper_bound), 0);
+    EXPECT_LT(hasher(kHashInput, upper_bound), upper_bound);
+  }
+}
+
 }  // namespace
 }  // namespace distributed_point_functions
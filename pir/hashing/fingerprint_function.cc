@@ -0,0 +1,70 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/hashing/fingerprint_function.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "dpf/status_macros.h"
+#include "pir/hashing/hash_family.h"
+
+namespace distributed_point_functions {
+
+namespace {
+
+// Prepended to the seeds of all hash functions used for fingerprints.
+constexpr absl::string_view kFingerprintSeedPrefix = "fingerprint";
+
+}  // namespace
+
+FingerprintFunction::FingerprintFunction(
+    std::vector<HashFunction> hash_functions, int num_bytes)
+    : hash_functions_(std::move(hash_functions)), num_bytes_(num_bytes) {}
+
+absl::StatusOr<FingerprintFunction> FingerprintFunction::Create(
+    HashFamily hash_family, int num_bytes) {
+  if (num_bytes <= 0) {
+    return absl::InvalidArgumentError("`num_bytes` must be positive");
+  }
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<HashFunction> hash_functions,
+      CreateHashFunctions(
+          WrapWithSeed(std::move(hash_family), kFingerprintSeedPrefix),
+          (num_bytes + kBytesPerHashFunction - 1) / kBytesPerHashFunction));
+  return FingerprintFunction(std::move(hash_functions), num_bytes);
+}
+
+std::string FingerprintFunction::operator()(absl::string_view input) const {
+  std::string result(num_bytes_, '\0');
+  for (int i = 0; i < hash_functions_.size(); ++i) {
+    // Each hash function yields kBytesPerHashFunction uniformly random bytes.
+    const int64_t hash = hash_functions_[i](
+        input, int64_t{1} << (8 * kBytesPerHashFunction));
+    for (int j = 0; j < kBytesPerHashFunction; ++j) {
+      const int index = i * kBytesPerHashFunction + j;
+      if (index < num_bytes_) {
+        result[index] = static_cast<char>(hash >> (8 * j));
+      }
+    }
+  }
+  return result;
+}
+
+}  // namespace distributed_point_functions
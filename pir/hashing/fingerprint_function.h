@@ -0,0 +1,64 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_HASHING_FINGERPRINT_FUNCTION_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_HASHING_FINGERPRINT_FUNCTION_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "pir/hashing/hash_family.h"
+
+namespace distributed_point_functions {
+
+// A FingerprintFunction maps strings to keyed fingerprints of a fixed number of
+// bytes. The fingerprint bytes are obtained from hash functions of a
+// HashFamily, so that the fingerprints are keyed by the seed of the family.
+// Hash functions are derived with a dedicated seed prefix, so that the
+// fingerprints are independent of the HashFunctions obtained from the same
+// HashFamily through `CreateHashFunctions`.
+class FingerprintFunction {
+ public:
+  // Creates a FingerprintFunction returning fingerprints of `num_bytes` bytes
+  // computed with hash functions from `hash_family`.
+  //
+  // Returns INVALID_ARGUMENT if `num_bytes` is not positive.
+  static absl::StatusOr<FingerprintFunction> Create(HashFamily hash_family,
+                                                    int num_bytes);
+
+  // Returns the fingerprint of `input`.
+  std::string operator()(absl::string_view input) const;
+
+  // Returns the number of bytes of each fingerprint.
+  int num_bytes() const { return num_bytes_; }
+
+ private:
+  // Number of fingerprint bytes obtained from each hash function. Hash
+  // functions return non-negative int64_t values, so each call yields up to 7
+  // uniformly random bytes.
+  static constexpr int kBytesPerHashFunction = 7;
+
+  FingerprintFunction(std::vector<HashFunction> hash_functions, int num_bytes);
+
+  std::vector<HashFunction> hash_functions_;
+  int num_bytes_;
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_HASHING_FINGERPRINT_FUNCTION_H_
@@ -0,0 +1,118 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/hashing/fingerprint_function.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "pir/hashing/hash_family.h"
+#include "pir/hashing/sha256_hash_family.h"
+
+namespace distributed_point_functions {
+
+namespace {
+
+using dpf_internal::StatusIs;
+using ::testing::HasSubstr;
+using ::testing::SizeIs;
+
+constexpr absl::string_view kSeed = "kSeed";
+
+TEST(FingerprintFunction, CreateFailsIfNumBytesIsNotPositive) {
+  EXPECT_THAT(FingerprintFunction::Create(SHA256HashFamily(), 0),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`num_bytes` must be positive")));
+}
+
+class FingerprintFunctionTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(FingerprintFunctionTest, FingerprintsHaveRequestedSize) {
+  DPF_ASSERT_OK_AND_ASSIGN(
+      FingerprintFunction fingerprint,
+      FingerprintFunction::Create(WrapWithSeed(SHA256HashFamily(), kSeed),
+                                  GetParam()));
+  EXPECT_EQ(fingerprint.num_bytes(), GetParam());
+  EXPECT_THAT(fingerprint(""), SizeIs(GetParam()));
+  EXPECT_THAT(fingerprint("input"), SizeIs(GetParam()));
+}
+
+TEST_P(FingerprintFunctionTest, FingerprintsAreDeterministic) {
+  DPF_ASSERT_OK_AND_ASSIGN(
+      FingerprintFunction fingerprint1,
+      FingerprintFunction::Create(WrapWithSeed(SHA256HashFamily(), kSeed),
+                                  GetParam()));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      FingerprintFunction fingerprint2,
+      FingerprintFunction::Create(WrapWithSeed(SHA256HashFamily(), kSeed),
+                                  GetParam()));
+  EXPECT_EQ(fingerprint1("input"), fingerprint2("input"));
+}
+
+INSTANTIATE_TEST_SUITE_P(FingerprintSizes, FingerprintFunctionTest,
+                         ::testing::Values(1, 3, 7, 8, 16));
+
+TEST(FingerprintFunction, FingerprintsDependOnSeed) {
+  DPF_ASSERT_OK_AND_ASSIGN(
+      FingerprintFunction fingerprint1,
+      FingerprintFunction::Create(WrapWithSeed(SHA256HashFamily(), "seed1"),
+                                  8));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      FingerprintFunction fingerprint2,
+      FingerprintFunction::Create(WrapWithSeed(SHA256HashFamily(), "seed2"),
+                                  8));
+  EXPECT_NE(fingerprint1("input"), fingerprint2("input"));
+}
+
+TEST(FingerprintFunction, DistinctInputsHaveDistinctFingerprints) {
+  constexpr int kNumInputs = 10000;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      FingerprintFunction fingerprint,
+      FingerprintFunction::Create(WrapWithSeed(SHA256HashFamily(), kSeed), 8));
+  absl::flat_hash_set<std::string> fingerprints;
+  for (int i = 0; i < kNumInputs; ++i) {
+    fingerprints.insert(fingerprint(absl::StrCat("Key ", i)));
+  }
+  EXPECT_EQ(fingerprints.size(), kNumInputs);
+}
+
+TEST(FingerprintFunction, AllBytesAreRandom) {
+  constexpr int kNumInputs = 1000;
+  constexpr int kNumBytes = 16;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      FingerprintFunction fingerprint,
+      FingerprintFunction::Create(WrapWithSeed(SHA256HashFamily(), kSeed),
+                                  kNumBytes));
+  std::vector<absl::flat_hash_set<char>> values(kNumBytes);
+  for (int i = 0; i < kNumInputs; ++i) {
+    std::string result = fingerprint(absl::StrCat("Key ", i));
+    for (int j = 0; j < kNumBytes; ++j) {
+      values[j].insert(result[j]);
+    }
+  }
+  // 1000 uniformly random bytes take about 251 distinct values.
+  for (int j = 0; j < kNumBytes; ++j) {
+    EXPECT_GT(values[j].size(), 200) << "j=" << j;
+  }
+}
+
+}  // namespace
+
+}  // namespace distributed_point_functions
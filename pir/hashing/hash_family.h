@@ -21,6 +21,7 @@
 #ifndef PRIVACY_PRIVATE_MEMBERSHIP_INTERNAL_HASHING_HASH_FAMILY_H_
 #define PRIVACY_PRIVATE_MEMBERSHIP_INTERNAL_HASHING_HASH_FAMILY_H_
 
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
@@ -34,7 +35,8 @@ namespace distributed_point_functions {
 
 // A HashFunction is any function object that hashes a string to a value between
 // 0 and an upper bound.
-using HashFunction = absl::AnyInvocable<int(absl::string_view, int) const>;
+using HashFunction =
+    absl::AnyInvocable<int64_t(absl::string_view, int64_t) const>;
 
 // A HashFamily is a function that returns a HashFunction given a seed.
 using HashFamily = absl::AnyInvocable<HashFunction(absl::string_view) const>;
@@ -14,6 +14,7 @@
 
 #include "pir/hashing/hash_family.h"
 
+#include <cstdint>
 #include <functional>
 #include <string>
 
@@ -35,7 +36,8 @@ using ::testing::StartsWith;
 
 class HashTableTest : public ::testing::Test {
  public:
-  testing::MockFunction<int(absl::string_view, int)> mock_hash_function_;
+  testing::MockFunction<int64_t(absl::string_view, int64_t)>
+      mock_hash_function_;
   testing::MockFunction<HashFunction(absl::string_view)> mock_hash_family_;
 };
 
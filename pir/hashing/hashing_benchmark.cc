@@ -0,0 +1,228 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/random/random.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"  // third_party/benchmark
+#include "dpf/internal/memory_counters.h"
+#include "dpf/internal/status_matchers.h"
+#include "pir/hashing/cuckoo_hash_table.h"
+#include "pir/hashing/farm_hash_family.h"
+#include "pir/hashing/hash_family.h"
+#include "pir/hashing/multiple_choice_hash_table.h"
+#include "pir/hashing/sha256_hash_family.h"
+#include "pir/hashing/simple_hash_table.h"
+
+// As in the other PIR benchmarks, the database size is set by a flag instead of
+// a benchmark argument, so that production scales of 10^6 to 10^8 keys can be
+// measured without recompiling.
+ABSL_FLAG(int64_t, num_elements, 1 << 20,
+          "The number of keys inserted into each hash table.");
+ABSL_FLAG(int, max_relocations, 1000,
+          "The maximum number of relocations for a single cuckoo hashing "
+          "insertion before an element is put on the stash.");
+
+namespace distributed_point_functions {
+namespace {
+
+// Number of distinct keys hashed in each iteration of BM_HashFunction.
+constexpr int kKeysPerIteration = 1024;
+
+// Returns `absl::GetFlag(FLAGS_num_elements)` distinct keys. The keys are
+// generated only once and shared by all benchmarks.
+const std::vector<std::string>& GetKeys() {
+  static const std::vector<std::string>* keys = [] {
+    auto* keys =
+        new std::vector<std::string>(absl::GetFlag(FLAGS_num_elements));
+    for (int64_t i = 0; i < static_cast<int64_t>(keys->size()); ++i) {
+      (*keys)[i] = absl::StrCat("key", i);
+    }
+    return keys;
+  }();
+  return *keys;
+}
+
+// Adds counters describing the distribution of bucket sizes in `table` to
+// `state`.
+void ReportBucketSizes(const std::vector<std::vector<std::string>>& table,
+                       benchmark::State& state) {
+  std::vector<int64_t> sizes(table.size());
+  int64_t num_empty = 0;
+  for (int64_t i = 0; i < static_cast<int64_t>(table.size()); ++i) {
+    sizes[i] = table[i].size();
+    num_empty += sizes[i] == 0;
+  }
+  std::sort(sizes.begin(), sizes.end());
+  auto percentile = [&sizes](double p) {
+    return sizes[std::min<int64_t>(sizes.size() - 1, p * sizes.size())];
+  };
+  state.counters["bucket_size_p50"] = percentile(0.5);
+  state.counters["bucket_size_p99"] = percentile(0.99);
+  state.counters["bucket_size_p999"] = percentile(0.999);
+  state.counters["bucket_size_max"] = sizes.back();
+  state.counters["empty_bucket_fraction"] =
+      static_cast<double>(num_empty) / sizes.size();
+}
+
+// Measures the throughput of a single hash function of `HashFamilyType` on
+// random keys of `state.range(0)` bytes, hashed into [0, 2^state.range(1)).
+// Bounds above 2^32 cover the bucket counts of 64-bit PIR indices.
+template <typename HashFamilyType>
+void BM_HashFunction(benchmark::State& state) {
+  const int key_length = state.range(0);
+  const int64_t upper_bound = int64_t{1} << state.range(1);
+  absl::BitGen rng;
+  std::vector<std::string> keys(kKeysPerIteration, std::string(key_length, 0));
+  for (std::string& key : keys) {
+    for (char& c : key) {
+      c = absl::Uniform<unsigned char>(rng);
+    }
+  }
+  HashFunction hash = HashFamilyType{}("seed");
+
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto _ : state) {
+    for (const std::string& key : keys) {
+      benchmark::DoNotOptimize(hash(key, upper_bound));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kKeysPerIteration);
+  state.SetBytesProcessed(state.iterations() * kKeysPerIteration * key_length);
+}
+BENCHMARK_TEMPLATE(BM_HashFunction, SHA256HashFamily)
+    ->ArgNames({"key_length", "log_upper_bound"})
+    ->ArgsProduct({benchmark::CreateRange(4, 1024, 4), {20, 40}});
+BENCHMARK_TEMPLATE(BM_HashFunction, FarmHashFamily)
+    ->ArgNames({"key_length", "log_upper_bound"})
+    ->ArgsProduct({benchmark::CreateRange(4, 1024, 4), {20, 40}});
+
+// Measures cuckoo hashing insertion throughput with `state.range(0)` hash
+// functions at a load factor of `state.range(1)` percent, and reports the
+// number of relocations per key and the final stash size.
+void BM_CuckooInsert(benchmark::State& state) {
+  const int num_hash_functions = state.range(0);
+  const int load_percent = state.range(1);
+  const std::vector<std::string>& keys = GetKeys();
+  const int64_t num_buckets =
+      static_cast<int64_t>(keys.size()) * 100 / load_percent;
+  const int max_relocations = absl::GetFlag(FLAGS_max_relocations);
+
+  int64_t num_relocations = 0;
+  int64_t stash_size = 0;
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto _ : state) {
+    DPF_ASSERT_OK_AND_ASSIGN(
+        auto table, CuckooHashTable::Create(FarmHashFamily{}, num_buckets,
+                                            num_hash_functions,
+                                            max_relocations));
+    for (const std::string& key : keys) {
+      DPF_ASSERT_OK(table->Insert(key));
+    }
+    num_relocations = table->GetNumRelocations();
+    stash_size = table->GetStash().size();
+    benchmark::DoNotOptimize(table);
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+  state.counters["relocations_per_key"] =
+      static_cast<double>(num_relocations) / keys.size();
+  state.counters["stash_size"] = stash_size;
+}
+BENCHMARK(BM_CuckooInsert)
+    ->ArgNames({"num_hash_functions", "load_percent"})
+    ->ArgsProduct({{2, 3, 4}, {25, 50, 67, 80, 90}})
+    ->Unit(benchmark::kMillisecond);
+
+// Measures SimpleHashTable insertion with `state.range(0)` hash functions and
+// `state.range(1)` keys per bucket on average, and reports the resulting
+// bucket sizes.
+void BM_SimpleHashTableInsert(benchmark::State& state) {
+  const int num_hash_functions = state.range(0);
+  const int keys_per_bucket = state.range(1);
+  const std::vector<std::string>& keys = GetKeys();
+  const int64_t num_buckets =
+      std::max<int64_t>(1, keys.size() / keys_per_bucket);
+
+  std::unique_ptr<SimpleHashTable> table;
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto _ : state) {
+    DPF_ASSERT_OK_AND_ASSIGN(
+        table, SimpleHashTable::Create(FarmHashFamily{}, num_buckets,
+                                       num_hash_functions));
+    for (const std::string& key : keys) {
+      DPF_ASSERT_OK(table->Insert(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+  ReportBucketSizes(table->GetTable(), state);
+}
+BENCHMARK(BM_SimpleHashTableInsert)
+    ->ArgNames({"num_hash_functions", "keys_per_bucket"})
+    ->ArgsProduct({{1, 2, 3}, {1, 16, 256}})
+    ->Unit(benchmark::kMillisecond);
+
+// Same as BM_SimpleHashTableInsert, but for MultipleChoiceHashTable.
+void BM_MultipleChoiceHashTableInsert(benchmark::State& state) {
+  const int num_hash_functions = state.range(0);
+  const int keys_per_bucket = state.range(1);
+  const std::vector<std::string>& keys = GetKeys();
+  const int64_t num_buckets =
+      std::max<int64_t>(1, keys.size() / keys_per_bucket);
+
+  std::unique_ptr<MultipleChoiceHashTable> table;
+  dpf_internal::MemoryCounters memory_counters(state);
+  for (auto _ : state) {
+    DPF_ASSERT_OK_AND_ASSIGN(
+        table, MultipleChoiceHashTable::Create(FarmHashFamily{}, num_buckets,
+                                               num_hash_functions));
+    for (const std::string& key : keys) {
+      DPF_ASSERT_OK(table->Insert(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+  ReportBucketSizes(table->GetTable(), state);
+}
+BENCHMARK(BM_MultipleChoiceHashTableInsert)
+    ->ArgNames({"num_hash_functions", "keys_per_bucket"})
+    ->ArgsProduct({{2, 3}, {1, 16, 256}})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace distributed_point_functions
+
+// Declare benchmark_filter flag, which will be defined by benchmark library.
+// Use it to check if any benchmarks were specified explicitly.
+//
+namespace benchmark {
+extern std::string FLAGS_benchmark_filter;
+}
+using benchmark::FLAGS_benchmark_filter;
+
+int main(int argc, char* argv[]) {
+  FLAGS_benchmark_filter = "";
+  benchmark::Initialize(&argc, argv);
+  absl::ParseCommandLine(argc, argv);
+  if (!FLAGS_benchmark_filter.empty()) {
+    benchmark::RunSpecifiedBenchmarks();
+  }
+  benchmark::Shutdown();
+  return 0;
+}
@@ -30,7 +30,7 @@ namespace distributed_point_functions {
 
 absl::StatusOr<std::unique_ptr<MultipleChoiceHashTable>>
 MultipleChoiceHashTable::Create(std::vector<HashFunction> hash_functions,
-                                int num_buckets,
+                                int64_t num_buckets,
                                 absl::optional<int> max_bucket_size) {
   if (num_buckets <= 0) {
     return absl::InvalidArgumentError("num_buckets must be positive");
@@ -47,7 +47,7 @@ MultipleChoiceHashTable::Create(std::vector<HashFunction> hash_functions,
 }
 
 MultipleChoiceHashTable::MultipleChoiceHashTable(
-    std::vector<HashFunction> hash_functions, int num_buckets,
+    std::vector<HashFunction> hash_functions, int64_t num_buckets,
     absl::optional<int> max_bucket_size)
     : num_buckets_(num_buckets),
       max_bucket_size_(max_bucket_size),
@@ -55,8 +55,8 @@ MultipleChoiceHashTable::MultipleChoiceHashTable(
       table_(num_buckets) {}
 
 absl::Status MultipleChoiceHashTable::Insert(absl::string_view input) {
-  std::vector<int> hashes(hash_functions_.size());
-  int smallest_bucket = 0;
+  std::vector<int64_t> hashes(hash_functions_.size());
+  int64_t smallest_bucket = 0;
   for (int i = 0; i < hash_functions_.size(); i++) {
     hashes[i] = hash_functions_[i](input, num_buckets_);
     if (i == 0 || table_[hashes[i]].size() < table_[smallest_bucket].size()) {
@@ -20,6 +20,7 @@
 #ifndef PRIVACY_PRIVATE_MEMBERSHIP_INTERNAL_HASHING_MULTIPLE_CHOICE_HASH_TABLE_H_
 #define PRIVACY_PRIVATE_MEMBERSHIP_INTERNAL_HASHING_MULTIPLE_CHOICE_HASH_TABLE_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -42,13 +43,13 @@ class MultipleChoiceHashTable {
   // Returns INVALID_ARGUMENT if hash_functions.size() < 2, or if num_buckets or
   // max_bucket_size are negative.
   static absl::StatusOr<std::unique_ptr<MultipleChoiceHashTable>> Create(
-      std::vector<HashFunction> hash_functions, int num_buckets,
+      std::vector<HashFunction> hash_functions, int64_t num_buckets,
       absl::optional<int> max_bucket_size = absl::optional<int>());
 
   // Overload that creates num_hash_functions hash functions from the given
   // HashFamily.
   static inline absl::StatusOr<std::unique_ptr<MultipleChoiceHashTable>> Create(
-      HashFamily hash_family, int num_buckets, int num_hash_functions = 2,
+      HashFamily hash_family, int64_t num_buckets, int num_hash_functions = 2,
       absl::optional<int> max_bucket_size = absl::optional<int>()) {
     DPF_ASSIGN_OR_RETURN(
         std::vector<HashFunction> hash_functions,
@@ -73,9 +74,10 @@ class MultipleChoiceHashTable {
 
  private:
   MultipleChoiceHashTable(std::vector<HashFunction> hash_functions,
-                          int num_buckets, absl::optional<int> max_bucket_size);
+                          int64_t num_buckets,
+                          absl::optional<int> max_bucket_size);
 
-  const int num_buckets_;
+  const int64_t num_buckets_;
   const absl::optional<int> max_bucket_size_;
   const std::vector<HashFunction> hash_functions_;
 
@@ -56,8 +56,8 @@ SHA256HashFunction::~SHA256HashFunction() {
   memset(&ctx_, 0, sizeof(ctx_));
 }
 
-int SHA256HashFunction::operator()(absl::string_view input,
-                                   int upper_bound) const {
+int64_t SHA256HashFunction::operator()(absl::string_view input,
+                                       int64_t upper_bound) const {
   // Copy the default state on SHA256(seed).
   SHA256_CTX ctx = ctx_;
   // Compute the hash as SHA256(seed || input).
@@ -83,7 +83,7 @@ int SHA256HashFunction::operator()(absl::string_view input,
   auto remainder2 = static_cast<uint64_t>(dividend2 % upper_bound);
   absl::uint128 dividend3 =
       absl::MakeUint128(remainder2, absl::Uint128Low64(lo));
-  return static_cast<int>(dividend3 % upper_bound);
+  return static_cast<int64_t>(dividend3 % upper_bound);
 }
 
 }  // namespace distributed_point_functions
@@ -17,6 +17,8 @@
 #ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_HASHING_SHA256_HASH_FAMILY_H_
 #define DISTRIBUTED_POINT_FUNCTIONS_PIR_HASHING_SHA256_HASH_FAMILY_H_
 
+#include <cstdint>
+
 #include "absl/strings/string_view.h"
 #include "openssl/sha.h"
 #include "pir/hashing/hash_family.h"
@@ -34,7 +36,7 @@ class SHA256HashFunction {
 
   // Computes the hash in `input` as SHA256(seed || input), and reduces the hash
   // to the range [0,upper_bound).
-  int operator()(absl::string_view input, int upper_bound) const;
+  int64_t operator()(absl::string_view input, int64_t upper_bound) const;
 
  private:
   SHA256_CTX ctx_;
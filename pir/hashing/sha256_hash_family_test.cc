@@ -24,6 +24,7 @@
 #include "absl/strings/string_view.h"
 #include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
+#include "openssl/sha.h"
 #include "shell_encryption/int256.h"
 
 namespace distributed_point_functions {
@@ -72,10 +73,33 @@ TEST(Sha256HashFamily, HashesCorrectly) {
   }
 }
 
+TEST(Sha256HashFamily, HashesCorrectlyWithUpperBoundsAbove32Bits) {
+  constexpr absl::string_view kHashFunctionSeed = "kHashFunctionSeed";
+  constexpr absl::string_view kHashInput = "kHashInput";
+  char full_hash[SHA256_DIGEST_LENGTH];
+  const std::string seeded_input = absl::StrCat(kHashFunctionSeed, kHashInput);
+  SHA256(reinterpret_cast<const unsigned char*>(seeded_input.data()),
+         seeded_input.size(), reinterpret_cast<unsigned char*>(full_hash));
+  rlwe::uint256 wanted_hash_value{0};
+  for (int i = 0; i < SHA256_DIGEST_LENGTH; ++i) {
+    rlwe::uint256 x{static_cast<uint8_t>(full_hash[i])};
+    wanted_hash_value |= x << (8 * i);
+  }
+
+  HashFunction hash = SHA256HashFamily{}(kHashFunctionSeed);
+
+  for (int64_t upper_bound = int64_t{1} << 32; upper_bound > 0;
+       upper_bound = upper_bound * 3 + 1) {
+    int64_t wanted = static_cast<int64_t>(
+        wanted_hash_value % rlwe::uint256{static_cast<uint64_t>(upper_bound)});
+    EXPECT_EQ(hash(kHashInput, upper_bound), wanted);
+  }
+}
+
 void BM_Hash(benchmark::State& state) {
   constexpr absl::string_view kHashFunctionSeed = "kHashFunctionSeed";
   int num_values = state.range(0);
-  int upper_bound = state.range(1);
+  int64_t upper_bound = state.range(1);
 
   for (auto _ : state) {
     HashFunction hash = SHA256HashFamily{}(kHashFunctionSeed);
@@ -88,7 +112,8 @@ void BM_Hash(benchmark::State& state) {
 BENCHMARK(BM_Hash)
     ->Args({1 << 20, 256})
     ->Args({1 << 20, 1 << 20})
-    ->Args({1 << 20, 1 << 30});
+    ->Args({1 << 20, 1 << 30})
+    ->Args({1 << 20, int64_t{1} << 40});
 
 }  // namespace
 }  // namespace distributed_point_functions
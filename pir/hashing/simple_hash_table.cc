@@ -29,7 +29,7 @@
 namespace distributed_point_functions {
 
 absl::StatusOr<std::unique_ptr<SimpleHashTable>> SimpleHashTable::Create(
-    std::vector<HashFunction> hash_functions, int num_buckets,
+    std::vector<HashFunction> hash_functions, int64_t num_buckets,
     absl::optional<int> max_bucket_size) {
   if (num_buckets <= 0) {
     return absl::InvalidArgumentError("num_buckets must be positive");
@@ -45,7 +45,7 @@ absl::StatusOr<std::unique_ptr<SimpleHashTable>> SimpleHashTable::Create(
 }
 
 SimpleHashTable::SimpleHashTable(std::vector<HashFunction> hash_functions,
-                                 int num_buckets,
+                                 int64_t num_buckets,
                                  absl::optional<int> max_bucket_size)
     : num_buckets_(num_buckets),
       max_bucket_size_(max_bucket_size),
@@ -53,7 +53,7 @@ SimpleHashTable::SimpleHashTable(std::vector<HashFunction> hash_functions,
       table_(num_buckets) {}
 
 absl::Status SimpleHashTable::Insert(absl::string_view input) {
-  std::vector<int> hashes(hash_functions_.size());
+  std::vector<int64_t> hashes(hash_functions_.size());
   for (int i = 0; i < hash_functions_.size(); i++) {
     hashes[i] = hash_functions_[i](input, num_buckets_);
     if (max_bucket_size_ && table_[hashes[i]].size() >= *max_bucket_size_) {
@@ -21,6 +21,7 @@
 #ifndef PRIVACY_PRIVATE_MEMBERSHIP_INTERNAL_HASHING_SIMPLE_HASH_TABLE_H_
 #define PRIVACY_PRIVATE_MEMBERSHIP_INTERNAL_HASHING_SIMPLE_HASH_TABLE_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -44,13 +45,13 @@ class SimpleHashTable {
   // Returns INVALID_ARGUMENT if hash_functions is empty, or if num_buckets or
   // max_bucket_size are negative.
   static absl::StatusOr<std::unique_ptr<SimpleHashTable>> Create(
-      std::vector<HashFunction> hash_functions, int num_buckets,
+      std::vector<HashFunction> hash_functions, int64_t num_buckets,
       absl::optional<int> max_bucket_size = absl::optional<int>());
 
   // Overload that creates num_hash_functions hash functions from the given
   // HashFamily.
   static inline absl::StatusOr<std::unique_ptr<SimpleHashTable>> Create(
-      HashFamily hash_family, int num_buckets, int num_hash_functions = 1,
+      HashFamily hash_family, int64_t num_buckets, int num_hash_functions = 1,
       absl::optional<int> max_bucket_size = absl::optional<int>()) {
     DPF_ASSIGN_OR_RETURN(
         std::vector<HashFunction> hash_functions,
@@ -79,10 +80,10 @@ class SimpleHashTable {
   }
 
  private:
-  SimpleHashTable(std::vector<HashFunction> hash_functions, int num_buckets,
+  SimpleHashTable(std::vector<HashFunction> hash_functions, int64_t num_buckets,
                   absl::optional<int> max_bucket_size);
 
-  const int num_buckets_;
+  const int64_t num_buckets_;
   const absl::optional<int> max_bucket_size_;
   const std::vector<HashFunction> hash_functions_;
 
@@ -0,0 +1,257 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/hedged_helper_sender.h"
+
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+// State shared between the threads handling a single call to Send. Replica
+// calls that are still running when Send returns keep it alive.
+struct HedgedHelperSender::CallState {
+  CallState(const PirRequest& helper_request, int max_calls)
+      : helper_request(helper_request),
+        max_calls(max_calls),
+        errors(max_calls) {}
+
+  // Returns true if Send can return.
+  bool IsDone() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu) {
+    return winner.has_value() || finished == max_calls;
+  }
+
+  // Copied, since replica calls may outlive the call to Send.
+  const PirRequest helper_request;
+  // Number of replicas that may be called, i.e., `max_hedged_requests + 1`.
+  const int max_calls;
+  absl::Mutex mu;
+  int launched ABSL_GUARDED_BY(mu) = 0;
+  int finished ABSL_GUARDED_BY(mu) = 0;
+  absl::optional<PirResponse> winner ABSL_GUARDED_BY(mu);
+  int winner_index ABSL_GUARDED_BY(mu) = -1;
+  std::vector<absl::Status> errors ABSL_GUARDED_BY(mu);
+  absl::Notification cancelled;
+};
+
+HedgedHelperSender::HedgedHelperSender(std::vector<ReplicaFn> replicas,
+                                       Options options)
+    : replicas_(std::move(replicas)), options_(std::move(options)) {
+  call_threads_.reserve(options_.max_concurrent_calls);
+  for (int i = 0; i < options_.max_concurrent_calls; ++i) {
+    call_threads_.emplace_back([this] { RunCallThread(); });
+  }
+  hedge_thread_ = std::thread([this] { RunHedgeThread(); });
+}
+
+HedgedHelperSender::~HedgedHelperSender() {
+  {
+    absl::MutexLock lock(&mu_);
+    shutting_down_ = true;
+  }
+  hedge_thread_.join();
+  for (std::thread& thread : call_threads_) {
+    thread.join();
+  }
+}
+
+absl::StatusOr<std::shared_ptr<HedgedHelperSender>> HedgedHelperSender::Create(
+    std::vector<ReplicaFn> replicas, Options options) {
+  if (replicas.empty()) {
+    return absl::InvalidArgumentError("`replicas` must not be empty");
+  }
+  for (int i = 0; i < static_cast<int>(replicas.size()); ++i) {
+    if (!replicas[i]) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("`replicas[", i, "]` cannot be null"));
+    }
+  }
+  if (options.max_hedged_requests < 0 ||
+      options.max_hedged_requests >= static_cast<int>(replicas.size())) {
+    return absl::InvalidArgumentError(
+        "`max_hedged_requests` must be between 0 and the number of replicas "
+        "minus one");
+  }
+  if (options.hedge_delay < absl::ZeroDuration()) {
+    return absl::InvalidArgumentError("`hedge_delay` must not be negative");
+  }
+  if (options.max_concurrent_calls <= 0) {
+    return absl::InvalidArgumentError(
+        "`max_concurrent_calls` must be positive");
+  }
+  return std::shared_ptr<HedgedHelperSender>(
+      new HedgedHelperSender(std::move(replicas), std::move(options)));
+}
+
+void HedgedHelperSender::LaunchReplicaCall(
+    const std::shared_ptr<CallState>& state) const {
+  int index = state->launched++;
+  absl::MutexLock lock(&mu_);
+  pending_calls_.emplace_back(state, index);
+  if (state->launched < state->max_calls &&
+      options_.hedge_delay != absl::InfiniteDuration()) {
+    hedges_.emplace(absl::Now() + options_.hedge_delay,
+                    std::make_pair(state, state->launched));
+  }
+}
+
+void HedgedHelperSender::RunCallThread() const {
+  while (true) {
+    std::shared_ptr<CallState> state;
+    int index;
+    {
+      absl::MutexLock lock(&mu_);
+      auto has_work = [this]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        return shutting_down_ || !pending_calls_.empty();
+      };
+      mu_.Await(absl::Condition(&has_work));
+      if (shutting_down_) {
+        return;
+      }
+      std::tie(state, index) = std::move(pending_calls_.front());
+      pending_calls_.pop_front();
+    }
+
+    // Calls queued behind a winner are not sent at all.
+    bool has_winner;
+    {
+      absl::MutexLock lock(&state->mu);
+      has_winner = state->winner.has_value();
+    }
+    absl::StatusOr<PirResponse> response =
+        absl::CancelledError("Cancelled before the call started");
+    if (!has_winner) {
+      response = replicas_[index](state->helper_request, state->cancelled);
+    }
+    if (response.ok() && !response->has_dpf_pir_response()) {
+      response = absl::InternalError(
+          absl::StrCat("Replica ", index, " returned an invalid response"));
+    }
+    absl::MutexLock lock(&state->mu);
+    ++state->finished;
+    if (!response.ok()) {
+      state->errors[index] = response.status();
+      // Hedge right away if all launched calls failed.
+      if (!state->winner.has_value() && state->finished == state->launched &&
+          state->launched < state->max_calls) {
+        LaunchReplicaCall(state);
+      }
+    } else if (!state->winner.has_value()) {
+      state->winner = *std::move(response);
+      state->winner_index = index;
+    }
+  }
+}
+
+void HedgedHelperSender::RunHedgeThread() const {
+  std::shared_ptr<CallState> state;
+  int num_launched;
+  while (TakeNextHedge(state, num_launched)) {
+    absl::MutexLock lock(&state->mu);
+    if (!state->winner.has_value() && state->launched == num_launched) {
+      LaunchReplicaCall(state);
+    }
+  }
+}
+
+bool HedgedHelperSender::TakeNextHedge(std::shared_ptr<CallState>& state,
+                                       int& num_launched) const {
+  absl::MutexLock lock(&mu_);
+  while (!shutting_down_) {
+    const absl::Time next_due =
+        hedges_.empty() ? absl::InfiniteFuture() : hedges_.begin()->first;
+    if (next_due <= absl::Now()) {
+      std::tie(state, num_launched) = std::move(hedges_.begin()->second);
+      hedges_.erase(hedges_.begin());
+      return true;
+    }
+    // Wait until the next hedge is due, an earlier one is scheduled, or the
+    // destructor is called.
+    auto should_wake_up = [this, next_due]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(
+                              mu_) {
+      return shutting_down_ ||
+             (!hedges_.empty() && hedges_.begin()->first < next_due);
+    };
+    mu_.AwaitWithDeadline(absl::Condition(&should_wake_up), next_due);
+  }
+  return false;
+}
+
+DpfPirServer::ForwardHelperRequestFn
+HedgedHelperSender::AsForwardHelperRequestFn(
+    std::shared_ptr<const HedgedHelperSender> sender) {
+  return [sender = std::move(sender)](
+             const PirRequest& helper_request,
+             absl::AnyInvocable<void()> while_waiting) {
+    return sender->Send(helper_request, std::move(while_waiting));
+  };
+}
+
+absl::StatusOr<PirResponse> HedgedHelperSender::Send(
+    const PirRequest& helper_request,
+    absl::AnyInvocable<void()> while_waiting) const {
+  auto state = std::make_shared<CallState>(helper_request,
+                                           options_.max_hedged_requests + 1);
+  {
+    absl::MutexLock lock(&state->mu);
+    LaunchReplicaCall(state);
+  }
+
+  while_waiting();
+
+  // Return as soon as there is a winner. Calls that are still running or
+  // queued are cancelled, and finish in the background.
+  absl::MutexLock lock(&state->mu);
+  state->mu.Await(absl::Condition(state.get(), &CallState::IsDone));
+  state->cancelled.Notify();
+  {
+    absl::MutexLock stats_lock(&mu_);
+    ++stats_.requests;
+    if (state->launched > 1) {
+      ++stats_.hedged_requests;
+      stats_.hedges_sent += state->launched - 1;
+    }
+    if (state->winner_index > 0) {
+      ++stats_.hedge_wins;
+    }
+    if (!state->winner.has_value()) {
+      ++stats_.failed_requests;
+    }
+  }
+  if (!state->winner.has_value()) {
+    return state->errors[0];
+  }
+  return *std::move(state->winner);
+}
+
+HedgedHelperSender::Stats HedgedHelperSender::GetStats() const {
+  absl::MutexLock lock(&mu_);
+  return stats_;
+}
+
+}  // namespace distributed_point_functions
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_HEDGED_HELPER_SENDER_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_HEDGED_HELPER_SENDER_H_
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "pir/dpf_pir_server.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+// Forwards a Leader's helper requests to one of several equivalent Helper
+// replicas, hedging against slow replicas. Each request is first sent to one
+// replica. If no valid response arrived after `Options::hedge_delay`, or if
+// the replica failed, a duplicate is sent to the next replica, up to
+// `Options::max_hedged_requests` times. The first valid response is returned,
+// and all other outstanding calls are cancelled.
+//
+// Since helper requests are encrypted and masked with a one-time pad chosen by
+// the client, all replicas return the same response, and sending duplicates
+// reveals nothing beyond the original request.
+//
+// Usage:
+//
+//   DPF_ASSIGN_OR_RETURN(
+//       std::shared_ptr<HedgedHelperSender> hedged_sender,
+//       HedgedHelperSender::Create(std::move(replicas), options));
+//   DPF_ASSIGN_OR_RETURN(
+//       auto leader,
+//       DenseDpfPirServer::CreateLeader(
+//           config, std::move(database),
+//           HedgedHelperSender::AsForwardHelperRequestFn(hedged_sender)));
+//
+// Replica calls run on a fixed number of threads owned by the
+// HedgedHelperSender, see `Options::max_concurrent_calls`.
+//
+// This class is thread-safe, as long as all replica functions are.
+class HedgedHelperSender {
+ public:
+  // Function type for a single Helper replica. Should send `helper_request` to
+  // the replica and return its response. Calls that are no longer needed are
+  // cancelled by notifying `cancelled`, upon which the function should return
+  // as soon as possible, e.g., by cancelling the underlying RPC. The returned
+  // value of a cancelled call is ignored. Calls may still be running after
+  // Send returned, but the destructor of HedgedHelperSender waits for them.
+  // Anything the function references must therefore stay alive until the
+  // HedgedHelperSender is destroyed, and cancelled calls must return promptly
+  // to not block the destructor.
+  using ReplicaFn = absl::AnyInvocable<absl::StatusOr<PirResponse>(
+      const PirRequest& helper_request,
+      const absl::Notification& cancelled) const>;
+
+  struct Options {
+    // Time to wait for a replica's response before sending a duplicate request
+    // to the next replica.
+    absl::Duration hedge_delay = absl::Milliseconds(50);
+
+    // Maximum number of duplicate requests sent for each helper request. Must
+    // not be negative, and at most the number of replicas minus one.
+    int max_hedged_requests = 1;
+
+    // Maximum number of replica calls running at the same time, across all
+    // requests. Further calls wait until a running call returned. This is the
+    // number of threads started for replica calls. Must be positive.
+    int max_concurrent_calls = 16;
+  };
+
+  // Counters to be exported as metrics.
+  struct Stats {
+    // Total number of helper requests.
+    int64_t requests = 0;
+    // Number of helper requests for which at least one duplicate was sent.
+    int64_t hedged_requests = 0;
+    // Total number of duplicate requests sent.
+    int64_t hedges_sent = 0;
+    // Number of helper requests answered by a duplicate instead of the first
+    // replica.
+    int64_t hedge_wins = 0;
+    // Number of helper requests for which no replica returned a valid
+    // response.
+    int64_t failed_requests = 0;
+  };
+
+  // Creates a new HedgedHelperSender. Requests are sent to `replicas` in
+  // order, i.e., the first replica is the primary.
+  //
+  // Returns INVALID_ARGUMENT if `replicas` is empty or contains NULL
+  // functions, or if `options` are invalid.
+  static absl::StatusOr<std::shared_ptr<HedgedHelperSender>> Create(
+      std::vector<ReplicaFn> replicas, Options options);
+
+  // Waits for running replica calls and joins all threads. Calls that did not
+  // start yet belong to requests that were already answered, and are dropped.
+  ~HedgedHelperSender();
+
+  // Returns a function that can be passed as the `sender` of a Leader, and
+  // that keeps `sender` alive for as long as it is used.
+  static DpfPirServer::ForwardHelperRequestFn AsForwardHelperRequestFn(
+      std::shared_ptr<const HedgedHelperSender> sender);
+
+  // Sends `helper_request` to the replicas as described above. Calls
+  // `while_waiting` on the calling thread after the first replica has been
+  // contacted. Returns as soon as a valid response arrived, without waiting
+  // for the other replica calls, which are cancelled and finish in the
+  // background on the sender's threads.
+  //
+  // Returns the first valid response. If all replicas fail, returns the error
+  // of the first replica.
+  absl::StatusOr<PirResponse> Send(
+      const PirRequest& helper_request,
+      absl::AnyInvocable<void()> while_waiting) const;
+
+  // Returns a snapshot of the current counters.
+  Stats GetStats() const;
+
+ private:
+  // State of a single call to Send.
+  struct CallState;
+
+  HedgedHelperSender(std::vector<ReplicaFn> replicas, Options options);
+
+  // Queues a call to the next replica for `state`, and schedules a hedge if
+  // more replicas may be called. Requires `state->mu` to be held.
+  void LaunchReplicaCall(const std::shared_ptr<CallState>& state) const;
+
+  // Main loop of each call thread. Runs queued replica calls until the
+  // destructor is called.
+  void RunCallThread() const;
+
+  // Main loop of the hedge thread. Launches a duplicate call for each request
+  // whose hedge is due, unless it already has a winner or launched another
+  // call since the hedge was scheduled.
+  void RunHedgeThread() const;
+
+  // Blocks until a hedge is due, and removes it from `hedges_`. Returns
+  // `false` once the destructor was called.
+  bool TakeNextHedge(std::shared_ptr<CallState>& state,
+                     int& num_launched) const;
+
+  const std::vector<ReplicaFn> replicas_;
+  const Options options_;
+
+  mutable absl::Mutex mu_;
+  mutable Stats stats_ ABSL_GUARDED_BY(mu_);
+  // Replica calls waiting for a call thread, oldest first, each with the index
+  // of the replica to call.
+  mutable std::deque<std::pair<std::shared_ptr<CallState>, int>> pending_calls_
+      ABSL_GUARDED_BY(mu_);
+  // Scheduled hedges by the time they are due, each with the number of calls
+  // launched for the request when the hedge was scheduled.
+  mutable std::multimap<absl::Time, std::pair<std::shared_ptr<CallState>, int>>
+      hedges_ ABSL_GUARDED_BY(mu_);
+  bool shutting_down_ ABSL_GUARDED_BY(mu_) = false;
+
+  // Started by the constructor and joined by the destructor.
+  std::vector<std::thread> call_threads_;
+  std::thread hedge_thread_;
+};
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_HEDGED_HELPER_SENDER_H_
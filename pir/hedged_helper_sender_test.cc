@@ -0,0 +1,384 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/hedged_helper_sender.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::StatusIs;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using Options = HedgedHelperSender::Options;
+
+PirResponse CreateResponse(std::string masked_response) {
+  PirResponse response;
+  response.mutable_dpf_pir_response()->add_masked_response(
+      std::move(masked_response));
+  return response;
+}
+
+// In-process stand-in for a Helper replica that responds after `latency`,
+// unless the call is cancelled before. Counts cancelled calls in `cancelled`,
+// if not NULL.
+HedgedHelperSender::ReplicaFn CreateReplica(
+    absl::Duration latency, absl::StatusOr<PirResponse> response,
+    std::atomic<int>* cancelled = nullptr) {
+  return [latency, response = std::move(response), cancelled](
+             const PirRequest& helper_request,
+             const absl::Notification& cancellation)
+             -> absl::StatusOr<PirResponse> {
+    if (cancellation.WaitForNotificationWithTimeout(latency)) {
+      if (cancelled != nullptr) {
+        ++*cancelled;
+      }
+      return absl::CancelledError("cancelled");
+    }
+    return response;
+  };
+}
+
+// Waits until `count` reaches `expected`, since cancelled calls finish after
+// Send returned. Returns the final value of `count`.
+int WaitForCount(const std::atomic<int>& count, int expected) {
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (count < expected && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  return count;
+}
+
+std::vector<HedgedHelperSender::ReplicaFn> CreateReplicas(
+    HedgedHelperSender::ReplicaFn primary,
+    HedgedHelperSender::ReplicaFn secondary) {
+  std::vector<HedgedHelperSender::ReplicaFn> replicas;
+  replicas.push_back(std::move(primary));
+  replicas.push_back(std::move(secondary));
+  return replicas;
+}
+
+TEST(HedgedHelperSender, CreateFailsWithoutReplicas) {
+  EXPECT_THAT(HedgedHelperSender::Create({}, Options()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`replicas` must not be empty")));
+}
+
+TEST(HedgedHelperSender, CreateFailsWithNullReplica) {
+  EXPECT_THAT(
+      HedgedHelperSender::Create(
+          CreateReplicas(CreateReplica(absl::ZeroDuration(), PirResponse()),
+                         nullptr),
+          Options()),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("`replicas[1]` cannot be null")));
+}
+
+TEST(HedgedHelperSender, CreateFailsWithTooManyHedgedRequests) {
+  Options options;
+  options.max_hedged_requests = 2;
+  EXPECT_THAT(
+      HedgedHelperSender::Create(
+          CreateReplicas(CreateReplica(absl::ZeroDuration(), PirResponse()),
+                         CreateReplica(absl::ZeroDuration(), PirResponse())),
+          options),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("max_hedged_requests")));
+}
+
+TEST(HedgedHelperSender, CreateFailsWithNonPositiveMaxConcurrentCalls) {
+  Options options;
+  options.max_concurrent_calls = 0;
+  EXPECT_THAT(
+      HedgedHelperSender::Create(
+          CreateReplicas(CreateReplica(absl::ZeroDuration(), PirResponse()),
+                         CreateReplica(absl::ZeroDuration(), PirResponse())),
+          options),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("`max_concurrent_calls` must be positive")));
+}
+
+TEST(HedgedHelperSender, FastPrimaryIsNotHedged) {
+  std::atomic<int> secondary_calls = 0;
+  Options options;
+  options.hedge_delay = absl::InfiniteDuration();
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender,
+      HedgedHelperSender::Create(
+          CreateReplicas(
+              CreateReplica(absl::ZeroDuration(), CreateResponse("primary")),
+              [&secondary_calls](const PirRequest&, const absl::Notification&)
+                  -> absl::StatusOr<PirResponse> {
+                ++secondary_calls;
+                return CreateResponse("secondary");
+              }),
+          options));
+
+  bool called_while_waiting = false;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      PirResponse response,
+      sender->Send(PirRequest(),
+                   [&called_while_waiting] { called_while_waiting = true; }));
+
+  EXPECT_TRUE(called_while_waiting);
+  EXPECT_THAT(response.dpf_pir_response().masked_response(),
+              ElementsAre("primary"));
+  EXPECT_EQ(secondary_calls, 0);
+  HedgedHelperSender::Stats stats = sender->GetStats();
+  EXPECT_EQ(stats.requests, 1);
+  EXPECT_EQ(stats.hedged_requests, 0);
+  EXPECT_EQ(stats.hedges_sent, 0);
+  EXPECT_EQ(stats.hedge_wins, 0);
+}
+
+TEST(HedgedHelperSender, SlowPrimaryIsHedgedAndCancelled) {
+  std::atomic<int> cancelled = 0;
+  Options options;
+  options.hedge_delay = absl::Milliseconds(10);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender,
+      HedgedHelperSender::Create(
+          CreateReplicas(
+              CreateReplica(absl::InfiniteDuration(),
+                            CreateResponse("primary"), &cancelled),
+              CreateReplica(absl::ZeroDuration(), CreateResponse("secondary"))),
+          options));
+
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response,
+                           sender->Send(PirRequest(), [] {}));
+
+  EXPECT_THAT(response.dpf_pir_response().masked_response(),
+              ElementsAre("secondary"));
+  EXPECT_EQ(WaitForCount(cancelled, 1), 1);
+  HedgedHelperSender::Stats stats = sender->GetStats();
+  EXPECT_EQ(stats.requests, 1);
+  EXPECT_EQ(stats.hedged_requests, 1);
+  EXPECT_EQ(stats.hedges_sent, 1);
+  EXPECT_EQ(stats.hedge_wins, 1);
+  EXPECT_EQ(stats.failed_requests, 0);
+}
+
+TEST(HedgedHelperSender, PrimaryWinsAfterHedging) {
+  std::atomic<int> cancelled = 0;
+  Options options;
+  options.hedge_delay = absl::Milliseconds(1);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender,
+      HedgedHelperSender::Create(
+          CreateReplicas(CreateReplica(absl::Milliseconds(20),
+                                       CreateResponse("primary")),
+                         CreateReplica(absl::InfiniteDuration(),
+                                       CreateResponse("secondary"),
+                                       &cancelled)),
+          options));
+
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response,
+                           sender->Send(PirRequest(), [] {}));
+
+  EXPECT_THAT(response.dpf_pir_response().masked_response(),
+              ElementsAre("primary"));
+  EXPECT_EQ(WaitForCount(cancelled, 1), 1);
+  HedgedHelperSender::Stats stats = sender->GetStats();
+  EXPECT_EQ(stats.hedged_requests, 1);
+  EXPECT_EQ(stats.hedge_wins, 0);
+}
+
+TEST(HedgedHelperSender, DoesNotWaitForReplicasIgnoringCancellation) {
+  // The primary only returns once `release` is notified, even if cancelled.
+  auto release = std::make_shared<absl::Notification>();
+  auto primary_done = std::make_shared<absl::Notification>();
+  Options options;
+  options.hedge_delay = absl::Milliseconds(1);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender,
+      HedgedHelperSender::Create(
+          CreateReplicas(
+              [release, primary_done](const PirRequest&,
+                                      const absl::Notification&)
+                  -> absl::StatusOr<PirResponse> {
+                release->WaitForNotification();
+                primary_done->Notify();
+                return CreateResponse("primary");
+              },
+              CreateReplica(absl::ZeroDuration(), CreateResponse("secondary"))),
+          options));
+
+  const absl::Time start = absl::Now();
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response,
+                           sender->Send(PirRequest(), [] {}));
+
+  EXPECT_LT(absl::Now() - start, absl::Seconds(5));
+  EXPECT_FALSE(primary_done->HasBeenNotified());
+  EXPECT_THAT(response.dpf_pir_response().masked_response(),
+              ElementsAre("secondary"));
+  EXPECT_EQ(sender->GetStats().hedge_wins, 1);
+
+  // The straggler finishes in the background, and the destructor waits for
+  // it.
+  std::thread releaser([release] {
+    absl::SleepFor(absl::Milliseconds(10));
+    release->Notify();
+  });
+  sender.reset();
+  EXPECT_TRUE(primary_done->HasBeenNotified());
+  releaser.join();
+}
+
+TEST(HedgedHelperSender, HedgeWaitsForFreeCallThread) {
+  std::atomic<int> secondary_calls = 0;
+  Options options;
+  options.hedge_delay = absl::Milliseconds(1);
+  options.max_concurrent_calls = 1;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender,
+      HedgedHelperSender::Create(
+          CreateReplicas(
+              CreateReplica(absl::Milliseconds(50), CreateResponse("primary")),
+              [&secondary_calls](const PirRequest&, const absl::Notification&)
+                  -> absl::StatusOr<PirResponse> {
+                ++secondary_calls;
+                return CreateResponse("secondary");
+              }),
+          options));
+
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response,
+                           sender->Send(PirRequest(), [] {}));
+
+  // The hedge is launched, but the only call thread is busy with the primary,
+  // which wins. The queued hedge is then dropped without calling the replica.
+  EXPECT_THAT(response.dpf_pir_response().masked_response(),
+              ElementsAre("primary"));
+  HedgedHelperSender::Stats stats = sender->GetStats();
+  EXPECT_EQ(stats.hedges_sent, 1);
+  EXPECT_EQ(stats.hedge_wins, 0);
+  sender.reset();
+  EXPECT_EQ(secondary_calls, 0);
+}
+
+TEST(HedgedHelperSender, FailedPrimaryIsHedgedImmediately) {
+  Options options;
+  options.hedge_delay = absl::InfiniteDuration();
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender,
+      HedgedHelperSender::Create(
+          CreateReplicas(
+              CreateReplica(absl::ZeroDuration(),
+                            absl::UnavailableError("primary is down")),
+              CreateReplica(absl::ZeroDuration(), CreateResponse("secondary"))),
+          options));
+
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response,
+                           sender->Send(PirRequest(), [] {}));
+
+  EXPECT_THAT(response.dpf_pir_response().masked_response(),
+              ElementsAre("secondary"));
+  EXPECT_EQ(sender->GetStats().hedge_wins, 1);
+}
+
+TEST(HedgedHelperSender, InvalidResponseIsTreatedAsFailure) {
+  Options options;
+  options.hedge_delay = absl::InfiniteDuration();
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender,
+      HedgedHelperSender::Create(
+          CreateReplicas(
+              CreateReplica(absl::ZeroDuration(), PirResponse()),
+              CreateReplica(absl::ZeroDuration(), CreateResponse("secondary"))),
+          options));
+
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response,
+                           sender->Send(PirRequest(), [] {}));
+
+  EXPECT_THAT(response.dpf_pir_response().masked_response(),
+              ElementsAre("secondary"));
+}
+
+TEST(HedgedHelperSender, ReturnsFirstErrorIfAllReplicasFail) {
+  Options options;
+  options.hedge_delay = absl::Milliseconds(1);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender,
+      HedgedHelperSender::Create(
+          CreateReplicas(CreateReplica(absl::Milliseconds(5),
+                                       absl::UnavailableError("primary")),
+                         CreateReplica(absl::ZeroDuration(),
+                                       absl::UnavailableError("secondary"))),
+          options));
+
+  EXPECT_THAT(sender->Send(PirRequest(), [] {}),
+              StatusIs(absl::StatusCode::kUnavailable, "primary"));
+  HedgedHelperSender::Stats stats = sender->GetStats();
+  EXPECT_EQ(stats.requests, 1);
+  EXPECT_EQ(stats.failed_requests, 1);
+}
+
+TEST(HedgedHelperSender, WithoutHedgingOnlyPrimaryIsUsed) {
+  Options options;
+  options.max_hedged_requests = 0;
+  options.hedge_delay = absl::ZeroDuration();
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto sender,
+      HedgedHelperSender::Create(
+          CreateReplicas(
+              CreateReplica(absl::Milliseconds(10), CreateResponse("primary")),
+              CreateReplica(absl::ZeroDuration(), CreateResponse("secondary"))),
+          options));
+
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response,
+                           sender->Send(PirRequest(), [] {}));
+
+  EXPECT_THAT(response.dpf_pir_response().masked_response(),
+              ElementsAre("primary"));
+  EXPECT_EQ(sender->GetStats().hedges_sent, 0);
+}
+
+TEST(HedgedHelperSender, AsForwardHelperRequestFnForwardsToSender) {
+  Options options;
+  options.hedge_delay = absl::Milliseconds(10);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::shared_ptr<HedgedHelperSender> sender,
+      HedgedHelperSender::Create(
+          CreateReplicas(
+              CreateReplica(absl::InfiniteDuration(),
+                            CreateResponse("primary")),
+              CreateReplica(absl::ZeroDuration(), CreateResponse("secondary"))),
+          options));
+  DpfPirServer::ForwardHelperRequestFn forward =
+      HedgedHelperSender::AsForwardHelperRequestFn(sender);
+
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response, forward(PirRequest(), [] {}));
+
+  EXPECT_THAT(response.dpf_pir_response().masked_response(),
+              ElementsAre("secondary"));
+  EXPECT_EQ(sender->GetStats().hedge_wins, 1);
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
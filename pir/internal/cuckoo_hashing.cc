@@ -0,0 +1,213 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/internal/cuckoo_hashing.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/distributed_point_function.pb.h"
+#include "dpf/status_macros.h"
+#include "dpf/xor_wrapper.h"
+#include "openssl/rand.h"
+#include "pir/dense_dpf_pir_client.h"
+#include "pir/hashing/fingerprint_function.h"
+#include "pir/hashing/hash_family.h"
+#include "pir/hashing/hash_family_config.h"
+#include "pir/hashing/hash_family_config.pb.h"
+#include "pir/hashing/sha256_hash_family.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+namespace pir_internal {
+
+namespace {
+
+constexpr int kNumHashFunctions = 3;
+constexpr double kBucketsPerElement = 1.5;
+constexpr int kHashFunctionSeedLengthBytes = 16;
+constexpr int kDpfBlockSizeBits = 8 * sizeof(absl::uint128);
+
+// Always returns an InternalError. Used in the constructor for the bucket
+// client, which should never be called directly.
+absl::StatusOr<std::string> DummyEncrypter(absl::string_view plaintext,
+                                           absl::string_view context_info) {
+  return absl::InternalError(
+      "This PIR client is wrapped by a cuckoo hashing PIR client and should "
+      "never be called directly");
+}
+
+}  // namespace
+
+absl::StatusOr<CuckooHashingParams> GenerateCuckooHashingParams(
+    int64_t num_elements, HashFamilyConfig::HashFamily hash_family) {
+  if (num_elements <= 0) {
+    return absl::InvalidArgumentError("`num_elements` must be positive");
+  }
+  if (hash_family == HashFamilyConfig::HASH_FAMILY_UNSPECIFIED) {
+    return absl::InvalidArgumentError("`hash_family` must be set");
+  }
+  CuckooHashingParams params;
+  std::string seed(kHashFunctionSeedLengthBytes, '\0');
+  RAND_bytes(reinterpret_cast<uint8_t*>(&seed[0]), seed.size());
+  params.mutable_hash_family_config()->set_seed(std::move(seed));
+  params.mutable_hash_family_config()->set_hash_family(hash_family);
+  params.set_num_hash_functions(kNumHashFunctions);
+  params.set_num_buckets(kBucketsPerElement * num_elements);
+  return params;
+}
+
+absl::Status ValidateCuckooHashingParams(const CuckooHashingParams& params) {
+  if (params.num_buckets() <= 0) {
+    return absl::InvalidArgumentError("`num_buckets` must be positive");
+  }
+  if (params.num_hash_functions() <= 0) {
+    return absl::InvalidArgumentError("`num_hash_functions` must be positive");
+  }
+  if (params.hash_family_config().hash_family() ==
+      HashFamilyConfig::HASH_FAMILY_UNSPECIFIED) {
+    return absl::InvalidArgumentError(
+        "params.hash_family_config.hash_family must be set");
+  }
+  return absl::OkStatus();
+}
+
+int ComputeSeedFingerprint(const CuckooHashingParams& params) {
+  return SHA256HashFunction("")(params.hash_family_config().seed(),
+                                std::numeric_limits<int>::max());
+}
+
+absl::StatusOr<std::vector<HashFunction>> CreateBucketHashFunctions(
+    const CuckooHashingParams& params) {
+  DPF_ASSIGN_OR_RETURN(HashFamily hash_family,
+                       CreateHashFamilyFromConfig(params.hash_family_config()));
+  return CreateHashFunctions(std::move(hash_family),
+                             params.num_hash_functions());
+}
+
+absl::StatusOr<FingerprintFunction> CreateKeyFingerprintFunction(
+    const CuckooHashingParams& params) {
+  if (params.fingerprint_bytes() <= 0) {
+    return absl::InvalidArgumentError("`fingerprint_bytes` must be positive");
+  }
+  DPF_ASSIGN_OR_RETURN(HashFamily hash_family,
+                       CreateHashFamilyFromConfig(params.hash_family_config()));
+  return FingerprintFunction::Create(std::move(hash_family),
+                                     params.fingerprint_bytes());
+}
+
+absl::StatusOr<std::unique_ptr<DistributedPointFunction>>
+CreateBucketSelectionDpf(int64_t num_buckets) {
+  DpfParameters dpf_parameters;
+  dpf_parameters.set_log_domain_size(
+      static_cast<int>(std::ceil(std::log2(num_buckets))));
+  dpf_parameters.mutable_value_type()->mutable_xor_wrapper()->set_bitsize(
+      kDpfBlockSizeBits);
+  return DistributedPointFunction::Create(dpf_parameters);
+}
+
+absl::StatusOr<const DpfPirRequest::PlainRequest*> GetCuckooHashingPlainRequest(
+    const PirRequest& request, int seed_fingerprint) {
+  if (request.wrapped_pir_request_case() != PirRequest::kDpfPirRequest) {
+    return absl::InvalidArgumentError(
+        "`request` does not contain a valid DpfPirRequest");
+  }
+  if (request.dpf_pir_request().wrapped_request_case() !=
+      DpfPirRequest::kPlainRequest) {
+    return absl::InvalidArgumentError(
+        "`request` does not contain a valid DpfPirRequest::PlainRequest");
+  }
+  const DpfPirRequest::PlainRequest& plain_request =
+      request.dpf_pir_request().plain_request();
+  if (plain_request.dpf_key_size() == 0) {
+    return absl::InvalidArgumentError("`dpf_key` must not be empty");
+  }
+  if (plain_request.seed_fingerprint() != 0 &&
+      plain_request.seed_fingerprint() != seed_fingerprint) {
+    return absl::InvalidArgumentError(
+        "`seed_fingerprint` does not match. Please ensure that all servers and "
+        "the client are initialized with the same parameters.");
+  }
+  return &plain_request;
+}
+
+absl::StatusOr<std::vector<XorWrapper<absl::uint128>>> EvaluateBucketSelections(
+    const DistributedPointFunction& dpf, int64_t num_buckets,
+    const DpfPirRequest::PlainRequest& plain_request) {
+  return dpf.EvaluateUntilBatch<XorWrapper<absl::uint128>>(
+      0,
+      absl::MakeConstSpan(plain_request.dpf_key().data(),
+                          plain_request.dpf_key_size()),
+      (num_buckets + kDpfBlockSizeBits - 1) / kDpfBlockSizeBits);
+}
+
+absl::StatusOr<std::unique_ptr<DenseDpfPirClient>> CreateBucketClient(
+    int64_t num_buckets) {
+  PirConfig config;
+  config.mutable_dense_dpf_pir_config()->set_num_elements(num_buckets);
+  return DenseDpfPirClient::Create(config, DummyEncrypter, "");
+}
+
+absl::StatusOr<std::tuple<DpfPirRequest::PlainRequest,
+                          DpfPirRequest::HelperRequest, std::string>>
+CreateBucketRequests(const DenseDpfPirClient& bucket_client,
+                     absl::Span<const HashFunction> hash_functions,
+                     int64_t num_buckets, int seed_fingerprint,
+                     absl::Span<const std::string> query) {
+  std::vector<int64_t> indices;
+  indices.reserve(hash_functions.size() * query.size());
+  for (const std::string& element : query) {
+    for (const HashFunction& hash_function : hash_functions) {
+      indices.push_back(hash_function(element, num_buckets));
+    }
+  }
+  DpfPirRequest::PlainRequest leader_request;
+  DpfPirRequest::HelperRequest helper_request;
+  PirRequestClientState request_client_state;
+  DPF_ASSIGN_OR_RETURN(
+      std::tie(leader_request, helper_request, request_client_state),
+      bucket_client.CreatePlainRequests(indices));
+  leader_request.set_seed_fingerprint(seed_fingerprint);
+  helper_request.mutable_plain_request()->set_seed_fingerprint(
+      seed_fingerprint);
+  return std::make_tuple(
+      std::move(leader_request), std::move(helper_request),
+      std::move(*request_client_state
+                     .mutable_dense_dpf_pir_request_client_state()
+                     ->mutable_one_time_pad_seed()));
+}
+
+absl::StatusOr<std::vector<std::string>> HandleBucketResponse(
+    const DenseDpfPirClient& bucket_client, const PirResponse& response,
+    const std::string& one_time_pad_seed) {
+  PirRequestClientState request_client_state;
+  request_client_state.mutable_dense_dpf_pir_request_client_state()
+      ->set_one_time_pad_seed(one_time_pad_seed);
+  return bucket_client.HandleResponse(response, request_client_state);
+}
+
+}  // namespace pir_internal
+}  // namespace distributed_point_functions
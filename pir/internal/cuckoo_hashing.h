@@ -0,0 +1,117 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_INTERNAL_CUCKOO_HASHING_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_INTERNAL_CUCKOO_HASHING_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/xor_wrapper.h"
+#include "pir/dense_dpf_pir_client.h"
+#include "pir/hashing/fingerprint_function.h"
+#include "pir/hashing/hash_family.h"
+#include "pir/hashing/hash_family_config.pb.h"
+#include "pir/private_information_retrieval.pb.h"
+
+// Shared implementation of the PIR servers and clients that cuckoo hash their
+// keys into a dense database, i.e., CuckooHashingSparseDpfPirServer/Client and
+// CuckooHashingMembershipDpfPirServer/Client.
+
+namespace distributed_point_functions {
+namespace pir_internal {
+
+// Returns CuckooHashingParams with a fresh random hash family seed for cuckoo
+// hashing `num_elements` elements with `hash_family`. Fields specific to a PIR
+// scheme, such as `fingerprint_bytes`, are left unset.
+//
+// Returns INVALID_ARGUMENT if `num_elements` is not positive or `hash_family`
+// is unspecified.
+absl::StatusOr<CuckooHashingParams> GenerateCuckooHashingParams(
+    int64_t num_elements, HashFamilyConfig::HashFamily hash_family);
+
+// Returns INVALID_ARGUMENT if `num_buckets` or `num_hash_functions` in
+// `params` is not positive, or if the hash family is unspecified.
+absl::Status ValidateCuckooHashingParams(const CuckooHashingParams& params);
+
+// Returns the first 31 bits of the SHA256 hash of the hash family seed in
+// `params`. Used to check that client and both servers use the same seed.
+int ComputeSeedFingerprint(const CuckooHashingParams& params);
+
+// Returns the `params.num_hash_functions` hash functions mapping keys to their
+// candidate buckets.
+absl::StatusOr<std::vector<HashFunction>> CreateBucketHashFunctions(
+    const CuckooHashingParams& params);
+
+// Returns the function computing key fingerprints of `params.fingerprint_bytes`
+// bytes.
+//
+// Returns INVALID_ARGUMENT if `params.fingerprint_bytes` is not positive.
+absl::StatusOr<FingerprintFunction> CreateKeyFingerprintFunction(
+    const CuckooHashingParams& params);
+
+// Server side: Creates the DPF whose keys select one of `num_buckets` buckets.
+absl::StatusOr<std::unique_ptr<DistributedPointFunction>>
+CreateBucketSelectionDpf(int64_t num_buckets);
+
+// Server side: Returns the plain request in `request`, or INVALID_ARGUMENT if
+// it has no DPF keys or its seed fingerprint doesn't match `seed_fingerprint`.
+absl::StatusOr<const DpfPirRequest::PlainRequest*> GetCuckooHashingPlainRequest(
+    const PirRequest& request, int seed_fingerprint);
+
+// Server side: Evaluates all DPF keys of `plain_request` together, so that
+// their (small) trees share AES batches. Returns the selection blocks of each
+// key, stored back to back. Each block holds the selection bits of 128
+// buckets, so the domain beyond the last bucket isn't expanded.
+absl::StatusOr<std::vector<XorWrapper<absl::uint128>>> EvaluateBucketSelections(
+    const DistributedPointFunction& dpf, int64_t num_buckets,
+    const DpfPirRequest::PlainRequest& plain_request);
+
+// Client side: Creates a dense client that generates the DPF keys of a cuckoo
+// hashing client for `num_buckets` buckets. The returned client cannot create
+// encrypted requests on its own.
+absl::StatusOr<std::unique_ptr<DenseDpfPirClient>> CreateBucketClient(
+    int64_t num_buckets);
+
+// Client side: Creates DPF keys with `bucket_client` for the candidate buckets
+// of each element of `query`, ordered by element and then by hash function.
+// Returns the requests for Leader and Helper, and the seed of the one-time pad
+// that masks the responses.
+absl::StatusOr<std::tuple<DpfPirRequest::PlainRequest,
+                          DpfPirRequest::HelperRequest, std::string>>
+CreateBucketRequests(const DenseDpfPirClient& bucket_client,
+                     absl::Span<const HashFunction> hash_functions,
+                     int64_t num_buckets, int seed_fingerprint,
+                     absl::Span<const std::string> query);
+
+// Client side: Returns the unmasked records in `response` to a request created
+// by `CreateBucketRequests` with the given `one_time_pad_seed`.
+absl::StatusOr<std::vector<std::string>> HandleBucketResponse(
+    const DenseDpfPirClient& bucket_client, const PirResponse& response,
+    const std::string& one_time_pad_seed);
+
+}  // namespace pir_internal
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_INTERNAL_CUCKOO_HASHING_H_
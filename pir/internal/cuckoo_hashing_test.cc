@@ -0,0 +1,171 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/internal/cuckoo_hashing.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "dpf/distributed_point_function.h"
+#include "dpf/internal/status_matchers.h"
+#include "dpf/xor_wrapper.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "pir/dense_dpf_pir_client.h"
+#include "pir/hashing/fingerprint_function.h"
+#include "pir/hashing/hash_family.h"
+#include "pir/hashing/hash_family_config.pb.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+namespace pir_internal {
+namespace {
+
+using dpf_internal::StatusIs;
+using ::testing::HasSubstr;
+using ::testing::SizeIs;
+
+constexpr int kNumElements = 100;
+
+CuckooHashingParams GenerateTestParams() {
+  absl::StatusOr<CuckooHashingParams> params = GenerateCuckooHashingParams(
+      kNumElements, HashFamilyConfig::HASH_FAMILY_SHA256);
+  EXPECT_TRUE(params.ok());
+  return *params;
+}
+
+TEST(CuckooHashingTest, GenerateParamsFailsIfNumElementsIsNotPositive) {
+  EXPECT_THAT(
+      GenerateCuckooHashingParams(0, HashFamilyConfig::HASH_FAMILY_SHA256),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               "`num_elements` must be positive"));
+}
+
+TEST(CuckooHashingTest, GenerateParamsFailsIfHashFamilyIsUnspecified) {
+  EXPECT_THAT(GenerateCuckooHashingParams(
+                  kNumElements, HashFamilyConfig::HASH_FAMILY_UNSPECIFIED),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`hash_family` must be set"));
+}
+
+TEST(CuckooHashingTest, GenerateParamsUsesFreshSeeds) {
+  CuckooHashingParams params1 = GenerateTestParams();
+  CuckooHashingParams params2 = GenerateTestParams();
+  DPF_EXPECT_OK(ValidateCuckooHashingParams(params1));
+  EXPECT_GE(params1.num_buckets(), kNumElements);
+  EXPECT_NE(params1.hash_family_config().seed(),
+            params2.hash_family_config().seed());
+  EXPECT_NE(ComputeSeedFingerprint(params1), ComputeSeedFingerprint(params2));
+}
+
+TEST(CuckooHashingTest, ValidateParamsFailsIfParamsAreInvalid) {
+  CuckooHashingParams params = GenerateTestParams();
+  params.set_num_buckets(0);
+  EXPECT_THAT(ValidateCuckooHashingParams(params),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("num_buckets")));
+  params = GenerateTestParams();
+  params.set_num_hash_functions(0);
+  EXPECT_THAT(ValidateCuckooHashingParams(params),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("num_hash_functions")));
+  params = GenerateTestParams();
+  params.mutable_hash_family_config()->clear_hash_family();
+  EXPECT_THAT(ValidateCuckooHashingParams(params),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("hash_family")));
+}
+
+TEST(CuckooHashingTest, CreateKeyFingerprintFunctionFailsWithoutBytes) {
+  EXPECT_THAT(CreateKeyFingerprintFunction(GenerateTestParams()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`fingerprint_bytes` must be positive"));
+}
+
+TEST(CuckooHashingTest, GetPlainRequestFailsIfSeedFingerprintDoesNotMatch) {
+  PirRequest request;
+  DpfPirRequest::PlainRequest* plain_request =
+      request.mutable_dpf_pir_request()->mutable_plain_request();
+  plain_request->add_dpf_key();
+  plain_request->set_seed_fingerprint(1);
+  DPF_EXPECT_OK(GetCuckooHashingPlainRequest(request, 1));
+  EXPECT_THAT(GetCuckooHashingPlainRequest(request, 2),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`seed_fingerprint` does not match")));
+  plain_request->clear_dpf_key();
+  EXPECT_THAT(GetCuckooHashingPlainRequest(request, 1),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`dpf_key` must not be empty"));
+}
+
+TEST(CuckooHashingTest, BucketRequestsSelectCandidateBuckets) {
+  CuckooHashingParams params = GenerateTestParams();
+  const int seed_fingerprint = ComputeSeedFingerprint(params);
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<HashFunction> hash_functions,
+                           CreateBucketHashFunctions(params));
+  ASSERT_THAT(hash_functions, SizeIs(params.num_hash_functions()));
+  DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<DenseDpfPirClient> client,
+                           CreateBucketClient(params.num_buckets()));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<DistributedPointFunction> dpf,
+      CreateBucketSelectionDpf(params.num_buckets()));
+
+  const std::vector<std::string> query = {"key1", "key2"};
+  DpfPirRequest::PlainRequest leader_request;
+  DpfPirRequest::HelperRequest helper_request;
+  std::string otp_seed;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::tie(leader_request, helper_request, otp_seed),
+      CreateBucketRequests(*client, hash_functions, params.num_buckets(),
+                           seed_fingerprint, query));
+  EXPECT_EQ(leader_request.seed_fingerprint(), seed_fingerprint);
+  EXPECT_EQ(helper_request.plain_request().seed_fingerprint(),
+            seed_fingerprint);
+  EXPECT_FALSE(otp_seed.empty());
+
+  // The XOR of both parties' selections is one bit per candidate bucket.
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<XorWrapper<absl::uint128>> selections0,
+      EvaluateBucketSelections(*dpf, params.num_buckets(), leader_request));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      std::vector<XorWrapper<absl::uint128>> selections1,
+      EvaluateBucketSelections(*dpf, params.num_buckets(),
+                               helper_request.plain_request()));
+  const int num_keys = query.size() * hash_functions.size();
+  ASSERT_EQ(selections0.size(), selections1.size());
+  ASSERT_EQ(selections0.size() % num_keys, 0);
+  const int64_t blocks_per_key = selections0.size() / num_keys;
+  for (int i = 0; i < query.size(); ++i) {
+    for (int j = 0; j < hash_functions.size(); ++j) {
+      const int key = i * hash_functions.size() + j;
+      const int64_t bucket = hash_functions[j](query[i], params.num_buckets());
+      for (int64_t b = 0; b < params.num_buckets(); ++b) {
+        const int64_t block = key * blocks_per_key + b / 128;
+        absl::uint128 bits =
+            (selections0[block] + selections1[block]).value();
+        EXPECT_EQ((bits >> (b % 128)) & 1, b == bucket ? 1 : 0)
+            << "i=" << i << " j=" << j << " b=" << b;
+      }
+    }
+  }
+}
+
+}  // namespace
+}  // namespace pir_internal
+}  // namespace distributed_point_functions
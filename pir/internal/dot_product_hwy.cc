@@ -0,0 +1,219 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/internal/dot_product_hwy.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "dpf/status_macros.h"
+
+// Guard the following definition of inline functions to make sure they are
+// defined only once, since hwy/foreach_target.h will include this .cc file
+// multiple times (once for each target archtechture).
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_INTERNAL_DOT_PRODUCT_HWY_INLINE_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_INTERNAL_DOT_PRODUCT_HWY_INLINE_
+
+namespace distributed_point_functions {
+namespace pir_internal {
+
+// Scalar dot product of `selection` and `values` starting at index `start`.
+// All arithmetic is modulo 2^64.
+template <typename T>
+inline uint64_t DotProductScalar(const uint64_t* selection, const T* values,
+                                 int64_t start, int64_t size) {
+  uint64_t result = 0;
+  for (int64_t i = start; i < size; ++i) {
+    result += selection[i] * static_cast<uint64_t>(values[i]);
+  }
+  return result;
+}
+
+}  // namespace pir_internal
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_INTERNAL_DOT_PRODUCT_HWY_INLINE_
+
+// Highway implementations.
+// clang-format off
+#undef HWY_TARGET_INCLUDE
+#define HWY_TARGET_INCLUDE "pir/internal/dot_product_hwy.cc"
+#include "hwy/foreach_target.h"  // IWYU pragma: keep
+// clang-format on
+
+// Must come after foreach_target.h to avoid redefinition errors.
+#include "hwy/highway.h"
+
+HWY_BEFORE_NAMESPACE();
+namespace distributed_point_functions::pir_internal {
+namespace HWY_NAMESPACE {
+
+namespace hn = hwy::HWY_NAMESPACE;
+
+#if HWY_TARGET == HWY_SCALAR
+
+uint64_t DotProductU64Hwy(const uint64_t* selection, const uint64_t* values,
+                          int64_t size) {
+  return DotProductScalar(selection, values, 0, size);
+}
+
+uint64_t DotProductU32Hwy(const uint64_t* selection, const uint32_t* values,
+                          int64_t size) {
+  return DotProductScalar(selection, values, 0, size);
+}
+
+#else
+
+// Returns the lower 64 bits of the lane-wise product of `a` and `b`. Not all
+// targets support 64-bit multiplication, so we compose it from 32x32->64 bit
+// multiplications of the lower and upper halves:
+//
+//   a * b mod 2^64 = a_lo * b_lo + ((a_hi * b_lo + a_lo * b_hi) << 32).
+//
+// `MulEven` multiplies the even (i.e., lower) 32-bit halves of each 64-bit
+// lane, so we only need to shift the upper halves down.
+template <class V>
+HWY_INLINE V MulLow64(V a, V b) {
+  const hn::Repartition<uint32_t, hn::DFromV<V>> d32;
+  const V lo_lo = hn::MulEven(hn::BitCast(d32, a), hn::BitCast(d32, b));
+  const V hi_lo =
+      hn::MulEven(hn::BitCast(d32, hn::ShiftRight<32>(a)), hn::BitCast(d32, b));
+  const V lo_hi =
+      hn::MulEven(hn::BitCast(d32, a), hn::BitCast(d32, hn::ShiftRight<32>(b)));
+  return hn::Add(lo_lo, hn::ShiftLeft<32>(hn::Add(hi_lo, lo_hi)));
+}
+
+// As `MulLow64`, but assumes that the upper half of each lane of `b` is zero,
+// which saves one multiplication.
+template <class V>
+HWY_INLINE V MulLow64By32(V a, V b) {
+  const hn::Repartition<uint32_t, hn::DFromV<V>> d32;
+  const V lo_lo = hn::MulEven(hn::BitCast(d32, a), hn::BitCast(d32, b));
+  const V hi_lo =
+      hn::MulEven(hn::BitCast(d32, hn::ShiftRight<32>(a)), hn::BitCast(d32, b));
+  return hn::Add(lo_lo, hn::ShiftLeft<32>(hi_lo));
+}
+
+uint64_t DotProductU64Hwy(const uint64_t* selection, const uint64_t* values,
+                          int64_t size) {
+  const hn::ScalableTag<uint64_t> d64;
+  const int64_t N = hn::Lanes(d64);
+
+  // Use two independent accumulators to hide the latency of the
+  // multiply-accumulate chain.
+  auto acc0 = hn::Zero(d64);
+  auto acc1 = hn::Zero(d64);
+  int64_t i = 0;
+  for (; i + 2 * N <= size; i += 2 * N) {
+    acc0 = hn::Add(acc0, MulLow64(hn::LoadU(d64, selection + i),
+                                  hn::LoadU(d64, values + i)));
+    acc1 = hn::Add(acc1, MulLow64(hn::LoadU(d64, selection + i + N),
+                                  hn::LoadU(d64, values + i + N)));
+  }
+  for (; i + N <= size; i += N) {
+    acc0 = hn::Add(acc0, MulLow64(hn::LoadU(d64, selection + i),
+                                  hn::LoadU(d64, values + i)));
+  }
+  uint64_t result = hn::GetLane(hn::SumOfLanes(d64, hn::Add(acc0, acc1)));
+  return result + DotProductScalar(selection, values, i, size);
+}
+
+uint64_t DotProductU32Hwy(const uint64_t* selection, const uint32_t* values,
+                          int64_t size) {
+  const hn::ScalableTag<uint64_t> d64;
+  // Half-width vector of 32-bit values with the same number of lanes as d64.
+  const hn::Rebind<uint32_t, decltype(d64)> d32;
+  const int64_t N = hn::Lanes(d64);
+
+  auto acc0 = hn::Zero(d64);
+  auto acc1 = hn::Zero(d64);
+  int64_t i = 0;
+  for (; i + 2 * N <= size; i += 2 * N) {
+    acc0 = hn::Add(
+        acc0, MulLow64By32(hn::LoadU(d64, selection + i),
+                           hn::PromoteTo(d64, hn::LoadU(d32, values + i))));
+    acc1 = hn::Add(
+        acc1, MulLow64By32(hn::LoadU(d64, selection + i + N),
+                           hn::PromoteTo(d64, hn::LoadU(d32, values + i + N))));
+  }
+  for (; i + N <= size; i += N) {
+    acc0 = hn::Add(
+        acc0, MulLow64By32(hn::LoadU(d64, selection + i),
+                           hn::PromoteTo(d64, hn::LoadU(d32, values + i))));
+  }
+  uint64_t result = hn::GetLane(hn::SumOfLanes(d64, hn::Add(acc0, acc1)));
+  return result + DotProductScalar(selection, values, i, size);
+}
+
+#endif  // HWY_TARGET == HWY_SCALAR
+
+}  // namespace HWY_NAMESPACE
+}  // namespace distributed_point_functions::pir_internal
+HWY_AFTER_NAMESPACE();
+
+#if HWY_ONCE || HWY_IDE
+namespace distributed_point_functions {
+namespace pir_internal {
+
+namespace {
+
+absl::Status CheckSizes(size_t selection_size, size_t values_size) {
+  if (selection_size != values_size) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("`selection.size()` (=", selection_size,
+                     ") does not match `values.size()` (=", values_size, ")"));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::StatusOr<uint64_t> DotProductNoHwy(absl::Span<const uint64_t> selection,
+                                         absl::Span<const uint64_t> values) {
+  DPF_RETURN_IF_ERROR(CheckSizes(selection.size(), values.size()));
+  return DotProductScalar(selection.data(), values.data(), 0,
+                          static_cast<int64_t>(values.size()));
+}
+
+absl::StatusOr<uint64_t> DotProductNoHwy(absl::Span<const uint64_t> selection,
+                                         absl::Span<const uint32_t> values) {
+  DPF_RETURN_IF_ERROR(CheckSizes(selection.size(), values.size()));
+  return DotProductScalar(selection.data(), values.data(), 0,
+                          static_cast<int64_t>(values.size()));
+}
+
+HWY_EXPORT(DotProductU64Hwy);
+HWY_EXPORT(DotProductU32Hwy);
+
+absl::StatusOr<uint64_t> DotProduct(absl::Span<const uint64_t> selection,
+                                    absl::Span<const uint64_t> values) {
+  DPF_RETURN_IF_ERROR(CheckSizes(selection.size(), values.size()));
+  return HWY_DYNAMIC_DISPATCH(DotProductU64Hwy)(
+      selection.data(), values.data(), static_cast<int64_t>(values.size()));
+}
+
+absl::StatusOr<uint64_t> DotProduct(absl::Span<const uint64_t> selection,
+                                    absl::Span<const uint32_t> values) {
+  DPF_RETURN_IF_ERROR(CheckSizes(selection.size(), values.size()));
+  return HWY_DYNAMIC_DISPATCH(DotProductU32Hwy)(
+      selection.data(), values.data(), static_cast<int64_t>(values.size()));
+}
+
+}  // namespace pir_internal
+}  // namespace distributed_point_functions
+#endif  // HWY_ONCE || HWY_IDE
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_INTERNAL_DOT_PRODUCT_HWY_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_INTERNAL_DOT_PRODUCT_HWY_H_
+
+#include <stdint.h>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+
+namespace distributed_point_functions {
+namespace pir_internal {
+
+// Returns the dot product between `selection` and `values` modulo 2^64, i.e.,
+// the sum of `selection[i] * values[i]` over all i. Used for additive PIR,
+// where `selection` holds one additive share per record.
+//
+// Returns INVALID_ARGUMENT if `selection` and `values` have different sizes.
+absl::StatusOr<uint64_t> DotProduct(absl::Span<const uint64_t> selection,
+                                    absl::Span<const uint64_t> values);
+
+// As above, but for 32-bit `values`, which are zero-extended to 64 bits before
+// multiplication. Reading 32-bit values halves the memory traffic for columns
+// that fit in 32 bits.
+absl::StatusOr<uint64_t> DotProduct(absl::Span<const uint64_t> selection,
+                                    absl::Span<const uint32_t> values);
+
+// As `DotProduct`, but does not provide explicit SIMD implementation.
+absl::StatusOr<uint64_t> DotProductNoHwy(absl::Span<const uint64_t> selection,
+                                         absl::Span<const uint64_t> values);
+absl::StatusOr<uint64_t> DotProductNoHwy(absl::Span<const uint64_t> selection,
+                                         absl::Span<const uint32_t> values);
+
+}  // namespace pir_internal
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_INTERNAL_DOT_PRODUCT_HWY_H_
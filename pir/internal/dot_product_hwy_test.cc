@@ -0,0 +1,142 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/internal/dot_product_hwy.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/types/span.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+// clang-format off
+#define HWY_IS_TEST 1
+#undef HWY_TARGET_INCLUDE
+#define HWY_TARGET_INCLUDE "pir/internal/dot_product_hwy_test.cc"  // NOLINT
+#include "hwy/foreach_target.h"
+// clang-format on
+
+#include "hwy/highway.h"
+#include "hwy/tests/test_util-inl.h"
+
+HWY_BEFORE_NAMESPACE();
+namespace distributed_point_functions {
+namespace pir_internal {
+namespace HWY_NAMESPACE {
+
+using distributed_point_functions::dpf_internal::IsOkAndHolds;
+using distributed_point_functions::dpf_internal::StatusIs;
+using testing::HasSubstr;
+
+// Sizes that cover empty inputs, partial vectors, and multiple unrolled
+// iterations for all vector sizes supported by Highway.
+constexpr int kSizes[] = {0, 1, 2, 3, 7, 8, 9, 31, 64, 65, 1000};
+
+template <typename T>
+uint64_t ReferenceDotProduct(absl::Span<const uint64_t> selection,
+                             absl::Span<const T> values) {
+  uint64_t result = 0;
+  for (int i = 0; i < values.size(); ++i) {
+    result += selection[i] * static_cast<uint64_t>(values[i]);
+  }
+  return result;
+}
+
+void DotProductFailsWithMismatchingSizes() {
+  std::vector<uint64_t> selection(3);
+  std::vector<uint64_t> values64(4);
+  std::vector<uint32_t> values32(4);
+  EXPECT_THAT(DotProduct(selection, values64),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("does not match")));
+  EXPECT_THAT(DotProduct(selection, values32),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("does not match")));
+}
+
+void DotProductOf64BitValuesMatchesReference() {
+  absl::BitGen gen;
+  for (int size : kSizes) {
+    std::vector<uint64_t> selection(size), values(size);
+    for (int i = 0; i < size; ++i) {
+      selection[i] = absl::Uniform<uint64_t>(gen);
+      values[i] = absl::Uniform<uint64_t>(gen);
+    }
+    uint64_t expected = ReferenceDotProduct<uint64_t>(selection, values);
+    EXPECT_THAT(DotProduct(selection, values), IsOkAndHolds(expected));
+    EXPECT_THAT(DotProductNoHwy(selection, values), IsOkAndHolds(expected));
+  }
+}
+
+void DotProductOf32BitValuesMatchesReference() {
+  absl::BitGen gen;
+  for (int size : kSizes) {
+    std::vector<uint64_t> selection(size);
+    std::vector<uint32_t> values(size);
+    for (int i = 0; i < size; ++i) {
+      selection[i] = absl::Uniform<uint64_t>(gen);
+      values[i] = absl::Uniform<uint32_t>(gen);
+    }
+    uint64_t expected = ReferenceDotProduct<uint32_t>(selection, values);
+    EXPECT_THAT(DotProduct(selection, values), IsOkAndHolds(expected));
+    EXPECT_THAT(DotProductNoHwy(selection, values), IsOkAndHolds(expected));
+  }
+}
+
+void DotProductOfSharesReconstructsSelectedValue() {
+  // Additive shares of a point function with value 3 at index 5.
+  constexpr int kSize = 100;
+  absl::BitGen gen;
+  std::vector<uint64_t> share0(kSize), share1(kSize), values(kSize);
+  for (int i = 0; i < kSize; ++i) {
+    share0[i] = absl::Uniform<uint64_t>(gen);
+    share1[i] = -share0[i] + (i == 5 ? 3 : 0);
+    values[i] = absl::Uniform<uint64_t>(gen);
+  }
+  DPF_ASSERT_OK_AND_ASSIGN(uint64_t result0, DotProduct(share0, values));
+  DPF_ASSERT_OK_AND_ASSIGN(uint64_t result1, DotProduct(share1, values));
+  EXPECT_EQ(result0 + result1, 3 * values[5]);
+}
+
+void TestAll() {
+  DotProductFailsWithMismatchingSizes();
+  DotProductOf64BitValuesMatchesReference();
+  DotProductOf32BitValuesMatchesReference();
+  DotProductOfSharesReconstructsSelectedValue();
+}
+
+}  // namespace HWY_NAMESPACE
+}  // namespace pir_internal
+}  // namespace distributed_point_functions
+HWY_AFTER_NAMESPACE();
+
+#if HWY_ONCE
+
+namespace distributed_point_functions {
+namespace pir_internal {
+HWY_BEFORE_TEST(DotProductHwyTest);
+HWY_EXPORT_AND_TEST_P(DotProductHwyTest, TestAll);
+}  // namespace pir_internal
+}  // namespace distributed_point_functions
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+#endif
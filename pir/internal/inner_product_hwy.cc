@@ -28,6 +28,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
+#include "dpf/status_macros.h"
 #include "pir/canonical_status_payload_uris.h"
 #include "pir/private_information_retrieval.pb.h"
 
@@ -75,6 +76,77 @@ inline void XorStringInPlaceNoHwy(const absl::string_view value, char* result) {
   }
 }
 
+// Selection vectors stored back to back, as passed to `InnerProductInto`.
+class ConcatenatedSelections {
+ public:
+  ConcatenatedSelections(absl::Span<const BlockType> selections,
+                         int64_t num_selections)
+      : selections_(selections),
+        vector_size_(selections.size() / num_selections) {}
+
+  int64_t vector_size() const { return vector_size_; }
+
+  // Returns the i-th block of the k-th selection vector.
+  const BlockType& operator()(int64_t k, int64_t i) const {
+    return selections_[k * vector_size_ + i];
+  }
+
+ private:
+  absl::Span<const BlockType> selections_;
+  int64_t vector_size_;
+};
+
+// Selection vectors stored separately, as passed to `InnerProduct`.
+class SeparateSelections {
+ public:
+  explicit SeparateSelections(
+      absl::Span<const std::vector<BlockType>> selections)
+      : selections_(selections) {}
+
+  int64_t vector_size() const { return selections_[0].size(); }
+
+  // Returns the i-th block of the k-th selection vector.
+  const BlockType& operator()(int64_t k, int64_t i) const {
+    return selections_[k][i];
+  }
+
+ private:
+  absl::Span<const std::vector<BlockType>> selections_;
+};
+
+// Computes the inner products with all selection vectors in `selections`
+// without explicit SIMD instructions. `Selections` is one of the classes above.
+// Assumes all arguments have been validated by `InnerProductInto` or
+// `InnerProduct`.
+template <typename Selections>
+inline void InnerProductIntoNoHwyUnchecked(
+    absl::Span<const absl::string_view> values, const Selections& selections,
+    int64_t max_value_size, InnerProductOutputs outputs) {
+  const int64_t num_selections = outputs.size();
+  for (int64_t k = 0; k < num_selections; ++k) {
+    std::fill_n(outputs[k], max_value_size, '\0');
+  }
+  const int64_t selection_vector_size = selections.vector_size();
+  for (int64_t i = 0; i < selection_vector_size; ++i) {
+    const int64_t base = i * kBitsPerBlock;
+    for (int j = 0; j < kBitsPerBlock; ++j) {
+      if (base + j >= values.size()) {
+        break;
+      }
+      absl::string_view value = values[base + j];
+      for (int64_t k = 0; k < num_selections; ++k) {
+        const BlockType& selection_block = selections(k, i);
+        if ((selection_block.value() & (absl::uint128{1} << j)) == 0) {
+          // Skip this value since the selection bit at the index (base + j) is
+          // 0.
+          continue;
+        }
+        XorStringInPlaceNoHwy(value, outputs[k]);
+      }
+    }
+  }
+}
+
 }  // namespace pir_internal
 }  // namespace distributed_point_functions
 
@@ -99,11 +171,12 @@ namespace hn = hwy::HWY_NAMESPACE;
 
 #if HWY_TARGET == HWY_SCALAR
 
-absl::StatusOr<std::vector<std::string>> InnerProductHwy(
-    absl::Span<const absl::string_view> values,
-    absl::Span<const std::vector<BlockType>> selections,
-    int64_t max_value_size) {
-  return InnerProductNoHwy(values, selections, max_value_size);
+template <typename Selections>
+void InnerProductIntoHwyImpl(absl::Span<const absl::string_view> values,
+                             const Selections& selections,
+                             int64_t max_value_size,
+                             InnerProductOutputs outputs) {
+  InnerProductIntoNoHwyUnchecked(values, selections, max_value_size, outputs);
 }
 
 #else
@@ -156,41 +229,46 @@ inline void XorPartialString<HWY_MIN_POW2>(
     const uint8_t* /*value_ptr*/, int64_t /*pos*/, int64_t /*remaining*/,
     absl::Span<uint8_t* const> /*result_ptrs*/) {}
 
-absl::StatusOr<std::vector<std::string>> InnerProductHwy(
-    absl::Span<const absl::string_view> values,
-    absl::Span<const std::vector<BlockType>> selections,
-    int64_t max_value_size) {
+// Number of selection vectors whose results are updated together for each
+// value. Bounds the size of the array of result pointers, so that it can live
+// on the stack.
+constexpr int kMaxSelectionsPerPass = 64;
+
+// Computes the inner products with all selection vectors in `selections`.
+// Assumes all arguments have been validated by `InnerProductInto` or
+// `InnerProduct`.
+template <typename Selections>
+void InnerProductIntoHwyImpl(absl::Span<const absl::string_view> values,
+                             const Selections& selections,
+                             int64_t max_value_size,
+                             InnerProductOutputs outputs) {
   // Vector type used throughout this function: Largest byte vector available.
   const hn::ScalableTag<uint8_t> d8;
   const int N = hn::Lanes(d8);
   // Do not run the highway version if
   // - the number of bytes in a hwy vector is less than 16, or
-  // - the number of bytes in a hwy vector is not a multiple of 16.
-  if (ABSL_PREDICT_FALSE(N < 16 || N % 16 != 0)) {
-    return InnerProductNoHwy(values, selections, max_value_size);
+  // - the number of bytes in a hwy vector is not a multiple of 16, or
+  // - the outputs are not aligned for this vector size.
+  if (ABSL_PREDICT_FALSE(N < 16 || N % 16 != 0 ||
+                         kInnerProductOutputAlignment % kHwyAlignment != 0)) {
+    InnerProductIntoNoHwyUnchecked(values, selections, max_value_size,
+                                   outputs);
+    return;
   }
 
-  // Allocate aligned buffers to hold the intermediate values of inner products.
-  std::vector<hwy::AlignedFreeUniquePtr<uint8_t[]>> aligned_results;
-  aligned_results.reserve(selections.size());
-  for (int i = 0; i < selections.size(); ++i) {
-    aligned_results.emplace_back(hwy::AllocateAligned<uint8_t>(max_value_size));
-    if (aligned_results[i] == nullptr) {
-      return absl::ResourceExhaustedError("memory allocation error");
-    }
-    std::fill_n(aligned_results[i].get(), max_value_size, '\0');
+  const int64_t num_selections = outputs.size();
+  for (int64_t k = 0; k < num_selections; ++k) {
+    std::fill_n(outputs[k], max_value_size, '\0');
   }
 
-  // Compute the inner products using highway instructions. Assume all selection
-  // vectors have the same size.
-  const int64_t selection_vector_size = selections[0].size();
-  std::vector<uint8_t*> result_ptrs;
-  result_ptrs.reserve(aligned_results.size());
+  // Compute the inner products using highway instructions.
+  const int64_t selection_vector_size = selections.vector_size();
+  uint8_t* result_ptrs_storage[kMaxSelectionsPerPass];
   for (int64_t i = 0; i < selection_vector_size; ++i) {
     // The selection bits are packed in blocks, so we go over them next.
-    const int base = i * kBitsPerBlock;
+    const int64_t base = i * kBitsPerBlock;
     for (int j = 0; j < kBitsPerBlock; ++j) {
-      const int index = base + j;
+      const int64_t index = base + j;
       if (index >= values.size()) {
         break;  // end of values reached
       }
@@ -205,62 +283,78 @@ absl::StatusOr<std::vector<std::string>> InnerProductHwy(
       const bool is_value_aligned =
           (reinterpret_cast<uintptr_t>(value_ptr) & (kHwyAlignment - 1)) == 0;
 
-      // Go over each selection vector. If the current bit is 0, ignore it. If
-      // the value is unaligned, XOR it directly without HWY. Otherwise add the
+      // Go over the selection vectors in passes of at most
+      // kMaxSelectionsPerPass. If the current bit is 0, ignore it. If the value
+      // is unaligned, XOR it directly without HWY. Otherwise add the
       // corresponding result pointer to result_ptrs, to be processed with
       // Highway in parallel.
-      result_ptrs.clear();
-      for (int k = 0; k < selections.size(); ++k) {
-        const absl::uint128& selection_block = selections[k][i].value();
-        if ((selection_block & (absl::uint128{1} << j)) == 0) {
-          // Skip this value since the selection bit at the index (base + j) is
-          // 0. Theoretically this may introduce the possibility of timing
-          // attacks, i.e. if an attacker can precisely measure the execution
-          // time of this function then it may infer the distribution of
-          // selection bits. However, this doesn't seem to be a realistic attack
-          // scenatio in the context of 2-party DPF-based PIR.
-          continue;
+      for (int64_t pass_begin = 0; pass_begin < num_selections;
+           pass_begin += kMaxSelectionsPerPass) {
+        const int64_t pass_end =
+            std::min(pass_begin + kMaxSelectionsPerPass, num_selections);
+        int num_result_ptrs = 0;
+        for (int64_t k = pass_begin; k < pass_end; ++k) {
+          const absl::uint128& selection_block = selections(k, i).value();
+          if ((selection_block & (absl::uint128{1} << j)) == 0) {
+            // Skip this value since the selection bit at the index (base + j)
+            // is 0. Theoretically this may introduce the possibility of timing
+            // attacks, i.e. if an attacker can precisely measure the execution
+            // time of this function then it may infer the distribution of
+            // selection bits. However, this doesn't seem to be a realistic
+            // attack scenatio in the context of 2-party DPF-based PIR.
+            continue;
+          }
+          if (!is_value_aligned) {
+            // Compute XOR(value, result) using the non-highway version.
+            XorStringInPlaceNoHwy(values[index], outputs[k]);
+            continue;
+          }
+          result_ptrs_storage[num_result_ptrs++] =
+              reinterpret_cast<uint8_t*>(outputs[k]);
         }
-        if (!is_value_aligned) {
-          // Compute XOR(value, result) using the non-highway version.
-          XorStringInPlaceNoHwy(
-              values[index], reinterpret_cast<char*>(aligned_results[k].get()));
+        if (num_result_ptrs == 0) {
           continue;
         }
-        result_ptrs.push_back(aligned_results[k].get());
-      }
-      if (result_ptrs.empty()) {
-        continue;
-      }
-
-      // Compute XOR(value, result) using the Highway instructions.
-      // First, one hwy vector at a time.
-      int64_t pos = 0;
-      for (; pos + N <= value_size; pos += N) {
-        auto vec = hn::Load(d8, value_ptr + pos);
-        for (int k = 0; k < result_ptrs.size(); ++k) {
-          auto vec2 = hn::Xor(vec, hn::Load(d8, result_ptrs[k] + pos));
-          hn::Store(vec2, d8, result_ptrs[k] + pos);
+        const absl::Span<uint8_t* const> result_ptrs(result_ptrs_storage,
+                                                     num_result_ptrs);
+
+        // Compute XOR(value, result) using the Highway instructions.
+        // First, one hwy vector at a time.
+        int64_t pos = 0;
+        for (; pos + N <= value_size; pos += N) {
+          auto vec = hn::Load(d8, value_ptr + pos);
+          for (int k = 0; k < result_ptrs.size(); ++k) {
+            auto vec2 = hn::Xor(vec, hn::Load(d8, result_ptrs[k] + pos));
+            hn::Store(vec2, d8, result_ptrs[k] + pos);
+          }
+        }
+        // Remaining bytes that are shorter than a full hwy vector.
+        if (pos < value_size) {
+          XorPartialString<0>(value_ptr, pos, value_size - pos, result_ptrs);
         }
-      }
-      // Remaining bytes that are shorter than a full hwy vector.
-      if (pos < value_size) {
-        XorPartialString<0>(value_ptr, pos, value_size - pos, result_ptrs);
       }
     }
   }
-
-  // Copy into unaligned strings and return.
-  std::vector<std::string> result(aligned_results.size());
-  for (int i = 0; i < aligned_results.size(); ++i) {
-    result[i] = std::string(reinterpret_cast<char*>(aligned_results[i].get()),
-                            max_value_size);
-  }
-  return result;
 }
 
 #endif  // HWY_TARGET == HWY_SCALAR
 
+void InnerProductIntoHwy(absl::Span<const absl::string_view> values,
+                         absl::Span<const BlockType> selections,
+                         int64_t max_value_size, InnerProductOutputs outputs) {
+  InnerProductIntoHwyImpl(values,
+                          ConcatenatedSelections(selections, outputs.size()),
+                          max_value_size, outputs);
+}
+
+void InnerProductOfVectorsIntoHwy(
+    absl::Span<const absl::string_view> values,
+    absl::Span<const std::vector<BlockType>> selections,
+    int64_t max_value_size, InnerProductOutputs outputs) {
+  InnerProductIntoHwyImpl(values, SeparateSelections(selections),
+                          max_value_size, outputs);
+}
+
 }  // namespace HWY_NAMESPACE
 }  // namespace distributed_point_functions::pir_internal
 HWY_AFTER_NAMESPACE();
@@ -276,8 +370,8 @@ absl::StatusOr<std::vector<std::string>> InnerProductNoHwy(
   std::vector<std::string> result(selections.size(),
                                   std::string(max_value_size, '\0'));
   const int64_t selection_vector_size = selections[0].size();
-  for (int i = 0; i < selection_vector_size; ++i) {
-    int base = i * kBitsPerBlock;
+  for (int64_t i = 0; i < selection_vector_size; ++i) {
+    const int64_t base = i * kBitsPerBlock;
     for (int j = 0; j < kBitsPerBlock; ++j) {
       if (base + j >= values.size()) {
         break;
@@ -297,7 +391,69 @@ absl::StatusOr<std::vector<std::string>> InnerProductNoHwy(
   return result;
 }
 
-HWY_EXPORT(InnerProductHwy);
+HWY_EXPORT(InnerProductIntoHwy);
+HWY_EXPORT(InnerProductOfVectorsIntoHwy);
+
+namespace {
+
+// Returns INVALID_ARGUMENT if `max_value_size` is not positive.
+absl::Status CheckMaxValueSize(int64_t max_value_size) {
+  if (max_value_size <= 0) {
+    absl::Status status =
+        absl::InvalidArgumentError("`max_value_size` must be positive");
+    CanonicalPirError payload;
+    payload.set_code(CanonicalPirError::MAX_VALUE_SIZE_IS_ZERO);
+    status.SetPayload(kPirInternalErrorUri,
+                      std::move(payload).SerializeAsCord());
+    return status;
+  }
+  return absl::OkStatus();
+}
+
+// Returns INVALID_ARGUMENT if any of `values` is larger than `max_value_size`.
+absl::Status CheckValueSizes(absl::Span<const absl::string_view> values,
+                             int64_t max_value_size) {
+  for (int64_t i = 0; i < values.size(); ++i) {
+    if (values[i].size() > max_value_size) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("`values[", i, "]` is larger than `max_value_size`"));
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Checks the arguments of `InnerProductInto` and `InnerProductIntoNoHwy`.
+absl::Status CheckInnerProductIntoArguments(
+    absl::Span<const absl::string_view> values,
+    absl::Span<const BlockType> selections, int64_t max_value_size,
+    InnerProductOutputs outputs) {
+  if (selections.size() % outputs.size() != 0) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "`selections.size()` must be a multiple of the number of outputs: ",
+        selections.size(), " is not a multiple of ", outputs.size()));
+  }
+  const int64_t selection_vector_size = selections.size() / outputs.size();
+  if (selection_vector_size * kBitsPerBlock < values.size()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "`selections` contains insufficient number of bits per output: ",
+        selection_vector_size * kBitsPerBlock, ", expected: ", values.size()));
+  }
+  DPF_RETURN_IF_ERROR(CheckMaxValueSize(max_value_size));
+  if (reinterpret_cast<uintptr_t>(outputs[0]) % kInnerProductOutputAlignment !=
+          0 ||
+      outputs.stride() % kInnerProductOutputAlignment != 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("`outputs` must be aligned to ",
+                     kInnerProductOutputAlignment, " bytes"));
+  }
+  if (outputs.size() > 1 && outputs.stride() < max_value_size) {
+    return absl::InvalidArgumentError(
+        "`outputs.stride()` must not be smaller than `max_value_size`");
+  }
+  return CheckValueSizes(values, max_value_size);
+}
+
+}  // namespace
 
 absl::StatusOr<std::vector<std::string>> InnerProduct(
     absl::Span<const absl::string_view> values,
@@ -308,7 +464,7 @@ absl::StatusOr<std::vector<std::string>> InnerProduct(
   if (selections.empty()) {
     return std::vector<std::string>();
   }
-  int first_selection_vector_size = selections[0].size();
+  const int64_t first_selection_vector_size = selections[0].size();
   for (int i = 0; i < selections.size(); ++i) {
     if ((selections[i].size() * kBitsPerBlock) < values.size()) {
       return absl::InvalidArgumentError(absl::StrCat(
@@ -321,24 +477,102 @@ absl::StatusOr<std::vector<std::string>> InnerProduct(
           "].size()` does not match `selections[0].size()`: actual",
           selections[i].size(), ", expected ", first_selection_vector_size));
     }
-    if (max_value_size <= 0) {
-      absl::Status status =
-          absl::InvalidArgumentError("`max_value_size` must be positive");
-      CanonicalPirError payload;
-      payload.set_code(CanonicalPirError::MAX_VALUE_SIZE_IS_ZERO);
-      status.SetPayload(kPirInternalErrorUri,
-                        std::move(payload).SerializeAsCord());
-      return status;
-    }
+    DPF_RETURN_IF_ERROR(CheckMaxValueSize(max_value_size));
+  }
+  DPF_RETURN_IF_ERROR(CheckValueSizes(values, max_value_size));
+
+  // Compute the inner products into aligned buffers, reading the selection
+  // vectors in place.
+  const int64_t stride = AlignInnerProductOutputSize(max_value_size);
+  hwy::AlignedFreeUniquePtr<char[]> aligned_results =
+      hwy::AllocateAligned<char>(selections.size() * stride);
+  if (aligned_results == nullptr) {
+    return absl::ResourceExhaustedError("memory allocation error");
+  }
+  InnerProductOutputs outputs(aligned_results.get(), selections.size(), stride);
+  HWY_DYNAMIC_DISPATCH(InnerProductOfVectorsIntoHwy)(values, selections,
+                                                     max_value_size, outputs);
+
+  // Copy into unaligned strings and return.
+  std::vector<std::string> result(selections.size());
+  for (int i = 0; i < selections.size(); ++i) {
+    result[i] = std::string(outputs[i], max_value_size);
   }
-  for (int i = 0; i < values.size(); ++i) {
+  return result;
+}
+
+absl::Status InnerProductInto(absl::Span<const absl::string_view> values,
+                              absl::Span<const BlockType> selections,
+                              int64_t max_value_size,
+                              InnerProductOutputs outputs) {
+  if (outputs.size() == 0) {
+    return absl::OkStatus();
+  }
+  DPF_RETURN_IF_ERROR(CheckInnerProductIntoArguments(values, selections,
+                                                     max_value_size, outputs));
+  HWY_DYNAMIC_DISPATCH(InnerProductIntoHwy)(values, selections,
+                                            max_value_size, outputs);
+  return absl::OkStatus();
+}
+
+absl::Status InnerProductIntoNoHwy(absl::Span<const absl::string_view> values,
+                                   absl::Span<const BlockType> selections,
+                                   int64_t max_value_size,
+                                   InnerProductOutputs outputs) {
+  if (outputs.size() == 0) {
+    return absl::OkStatus();
+  }
+  DPF_RETURN_IF_ERROR(CheckInnerProductIntoArguments(values, selections,
+                                                     max_value_size, outputs));
+  InnerProductIntoNoHwyUnchecked(
+      values, ConcatenatedSelections(selections, outputs.size()),
+      max_value_size, outputs);
+  return absl::OkStatus();
+}
+
+absl::Status InnerProductChunked(
+    absl::Span<const absl::string_view> values,
+    absl::Span<const std::vector<BlockType>> selections,
+    int64_t max_value_size, int64_t chunk_size, InnerProductChunkSink sink) {
+  if (chunk_size <= 0) {
+    return absl::InvalidArgumentError("`chunk_size` must be positive");
+  }
+  if (selections.empty()) {
+    return absl::OkStatus();
+  }
+  for (int64_t i = 0; i < values.size(); ++i) {
     if (values[i].size() > max_value_size) {
       return absl::InvalidArgumentError(
           absl::StrCat("`values[", i, "]` is larger than `max_value_size`"));
     }
   }
-  return HWY_DYNAMIC_DISPATCH(InnerProductHwy)(values, selections,
-                                               max_value_size);
+  chunk_size = (chunk_size + kInnerProductChunkAlignment - 1) /
+               kInnerProductChunkAlignment * kInnerProductChunkAlignment;
+
+  // The first iteration always runs, so that InnerProduct checks the remaining
+  // arguments even if `max_value_size` is not positive.
+  std::vector<absl::string_view> chunk_values(values.size());
+  int64_t offset = 0;
+  do {
+    const int64_t current_chunk_size =
+        std::min(chunk_size, max_value_size - offset);
+    for (int64_t i = 0; i < values.size(); ++i) {
+      chunk_values[i] = values[i].size() > offset
+                            ? values[i].substr(offset, current_chunk_size)
+                            : absl::string_view();
+    }
+    absl::StatusOr<std::vector<std::string>> chunks =
+        InnerProduct(chunk_values, selections, current_chunk_size);
+    if (!chunks.ok()) {
+      return chunks.status();
+    }
+    absl::Status status = sink(offset, *std::move(chunks));
+    if (!status.ok()) {
+      return status;
+    }
+    offset += chunk_size;
+  } while (offset < max_value_size);
+  return absl::OkStatus();
 }
 
 }  // namespace pir_internal
@@ -22,11 +22,14 @@
 #include <string>
 #include <vector>
 
+#include "absl/functional/function_ref.h"
 #include "absl/numeric/int128.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
 #include "dpf/xor_wrapper.h"
+#include "pir/pir_database_interface.h"
 
 namespace distributed_point_functions {
 namespace pir_internal {
@@ -46,6 +49,48 @@ absl::StatusOr<std::vector<std::string>> InnerProductNoHwy(
     absl::Span<const std::vector<BlockType>> selections,
     int64_t max_value_size);
 
+// As `InnerProduct`, but reads `outputs.size()` selection vectors stored back
+// to back in `selections`, and writes the inner product with the k-th one to
+// the first `max_value_size` bytes of `outputs[k]`. Does not allocate.
+//
+// Returns INVALID_ARGUMENT under the same conditions as `InnerProduct`, if
+// `selections` cannot be split into `outputs.size()` vectors of equal size, or
+// if `outputs` are not aligned or too small.
+absl::Status InnerProductInto(absl::Span<const absl::string_view> values,
+                              absl::Span<const BlockType> selections,
+                              int64_t max_value_size,
+                              InnerProductOutputs outputs);
+
+// As `InnerProductInto`, but does not provide explicit SIMD implementation.
+absl::Status InnerProductIntoNoHwy(absl::Span<const absl::string_view> values,
+                                   absl::Span<const BlockType> selections,
+                                   int64_t max_value_size,
+                                   InnerProductOutputs outputs);
+
+// Function type for receiving chunks from `InnerProductChunked`. `offset` is
+// the byte offset of the chunk within each inner product, and `chunks[k]`
+// holds the bytes of the inner product with `selections[k]` starting at
+// `offset`.
+using InnerProductChunkSink = absl::FunctionRef<absl::Status(
+    int64_t offset, std::vector<std::string> chunks)>;
+
+// As `InnerProduct`, but processes `values` in byte ranges of `chunk_size`
+// bytes, and passes each completed chunk of all inner products to `sink` before
+// computing the next one. This bounds the memory used for intermediate results
+// to `chunk_size` bytes per selection vector. `chunk_size` is rounded up to a
+// multiple of `kInnerProductChunkAlignment`, so that chunks of aligned values
+// remain aligned.
+//
+// Returns INVALID_ARGUMENT if `chunk_size` is not positive, or under the same
+// conditions as `InnerProduct`. Returns the first error returned by `sink`.
+absl::Status InnerProductChunked(
+    absl::Span<const absl::string_view> values,
+    absl::Span<const std::vector<BlockType>> selections,
+    int64_t max_value_size, int64_t chunk_size, InnerProductChunkSink sink);
+
+// Chunk boundaries used by `InnerProductChunked` are multiples of this value.
+inline constexpr int64_t kInnerProductChunkAlignment = 64;
+
 }  // namespace pir_internal
 }  // namespace distributed_point_functions
 
@@ -14,12 +14,15 @@
 
 #include "pir/internal/inner_product_hwy.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/numeric/int128.h"
+#include "absl/random/distributions.h"
 #include "absl/random/random.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -29,6 +32,7 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "hwy/aligned_allocator.h"
+#include "pir/pir_database_interface.h"
 
 // clang-format off
 #define HWY_IS_TEST 1
@@ -336,6 +340,143 @@ class TestInnerProduct {
     ASSERT_EQ(result[0], target);
   }
 
+  // Tests that `InnerProductChunked` emits chunks that concatenate to the
+  // result of `InnerProduct`, for both aligned and unaligned values.
+  void InnerProductChunkedMatchesInnerProduct() {
+    std::vector<bool> selections1(this->value_sizes_.size(), true);
+    std::vector<bool> selections2(this->value_sizes_.size(), false);
+    for (int i = 0; i < selections2.size(); i += 3) {
+      selections2[i] = true;
+    }
+    const std::vector<std::vector<BlockType>> packed_selections = {
+        this->PackSelectionBits(selections1),
+        this->PackSelectionBits(selections2)};
+    for (const auto* values : {&this->aligned_values_,
+                               &this->unaligned_values_}) {
+      DPF_ASSERT_OK_AND_ASSIGN(
+          std::vector<std::string> expected,
+          InnerProduct(*values, packed_selections, kMaxValueSize));
+      for (int chunk_size : {1, 64, 100, kMaxValueSize, 2 * kMaxValueSize}) {
+        std::vector<std::string> result(packed_selections.size());
+        int64_t expected_offset = 0;
+        DPF_ASSERT_OK(InnerProductChunked(
+            *values, packed_selections, kMaxValueSize, chunk_size,
+            [&](int64_t offset, std::vector<std::string> chunks) {
+              EXPECT_EQ(offset, expected_offset);
+              EXPECT_EQ(offset % kInnerProductChunkAlignment, 0);
+              EXPECT_EQ(chunks.size(), result.size());
+              for (int k = 0; k < chunks.size(); ++k) {
+                result[k] += chunks[k];
+              }
+              expected_offset += chunks[0].size();
+              return absl::OkStatus();
+            }));
+        EXPECT_EQ(result, expected);
+      }
+    }
+  }
+
+  void InnerProductChunkedFailsWithNonPositiveChunkSize() {
+    std::vector<bool> selections(this->aligned_values_.size(), true);
+    EXPECT_THAT(InnerProductChunked(
+                    this->aligned_values_, {PackSelectionBits(selections)},
+                    kMaxValueSize, 0,
+                    [](int64_t, std::vector<std::string>) {
+                      return absl::OkStatus();
+                    }),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("`chunk_size` must be positive")));
+  }
+
+  void InnerProductChunkedStopsOnSinkError() {
+    std::vector<bool> selections(this->aligned_values_.size(), true);
+    int num_calls = 0;
+    EXPECT_THAT(InnerProductChunked(
+                    this->aligned_values_, {PackSelectionBits(selections)},
+                    kMaxValueSize, 1,
+                    [&num_calls](int64_t, std::vector<std::string>) {
+                      ++num_calls;
+                      return absl::CancelledError("stop");
+                    }),
+                StatusIs(absl::StatusCode::kCancelled));
+    EXPECT_EQ(num_calls, 1);
+  }
+
+  // Tests that `InnerProductInto` and `InnerProductIntoNoHwy` write the same
+  // results as `InnerProduct` into the outputs, for more selection vectors than
+  // are processed in a single pass.
+  void InnerProductIntoMatchesInnerProduct() {
+    constexpr int kNumSelections = 70;
+    absl::BitGen bitgen;
+    std::vector<std::vector<BlockType>> packed_selections;
+    std::vector<BlockType> selection_matrix;
+    for (int k = 0; k < kNumSelections; ++k) {
+      std::vector<bool> selections(this->value_sizes_.size());
+      for (int i = 0; i < selections.size(); ++i) {
+        selections[i] = absl::Bernoulli(bitgen, 0.5);
+      }
+      packed_selections.push_back(this->PackSelectionBits(selections));
+      selection_matrix.insert(selection_matrix.end(),
+                              packed_selections.back().begin(),
+                              packed_selections.back().end());
+    }
+    const int64_t stride = AlignInnerProductOutputSize(kMaxValueSize + 1);
+    auto buffer = hwy::AllocateAligned<char>(kNumSelections * stride);
+    InnerProductOutputs outputs(buffer.get(), kNumSelections, stride);
+    for (const auto* values :
+         {&this->aligned_values_, &this->unaligned_values_}) {
+      DPF_ASSERT_OK_AND_ASSIGN(
+          std::vector<std::string> expected,
+          InnerProduct(*values, packed_selections, kMaxValueSize));
+      for (auto inner_product_into : {&InnerProductInto,
+                                      &InnerProductIntoNoHwy}) {
+        // Outputs must be overwritten, not accumulated into.
+        std::fill_n(buffer.get(), kNumSelections * stride, '\xff');
+        DPF_ASSERT_OK(inner_product_into(*values, selection_matrix,
+                                         kMaxValueSize, outputs));
+        for (int k = 0; k < kNumSelections; ++k) {
+          EXPECT_EQ(absl::string_view(outputs[k], kMaxValueSize),
+                    expected[k]);
+          // Padding after each output is left untouched.
+          EXPECT_EQ(outputs[k][kMaxValueSize], '\xff');
+        }
+      }
+    }
+  }
+
+  void InnerProductIntoFailsWithInvalidArguments() {
+    std::vector<bool> selections(this->aligned_values_.size(), true);
+    std::vector<BlockType> packed_selections = PackSelectionBits(selections);
+    const int64_t stride = AlignInnerProductOutputSize(kMaxValueSize);
+    auto buffer = hwy::AllocateAligned<char>(3 * stride);
+    EXPECT_THAT(
+        InnerProductInto(this->aligned_values_, packed_selections,
+                         kMaxValueSize,
+                         InnerProductOutputs(buffer.get(), 2, stride)),
+        StatusIs(absl::StatusCode::kInvalidArgument,
+                 HasSubstr("must be a multiple of the number of outputs")));
+    EXPECT_THAT(
+        InnerProductInto(this->aligned_values_, packed_selections,
+                         kMaxValueSize,
+                         InnerProductOutputs(buffer.get() + 1, 1, stride)),
+        StatusIs(absl::StatusCode::kInvalidArgument,
+                 HasSubstr("must be aligned")));
+    std::vector<BlockType> selection_matrix = packed_selections;
+    selection_matrix.insert(selection_matrix.end(), packed_selections.begin(),
+                            packed_selections.end());
+    EXPECT_THAT(
+        InnerProductInto(this->aligned_values_, selection_matrix,
+                         kMaxValueSize,
+                         InnerProductOutputs(buffer.get(), 2, stride / 2)),
+        StatusIs(absl::StatusCode::kInvalidArgument,
+                 HasSubstr("must not be smaller than `max_value_size`")));
+    EXPECT_THAT(
+        InnerProductInto(this->aligned_values_, packed_selections, 0,
+                         InnerProductOutputs(buffer.get(), 1, stride)),
+        StatusIs(absl::StatusCode::kInvalidArgument,
+                 HasSubstr("`max_value_size` must be positive")));
+  }
+
  protected:
   // Returns the number of blocks needed to pack `n` bits.
   static int NumberOfBlocksFor(int n) {
@@ -413,6 +554,11 @@ void TestAll() {
   test.InnerProductOfUnalignedValuesAndLongSelectionVector();
   test.InnerProductOfAllAlignedValues();
   test.InnerProductOfAllUnalignedValues();
+  test.InnerProductChunkedMatchesInnerProduct();
+  test.InnerProductChunkedFailsWithNonPositiveChunkSize();
+  test.InnerProductChunkedStopsOnSinkError();
+  test.InnerProductIntoMatchesInnerProduct();
+  test.InnerProductIntoFailsWithInvalidArguments();
 }
 
 }  // namespace HWY_NAMESPACE
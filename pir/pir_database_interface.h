@@ -19,14 +19,59 @@
 
 #include <stddef.h>
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/types/span.h"
 
 namespace distributed_point_functions {
 
+// Alignment in bytes of the outputs of
+// `PirDatabaseInterface::InnerProductWithInto`. Matches the largest SIMD
+// vector size, so that the inner products can be computed with aligned loads
+// and stores.
+inline constexpr int64_t kInnerProductOutputAlignment = 64;
+
+// Returns `size` rounded up to a multiple of `kInnerProductOutputAlignment`.
+inline constexpr int64_t AlignInnerProductOutputSize(int64_t size) {
+  return (size + kInnerProductOutputAlignment - 1) /
+         kInnerProductOutputAlignment * kInnerProductOutputAlignment;
+}
+
+// Caller-provided output buffers for
+// `PirDatabaseInterface::InnerProductWithInto`. Does not own the memory. Holds
+// `size()` outputs, where output `k` starts at `data + k * stride`. Both `data`
+// and `stride` must be multiples of `kInnerProductOutputAlignment`.
+class InnerProductOutputs {
+ public:
+  InnerProductOutputs(char* data, int64_t size, int64_t stride)
+      : data_(data), size_(size), stride_(stride) {}
+
+  // Returns the number of outputs.
+  int64_t size() const { return size_; }
+
+  // Returns the distance in bytes between consecutive outputs.
+  int64_t stride() const { return stride_; }
+
+  // Returns the start of the k-th output.
+  char* operator[](int64_t k) const { return data_ + k * stride_; }
+
+  // Returns the outputs starting `offset` bytes into each of these outputs.
+  // `offset` must be a multiple of `kInnerProductOutputAlignment`.
+  InnerProductOutputs WithOffset(int64_t offset) const {
+    return InnerProductOutputs(data_ + offset, size_, stride_);
+  }
+
+ private:
+  char* data_;
+  int64_t size_;
+  int64_t stride_;
+};
+
 // This class defines the basic database interfaces used by a PIR server.
 template <typename BlockTypeT, typename RecordTypeT,
           typename ResponseTypeT = RecordTypeT>
@@ -61,6 +106,13 @@ class PirDatabaseInterface {
     virtual absl::StatusOr<std::unique_ptr<PirDatabaseInterface>> Build() = 0;
   };
 
+  // Function type for receiving chunks from `InnerProductWithChunked`.
+  // `offset` is the position of the chunk within each response,
+  // `response_size` is the size of each complete response, and `chunks[k]`
+  // holds the part of the response to `selections[k]` starting at `offset`.
+  using ChunkSink = absl::FunctionRef<absl::Status(
+      int64_t offset, int64_t response_size, std::vector<ResponseType> chunks)>;
+
   virtual ~PirDatabaseInterface() {}
 
   // Returns the inner product between the database records and a bit-vector.
@@ -70,6 +122,56 @@ class PirDatabaseInterface {
   virtual absl::StatusOr<std::vector<ResponseType>> InnerProductWith(
       absl::Span<const std::vector<BlockType>> selections) const = 0;
 
+  // As `InnerProductWith`, but computes the responses in chunks of about
+  // `chunk_size` bytes, and passes each completed chunk to `sink` in order of
+  // increasing offset before computing the next one. Databases supporting this
+  // only need to hold one chunk per selection vector in memory at a time. The
+  // default implementation returns UNIMPLEMENTED, in which case callers should
+  // fall back to `InnerProductWith`.
+  virtual absl::Status InnerProductWithChunked(
+      absl::Span<const std::vector<BlockType>> /*selections*/,
+      int64_t /*chunk_size*/, ChunkSink /*sink*/) const {
+    return absl::UnimplementedError(
+        "InnerProductWithChunked is not supported by this database");
+  }
+
+  // Returns the sizes in bytes of the parts of each response written by
+  // `InnerProductWithInto`, e.g., one part holding the record for dense
+  // databases. Parts are laid out back to back, each starting at a multiple of
+  // `kInnerProductOutputAlignment`. The default implementation returns an empty
+  // span, signalling that `InnerProductWithInto` is not supported.
+  virtual absl::Span<const int64_t> response_part_sizes() const { return {}; }
+
+  // As `InnerProductWith`, but reads the selection vectors from a single
+  // contiguous matrix and writes the responses into caller-provided buffers,
+  // so that it does not allocate. `selections` holds `outputs.size()`
+  // selection vectors of equal size back to back, and the response to the k-th
+  // one is written to `outputs[k]`, laid out as given by
+  // `response_part_sizes()`. The stride of `outputs` must be at least the sum
+  // of the aligned part sizes. The default implementation returns
+  // UNIMPLEMENTED, in which case callers should fall back to
+  // `InnerProductWith`.
+  virtual absl::Status InnerProductWithInto(
+      absl::Span<const BlockType> /*selections*/,
+      InnerProductOutputs /*outputs*/) const {
+    return absl::UnimplementedError(
+        "InnerProductWithInto is not supported by this database");
+  }
+
+  // As `InnerProductWith`, but only computes the inner products over the given
+  // `columns` of a database that stores its records column by column, so that
+  // the cost is proportional to the size of these columns. Returns
+  // `columns.size()` responses per selection vector, where the response for
+  // `selections[k]` and `columns[j]` is at index `k * columns.size() + j`. The
+  // default implementation returns UNIMPLEMENTED, as most databases do not
+  // store their records in columns.
+  virtual absl::StatusOr<std::vector<ResponseType>> InnerProductWithColumns(
+      absl::Span<const std::vector<BlockType>> /*selections*/,
+      absl::Span<const int> /*columns*/) const {
+    return absl::UnimplementedError(
+        "InnerProductWithColumns is not supported by this database");
+  }
+
   // Returns the number of elements contained in the database.
   virtual size_t size() const = 0;
 
@@ -100,4 +100,29 @@ std::string Aes128CtrSeededPrng::GetRandomBytes(size_t length) {
   return output;
 }
 
+void Aes128CtrSeededPrng::Skip(size_t length) {
+  // First use up the rest of the current keystream block.
+  if (num_ != 0) {
+    const size_t remaining_in_block =
+        std::min<size_t>(length, AES_BLOCK_SIZE - num_);
+    num_ = (num_ + remaining_in_block) % AES_BLOCK_SIZE;
+    length -= remaining_in_block;
+  }
+  if (length == 0) {
+    return;
+  }
+
+  // Now `num_` is zero, so `ivec_` holds the counter of the next block. Skip
+  // whole blocks by adding to the big-endian counter directly.
+  uint64_t carry = length / AES_BLOCK_SIZE;
+  for (int i = AES_BLOCK_SIZE - 1; i >= 0 && carry != 0; --i) {
+    carry += ivec_[i];
+    ivec_[i] = static_cast<uint8_t>(carry & 0xff);
+    carry >>= 8;
+  }
+
+  // Generate the remaining partial block normally.
+  GetRandomBytes(length % AES_BLOCK_SIZE);
+}
+
 }  // namespace distributed_point_functions
@@ -84,6 +84,12 @@ class Aes128CtrSeededPrng {
   //
   std::string GetRandomBytes(size_t length);
 
+  // Advances the PRNG by `length` bytes, with the same effect on subsequent
+  // outputs as calling GetRandomBytes(length) and discarding the result. Runs
+  // in constant time for whole AES blocks, so it can be used to seek to
+  // arbitrary positions of the output stream.
+  void Skip(size_t length);
+
  private:
   // Called by `Create` and `CreateWithNonce`.
   Aes128CtrSeededPrng(AES_KEY aes_key, std::vector<uint8_t> ivec,
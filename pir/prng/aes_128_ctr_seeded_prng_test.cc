@@ -90,6 +90,24 @@ TEST_F(SeededPrngTest, MultipleCallsGiveSameSequenceOfBytes) {
   EXPECT_EQ(absl::StrCat(output1a, output1b), output2);
 }
 
+TEST_F(SeededPrngTest, SkipIsEquivalentToDiscardingBytes) {
+  const std::string expected = prng_->GetRandomBytes(1000);
+  // Cover partial blocks before and after the skipped range, as well as
+  // skipping within a single block.
+  for (size_t start : {0, 5, 16, 31}) {
+    for (size_t skip : {0, 3, 11, 16, 100, 517}) {
+      DPF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Aes128CtrSeededPrng> prng,
+                               Aes128CtrSeededPrng::Create(seed_));
+      std::string output = prng->GetRandomBytes(start);
+      prng->Skip(skip);
+      absl::StrAppend(&output, prng->GetRandomBytes(100));
+      EXPECT_EQ(output, absl::StrCat(expected.substr(0, start),
+                                     expected.substr(start + skip, 100)))
+          << "start=" << start << ", skip=" << skip;
+    }
+  }
+}
+
 TEST_F(SeededPrngTest, DifferentSeedsGiveDifferentOutputs) {
   DPF_ASSERT_OK_AND_ASSIGN(std::string seed2,
                            Aes128CtrSeededPrng::GenerateSeed());
@@ -0,0 +1,260 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/record_compression.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "pir/private_information_retrieval.pb.h"
+#include "zlib.h"
+
+namespace distributed_point_functions {
+
+namespace {
+
+// Negative window bits select raw DEFLATE without zlib header and checksum,
+// which would only add 6 bytes to every record.
+constexpr int kWindowBits = -15;
+constexpr int kMemLevel = 8;
+constexpr int kDecompressionChunkSize = 4096;
+
+// Length of the substrings counted by TrainCompressionDictionary. Shorter
+// matches are rarely worth a back reference.
+constexpr int kDictionaryGramSize = 8;
+// Length of the sample segments TrainCompressionDictionary selects from.
+constexpr int kDictionarySegmentSize = 64;
+
+// Returns the part of `dictionary` that fits into the DEFLATE window.
+absl::string_view EffectiveDictionary(absl::string_view dictionary) {
+  if (dictionary.size() > kMaxCompressionDictionarySize) {
+    dictionary.remove_prefix(dictionary.size() - kMaxCompressionDictionarySize);
+  }
+  return dictionary;
+}
+
+Bytef* ToBytef(const char* data) {
+  return reinterpret_cast<Bytef*>(const_cast<char*>(data));
+}
+
+}  // namespace
+
+RecordCompressor::RecordCompressor(RecordCompressionParams params)
+    : params_(std::move(params)),
+      max_record_size_(params_.max_record_size() > 0
+                           ? params_.max_record_size()
+                           : kDefaultMaxRecordSize) {}
+
+absl::StatusOr<std::unique_ptr<RecordCompressor>> RecordCompressor::Create(
+    const RecordCompressionParams& params) {
+  if (params.codec() != RecordCompressionParams::CODEC_DEFLATE) {
+    return absl::InvalidArgumentError("Unsupported compression `codec`");
+  }
+  if (params.level() < 0 || params.level() > 9) {
+    return absl::InvalidArgumentError("`level` must be between 0 and 9");
+  }
+  if (params.size_bucket_bytes() < 0) {
+    return absl::InvalidArgumentError(
+        "`size_bucket_bytes` must not be negative");
+  }
+  if (params.max_record_size() < 0) {
+    return absl::InvalidArgumentError(
+        "`max_record_size` must not be negative");
+  }
+  return absl::WrapUnique(new RecordCompressor(params));
+}
+
+absl::StatusOr<std::string> RecordCompressor::Compress(
+    absl::string_view record) const {
+  if (static_cast<int64_t>(record.size()) > max_record_size_) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Record size (=", record.size(),
+                     ") exceeds `max_record_size` (=", max_record_size_, ")"));
+  }
+  z_stream stream = {};
+  const int level =
+      params_.level() == 0 ? Z_DEFAULT_COMPRESSION : params_.level();
+  if (deflateInit2(&stream, level, Z_DEFLATED, kWindowBits, kMemLevel,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return absl::InternalError("Initializing compression failed");
+  }
+  absl::string_view dictionary = EffectiveDictionary(params_.dictionary());
+  if (!dictionary.empty() &&
+      deflateSetDictionary(&stream, ToBytef(dictionary.data()),
+                           dictionary.size()) != Z_OK) {
+    deflateEnd(&stream);
+    return absl::InternalError("Setting compression dictionary failed");
+  }
+
+  std::string result(deflateBound(&stream, record.size()), '\0');
+  stream.next_in = ToBytef(record.data());
+  stream.avail_in = record.size();
+  stream.next_out = ToBytef(result.data());
+  stream.avail_out = result.size();
+  const int status = deflate(&stream, Z_FINISH);
+  result.resize(stream.total_out);
+  deflateEnd(&stream);
+  if (status != Z_STREAM_END) {
+    return absl::InternalError("Compressing record failed");
+  }
+
+  const int64_t bucket = params_.size_bucket_bytes();
+  if (bucket > 1) {
+    result.resize((result.size() + bucket - 1) / bucket * bucket, '\0');
+  }
+  return result;
+}
+
+absl::StatusOr<std::string> RecordCompressor::Decompress(
+    absl::string_view compressed) const {
+  z_stream stream = {};
+  if (inflateInit2(&stream, kWindowBits) != Z_OK) {
+    return absl::InternalError("Initializing decompression failed");
+  }
+  absl::string_view dictionary = EffectiveDictionary(params_.dictionary());
+  if (!dictionary.empty() &&
+      inflateSetDictionary(&stream, ToBytef(dictionary.data()),
+                           dictionary.size()) != Z_OK) {
+    inflateEnd(&stream);
+    return absl::InternalError("Setting compression dictionary failed");
+  }
+
+  std::string result;
+  stream.next_in = ToBytef(compressed.data());
+  stream.avail_in = compressed.size();
+  int status = Z_OK;
+  while (status == Z_OK) {
+    // Output is limited to one byte more than `max_record_size_`, which is
+    // enough to detect records exceeding it.
+    if (static_cast<int64_t>(result.size()) > max_record_size_) {
+      inflateEnd(&stream);
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Decompressed record exceeds `max_record_size` (=", max_record_size_,
+          ")"));
+    }
+    const size_t old_size = result.size();
+    const size_t chunk_size = std::min<int64_t>(
+        kDecompressionChunkSize, max_record_size_ + 1 - old_size);
+    result.resize(old_size + chunk_size);
+    stream.next_out = ToBytef(result.data() + old_size);
+    stream.avail_out = chunk_size;
+    status = inflate(&stream, Z_NO_FLUSH);
+    result.resize(stream.total_out);
+    if (status == Z_OK && stream.avail_in == 0 && stream.avail_out > 0) {
+      // All input consumed without reaching the end of the stream.
+      status = Z_DATA_ERROR;
+    }
+  }
+  inflateEnd(&stream);
+  if (status == Z_STREAM_END &&
+      static_cast<int64_t>(result.size()) > max_record_size_) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Decompressed record exceeds `max_record_size` (=", max_record_size_,
+        ")"));
+  }
+  if (status != Z_STREAM_END) {
+    return absl::InvalidArgumentError("Compressed record is corrupted");
+  }
+  return result;
+}
+
+std::string TrainCompressionDictionary(absl::Span<const std::string> samples,
+                                       int max_size) {
+  max_size = std::clamp(max_size, 0, kMaxCompressionDictionarySize);
+
+  // Count the number of samples containing each substring.
+  absl::flat_hash_map<absl::string_view, int> frequencies;
+  for (const std::string& sample : samples) {
+    absl::flat_hash_set<absl::string_view> seen;
+    for (size_t i = 0; i + kDictionaryGramSize <= sample.size(); ++i) {
+      absl::string_view gram(sample.data() + i, kDictionaryGramSize);
+      if (seen.insert(gram).second) {
+        ++frequencies[gram];
+      }
+    }
+  }
+
+  // Scores a segment by the number of other samples sharing each of its
+  // substrings, skipping substrings in `covered`.
+  auto score = [&frequencies](absl::string_view segment,
+                              const absl::flat_hash_set<absl::string_view>&
+                                  covered) {
+    int64_t result = 0;
+    for (size_t i = 0; i + kDictionaryGramSize <= segment.size(); ++i) {
+      absl::string_view gram(segment.data() + i, kDictionaryGramSize);
+      if (!covered.contains(gram)) {
+        result += frequencies[gram] - 1;
+      }
+    }
+    return result;
+  };
+  std::vector<std::pair<int64_t, absl::string_view>> segments;
+  const absl::flat_hash_set<absl::string_view> none;
+  for (const std::string& sample : samples) {
+    for (size_t i = 0; i < sample.size(); i += kDictionarySegmentSize) {
+      absl::string_view segment =
+          absl::string_view(sample).substr(i, kDictionarySegmentSize);
+      int64_t segment_score = score(segment, none);
+      if (segment_score > 0) {
+        segments.emplace_back(segment_score, segment);
+      }
+    }
+  }
+  std::stable_sort(
+      segments.begin(), segments.end(),
+      [](const auto& a, const auto& b) { return a.first > b.first; });
+
+  // Greedily select the best segments, skipping segments that mostly repeat
+  // substrings of segments selected before.
+  absl::flat_hash_set<absl::string_view> covered;
+  std::vector<absl::string_view> selected;
+  int64_t total_size = 0;
+  for (const auto& [segment_score, segment] : segments) {
+    if (total_size >= max_size) {
+      break;
+    }
+    if (2 * score(segment, covered) < segment_score) {
+      continue;
+    }
+    for (size_t i = 0; i + kDictionaryGramSize <= segment.size(); ++i) {
+      covered.insert(segment.substr(i, kDictionaryGramSize));
+    }
+    selected.push_back(segment);
+    total_size += segment.size();
+  }
+
+  std::string dictionary;
+  dictionary.reserve(total_size);
+  for (auto it = selected.rbegin(); it != selected.rend(); ++it) {
+    dictionary.append(it->data(), it->size());
+  }
+  if (dictionary.size() > static_cast<size_t>(max_size)) {
+    dictionary.erase(0, dictionary.size() - max_size);
+  }
+  return dictionary;
+}
+
+}  // namespace distributed_point_functions
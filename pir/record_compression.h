@@ -0,0 +1,87 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_RECORD_COMPRESSION_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_RECORD_COMPRESSION_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+
+// Maximum size of a DEFLATE preset dictionary. Larger dictionaries are
+// truncated to their last `kMaxCompressionDictionarySize` bytes.
+inline constexpr int kMaxCompressionDictionarySize = 32 * 1024;
+
+// Maximum size of an uncompressed record if
+// `RecordCompressionParams.max_record_size` is unset.
+inline constexpr int64_t kDefaultMaxRecordSize = 16 * 1024 * 1024;
+
+// Compresses and decompresses PIR database records as specified by a
+// RecordCompressionParams proto. Database builders compress each record before
+// storing it, and clients decompress the unmasked records. Compressed records
+// are self-delimiting, so any null bytes appended after them, e.g., by padding
+// to the largest record in the database, are ignored on decompression.
+//
+// Thread-safe.
+class RecordCompressor {
+ public:
+  // Creates a RecordCompressor for the given `params`.
+  //
+  // Returns INVALID_ARGUMENT if `params` are invalid.
+  static absl::StatusOr<std::unique_ptr<RecordCompressor>> Create(
+      const RecordCompressionParams& params);
+
+  // Returns `record` compressed and padded to a multiple of
+  // `params.size_bucket_bytes`.
+  //
+  // Returns INVALID_ARGUMENT if `record` is larger than
+  // `params.max_record_size`.
+  absl::StatusOr<std::string> Compress(absl::string_view record) const;
+
+  // Decompresses a record returned by `Compress`, possibly followed by
+  // arbitrary bytes.
+  //
+  // Returns INVALID_ARGUMENT if `compressed` does not start with a valid
+  // compressed record, or if the record would be larger than
+  // `params.max_record_size`.
+  absl::StatusOr<std::string> Decompress(absl::string_view compressed) const;
+
+ private:
+  explicit RecordCompressor(RecordCompressionParams params);
+
+  RecordCompressionParams params_;
+  int64_t max_record_size_;
+};
+
+// Computes a preset dictionary of at most `max_size` bytes from `samples`,
+// a representative subset of the records to be compressed. The dictionary
+// consists of the segments of the samples that share the most substrings with
+// other samples, with the most common segments at the end, where DEFLATE can
+// reference them with the shortest distances.
+std::string TrainCompressionDictionary(
+    absl::Span<const std::string> samples,
+    int max_size = kMaxCompressionDictionarySize);
+
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_RECORD_COMPRESSION_H_
@@ -0,0 +1,219 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pir/record_compression.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+namespace {
+
+using dpf_internal::IsOkAndHolds;
+using dpf_internal::StatusIs;
+using ::testing::Le;
+using ::testing::Lt;
+using ::testing::Not;
+using ::testing::SizeIs;
+
+// Returns JSON records sharing most of their structure.
+std::vector<std::string> GenerateJsonRecords(int num_records) {
+  std::vector<std::string> records(num_records);
+  for (int i = 0; i < num_records; ++i) {
+    records[i] = absl::StrCat(
+        R"({"id": )", i, R"(, "name": "user)", i * 7919 % 1000,
+        R"(", "email": "user)", i, R"(@example.com", "active": )",
+        i % 2 == 0 ? "true" : "false",
+        R"(, "roles": ["reader", "writer"], "country": "CH"})");
+  }
+  return records;
+}
+
+RecordCompressionParams DeflateParams(std::string dictionary = "") {
+  RecordCompressionParams params;
+  params.set_codec(RecordCompressionParams::CODEC_DEFLATE);
+  params.set_dictionary(std::move(dictionary));
+  return params;
+}
+
+TEST(RecordCompressorTest, CreateFailsIfCodecIsUnspecified) {
+  EXPECT_THAT(RecordCompressor::Create(RecordCompressionParams()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Unsupported compression `codec`"));
+}
+
+TEST(RecordCompressorTest, CreateFailsIfLevelIsInvalid) {
+  RecordCompressionParams params = DeflateParams();
+  params.set_level(10);
+  EXPECT_THAT(RecordCompressor::Create(params),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`level` must be between 0 and 9"));
+}
+
+TEST(RecordCompressorTest, CreateFailsIfSizeBucketIsNegative) {
+  RecordCompressionParams params = DeflateParams();
+  params.set_size_bucket_bytes(-1);
+  EXPECT_THAT(RecordCompressor::Create(params),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`size_bucket_bytes` must not be negative"));
+}
+
+TEST(RecordCompressorTest, CreateFailsIfMaxRecordSizeIsNegative) {
+  RecordCompressionParams params = DeflateParams();
+  params.set_max_record_size(-1);
+  EXPECT_THAT(RecordCompressor::Create(params),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "`max_record_size` must not be negative"));
+}
+
+TEST(RecordCompressorTest, RoundTripsRecords) {
+  std::vector<std::string> records = GenerateJsonRecords(10);
+  records.push_back("");
+  records.push_back(std::string(100000, 'a'));
+  DPF_ASSERT_OK_AND_ASSIGN(auto compressor,
+                           RecordCompressor::Create(DeflateParams()));
+  for (const std::string& record : records) {
+    DPF_ASSERT_OK_AND_ASSIGN(std::string compressed,
+                             compressor->Compress(record));
+    EXPECT_THAT(compressor->Decompress(compressed), IsOkAndHolds(record));
+  }
+}
+
+TEST(RecordCompressorTest, IgnoresTrailingNullBytes) {
+  DPF_ASSERT_OK_AND_ASSIGN(auto compressor,
+                           RecordCompressor::Create(DeflateParams()));
+  const std::string record = GenerateJsonRecords(1)[0];
+  DPF_ASSERT_OK_AND_ASSIGN(std::string compressed,
+                           compressor->Compress(record));
+  compressed.resize(compressed.size() + 100, '\0');
+  EXPECT_THAT(compressor->Decompress(compressed), IsOkAndHolds(record));
+}
+
+TEST(RecordCompressorTest, PadsToSizeBucket) {
+  RecordCompressionParams params = DeflateParams();
+  params.set_size_bucket_bytes(64);
+  DPF_ASSERT_OK_AND_ASSIGN(auto compressor, RecordCompressor::Create(params));
+  for (const std::string& record : GenerateJsonRecords(10)) {
+    DPF_ASSERT_OK_AND_ASSIGN(std::string compressed,
+                             compressor->Compress(record));
+    EXPECT_EQ(compressed.size() % 64, 0);
+    EXPECT_THAT(compressor->Decompress(compressed), IsOkAndHolds(record));
+  }
+}
+
+TEST(RecordCompressorTest, DecompressFailsIfRecordIsTruncated) {
+  DPF_ASSERT_OK_AND_ASSIGN(auto compressor,
+                           RecordCompressor::Create(DeflateParams()));
+  DPF_ASSERT_OK_AND_ASSIGN(std::string compressed,
+                           compressor->Compress(GenerateJsonRecords(1)[0]));
+  compressed.resize(compressed.size() / 2);
+  EXPECT_THAT(compressor->Decompress(compressed),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       "Compressed record is corrupted"));
+}
+
+TEST(RecordCompressorTest, CompressFailsIfRecordExceedsMaxRecordSize) {
+  RecordCompressionParams params = DeflateParams();
+  params.set_max_record_size(1000);
+  DPF_ASSERT_OK_AND_ASSIGN(auto compressor, RecordCompressor::Create(params));
+  EXPECT_THAT(compressor->Compress(std::string(1000, 'a')),
+              IsOkAndHolds(Not(SizeIs(0))));
+  EXPECT_THAT(compressor->Compress(std::string(1001, 'a')),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(RecordCompressorTest, DecompressFailsIfRecordExceedsMaxRecordSize) {
+  DPF_ASSERT_OK_AND_ASSIGN(auto compressor,
+                           RecordCompressor::Create(DeflateParams()));
+  for (int64_t record_size : {1000, 100000}) {
+    const std::string record(record_size, 'a');
+    DPF_ASSERT_OK_AND_ASSIGN(std::string compressed,
+                             compressor->Compress(record));
+    RecordCompressionParams params = DeflateParams();
+    params.set_max_record_size(record_size);
+    DPF_ASSERT_OK_AND_ASSIGN(auto exact_compressor,
+                             RecordCompressor::Create(params));
+    EXPECT_THAT(exact_compressor->Decompress(compressed),
+                IsOkAndHolds(record));
+    params.set_max_record_size(record_size - 1);
+    DPF_ASSERT_OK_AND_ASSIGN(auto smaller_compressor,
+                             RecordCompressor::Create(params));
+    EXPECT_THAT(smaller_compressor->Decompress(compressed),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         absl::StrCat("Decompressed record exceeds "
+                                      "`max_record_size` (=",
+                                      record_size - 1, ")")));
+  }
+}
+
+TEST(RecordCompressorTest, DecompressFailsWithDifferentDictionary) {
+  const std::vector<std::string> records = GenerateJsonRecords(100);
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto compressor,
+      RecordCompressor::Create(
+          DeflateParams(TrainCompressionDictionary(records))));
+  DPF_ASSERT_OK_AND_ASSIGN(auto other_compressor,
+                           RecordCompressor::Create(
+                               DeflateParams(std::string(1000, 'x'))));
+  DPF_ASSERT_OK_AND_ASSIGN(std::string compressed,
+                           compressor->Compress(records[0]));
+  EXPECT_THAT(other_compressor->Decompress(compressed),
+              Not(IsOkAndHolds(records[0])));
+}
+
+TEST(TrainCompressionDictionaryTest, RespectsMaxSize) {
+  const std::vector<std::string> records = GenerateJsonRecords(1000);
+  EXPECT_THAT(TrainCompressionDictionary(records, 100), SizeIs(Le(100)));
+  EXPECT_THAT(TrainCompressionDictionary(records),
+              SizeIs(Le(kMaxCompressionDictionarySize)));
+  EXPECT_THAT(TrainCompressionDictionary({}), SizeIs(0));
+}
+
+TEST(TrainCompressionDictionaryTest, DictionaryImprovesCompression) {
+  const std::vector<std::string> records = GenerateJsonRecords(1000);
+  const std::vector<std::string> samples(records.begin(),
+                                         records.begin() + 100);
+  DPF_ASSERT_OK_AND_ASSIGN(auto plain,
+                           RecordCompressor::Create(DeflateParams()));
+  DPF_ASSERT_OK_AND_ASSIGN(
+      auto with_dictionary,
+      RecordCompressor::Create(
+          DeflateParams(TrainCompressionDictionary(samples))));
+  int64_t original_size = 0, plain_size = 0, dictionary_size = 0;
+  for (const std::string& record : records) {
+    DPF_ASSERT_OK_AND_ASSIGN(std::string compressed, plain->Compress(record));
+    DPF_ASSERT_OK_AND_ASSIGN(std::string compressed_with_dictionary,
+                             with_dictionary->Compress(record));
+    EXPECT_THAT(with_dictionary->Decompress(compressed_with_dictionary),
+                IsOkAndHolds(record));
+    original_size += record.size();
+    plain_size += compressed.size();
+    dictionary_size += compressed_with_dictionary.size();
+  }
+  EXPECT_THAT(dictionary_size, Lt(plain_size));
+  EXPECT_THAT(2 * dictionary_size, Lt(original_size));
+}
+
+}  // namespace
+}  // namespace distributed_point_functions
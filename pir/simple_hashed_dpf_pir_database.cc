@@ -31,6 +31,7 @@
 #include "pir/hashing/hash_family.h"
 #include "pir/hashing/hash_family_config.h"
 #include "pir/private_information_retrieval.pb.h"
+#include "pir/record_compression.h"
 
 namespace distributed_point_functions {
 
@@ -94,8 +95,8 @@ absl::StatusOr<std::unique_ptr<SimpleHashedDpfPirDatabase::Interface>>
 SimpleHashedDpfPirDatabase::Builder::Build() {
   DPF_RETURN_IF_ERROR(CheckHasNotBeenBuilt(has_been_built_));
   has_been_built_ = true;
-  int num_buckets = params_.num_buckets();
-  int num_records = records_.size();
+  int64_t num_buckets = params_.num_buckets();
+  int64_t num_records = records_.size();
 
   if (num_buckets <= 0) {
     return absl::InvalidArgumentError("`num_buckets` must be positive");
@@ -111,6 +112,11 @@ SimpleHashedDpfPirDatabase::Builder::Build() {
   if (dense_database_builder_ == nullptr) {
     dense_database_builder_ = std::make_unique<DenseDpfPirDatabase::Builder>();
   }
+  std::unique_ptr<RecordCompressor> compressor;
+  if (params_.has_record_compression()) {
+    DPF_ASSIGN_OR_RETURN(
+        compressor, RecordCompressor::Create(params_.record_compression()));
+  }
 
   // Allocate protos for buckets. The final bucket will consist of a single
   // serialized string containing all key-value pairs that hashed to it.
@@ -121,14 +127,14 @@ SimpleHashedDpfPirDatabase::Builder::Build() {
     if (kv.first.empty()) {
       return absl::InvalidArgumentError("Key cannot be empty");
     }
-    int bucket_index = hash_function(kv.first, num_buckets);
+    int64_t bucket_index = hash_function(kv.first, num_buckets);
     *(bucket_protos[bucket_index].add_keys()) = std::move(kv.first);
     *(bucket_protos[bucket_index].add_values()) = std::move(kv.second);
   }
 
   // Serialize all Key-Value pairs deterministically, and insert the resulting
   // strings into the dense database builder.
-  for (int i = 0; i < num_buckets; ++i) {
+  for (int64_t i = 0; i < num_buckets; ++i) {
     std::string serialized_bucket;
     {  // Start new block so that stream destructors are run before moving the
        // string.
@@ -140,6 +146,10 @@ SimpleHashedDpfPirDatabase::Builder::Build() {
         return absl::InternalError("Serializing bucket to string failed");
       }
     }
+    if (compressor != nullptr) {
+      DPF_ASSIGN_OR_RETURN(serialized_bucket,
+                           compressor->Compress(serialized_bucket));
+    }
     dense_database_builder_->Insert(std::move(serialized_bucket));
   }
   records_.clear();
@@ -163,4 +173,10 @@ SimpleHashedDpfPirDatabase::InnerProductWith(
   return dense_database_->InnerProductWith(selections);
 }
 
+absl::Status SimpleHashedDpfPirDatabase::InnerProductWithInto(
+    absl::Span<const BlockType> selections,
+    InnerProductOutputs outputs) const {
+  return dense_database_->InnerProductWithInto(selections, outputs);
+}
+
 }  // namespace distributed_point_functions
@@ -18,12 +18,14 @@
 #define DISTRIBUTED_POINT_FUNCTIONS_PIR_SIMPLE_HASHED_DPF_PIR_DATABASE_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/numeric/int128.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/types/span.h"
 #include "dpf/xor_wrapper.h"
@@ -85,6 +87,15 @@ class SimpleHashedDpfPirDatabase
   absl::StatusOr<std::vector<ResponseType>> InnerProductWith(
       absl::Span<const std::vector<BlockType>> selections) const override;
 
+  // Responses are laid out as in the underlying dense database.
+  absl::Span<const int64_t> response_part_sizes() const override {
+    return dense_database_->response_part_sizes();
+  }
+
+  // As `InnerProductWith`, but without allocating. See PirDatabaseInterface.
+  absl::Status InnerProductWithInto(absl::Span<const BlockType> selections,
+                                    InnerProductOutputs outputs) const override;
+
  private:
   SimpleHashedDpfPirDatabase(std::unique_ptr<DenseDatabase> dense_database,
                              size_t size, size_t num_selection_bits);
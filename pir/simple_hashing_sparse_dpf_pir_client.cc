@@ -70,7 +70,7 @@ absl::StatusOr<std::string> DummyEncrypter(absl::string_view plaintext,
 SimpleHashingSparseDpfPirClient::SimpleHashingSparseDpfPirClient(
     EncryptHelperRequestFn encrypter, std::string encryption_context_info,
     std::unique_ptr<DenseDpfPirClient> wrapped_client,
-    HashFunction hash_function, int num_buckets, int seed_fingerprint)
+    HashFunction hash_function, int64_t num_buckets, int seed_fingerprint)
     : DpfPirClient(std::move(encrypter), std::move(encryption_context_info)),
       wrapped_client_(std::move(wrapped_client)),
       hash_function_(std::move(hash_function)),
@@ -114,6 +114,14 @@ SimpleHashingSparseDpfPirClient::Create(
   PirConfig wrapped_client_config;
   wrapped_client_config.mutable_dense_dpf_pir_config()->set_num_elements(
       params.simple_hashing_sparse_dpf_pir_server_params().num_buckets());
+  // Buckets are compressed as a whole, so the wrapped client decompresses them.
+  if (params.simple_hashing_sparse_dpf_pir_server_params()
+          .has_record_compression()) {
+    *wrapped_client_config.mutable_dense_dpf_pir_config()
+         ->mutable_record_compression() =
+        params.simple_hashing_sparse_dpf_pir_server_params()
+            .record_compression();
+  }
   DPF_ASSIGN_OR_RETURN(
       std::unique_ptr<DenseDpfPirClient> wrapped_client,
       DenseDpfPirClient::Create(wrapped_client_config, DummyEncrypter, ""));
@@ -128,7 +136,7 @@ absl::StatusOr<std::tuple<DpfPirRequest::PlainRequest,
                           DpfPirRequest::HelperRequest, PirRequestClientState>>
 SimpleHashingSparseDpfPirClient::CreatePlainRequests(
     absl::Span<const std::string> query) const {
-  std::vector<int> indices;
+  std::vector<int64_t> indices;
   indices.reserve(query.size());
   for (int i = 0; i < query.size(); ++i) {
     indices.push_back(hash_function_(query[i], num_buckets_));
@@ -17,6 +17,7 @@
 #ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_SIMPLE_HASHING_SPARSE_DPF_PIR_CLIENT_H_
 #define DISTRIBUTED_POINT_FUNCTIONS_PIR_SIMPLE_HASHING_SPARSE_DPF_PIR_CLIENT_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -74,11 +75,11 @@ class SimpleHashingSparseDpfPirClient
   SimpleHashingSparseDpfPirClient(
       EncryptHelperRequestFn encrypter, std::string encryption_context_info,
       std::unique_ptr<DenseDpfPirClient> wrapped_client,
-      HashFunction hash_function, int num_buckets, int seed_fingerprint);
+      HashFunction hash_function, int64_t num_buckets, int seed_fingerprint);
 
   std::unique_ptr<DenseDpfPirClient> wrapped_client_;
   HashFunction hash_function_;
-  int num_buckets_;
+  int64_t num_buckets_;
   int seed_fingerprint_;
 };
 
@@ -44,6 +44,7 @@ inline constexpr absl::string_view kTestHashFamilySeed = "kTestHashFamilySeed";
 
 using dpf_internal::IsOkAndHolds;
 using dpf_internal::StatusIs;
+using ::testing::ElementsAre;
 using ::testing::HasSubstr;
 using ::testing::NotNull;
 using ::testing::Optional;
@@ -111,6 +112,10 @@ class SimpleHashingSparseDpfPirClientTest : public ::testing::Test {
         HashFamilyConfig::HASH_FAMILY_SHA256);
     config.mutable_simple_hashing_sparse_dpf_pir_config()->set_num_buckets(
         kTestDatabaseNumBuckets);
+    if (record_compression_.has_value()) {
+      *config.mutable_simple_hashing_sparse_dpf_pir_config()
+           ->mutable_record_compression() = *record_compression_;
+    }
     DPF_ASSERT_OK_AND_ASSIGN(
         SimpleHashingParams params,
         SimpleHashingSparseDpfPirServer::GenerateParams(config));
@@ -155,6 +160,8 @@ class SimpleHashingSparseDpfPirClientTest : public ::testing::Test {
                              SimpleHashingSparseDpfPirClient::Create(
                                  leader_->GetPublicParams(), GetEncrypter()));
   }
+  // Set by subclasses before SetUp() to compress the database.
+  absl::optional<RecordCompressionParams> record_compression_;
   std::unique_ptr<SimpleHashingSparseDpfPirClient> client_;
   std::unique_ptr<SimpleHashingSparseDpfPirServer> leader_, helper_;
   std::vector<std::string> keys_, values_;
@@ -242,5 +249,32 @@ TEST_F(SimpleHashingSparseDpfPirClientTest,
   EXPECT_THAT(result[2], Optional(StartsWith(values_[42])));
 }
 
+class SimpleHashingSparseDpfPirClientCompressionTest
+    : public SimpleHashingSparseDpfPirClientTest {
+ protected:
+  SimpleHashingSparseDpfPirClientCompressionTest() {
+    record_compression_.emplace();
+    record_compression_->set_codec(RecordCompressionParams::CODEC_DEFLATE);
+    record_compression_->set_dictionary("Key Value ");
+  }
+};
+
+TEST_F(SimpleHashingSparseDpfPirClientCompressionTest, EndToEndSucceeds) {
+  std::vector<std::string> queries = {"Key 1", "Key", "Key 42"};
+
+  PirRequest request;
+  PirRequestClientState client_state;
+  DPF_ASSERT_OK_AND_ASSIGN(std::tie(request, client_state),
+                           client_->CreateRequest(queries));
+  DPF_ASSERT_OK_AND_ASSIGN(PirResponse response,
+                           leader_->HandleRequest(request));
+  DPF_ASSERT_OK_AND_ASSIGN(std::vector<absl::optional<std::string>> result,
+                           client_->HandleResponse(response, client_state));
+
+  // Decompressed values have no trailing null bytes.
+  EXPECT_THAT(result, ElementsAre(Optional(values_[1]), absl::nullopt,
+                                  Optional(values_[42])));
+}
+
 }  // namespace
 }  // namespace distributed_point_functions
@@ -15,6 +15,7 @@
 #include "pir/simple_hashing_sparse_dpf_pir_server.h"
 
 #include <cmath>
+#include <cstdint>
 #include <limits>
 #include <memory>
 #include <new>
@@ -26,6 +27,7 @@
 #include "absl/numeric/int128.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "dpf/distributed_point_function.h"
 #include "dpf/distributed_point_function.pb.h"
 #include "dpf/status_macros.h"
@@ -68,6 +70,10 @@ SimpleHashingSparseDpfPirServer::GenerateParams(const PirConfig& config) {
       config.simple_hashing_sparse_dpf_pir_config().hash_family());
   params.set_num_buckets(
       config.simple_hashing_sparse_dpf_pir_config().num_buckets());
+  if (config.simple_hashing_sparse_dpf_pir_config().has_record_compression()) {
+    *params.mutable_record_compression() =
+        config.simple_hashing_sparse_dpf_pir_config().record_compression();
+  }
   return params;
 }
 
@@ -156,19 +162,35 @@ absl::StatusOr<PirResponse> SimpleHashingSparseDpfPirServer::HandlePlainRequest(
         "the client are initialized with the same parameters.");
   }
 
-  std::vector<std::vector<XorWrapper<absl::uint128>>> selections(
-      plain_request.dpf_key_size());
-  for (int i = 0; i < plain_request.dpf_key_size(); ++i) {
-    // Evaluate DPF and compute inner product with the database.
-    DPF_ASSIGN_OR_RETURN(
-        auto ctx, dpf_->CreateEvaluationContext(plain_request.dpf_key(i)));
-    DPF_ASSIGN_OR_RETURN(
-        selections[i], dpf_->EvaluateNext<XorWrapper<absl::uint128>>({}, ctx));
+  // Evaluate all keys together, so that their (small) trees share AES batches.
+  // Each output holds the selection bits of kDpfBlockSizeBits buckets, so the
+  // domain beyond the last bucket doesn't need to be expanded.
+  const int64_t num_buckets =
+      params_.simple_hashing_sparse_dpf_pir_server_params().num_buckets();
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<XorWrapper<absl::uint128>> selections,
+      dpf_->EvaluateUntilBatch<XorWrapper<absl::uint128>>(
+          0,
+          absl::MakeConstSpan(plain_request.dpf_key().data(),
+                              plain_request.dpf_key_size()),
+          (num_buckets + kDpfBlockSizeBits - 1) / kDpfBlockSizeBits));
+
+  // The outputs of each key are contiguous, so they can be passed to the
+  // database as they are.
+  PirResponse response;
+  absl::Status status =
+      AppendInnerProducts(*database_, absl::MakeConstSpan(selections),
+                          plain_request.dpf_key_size(), response);
+  if (!absl::IsUnimplemented(status)) {
+    DPF_RETURN_IF_ERROR(status);
+    return response;
   }
 
-  DPF_ASSIGN_OR_RETURN(std::vector<std::string> inner_products,
-                       database_->InnerProductWith(selections));
-  PirResponse response;
+  // The database can only return newly allocated inner products.
+  DPF_ASSIGN_OR_RETURN(
+      std::vector<std::string> inner_products,
+      database_->InnerProductWith(SplitSelections(
+          absl::MakeConstSpan(selections), plain_request.dpf_key_size())));
   response.mutable_dpf_pir_response()->mutable_masked_response()->Reserve(
       inner_products.size());
   for (int i = 0; i < inner_products.size(); ++i) {
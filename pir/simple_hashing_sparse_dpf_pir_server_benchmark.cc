@@ -23,6 +23,7 @@
 #include "absl/random/random.h"
 #include "absl/types/span.h"
 #include "benchmark/benchmark.h"  // third_party/benchmark
+#include "dpf/internal/memory_counters.h"
 #include "dpf/internal/status_matchers.h"
 #include "pir/hashing/hash_family.h"
 #include "pir/hashing/hash_family_config.h"
@@ -102,10 +103,11 @@ void BM_HandlePlainRequest(benchmark::State& state) {
                            CreateHashFunctions(std::move(hash_family), 1));
 
   absl::BitGen bitgen;
+  dpf_internal::MemoryCounters memory_counters(state);
   for (auto _ : state) {
     state.PauseTiming();
 
-    std::vector<int> indices;
+    std::vector<int64_t> indices;
     indices.reserve(num_keys_per_request);
     for (int i = 0; i < num_keys_per_request; ++i) {
       int query_index = absl::Uniform<int>(bitgen, 0, num_records);
@@ -334,7 +334,7 @@ TEST_F(SimpleHashingSparseDpfPirServerTest, HandleRequestSucceeds) {
 TEST_F(SimpleHashingSparseDpfPirServerTest,
        HandlePlainRequestCanBeCalledConcurrently) {
   SetUpServer();
-  std::vector<int> indices = {0};
+  std::vector<int64_t> indices = {0};
   constexpr int kNumThreads = 1024;
 
   // Create plain request for `indices`.
@@ -0,0 +1,99 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pir/testing/in_process_helper_transport.h"
+
+#include <cstdint>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+
+#include "absl/functional/any_invocable.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "dpf/status_macros.h"
+#include "pir/private_information_retrieval.pb.h"
+
+namespace distributed_point_functions {
+namespace pir_testing {
+
+namespace {
+
+// Passes `request` to `helper` through their wire formats.
+absl::StatusOr<PirResponse> CallHelper(const PirServer& helper,
+                                       const PirRequest& request,
+                                       absl::Duration latency) {
+  absl::SleepFor(latency);
+  PirRequest received_request;
+  if (!received_request.ParseFromString(request.SerializeAsString())) {
+    return absl::InternalError("Failed to parse the request");
+  }
+  DPF_ASSIGN_OR_RETURN(PirResponse response,
+                       helper.HandleRequest(received_request));
+  PirResponse received_response;
+  if (!received_response.ParseFromString(response.SerializeAsString())) {
+    return absl::InternalError("Failed to parse the response");
+  }
+  return received_response;
+}
+
+}  // namespace
+
+DpfPirServer::ForwardHelperRequestFn CreateInProcessHelperSender(
+    const PirServer& helper, absl::Duration latency) {
+  return [&helper, latency](const PirRequest& helper_request,
+                            absl::AnyInvocable<void()> while_waiting)
+             -> absl::StatusOr<PirResponse> {
+    absl::StatusOr<PirResponse> response;
+    std::thread call(
+        [&] { response = CallHelper(helper, helper_request, latency); });
+    while_waiting();
+    call.join();
+    return response;
+  };
+}
+
+DpfPirServer::ForwardHelperRequestChunkedFn CreateInProcessChunkedHelperSender(
+    const DpfPirServer& helper, absl::Duration latency) {
+  return [&helper, latency](const PirRequest& helper_request,
+                            int64_t chunk_size,
+                            DpfPirServer::ResponseChunkSink sink) {
+    absl::SleepFor(latency);
+    PirRequest received_request;
+    if (!received_request.ParseFromString(helper_request.SerializeAsString())) {
+      return absl::InternalError("Failed to parse the request");
+    }
+    return helper.HandleRequestChunked(
+        received_request, chunk_size, [&sink](PirResponse chunk) {
+          PirResponse received_chunk;
+          if (!received_chunk.ParseFromString(chunk.SerializeAsString())) {
+            return absl::InternalError("Failed to parse the response chunk");
+          }
+          return sink(std::move(received_chunk));
+        });
+  };
+}
+
+BatchingHelperSender::BatchSenderFn CreateInProcessBatchSender(
+    const PirServer& helper, absl::Duration latency) {
+  return [&helper, latency](const PirRequest& batched_helper_request) {
+    return CallHelper(helper, batched_helper_request, latency);
+  };
+}
+
+}  // namespace pir_testing
+}  // namespace distributed_point_functions
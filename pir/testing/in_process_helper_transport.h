@@ -0,0 +1,53 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_TESTING_IN_PROCESS_HELPER_TRANSPORT_H_
+#define DISTRIBUTED_POINT_FUNCTIONS_PIR_TESTING_IN_PROCESS_HELPER_TRANSPORT_H_
+
+#include "absl/time/time.h"
+#include "pir/batching_helper_sender.h"
+#include "pir/dpf_pir_server.h"
+#include "pir/pir_server.h"
+
+namespace distributed_point_functions {
+namespace pir_testing {
+
+// Stand-ins for the RPC between a Leader and a Helper, for tests and
+// benchmarks running both servers in the same process. Requests and responses
+// are serialized and parsed as they would be on the wire, and each call is
+// delayed by `latency` to model the round trip. `helper` must outlive the
+// returned functions.
+
+// Returns a `sender` for a Leader that forwards each helper request to
+// `helper` on a separate thread, and calls `while_waiting` in the meantime.
+DpfPirServer::ForwardHelperRequestFn CreateInProcessHelperSender(
+    const PirServer& helper, absl::Duration latency = absl::ZeroDuration());
+
+// Returns a chunked `sender` for a Leader that passes the chunks of
+// `helper`'s response to the Leader's sink as they are computed.
+DpfPirServer::ForwardHelperRequestChunkedFn CreateInProcessChunkedHelperSender(
+    const DpfPirServer& helper, absl::Duration latency = absl::ZeroDuration());
+
+// Returns a batch sender for a BatchingHelperSender that forwards batched
+// helper requests to `helper`.
+BatchingHelperSender::BatchSenderFn CreateInProcessBatchSender(
+    const PirServer& helper, absl::Duration latency = absl::ZeroDuration());
+
+}  // namespace pir_testing
+}  // namespace distributed_point_functions
+
+#endif  // DISTRIBUTED_POINT_FUNCTIONS_PIR_TESTING_IN_PROCESS_HELPER_TRANSPORT_H_
@@ -0,0 +1,65 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pir/testing/in_process_helper_transport.h"
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "dpf/internal/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "pir/private_information_retrieval.pb.h"
+#include "pir/testing/mock_pir_server.h"
+
+namespace distributed_point_functions {
+namespace pir_testing {
+namespace {
+
+using dpf_internal::StatusIs;
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::Return;
+
+TEST(InProcessHelperTransport, HelperSenderForwardsRequestAndResponse) {
+  MockPirServer helper;
+  PirResponse response;
+  response.mutable_dpf_pir_response()->add_masked_response("response");
+  EXPECT_CALL(helper, HandleRequest(_)).WillOnce(Return(response));
+  auto sender = CreateInProcessHelperSender(helper);
+
+  bool called_while_waiting = false;
+  DPF_ASSERT_OK_AND_ASSIGN(
+      PirResponse result,
+      sender(PirRequest(),
+             [&called_while_waiting] { called_while_waiting = true; }));
+
+  EXPECT_TRUE(called_while_waiting);
+  EXPECT_THAT(result.dpf_pir_response().masked_response(),
+              ElementsAre("response"));
+}
+
+TEST(InProcessHelperTransport, BatchSenderReturnsHelperError) {
+  MockPirServer helper;
+  EXPECT_CALL(helper, HandleRequest(_))
+      .WillOnce(Return(absl::InvalidArgumentError("invalid")));
+  auto batch_sender = CreateInProcessBatchSender(helper);
+
+  EXPECT_THAT(batch_sender(PirRequest()),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace pir_testing
+}  // namespace distributed_point_functions
@@ -33,13 +33,13 @@ namespace pir_testing {
 // Creates `num_elements` strings to be used as database elements, with the i-th
 // string being absl::StrCat(prefix, i).
 absl::StatusOr<std::vector<std::string>> GenerateCountingStrings(
-    int num_elements, absl::string_view prefix) {
+    int64_t num_elements, absl::string_view prefix) {
   if (num_elements < 0) {
     return absl::InvalidArgumentError("num_elements must be non-negative");
   }
   std::vector<std::string> elements;
   elements.reserve(num_elements);
-  for (int i = 0; i < num_elements; ++i) {
+  for (int64_t i = 0; i < num_elements; ++i) {
     elements.push_back(absl::StrCat(prefix, i));
   }
   return elements;
@@ -66,7 +66,7 @@ absl::StatusOr<std::vector<std::string>> GenerateRandomStrings(
 // Creates `num_elements` random strings to be used as database elements, where
 // all have size `element_size`.
 absl::StatusOr<std::vector<std::string>> GenerateRandomStringsEqualSize(
-    int num_elements, int element_size) {
+    int64_t num_elements, int element_size) {
   if (num_elements < 0) {
     return absl::InvalidArgumentError("num_elements must be non-negative");
   }
@@ -81,7 +81,7 @@ absl::StatusOr<std::vector<std::string>> GenerateRandomStringsEqualSize(
 // elements have variable sizes in the range [avg_element_size_bytes +/-
 // max_size_diff].
 absl::StatusOr<std::vector<std::string>> GenerateRandomStringsVariableSize(
-    int num_elements, int avg_element_size, int max_size_diff) {
+    int64_t num_elements, int avg_element_size, int max_size_diff) {
   if (num_elements < 0) {
     return absl::InvalidArgumentError("num_elements must be non-negative");
   }
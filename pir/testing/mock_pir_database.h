@@ -19,6 +19,7 @@
 
 #include <stddef.h>
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -56,7 +57,7 @@ class MockPirDatabase : public PirDatabaseInterface<BlockType, RecordType> {
 // Creates `num_elements` strings to be used as database elements, with the i-th
 // string being absl::StrCat(prefix, i).
 absl::StatusOr<std::vector<std::string>> GenerateCountingStrings(
-    int num_elements, absl::string_view prefix);
+    int64_t num_elements, absl::string_view prefix);
 
 // Creates random strings to be used as database elements, where the elements'
 // sizes are given in `element_sizes`.
@@ -66,13 +67,13 @@ absl::StatusOr<std::vector<std::string>> GenerateRandomStrings(
 // Creates `num_elements` random strings to be used as database elements, where
 // all have size `element_size`.
 absl::StatusOr<std::vector<std::string>> GenerateRandomStringsEqualSize(
-    int num_elements, int element_size);
+    int64_t num_elements, int element_size);
 
 // Creates `num_elements` random strings to be used as database elements, where
 // elements have variable sizes in the range [avg_element_size_bytes +/-
 // max_size_diff].
 absl::StatusOr<std::vector<std::string>> GenerateRandomStringsVariableSize(
-    int num_elements, int avg_element_size, int max_size_diff);
+    int64_t num_elements, int avg_element_size, int max_size_diff);
 
 // Creates a Database containing the given `elements`.
 template <typename Database>
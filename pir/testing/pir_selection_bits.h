@@ -17,6 +17,7 @@
 #ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_TESTING_PIR_SELECTION_BITS_H_
 #define DISTRIBUTED_POINT_FUNCTIONS_PIR_TESTING_PIR_SELECTION_BITS_H_
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -35,12 +36,12 @@ template <typename BlockType>
 std::vector<BlockType> PackSelectionBits(const std::vector<bool>& selections) {
   constexpr int kBitsPerBlock = 8 * sizeof(BlockType);
 
-  int num_blocks = (selections.size() + kBitsPerBlock - 1) / kBitsPerBlock;
+  int64_t num_blocks = (selections.size() + kBitsPerBlock - 1) / kBitsPerBlock;
   std::vector<BlockType> blocks;
   blocks.reserve(num_blocks);
-  for (int i = 0; i < num_blocks; ++i) {
+  for (int64_t i = 0; i < num_blocks; ++i) {
     typename BlockType::WrappedType block{0};
-    int base = i * kBitsPerBlock;
+    const int64_t base = i * kBitsPerBlock;
     for (int j = 0; j < kBitsPerBlock; ++j) {
       if (base + j >= selections.size()) {
         break;  // reached the last partial block
@@ -57,16 +58,16 @@ std::vector<BlockType> PackSelectionBits(const std::vector<bool>& selections) {
 // Sample a vector of packed random selections bits.
 // The template parameter `BlockType` must be an instance of XorWrapper.
 template <typename BlockType>
-std::vector<BlockType> GenerateRandomPackedSelectionBits(int num_bits) {
+std::vector<BlockType> GenerateRandomPackedSelectionBits(int64_t num_bits) {
   using WrappedType = typename BlockType::WrappedType;
   constexpr int kBitsPerBlock = 8 * sizeof(BlockType);
 
-  int num_blocks = (num_bits + kBitsPerBlock - 1) / kBitsPerBlock;
+  int64_t num_blocks = (num_bits + kBitsPerBlock - 1) / kBitsPerBlock;
   std::vector<BlockType> blocks;
   blocks.reserve(num_blocks);
 
   absl::BitGen bitgen;
-  for (int i = 0; i < num_blocks; ++i) {
+  for (int64_t i = 0; i < num_blocks; ++i) {
     auto bits = absl::Uniform<WrappedType>(bitgen);
     blocks.push_back(BlockType(bits));
   }
@@ -40,14 +40,14 @@ constexpr int kBitsPerBlock = 128;
 
 RequestGenerator::RequestGenerator(
     std::unique_ptr<DistributedPointFunction> dpf, std::string otp_seed,
-    std::string encryption_context_info, int database_size)
+    std::string encryption_context_info, int64_t database_size)
     : dpf_(std::move(dpf)),
       otp_seed_(std::move(otp_seed)),
       encryption_context_info_(std::move(encryption_context_info)),
       database_size_(database_size) {}
 
 absl::StatusOr<std::unique_ptr<RequestGenerator>> RequestGenerator::Create(
-    int database_size, absl::string_view encryption_context_info) {
+    int64_t database_size, absl::string_view encryption_context_info) {
   if (database_size <= 0) {
     return absl::InvalidArgumentError("`database_size` must be positive");
   }
@@ -67,9 +67,9 @@ absl::StatusOr<std::unique_ptr<RequestGenerator>> RequestGenerator::Create(
 absl::StatusOr<
     std::pair<DpfPirRequest::PlainRequest, DpfPirRequest::PlainRequest>>
 RequestGenerator::CreateDpfPirPlainRequests(
-    absl::Span<const int> indices) const {
+    absl::Span<const int64_t> indices) const {
   DpfPirRequest::PlainRequest request1, request2;
-  for (int i = 0; i < indices.size(); ++i) {
+  for (int64_t i = 0; i < indices.size(); ++i) {
     if (indices[i] < 0) {
       return absl::InvalidArgumentError("`indices` must be non-negative");
     }
@@ -89,7 +89,7 @@ RequestGenerator::CreateDpfPirPlainRequests(
 
 absl::StatusOr<DpfPirRequest::LeaderRequest>
 RequestGenerator::CreateDpfPirLeaderRequest(
-    absl::Span<const int> indices) const {
+    absl::Span<const int64_t> indices) const {
   DpfPirRequest::LeaderRequest leader_request;
   DpfPirRequest::HelperRequest helper_request;
   helper_request.set_one_time_pad_seed(otp_seed_);
@@ -17,6 +17,7 @@
 #ifndef DISTRIBUTED_POINT_FUNCTIONS_PIR_TESTING_REQUEST_GENERATOR_H_
 #define DISTRIBUTED_POINT_FUNCTIONS_PIR_TESTING_REQUEST_GENERATOR_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -34,16 +35,16 @@ namespace pir_testing {
 class RequestGenerator {
  public:
   static absl::StatusOr<std::unique_ptr<RequestGenerator>> Create(
-      int database_size, absl::string_view encryption_context_info);
+      int64_t database_size, absl::string_view encryption_context_info);
 
   // Creates a pair of DpfPirRequest::PlainRequests for the given indices.
   absl::StatusOr<
       std::pair<DpfPirRequest::PlainRequest, DpfPirRequest::PlainRequest>>
-  CreateDpfPirPlainRequests(absl::Span<const int> indices) const;
+  CreateDpfPirPlainRequests(absl::Span<const int64_t> indices) const;
 
   // Creates a pair of DpfPirRequest::LeaderRequest for the given indices.
   absl::StatusOr<DpfPirRequest::LeaderRequest> CreateDpfPirLeaderRequest(
-      absl::Span<const int> indices) const;
+      absl::Span<const int64_t> indices) const;
 
   // Returns the one-time-pad seed used for the HelperRequest in
   // CreateDpfPirLeaderRequest.
@@ -53,12 +54,12 @@ class RequestGenerator {
   explicit RequestGenerator(std::unique_ptr<DistributedPointFunction> dpf,
                             std::string otp_seed,
                             std::string encryption_context_info,
-                            int database_size);
+                            int64_t database_size);
 
   std::unique_ptr<DistributedPointFunction> dpf_;
   std::string otp_seed_;
   std::string encryption_context_info_;
-  int database_size_;
+  int64_t database_size_;
 };
 
 }  // namespace pir_testing